@@ -78,10 +78,14 @@ const uint8_t * linphone_buffer_get_content(const LinphoneBuffer *buffer) {
 }
 
 void linphone_buffer_set_content(LinphoneBuffer *buffer, const uint8_t *content, size_t size) {
+	/* Keep the allocation when it is large enough, the file transfer refills the same buffer for each chunk. */
+	if (!buffer->content || buffer->capacity < size + 1) {
+		if (buffer->content) belle_sip_free(buffer->content);
+		buffer->content = reinterpret_cast<uint8_t *>(belle_sip_malloc(size + 1));
+		buffer->capacity = size + 1;
+	}
 	buffer->size = size;
-	if (buffer->content) belle_sip_free(buffer->content);
-	buffer->content = reinterpret_cast<uint8_t *>(belle_sip_malloc(size + 1));
-	memcpy(buffer->content, content, size);
+	memmove(buffer->content, content, size);
     ((char *)buffer->content)[size] = '\0';
 }
 
@@ -93,6 +97,7 @@ void linphone_buffer_set_string_content(LinphoneBuffer *buffer, const char *cont
 	buffer->size = strlen(content);
 	if (buffer->content) belle_sip_free(buffer->content);
 	buffer->content = (uint8_t *)belle_sip_strdup(content);
+	buffer->capacity = buffer->size + 1;
 }
 
 size_t linphone_buffer_get_size(const LinphoneBuffer *buffer) {
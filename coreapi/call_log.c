@@ -36,11 +36,6 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 // TODO: From coreapi. Remove me later.
 #include "private.h"
 
-typedef struct _CallLogStorageResult {
-	LinphoneCore *core;
-	bctbx_list_t *result;
-} CallLogStorageResult;
-
 /*******************************************************************************
  * Internal functions                                                          *
  ******************************************************************************/
@@ -193,6 +188,10 @@ void linphone_call_log_set_call_id(LinphoneCallLog *cl, const char *call_id) {
 	cl->call_id = call_id ? bctbx_strdup(call_id) : NULL;
 }
 
+unsigned int linphone_call_log_get_storage_id(const LinphoneCallLog *cl){
+	return cl->storage_id;
+}
+
 LinphoneCallDir linphone_call_log_get_dir(const LinphoneCallLog *cl){
 	return cl->dir;
 }
@@ -375,6 +374,47 @@ BELLE_SIP_INSTANCIATE_VPTR(LinphoneCallLog, belle_sip_object_t,
  * SQL storage related functions                                               *
  ******************************************************************************/
 
+/* Statements are prepared on first use and kept until the storage is closed. */
+typedef enum _CallLogStatementId {
+	CallLogInsertStatement,
+	CallLogUpdateUrisStatement,
+	CallLogSelectMissingUrisStatement,
+	CallLogSelectPageStatement,
+	CallLogSelectPageForPeerStatement,
+	CallLogSelectPageForLocalStatement,
+	CallLogSelectPageForPeerAndLocalStatement,
+	CallLogSelectForAddressStatement,
+	CallLogSelectLastOutgoingStatement,
+	CallLogSelectFromCallIdStatement,
+	CallLogDeleteStatement,
+	CallLogDeleteAllStatement,
+	CallLogCountStatement,
+	CallLogStatementCount
+} CallLogStatementId;
+
+#define CALL_LOG_COLUMNS "id, caller, callee, direction, duration, start_time, connected_time, status, videoEnabled, quality, call_id, refkey"
+
+static const char *call_log_statements_sql[CallLogStatementCount] = {
+	"INSERT INTO call_history (caller, callee, direction, duration, start_time, connected_time, status, videoEnabled, quality, call_id, refkey, peer_uri, local_uri) "
+		"VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10, ?11, ?12, ?13)",
+	"UPDATE call_history SET peer_uri = ?1, local_uri = ?2 WHERE id = ?3",
+	"SELECT id, caller, callee, direction FROM call_history WHERE peer_uri IS NULL",
+	"SELECT " CALL_LOG_COLUMNS " FROM call_history WHERE id < ?3 ORDER BY id DESC LIMIT ?4",
+	"SELECT " CALL_LOG_COLUMNS " FROM call_history WHERE peer_uri = ?1 AND id < ?3 ORDER BY id DESC LIMIT ?4",
+	"SELECT " CALL_LOG_COLUMNS " FROM call_history WHERE local_uri = ?2 AND id < ?3 ORDER BY id DESC LIMIT ?4",
+	"SELECT " CALL_LOG_COLUMNS " FROM call_history WHERE peer_uri = ?1 AND local_uri = ?2 AND id < ?3 ORDER BY id DESC LIMIT ?4",
+	"SELECT " CALL_LOG_COLUMNS " FROM call_history WHERE peer_uri = ?1 OR local_uri = ?1 ORDER BY id DESC",
+	"SELECT " CALL_LOG_COLUMNS " FROM call_history WHERE direction = 0 ORDER BY id DESC LIMIT 1",
+	"SELECT " CALL_LOG_COLUMNS " FROM call_history WHERE call_id = ?1 ORDER BY id DESC LIMIT 1",
+	"DELETE FROM call_history WHERE id = ?1",
+	"DELETE FROM call_history",
+	"SELECT count(*) FROM call_history"
+};
+
+struct _CallLogStorageStatements {
+	sqlite3_stmt *statements[CallLogStatementCount];
+};
+
 static void linphone_create_call_log_table(sqlite3* db) {
 	char* errmsg=NULL;
 	int ret;
@@ -415,6 +455,149 @@ static void linphone_update_call_log_table(sqlite3* db) {
 			ms_debug("Table call_history updated successfully for call_id and refkey.");
 		}
 	}
+
+	// normalized peer and local addresses, so that lookups by address do not need to scan the whole table
+	ret=sqlite3_exec(db,"ALTER TABLE call_history ADD COLUMN peer_uri TEXT;",NULL,NULL,&errmsg);
+	if(ret != SQLITE_OK) {
+		ms_message("Table already up to date: %s.", errmsg);
+		sqlite3_free(errmsg);
+	} else {
+		ret=sqlite3_exec(db,"ALTER TABLE call_history ADD COLUMN local_uri TEXT;",NULL,NULL,&errmsg);
+		if(ret != SQLITE_OK) {
+			ms_message("Table already up to date: %s.", errmsg);
+			sqlite3_free(errmsg);
+		} else {
+			ms_debug("Table call_history updated successfully for peer_uri and local_uri.");
+		}
+	}
+
+	ret=sqlite3_exec(db,
+		"CREATE INDEX IF NOT EXISTS call_history_peer_local_idx ON call_history (peer_uri, local_uri);"
+		"CREATE INDEX IF NOT EXISTS call_history_local_idx ON call_history (local_uri);"
+		"CREATE INDEX IF NOT EXISTS call_history_direction_idx ON call_history (direction);"
+		"CREATE INDEX IF NOT EXISTS call_history_call_id_idx ON call_history (call_id);",
+		NULL,NULL,&errmsg);
+	if(ret != SQLITE_OK) {
+		ms_error("Cannot create call_history indexes: %s.", errmsg);
+		sqlite3_free(errmsg);
+	}
+}
+
+static sqlite3_stmt *linphone_core_get_call_log_statement(LinphoneCore *lc, CallLogStatementId id) {
+	sqlite3_stmt **stmt;
+
+	if (!lc->logs_db_statements)
+		lc->logs_db_statements = reinterpret_cast<struct _CallLogStorageStatements *>(ms_new0(struct _CallLogStorageStatements, 1));
+	stmt = &lc->logs_db_statements->statements[id];
+	if (*stmt == NULL) {
+		if (sqlite3_prepare_v2(lc->logs_db, call_log_statements_sql[id], -1, stmt, NULL) != SQLITE_OK) {
+			ms_error("Cannot prepare call log statement [%s]: %s", call_log_statements_sql[id], sqlite3_errmsg(lc->logs_db));
+			*stmt = NULL;
+			return NULL;
+		}
+	} else {
+		sqlite3_reset(*stmt);
+		sqlite3_clear_bindings(*stmt);
+	}
+	return *stmt;
+}
+
+static void linphone_core_finalize_call_log_statements(LinphoneCore *lc) {
+	int i;
+	if (!lc->logs_db_statements) return;
+	for (i = 0; i < CallLogStatementCount; i++) {
+		if (lc->logs_db_statements->statements[i]) sqlite3_finalize(lc->logs_db_statements->statements[i]);
+	}
+	ms_free(lc->logs_db_statements);
+	lc->logs_db_statements = NULL;
+}
+
+/*
+ * Key under which an address is indexed: scheme, username and domain only, so that display names, ports and uri
+ * parameters do not prevent a match, like the former LIKE '%uri%' lookups did.
+ */
+static char *call_log_uri_key(const LinphoneAddress *addr) {
+	const char *scheme = linphone_address_get_scheme(addr);
+	const char *username = linphone_address_get_username(addr);
+	const char *domain = linphone_address_get_domain(addr);
+
+	if (username)
+		return bctbx_strdup_printf("%s:%s@%s", scheme ? scheme : "sip", username, domain ? domain : "");
+	return bctbx_strdup_printf("%s:%s", scheme ? scheme : "sip", domain ? domain : "");
+}
+
+static void call_log_get_uri_keys(LinphoneCallDir dir, const LinphoneAddress *from, const LinphoneAddress *to, char **peer_uri, char **local_uri) {
+	*peer_uri = call_log_uri_key(dir == LinphoneCallOutgoing ? to : from);
+	*local_uri = call_log_uri_key(dir == LinphoneCallOutgoing ? from : to);
+}
+
+typedef struct _CallLogUris {
+	sqlite3_int64 id;
+	char *peer_uri;
+	char *local_uri;
+} CallLogUris;
+
+static void call_log_uris_free(CallLogUris *uris) {
+	bctbx_free(uris->peer_uri);
+	bctbx_free(uris->local_uri);
+	ms_free(uris);
+}
+
+/*
+ * Fills the peer_uri and local_uri columns of the rows stored before they existed. The rows are all read before being
+ * updated, so that the table is not modified while it is scanned. A row whose addresses cannot be parsed gets empty
+ * uris, that no lookup matches, so that it is not read again at the next startup.
+ */
+static void linphone_core_fill_call_log_uris(LinphoneCore *lc) {
+	sqlite3_stmt *select_stmt = linphone_core_get_call_log_statement(lc, CallLogSelectMissingUrisStatement);
+	sqlite3_stmt *update_stmt = linphone_core_get_call_log_statement(lc, CallLogUpdateUrisStatement);
+	bctbx_list_t *rows = NULL, *elem;
+	int count = 0, nb_unparsable = 0;
+
+	if (!select_stmt || !update_stmt) return;
+
+	while (sqlite3_step(select_stmt) == SQLITE_ROW) {
+		LinphoneAddress *from = linphone_address_new((const char *)sqlite3_column_text(select_stmt, 1));
+		LinphoneAddress *to = linphone_address_new((const char *)sqlite3_column_text(select_stmt, 2));
+		CallLogUris *uris = ms_new0(CallLogUris, 1);
+
+		uris->id = sqlite3_column_int64(select_stmt, 0);
+		if (from && to) {
+			call_log_get_uri_keys((LinphoneCallDir)sqlite3_column_int(select_stmt, 3), from, to, &uris->peer_uri, &uris->local_uri);
+		} else {
+			uris->peer_uri = bctbx_strdup("");
+			uris->local_uri = bctbx_strdup("");
+			nb_unparsable++;
+		}
+		rows = bctbx_list_prepend(rows, uris);
+		if (from) linphone_address_unref(from);
+		if (to) linphone_address_unref(to);
+	}
+	sqlite3_reset(select_stmt);
+	if (!rows) return;
+
+	sqlite3_exec(lc->logs_db, "BEGIN", NULL, NULL, NULL);
+	for (elem = rows; elem != NULL; elem = bctbx_list_next(elem)) {
+		CallLogUris *uris = (CallLogUris *)bctbx_list_get_data(elem);
+		sqlite3_reset(update_stmt);
+		sqlite3_bind_text(update_stmt, 1, uris->peer_uri, -1, SQLITE_STATIC);
+		sqlite3_bind_text(update_stmt, 2, uris->local_uri, -1, SQLITE_STATIC);
+		sqlite3_bind_int64(update_stmt, 3, uris->id);
+		if (sqlite3_step(update_stmt) == SQLITE_DONE) count++;
+	}
+	sqlite3_exec(lc->logs_db, "COMMIT", NULL, NULL, NULL);
+	sqlite3_reset(update_stmt);
+	sqlite3_clear_bindings(update_stmt);
+	bctbx_list_free_with_data(rows, (bctbx_list_free_func)call_log_uris_free);
+	if (count > 0) ms_message("Indexed addresses of %i call logs", count);
+	if (nb_unparsable > 0) ms_warning("%i call logs have addresses that cannot be parsed, they will not be found by address", nb_unparsable);
+}
+
+/* Number of most recent call logs kept in lc->call_logs when they are stored in a database. */
+static int linphone_core_get_call_logs_window_size(const LinphoneCore *lc) {
+	if (lc->call_logs_window_size <= 0) return lc->max_call_logs;
+	if (lc->max_call_logs == LINPHONE_MAX_CALL_HISTORY_UNLIMITED) return lc->call_logs_window_size;
+	return MIN(lc->max_call_logs, lc->call_logs_window_size);
 }
 
 void linphone_core_call_log_storage_init(LinphoneCore *lc) {
@@ -435,6 +618,7 @@ void linphone_core_call_log_storage_init(LinphoneCore *lc) {
 	linphone_create_call_log_table(db);
 	linphone_update_call_log_table(db);
 	lc->logs_db = db;
+	linphone_core_fill_call_log_uris(lc);
 
 	// Load the existing call logs
 	linphone_core_get_call_history(lc);
@@ -442,6 +626,7 @@ void linphone_core_call_log_storage_init(LinphoneCore *lc) {
 
 void linphone_core_call_log_storage_close(LinphoneCore *lc) {
 	if (lc->logs_db){
+		linphone_core_finalize_call_log_statements(lc);
 		sqlite3_close(lc->logs_db);
 		lc->logs_db = NULL;
 	}
@@ -456,7 +641,7 @@ static LinphoneCallLog * find_call_log_by_storage_id(bctbx_list_t *call_logs, un
 	return NULL;
 }
 
-/* DB layout:
+/* Row layout, see CALL_LOG_COLUMNS:
  * | 0  | storage_id
  * | 1  | from
  * | 2  | to
@@ -470,49 +655,45 @@ static LinphoneCallLog * find_call_log_by_storage_id(bctbx_list_t *call_logs, un
  * | 10 | call_id
  * | 11 | refkey
  */
-static int create_call_log(void *data, int argc, char **argv, char **colName) {
-	CallLogStorageResult *clsres = (CallLogStorageResult *)data;
+static LinphoneCallLog *create_call_log(LinphoneCore *lc, sqlite3_stmt *stmt) {
 	LinphoneAddress *from;
 	LinphoneAddress *to;
 	LinphoneCallDir dir;
 	LinphoneCallLog *log;
+	const char *text;
 
-	unsigned int storage_id = (unsigned int)atoi(argv[0]);
+	unsigned int storage_id = (unsigned int)sqlite3_column_int64(stmt, 0);
 
-	log = find_call_log_by_storage_id(clsres->core->call_logs, storage_id);
-	if (log != NULL) {
-		clsres->result = bctbx_list_append(clsres->result, linphone_call_log_ref(log));
-		return 0;
-	}
+	log = find_call_log_by_storage_id(lc->call_logs, storage_id);
+	if (log != NULL) return linphone_call_log_ref(log);
 
-	from = linphone_address_new(argv[1]);
-	to = linphone_address_new(argv[2]);
+	from = linphone_address_new((const char *)sqlite3_column_text(stmt, 1));
+	to = linphone_address_new((const char *)sqlite3_column_text(stmt, 2));
 
 	if (from == NULL || to == NULL) goto error;
 
-	dir = (LinphoneCallDir) atoi(argv[3]);
+	dir = (LinphoneCallDir) sqlite3_column_int(stmt, 3);
 	log = linphone_call_log_new(dir, from, to);
 
 	log->storage_id = storage_id;
-	log->duration = atoi(argv[4]);
-	log->start_date_time = (time_t)atol(argv[5]);
+	log->duration = sqlite3_column_int(stmt, 4);
+	log->start_date_time = (time_t)sqlite3_column_int64(stmt, 5);
 	set_call_log_date(log,log->start_date_time);
-	log->connected_date_time = (time_t)atol(argv[6]);
-	log->status = (LinphoneCallStatus) atoi(argv[7]);
-	log->video_enabled = atoi(argv[8]) == 1;
-	log->quality = (float)atof(argv[9]);
-
-	if (argc > 10) {
-		if (argv[10] != NULL) {
-			log->call_id = ms_strdup(argv[10]);
-		}
-		if (argv[10] != NULL) {
-			log->refkey = ms_strdup(argv[11]);
-		}
+	log->connected_date_time = (time_t)sqlite3_column_int64(stmt, 6);
+	log->status = (LinphoneCallStatus) sqlite3_column_int(stmt, 7);
+	log->video_enabled = sqlite3_column_int(stmt, 8) == 1;
+	log->quality = (float)sqlite3_column_double(stmt, 9);
+
+	text = (const char *)sqlite3_column_text(stmt, 10);
+	if (text != NULL) {
+		log->call_id = ms_strdup(text);
+	}
+	text = (const char *)sqlite3_column_text(stmt, 11);
+	if (text != NULL) {
+		log->refkey = ms_strdup(text);
 	}
 
-	clsres->result = bctbx_list_append(clsres->result, log);
-	return 0;
+	return log;
 
 error:
 	if (from){
@@ -522,155 +703,203 @@ error:
 		linphone_address_unref(to);
 	}
 	ms_error("Bad call log at storage_id %u", storage_id);
-	return 0;
+	return NULL;
 }
 
-static void linphone_sql_request_call_log(sqlite3 *db, const char *stmt, CallLogStorageResult *clsres) {
-	char* errmsg = NULL;
+/* Runs a bound select statement and returns the matching logs, most recent first. */
+static bctbx_list_t *linphone_sql_request_call_log(LinphoneCore *lc, sqlite3_stmt *stmt, const char *caller) {
+	bctbx_list_t *result = NULL;
+	bctbx_list_t *tail = NULL;
+	uint64_t begin, end;
 	int ret;
-	ret = sqlite3_exec(db, stmt, create_call_log, clsres, &errmsg);
-	if (ret != SQLITE_OK) {
-		ms_error("linphone_sql_request: statement %s -> error sqlite3_exec(): %s.", stmt, errmsg);
-		sqlite3_free(errmsg);
+
+	begin = ortp_get_cur_time_ms();
+	while ((ret = sqlite3_step(stmt)) == SQLITE_ROW) {
+		LinphoneCallLog *log = create_call_log(lc, stmt);
+		if (log) {
+			bctbx_list_t *elem = bctbx_list_append(tail, log);
+			if (!result) result = elem;
+			tail = tail ? bctbx_list_next(tail) : elem;
+		}
 	}
+	if (ret != SQLITE_DONE) {
+		ms_error("linphone_sql_request: statement %s -> error sqlite3_step(): %s.", sqlite3_sql(stmt), sqlite3_errmsg(lc->logs_db));
+	}
+	sqlite3_reset(stmt);
+	end = ortp_get_cur_time_ms();
+	ms_message("%s(): completed in %i ms", caller, (int)(end - begin));
+
+	return result;
 }
 
-static int linphone_sql_request_generic(sqlite3* db, const char *stmt) {
-	char* errmsg = NULL;
-	int ret;
-	ret = sqlite3_exec(db, stmt, NULL, NULL, &errmsg);
-	if (ret != SQLITE_OK) {
-		ms_error("linphone_sql_request: statement %s -> error sqlite3_exec(): %s.", stmt, errmsg);
-		sqlite3_free(errmsg);
+static int linphone_sql_request_generic(LinphoneCore *lc, sqlite3_stmt *stmt) {
+	int ret = sqlite3_step(stmt);
+	if (ret != SQLITE_DONE) {
+		ms_error("linphone_sql_request: statement %s -> error sqlite3_step(): %s.", sqlite3_sql(stmt), sqlite3_errmsg(lc->logs_db));
 	}
+	sqlite3_reset(stmt);
 	return ret;
 }
 
+static void linphone_core_trim_call_logs(LinphoneCore *lc) {
+	int window_size = linphone_core_get_call_logs_window_size(lc);
+	bctbx_list_t *last = lc->call_logs;
+	int i;
+
+	if (window_size == LINPHONE_MAX_CALL_HISTORY_UNLIMITED) return;
+	if (window_size <= 0) {
+		lc->call_logs = bctbx_list_free_with_data(lc->call_logs, (void (*)(void*))linphone_call_log_unref);
+		return;
+	}
+	for (i = 1; last && i < window_size; i++) last = bctbx_list_next(last);
+	if (last && last->next) {
+		bctbx_list_t *older = last->next;
+		last->next = NULL;
+		older->prev = NULL;
+		bctbx_list_free_with_data(older, (void (*)(void*))linphone_call_log_unref);
+	}
+}
+
 void linphone_core_store_call_log(LinphoneCore *lc, LinphoneCallLog *log) {
 	if (lc && lc->logs_db){
+		sqlite3_stmt *stmt = linphone_core_get_call_log_statement(lc, CallLogInsertStatement);
 		char *from, *to;
-		char *buf;
-
-		from = linphone_address_as_string(log->from);
-		to = linphone_address_as_string(log->to);
-		buf = sqlite3_mprintf("INSERT INTO call_history VALUES(NULL,%Q,%Q,%i,%i,%lld,%lld,%i,%i,%f,%Q,%Q);",
-						from,
-						to,
-						log->dir,
-						log->duration,
-						(int64_t)log->start_date_time,
-						(int64_t)log->connected_date_time,
-						log->status,
-						log->video_enabled ? 1 : 0,
-						log->quality,
-						log->call_id,
-						log->refkey
-					);
-		linphone_sql_request_generic(lc->logs_db, buf);
-		sqlite3_free(buf);
-		ms_free(from);
-		ms_free(to);
-
-		log->storage_id = (unsigned int)sqlite3_last_insert_rowid(lc->logs_db);
+		char *peer_uri, *local_uri;
+
+		if (stmt) {
+			from = linphone_address_as_string(log->from);
+			to = linphone_address_as_string(log->to);
+			call_log_get_uri_keys(log->dir, log->from, log->to, &peer_uri, &local_uri);
+			sqlite3_bind_text(stmt, 1, from, -1, SQLITE_TRANSIENT);
+			sqlite3_bind_text(stmt, 2, to, -1, SQLITE_TRANSIENT);
+			sqlite3_bind_int(stmt, 3, log->dir);
+			sqlite3_bind_int(stmt, 4, log->duration);
+			sqlite3_bind_int64(stmt, 5, (int64_t)log->start_date_time);
+			sqlite3_bind_int64(stmt, 6, (int64_t)log->connected_date_time);
+			sqlite3_bind_int(stmt, 7, log->status);
+			sqlite3_bind_int(stmt, 8, log->video_enabled ? 1 : 0);
+			sqlite3_bind_double(stmt, 9, log->quality);
+			sqlite3_bind_text(stmt, 10, log->call_id, -1, SQLITE_TRANSIENT);
+			sqlite3_bind_text(stmt, 11, log->refkey, -1, SQLITE_TRANSIENT);
+			sqlite3_bind_text(stmt, 12, peer_uri, -1, SQLITE_TRANSIENT);
+			sqlite3_bind_text(stmt, 13, local_uri, -1, SQLITE_TRANSIENT);
+			if (linphone_sql_request_generic(lc, stmt) == SQLITE_DONE)
+				log->storage_id = (unsigned int)sqlite3_last_insert_rowid(lc->logs_db);
+			ms_free(from);
+			ms_free(to);
+			bctbx_free(peer_uri);
+			bctbx_free(local_uri);
+		}
 	}
 
 	if (lc) {
 		lc->call_logs = bctbx_list_prepend(lc->call_logs, linphone_call_log_ref(log));
+		if (lc->logs_db) linphone_core_trim_call_logs(lc);
 	}
 }
 
 const bctbx_list_t *linphone_core_get_call_history(LinphoneCore *lc) {
-	char *buf;
-	uint64_t begin,end;
-	CallLogStorageResult clsres;
+	if (!lc || lc->logs_db == NULL) return NULL;
+	if (lc->call_logs != NULL) return lc->call_logs;
+
+	lc->call_logs = linphone_core_get_call_history_page(lc, NULL, NULL, 0, linphone_core_get_call_logs_window_size(lc));
+	return lc->call_logs;
+}
+
+bctbx_list_t *linphone_core_get_call_history_page(
+	LinphoneCore *lc,
+	const LinphoneAddress *peer_addr,
+	const LinphoneAddress *local_addr,
+	unsigned int before_id,
+	int limit
+) {
+	CallLogStatementId id;
+	sqlite3_stmt *stmt;
+	char *peer_uri = NULL;
+	char *local_uri = NULL;
+	bctbx_list_t *result;
 
 	if (!lc || lc->logs_db == NULL) return NULL;
-		if (lc->call_logs != NULL) return lc->call_logs;
 
-	if (lc->max_call_logs != LINPHONE_MAX_CALL_HISTORY_UNLIMITED){
-		buf = sqlite3_mprintf("SELECT * FROM call_history ORDER BY id DESC LIMIT %i", lc->max_call_logs);
-	}else{
-		buf = sqlite3_mprintf("SELECT * FROM call_history ORDER BY id DESC");
-	}
+	if (peer_addr && local_addr) id = CallLogSelectPageForPeerAndLocalStatement;
+	else if (peer_addr) id = CallLogSelectPageForPeerStatement;
+	else if (local_addr) id = CallLogSelectPageForLocalStatement;
+	else id = CallLogSelectPageStatement;
+	stmt = linphone_core_get_call_log_statement(lc, id);
+	if (!stmt) return NULL;
 
-	clsres.core = lc;
-	clsres.result = NULL;
-	begin = ortp_get_cur_time_ms();
-	linphone_sql_request_call_log(lc->logs_db, buf, &clsres);
-	end = ortp_get_cur_time_ms();
-	ms_message("%s(): completed in %i ms",__FUNCTION__, (int)(end-begin));
-	sqlite3_free(buf);
+	if (peer_addr) {
+		peer_uri = call_log_uri_key(peer_addr);
+		sqlite3_bind_text(stmt, 1, peer_uri, -1, SQLITE_TRANSIENT);
+	}
+	if (local_addr) {
+		local_uri = call_log_uri_key(local_addr);
+		sqlite3_bind_text(stmt, 2, local_uri, -1, SQLITE_TRANSIENT);
+	}
+	sqlite3_bind_int64(stmt, 3, before_id > 0 ? (sqlite3_int64)before_id : INT64_MAX);
+	sqlite3_bind_int(stmt, 4, limit >= 0 ? limit : -1);
 
-	lc->call_logs = clsres.result;
-	return lc->call_logs;
+	result = linphone_sql_request_call_log(lc, stmt, __FUNCTION__);
+	if (peer_uri) bctbx_free(peer_uri);
+	if (local_uri) bctbx_free(local_uri);
+	return result;
 }
 
 void linphone_core_delete_call_history(LinphoneCore *lc) {
-	char *buf;
+	sqlite3_stmt *stmt;
 
 	if (!lc || lc->logs_db == NULL) return ;
 
-	buf = sqlite3_mprintf("DELETE FROM call_history");
-	linphone_sql_request_generic(lc->logs_db, buf);
-	sqlite3_free(buf);
+	stmt = linphone_core_get_call_log_statement(lc, CallLogDeleteAllStatement);
+	if (stmt) linphone_sql_request_generic(lc, stmt);
 }
 
 void linphone_core_delete_call_log(LinphoneCore *lc, LinphoneCallLog *log) {
-	char *buf;
+	sqlite3_stmt *stmt;
 
 	if (!lc || lc->logs_db == NULL) return ;
 
-	buf = sqlite3_mprintf("DELETE FROM call_history WHERE id = %u", log->storage_id);
-	linphone_sql_request_generic(lc->logs_db, buf);
-	sqlite3_free(buf);
+	stmt = linphone_core_get_call_log_statement(lc, CallLogDeleteStatement);
+	if (!stmt) return;
+	sqlite3_bind_int64(stmt, 1, log->storage_id);
+	linphone_sql_request_generic(lc, stmt);
 }
 
 int linphone_core_get_call_history_size(LinphoneCore *lc) {
 	int numrows = 0;
-	char *buf;
-	sqlite3_stmt *selectStatement;
-	int returnValue;
+	sqlite3_stmt *stmt;
 
 	if (!lc)
 		return 0;
 	if (!lc->logs_db)
 		return (int)bctbx_list_size(lc->call_logs);
 
-	buf = sqlite3_mprintf("SELECT count(*) FROM call_history");
-	returnValue = sqlite3_prepare_v2(lc->logs_db, buf, -1, &selectStatement, NULL);
-	if (returnValue == SQLITE_OK){
-		if(sqlite3_step(selectStatement) == SQLITE_ROW){
-			numrows = sqlite3_column_int(selectStatement, 0);
+	stmt = linphone_core_get_call_log_statement(lc, CallLogCountStatement);
+	if (stmt) {
+		if (sqlite3_step(stmt) == SQLITE_ROW) {
+			numrows = sqlite3_column_int(stmt, 0);
 		}
+		sqlite3_reset(stmt);
 	}
-	sqlite3_finalize(selectStatement);
-	sqlite3_free(buf);
 
 	return numrows;
 }
 
 bctbx_list_t * linphone_core_get_call_history_for_address(LinphoneCore *lc, const LinphoneAddress *addr) {
-	char *buf;
-	char *sipAddress;
-	uint64_t begin,end;
-	CallLogStorageResult clsres;
+	sqlite3_stmt *stmt;
+	char *uri;
+	bctbx_list_t *result;
 
 	if (!lc || lc->logs_db == NULL || addr == NULL) return NULL;
 
-	/*since we want to append query parameters depending on arguments given, we use malloc instead of sqlite3_mprintf*/
-	sipAddress = linphone_address_as_string_uri_only(addr);
-	buf = sqlite3_mprintf("SELECT * FROM call_history WHERE caller LIKE '%%%q%%' OR callee LIKE '%%%q%%' ORDER BY id DESC", sipAddress, sipAddress); // The '%%%q%%' takes care of the eventual presence of a display name
+	stmt = linphone_core_get_call_log_statement(lc, CallLogSelectForAddressStatement);
+	if (!stmt) return NULL;
+	uri = call_log_uri_key(addr);
+	sqlite3_bind_text(stmt, 1, uri, -1, SQLITE_TRANSIENT);
+	result = linphone_sql_request_call_log(lc, stmt, __FUNCTION__);
+	bctbx_free(uri);
 
-	clsres.core = lc;
-	clsres.result = NULL;
-	begin = ortp_get_cur_time_ms();
-	linphone_sql_request_call_log(lc->logs_db, buf, &clsres);
-	end = ortp_get_cur_time_ms();
-	ms_message("%s(): completed in %i ms",__FUNCTION__, (int)(end-begin));
-	sqlite3_free(buf);
-	ms_free(sipAddress);
-
-	return clsres.result;
+	return result;
 }
 
 bctbx_list_t *linphone_core_get_call_history_2(
@@ -678,87 +907,45 @@ bctbx_list_t *linphone_core_get_call_history_2(
 	const LinphoneAddress *peer_addr,
 	const LinphoneAddress *local_addr
 ) {
-	char *buf;
-	char *peer_addr_str;
-	char *local_addr_str;
-	uint64_t begin, end;
-	CallLogStorageResult clsres;
-
 	if (!lc || !lc->logs_db || !peer_addr || !local_addr) return NULL;
 
-	peer_addr_str = bctbx_strdup(L_GET_CPP_PTR_FROM_C_OBJECT(peer_addr)->asStringUriOnly().c_str());
-	local_addr_str = bctbx_strdup(L_GET_CPP_PTR_FROM_C_OBJECT(local_addr)->asStringUriOnly().c_str());
-	buf = sqlite3_mprintf(
-		"SELECT * FROM call_history WHERE "
-		"(caller LIKE '%%%q%%' AND callee LIKE '%%%q%%' AND direction = 0) OR "
-		"(caller LIKE '%%%q%%' AND callee LIKE '%%%q%%' AND direction = 1) "
-		"ORDER BY id DESC",
-		local_addr_str,
-		peer_addr_str,
-		peer_addr_str,
-		local_addr_str
-	);
-
-	clsres.core = lc;
-	clsres.result = NULL;
-	begin = ortp_get_cur_time_ms();
-	linphone_sql_request_call_log(lc->logs_db, buf, &clsres);
-	end = ortp_get_cur_time_ms();
-	bctbx_message("%s(): completed in %i ms", __FUNCTION__, (int)(end - begin));
-	sqlite3_free(buf);
-	bctbx_free(peer_addr_str);
-	bctbx_free(local_addr_str);
-
-	return clsres.result;
+	return linphone_core_get_call_history_page(lc, peer_addr, local_addr, 0, -1);
 }
 
 LinphoneCallLog * linphone_core_get_last_outgoing_call_log(LinphoneCore *lc) {
-	char *buf;
-	uint64_t begin,end;
-	CallLogStorageResult clsres;
+	sqlite3_stmt *stmt;
+	bctbx_list_t *logs;
 	LinphoneCallLog *result = NULL;
 
 	if (!lc || lc->logs_db == NULL) return NULL;
 
-	/*since we want to append query parameters depending on arguments given, we use malloc instead of sqlite3_mprintf*/
-	buf = sqlite3_mprintf("SELECT * FROM call_history WHERE direction = 0 ORDER BY id DESC LIMIT 1");
+	stmt = linphone_core_get_call_log_statement(lc, CallLogSelectLastOutgoingStatement);
+	if (!stmt) return NULL;
+	logs = linphone_sql_request_call_log(lc, stmt, __FUNCTION__);
 
-	clsres.core = lc;
-	clsres.result = NULL;
-	begin = ortp_get_cur_time_ms();
-	linphone_sql_request_call_log(lc->logs_db, buf, &clsres);
-	end = ortp_get_cur_time_ms();
-	ms_message("%s(): completed in %i ms",__FUNCTION__, (int)(end-begin));
-	sqlite3_free(buf);
-
-	if (clsres.result != NULL) {
-		result = (LinphoneCallLog *)bctbx_list_get_data(clsres.result);
+	if (logs != NULL) {
+		result = (LinphoneCallLog *)bctbx_list_get_data(logs);
+		bctbx_list_free(logs);
 	}
 
 	return result;
 }
 
 LinphoneCallLog * linphone_core_find_call_log_from_call_id(LinphoneCore *lc, const char *call_id) {
-	char *buf;
-	uint64_t begin,end;
-	CallLogStorageResult clsres;
+	sqlite3_stmt *stmt;
+	bctbx_list_t *logs;
 	LinphoneCallLog* result = NULL;
 
 	if (!lc || lc->logs_db == NULL) return NULL;
 
-	/*since we want to append query parameters depending on arguments given, we use malloc instead of sqlite3_mprintf*/
-	buf = sqlite3_mprintf("SELECT * FROM call_history WHERE call_id = '%q' ORDER BY id DESC LIMIT 1", call_id);
-
-	clsres.core = lc;
-	clsres.result = NULL;
-	begin = ortp_get_cur_time_ms();
-	linphone_sql_request_call_log(lc->logs_db, buf, &clsres);
-	end = ortp_get_cur_time_ms();
-	ms_message("%s(): completed in %i ms",__FUNCTION__, (int)(end-begin));
-	sqlite3_free(buf);
+	stmt = linphone_core_get_call_log_statement(lc, CallLogSelectFromCallIdStatement);
+	if (!stmt) return NULL;
+	sqlite3_bind_text(stmt, 1, call_id, -1, SQLITE_TRANSIENT);
+	logs = linphone_sql_request_call_log(lc, stmt, __FUNCTION__);
 
-	if (clsres.result != NULL) {
-		result = (LinphoneCallLog *)bctbx_list_get_data(clsres.result);
+	if (logs != NULL) {
+		result = (LinphoneCallLog *)bctbx_list_get_data(logs);
+		bctbx_list_free(logs);
 	}
 
 	return result;
@@ -111,46 +111,104 @@ static int friend_compare(const void * a, const void * b) {
 	return ret;
 }
 
-static LinphoneFriendPresence * find_presence_model_for_uri_or_tel(const LinphoneFriend *lf, const char *uri_or_tel) {
-	bctbx_list_t *iterator = NULL;
-	LinphoneAddress *uri_or_tel_addr = NULL;
-	LinphoneFriendPresence *result=NULL;
+/*
+ * Computes the key used to index presence models: the parts of the address that are compared by linphone_address_weak_equal().
+ */
+static char * presence_model_key_for_uri_or_tel(LinphoneCore *lc, const char *uri_or_tel) {
+	LinphoneAddress *addr = linphone_core_interpret_url(lc, uri_or_tel);
+	char *key;
+	if (!addr) return NULL;
+	key = ms_strdup_printf("%s@%s:%d",
+		linphone_address_get_username(addr) ? linphone_address_get_username(addr) : "",
+		linphone_address_get_domain(addr) ? linphone_address_get_domain(addr) : "",
+		linphone_address_get_port(addr));
+	linphone_address_unref(addr);
+	return key;
+}
+
+static LinphoneFriendPresence * find_presence_model_in_map(const LinphoneFriend *lf, const char *key) {
+	LinphoneFriendPresence *result = NULL;
+	bctbx_iterator_t *it = bctbx_map_cchar_find_key(lf->presence_models_map, key);
+	bctbx_iterator_t *end = bctbx_map_cchar_end(lf->presence_models_map);
+	if (!bctbx_iterator_cchar_equals(it, end)) {
+		bctbx_pair_t *pair = bctbx_iterator_cchar_get_pair(it);
+		result = (LinphoneFriendPresence *)bctbx_pair_cchar_get_second(pair);
+	}
+	bctbx_iterator_cchar_delete(it);
+	bctbx_iterator_cchar_delete(end);
+	return result;
+}
+
+static void index_presence_model(LinphoneFriend *lf, const char *key, LinphoneFriendPresence *lfp) {
+	bctbx_pair_t *pair = (bctbx_pair_t *)bctbx_pair_cchar_new(key, lfp);
+	bctbx_map_cchar_insert_and_delete(lf->presence_models_map, pair);
+}
+
+/*
+ * Looks up the presence model first by the raw uri_or_tel (no parsing at all when the same string is used again),
+ * then by its normalized key, which requires a single parsing of the searched uri_or_tel.
+ * found_by_key is set to TRUE when the match was made through the normalized key, i.e. the raw string is not indexed yet.
+ */
+static LinphoneFriendPresence * lookup_presence_model_for_uri_or_tel(const LinphoneFriend *lf, const char *uri_or_tel, bool_t *found_by_key) {
+	LinphoneFriendPresence *result;
+	char *key;
+	if (found_by_key) *found_by_key = FALSE;
 	if (!lf->lc) {
 		ms_warning("Cannot find uri of tel [%s] from friend [%p] because not associated to any Linphone core object",uri_or_tel,lf);
 		return NULL;
 	}
-	if ((iterator = lf->presence_models) == NULL) {
+	if (lf->presence_models == NULL || lf->presence_models_map == NULL) {
 		/*no need to move forward, just reutn to avoid useless uri parsing*/
 		return NULL;
-	};
+	}
 
-	uri_or_tel_addr = linphone_core_interpret_url(lf->lc, uri_or_tel);
+	result = find_presence_model_in_map(lf, uri_or_tel);
+	if (result) return result;
 
-	while (uri_or_tel_addr && iterator) {
-		LinphoneFriendPresence *lfp = (LinphoneFriendPresence *)bctbx_list_get_data(iterator);
-		LinphoneAddress *lfp_addr = linphone_core_interpret_url(lf->lc, lfp->uri_or_tel);
-		if (lfp_addr && linphone_address_weak_equal(uri_or_tel_addr, lfp_addr)) {
-			result = lfp;
-		}
-		if (lfp_addr) linphone_address_unref(lfp_addr);
-		if (result == NULL)
-			iterator = bctbx_list_next(iterator);
-		else
-			break;
+	key = presence_model_key_for_uri_or_tel(lf->lc, uri_or_tel);
+	if (key) {
+		result = find_presence_model_in_map(lf, key);
+		ms_free(key);
+		if (result && found_by_key) *found_by_key = TRUE;
 	}
-	if (uri_or_tel_addr) linphone_address_unref(uri_or_tel_addr);
 	return result;
 }
 
+static LinphoneFriendPresence * find_presence_model_for_uri_or_tel(const LinphoneFriend *lf, const char *uri_or_tel) {
+	return lookup_presence_model_for_uri_or_tel(lf, uri_or_tel, NULL);
+}
+
 static void add_presence_model_for_uri_or_tel(LinphoneFriend *lf, const char *uri_or_tel, LinphonePresenceModel *presence) {
 	LinphoneFriendPresence *lfp = ms_new0(LinphoneFriendPresence, 1);
 	lfp->uri_or_tel = ms_strdup(uri_or_tel);
+	lfp->key = lf->lc ? presence_model_key_for_uri_or_tel(lf->lc, uri_or_tel) : NULL;
 	lfp->presence = linphone_presence_model_ref(presence);
 	lf->presence_models = bctbx_list_append(lf->presence_models, lfp);
+
+	if (!lf->presence_models_map) lf->presence_models_map = bctbx_mmap_cchar_new();
+	index_presence_model(lf, lfp->uri_or_tel, lfp);
+	if (lfp->key && strcmp(lfp->key, lfp->uri_or_tel) != 0)
+		index_presence_model(lf, lfp->key, lfp);
+}
+
+/*
+ * Computes and indexes the keys of the presence models added while the friend was not associated to any core.
+ */
+void linphone_friend_index_presence_models(LinphoneFriend *lf) {
+	bctbx_list_t *elem;
+	if (!lf->lc) return;
+	for (elem = lf->presence_models; elem != NULL; elem = bctbx_list_next(elem)) {
+		LinphoneFriendPresence *lfp = (LinphoneFriendPresence *)bctbx_list_get_data(elem);
+		if (lfp->key) continue;
+		lfp->key = presence_model_key_for_uri_or_tel(lf->lc, lfp->uri_or_tel);
+		if (lfp->key && strcmp(lfp->key, lfp->uri_or_tel) != 0)
+			index_presence_model(lf, lfp->key, lfp);
+	}
 }
 
 static void free_friend_presence(LinphoneFriendPresence *lfp) {
 	ms_free(lfp->uri_or_tel);
+	if (lfp->key) ms_free(lfp->key);
 	if (lfp->presence) linphone_presence_model_unref(lfp->presence);
 	ms_free(lfp);
 }
@@ -181,7 +239,7 @@ void __linphone_friend_do_subscribe(LinphoneFriend *fr){
 	if (addr != NULL) {
 		if (fr->outsub==NULL){
 			/* people for which we don't have yet an answer should appear as offline */
-			fr->presence_models = bctbx_list_free_with_data(fr->presence_models, (bctbx_list_free_func)free_friend_presence);
+			linphone_friend_clear_presence_models(fr);
 			/*
 			if (fr->lc->vtable.notify_recv)
 				fr->lc->vtable.notify_recv(fr->lc,(LinphoneFriend*)fr);
@@ -584,7 +642,7 @@ static void _linphone_friend_release_ops(LinphoneFriend *lf){
 
 static void _linphone_friend_destroy(LinphoneFriend *lf){
 	_linphone_friend_release_ops(lf);
-	if (lf->presence_models) bctbx_list_free_with_data(lf->presence_models, (bctbx_list_free_func)free_friend_presence);
+	linphone_friend_clear_presence_models(lf);
 	if (lf->phone_number_sip_uri_map) bctbx_list_free_with_data(lf->phone_number_sip_uri_map, (bctbx_list_free_func)free_phone_number_sip_uri);
 	if (lf->uri!=NULL) linphone_address_unref(lf->uri);
 	if (lf->info!=NULL) buddy_info_free(lf->info);
@@ -753,10 +811,13 @@ void linphone_friend_set_presence_model(LinphoneFriend *lf, LinphonePresenceMode
 }
 
 void linphone_friend_set_presence_model_for_uri_or_tel(LinphoneFriend *lf, const char *uri_or_tel, LinphonePresenceModel *presence) {
-	LinphoneFriendPresence *lfp = find_presence_model_for_uri_or_tel(lf, uri_or_tel);
+	bool_t found_by_key = FALSE;
+	LinphoneFriendPresence *lfp = lookup_presence_model_for_uri_or_tel(lf, uri_or_tel, &found_by_key);
 	if (lfp) {
 		if (lfp->presence) linphone_presence_model_unref(lfp->presence);
 		lfp->presence = linphone_presence_model_ref(presence);
+		/* Remember this spelling of the address so that next lookups with it don't need any parsing */
+		if (found_by_key) index_presence_model(lf, uri_or_tel, lfp);
 	} else {
 		add_presence_model_for_uri_or_tel(lf, uri_or_tel, presence);
 	}
@@ -1768,6 +1829,10 @@ const char * linphone_friend_sip_uri_to_phone_number(LinphoneFriend *lf, const c
 }
 
 void linphone_friend_clear_presence_models(LinphoneFriend *lf) {
+	if (lf->presence_models_map) {
+		bctbx_mmap_cchar_delete(lf->presence_models_map);
+		lf->presence_models_map = NULL;
+	}
 	lf->presence_models = bctbx_list_free_with_data(lf->presence_models, (bctbx_list_free_func)free_friend_presence);
 }
 
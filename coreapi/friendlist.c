@@ -260,170 +260,236 @@ static void linphone_friend_presence_received(LinphoneFriendList *list, Linphone
 	linphone_core_notify_notify_presence_received(list->lc, lf);
 }
 
-static void linphone_friend_list_parse_multipart_related_body(LinphoneFriendList *list, const LinphoneContent *body, const char *first_part_body) {
-	xmlparsing_context_t *xml_ctx = linphone_xmlparsing_context_new();
-	xmlSetGenericErrorFunc(xml_ctx, linphone_xmlparsing_genericxml_error);
-	xml_ctx->doc = xmlReadDoc((const unsigned char*)first_part_body, 0, NULL, 0);
-	if (xml_ctx->doc) {
-		LinphoneFriend *lf;
-		LinphoneContent *presence_part;
-		xmlXPathObjectPtr resource_object;
-		xmlXPathObjectPtr name_object;
-		char *version_str = NULL;
-		char *full_state_str = NULL;
-		char *uri = NULL;
-		bool_t full_state = FALSE;
-		int version;
-		int i;
-		bctbx_list_t *list_friends_presence_received = NULL;
-		LinphoneFriendListCbs *list_cbs = linphone_friend_list_get_callbacks(list);
-
-		if (linphone_create_xml_xpath_context(xml_ctx) < 0) goto end;
-		xmlXPathRegisterNs(xml_ctx->xpath_ctx, (const xmlChar *)"rlmi", (const xmlChar *)"urn:ietf:params:xml:ns:rlmi");
-
-		version_str = linphone_get_xml_attribute_text_content(xml_ctx, "/rlmi:list", "version");
-		if (!version_str) {
-			ms_warning("rlmi+xml: No version attribute in list");
-			goto end;
+static const char *rlmi_ns = "urn:ietf:params:xml:ns:rlmi";
+
+static void linphone_friend_list_apply_resource_name(LinphoneFriendList *list, const char *uri, const char *name) {
+	LinphoneFriend *lf;
+	LinphoneAddress *addr = linphone_address_new(uri);
+	if (!addr)
+		return;
+	lf = linphone_friend_list_find_friend_by_address(list, addr);
+	linphone_address_unref(addr);
+	if (!lf && list->bodyless_subscription) {
+		lf = linphone_core_create_friend_with_address(list->lc, uri);
+		linphone_friend_list_add_friend(list, lf);
+		linphone_friend_unref(lf);
+	}
+	if (lf)
+		linphone_friend_set_name(lf, name);
+}
+
+static void linphone_friend_list_apply_resource_presence(LinphoneFriendList *list, const char *resource_uri, SalBodyHandler *presence_part, bctbx_list_t **list_friends_presence_received) {
+	SalPresenceModel *presence = NULL;
+	LinphoneAddress *addr;
+	LinphoneFriend *lf;
+	char *uri;
+	const char *type = sal_body_handler_get_type(presence_part);
+	const char *subtype = sal_body_handler_get_subtype(presence_part);
+	const char *data = (const char *)sal_body_handler_get_data(presence_part);
+
+	if (!type || !subtype || !data)
+		return;
+	linphone_notify_parse_presence(type, subtype, data, &presence);
+	if (!presence)
+		return;
+
+	// Try to reduce CPU cost of linphone_address_new and find_friend_by_address by only doing it when we know for sure we have a presence to notify
+	addr = linphone_address_new(resource_uri);
+	if (!addr) {
+		linphone_presence_model_unref((LinphonePresenceModel *)presence);
+		return;
+	}
+
+	// Clean the URI
+	if (linphone_address_has_uri_param(addr, "gr")) {
+		linphone_address_remove_uri_param(addr, "gr");
+	}
+	uri = linphone_address_as_string_uri_only(addr);
+	linphone_address_unref(addr);
+
+	bctbx_iterator_t *it = bctbx_map_cchar_find_key(list->friends_map_uri, uri);
+	bctbx_iterator_t *end = bctbx_map_cchar_end(list->friends_map_uri);
+	if (bctbx_iterator_cchar_equals(it, end)) {
+		if (list->bodyless_subscription) {
+			lf = linphone_core_create_friend_with_address(list->lc, uri);
+			linphone_friend_list_add_friend(list, lf);
+			linphone_friend_unref(lf);
+
+			linphone_friend_presence_received(list, lf, uri, (LinphonePresenceModel *)presence);
+			*list_friends_presence_received = bctbx_list_prepend(*list_friends_presence_received, lf);
+		}
+	} else {
+		// Map is sorted, check if next entry matches key otherwise stop
+		while (!bctbx_iterator_cchar_equals(it, end)) {
+			bctbx_pair_t *pair = bctbx_iterator_cchar_get_pair(it);
+			const char *key = bctbx_pair_cchar_get_first(reinterpret_cast<bctbx_pair_cchar_t *>(pair));
+			if (!key || strcmp(uri, key) != 0) break;
+			lf = (LinphoneFriend*) bctbx_pair_cchar_get_second(pair);
+			if (lf) {
+				linphone_friend_presence_received(list, lf, uri, (LinphonePresenceModel *)presence);
+				*list_friends_presence_received = bctbx_list_prepend(*list_friends_presence_received, lf);
+			}
+			it = bctbx_iterator_cchar_get_next(it);
 		}
-		version = atoi(version_str);
-		linphone_free_xml_text_content(version_str);
-		if (version < list->expected_notification_version) { /*no longuer an error as dialog may be silently restarting by the refresher*/
-			ms_warning("rlmi+xml: Received notification with version %d expected was %d, dialog may have been reseted", version, list->expected_notification_version);
+	}
+	bctbx_iterator_cchar_delete(it);
+	bctbx_iterator_cchar_delete(end);
+
+	ms_free(uri);
+	linphone_presence_model_unref((LinphonePresenceModel *)presence);
+}
+
+static SalBodyHandler * find_presence_part(bctbx_map_t *parts_by_cid, const char *cid) {
+	SalBodyHandler *part = NULL;
+	bctbx_iterator_t *it = bctbx_map_cchar_find_key(parts_by_cid, cid);
+	bctbx_iterator_t *end = bctbx_map_cchar_end(parts_by_cid);
+	if (!bctbx_iterator_cchar_equals(it, end))
+		part = (SalBodyHandler *)bctbx_pair_cchar_get_second(bctbx_iterator_cchar_get_pair(it));
+	bctbx_iterator_cchar_delete(it);
+	bctbx_iterator_cchar_delete(end);
+	return part;
+}
+
+/*
+ * Decodes a <rlmi:resource> element and applies it right away, so that partial-state notifications are merged
+ * resource by resource into the friends of the list while the document is being read.
+ */
+static int linphone_friend_list_process_rlmi_resource(LinphoneFriendList *list, xmlTextReaderPtr reader, bctbx_map_t *parts_by_cid, bctbx_list_t **list_friends_presence_received) {
+	int depth = xmlTextReaderDepth(reader);
+	char *uri = linphone_xml_reader_get_attribute(reader, "uri");
+	char *name = NULL;
+	char *cid = NULL;
+	int ret = 0;
+
+	if (!xmlTextReaderIsEmptyElement(reader)) {
+		while ((ret = linphone_xml_reader_next_child_element(reader, depth)) == 1) {
+			if (linphone_xml_reader_is_element(reader, rlmi_ns, "name")) {
+				if (name) linphone_free_xml_text_content(name);
+				name = linphone_xml_reader_get_text_content(reader);
+			} else if (!cid && linphone_xml_reader_is_element(reader, rlmi_ns, "instance")) {
+				char *state = linphone_xml_reader_get_attribute(reader, "state");
+				if (state && (strcmp(state, "active") == 0))
+					cid = linphone_xml_reader_get_attribute(reader, "cid");
+				if (state) linphone_free_xml_text_content(state);
+			}
 		}
+	}
 
-		full_state_str = linphone_get_xml_attribute_text_content(xml_ctx, "/rlmi:list", "fullState");
-		if (!full_state_str) {
-			ms_warning("rlmi+xml: No fullState attribute in list");
-			goto end;
+	if (uri) {
+		if (name)
+			linphone_friend_list_apply_resource_name(list, uri, name);
+		if (cid) {
+			SalBodyHandler *presence_part = find_presence_part(parts_by_cid, cid);
+			if (!presence_part)
+				ms_warning("rlmi+xml: Cannot find part with Content-Id: %s", cid);
+			else
+				linphone_friend_list_apply_resource_presence(list, uri, presence_part, list_friends_presence_received);
 		}
-		if ((strcmp(full_state_str, "true") == 0) || (strcmp(full_state_str, "1") == 0)) {
-			bctbx_list_t *l = list->friends;
-			for (; l != NULL; l = bctbx_list_next(l)) {
-				lf = (LinphoneFriend *)bctbx_list_get_data(l);
-				linphone_friend_clear_presence_models(lf);
-			}
-			full_state = TRUE;
+	}
+
+	if (uri) linphone_free_xml_text_content(uri);
+	if (name) linphone_free_xml_text_content(name);
+	if (cid) linphone_free_xml_text_content(cid);
+	return ret;
+}
+
+/*
+ * The rlmi document is read in a single pass with a libxml2 text reader. Presence parts are indexed by Content-Id
+ * beforehand so that each resource finds its PIDF part in O(log n) instead of walking the whole multipart body.
+ */
+static void linphone_friend_list_parse_multipart_related_body(LinphoneFriendList *list, const belle_sip_list_t *parts, const char *first_part_body) {
+	xmlparsing_context_t *xml_ctx = linphone_xmlparsing_context_new();
+	xmlTextReaderPtr reader = NULL;
+	bctbx_map_t *parts_by_cid = NULL;
+	bctbx_list_t *list_friends_presence_received = NULL;
+	LinphoneFriendListCbs *list_cbs = linphone_friend_list_get_callbacks(list);
+	char *version_str = NULL;
+	char *full_state_str = NULL;
+	bool_t full_state = FALSE;
+	int version;
+	int ret;
+
+	xmlSetGenericErrorFunc(xml_ctx, linphone_xmlparsing_genericxml_error);
+	reader = xmlReaderForMemory(first_part_body, (int)strlen(first_part_body), NULL, NULL, 0);
+	if (!reader) goto error;
+
+	/* Move to the root element. */
+	while (((ret = xmlTextReaderRead(reader)) == 1) && (xmlTextReaderNodeType(reader) != XML_READER_TYPE_ELEMENT));
+	if (ret != 1) goto error;
+	if (!linphone_xml_reader_is_element(reader, rlmi_ns, "list")) {
+		ms_warning("rlmi+xml: Root element is not a list");
+		goto end;
+	}
+
+	version_str = linphone_xml_reader_get_attribute(reader, "version");
+	if (!version_str) {
+		ms_warning("rlmi+xml: No version attribute in list");
+		goto end;
+	}
+	version = atoi(version_str);
+	linphone_free_xml_text_content(version_str);
+	if (version < list->expected_notification_version) { /*no longuer an error as dialog may be silently restarting by the refresher*/
+		ms_warning("rlmi+xml: Received notification with version %d expected was %d, dialog may have been reseted", version, list->expected_notification_version);
+	}
+
+	full_state_str = linphone_xml_reader_get_attribute(reader, "fullState");
+	if (!full_state_str) {
+		ms_warning("rlmi+xml: No fullState attribute in list");
+		goto end;
+	}
+	if ((strcmp(full_state_str, "true") == 0) || (strcmp(full_state_str, "1") == 0)) {
+		bctbx_list_t *l = list->friends;
+		for (; l != NULL; l = bctbx_list_next(l)) {
+			LinphoneFriend *lf = (LinphoneFriend *)bctbx_list_get_data(l);
+			linphone_friend_clear_presence_models(lf);
 		}
-		linphone_free_xml_text_content(full_state_str);
-		if ((list->expected_notification_version == 0) && !full_state) {
-			ms_warning("rlmi+xml: Notification with version 0 is not full state, this is not valid");
-			goto end;
+		full_state = TRUE;
+	}
+	linphone_free_xml_text_content(full_state_str);
+	if ((list->expected_notification_version == 0) && !full_state) {
+		ms_warning("rlmi+xml: Notification with version 0 is not full state, this is not valid");
+		goto end;
+	}
+	list->expected_notification_version = version + 1;
+
+	parts_by_cid = bctbx_mmap_cchar_new();
+	for (; parts != NULL; parts = parts->next) {
+		SalBodyHandler *part = (SalBodyHandler *)parts->data;
+		const char *cid = sal_body_handler_get_header(part, "Content-Id");
+		if (cid) {
+			bctbx_pair_t *pair = (bctbx_pair_t *)bctbx_pair_cchar_new(cid, part);
+			bctbx_map_cchar_insert_and_delete(parts_by_cid, pair);
 		}
-		list->expected_notification_version = version + 1;
-
-		name_object = linphone_get_xml_xpath_object_for_node_list(xml_ctx, "/rlmi:list/rlmi:resource/rlmi:name/..");
-		if (name_object && name_object->nodesetval) {
-			for (i = 1; i <= name_object->nodesetval->nodeNr; i++) {
-				char *name = NULL;
-				LinphoneAddress* addr;
-				linphone_xml_xpath_context_set_node(xml_ctx, xmlXPathNodeSetItem(name_object->nodesetval, i-1));
-				name = linphone_get_xml_text_content(xml_ctx, "./rlmi:name");
-				uri = linphone_get_xml_text_content(xml_ctx, "./@uri");
-				if (!uri)
-					continue;
-				addr = linphone_address_new(uri);
-				if (!addr)
-					continue;
-				lf = linphone_friend_list_find_friend_by_address(list, addr);
-				linphone_address_unref(addr);
-				if (!lf && list->bodyless_subscription) {
-					lf = linphone_core_create_friend_with_address(list->lc, uri);
-					linphone_friend_list_add_friend(list, lf);
-					linphone_friend_unref(lf);
-				}
-				if (name) {
-					linphone_friend_set_name(lf, name);
-					linphone_free_xml_text_content(name);
-				}
+	}
+
+	ret = 0;
+	if (!xmlTextReaderIsEmptyElement(reader)) {
+		while ((ret = linphone_xml_reader_next_child_element(reader, 0)) == 1) {
+			if (linphone_xml_reader_is_element(reader, rlmi_ns, "resource")) {
+				ret = linphone_friend_list_process_rlmi_resource(list, reader, parts_by_cid, &list_friends_presence_received);
+				if (ret < 0) break;
 			}
 		}
-		if (name_object)
-			xmlXPathFreeObject(name_object);
-
-		resource_object = linphone_get_xml_xpath_object_for_node_list(xml_ctx, "/rlmi:list/rlmi:resource/rlmi:instance[@state=\"active\"]/..");
-		if (resource_object && resource_object->nodesetval) {
-			for (i = 1; i <= resource_object->nodesetval->nodeNr; i++) {
-				char *cid = NULL;
-				linphone_xml_xpath_context_set_node(xml_ctx, xmlXPathNodeSetItem(resource_object->nodesetval, i-1));
-				cid = linphone_get_xml_text_content(xml_ctx, "./rlmi:instance/@cid");
-				if (cid) {
-					presence_part = linphone_content_find_part_by_header(body, "Content-Id", cid);
-					if (!presence_part) {
-						ms_warning("rlmi+xml: Cannot find part with Content-Id: %s", cid);
-					} else {
-						SalPresenceModel *presence = NULL;
-						linphone_notify_parse_presence(linphone_content_get_type(presence_part), linphone_content_get_subtype(presence_part), linphone_content_get_string_buffer(presence_part), &presence);
-						if (presence) {
-							// Try to reduce CPU cost of linphone_address_new and find_friend_by_address by only doing it when we know for sure we have a presence to notify
-							LinphoneAddress* addr;
-							uri = linphone_get_xml_text_content(xml_ctx, "./@uri");
-							if (!uri)
-								continue;
-							addr = linphone_address_new(uri);
-							if (!addr)
-								continue;
-							linphone_free_xml_text_content(uri);
-							
-							// Clean the URI
-							if (linphone_address_has_uri_param(addr, "gr")) {
-								linphone_address_remove_uri_param(addr, "gr");
-							}
-							uri = linphone_address_as_string_uri_only(addr);
-							linphone_address_unref(addr);
-
-							bctbx_iterator_t *it = bctbx_map_cchar_find_key(list->friends_map_uri, uri);
-							bctbx_iterator_t *end = bctbx_map_cchar_end(list->friends_map_uri);
-							if (bctbx_iterator_cchar_equals(it, end)) {
-								if (list->bodyless_subscription) {
-									lf = linphone_core_create_friend_with_address(list->lc, uri);
-									linphone_friend_list_add_friend(list, lf);
-									linphone_friend_unref(lf);
-
-									linphone_friend_presence_received(list, lf, uri, (LinphonePresenceModel *)presence);
-									list_friends_presence_received = bctbx_list_prepend(list_friends_presence_received, lf);
-								}
-							} else {
-								// Map is sorted, check if next entry matches key otherwise stop
-								while (!bctbx_iterator_cchar_equals(it, end)) {
-									bctbx_pair_t *pair = bctbx_iterator_cchar_get_pair(it);
-									const char *key = bctbx_pair_cchar_get_first(reinterpret_cast<bctbx_pair_cchar_t *>(pair));
-									if (!key || strcmp(uri, key) != 0) break;
-									lf = (LinphoneFriend*) bctbx_pair_cchar_get_second(pair);
-									if (lf) {
-										linphone_friend_presence_received(list, lf, uri, (LinphonePresenceModel *)presence);
-										list_friends_presence_received = bctbx_list_prepend(list_friends_presence_received, lf);
-									}
-									it = bctbx_iterator_cchar_get_next(it);
-								}
-							}
-							bctbx_iterator_cchar_delete(it);
-							bctbx_iterator_cchar_delete(end);
-							
-							linphone_content_unref(presence_part);
-							linphone_presence_model_unref((LinphonePresenceModel *)presence);
-						}
-					}
-					linphone_free_xml_text_content(cid);
-				}
-			}
-			// Notify list with all friends for which we received presence information
-			if (bctbx_list_size(list_friends_presence_received) > 0) {
-				if (list_cbs && linphone_friend_list_cbs_get_presence_received(list_cbs)) {
-					linphone_friend_list_cbs_get_presence_received(list_cbs)(list, list_friends_presence_received);
-				}
+	}
+	if (ret < 0)
+		ms_warning("Wrongly formatted rlmi+xml body, resources after the error are ignored: %s", xml_ctx->errorBuffer);
 
-				NOTIFY_IF_EXIST(PresenceReceived, presence_received, list, list_friends_presence_received)
-			}
-			bctbx_list_free(list_friends_presence_received);
+	// Notify list with all friends for which we received presence information
+	if (bctbx_list_size(list_friends_presence_received) > 0) {
+		if (list_cbs && linphone_friend_list_cbs_get_presence_received(list_cbs)) {
+			linphone_friend_list_cbs_get_presence_received(list_cbs)(list, list_friends_presence_received);
 		}
-		if (resource_object)
-			xmlXPathFreeObject(resource_object);
-	} else {
-		ms_warning("Wrongly formatted rlmi+xml body: %s", xml_ctx->errorBuffer);
+
+		NOTIFY_IF_EXIST(PresenceReceived, presence_received, list, list_friends_presence_received)
 	}
+	bctbx_list_free(list_friends_presence_received);
+	goto end;
 
+error:
+	ms_warning("Wrongly formatted rlmi+xml body: %s", xml_ctx->errorBuffer);
 end:
+	if (parts_by_cid) bctbx_mmap_cchar_delete(parts_by_cid);
+	if (reader) xmlFreeTextReader(reader);
 	linphone_xmlparsing_context_destroy(xml_ctx);
 }
 
@@ -659,6 +725,7 @@ LinphoneFriendListStatus linphone_friend_list_import_friend(LinphoneFriendList *
 	
 	lf->friend_list = list;
 	lf->lc = list->lc;
+	linphone_friend_index_presence_models(lf);
 	list->friends = bctbx_list_prepend(list->friends, linphone_friend_ref(lf));
 	linphone_friend_add_addresses_and_numbers_into_maps(lf, list);
 
@@ -1116,7 +1183,9 @@ void linphone_friend_list_notify_presence_received(LinphoneFriendList *list, Lin
 	if (!linphone_content_is_multipart(body))
 		return;
 
-	LinphoneContent *first_part;
+	SalBodyHandler *body_handler;
+	SalBodyHandler *first_part;
+	const belle_sip_list_t *parts;
 	const char *type = linphone_content_get_type(body);
 	const char *subtype = linphone_content_get_subtype(body);
 
@@ -1125,22 +1194,26 @@ void linphone_friend_list_notify_presence_received(LinphoneFriendList *list, Lin
 		return;
 	}
 
-	first_part = linphone_content_get_part(body, 0);
-	if (first_part == NULL) {
+	/* The multipart body is split into parts only once, parts are then accessed in place. */
+	body_handler = sal_body_handler_from_content(body);
+	parts = sal_body_handler_get_parts(body_handler);
+	if (parts == NULL) {
 		ms_warning("'multipart/related' presence notified but it doesn't contain any part");
+		sal_body_handler_unref(body_handler);
 		return;
 	}
 
-	type = linphone_content_get_type(first_part);
-	subtype = linphone_content_get_subtype(first_part);
-	if ((strcmp(type, "application") != 0) || (strcmp(subtype, "rlmi+xml") != 0)) {
+	first_part = (SalBodyHandler *)parts->data;
+	type = sal_body_handler_get_type(first_part);
+	subtype = sal_body_handler_get_subtype(first_part);
+	if (!type || !subtype || (strcmp(type, "application") != 0) || (strcmp(subtype, "rlmi+xml") != 0) || !sal_body_handler_get_data(first_part)) {
 		ms_warning("multipart presence notified but first part is not 'application/rlmi+xml'");
-		linphone_content_unref(first_part);
+		sal_body_handler_unref(body_handler);
 		return;
 	}
 
-	linphone_friend_list_parse_multipart_related_body(list, body, linphone_content_get_string_buffer(first_part));
-	linphone_content_unref(first_part);
+	linphone_friend_list_parse_multipart_related_body(list, parts->next, (const char *)sal_body_handler_get_data(first_part));
+	sal_body_handler_unref(body_handler);
 }
 
 const char * linphone_friend_list_get_uri(const LinphoneFriendList *list) {
@@ -89,7 +89,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 #include "c-wrapper/c-wrapper.h"
 #include "call/call-p.h"
+#include "call/call-stats-snapshot-table.h"
 #include "conference/params/media-session-params-p.h"
+#include "logger/metrics.h"
 
 #ifdef HAVE_ZLIB
 #define COMPRESSED_LOG_COLLECTION_EXTENSION "gz"
@@ -194,6 +196,7 @@ void _linphone_core_cbs_set_v_table(LinphoneCoreCbs *cbs, LinphoneCoreVTable *vt
 	ms_free(cbs->vtable);
 	cbs->vtable = vtable;
 	cbs->autorelease = autorelease;
+	_linphone_core_cbs_changed();
 }
 
 LinphoneCoreCbs *linphone_core_cbs_ref(LinphoneCoreCbs *cbs) {
@@ -222,6 +225,7 @@ LinphoneCoreCbsGlobalStateChangedCb linphone_core_cbs_get_global_state_changed(L
 
 void linphone_core_cbs_set_global_state_changed(LinphoneCoreCbs *cbs, LinphoneCoreCbsGlobalStateChangedCb cb) {
 	cbs->vtable->global_state_changed = cb;
+	_linphone_core_cbs_changed();
 }
 
 LinphoneCoreCbsRegistrationStateChangedCb linphone_core_cbs_get_registration_state_changed(LinphoneCoreCbs *cbs) {
@@ -230,6 +234,7 @@ LinphoneCoreCbsRegistrationStateChangedCb linphone_core_cbs_get_registration_sta
 
 void linphone_core_cbs_set_registration_state_changed(LinphoneCoreCbs *cbs, LinphoneCoreCbsRegistrationStateChangedCb cb) {
 	cbs->vtable->registration_state_changed = cb;
+	_linphone_core_cbs_changed();
 }
 
 LinphoneCoreCbsCallStateChangedCb linphone_core_cbs_get_call_state_changed(LinphoneCoreCbs *cbs) {
@@ -238,6 +243,7 @@ LinphoneCoreCbsCallStateChangedCb linphone_core_cbs_get_call_state_changed(Linph
 
 void linphone_core_cbs_set_call_state_changed(LinphoneCoreCbs *cbs, LinphoneCoreCbsCallStateChangedCb cb) {
 	cbs->vtable->call_state_changed = cb;
+	_linphone_core_cbs_changed();
 }
 
 LinphoneCoreCbsNotifyPresenceReceivedCb linphone_core_cbs_get_notify_presence_received(LinphoneCoreCbs *cbs) {
@@ -246,6 +252,7 @@ LinphoneCoreCbsNotifyPresenceReceivedCb linphone_core_cbs_get_notify_presence_re
 
 void linphone_core_cbs_set_notify_presence_received(LinphoneCoreCbs *cbs, LinphoneCoreCbsNotifyPresenceReceivedCb cb) {
 	cbs->vtable->notify_presence_received = cb;
+	_linphone_core_cbs_changed();
 }
 
 LinphoneCoreCbsNotifyPresenceReceivedForUriOrTelCb linphone_core_cbs_get_notify_presence_received_for_uri_or_tel(LinphoneCoreCbs *cbs) {
@@ -254,6 +261,7 @@ LinphoneCoreCbsNotifyPresenceReceivedForUriOrTelCb linphone_core_cbs_get_notify_
 
 void linphone_core_cbs_set_notify_presence_received_for_uri_or_tel(LinphoneCoreCbs *cbs, LinphoneCoreCbsNotifyPresenceReceivedForUriOrTelCb cb) {
 	cbs->vtable->notify_presence_received_for_uri_or_tel = cb;
+	_linphone_core_cbs_changed();
 }
 
 LinphoneCoreCbsNewSubscriptionRequestedCb linphone_core_cbs_get_new_subscription_requested(LinphoneCoreCbs *cbs) {
@@ -262,6 +270,7 @@ LinphoneCoreCbsNewSubscriptionRequestedCb linphone_core_cbs_get_new_subscription
 
 void linphone_core_cbs_set_new_subscription_requested(LinphoneCoreCbs *cbs, LinphoneCoreCbsNewSubscriptionRequestedCb cb) {
 	cbs->vtable->new_subscription_requested = cb;
+	_linphone_core_cbs_changed();
 }
 
 LinphoneCoreCbsAuthenticationRequestedCb linphone_core_cbs_get_authentication_requested(LinphoneCoreCbs *cbs) {
@@ -270,6 +279,7 @@ LinphoneCoreCbsAuthenticationRequestedCb linphone_core_cbs_get_authentication_re
 
 void linphone_core_cbs_set_authentication_requested(LinphoneCoreCbs *cbs, LinphoneCoreCbsAuthenticationRequestedCb cb) {
 	cbs->vtable->authentication_requested = cb;
+	_linphone_core_cbs_changed();
 }
 
 LinphoneCoreCbsCallLogUpdatedCb linphone_core_cbs_get_call_log_updated(LinphoneCoreCbs *cbs) {
@@ -278,6 +288,7 @@ LinphoneCoreCbsCallLogUpdatedCb linphone_core_cbs_get_call_log_updated(LinphoneC
 
 void linphone_core_cbs_set_call_log_updated(LinphoneCoreCbs *cbs, LinphoneCoreCbsCallLogUpdatedCb cb) {
 	cbs->vtable->call_log_updated = cb;
+	_linphone_core_cbs_changed();
 }
 
 LinphoneCoreCbsChatRoomReadCb linphone_core_cbs_get_chat_room_read(LinphoneCoreCbs *cbs) {
@@ -286,6 +297,7 @@ LinphoneCoreCbsChatRoomReadCb linphone_core_cbs_get_chat_room_read(LinphoneCoreC
 
 void linphone_core_cbs_set_chat_room_read(LinphoneCoreCbs *cbs, LinphoneCoreCbsChatRoomReadCb cb) {
 	cbs->vtable->chat_room_read = cb;
+	_linphone_core_cbs_changed();
 }
 
 LinphoneCoreCbsMessageReceivedCb linphone_core_cbs_get_message_sent(LinphoneCoreCbs *cbs) {
@@ -294,6 +306,7 @@ LinphoneCoreCbsMessageReceivedCb linphone_core_cbs_get_message_sent(LinphoneCore
 
 void linphone_core_cbs_set_message_sent(LinphoneCoreCbs *cbs, LinphoneCoreCbsMessageReceivedCb cb) {
 	cbs->vtable->message_sent = cb;
+	_linphone_core_cbs_changed();
 }
 
 LinphoneCoreCbsMessageReceivedCb linphone_core_cbs_get_message_received(LinphoneCoreCbs *cbs) {
@@ -302,6 +315,7 @@ LinphoneCoreCbsMessageReceivedCb linphone_core_cbs_get_message_received(Linphone
 
 void linphone_core_cbs_set_message_received(LinphoneCoreCbs *cbs, LinphoneCoreCbsMessageReceivedCb cb) {
 	cbs->vtable->message_received = cb;
+	_linphone_core_cbs_changed();
 }
 
 LinphoneCoreCbsMessageReceivedUnableDecryptCb linphone_core_cbs_get_message_received_unable_decrypt(LinphoneCoreCbs *cbs) {
@@ -310,6 +324,7 @@ LinphoneCoreCbsMessageReceivedUnableDecryptCb linphone_core_cbs_get_message_rece
 
 void linphone_core_cbs_set_message_received_unable_decrypt(LinphoneCoreCbs *cbs, LinphoneCoreCbsMessageReceivedUnableDecryptCb cb) {
 	cbs->vtable->message_received_unable_decrypt = cb;
+	_linphone_core_cbs_changed();
 }
 
 LinphoneCoreCbsIsComposingReceivedCb linphone_core_cbs_get_is_composing_received(LinphoneCoreCbs *cbs) {
@@ -318,6 +333,7 @@ LinphoneCoreCbsIsComposingReceivedCb linphone_core_cbs_get_is_composing_received
 
 void linphone_core_cbs_set_is_composing_received(LinphoneCoreCbs *cbs, LinphoneCoreCbsIsComposingReceivedCb cb) {
 	cbs->vtable->is_composing_received = cb;
+	_linphone_core_cbs_changed();
 }
 
 LinphoneCoreCbsDtmfReceivedCb linphone_core_cbs_get_dtmf_received(LinphoneCoreCbs *cbs) {
@@ -326,6 +342,7 @@ LinphoneCoreCbsDtmfReceivedCb linphone_core_cbs_get_dtmf_received(LinphoneCoreCb
 
 void linphone_core_cbs_set_dtmf_received(LinphoneCoreCbs *cbs, LinphoneCoreCbsDtmfReceivedCb cb) {
 	cbs->vtable->dtmf_received = cb;
+	_linphone_core_cbs_changed();
 }
 
 LinphoneCoreCbsReferReceivedCb linphone_core_cbs_get_refer_received(LinphoneCoreCbs *cbs) {
@@ -334,6 +351,7 @@ LinphoneCoreCbsReferReceivedCb linphone_core_cbs_get_refer_received(LinphoneCore
 
 void linphone_core_cbs_set_refer_received(LinphoneCoreCbs *cbs, LinphoneCoreCbsReferReceivedCb cb) {
 	cbs->vtable->refer_received = cb;
+	_linphone_core_cbs_changed();
 }
 
 LinphoneCoreCbsCallEncryptionChangedCb linphone_core_cbs_get_call_encryption_changed(LinphoneCoreCbs *cbs) {
@@ -342,6 +360,7 @@ LinphoneCoreCbsCallEncryptionChangedCb linphone_core_cbs_get_call_encryption_cha
 
 void linphone_core_cbs_set_call_encryption_changed(LinphoneCoreCbs *cbs, LinphoneCoreCbsCallEncryptionChangedCb cb) {
 	cbs->vtable->call_encryption_changed = cb;
+	_linphone_core_cbs_changed();
 }
 
 LinphoneCoreCbsTransferStateChangedCb linphone_core_cbs_get_transfer_state_changed(LinphoneCoreCbs *cbs) {
@@ -350,6 +369,7 @@ LinphoneCoreCbsTransferStateChangedCb linphone_core_cbs_get_transfer_state_chang
 
 void linphone_core_cbs_set_transfer_state_changed(LinphoneCoreCbs *cbs, LinphoneCoreCbsTransferStateChangedCb cb) {
 	cbs->vtable->transfer_state_changed = cb;
+	_linphone_core_cbs_changed();
 }
 
 LinphoneCoreCbsBuddyInfoUpdatedCb linphone_core_cbs_get_buddy_info_updated(LinphoneCoreCbs *cbs) {
@@ -358,6 +378,7 @@ LinphoneCoreCbsBuddyInfoUpdatedCb linphone_core_cbs_get_buddy_info_updated(Linph
 
 void linphone_core_cbs_set_buddy_info_updated(LinphoneCoreCbs *cbs, LinphoneCoreCbsBuddyInfoUpdatedCb cb) {
 	cbs->vtable->buddy_info_updated = cb;
+	_linphone_core_cbs_changed();
 }
 
 LinphoneCoreCbsCallStatsUpdatedCb linphone_core_cbs_get_call_stats_updated(LinphoneCoreCbs *cbs) {
@@ -366,6 +387,7 @@ LinphoneCoreCbsCallStatsUpdatedCb linphone_core_cbs_get_call_stats_updated(Linph
 
 void linphone_core_cbs_set_call_stats_updated(LinphoneCoreCbs *cbs, LinphoneCoreCbsCallStatsUpdatedCb cb) {
 	cbs->vtable->call_stats_updated = cb;
+	_linphone_core_cbs_changed();
 }
 
 LinphoneCoreCbsInfoReceivedCb linphone_core_cbs_get_info_received(LinphoneCoreCbs *cbs) {
@@ -374,6 +396,7 @@ LinphoneCoreCbsInfoReceivedCb linphone_core_cbs_get_info_received(LinphoneCoreCb
 
 void linphone_core_cbs_set_info_received(LinphoneCoreCbs *cbs, LinphoneCoreCbsInfoReceivedCb cb) {
 	cbs->vtable->info_received = cb;
+	_linphone_core_cbs_changed();
 }
 
 LinphoneCoreCbsSubscriptionStateChangedCb linphone_core_cbs_get_subscription_state_changed(LinphoneCoreCbs *cbs) {
@@ -382,6 +405,7 @@ LinphoneCoreCbsSubscriptionStateChangedCb linphone_core_cbs_get_subscription_sta
 
 void linphone_core_cbs_set_subscription_state_changed(LinphoneCoreCbs *cbs, LinphoneCoreCbsSubscriptionStateChangedCb cb) {
 	cbs->vtable->subscription_state_changed = cb;
+	_linphone_core_cbs_changed();
 }
 
 LinphoneCoreCbsNotifyReceivedCb linphone_core_cbs_get_notify_received(LinphoneCoreCbs *cbs) {
@@ -390,6 +414,7 @@ LinphoneCoreCbsNotifyReceivedCb linphone_core_cbs_get_notify_received(LinphoneCo
 
 void linphone_core_cbs_set_notify_received(LinphoneCoreCbs *cbs, LinphoneCoreCbsNotifyReceivedCb cb) {
 	cbs->vtable->notify_received = cb;
+	_linphone_core_cbs_changed();
 }
 
 LinphoneCoreCbsSubscribeReceivedCb linphone_core_cbs_get_subscribe_received(LinphoneCoreCbs *cbs) {
@@ -398,6 +423,7 @@ LinphoneCoreCbsSubscribeReceivedCb linphone_core_cbs_get_subscribe_received(Linp
 
 void linphone_core_cbs_set_subscribe_received(LinphoneCoreCbs *cbs, LinphoneCoreCbsSubscribeReceivedCb cb) {
 	cbs->vtable->subscribe_received = cb;
+	_linphone_core_cbs_changed();
 }
 
 LinphoneCoreCbsPublishStateChangedCb linphone_core_cbs_get_rpublish_state_changed(LinphoneCoreCbs *cbs) {
@@ -406,6 +432,7 @@ LinphoneCoreCbsPublishStateChangedCb linphone_core_cbs_get_rpublish_state_change
 
 void linphone_core_cbs_set_publish_state_changed(LinphoneCoreCbs *cbs, LinphoneCoreCbsPublishStateChangedCb cb) {
 	cbs->vtable->publish_state_changed = cb;
+	_linphone_core_cbs_changed();
 }
 
 LinphoneCoreCbsConfiguringStatusCb linphone_core_cbs_get_configuring_status(LinphoneCoreCbs *cbs) {
@@ -414,6 +441,7 @@ LinphoneCoreCbsConfiguringStatusCb linphone_core_cbs_get_configuring_status(Linp
 
 void linphone_core_cbs_set_configuring_status(LinphoneCoreCbs *cbs, LinphoneCoreCbsConfiguringStatusCb cb) {
 	cbs->vtable->configuring_status = cb;
+	_linphone_core_cbs_changed();
 }
 
 LinphoneCoreCbsNetworkReachableCb linphone_core_cbs_get_network_reachable(LinphoneCoreCbs *cbs) {
@@ -422,6 +450,7 @@ LinphoneCoreCbsNetworkReachableCb linphone_core_cbs_get_network_reachable(Linpho
 
 void linphone_core_cbs_set_network_reachable(LinphoneCoreCbs *cbs, LinphoneCoreCbsNetworkReachableCb cb) {
 	cbs->vtable->network_reachable = cb;
+	_linphone_core_cbs_changed();
 }
 
 LinphoneCoreCbsLogCollectionUploadStateChangedCb linphone_core_cbs_log_collection_upload_state_changed(LinphoneCoreCbs *cbs) {
@@ -430,6 +459,7 @@ LinphoneCoreCbsLogCollectionUploadStateChangedCb linphone_core_cbs_log_collectio
 
 void linphone_core_cbs_set_log_collection_upload_state_changed(LinphoneCoreCbs *cbs, LinphoneCoreCbsLogCollectionUploadStateChangedCb cb) {
 	cbs->vtable->log_collection_upload_state_changed = cb;
+	_linphone_core_cbs_changed();
 }
 
 LinphoneCoreCbsLogCollectionUploadProgressIndicationCb linphone_core_cbs_get_rlog_collection_upload_progress_indication(LinphoneCoreCbs *cbs) {
@@ -438,6 +468,7 @@ LinphoneCoreCbsLogCollectionUploadProgressIndicationCb linphone_core_cbs_get_rlo
 
 void linphone_core_cbs_set_log_collection_upload_progress_indication(LinphoneCoreCbs *cbs, LinphoneCoreCbsLogCollectionUploadProgressIndicationCb cb) {
 	cbs->vtable->log_collection_upload_progress_indication = cb;
+	_linphone_core_cbs_changed();
 }
 
 LinphoneCoreCbsFriendListCreatedCb linphone_core_cbs_get_friend_list_created(LinphoneCoreCbs *cbs) {
@@ -446,6 +477,7 @@ LinphoneCoreCbsFriendListCreatedCb linphone_core_cbs_get_friend_list_created(Lin
 
 void linphone_core_cbs_set_friend_list_created(LinphoneCoreCbs *cbs, LinphoneCoreCbsFriendListCreatedCb cb) {
 	cbs->vtable->friend_list_created = cb;
+	_linphone_core_cbs_changed();
 }
 
 LinphoneCoreCbsFriendListRemovedCb linphone_core_cbs_get_friend_list_removed(LinphoneCoreCbs *cbs) {
@@ -454,6 +486,7 @@ LinphoneCoreCbsFriendListRemovedCb linphone_core_cbs_get_friend_list_removed(Lin
 
 void linphone_core_cbs_set_friend_list_removed(LinphoneCoreCbs *cbs, LinphoneCoreCbsFriendListRemovedCb cb) {
 	cbs->vtable->friend_list_removed = cb;
+	_linphone_core_cbs_changed();
 }
 
 LinphoneCoreCbsCallCreatedCb linphone_core_cbs_get_call_created(LinphoneCoreCbs *cbs) {
@@ -462,6 +495,7 @@ LinphoneCoreCbsCallCreatedCb linphone_core_cbs_get_call_created(LinphoneCoreCbs
 
 void linphone_core_cbs_set_call_created(LinphoneCoreCbs *cbs, LinphoneCoreCbsCallCreatedCb cb) {
 	cbs->vtable->call_created = cb;
+	_linphone_core_cbs_changed();
 }
 
 LinphoneCoreCbsVersionUpdateCheckResultReceivedCb linphone_core_cbs_get_version_update_check_result_received(LinphoneCoreCbs *cbs) {
@@ -470,6 +504,7 @@ LinphoneCoreCbsVersionUpdateCheckResultReceivedCb linphone_core_cbs_get_version_
 
 void linphone_core_cbs_set_version_update_check_result_received(LinphoneCoreCbs *cbs, LinphoneCoreCbsVersionUpdateCheckResultReceivedCb cb) {
 	cbs->vtable->version_update_check_result_received = cb;
+	_linphone_core_cbs_changed();
 }
 
 LinphoneCoreCbsChatRoomStateChangedCb linphone_core_cbs_get_chat_room_state_changed (LinphoneCoreCbs *cbs) {
@@ -478,6 +513,7 @@ LinphoneCoreCbsChatRoomStateChangedCb linphone_core_cbs_get_chat_room_state_chan
 
 void linphone_core_cbs_set_chat_room_state_changed (LinphoneCoreCbs *cbs, LinphoneCoreCbsChatRoomStateChangedCb cb) {
 	cbs->vtable->chat_room_state_changed = cb;
+	_linphone_core_cbs_changed();
 }
 
 LinphoneCoreCbsQrcodeFoundCb linphone_core_cbs_get_qrcode_found(LinphoneCoreCbs *cbs) {
@@ -486,18 +522,22 @@ LinphoneCoreCbsQrcodeFoundCb linphone_core_cbs_get_qrcode_found(LinphoneCoreCbs
 
 void linphone_core_cbs_set_qrcode_found(LinphoneCoreCbs *cbs, LinphoneCoreCbsQrcodeFoundCb cb) {
 	cbs->vtable->qrcode_found = cb;
+	_linphone_core_cbs_changed();
 }
 
 void linphone_core_cbs_set_ec_calibration_result(LinphoneCoreCbs *cbs, LinphoneCoreCbsEcCalibrationResultCb cb) {
 	cbs->vtable->ec_calibration_result = cb;
+	_linphone_core_cbs_changed();
 }
 
 void linphone_core_cbs_set_ec_calibration_audio_init(LinphoneCoreCbs *cbs, LinphoneCoreCbsEcCalibrationAudioInitCb cb) {
 	cbs->vtable->ec_calibration_audio_init = cb;
+	_linphone_core_cbs_changed();
 }
 
 void linphone_core_cbs_set_ec_calibration_audio_uninit(LinphoneCoreCbs *cbs, LinphoneCoreCbsEcCalibrationAudioUninitCb cb) {
 	cbs->vtable->ec_calibration_audio_uninit = cb;
+	_linphone_core_cbs_changed();
 }
 
 
@@ -2062,6 +2102,7 @@ static void misc_config_read (LinphoneCore *lc) {
 	LpConfig *config = lc->config;
 
 	lc->max_call_logs = lp_config_get_int(config,"misc","history_max_size",LINPHONE_MAX_CALL_HISTORY_SIZE);
+	lc->call_logs_window_size = lp_config_get_int(config,"misc","history_window_size",LINPHONE_CALL_HISTORY_WINDOW_SIZE);
 	lc->max_calls = lp_config_get_int(config,"misc","max_calls",NB_MAX_CALLS);
 
 	if (lc->user_certificates_path) bctbx_free(lc->user_certificates_path);
@@ -2363,6 +2404,8 @@ static void linphone_core_init(LinphoneCore * lc, LinphoneCoreCbs *cbs, LpConfig
 
 	lc->is_unreffing = FALSE;
 	lc->config=lp_config_ref(config);
+	if (lp_config_get_int(lc->config, "misc", "config_write_behind", 0))
+		lp_config_enable_write_behind(lc->config, TRUE);
 	lc->data=userdata;
 	lc->ringstream_autorelease=TRUE;
 
@@ -3441,6 +3484,7 @@ static void linphone_core_do_plugin_tasks(LinphoneCore *lc){
 }
 
 void linphone_core_iterate(LinphoneCore *lc){
+	L_METRIC_TIME_SCOPE("core.iterate");
 	uint64_t curtime_ms = ms_get_cur_time_ms(); /*monotonic time*/
 	time_t current_real_time = ms_time(NULL);
 	int64_t diff_time;
@@ -3500,6 +3544,8 @@ void linphone_core_iterate(LinphoneCore *lc){
 
 	lc->sal->iterate();
 	if (lc->msevq) ms_event_queue_pump(lc->msevq);
+	/* Completions of the chat messages encoded by the worker threads of the send pipeline. */
+	L_GET_PRIVATE_FROM_C_OBJECT(lc)->iterateChatMessageSendPipeline();
 	if (linphone_core_get_global_state(lc) == LinphoneGlobalConfiguring)
 		// Avoid registration before getting remote configuration results
 		return;
@@ -3539,6 +3585,7 @@ void linphone_core_iterate(LinphoneCore *lc){
 				linphone_friend_list_update_dirty_friends(list);
 			}
 		}
+		L_METRIC_GAUGE_SET("core.calls", linphone_core_get_calls_nb(lc));
 	}
 
 	if (liblinphone_serialize_logs == TRUE) {
@@ -3964,6 +4011,12 @@ LinphoneStatus linphone_core_decline_call(LinphoneCore *lc, LinphoneCall *call,
 	return linphone_call_decline(call, reason);
 }
 
+int linphone_core_get_call_stats_snapshots(const LinphoneCore *lc, LinphoneCallStatsSnapshot *snapshots, int max_count) {
+	const shared_ptr<LinphonePrivate::CallStatsSnapshotTable> &table = L_GET_PRIVATE_FROM_C_OBJECT(lc)->callStatsSnapshots;
+	if (!table || max_count <= 0) return 0;
+	return (int)table->readAll(snapshots, (size_t)max_count);
+}
+
 const bctbx_list_t *linphone_core_get_calls(LinphoneCore *lc) {
 	if (lc->callsCache) {
 		bctbx_list_free_with_data(lc->callsCache, (bctbx_list_free_func)linphone_call_unref);
@@ -4977,6 +5030,7 @@ void linphone_core_migrate_logs_from_rc_to_db(LinphoneCore *lc) {
 	bctbx_list_t *logs_to_migrate = NULL;
 	LpConfig *lpc = NULL;
 	size_t original_logs_count, migrated_logs_count;
+	int previous_logs_count;
 	int i;
 
 	if (!lc) {
@@ -5004,16 +5058,20 @@ void linphone_core_migrate_logs_from_rc_to_db(LinphoneCore *lc) {
 	lc->call_logs = NULL;
 
 	// We can't use bctbx_list_for_each because logs_to_migrate are listed in the wrong order (latest first), and we want to store the logs latest last
+	previous_logs_count = linphone_core_get_call_history_size(lc);
+	if (lc->logs_db) sqlite3_exec(lc->logs_db, "BEGIN", NULL, NULL, NULL);
 	for (i = (int)bctbx_list_size(logs_to_migrate) - 1; i >= 0; i--) {
 		LinphoneCallLog *log = (LinphoneCallLog *) bctbx_list_nth_data(logs_to_migrate, i);
 		linphone_core_store_call_log(lc, log);
 	}
+	if (lc->logs_db) sqlite3_exec(lc->logs_db, "COMMIT", NULL, NULL, NULL);
 
 	original_logs_count = bctbx_list_size(logs_to_migrate);
-	migrated_logs_count = bctbx_list_size(lc->call_logs);
+	// lc->call_logs only keeps the most recent ones when a database is used, count what was actually stored
+	migrated_logs_count = lc->logs_db ? (size_t)(linphone_core_get_call_history_size(lc) - previous_logs_count) : bctbx_list_size(lc->call_logs);
 	if (original_logs_count == migrated_logs_count) {
 		size_t i = 0;
-		ms_debug("call logs migration successful: %u logs migrated", (unsigned int)bctbx_list_size(lc->call_logs));
+		ms_debug("call logs migration successful: %u logs migrated", (unsigned int)migrated_logs_count);
 		lp_config_set_int(lpc, "misc", "call_logs_migration_done", 1);
 
 		for (; i < original_logs_count; i++) {
@@ -6363,6 +6421,8 @@ static void _linphone_core_stop(LinphoneCore *lc) {
 
 	L_GET_PRIVATE_FROM_C_OBJECT(lc)->uninit();
 
+	linphone_reporting_collector_destroy(lc);
+
 	for (elem = lc->friends_lists; elem != NULL; elem = bctbx_list_next(elem)) {
 		LinphoneFriendList *list = (LinphoneFriendList *)elem->data;
 		linphone_friend_list_enable_subscriptions(list,FALSE);
@@ -6400,7 +6460,8 @@ static void _linphone_core_stop(LinphoneCore *lc) {
 
 	sip_setup_unregister_all();
 
-	if (lp_config_needs_commit(lc->config)) lp_config_sync(lc->config);
+	/* with write-behind enabled, also make sure everything is on disk before going further */
+	lp_config_flush(lc->config);
 
 	bctbx_list_for_each(lc->call_logs,(void (*)(void*))linphone_call_log_unref);
 	lc->call_logs=bctbx_list_free(lc->call_logs);
@@ -6490,6 +6551,7 @@ void _linphone_core_uninit(LinphoneCore *lc)
 	
 	linphone_core_deactivate_log_serialization_if_needed();
 	bctbx_list_free_with_data(lc->vtable_refs,(void (*)(void *))v_table_reference_destroy);
+	v_table_subscribers_destroy(lc->vtable_subscribers);
 	bctbx_uninit_logger();
 }
 
@@ -7678,6 +7740,23 @@ int linphone_core_get_unread_chat_message_count_from_active_locals (const Linpho
 	return L_GET_CPP_PTR_FROM_C_OBJECT(lc)->getUnreadChatMessageCountFromActiveLocals();
 }
 
+void linphone_core_enable_metrics(LinphoneCore *lc, bool_t enable) {
+	lp_config_set_int(lc->config, "misc", "metrics_enabled", enable);
+	LinphonePrivate::Metrics::setEnabled(!!enable);
+}
+
+bool_t linphone_core_metrics_enabled(const LinphoneCore *lc) {
+	return LinphonePrivate::Metrics::isEnabled();
+}
+
+char *linphone_core_get_metrics_report(const LinphoneCore *lc) {
+	return ms_strdup(LinphonePrivate::Metrics::getReport().c_str());
+}
+
+void linphone_core_reset_metrics(LinphoneCore *lc) {
+	LinphonePrivate::Metrics::reset();
+}
+
 bool_t linphone_core_has_crappy_opengl(LinphoneCore *lc) {
 	MSFactory * factory = linphone_core_get_ms_factory(lc);
 	MSDevicesInfo *devices = ms_factory_get_devices_info(factory);
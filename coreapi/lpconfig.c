@@ -32,6 +32,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <string>
+#include <unordered_map>
 #if !defined(_WIN32_WCE)
 #include <errno.h>
 #include <sys/types.h>
@@ -75,21 +77,49 @@ typedef struct _LpSectionParam{
 	char *value;
 } LpSectionParam;
 
+typedef std::unordered_map<std::string, LpItem *> LpItemIndex;
+
 typedef struct _LpSection{
 	char *name;
-	bctbx_list_t *items;
+	bctbx_list_t *items; /* keeps the insertion order, used when writing the file */
+	LpItemIndex *items_index; /* non-comment items indexed by key */
+	std::string *serialized; /* cached file text of the section for write-behind, NULL when modified */
 	bctbx_list_t *params;
 	bool_t overwrite; // If set to true, will add overwrite=true to all items of this section when converted to xml
 	bool_t skip; // If set to true, won't be dumped when converted to xml
 } LpSection;
 
+typedef std::unordered_map<std::string, LpSection *> LpSectionIndex;
+
+/*
+ * Background writer used in write-behind mode: linphone_config_sync() only serializes a snapshot on the calling
+ * thread and hands it over, the writer thread does the file I/O and publishes the file with an atomic rename.
+ * Only the latest snapshot is kept, so rapid successive syncs are coalesced into a single write.
+ */
+typedef struct _LpConfigWriter{
+	ms_thread_t thread;
+	ms_mutex_t mutex;
+	ms_cond_t cond;
+	std::string *pending; /* snapshot waiting to be written, protected by mutex */
+	char *filename;
+	char *tmpfilename;
+	bctbx_vfs_t *vfs;
+	bool_t busy; /* a snapshot is being written */
+	bool_t running;
+	bool_t write_failed;
+} LpConfigWriter;
+
+static void linphone_config_writer_destroy(LpConfigWriter *writer);
+
 struct _LpConfig{
 	belle_sip_object_t base;
 	bctbx_vfs_file_t* pFile;
 	char *filename;
 	char *tmpfilename;
 	char *factory_filename;
-	bctbx_list_t *sections;
+	bctbx_list_t *sections; /* keeps the insertion order, used when writing the file */
+	LpSectionIndex *sections_index; /* sections indexed by name */
+	LpConfigWriter *writer; /* NULL unless write-behind is enabled */
 	bool_t modified;
 	bool_t readonly;
 	bctbx_vfs_t* g_bctbx_vfs;
@@ -143,6 +173,7 @@ LpSectionParam *lp_section_param_new(const char *key, const char *value){
 LpSection *lp_section_new(const char *name){
 	LpSection *sec=lp_new0(LpSection,1);
 	sec->name=ortp_strdup(name);
+	sec->items_index=new LpItemIndex();
 	return sec;
 }
 
@@ -160,7 +191,16 @@ void lp_section_param_destroy(void *section_param){
 	free(param);
 }
 
+static void lp_section_mark_modified(LpSection *sec){
+	if (sec->serialized) {
+		delete sec->serialized;
+		sec->serialized = NULL;
+	}
+}
+
 void lp_section_destroy(LpSection *sec){
+	delete sec->items_index;
+	delete sec->serialized;
 	ortp_free(sec->name);
 	bctbx_list_for_each(sec->items,lp_item_destroy);
 	bctbx_list_for_each(sec->params,lp_section_param_destroy);
@@ -170,23 +210,49 @@ void lp_section_destroy(LpSection *sec){
 
 void lp_section_add_item(LpSection *sec,LpItem *item){
 	sec->items=bctbx_list_append(sec->items,(void *)item);
+	lp_section_mark_modified(sec);
+	/* Like the former linear lookup, the first item added with a given key wins. */
+	if (!item->is_comment) sec->items_index->emplace(item->key, item);
 }
 
 void linphone_config_add_section(LpConfig *lpconfig, LpSection *section){
 	lpconfig->sections=bctbx_list_append(lpconfig->sections,(void *)section);
+	if (!lpconfig->sections_index) lpconfig->sections_index=new LpSectionIndex();
+	lpconfig->sections_index->emplace(section->name, section);
 }
 
 void linphone_config_add_section_param(LpSection *section, LpSectionParam *param){
+	lp_section_mark_modified(section);
 	section->params = bctbx_list_append(section->params, (void *)param);
 }
 
 void linphone_config_remove_section(LpConfig *lpconfig, LpSection *section){
 	lpconfig->sections=bctbx_list_remove(lpconfig->sections,(void *)section);
+	if (lpconfig->sections_index) {
+		auto it = lpconfig->sections_index->find(section->name);
+		if (it != lpconfig->sections_index->end() && it->second == section) lpconfig->sections_index->erase(it);
+	}
 	lp_section_destroy(section);
 }
 
 void lp_section_remove_item(LpSection *sec, LpItem *item){
 	sec->items=bctbx_list_remove(sec->items,(void *)item);
+	lp_section_mark_modified(sec);
+	if (!item->is_comment) {
+		auto it = sec->items_index->find(item->key);
+		if (it != sec->items_index->end() && it->second == item) {
+			bctbx_list_t *elem;
+			sec->items_index->erase(it);
+			/* Re-index a remaining duplicate of this key, if any. */
+			for (elem = sec->items; elem != NULL; elem = bctbx_list_next(elem)) {
+				LpItem *other = (LpItem *)elem->data;
+				if (!other->is_comment && strcmp(other->key, item->key) == 0) {
+					sec->items_index->emplace(other->key, other);
+					break;
+				}
+			}
+		}
+	}
 	lp_item_destroy(item);
 }
 
@@ -207,17 +273,9 @@ static int is_a_comment(const char *str){
 }
 
 LpSection *linphone_config_find_section(const LpConfig *lpconfig, const char *name){
-	LpSection *sec;
-	bctbx_list_t *elem;
-	/*printf("Looking for section %s\n",name);*/
-	for (elem=lpconfig->sections;elem!=NULL;elem=bctbx_list_next(elem)){
-		sec=(LpSection*)elem->data;
-		if (strcmp(sec->name,name)==0){
-			/*printf("Section %s found\n",name);*/
-			return sec;
-		}
-	}
-	return NULL;
+	if (!lpconfig->sections_index) return NULL;
+	auto it = lpconfig->sections_index->find(name);
+	return (it != lpconfig->sections_index->end()) ? it->second : NULL;
 }
 
 LpSectionParam *lp_section_find_param(const LpSection *sec, const char *key){
@@ -247,17 +305,8 @@ LpItem *lp_section_find_comment(const LpSection *sec, const char *comment){
 }
 
 LpItem *lp_section_find_item(const LpSection *sec, const char *name){
-	bctbx_list_t *elem;
-	LpItem *item;
-	/*printf("Looking for item %s\n",name);*/
-	for (elem=sec->items;elem!=NULL;elem=bctbx_list_next(elem)){
-		item=(LpItem*)elem->data;
-		if (!item->is_comment && strcmp(item->key,name)==0) {
-			/*printf("Item %s found\n",name);*/
-			return item;
-		}
-	}
-	return NULL;
+	auto it = sec->items_index->find(name);
+	return (it != sec->items_index->end()) ? it->second : NULL;
 }
 
 static LpSection* linphone_config_parse_line(LpConfig* lpconfig, char* line, LpSection* cur) {
@@ -351,6 +400,7 @@ static LpSection* linphone_config_parse_line(LpConfig* lpconfig, char* line, LpS
 							}else{
 								ortp_free(item->value);
 								item->value=ortp_strdup(pos1);
+								lp_section_mark_modified(cur);
 							}
 							/*ms_message("Found %s=%s",key,pos1);*/
 						}else{
@@ -571,11 +621,13 @@ void lp_item_set_value(LpItem *item, const char *value){
 
 
 static void _linphone_config_uninit(LpConfig *lpconfig){
+	if (lpconfig->writer) linphone_config_writer_destroy(lpconfig->writer);
 	if (lpconfig->filename!=NULL) ortp_free(lpconfig->filename);
 	if (lpconfig->tmpfilename) ortp_free(lpconfig->tmpfilename);
 	if (lpconfig->factory_filename) bctbx_free(lpconfig->factory_filename);
 	bctbx_list_for_each(lpconfig->sections,(void (*)(void*))lp_section_destroy);
 	bctbx_list_free(lpconfig->sections);
+	delete lpconfig->sections_index;
 }
 
 LpConfig *linphone_config_ref(LpConfig *lpconfig){
@@ -749,6 +801,7 @@ void linphone_config_set_string(LpConfig *lpconfig,const char *section, const ch
 			if ((value != NULL) && (value[0] != '\0')) {
 				if (strcmp(value, item->value) == 0) return;
 				lp_item_set_value(item, value);
+				lp_section_mark_modified(sec);
 			} else {
 				lp_section_remove_item(sec, item);
 			}
@@ -894,6 +947,156 @@ void lp_section_write(LpSection *sec,LpConfig *lpconfig){
 
 }
 
+static void lp_section_serialize(LpSection *sec, std::string &out){
+	bctbx_list_t *elem;
+	out.append("[").append(sec->name);
+	for (elem = sec->params; elem != NULL; elem = bctbx_list_next(elem)){
+		LpSectionParam *param = (LpSectionParam *)elem->data;
+		if (param->value && param->value[0] != '\0')
+			out.append(" ").append(param->key).append("=").append(param->value);
+	}
+	out.append("]\n");
+	for (elem = sec->items; elem != NULL; elem = bctbx_list_next(elem)){
+		LpItem *item = (LpItem *)elem->data;
+		if (item->is_comment)
+			out.append(item->value).append("\n");
+		else if (item->value && item->value[0] != '\0')
+			out.append(item->key).append("=").append(item->value).append("\n");
+	}
+	out.append("\n");
+}
+
+/* Serializes the whole configuration, reusing the cached text of the sections that did not change since last time. */
+static std::string *linphone_config_snapshot(LpConfig *lpconfig){
+	std::string *snapshot = new std::string();
+	bctbx_list_t *elem;
+	for (elem = lpconfig->sections; elem != NULL; elem = bctbx_list_next(elem)){
+		LpSection *sec = (LpSection *)elem->data;
+		if (!sec->serialized) {
+			sec->serialized = new std::string();
+			lp_section_serialize(sec, *sec->serialized);
+		}
+		snapshot->append(*sec->serialized);
+	}
+	return snapshot;
+}
+
+static int linphone_config_publish_file(bctbx_vfs_t *vfs, const char *filename, const char *tmpfilename, const std::string &content){
+	bctbx_vfs_file_t *pFile = bctbx_file_open(vfs, tmpfilename, "w");
+	ssize_t written;
+	if (pFile == NULL) return -1;
+	written = content.empty() ? 0 : bctbx_file_write(pFile, content.c_str(), content.size(), 0);
+	bctbx_file_close(pFile);
+	if (written < 0 || (size_t)written != content.size()) {
+		ms_error("Cannot write %s, keeping %s untouched", tmpfilename, filename);
+		return -1;
+	}
+#ifdef RENAME_REQUIRES_NONEXISTENT_NEW_PATH
+	/* On windows, rename() does not accept that the newpath is an existing file, while it is accepted on Unix.
+	 * As a result, we are forced to first delete the linphonerc file, and then rename.*/
+	if (remove(filename)!=0){
+		ms_error("Cannot remove %s: %s",filename, strerror(errno));
+	}
+#endif
+	if (rename(tmpfilename,filename)!=0){
+		ms_error("Cannot rename %s into %s: %s",tmpfilename,filename,strerror(errno));
+	}
+	return 0;
+}
+
+static void *linphone_config_writer_thread(void *data){
+	LpConfigWriter *writer = (LpConfigWriter *)data;
+	ms_mutex_lock(&writer->mutex);
+	while (TRUE) {
+		std::string *snapshot;
+		while (writer->running && !writer->pending)
+			ms_cond_wait(&writer->cond, &writer->mutex);
+		if (!writer->pending) break; /* stopped and nothing left to write */
+		snapshot = writer->pending;
+		writer->pending = NULL;
+		writer->busy = TRUE;
+		ms_mutex_unlock(&writer->mutex);
+
+		if (linphone_config_publish_file(writer->vfs, writer->filename, writer->tmpfilename, *snapshot) != 0) {
+			ms_warning("Could not write %s ! Maybe it is read-only. Configuration will not be saved.", writer->filename);
+			ms_mutex_lock(&writer->mutex);
+			writer->write_failed = TRUE;
+		} else {
+			ms_mutex_lock(&writer->mutex);
+		}
+		delete snapshot;
+		writer->busy = FALSE;
+		ms_cond_broadcast(&writer->cond);
+	}
+	ms_mutex_unlock(&writer->mutex);
+	return NULL;
+}
+
+static LpConfigWriter *linphone_config_writer_new(LpConfig *lpconfig){
+	LpConfigWriter *writer = lp_new0(LpConfigWriter, 1);
+	ms_mutex_init(&writer->mutex, NULL);
+	ms_cond_init(&writer->cond, NULL);
+	writer->filename = ms_strdup(lpconfig->filename);
+	writer->tmpfilename = ms_strdup(lpconfig->tmpfilename);
+	writer->vfs = lpconfig->g_bctbx_vfs;
+	writer->running = TRUE;
+	if (ms_thread_create(&writer->thread, NULL, linphone_config_writer_thread, writer) != 0) {
+		ms_error("Could not start the configuration writer thread, %s will be written synchronously", lpconfig->filename);
+		ms_free(writer->filename);
+		ms_free(writer->tmpfilename);
+		ms_cond_destroy(&writer->cond);
+		ms_mutex_destroy(&writer->mutex);
+		free(writer);
+		return NULL;
+	}
+	return writer;
+}
+
+static void linphone_config_writer_wait(LpConfigWriter *writer){
+	ms_mutex_lock(&writer->mutex);
+	while (writer->pending || writer->busy)
+		ms_cond_wait(&writer->cond, &writer->mutex);
+	ms_mutex_unlock(&writer->mutex);
+}
+
+/* Writes what is still pending, then stops the thread. */
+static void linphone_config_writer_destroy(LpConfigWriter *writer){
+	ms_mutex_lock(&writer->mutex);
+	writer->running = FALSE;
+	ms_cond_broadcast(&writer->cond);
+	ms_mutex_unlock(&writer->mutex);
+	ms_thread_join(writer->thread, NULL);
+	ms_free(writer->filename);
+	ms_free(writer->tmpfilename);
+	ms_cond_destroy(&writer->cond);
+	ms_mutex_destroy(&writer->mutex);
+	free(writer);
+}
+
+static LinphoneStatus linphone_config_sync_async(LpConfig *lpconfig){
+	LpConfigWriter *writer = lpconfig->writer;
+	std::string *snapshot;
+	bool_t write_failed;
+
+	ms_mutex_lock(&writer->mutex);
+	write_failed = writer->write_failed;
+	ms_mutex_unlock(&writer->mutex);
+	if (write_failed) {
+		lpconfig->readonly = TRUE;
+		return -1;
+	}
+
+	snapshot = linphone_config_snapshot(lpconfig);
+	ms_mutex_lock(&writer->mutex);
+	/* Coalesce: a snapshot that was not picked up yet is superseded by this one. */
+	if (writer->pending) delete writer->pending;
+	writer->pending = snapshot;
+	ms_cond_signal(&writer->cond);
+	ms_mutex_unlock(&writer->mutex);
+	lpconfig->modified = FALSE;
+	return 0;
+}
+
 LinphoneStatus linphone_config_sync(LpConfig *lpconfig){
 	bctbx_vfs_file_t *pFile = NULL;
 	if (lpconfig->filename==NULL) return -1;
@@ -903,6 +1106,8 @@ LinphoneStatus linphone_config_sync(LpConfig *lpconfig){
 	/* don't create group/world-accessible files */
 	(void) umask(S_IRWXG | S_IRWXO);
 #endif
+	if (lpconfig->writer) return linphone_config_sync_async(lpconfig);
+
 	pFile  = bctbx_file_open(lpconfig->g_bctbx_vfs,lpconfig->tmpfilename, "w");
 	lpconfig->pFile = pFile;
 	if (pFile == NULL){
@@ -928,6 +1133,36 @@ LinphoneStatus linphone_config_sync(LpConfig *lpconfig){
 	return 0;
 }
 
+void linphone_config_enable_write_behind(LpConfig *lpconfig, bool_t enable){
+	if (enable) {
+		if (lpconfig->writer || lpconfig->filename == NULL || lpconfig->readonly) return;
+		lpconfig->writer = linphone_config_writer_new(lpconfig);
+	} else if (lpconfig->writer) {
+		linphone_config_writer_destroy(lpconfig->writer);
+		lpconfig->writer = NULL;
+	}
+}
+
+bool_t linphone_config_write_behind_enabled(const LpConfig *lpconfig){
+	return lpconfig->writer != NULL;
+}
+
+void linphone_config_wait_for_pending_writes(LpConfig *lpconfig){
+	if (lpconfig->writer) linphone_config_writer_wait(lpconfig->writer);
+}
+
+LinphoneStatus linphone_config_flush(LpConfig *lpconfig){
+	LinphoneStatus status = 0;
+	if (lpconfig->modified) status = linphone_config_sync(lpconfig);
+	if (lpconfig->writer) {
+		linphone_config_writer_wait(lpconfig->writer);
+		ms_mutex_lock(&lpconfig->writer->mutex);
+		if (lpconfig->writer->write_failed) status = -1;
+		ms_mutex_unlock(&lpconfig->writer->mutex);
+	}
+	return status;
+}
+
 int linphone_config_has_section(const LpConfig *lpconfig, const char *section){
 	if (linphone_config_find_section(lpconfig,section)!=NULL) return 1;
 	return 0;
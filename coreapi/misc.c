@@ -55,6 +55,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #define pclose _pclose
 #endif
 
+#include "core/core-p.h"
 #include "nat/stun-client.h"
 #include "utils/payload-type-handler.h"
 
@@ -176,18 +177,25 @@ int parse_hostname_to_addr(const char *server, struct sockaddr_storage *ss, sock
 	return 0;
 }
 
-/* this functions runs a simple stun test and return the number of milliseconds to complete the tests, or -1 if the test were failed.*/
-int linphone_run_stun_tests(LinphoneCore *lc, int audioPort, int videoPort, int textPort,
-	char *audioCandidateAddr, int *audioCandidatePort, char *videoCandidateAddr, int *videoCandidatePort, char *textCandidateAddr, int *textCandidatePort) {
-	LinphonePrivate::StunClient *client = new LinphonePrivate::StunClient(L_GET_CPP_PTR_FROM_C_OBJECT(lc));
-	int ret = client->run(audioPort, videoPort, textPort);
-	strncpy(audioCandidateAddr, client->getAudioCandidate().address.c_str(), LINPHONE_IPADDR_SIZE);
-	*audioCandidatePort = client->getAudioCandidate().port;
-	strncpy(videoCandidateAddr, client->getVideoCandidate().address.c_str(), LINPHONE_IPADDR_SIZE);
-	*videoCandidatePort = client->getVideoCandidate().port;
-	strncpy(textCandidateAddr, client->getTextCandidate().address.c_str(), LINPHONE_IPADDR_SIZE);
-	*textCandidatePort = client->getTextCandidate().port;
-	delete client;
+/* this functions starts a simple stun test, cb is called with the number of milliseconds to complete the tests, or -1 if the test were failed.*/
+int linphone_run_stun_tests(LinphoneCore *lc, int audioPort, int videoPort, int textPort, LinphoneStunTestsDoneCb cb, void *user_data) {
+	std::shared_ptr<LinphonePrivate::StunClient> client = std::make_shared<LinphonePrivate::StunClient>(L_GET_CPP_PTR_FROM_C_OBJECT(lc));
+	LinphonePrivate::StunClient *clientPtr = client.get();
+	int ret = client->runAsync(audioPort, videoPort, textPort, [lc, clientPtr, cb, user_data](int pingTime) {
+		if (cb) cb(lc, pingTime,
+			clientPtr->getAudioCandidate().address.c_str(), clientPtr->getAudioCandidate().port,
+			clientPtr->getVideoCandidate().address.c_str(), clientPtr->getVideoCandidate().port,
+			clientPtr->getTextCandidate().address.c_str(), clientPtr->getTextCandidate().port,
+			user_data);
+		/* The client is still on the stack of its main loop callback. If the core was stopped meanwhile, it is already released. */
+		L_GET_PRIVATE_FROM_C_OBJECT(lc)->doLater([lc, clientPtr]() {
+			L_GET_PRIVATE_FROM_C_OBJECT(lc)->stunClients.remove_if([clientPtr](const std::shared_ptr<LinphonePrivate::StunClient> &stunClient) {
+				return stunClient.get() == clientPtr;
+			});
+		});
+	});
+	if (ret == 0)
+		L_GET_PRIVATE_FROM_C_OBJECT(lc)->stunClients.push_back(client);
 	return ret;
 }
 
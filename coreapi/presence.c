@@ -26,6 +26,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "linphone/presence.h"
 
 #include "c-wrapper/c-wrapper.h"
+#include "logger/metrics.h"
 
 // TODO: From coreapi. Remove me later.
 #include "private.h"
@@ -100,9 +101,6 @@ BELLE_SIP_DECLARE_NO_IMPLEMENTED_INTERFACES(LinphonePresenceModel);
 BELLE_SIP_DECLARE_VPTR_NO_EXPORT(LinphonePresenceModel);
 
 
-static const char *person_prefix = "/pidf:presence/dm:person";
-
-
 /*****************************************************************************
  * PRIVATE FUNCTIONS                                                         *
  ****************************************************************************/
@@ -1368,124 +1366,132 @@ void * linphone_presence_note_get_user_data(const LinphonePresenceNote *note) {
  * XML PRESENCE INTERNAL HANDLING                                            *
  ****************************************************************************/
 
-static const char *service_prefix = "/pidf:presence/pidf:tuple";
-
-static int process_pidf_xml_presence_service_notes(xmlparsing_context_t *xml_ctx, LinphonePresenceService *service, unsigned int service_idx) {
-	char xpath_str[MAX_XPATH_LENGTH];
-	xmlXPathObjectPtr note_object;
-	LinphonePresenceNote *note;
-	char *note_str;
-	char *lang;
-	int i;
+static const char *pidf_ns = "urn:ietf:params:xml:ns:pidf";
+static const char *dm_ns = "urn:ietf:params:xml:ns:pidf:data-model";
+static const char *rpid_ns = "urn:ietf:params:xml:ns:pidf:rpid";
+static const char *pidfonline_ns = "http://www.linphone.org/xsds/pidfonline.xsd";
+static const char *oma_pres_ns = "urn:oma:xml:prs:pidf:oma-pres";
 
-	snprintf(xpath_str, sizeof(xpath_str), "%s[%i]/pidf:note", service_prefix, service_idx);
-	note_object = linphone_get_xml_xpath_object_for_node_list(xml_ctx, xpath_str);
-	if ((note_object != NULL) && (note_object->nodesetval != NULL)) {
-		for (i = 1; i <= note_object->nodesetval->nodeNr; i++) {
-			snprintf(xpath_str, sizeof(xpath_str), "%s[%i]/pidf:note[%i]", service_prefix, service_idx, i);
-			note_str = linphone_get_xml_text_content(xml_ctx, xpath_str);
-			if (note_str == NULL) continue;
-			snprintf(xpath_str, sizeof(xpath_str), "%s[%i]/pidf:note[%i]/@xml:lang", service_prefix, service_idx, i);
-			lang = linphone_get_xml_text_content(xml_ctx, xpath_str);
-
-			note = linphone_presence_note_new(note_str, lang);
-			presence_service_add_note(service, note);
-			if (lang != NULL) linphone_free_xml_text_content(lang);
-			linphone_free_xml_text_content(note_str);
-		}
-	}
-	if (note_object != NULL) xmlXPathFreeObject(note_object);
+/*
+ * The PIDF document is decoded in a single forward pass with a libxml2 text reader: no tree is kept and no XPath
+ * expression is built or evaluated. Each process_* function is called with the reader positioned on the start of
+ * its element and returns once the whole element has been consumed.
+ */
 
-	return 0;
+static bool_t xml_reader_has_children(xmlTextReaderPtr reader) {
+	return !xmlTextReaderIsEmptyElement(reader);
 }
 
-static int process_pidf_xml_presence_services(xmlparsing_context_t *xml_ctx, LinphonePresenceModel *model) {
-	char xpath_str[MAX_XPATH_LENGTH];
-	xmlXPathObjectPtr service_object;
-	xmlXPathObjectPtr pidfonline_object;
-	LinphonePresenceService *service;
-	char *basic_status_str;
-	char *service_id_str;
-	char *timestamp_str;
-	char *contact_str;
-	LinphonePresenceBasicStatus basic_status;
-	int i;
-	xmlXPathObjectPtr service_descriptions;
+static LinphonePresenceNote * process_pidf_xml_presence_note(xmlTextReaderPtr reader) {
+	LinphonePresenceNote *note = NULL;
+	char *note_str = linphone_xml_reader_get_text_content(reader);
+	if (note_str != NULL) {
+		char *lang = (char *)xmlTextReaderGetAttributeNs(reader, (const xmlChar *)"lang", XML_XML_NAMESPACE);
+		note = linphone_presence_note_new(note_str, lang);
+		if (lang != NULL) linphone_free_xml_text_content(lang);
+		linphone_free_xml_text_content(note_str);
+	}
+	return note;
+}
 
-	service_object = linphone_get_xml_xpath_object_for_node_list(xml_ctx, service_prefix);
-	if ((service_object != NULL) && (service_object->nodesetval != NULL)) {
-		for (i = 1; i <= service_object->nodesetval->nodeNr; i++) {
-			snprintf(xpath_str, sizeof(xpath_str), "%s[%i]/pidf:status/pidf:basic", service_prefix, i);
-			basic_status_str = linphone_get_xml_text_content(xml_ctx, xpath_str);
-			if (basic_status_str == NULL)
-				continue;
+static int process_pidf_xml_presence_service_status(xmlTextReaderPtr reader, LinphonePresenceService *service, bool_t *has_basic_status, bool_t *online) {
+	int depth = xmlTextReaderDepth(reader);
+	int ret;
 
+	if (!xml_reader_has_children(reader)) return 0;
+	while ((ret = linphone_xml_reader_next_child_element(reader, depth)) == 1) {
+		if (linphone_xml_reader_is_element(reader, pidf_ns, "basic")) {
+			char *basic_status_str = linphone_xml_reader_get_text_content(reader);
+			if (basic_status_str == NULL) continue;
 			if (strcmp(basic_status_str, "open") == 0) {
-				basic_status = LinphonePresenceBasicStatusOpen;
+				service->status = LinphonePresenceBasicStatusOpen;
 			} else if (strcmp(basic_status_str, "closed") == 0) {
-				basic_status = LinphonePresenceBasicStatusClosed;
+				service->status = LinphonePresenceBasicStatusClosed;
 			} else {
 				/* Invalid value for basic status. */
 				linphone_free_xml_text_content(basic_status_str);
 				return -1;
 			}
+			*has_basic_status = TRUE;
+			linphone_free_xml_text_content(basic_status_str);
+		} else if (linphone_xml_reader_is_element(reader, pidfonline_ns, "online")) {
+			*online = TRUE;
+		}
+	}
+	return ret;
+}
 
-			snprintf(xpath_str, sizeof(xpath_str), "%s[%i]/pidf:status/pidfonline:online", service_prefix, i);
-			pidfonline_object = linphone_get_xml_xpath_object_for_node_list(xml_ctx, xpath_str);
-			if (pidfonline_object) {
-				if (pidfonline_object->nodesetval && pidfonline_object->nodesetval->nodeNr > 0)
-					model->is_online = TRUE;
-				xmlXPathFreeObject(pidfonline_object);
-			}
+static int process_pidf_xml_presence_service_description(xmlTextReaderPtr reader, LinphonePresenceService *service, bctbx_list_t **services) {
+	int depth = xmlTextReaderDepth(reader);
+	char *service_id = NULL;
+	char *version = NULL;
+	int ret;
 
-			snprintf(xpath_str, sizeof(xpath_str), "%s[%i]/pidf:timestamp", service_prefix, i);
-			timestamp_str = linphone_get_xml_text_content(xml_ctx, xpath_str);
-
-			snprintf(xpath_str, sizeof(xpath_str), "%s[%i]/pidf:contact", service_prefix, i);
-			contact_str = linphone_get_xml_text_content(xml_ctx, xpath_str);
-
-			snprintf(xpath_str, sizeof(xpath_str), "%s[%i]/@id", service_prefix, i);
-			service_id_str = linphone_get_xml_text_content(xml_ctx, xpath_str);
-			service = presence_service_new(service_id_str, basic_status);
-
-			snprintf(xpath_str, sizeof(xpath_str), "%s[%i]/oma-pres:service-description", service_prefix, i);
-			service_descriptions = linphone_get_xml_xpath_object_for_node_list(xml_ctx, xpath_str);
-			bctbx_list_t *services = nullptr;
-			if (service_descriptions && service_descriptions->nodesetval) {
-				for (int j = 1; j <= service_descriptions->nodesetval->nodeNr; j++) {
-					char *service_id = nullptr;
-					char *version = nullptr;
-					linphone_xml_xpath_context_set_node(xml_ctx, xmlXPathNodeSetItem(service_descriptions->nodesetval, j-1));
-					service_id = linphone_get_xml_text_content(xml_ctx, "./oma-pres:service-id");
-					if (service_id) {
-						version = linphone_get_xml_text_content(xml_ctx, "./oma-pres:version");
-						services = bctbx_list_append(services, ms_strdup(service_id));
-
-						if (service) linphone_presence_service_add_capability(service, ms_strdup(service_id), ms_strdup(version));
-
-						linphone_free_xml_text_content(service_id);
-						linphone_free_xml_text_content(version);
-					}
+	if (!xml_reader_has_children(reader)) return 0;
+	while ((ret = linphone_xml_reader_next_child_element(reader, depth)) == 1) {
+		if (linphone_xml_reader_is_element(reader, oma_pres_ns, "service-id")) {
+			if (service_id) linphone_free_xml_text_content(service_id);
+			service_id = linphone_xml_reader_get_text_content(reader);
+		} else if (linphone_xml_reader_is_element(reader, oma_pres_ns, "version")) {
+			if (version) linphone_free_xml_text_content(version);
+			version = linphone_xml_reader_get_text_content(reader);
+		}
+	}
+	if (service_id) {
+		*services = bctbx_list_append(*services, ms_strdup(service_id));
+		linphone_presence_service_add_capability(service, service_id, version ? ms_strdup(version) : NULL);
+		linphone_free_xml_text_content(service_id);
+	}
+	if (version) linphone_free_xml_text_content(version);
+	return ret;
+}
+
+static int process_pidf_xml_presence_service(xmlTextReaderPtr reader, LinphonePresenceModel *model) {
+	int depth = xmlTextReaderDepth(reader);
+	char *service_id_str = linphone_xml_reader_get_attribute(reader, "id");
+	LinphonePresenceService *service = presence_service_new(service_id_str, LinphonePresenceBasicStatusClosed);
+	bctbx_list_t *services = nullptr;
+	bool_t has_basic_status = FALSE;
+	bool_t online = FALSE;
+	int ret = 0;
+
+	if (service_id_str) linphone_free_xml_text_content(service_id_str);
+
+	if (xml_reader_has_children(reader)) {
+		while ((ret = linphone_xml_reader_next_child_element(reader, depth)) == 1) {
+			if (linphone_xml_reader_is_element(reader, pidf_ns, "status")) {
+				ret = process_pidf_xml_presence_service_status(reader, service, &has_basic_status, &online);
+			} else if (linphone_xml_reader_is_element(reader, pidf_ns, "timestamp")) {
+				char *timestamp_str = linphone_xml_reader_get_text_content(reader);
+				if (timestamp_str) {
+					presence_service_set_timestamp(service, parse_timestamp(timestamp_str));
+					linphone_free_xml_text_content(timestamp_str);
 				}
+			} else if (linphone_xml_reader_is_element(reader, pidf_ns, "contact")) {
+				char *contact_str = linphone_xml_reader_get_text_content(reader);
+				if (contact_str) {
+					linphone_presence_service_set_contact(service, contact_str);
+					linphone_free_xml_text_content(contact_str);
+				}
+			} else if (linphone_xml_reader_is_element(reader, pidf_ns, "note")) {
+				LinphonePresenceNote *note = process_pidf_xml_presence_note(reader);
+				if (note) presence_service_add_note(service, note);
+			} else if (linphone_xml_reader_is_element(reader, oma_pres_ns, "service-description")) {
+				ret = process_pidf_xml_presence_service_description(reader, service, &services);
 			}
-
-			if (service) {
-				if (timestamp_str) presence_service_set_timestamp(service, parse_timestamp(timestamp_str));
-				if (contact_str) linphone_presence_service_set_contact(service, contact_str);
-				if (services) linphone_presence_service_set_service_descriptions(service, services);
-				process_pidf_xml_presence_service_notes(xml_ctx, service, (unsigned int)i);
-				linphone_presence_model_add_service(model, service);
-				linphone_presence_service_unref(service);
-			}
-			if (timestamp_str) linphone_free_xml_text_content(timestamp_str);
-			if (contact_str) linphone_free_xml_text_content(contact_str);
-			if (service_id_str) linphone_free_xml_text_content(service_id_str);
-			linphone_free_xml_text_content(basic_status_str);
+			if (ret < 0) break;
 		}
 	}
-	if (service_object != NULL) xmlXPathFreeObject(service_object);
 
-	return 0;
+	if ((ret == 0) && has_basic_status) {
+		if (online) model->is_online = TRUE;
+		if (services) linphone_presence_service_set_service_descriptions(service, services);
+		linphone_presence_model_add_service(model, service);
+	} else {
+		bctbx_list_free_with_data(services, bctbx_free);
+	}
+	linphone_presence_service_unref(service);
+	return ret;
 }
 
 static bool_t is_valid_activity_name(const char *name) {
@@ -1498,196 +1504,90 @@ static bool_t is_valid_activity_name(const char *name) {
 	return FALSE;
 }
 
-static int process_pidf_xml_presence_person_activities(xmlparsing_context_t *xml_ctx, LinphonePresencePerson *person, unsigned int person_idx) {
-	char xpath_str[MAX_XPATH_LENGTH];
-	xmlXPathObjectPtr activities_nodes_object;
-	xmlXPathObjectPtr activities_object;
-	xmlNodePtr activity_node;
-	LinphonePresenceActivity *activity;
-	char *description;
-	int i, j;
-	int err = 0;
-
-	snprintf(xpath_str, sizeof(xpath_str), "%s[%i]/rpid:activities", person_prefix, person_idx);
-	activities_nodes_object = linphone_get_xml_xpath_object_for_node_list(xml_ctx, xpath_str);
-	if ((activities_nodes_object != NULL) && (activities_nodes_object->nodesetval != NULL)) {
-		for (i = 1; i <= activities_nodes_object->nodesetval->nodeNr; i++) {
-			snprintf(xpath_str, sizeof(xpath_str), "%s[%i]/rpid:activities[%i]/rpid:*", person_prefix, person_idx, i);
-			activities_object = linphone_get_xml_xpath_object_for_node_list(xml_ctx, xpath_str);
-			if ((activities_object != NULL) && (activities_object->nodesetval != NULL)) {
-				for (j = 0; j < activities_object->nodesetval->nodeNr; j++) {
-					activity_node = activities_object->nodesetval->nodeTab[j];
-					if ((activity_node->name != NULL) && (is_valid_activity_name((const char *)activity_node->name) == TRUE)) {
-						LinphonePresenceActivityType acttype;
-						description = (char *)xmlNodeGetContent(activity_node);
-						if ((description != NULL) && (description[0] == '\0')) {
-							linphone_free_xml_text_content(description);
-							description = NULL;
-						}
-						err = activity_name_to_presence_activity_type((const char *)activity_node->name, &acttype);
-						if (err < 0) break;
-						activity = linphone_presence_activity_new(acttype, description);
-						linphone_presence_person_add_activity(person, activity);
-						linphone_presence_activity_unref(activity);
-						if (description != NULL) linphone_free_xml_text_content(description);
-					}
-				}
+static int process_pidf_xml_presence_person_activities(xmlTextReaderPtr reader, LinphonePresencePerson *person) {
+	int depth = xmlTextReaderDepth(reader);
+	int ret;
+
+	if (!xml_reader_has_children(reader)) return 0;
+	while ((ret = linphone_xml_reader_next_child_element(reader, depth)) == 1) {
+		const char *name = (const char *)xmlTextReaderConstLocalName(reader);
+		if (!linphone_xml_reader_is_element(reader, rpid_ns, NULL)) continue;
+		if (strcmp(name, "note") == 0) {
+			LinphonePresenceNote *note = process_pidf_xml_presence_note(reader);
+			if (note) presence_person_add_activities_note(person, note);
+		} else if (is_valid_activity_name(name) == TRUE) {
+			LinphonePresenceActivityType acttype;
+			LinphonePresenceActivity *activity;
+			char *description = linphone_xml_reader_get_text_content(reader);
+			if (activity_name_to_presence_activity_type(name, &acttype) < 0) {
+				if (description != NULL) linphone_free_xml_text_content(description);
+				return -1;
 			}
-			if (activities_object != NULL) xmlXPathFreeObject(activities_object);
-			if (err < 0) break;
+			activity = linphone_presence_activity_new(acttype, description);
+			linphone_presence_person_add_activity(person, activity);
+			linphone_presence_activity_unref(activity);
+			if (description != NULL) linphone_free_xml_text_content(description);
 		}
 	}
-	if (activities_nodes_object != NULL) xmlXPathFreeObject(activities_nodes_object);
-
-	return err;
-}
-
-static int process_pidf_xml_presence_person_notes(xmlparsing_context_t *xml_ctx, LinphonePresencePerson *person, unsigned int person_idx) {
-	char xpath_str[MAX_XPATH_LENGTH];
-	xmlXPathObjectPtr note_object;
-	LinphonePresenceNote *note;
-	char *note_str;
-	char *lang;
-	int i;
-
-	snprintf(xpath_str, sizeof(xpath_str), "%s[%i]/rpid:activities/rpid:note", person_prefix, person_idx);
-	note_object = linphone_get_xml_xpath_object_for_node_list(xml_ctx, xpath_str);
-	if ((note_object != NULL) && (note_object->nodesetval != NULL)) {
-		for (i = 1; i <= note_object->nodesetval->nodeNr; i++) {
-			snprintf(xpath_str, sizeof(xpath_str), "%s[%i]/rpid:activities/rpid:note[%i]", person_prefix, person_idx, i);
-			note_str = linphone_get_xml_text_content(xml_ctx, xpath_str);
-			if (note_str == NULL) continue;
-			snprintf(xpath_str, sizeof(xpath_str), "%s[%i]/rpid:activities/rpid:note[%i]/@xml:lang", person_prefix, person_idx, i);
-			lang = linphone_get_xml_text_content(xml_ctx, xpath_str);
-
-			note = linphone_presence_note_new(note_str, lang);
-			presence_person_add_activities_note(person, note);
-			if (lang != NULL) linphone_free_xml_text_content(lang);
-			linphone_free_xml_text_content(note_str);
-		}
-	}
-	if (note_object != NULL) xmlXPathFreeObject(note_object);
-
-	snprintf(xpath_str, sizeof(xpath_str), "%s[%i]/dm:note", person_prefix, person_idx);
-	note_object = linphone_get_xml_xpath_object_for_node_list(xml_ctx, xpath_str);
-	if ((note_object != NULL) && (note_object->nodesetval != NULL)) {
-		for (i = 1; i <= note_object->nodesetval->nodeNr; i++) {
-			snprintf(xpath_str, sizeof(xpath_str), "%s[%i]/dm:note[%i]", person_prefix, person_idx, i);
-			note_str = linphone_get_xml_text_content(xml_ctx, xpath_str);
-			if (note_str == NULL) continue;
-			snprintf(xpath_str, sizeof(xpath_str), "%s[%i]/dm:note[%i]/@xml:lang", person_prefix, person_idx, i);
-			lang = linphone_get_xml_text_content(xml_ctx, xpath_str);
-
-			note = linphone_presence_note_new(note_str, lang);
-			presence_person_add_note(person, note);
-			if (lang != NULL) linphone_free_xml_text_content(lang);
-			linphone_free_xml_text_content(note_str);
-		}
-	}
-	if (note_object != NULL) xmlXPathFreeObject(note_object);
-
-	return 0;
-}
-
-static int process_pidf_xml_presence_persons(xmlparsing_context_t *xml_ctx, LinphonePresenceModel *model) {
-	char xpath_str[MAX_XPATH_LENGTH];
-	xmlXPathObjectPtr person_object;
-	LinphonePresencePerson *person;
-	char *person_id_str;
-	char *person_timestamp_str;
-	time_t timestamp;
-	int i;
-	int err = 0;
-
-	person_object = linphone_get_xml_xpath_object_for_node_list(xml_ctx, person_prefix);
-	if ((person_object != NULL) && (person_object->nodesetval != NULL)) {
-		for (i = 1; i <= person_object->nodesetval->nodeNr; i++) {
-			snprintf(xpath_str, sizeof(xpath_str), "%s[%i]/@id", person_prefix, i);
-			person_id_str = linphone_get_xml_text_content(xml_ctx, xpath_str);
-			snprintf(xpath_str, sizeof(xpath_str), "%s[%i]/pidf:timestamp", person_prefix, i);
-			person_timestamp_str = linphone_get_xml_text_content(xml_ctx, xpath_str);
-			if (person_timestamp_str == NULL)
-				timestamp = time(NULL);
-			else
-				timestamp = parse_timestamp(person_timestamp_str);
-			person = presence_person_new(person_id_str, timestamp);
-
-			if (person != NULL) {
-				err = process_pidf_xml_presence_person_activities(xml_ctx, person, (unsigned int)i);
-				if (err == 0) {
-					err = process_pidf_xml_presence_person_notes(xml_ctx, person, (unsigned int)i);
-				}
-				if (err == 0) {
-					presence_model_add_person(model, person);
-					linphone_presence_person_unref(person);
-				} else {
-					linphone_presence_person_unref(person);
-					break;
+	return ret;
+}
+
+static int process_pidf_xml_presence_person(xmlTextReaderPtr reader, LinphonePresenceModel *model) {
+	int depth = xmlTextReaderDepth(reader);
+	char *person_id_str = linphone_xml_reader_get_attribute(reader, "id");
+	LinphonePresencePerson *person = presence_person_new(person_id_str, time(NULL));
+	int ret = 0;
+
+	if (person_id_str != NULL) linphone_free_xml_text_content(person_id_str);
+
+	if (xml_reader_has_children(reader)) {
+		while ((ret = linphone_xml_reader_next_child_element(reader, depth)) == 1) {
+			if (linphone_xml_reader_is_element(reader, rpid_ns, "activities")) {
+				ret = process_pidf_xml_presence_person_activities(reader, person);
+			} else if (linphone_xml_reader_is_element(reader, dm_ns, "note")) {
+				LinphonePresenceNote *note = process_pidf_xml_presence_note(reader);
+				if (note) presence_person_add_note(person, note);
+			} else if (linphone_xml_reader_is_element(reader, pidf_ns, "timestamp")) {
+				char *person_timestamp_str = linphone_xml_reader_get_text_content(reader);
+				if (person_timestamp_str != NULL) {
+					person->timestamp = parse_timestamp(person_timestamp_str);
+					linphone_free_xml_text_content(person_timestamp_str);
 				}
 			}
-			if (person_id_str != NULL) linphone_free_xml_text_content(person_id_str);
-			if (person_timestamp_str != NULL) linphone_free_xml_text_content(person_timestamp_str);
+			if (ret < 0) break;
 		}
 	}
-	if (person_object != NULL) xmlXPathFreeObject(person_object);
 
-	if (err < 0) {
-		/* Remove all the persons added since there was an error. */
-		bctbx_list_for_each(model->persons, presence_person_unref);
-	}
-	return err;
+	/* Persons are sorted by timestamp, so they can only be added once completely parsed. */
+	if (ret == 0) presence_model_add_person(model, person);
+	linphone_presence_person_unref(person);
+	return ret;
 }
 
-static int process_pidf_xml_presence_notes(xmlparsing_context_t *xml_ctx, LinphonePresenceModel *model) {
-	char xpath_str[MAX_XPATH_LENGTH];
-	xmlXPathObjectPtr note_object;
-	LinphonePresenceNote *note;
-	char *note_str;
-	char *lang;
-	int i;
-
-	note_object = linphone_get_xml_xpath_object_for_node_list(xml_ctx, "/pidf:presence/pidf:note");
-	if ((note_object != NULL) && (note_object->nodesetval != NULL)) {
-		for (i = 1; i <= note_object->nodesetval->nodeNr; i++) {
-			snprintf(xpath_str, sizeof(xpath_str), "/pidf:presence/pidf:note[%i]", i);
-			note_str = linphone_get_xml_text_content(xml_ctx, xpath_str);
-			if (note_str == NULL) continue;
-			snprintf(xpath_str, sizeof(xpath_str), "/pidf:presence/pidf:note[%i]/@xml:lang", i);
-			lang = linphone_get_xml_text_content(xml_ctx, xpath_str);
-
-			note = linphone_presence_note_new(note_str, lang);
-			presence_model_add_note(model, note);
-			if (lang != NULL) linphone_free_xml_text_content(lang);
-			linphone_free_xml_text_content(note_str);
-		}
-	}
-	if (note_object != NULL) xmlXPathFreeObject(note_object);
-
-	return 0;
-}
-
-static LinphonePresenceModel * process_pidf_xml_presence_notification(xmlparsing_context_t *xml_ctx) {
+static LinphonePresenceModel * process_pidf_xml_presence_notification(xmlTextReaderPtr reader) {
 	LinphonePresenceModel *model = NULL;
-	int err;
+	int ret;
 
-	if (linphone_create_xml_xpath_context(xml_ctx) < 0)
-		return NULL;
+	/* Move to the root element. */
+	while (((ret = xmlTextReaderRead(reader)) == 1) && (xmlTextReaderNodeType(reader) != XML_READER_TYPE_ELEMENT));
+	if (ret != 1) return NULL;
 
 	model = linphone_presence_model_new();
-	xmlXPathRegisterNs(xml_ctx->xpath_ctx, (const xmlChar *)"pidf", (const xmlChar *)"urn:ietf:params:xml:ns:pidf");
-	xmlXPathRegisterNs(xml_ctx->xpath_ctx, (const xmlChar *)"dm", (const xmlChar *)"urn:ietf:params:xml:ns:pidf:data-model");
-	xmlXPathRegisterNs(xml_ctx->xpath_ctx, (const xmlChar *)"rpid", (const xmlChar *)"urn:ietf:params:xml:ns:pidf:rpid");
-	xmlXPathRegisterNs(xml_ctx->xpath_ctx, (const xmlChar *)"pidfonline", (const xmlChar *)"http://www.linphone.org/xsds/pidfonline.xsd");
-	xmlXPathRegisterNs(xml_ctx->xpath_ctx, (const xmlChar *)"oma-pres", (const xmlChar *)"urn:oma:xml:prs:pidf:oma-pres");
-	err = process_pidf_xml_presence_services(xml_ctx, model);
-	if (err == 0) {
-		err = process_pidf_xml_presence_persons(xml_ctx, model);
-	}
-	if (err == 0) {
-		err = process_pidf_xml_presence_notes(xml_ctx, model);
+	if (linphone_xml_reader_is_element(reader, pidf_ns, "presence") && xml_reader_has_children(reader)) {
+		while ((ret = linphone_xml_reader_next_child_element(reader, 0)) == 1) {
+			if (linphone_xml_reader_is_element(reader, pidf_ns, "tuple")) {
+				ret = process_pidf_xml_presence_service(reader, model);
+			} else if (linphone_xml_reader_is_element(reader, dm_ns, "person")) {
+				ret = process_pidf_xml_presence_person(reader, model);
+			} else if (linphone_xml_reader_is_element(reader, pidf_ns, "note")) {
+				LinphonePresenceNote *note = process_pidf_xml_presence_note(reader);
+				if (note) presence_model_add_note(model, note);
+			}
+			if (ret < 0) break;
+		}
 	}
 
-	if (err < 0) {
+	if (ret < 0) {
 		linphone_presence_model_unref(model);
 		model = NULL;
 	}
@@ -1788,7 +1688,9 @@ void linphone_subscription_new(LinphoneCore *lc, SalSubscribeOp *op, const char
 }
 
 void linphone_notify_parse_presence(const char *content_type, const char *content_subtype, const char *body, SalPresenceModel **result) {
+	L_METRIC_TIME_SCOPE("presence.notify.parse");
 	xmlparsing_context_t *xml_ctx;
+	xmlTextReaderPtr reader;
 	LinphonePresenceModel *model = NULL;
 
 	if (strcmp(content_type, "application") != 0) {
@@ -1799,10 +1701,12 @@ void linphone_notify_parse_presence(const char *content_type, const char *conten
 	if (strcmp(content_subtype, "pidf+xml") == 0) {
 		xml_ctx = linphone_xmlparsing_context_new();
 		xmlSetGenericErrorFunc(xml_ctx, linphone_xmlparsing_genericxml_error);
-		xml_ctx->doc = xmlReadDoc((const unsigned char*)body, 0, NULL, 0);
-		if (xml_ctx->doc != NULL) {
-			model = process_pidf_xml_presence_notification(xml_ctx);
-		} else {
+		reader = xmlReaderForMemory(body, (int)strlen(body), NULL, NULL, 0);
+		if (reader != NULL) {
+			model = process_pidf_xml_presence_notification(reader);
+			xmlFreeTextReader(reader);
+		}
+		if (model == NULL) {
 			ms_warning("Wrongly formatted presence XML: %s", xml_ctx->errorBuffer);
 		}
 		linphone_xmlparsing_context_destroy(xml_ctx);
@@ -2117,6 +2021,8 @@ end:
 }
 
 void linphone_notify_recv(LinphoneCore *lc, SalOp *op, SalSubscribeStatus ss, SalPresenceModel *model){
+	L_METRIC_TIME_SCOPE("presence.notify");
+	L_METRIC_COUNTER_INCREMENT("presence.notifies.received");
 	char *tmp;
 	LinphoneFriend *lf = NULL;
 	const LinphoneAddress *lfa=NULL;
@@ -141,6 +141,11 @@
 	#define LINPHONE_MAX_CALL_HISTORY_SIZE LINPHONE_MAX_CALL_HISTORY_UNLIMITED
 #endif
 
+/* Number of most recent call logs kept in memory when the call history is stored in a database. */
+#ifndef LINPHONE_CALL_HISTORY_WINDOW_SIZE
+	#define LINPHONE_CALL_HISTORY_WINDOW_SIZE 100
+#endif
+
 #define LINPHONE_SQLITE3_VFS "sqlite3bctbx_vfs"
 
 #endif /* _PRIVATE_H */
@@ -193,6 +193,7 @@ LINPHONE_PUBLIC LinphoneFriendListStatus linphone_friend_list_import_friend(Linp
 LinphoneFriendListCbs * linphone_friend_list_cbs_new(void);
 void linphone_friend_list_set_current_callbacks(LinphoneFriendList *friend_list, LinphoneFriendListCbs *cbs);
 void linphone_friend_add_addresses_and_numbers_into_maps(LinphoneFriend *lf, LinphoneFriendList *list);
+void linphone_friend_index_presence_models(LinphoneFriend *lf);
 
 int linphone_parse_host_port(const char *input, char *host, size_t hostlen, int *port);
 int parse_hostname_to_addr(const char *server, struct sockaddr_storage *ss, socklen_t *socklen, int default_port);
@@ -230,8 +231,6 @@ void linphone_subscription_closed(LinphoneCore *lc, LinphonePrivate::SalOp *op);
 
 void linphone_core_update_allocated_audio_bandwidth(LinphoneCore *lc);
 
-LINPHONE_PUBLIC int linphone_run_stun_tests(LinphoneCore *lc, int audioPort, int videoPort, int textPort,
-	char *audioCandidateAddr, int *audioCandidatePort, char *videoCandidateAddr, int *videoCandidatePort, char *textCandidateAddr, int *textCandidatePort);
 void linphone_core_resolve_stun_server(LinphoneCore *lc);
 LINPHONE_PUBLIC const struct addrinfo *linphone_core_get_stun_server_addrinfo(LinphoneCore *lc);
 LINPHONE_PUBLIC void linphone_core_enable_forced_ice_relay(LinphoneCore *lc, bool_t enable);
@@ -489,6 +488,11 @@ char * linphone_get_xml_attribute_text_content(xmlparsing_context_t *xml_ctx, co
 void linphone_free_xml_text_content(char *text);
 xmlXPathObjectPtr linphone_get_xml_xpath_object_for_node_list(xmlparsing_context_t *xml_ctx, const char *xpath_expression);
 void linphone_xml_xpath_context_init_carddav_ns(xmlparsing_context_t *xml_ctx);
+/* Streaming helpers: walk the children elements of the element at parent_depth, returns 1 on a child element, 0 at the end of the parent, -1 on error. */
+int linphone_xml_reader_next_child_element(xmlTextReaderPtr reader, int parent_depth);
+bool_t linphone_xml_reader_is_element(xmlTextReaderPtr reader, const char *ns, const char *name);
+char * linphone_xml_reader_get_text_content(xmlTextReaderPtr reader);
+char * linphone_xml_reader_get_attribute(xmlTextReaderPtr reader, const char *attribute_name);
 
 /*****************************************************************************
  * OTHER UTILITY FUNCTIONS                                                     *
@@ -584,6 +588,9 @@ SalStreamDir sal_dir_from_call_params_dir(LinphoneMediaDirection cpdir);
 void ** linphone_content_get_cryptoContext_address(LinphoneContent *content);
 
 void v_table_reference_destroy(VTableReference *ref);
+void v_table_subscribers_destroy(VTableSubscribers *subscribers);
+/* To be called whenever a callback of a LinphoneCoreCbs is set, the cores then rebuild their subscribers index. */
+void _linphone_core_cbs_changed(void);
 
 LINPHONE_PUBLIC void _linphone_core_add_callbacks(LinphoneCore *lc, LinphoneCoreCbs *vtable, bool_t internal);
 
@@ -162,6 +162,7 @@ struct _LinphoneAuthInfo
 
 struct _LinphoneFriendPresence {
 	char *uri_or_tel;
+	char *key; /* normalized form of uri_or_tel (user@domain:port), computed once at insertion */
 	LinphonePresenceModel *presence;
 };
 
@@ -178,6 +179,7 @@ struct _LinphoneFriend{
 	LinphonePrivate::SalPresenceOp *outsub;
 	LinphoneSubscribePolicy pol;
 	MSList *presence_models; /* list of LinphoneFriendPresence. It associates SIP URIs and phone numbers with their respective presence models. */
+	bctbx_map_t *presence_models_map; /* LinphoneFriendPresence indexed by both raw uri_or_tel and normalized key, to avoid parsing on lookup. */
 	MSList *phone_number_sip_uri_map; /* list of LinphoneFriendPhoneNumberSipUri. It associates phone numbers with their corresponding SIP URIs. */
 	struct _LinphoneCore *lc;
 	BuddyInfo *info;
@@ -482,6 +484,7 @@ struct _LinphoneBuffer {
 	void *user_data;
 	uint8_t *content;	/**< A pointer to the buffer content */
 	size_t size;	/**< The size of the buffer content */
+	size_t capacity;	/**< The allocated size of the buffer content */
 };
 
 BELLE_SIP_DECLARE_VPTR_NO_EXPORT(LinphoneBuffer);
@@ -744,6 +747,7 @@ namespace LinphonePrivate {
 #define LINPHONE_CORE_STRUCT_BASE_FIELDS \
 	MSFactory* factory; \
 	MSList* vtable_refs; \
+	VTableSubscribers *vtable_subscribers; \
 	int vtable_notify_recursion; \
 	LinphonePrivate::Sal *sal; \
 	void *platform_helper; \
@@ -770,6 +774,7 @@ namespace LinphonePrivate {
 	MSList *queued_calls; \
 	MSList *call_logs; \
 	int max_call_logs; \
+	int call_logs_window_size; \
 	int missed_calls; \
 	VideoPreview *previewstream; \
 	struct _MSEventQueue *msevq; \
@@ -851,6 +856,8 @@ namespace LinphonePrivate {
 	sqlite3 *zrtp_cache_db; \
 	bctbx_mutex_t zrtp_cache_db_mutex; \
 	sqlite3 *logs_db; \
+	struct _CallLogStorageStatements *logs_db_statements; \
+	struct _QualityReportingCollector *reporting_collector; \
 	sqlite3 *friends_db; \
 	bool_t debug_storage; \
 	void *system_context; \
@@ -63,6 +63,8 @@ typedef struct _xmlparsing_context xmlparsing_context_t;
 
 typedef struct _VTableReference  VTableReference;
 
+typedef struct _VTableSubscribers VTableSubscribers;
+
 typedef struct _EchoTester EchoTester;
 
 typedef struct _LinphoneXmlRpcArg LinphoneXmlRpcArg;
@@ -73,12 +73,12 @@ static void append_to_buffer_valist(char **buff, size_t *buff_size, size_t *offs
 		ret = belle_sip_snprintf_valist(*buff, *buff_size, offset, fmt, args);
 	#endif
 
-	/*if we are out of memory, we add some size to buffer*/
+	/*the buffer is sized from report_size_bound(), so this should not happen unless the bound is wrong*/
 	if (ret == BELLE_SIP_BUFFER_OVERFLOW) {
 		/*some compilers complain that size_t cannot be formatted as unsigned long, hence forcing cast*/
-		ms_debug("QualityReporting: Buffer was too small to contain the whole report - increasing its size from %lu to %lu",
-			(unsigned long)*buff_size, (unsigned long)*buff_size + 2048);
-		*buff_size += 2048;
+		ms_warning("QualityReporting: Buffer was too small to contain the whole report - increasing its size from %lu to %lu",
+			(unsigned long)*buff_size, (unsigned long)*buff_size * 2);
+		*buff_size *= 2;
 		*buff = (char *) ms_realloc(*buff, *buff_size);
 
 		*offset = prevoffset;
@@ -95,6 +95,211 @@ static void append_to_buffer(char **buff, size_t *buff_size, size_t *offset, con
 	va_end(args);
 }
 
+/*upper bounds of what the labels and the numeric fields of a report may take once formatted, strings excluded*/
+#define REPORT_FIXED_SIZE 1024
+#define REPORT_METRICS_FIXED_SIZE 768
+
+#define REPORT_BATCH_BOUNDARY "vq-rtcpxr-batch"
+#define REPORT_BATCH_PART_HEADER "--" REPORT_BATCH_BOUNDARY "\r\nContent-Type: application/vq-rtcpxr\r\n\r\n"
+#define REPORT_BATCH_END "--" REPORT_BATCH_BOUNDARY "--\r\n"
+
+/*Per core state of the quality reporting: the buffer reports are built into, and the interval reports waiting to be
+published together to their collector.*/
+struct _QualityReportingCollector {
+	char *buffer;
+	size_t buffer_size;
+	bctbx_list_t *batches; /*reporting_batch_t*/
+	belle_sip_source_t *flush_timer;
+};
+
+typedef struct reporting_batch {
+	char *collector_uri;
+	bctbx_list_t *reports; /*char *, oldest first*/
+	int count;
+	size_t size;
+} reporting_batch_t;
+
+static size_t strlen_or_zero(const char *str) {
+	return str ? strlen(str) : 0;
+}
+
+static size_t metrics_size_bound(const reporting_content_metrics_t *rm) {
+	return REPORT_METRICS_FIXED_SIZE
+		+ strlen_or_zero(rm->session_description.payload_desc)
+		+ strlen_or_zero(rm->session_description.fmtp)
+		+ strlen_or_zero(rm->user_agent);
+}
+
+/*computes a size the report is guaranteed to fit in, so that it is formatted in a single pass*/
+static size_t report_size_bound(const reporting_session_report_t *report, const char *report_event) {
+	const reporting_addr_t *addrs[2] = {&report->info.local_addr, &report->info.remote_addr};
+	size_t size = REPORT_FIXED_SIZE + strlen(report_event)
+		+ strlen_or_zero(report->info.call_id)
+		+ strlen_or_zero(report->info.orig_id)
+		+ strlen_or_zero(report->dialog_id)
+		+ strlen_or_zero(report->qos_analyzer.name)
+		+ strlen_or_zero(report->qos_analyzer.timestamp)
+		+ strlen_or_zero(report->qos_analyzer.input_leg)
+		+ strlen_or_zero(report->qos_analyzer.input)
+		+ strlen_or_zero(report->qos_analyzer.output_leg)
+		+ strlen_or_zero(report->qos_analyzer.output)
+		+ metrics_size_bound(&report->local_metrics)
+		+ metrics_size_bound(&report->remote_metrics);
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		size += strlen_or_zero(addrs[i]->id) + strlen_or_zero(addrs[i]->ip) + strlen_or_zero(addrs[i]->group) + strlen_or_zero(addrs[i]->mac);
+	}
+	return size;
+}
+
+static reporting_collector_t *get_collector(LinphoneCore *lc) {
+	if (lc->reporting_collector == NULL)
+		lc->reporting_collector = ms_new0(reporting_collector_t, 1);
+	return lc->reporting_collector;
+}
+
+/*the buffer is kept from one report to the other and only grows when a report is bigger than all the previous ones*/
+static void reserve_buffer(reporting_collector_t *collector, size_t size) {
+	if (collector->buffer_size < size) {
+		collector->buffer = (char *) ms_realloc(collector->buffer, size);
+		collector->buffer_size = size;
+	}
+	collector->buffer[0] = '\0';
+}
+
+static int publish_to_collector(LinphoneCore *lc, const char *collector_uri, const LinphoneContent *content) {
+	LinphoneAddress *request_uri = linphone_address_new(collector_uri);
+	LinphoneEvent *lev;
+	const SalAddress *salAddress;
+	int err;
+
+	if (request_uri == NULL) {
+		ms_error("QualityReporting: invalid collector uri [%s]", collector_uri);
+		return -1;
+	}
+	lev = linphone_core_create_one_shot_publish(lc, request_uri, "vq-rtcpxr");
+	/* Special exception for quality report PUBLISH: if the collector_uri has any transport related parameters
+	 * (port, transport, maddr), then it is sent directly.
+	 * Otherwise it is routed as any LinphoneEvent publish, following proxy config policy.
+	 **/
+	salAddress = L_GET_PRIVATE_FROM_C_OBJECT(request_uri)->getInternalAddress();
+	if (sal_address_has_uri_param(salAddress, "transport") ||
+		sal_address_has_uri_param(salAddress, "maddr") ||
+		linphone_address_get_port(request_uri) != 0) {
+		ms_message("Publishing report with custom route %s", collector_uri);
+		lev->op->setRoute(collector_uri);
+	}
+	err = linphone_event_send_publish(lev, content);
+	linphone_address_unref(request_uri);
+	return err;
+}
+
+/*a batch holding a single report is sent as is, several reports are sent as the parts of a multipart/mixed body*/
+static void publish_batch(LinphoneCore *lc, reporting_batch_t *batch) {
+	LinphoneContent *content = linphone_content_new();
+	const bctbx_list_t *elem;
+
+	if (batch->count == 1) {
+		linphone_content_set_type(content, "application");
+		linphone_content_set_subtype(content, "vq-rtcpxr");
+		linphone_content_set_buffer(content, (const uint8_t *)batch->reports->data, batch->size);
+	} else {
+		size_t size = batch->size + (size_t)batch->count * (strlen(REPORT_BATCH_PART_HEADER) + 2) + strlen(REPORT_BATCH_END);
+		char *body = (char *) ms_malloc(size);
+		char *ptr = body;
+
+		for (elem = batch->reports; elem != NULL; elem = elem->next) {
+			const char *report = (const char *)elem->data;
+			size_t report_size = strlen(report);
+			memcpy(ptr, REPORT_BATCH_PART_HEADER, strlen(REPORT_BATCH_PART_HEADER));
+			ptr += strlen(REPORT_BATCH_PART_HEADER);
+			memcpy(ptr, report, report_size);
+			ptr += report_size;
+			memcpy(ptr, "\r\n", 2);
+			ptr += 2;
+		}
+		memcpy(ptr, REPORT_BATCH_END, strlen(REPORT_BATCH_END));
+		linphone_content_set_type(content, "multipart");
+		linphone_content_set_subtype(content, "mixed");
+		linphone_content_add_content_type_parameter(content, "boundary", REPORT_BATCH_BOUNDARY);
+		linphone_content_set_buffer(content, (const uint8_t *)body, size);
+		ms_free(body);
+	}
+
+	ms_message("QualityReporting: publishing %d interval report(s) to %s", batch->count, batch->collector_uri);
+	if (publish_to_collector(lc, batch->collector_uri, content) != 0)
+		ms_warning("QualityReporting: could not publish %d interval report(s) to %s", batch->count, batch->collector_uri);
+	linphone_content_unref(content);
+}
+
+static void destroy_batch(reporting_batch_t *batch) {
+	bctbx_list_free_with_data(batch->reports, ms_free);
+	ms_free(batch->collector_uri);
+	ms_free(batch);
+}
+
+static void stop_flush_timer(LinphoneCore *lc, reporting_collector_t *collector) {
+	if (collector->flush_timer) {
+		if (lc->sal)
+			lc->sal->cancelTimer(collector->flush_timer);
+		belle_sip_object_unref(collector->flush_timer);
+		collector->flush_timer = NULL;
+	}
+}
+
+static void flush_batches(LinphoneCore *lc, reporting_collector_t *collector) {
+	bctbx_list_t *batches = collector->batches;
+	bctbx_list_t *elem;
+
+	collector->batches = NULL;
+	stop_flush_timer(lc, collector);
+	for (elem = batches; elem != NULL; elem = elem->next) {
+		if (lc->sal) publish_batch(lc, (reporting_batch_t *)elem->data);
+		destroy_batch((reporting_batch_t *)elem->data);
+	}
+	bctbx_list_free(batches);
+}
+
+static int on_flush_timer(void *data, unsigned int revents) {
+	LinphoneCore *lc = (LinphoneCore *)data;
+	flush_batches(lc, get_collector(lc));
+	return BELLE_SIP_STOP;
+}
+
+/*queues an interval report, it is published with the other reports for the same collector when the batch delay
+expires or when the batch is full*/
+static void queue_report(LinphoneCore *lc, const char *collector_uri, const char *report, size_t size, int delay) {
+	reporting_collector_t *collector = get_collector(lc);
+	reporting_batch_t *batch = NULL;
+	bctbx_list_t *elem;
+	int max_reports = lp_config_get_int(lc->config, "misc", "quality_reporting_batch_max_reports", 32);
+
+	for (elem = collector->batches; elem != NULL; elem = elem->next) {
+		if (strcmp(((reporting_batch_t *)elem->data)->collector_uri, collector_uri) == 0) {
+			batch = (reporting_batch_t *)elem->data;
+			break;
+		}
+	}
+	if (batch == NULL) {
+		batch = ms_new0(reporting_batch_t, 1);
+		batch->collector_uri = ms_strdup(collector_uri);
+		collector->batches = bctbx_list_append(collector->batches, batch);
+	}
+	batch->reports = bctbx_list_append(batch->reports, ms_strdup(report));
+	batch->count++;
+	batch->size += size;
+
+	if (batch->count >= max_reports) {
+		collector->batches = bctbx_list_remove(collector->batches, batch);
+		publish_batch(lc, batch);
+		destroy_batch(batch);
+		if (collector->batches == NULL) stop_flush_timer(lc, collector);
+	} else if (collector->flush_timer == NULL) {
+		collector->flush_timer = lc->sal->createTimer(on_flush_timer, lc, (unsigned int)delay, "quality reporting batch");
+	}
+}
+
 static void reset_avg_metrics(reporting_session_report_t * report){
 	int i;
 	reporting_content_metrics_t * metrics[2] = {&report->local_metrics, &report->remote_metrics};
@@ -275,16 +480,16 @@ static void append_metrics_to_buffer(char ** buffer, size_t * size, size_t * off
 }
 
 static int send_report(LinphoneCall* call, reporting_session_report_t * report, const char * report_event) {
+	LinphoneCore *lc = linphone_call_get_core(call);
+	reporting_collector_t *collector;
 	LinphoneContent *content;
 	size_t offset = 0;
-	size_t size = 2048;
-	char * buffer;
+	char ** buffer;
+	size_t * size;
 	int ret = 0;
-	LinphoneEvent *lev;
-	LinphoneAddress *request_uri;
+	int batch_delay;
 	const char* collector_uri;
 	char *collector_uri_allocated = NULL;
-	const SalAddress *salAddress;
 
 	/*if we are on a low bandwidth network, do not send reports to not overload it*/
 	if (linphone_call_params_low_bandwidth_enabled(linphone_call_get_current_params(call))){
@@ -307,42 +512,45 @@ static int send_report(LinphoneCall* call, reporting_session_report_t * report,
 		goto end;
 	}
 
-	buffer = (char *) ms_malloc0(size);
+	collector = get_collector(lc);
+	reserve_buffer(collector, report_size_bound(report, report_event));
+	buffer = &collector->buffer;
+	size = &collector->buffer_size;
 	content = linphone_content_new();
 	linphone_content_set_type(content, "application");
 	linphone_content_set_subtype(content, "vq-rtcpxr");
 
-	append_to_buffer(&buffer, &size, &offset, "%s\r\n", report_event);
-	append_to_buffer(&buffer, &size, &offset, "CallID: %s\r\n", report->info.call_id);
-	append_to_buffer(&buffer, &size, &offset, "LocalID: %s\r\n", report->info.local_addr.id);
-	append_to_buffer(&buffer, &size, &offset, "RemoteID: %s\r\n", report->info.remote_addr.id);
-	append_to_buffer(&buffer, &size, &offset, "OrigID: %s\r\n", report->info.orig_id);
+	append_to_buffer(buffer, size, &offset, "%s\r\n", report_event);
+	append_to_buffer(buffer, size, &offset, "CallID: %s\r\n", report->info.call_id);
+	append_to_buffer(buffer, size, &offset, "LocalID: %s\r\n", report->info.local_addr.id);
+	append_to_buffer(buffer, size, &offset, "RemoteID: %s\r\n", report->info.remote_addr.id);
+	append_to_buffer(buffer, size, &offset, "OrigID: %s\r\n", report->info.orig_id);
 
-	APPEND_IF_NOT_NULL_STR(&buffer, &size, &offset, "LocalGroup: %s\r\n", report->info.local_addr.group);
-	APPEND_IF_NOT_NULL_STR(&buffer, &size, &offset, "RemoteGroup: %s\r\n", report->info.remote_addr.group);
-	append_to_buffer(&buffer, &size, &offset, "LocalAddr: IP=%s PORT=%d SSRC=%u\r\n", report->info.local_addr.ip, report->info.local_addr.port, report->info.local_addr.ssrc);
-	APPEND_IF_NOT_NULL_STR(&buffer, &size, &offset, "LocalMAC: %s\r\n", report->info.local_addr.mac);
-	append_to_buffer(&buffer, &size, &offset, "RemoteAddr: IP=%s PORT=%d SSRC=%u\r\n", report->info.remote_addr.ip, report->info.remote_addr.port, report->info.remote_addr.ssrc);
-	APPEND_IF_NOT_NULL_STR(&buffer, &size, &offset, "RemoteMAC: %s\r\n", report->info.remote_addr.mac);
+	APPEND_IF_NOT_NULL_STR(buffer, size, &offset, "LocalGroup: %s\r\n", report->info.local_addr.group);
+	APPEND_IF_NOT_NULL_STR(buffer, size, &offset, "RemoteGroup: %s\r\n", report->info.remote_addr.group);
+	append_to_buffer(buffer, size, &offset, "LocalAddr: IP=%s PORT=%d SSRC=%u\r\n", report->info.local_addr.ip, report->info.local_addr.port, report->info.local_addr.ssrc);
+	APPEND_IF_NOT_NULL_STR(buffer, size, &offset, "LocalMAC: %s\r\n", report->info.local_addr.mac);
+	append_to_buffer(buffer, size, &offset, "RemoteAddr: IP=%s PORT=%d SSRC=%u\r\n", report->info.remote_addr.ip, report->info.remote_addr.port, report->info.remote_addr.ssrc);
+	APPEND_IF_NOT_NULL_STR(buffer, size, &offset, "RemoteMAC: %s\r\n", report->info.remote_addr.mac);
 
-	append_to_buffer(&buffer, &size, &offset, "LocalMetrics:\r\n");
-	append_metrics_to_buffer(&buffer, &size, &offset, &report->local_metrics);
+	append_to_buffer(buffer, size, &offset, "LocalMetrics:\r\n");
+	append_metrics_to_buffer(buffer, size, &offset, &report->local_metrics);
 
 	if (are_metrics_filled(&report->remote_metrics)!=0) {
-		append_to_buffer(&buffer, &size, &offset, "RemoteMetrics:\r\n");
-		append_metrics_to_buffer(&buffer, &size, &offset, &report->remote_metrics);
+		append_to_buffer(buffer, size, &offset, "RemoteMetrics:\r\n");
+		append_metrics_to_buffer(buffer, size, &offset, &report->remote_metrics);
 	}
-	APPEND_IF_NOT_NULL_STR(&buffer, &size, &offset, "DialogID: %s\r\n", report->dialog_id);
+	APPEND_IF_NOT_NULL_STR(buffer, size, &offset, "DialogID: %s\r\n", report->dialog_id);
 
 	if (report->qos_analyzer.timestamp!=NULL){
-		append_to_buffer(&buffer, &size, &offset, "AdaptiveAlg:");
-			APPEND_IF_NOT_NULL_STR(&buffer, &size, &offset, " NAME=\"%s\"", report->qos_analyzer.name);
-			APPEND_IF_NOT_NULL_STR(&buffer, &size, &offset, " TS=\"%s\"", report->qos_analyzer.timestamp);
-			APPEND_IF_NOT_NULL_STR(&buffer, &size, &offset, " IN_LEG=\"%s\"", report->qos_analyzer.input_leg);
-			APPEND_IF_NOT_NULL_STR(&buffer, &size, &offset, " IN=\"%s\"", report->qos_analyzer.input);
-			APPEND_IF_NOT_NULL_STR(&buffer, &size, &offset, " OUT_LEG=\"%s\"", report->qos_analyzer.output_leg);
-			APPEND_IF_NOT_NULL_STR(&buffer, &size, &offset, " OUT=\"%s\"", report->qos_analyzer.output);
-		append_to_buffer(&buffer, &size, &offset, "\r\n");
+		append_to_buffer(buffer, size, &offset, "AdaptiveAlg:");
+			APPEND_IF_NOT_NULL_STR(buffer, size, &offset, " NAME=\"%s\"", report->qos_analyzer.name);
+			APPEND_IF_NOT_NULL_STR(buffer, size, &offset, " TS=\"%s\"", report->qos_analyzer.timestamp);
+			APPEND_IF_NOT_NULL_STR(buffer, size, &offset, " IN_LEG=\"%s\"", report->qos_analyzer.input_leg);
+			APPEND_IF_NOT_NULL_STR(buffer, size, &offset, " IN=\"%s\"", report->qos_analyzer.input);
+			APPEND_IF_NOT_NULL_STR(buffer, size, &offset, " OUT_LEG=\"%s\"", report->qos_analyzer.output_leg);
+			APPEND_IF_NOT_NULL_STR(buffer, size, &offset, " OUT=\"%s\"", report->qos_analyzer.output);
+		append_to_buffer(buffer, size, &offset, "\r\n");
 	}
 
 #if TARGET_OS_IPHONE
@@ -352,12 +560,11 @@ static int send_report(LinphoneCall* call, reporting_session_report_t * report,
 		sysctlbyname("hw.machine", NULL, &namesize, NULL, 0);
 		machine = reinterpret_cast<char *>(malloc(namesize));
 		sysctlbyname("hw.machine", machine, &namesize, NULL, 0);
-		APPEND_IF_NOT_NULL_STR(&buffer, &size, &offset, "Device: %s\r\n", machine);
+		APPEND_IF_NOT_NULL_STR(buffer, size, &offset, "Device: %s\r\n", machine);
 	}
 #endif
 
-	linphone_content_set_buffer(content, (uint8_t *)buffer, strlen(buffer));
-	ms_free(buffer);
+	linphone_content_set_buffer(content, (uint8_t *)*buffer, offset);
 
 	if (linphone_call_get_log(call)->reporting.on_report_sent != NULL) {
 		SalStreamType type = report == linphone_call_get_log(call)->reporting.reports[0] ? SalAudio : report == linphone_call_get_log(call)->reporting.reports[1] ? SalVideo : SalText;
@@ -369,24 +576,14 @@ static int send_report(LinphoneCall* call, reporting_session_report_t * report,
 	if (!collector_uri){
 		collector_uri = collector_uri_allocated = ms_strdup_printf("sip:%s", linphone_proxy_config_get_domain(linphone_call_get_dest_proxy(call)));
 	}
-	request_uri = linphone_address_new(collector_uri);
-	lev = linphone_core_create_one_shot_publish(linphone_call_get_core(call), request_uri, "vq-rtcpxr");
-	/* Special exception for quality report PUBLISH: if the collector_uri has any transport related parameters
-	 * (port, transport, maddr), then it is sent directly.
-	 * Otherwise it is routed as any LinphoneEvent publish, following proxy config policy.
-	 **/
-	salAddress = L_GET_PRIVATE_FROM_C_OBJECT(request_uri)->getInternalAddress();
-	if (sal_address_has_uri_param(salAddress, "transport") ||
-		sal_address_has_uri_param(salAddress, "maddr") ||
-		linphone_address_get_port(request_uri) != 0) {
-		ms_message("Publishing report with custom route %s", collector_uri);
-		lev->op->setRoute(collector_uri);
-	}
-
-	if (linphone_event_send_publish(lev, content) != 0){
-		lev=NULL;
+	/*interval reports of all the calls may be grouped to save PUBLISH transactions, session reports are sent right away*/
+	batch_delay = lp_config_get_int(lc->config, "misc", "quality_reporting_batch_delay", 0);
+	if (batch_delay > 0 && strcmp(report_event, "VQIntervalReport") == 0) {
+		queue_report(lc, collector_uri, *buffer, offset, batch_delay);
+	} else if (publish_to_collector(lc, collector_uri, content) != 0) {
 		ret=4;
-	} else {
+	}
+	if (ret == 0) {
 		reset_avg_metrics(report);
 		STR_REASSIGN(report->qos_analyzer.timestamp, NULL);
 		STR_REASSIGN(report->qos_analyzer.input_leg, NULL);
@@ -395,7 +592,6 @@ static int send_report(LinphoneCall* call, reporting_session_report_t * report,
 		STR_REASSIGN(report->qos_analyzer.output, NULL);
 	}
 
-	linphone_address_unref(request_uri);
 	linphone_content_unref(content);
 	if (collector_uri_allocated) ms_free(collector_uri_allocated);
 
@@ -825,3 +1021,13 @@ void linphone_reporting_destroy(reporting_session_report_t * report) {
 void linphone_reporting_set_on_report_send(LinphoneCall *call, LinphoneQualityReportingReportSendCb cb){
 	linphone_call_get_log(call)->reporting.on_report_sent = cb;
 }
+
+void linphone_reporting_collector_destroy(LinphoneCore *lc) {
+	reporting_collector_t *collector = lc->reporting_collector;
+	if (collector == NULL) return;
+
+	flush_batches(lc, collector);
+	if (collector->buffer) ms_free(collector->buffer);
+	ms_free(collector);
+	lc->reporting_collector = NULL;
+}
@@ -142,6 +142,11 @@ typedef struct reporting_session_report {
 } reporting_session_report_t;
 
 
+/**
+ * Per core buffer and pending interval reports, see linphone_reporting_collector_destroy().
+ */
+typedef struct _QualityReportingCollector reporting_collector_t;
+
 typedef void (*LinphoneQualityReportingReportSendCb)(const LinphoneCall *call, SalStreamType stream_type, const LinphoneContent *content);
 
 reporting_session_report_t * linphone_reporting_new(void);
@@ -209,6 +214,14 @@ void linphone_reporting_call_state_updated(LinphoneCall *call);
  */
 LINPHONE_PUBLIC void linphone_reporting_set_on_report_send(LinphoneCall *call, LinphoneQualityReportingReportSendCb cb);
 
+/**
+ * Publish the interval reports still waiting to be batched, if the [misc] quality_reporting_batch_delay
+ * setting is enabled, and release the buffer used to build the reports. Must be called before the sal is destroyed.
+ * @param lc #LinphoneCore object to consider
+ *
+ */
+void linphone_reporting_collector_destroy(LinphoneCore *lc);
+
 #ifdef __cplusplus
 }
 #endif
@@ -21,11 +21,16 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "private.h"
 
 #include "call/call-p.h"
+#include "chat/chat-message/chat-message-broadcast.h"
 #include "chat/chat-room/chat-room-p.h"
+#include "chat/encryption/legacy-encryption-engine.h"
+#include "content/content-type.h"
+#include "content/content.h"
 #include "core/core-p.h"
 #include "c-wrapper/c-wrapper.h"
 #include "conference/session/media-session-p.h"
 #include "event-log/conference/conference-chat-message-event.h"
+#include "nat/network-topology-cache.h"
 
 using namespace std;
 
@@ -55,12 +60,34 @@ LinphoneCoreCbs *linphone_core_get_first_callbacks(const LinphoneCore *lc) {
 	return ((VTableReference *)lc->vtable_refs->data)->cbs;
 }
 
+void _linphone_core_notify_call_stats_updated(LinphoneCore *lc, LinphoneCall *call, const LinphoneCallStats *stats) {
+	linphone_core_notify_call_stats_updated(lc, call, stats);
+}
+
+void _linphone_core_use_legacy_encryption_engine(LinphoneCore *lc) {
+	shared_ptr<Core> core = L_GET_CPP_PTR_FROM_C_OBJECT(lc);
+	core->setEncryptionEngine(new LegacyEncryptionEngine(core));
+}
+
+bool_t _linphone_core_network_topology_has_local_address(const LinphoneCore *lc, int family) {
+	return L_GET_PRIVATE_FROM_C_OBJECT(lc)->networkTopologyCache->isLocalAddressCached(family);
+}
+
+bool_t _linphone_core_network_topology_has_stun_server_address(const LinphoneCore *lc, LinphoneNatPolicy *policy) {
+	return L_GET_PRIVATE_FROM_C_OBJECT(lc)->networkTopologyCache->isStunServerAddressCached(policy);
+}
+
+int _linphone_core_network_topology_get_reflexive_address_count(const LinphoneCore *lc) {
+	return (int)L_GET_PRIVATE_FROM_C_OBJECT(lc)->networkTopologyCache->getReflexiveAddressCount();
+}
+
 bctbx_list_t **linphone_core_get_call_logs_attribute(LinphoneCore *lc) {
 	return &lc->call_logs;
 }
 
 void linphone_core_cbs_set_auth_info_requested(LinphoneCoreCbs *cbs, LinphoneCoreAuthInfoRequestedCb cb) {
 	cbs->vtable->auth_info_requested = cb;
+	_linphone_core_cbs_changed();
 }
 
 LinphoneQualityReporting *linphone_call_log_get_quality_reporting(LinphoneCallLog *call_log) {
@@ -176,6 +203,55 @@ LinphoneChatMessage * _linphone_chat_room_get_first_transient_message (const Lin
 	return L_GET_C_BACK_PTR(event->getChatMessage());
 }
 
+struct _LinphoneChatMessageBroadcast {
+	shared_ptr<ChatMessageBroadcast> broadcast;
+	LinphoneChatMessageBroadcastStatus status;
+};
+
+static void _linphone_chat_message_broadcast_update_status (LinphoneChatMessageBroadcast *broadcast) {
+	const ChatMessageBroadcast::Status &status = broadcast->broadcast->getStatus();
+	broadcast->status.total = (int)status.total;
+	broadcast->status.queued = (int)status.queued;
+	broadcast->status.in_progress = (int)status.inProgress;
+	broadcast->status.delivered = (int)status.delivered;
+	broadcast->status.not_delivered = (int)status.notDelivered;
+	broadcast->status.done = broadcast->broadcast->isDone() ? 1 : 0;
+}
+
+LinphoneChatMessageBroadcast *_linphone_core_broadcast_text_message (LinphoneCore *lc, const char *text, const bctbx_list_t *peers) {
+	list<IdentityAddress> peerAddresses;
+	for (const bctbx_list_t *it = peers; it; it = bctbx_list_next(it))
+		peerAddresses.push_back(IdentityAddress(*L_GET_CPP_PTR_FROM_C_OBJECT(static_cast<const LinphoneAddress *>(bctbx_list_get_data(it)))));
+
+	Content content;
+	content.setContentType(ContentType::PlainText);
+	content.setBody(L_C_TO_STRING(text));
+
+	LinphoneChatMessageBroadcast *broadcast = new LinphoneChatMessageBroadcast();
+	broadcast->broadcast = L_GET_CPP_PTR_FROM_C_OBJECT(lc)->broadcastChatMessage(content, peerAddresses);
+	_linphone_chat_message_broadcast_update_status(broadcast);
+	broadcast->broadcast->setStatusChangedCallback([broadcast](const ChatMessageBroadcast::Status &) {
+		_linphone_chat_message_broadcast_update_status(broadcast);
+	});
+	return broadcast;
+}
+
+bctbx_list_t *_linphone_chat_message_broadcast_get_chat_messages (const LinphoneChatMessageBroadcast *broadcast) {
+	bctbx_list_t *messages = nullptr;
+	for (const auto &message : broadcast->broadcast->getChatMessages())
+		messages = bctbx_list_append(messages, L_GET_C_BACK_PTR(message));
+	return messages;
+}
+
+LinphoneChatMessageBroadcastStatus *_linphone_chat_message_broadcast_get_status (LinphoneChatMessageBroadcast *broadcast) {
+	return &broadcast->status;
+}
+
+void _linphone_chat_message_broadcast_free (LinphoneChatMessageBroadcast *broadcast) {
+	broadcast->broadcast->setStatusChangedCallback(nullptr);
+	delete broadcast;
+}
+
 char * linphone_core_get_device_identity(LinphoneCore *lc) {
 	char *identity = NULL;
 	LinphoneProxyConfig *proxy = linphone_core_get_default_proxy_config(lc);
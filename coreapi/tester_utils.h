@@ -36,6 +36,20 @@ typedef struct _SalOp SalOp;
 
 typedef struct _LinphoneQualityReporting LinphoneQualityReporting;
 
+/* Run of Core::broadcastChatMessage(). */
+typedef struct _LinphoneChatMessageBroadcast LinphoneChatMessageBroadcast;
+
+/* Copy of the status of a broadcast, kept up to date from the core main loop. */
+typedef struct _LinphoneChatMessageBroadcastStatus {
+	int total;
+	int queued;
+	int in_progress;
+	int delivered;
+	int not_delivered;
+	/* 1 once each message is delivered or not delivered. */
+	int done;
+} LinphoneChatMessageBroadcastStatus;
+
 typedef enum _LinphoneProxyConfigAddressComparisonResult{
 	LinphoneProxyConfigAddressDifferent,
 	LinphoneProxyConfigAddressEqual,
@@ -58,14 +72,24 @@ LINPHONE_PUBLIC IceSession * linphone_call_get_ice_session(const LinphoneCall *c
 LINPHONE_PUBLIC const struct addrinfo *linphone_core_get_stun_server_addrinfo(LinphoneCore *lc);
 LINPHONE_PUBLIC void linphone_core_enable_send_call_stats_periodical_updates(LinphoneCore *lc, bool_t enabled);
 
-LINPHONE_PUBLIC int linphone_run_stun_tests(LinphoneCore *lc, int audioPort, int videoPort, int textPort,
-	char *audioCandidateAddr, int *audioCandidatePort, char *videoCandidateAddr, int *videoCandidatePort, char *textCandidateAddr, int *textCandidatePort);
+/* Called from the core main loop with the round trip time in milliseconds, or -1 if the discovery failed. */
+typedef void (*LinphoneStunTestsDoneCb)(LinphoneCore *lc, int ping_time, const char *audio_candidate_addr, int audio_candidate_port,
+	const char *video_candidate_addr, int video_candidate_port, const char *text_candidate_addr, int text_candidate_port, void *user_data);
+/* Starts a STUN discovery without blocking, returns -1 if it could not be started, in which case cb is not called. */
+LINPHONE_PUBLIC int linphone_run_stun_tests(LinphoneCore *lc, int audioPort, int videoPort, int textPort, LinphoneStunTestsDoneCb cb, void *user_data);
 LINPHONE_PUBLIC void linphone_core_enable_short_turn_refresh(LinphoneCore *lc, bool_t enable);
 
 LINPHONE_PUBLIC void linphone_core_set_zrtp_cache_db(LinphoneCore *lc, sqlite3 *cache_db);
 
 LINPHONE_PUBLIC LinphoneCoreCbs *linphone_core_get_first_callbacks(const LinphoneCore *lc);
 LINPHONE_PUBLIC void _linphone_core_add_callbacks(LinphoneCore *lc, LinphoneCoreCbs *vtable, bool_t internal);
+LINPHONE_PUBLIC void _linphone_core_notify_call_stats_updated(LinphoneCore *lc, LinphoneCall *call, const LinphoneCallStats *stats);
+/* Makes the file transfers go through the callbacks of the LinphoneImEncryptionEngine set on the core. */
+LINPHONE_PUBLIC void _linphone_core_use_legacy_encryption_engine(LinphoneCore *lc);
+/* What the network topology cache of the core currently holds. */
+LINPHONE_PUBLIC bool_t _linphone_core_network_topology_has_local_address(const LinphoneCore *lc, int family);
+LINPHONE_PUBLIC bool_t _linphone_core_network_topology_has_stun_server_address(const LinphoneCore *lc, LinphoneNatPolicy *policy);
+LINPHONE_PUBLIC int _linphone_core_network_topology_get_reflexive_address_count(const LinphoneCore *lc);
 
 LINPHONE_PUBLIC bctbx_list_t * linphone_core_read_call_logs_from_config_file(LinphoneCore *lc);
 LINPHONE_PUBLIC bctbx_list_t **linphone_core_get_call_logs_attribute(LinphoneCore *lc);
@@ -109,6 +133,13 @@ LINPHONE_PUBLIC void _linphone_chat_room_enable_migration(LinphoneChatRoom *cr,
 LINPHONE_PUBLIC int _linphone_chat_room_get_transient_message_count (const LinphoneChatRoom *cr);
 LINPHONE_PUBLIC LinphoneChatMessage * _linphone_chat_room_get_first_transient_message (const LinphoneChatRoom *cr);
 
+/* Sends the text to each of the peers, a list of LinphoneAddress. To be freed with _linphone_chat_message_broadcast_free(). */
+LINPHONE_PUBLIC LinphoneChatMessageBroadcast *_linphone_core_broadcast_text_message (LinphoneCore *lc, const char *text, const bctbx_list_t *peers);
+/* The messages of the broadcast, the list is to be freed with bctbx_list_free(). */
+LINPHONE_PUBLIC bctbx_list_t *_linphone_chat_message_broadcast_get_chat_messages (const LinphoneChatMessageBroadcast *broadcast);
+LINPHONE_PUBLIC LinphoneChatMessageBroadcastStatus *_linphone_chat_message_broadcast_get_status (LinphoneChatMessageBroadcast *broadcast);
+LINPHONE_PUBLIC void _linphone_chat_message_broadcast_free (LinphoneChatMessageBroadcast *broadcast);
+
 LINPHONE_PUBLIC MSList* linphone_core_fetch_friends_from_db(LinphoneCore *lc, LinphoneFriendList *list);
 LINPHONE_PUBLIC MSList* linphone_core_fetch_friends_lists_from_db(LinphoneCore *lc);
 LINPHONE_PUBLIC void linphone_friend_invalidate_subscription(LinphoneFriend *lf);
@@ -122,6 +153,7 @@ LINPHONE_PUBLIC LinphoneFriendList *linphone_friend_get_friend_list(const Linpho
 LINPHONE_PUBLIC bctbx_list_t **linphone_friend_list_get_friends_attribute(LinphoneFriendList *lfl);
 LINPHONE_PUBLIC const bctbx_list_t *linphone_friend_list_get_dirty_friends_to_update(const LinphoneFriendList *lfl);
 LINPHONE_PUBLIC int linphone_friend_list_get_revision(const LinphoneFriendList *lfl);
+LINPHONE_PUBLIC void linphone_friend_list_notify_presence_received(LinphoneFriendList *list, LinphoneEvent *lev, const LinphoneContent *body);
 
 LINPHONE_PUBLIC int linphone_remote_provisioning_load_file( LinphoneCore* lc, const char* file_path);
 
@@ -18,6 +18,9 @@ along with this program; if not, write to the Free Software
 Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 */
 
+#include <atomic>
+#include <vector>
+
 #include "c-wrapper/c-wrapper.h"
 #include "core/core-p.h"
 
@@ -46,6 +49,72 @@ LinphoneCoreVTable *linphone_core_get_current_vtable(LinphoneCore *lc) {
 	else return NULL;
 }
 
+/*
+ * Index of the references subscribed to each callback of the vtable, a callback being identified by its position in
+ * LinphoneCoreVTable. It is rebuilt when references are added or removed, or when a callback of any LinphoneCoreCbs
+ * is set, so that notifying an event only walks through the references that have a function for it.
+ */
+struct _VTableSubscribers {
+	static const size_t SlotCount = sizeof(LinphoneCoreVTable) / sizeof(void *);
+
+	std::vector<VTableReference *> refs[SlotCount];
+	unsigned int cbsGeneration = 0;
+	bool valid = false;
+};
+
+#define VTABLE_SLOT(function_name) (offsetof(LinphoneCoreVTable, function_name) / sizeof(void *))
+
+/* A LinphoneCoreCbs may be shared by cores iterated from different threads, the callback it sets is read after the generation. */
+static std::atomic<unsigned int> core_cbs_generation(0);
+
+void _linphone_core_cbs_changed(void) {
+	core_cbs_generation.fetch_add(1, std::memory_order_release);
+}
+
+void v_table_subscribers_destroy(VTableSubscribers *subscribers) {
+	delete subscribers;
+}
+
+static void invalidate_vtable_subscribers(LinphoneCore *lc) {
+	if (lc->vtable_subscribers) lc->vtable_subscribers->valid = false;
+}
+
+static bool_t v_table_has_function(const LinphoneCoreVTable *vtable, size_t slot) {
+	void (*function)(void);
+	memcpy(&function, reinterpret_cast<const char *>(vtable) + slot * sizeof(void *), sizeof(function));
+	return function != NULL;
+}
+
+/*
+ * Returns NULL if the index is outdated and a notification is in progress: its vectors may be iterated by the
+ * enclosing notification, the caller must scan the whole list of references instead.
+ */
+static VTableSubscribers *get_vtable_subscribers(LinphoneCore *lc) {
+	VTableSubscribers *subscribers = lc->vtable_subscribers;
+	unsigned int cbsGeneration = core_cbs_generation.load(std::memory_order_acquire);
+	if (subscribers && subscribers->valid && subscribers->cbsGeneration == cbsGeneration)
+		return subscribers;
+	if (lc->vtable_notify_recursion > 0)
+		return NULL;
+
+	if (!subscribers)
+		subscribers = lc->vtable_subscribers = new VTableSubscribers;
+	for (auto &refs : subscribers->refs)
+		refs.clear();
+	for (bctbx_list_t *it = lc->vtable_refs; it != NULL; it = it->next) {
+		VTableReference *ref = (VTableReference *)it->data;
+		if (!ref->valid) continue;
+		for (size_t slot = 0; slot < VTableSubscribers::SlotCount; slot++) {
+			/* A vtable given to linphone_core_add_listener() belongs to the application that may change it at any time. */
+			if (!ref->cbs->autorelease || v_table_has_function(ref->cbs->vtable, slot))
+				subscribers->refs[slot].push_back(ref);
+		}
+	}
+	subscribers->cbsGeneration = cbsGeneration;
+	subscribers->valid = true;
+	return subscribers;
+}
+
 static void cleanup_dead_vtable_refs(LinphoneCore *lc){
 	bctbx_list_t *it,*next_it;
 
@@ -57,37 +126,46 @@ static void cleanup_dead_vtable_refs(LinphoneCore *lc){
 			lc->vtable_refs=bctbx_list_erase_link(lc->vtable_refs, it);
 			belle_sip_object_unref(ref->cbs);
 			ms_free(ref);
+			invalidate_vtable_subscribers(lc);
 		}
 		it=next_it;
 	}
 }
 
-#define NOTIFY_IF_EXIST(function_name, ...) \
-	if (lc->is_unreffing) return; /* This is to prevent someone from taking a ref in a callback called while the Core is being destroyed after last unref */ \
-	bctbx_list_t* iterator; \
-	VTableReference *ref; \
+#define NOTIFY_REFERENCE(function_name, condition, ...) \
+	if (ref->valid && (lc->current_cbs=ref->cbs)->vtable->function_name && (condition)) {\
+		lc->current_cbs->vtable->function_name(__VA_ARGS__);\
+		has_cb = TRUE;\
+	}
+
+#define NOTIFY_SUBSCRIBERS(function_name, condition, ...) \
 	bool_t has_cb = FALSE; \
+	VTableSubscribers *subscribers = get_vtable_subscribers(lc); \
 	lc->vtable_notify_recursion++;\
-	for (iterator=lc->vtable_refs; iterator!=NULL; iterator=iterator->next){\
-		if ((ref=(VTableReference*)iterator->data)->valid && (lc->current_cbs=ref->cbs)->vtable->function_name) {\
-			lc->current_cbs->vtable->function_name(__VA_ARGS__);\
-			has_cb = TRUE;\
+	if (subscribers) {\
+		/* References added meanwhile are not in the index and are notified of the next events only. */ \
+		const std::vector<VTableReference *> &refs = subscribers->refs[VTABLE_SLOT(function_name)]; \
+		for (size_t i = 0, count = refs.size(); i < count; i++) {\
+			VTableReference *ref = refs[i];\
+			NOTIFY_REFERENCE(function_name, condition, __VA_ARGS__)\
+		}\
+	} else {\
+		for (bctbx_list_t *iterator = lc->vtable_refs; iterator != NULL; iterator = iterator->next) {\
+			VTableReference *ref = (VTableReference *)iterator->data;\
+			NOTIFY_REFERENCE(function_name, condition, __VA_ARGS__)\
 		}\
 	}\
-	lc->vtable_notify_recursion--;\
+	lc->vtable_notify_recursion--;
+
+#define NOTIFY_IF_EXIST(function_name, ...) \
+	if (lc->is_unreffing) return; /* This is to prevent someone from taking a ref in a callback called while the Core is being destroyed after last unref */ \
+	NOTIFY_SUBSCRIBERS(function_name, TRUE, __VA_ARGS__) \
 	if (has_cb) ms_message("Linphone core [%p] notified [%s]",lc,#function_name)
 
 #define NOTIFY_IF_EXIST_INTERNAL(function_name, internal_val, ...) \
-	bctbx_list_t* iterator; \
-	VTableReference *ref; \
-	lc->vtable_notify_recursion++;\
 	bool_t internal_val_evaluation = (internal_val); \
-	for (iterator=lc->vtable_refs; iterator!=NULL; iterator=iterator->next){\
-		if ((ref=(VTableReference*)iterator->data)->valid && (lc->current_cbs=ref->cbs)->vtable->function_name && (ref->internal == internal_val_evaluation)) {\
-			lc->current_cbs->vtable->function_name(__VA_ARGS__);\
-		}\
-	}\
-	lc->vtable_notify_recursion--;
+	NOTIFY_SUBSCRIBERS(function_name, ref->internal == internal_val_evaluation, __VA_ARGS__) \
+	(void)has_cb;
 
 void linphone_core_notify_global_state_changed(LinphoneCore *lc, LinphoneGlobalState gstate, const char *message) {
 	L_GET_PRIVATE_FROM_C_OBJECT(lc)->notifyGlobalStateChanged(gstate);
@@ -356,6 +434,7 @@ void v_table_reference_destroy(VTableReference *ref){
 void _linphone_core_add_callbacks(LinphoneCore *lc, LinphoneCoreCbs *vtable, bool_t internal) {
 	ms_message("Core callbacks [%p] registered on core [%p]", vtable, lc);
 	lc->vtable_refs=bctbx_list_append(lc->vtable_refs,v_table_reference_new(vtable, internal));
+	invalidate_vtable_subscribers(lc);
 }
 
 void linphone_core_add_listener(LinphoneCore *lc, LinphoneCoreVTable *vtable){
@@ -136,3 +136,33 @@ void linphone_xml_xpath_context_init_carddav_ns(xmlparsing_context_t *xml_ctx) {
 		xmlXPathRegisterNs(xml_ctx->xpath_ctx, (const xmlChar*)"x1", (const xmlChar*)"http://calendarserver.org/ns/");
 	}
 }
+
+int linphone_xml_reader_next_child_element(xmlTextReaderPtr reader, int parent_depth) {
+	int ret;
+	while ((ret = xmlTextReaderRead(reader)) == 1) {
+		int depth = xmlTextReaderDepth(reader);
+		if (depth <= parent_depth) return 0; /* End of the parent element */
+		if ((depth == parent_depth + 1) && (xmlTextReaderNodeType(reader) == XML_READER_TYPE_ELEMENT)) return 1;
+	}
+	return (ret < 0) ? -1 : 0;
+}
+
+bool_t linphone_xml_reader_is_element(xmlTextReaderPtr reader, const char *ns, const char *name) {
+	const char *node_ns = (const char *)xmlTextReaderConstNamespaceUri(reader);
+	const char *node_name = (const char *)xmlTextReaderConstLocalName(reader);
+	if ((node_ns == NULL) || (node_name == NULL)) return FALSE;
+	return (strcmp(node_ns, ns) == 0) && ((name == NULL) || (strcmp(node_name, name) == 0));
+}
+
+char * linphone_xml_reader_get_text_content(xmlTextReaderPtr reader) {
+	xmlChar *text = xmlTextReaderReadString(reader);
+	if ((text != NULL) && (text[0] == '\0')) {
+		xmlFree(text);
+		text = NULL;
+	}
+	return (char *)text;
+}
+
+char * linphone_xml_reader_get_attribute(xmlTextReaderPtr reader, const char *attribute_name) {
+	return (char *)xmlTextReaderGetAttribute(reader, (const xmlChar *)attribute_name);
+}
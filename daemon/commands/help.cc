@@ -31,12 +31,10 @@ void HelpCommand::exec(Daemon *app, const string& args) {
 	const list<DaemonCommand*> &l = app->getCommandList();
 	bool found = false;
 	if (!args.empty()){
-		for (it = l.begin(); it != l.end(); ++it) {
-			if ((*it)->matches(args)){
-				ost << (*it)->getHelp();
-				found = true;
-				break;
-			}
+		DaemonCommand *command = app->findCommand(args);
+		if (command) {
+			ost << command->getHelp();
+			found = true;
 		}
 	}
 	
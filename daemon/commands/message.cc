@@ -62,7 +62,7 @@ void MessageCommand::exec(Daemon *app, const std::string &args){
 
 void MessageCommand::sMsgStateChanged(LinphoneChatMessage *msg, LinphoneChatMessageState state){
 	Daemon *app = (Daemon*) linphone_chat_message_get_user_data(msg);
-	app->queueEvent(new OutgoingMessageEvent(msg));
+	if (app->isEventWanted("message-state-changed")) app->queueEvent(new OutgoingMessageEvent(msg));
 }
 
 
@@ -0,0 +1,69 @@
+/*
+metrics.cc
+Copyright (C) 2018 Belledonne Communications, Grenoble, France
+
+This library is free software; you can redistribute it and/or modify it
+under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or (at
+your option) any later version.
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation,
+Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#include "metrics.h"
+
+using namespace std;
+
+MetricsCommand::MetricsCommand() :
+		DaemonCommand("metrics", "metrics [enable|disable|reset]",
+			"Show the metrics collected on the hot paths of the library, or enable, disable or reset them.\n"
+			"Each line of the report is a counter, a gauge or a latency histogram in microseconds.") {
+	addExample(new DaemonCommandExample("metrics enable",
+						"Status: Ok\n\n"
+						"Metrics: enabled"));
+	addExample(new DaemonCommandExample("metrics",
+						"Status: Ok\n\n"
+						"Metrics: enabled\n"
+						"counter chat.messages.sent 3\n"
+						"gauge core.calls 1\n"
+						"histogram core.iterate count=1500 sum_us=96000 min_us=12 max_us=4200 p50_us=63 p90_us=127 p99_us=1023"));
+}
+
+void MetricsCommand::exec(Daemon *app, const string& args) {
+	LinphoneCore *lc = app->getCore();
+	istringstream ist(args);
+	string action;
+	ist >> action;
+	if (!ist.fail()) {
+		if (action == "enable") {
+			linphone_core_enable_metrics(lc, TRUE);
+		} else if (action == "disable") {
+			linphone_core_enable_metrics(lc, FALSE);
+		} else if (action == "reset") {
+			linphone_core_reset_metrics(lc);
+		} else {
+			app->sendResponse(Response("Incorrect parameter.", Response::Error));
+			return;
+		}
+	}
+
+	ostringstream ost;
+	ost << "Metrics: " << (linphone_core_metrics_enabled(lc) ? "enabled" : "disabled");
+	if (action.empty()) {
+		char *report = linphone_core_get_metrics_report(lc);
+		ost << "\n" << report;
+		ms_free(report);
+	}
+	string body = ost.str();
+	// The report lines end with a newline, the response adds its own.
+	if (!body.empty() && body.back() == '\n')
+		body.pop_back();
+	app->sendResponse(Response(body, Response::Ok));
+}
@@ -21,7 +21,6 @@ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
 #include "call.h"
 #include <utility>
 using namespace std;
-#define VOIDPTR_TO_INT(p) ((int)(intptr_t)(p))
 
 void IncallPlayerStartCommand::onEof(LinphonePlayer *player){
 	pair<int, Daemon *> *callPlayingData = (pair<int, Daemon *> *)linphone_player_get_user_data(player);
@@ -90,7 +89,7 @@ void IncallPlayerStartCommand::exec(Daemon *app, const string& args) {
 	
 	pair<int, Daemon *> *callPlayingData = (pair<int, Daemon *> *)linphone_player_get_user_data(p);
 	if(callPlayingData) callPlayingData = new 	pair<int, Daemon *>({
-		VOIDPTR_TO_INT(linphone_call_get_user_data(call)),
+		app->updateCallId(call),
 		app
 	});
 	linphone_player_set_user_data(p, callPlayingData);
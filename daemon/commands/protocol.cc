@@ -0,0 +1,60 @@
+/*
+protocol.cc
+Copyright (C) 2018 Belledonne Communications, Grenoble, France
+
+This library is free software; you can redistribute it and/or modify it
+under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or (at
+your option) any later version.
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation,
+Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#include "protocol.h"
+
+using namespace std;
+
+ProtocolCommand::ProtocolCommand() :
+		DaemonCommand("protocol", "protocol [text|json]",
+			"Show or change the protocol used by this client.\n"
+			"'text' is the default protocol made of 'Status: ...' blocks.\n"
+			"With 'json', every message is preceded by its size as a 32 bits big endian integer. Commands are sent as "
+			"framed command lines, responses and events are received as framed JSON objects, and events are pushed as "
+			"soon as they happen instead of being popped with pop-event.\n"
+			"The response to this command still uses the former protocol.") {
+	addExample(new DaemonCommandExample("protocol json",
+						"Status: Ok\n\n"
+						"Protocol: json"));
+	addExample(new DaemonCommandExample("protocol",
+						"Status: Ok\n\n"
+						"Protocol: text"));
+}
+
+void ProtocolCommand::exec(Daemon *app, const string& args) {
+	DaemonClient *client = app->getCurrentClient();
+	istringstream ist(args);
+	string protocol;
+	ist >> protocol;
+	if (ist.fail()) {
+		protocol = (client->getProtocol() == DaemonClient::Json) ? "json" : "text";
+		app->sendResponse(Response("Protocol: " + protocol, Response::Ok));
+		return;
+	}
+	if (protocol != "text" && protocol != "json") {
+		app->sendResponse(Response("Incorrect parameter.", Response::Error));
+		return;
+	}
+	if (protocol == "json" && client->getFd() == (ortp_pipe_t)-1) {
+		app->sendResponse(Response("The json protocol is only available on the pipe.", Response::Error));
+		return;
+	}
+	app->sendResponse(Response("Protocol: " + protocol, Response::Ok));
+	client->setProtocol(protocol == "json" ? DaemonClient::Json : DaemonClient::Text);
+}
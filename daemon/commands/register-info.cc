@@ -84,11 +84,9 @@ void RegisterInfoCommand::exec(Daemon *app, const string& args) {
 	}
 	if (param == "ALL") {
 		RegisterInfoResponse response;
-		for (int i=1; i<=app->maxProxyId(); i++) {
-			::LinphoneProxyConfig *cfg = app->findProxy(i);
-			if (cfg != NULL) {
-				response.append(i, cfg);
-			}
+		const list<int> ids = app->getProxyIds();
+		for (list<int>::const_iterator it = ids.begin(); it != ids.end(); ++it) {
+			response.append(*it, app->findProxy(*it));
 		}
 		app->sendResponse(response);
 	} else {
@@ -76,11 +76,9 @@ void RegisterStatusCommand::exec(Daemon *app, const string& args) {
 	}
 	if (param.compare("ALL") == 0) {
 		RegisterStatusResponse response;
-		for (int i = 1; i <= app->maxProxyId(); i++) {
-			cfg = app->findProxy(i);
-			if (cfg != NULL) {
-				response.append(i, cfg);
-			}
+		const list<int> ids = app->getProxyIds();
+		for (list<int>::const_iterator it = ids.begin(); it != ids.end(); ++it) {
+			response.append(*it, app->findProxy(*it));
 		}
 		app->sendResponse(response);
 	} else {
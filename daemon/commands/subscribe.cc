@@ -0,0 +1,61 @@
+/*
+subscribe.cc
+Copyright (C) 2018 Belledonne Communications, Grenoble, France
+
+This library is free software; you can redistribute it and/or modify it
+under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or (at
+your option) any later version.
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation,
+Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#include "subscribe.h"
+
+using namespace std;
+
+SubscribeCommand::SubscribeCommand(const char *name, const char *proto, const char *help, bool subscribe) :
+		DaemonCommand(name, proto, help), mSubscribe(subscribe) {
+}
+
+void SubscribeCommand::exec(Daemon *app, const string& args) {
+	DaemonClient *client = app->getCurrentClient();
+	istringstream ist(args);
+	string eventType;
+	bool found = false;
+	while (ist >> eventType) {
+		if (mSubscribe) client->subscribe(eventType);
+		else client->unsubscribe(eventType);
+		found = true;
+	}
+	if (!found) {
+		app->sendResponse(Response("Missing parameter.", Response::Error));
+		return;
+	}
+	app->sendResponse(Response());
+}
+
+EventSubscribeCommand::EventSubscribeCommand() :
+		SubscribeCommand("event-subscribe", "event-subscribe <event-type>...|all",
+			"Only receive the events of the given types, on top of the ones already subscribed to.\n"
+			"A client receives every event until it subscribes to some of them. The events nobody subscribed to are "
+			"not even built.\n"
+			"<event-type> is one of call-state-changed, call-stats, call-playing-complete, receiving-tone, "
+			"audio-stream-stats, message-received or message-state-changed.", true) {
+	addExample(new DaemonCommandExample("event-subscribe call-state-changed receiving-tone",
+						"Status: Ok"));
+}
+
+EventUnsubscribeCommand::EventUnsubscribeCommand() :
+		SubscribeCommand("event-unsubscribe", "event-unsubscribe <event-type>...|all",
+			"Stop receiving the events of the given types.", false) {
+	addExample(new DaemonCommandExample("event-unsubscribe call-stats",
+						"Status: Ok"));
+}
@@ -44,11 +44,9 @@ void UnregisterCommand::exec(Daemon *app, const string& args) {
 		return;
 	}
 	if (param.compare("ALL") == 0) {
-		for (int i = 1; i <= app->maxProxyId(); i++) {
-			cfg = app->findProxy(i);
-			if (cfg != NULL) {
-				linphone_core_remove_proxy_config(app->getCore(), cfg);
-			}
+		const list<int> ids = app->getProxyIds();
+		for (list<int>::const_iterator it = ids.begin(); it != ids.end(); ++it) {
+			app->deleteProxy(app->findProxy(*it));
 		}
 	} else {
 		ist.clear();
@@ -63,7 +61,7 @@ void UnregisterCommand::exec(Daemon *app, const string& args) {
 			app->sendResponse(Response("No register with such id.", Response::Error));
 			return;
 		}
-		linphone_core_remove_proxy_config(app->getCore(), cfg);
+		app->deleteProxy(cfg);
 	}
 	app->sendResponse(Response());
 }
@@ -20,6 +20,8 @@ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
 #define _GNU_SOURCE
 #include <fcntl.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #ifndef _WIN32
 #include <poll.h>
@@ -31,15 +33,100 @@ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
 
 static int running=1;
 
+/* maximum number of requests sent ahead of their responses while benchmarking */
+#define BENCH_WINDOW 64
+
+static int read_full(ortp_pipe_t fd, uint8_t *buf, int len){
+	int done=0;
+	while (done<len){
+		int ret=ortp_pipe_read(fd,buf+done,len-done);
+		if (ret<=0) return -1;
+		done+=ret;
+	}
+	return done;
+}
+
+static int write_frame(ortp_pipe_t fd, const char *payload){
+	uint8_t header[4];
+	uint32_t size=(uint32_t)strlen(payload);
+	header[0]=(uint8_t)(size>>24);
+	header[1]=(uint8_t)(size>>16);
+	header[2]=(uint8_t)(size>>8);
+	header[3]=(uint8_t)size;
+	if (ortp_pipe_write(fd,header,4)<0) return -1;
+	return ortp_pipe_write(fd,(uint8_t*)payload,(int)size);
+}
+
+/* reads one frame of the json protocol and nul terminates it */
+static int read_frame(ortp_pipe_t fd, char *buf, int max){
+	uint8_t header[4];
+	int size;
+	if (read_full(fd,header,4)<0) return -1;
+	size=(int)(((uint32_t)header[0]<<24)|((uint32_t)header[1]<<16)|((uint32_t)header[2]<<8)|(uint32_t)header[3]);
+	if (size>=max){
+		ortp_error("Frame too big: %i bytes",size);
+		return -1;
+	}
+	if (read_full(fd,(uint8_t*)buf,size)<0) return -1;
+	buf[size]='\0';
+	return size;
+}
+
+/*
+ * Switches the connection to the framed json protocol and sends <count> times the same command, keeping up to
+ * BENCH_WINDOW requests in flight, to measure the throughput of the daemon.
+ */
+static int run_bench(ortp_pipe_t fd, int count, const char *command){
+	char buf[32768];
+	int sent=0,received=0,events=0,errors=0;
+	uint64_t begin,elapsed;
+	const char *switch_command="protocol json\n";
+
+	if (ortp_pipe_write(fd,(uint8_t*)switch_command,(int)strlen(switch_command))<0 || ortp_pipe_read(fd,(uint8_t*)buf,sizeof(buf)-1)<=0){
+		ortp_error("Could not switch to the json protocol");
+		return -1;
+	}
+	begin=ortp_get_cur_time_ms();
+	while (received<count){
+		while (sent<count && sent-received<BENCH_WINDOW){
+			char request[1024];
+			snprintf(request,sizeof(request),"@%i %s",sent,command);
+			if (write_frame(fd,request)<0){
+				ortp_error("Fail to write to unix socket");
+				return -1;
+			}
+			sent++;
+		}
+		if (read_frame(fd,buf,sizeof(buf))<0){
+			ortp_error("Connection lost after %i responses",received);
+			return -1;
+		}
+		if (strstr(buf,"\"type\":\"response\"")){
+			received++;
+			if (strstr(buf,"\"status\":\"error\"")) errors++;
+		}else events++;
+	}
+	elapsed=ortp_get_cur_time_ms()-begin;
+	fprintf(stdout,"%i commands in %i ms: %.0f commands/s, %i errors, %i events received\n",
+		count,(int)elapsed,elapsed>0 ? (count*1000.0)/(double)elapsed : 0.0,errors,events);
+	return 0;
+}
+
 int main(int argc, char *argv[]){
 	char buf[32768];
 	ortp_pipe_t fd;
+	int bench_count=0;
+	const char *bench_command="version";
 
 	/* handle args */
 	if (argc < 2) {
-		ortp_error("Usage: %s pipename", argv[0]);
+		ortp_error("Usage: %s pipename [--bench <count> [<command>]]", argv[0]);
 		return 1;
 	}
+	if (argc >= 4 && strcmp(argv[2],"--bench")==0){
+		bench_count=atoi(argv[3]);
+		if (argc >= 5) bench_command=argv[4];
+	}
 
 	ortp_init();
 	ortp_set_log_level_mask(NULL, ORTP_MESSAGE | ORTP_WARNING | ORTP_ERROR | ORTP_FATAL);
@@ -50,6 +137,12 @@ int main(int argc, char *argv[]){
 		return -1;
 	}
 
+	if (bench_count>0){
+		int ret=run_bench(fd,bench_count,bench_command);
+		ortp_client_pipe_close(fd);
+		return ret;
+	}
+
 #ifdef _WIN32
 	DWORD fdwMode, fdwOldMode;
 	HANDLE hin = GetStdHandle(STD_INPUT_HANDLE);
@@ -30,6 +30,7 @@ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
 #include <algorithm>
 #include <functional>
 #include <limits>
+#include <vector>
 
 #ifdef HAVE_READLINE
 #include <readline/readline.h>
@@ -37,12 +38,19 @@ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
 #endif
 
 #ifndef _WIN32
+#include <fcntl.h>
 #include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
 #endif
 
 #include "daemon.h"
 #include "commands/adaptive-jitter-compensation.h"
 #include "commands/jitterbuffer.h"
+#include "commands/metrics.h"
 #include "commands/answer.h"
 #include "commands/audio-codec-get.h"
 #include "commands/audio-codec-move.h"
@@ -71,10 +79,12 @@ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
 #include "commands/play-wav.h"
 #include "commands/pop-event.h"
 #include "commands/port.h"
+#include "commands/protocol.h"
 #include "commands/ptime.h"
 #include "commands/register.h"
 #include "commands/register-info.h"
 #include "commands/register-status.h"
+#include "commands/subscribe.h"
 #include "commands/terminate.h"
 #include "commands/unregister.h"
 #include "commands/quit.h"
@@ -89,9 +99,6 @@ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
 
 using namespace std;
 
-#define INT_TO_VOIDPTR(i) ((void*)(intptr_t)(i))
-#define VOIDPTR_TO_INT(p) ((int)(intptr_t)(p))
-
 #ifndef WIN32
 #else
 #include <windows.h>
@@ -270,6 +277,257 @@ PayloadTypeParser::PayloadTypeParser(LinphoneCore *core, const string &mime_type
 	}
 }
 
+#ifdef MSG_NOSIGNAL
+#define DAEMON_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define DAEMON_SEND_FLAGS 0
+#endif
+
+static const size_t sMaxClientOutputSize = 4 * 1024 * 1024;
+/*Events pushed to a framed client are dropped above this amount of unsent output, responses are still accepted.*/
+static const size_t sMaxClientEventOutputSize = 1024 * 1024;
+static const size_t sMaxFrameSize = 64 * 1024;
+
+static string jsonEscape(const string &str) {
+	ostringstream ostr;
+	for (string::const_iterator it = str.begin(); it != str.end(); ++it) {
+		unsigned char c = (unsigned char)*it;
+		switch (c) {
+			case '"': ostr << "\\\""; break;
+			case '\\': ostr << "\\\\"; break;
+			case '\n': ostr << "\\n"; break;
+			case '\r': ostr << "\\r"; break;
+			case '\t': ostr << "\\t"; break;
+			default:
+				if (c < 0x20) ostr << "\\u" << hex << setw(4) << setfill('0') << (int)c << dec;
+				else ostr << (char)c;
+				break;
+		}
+	}
+	return ostr.str();
+}
+
+/*Bodies are made of "Key: value" lines: each key becomes a member of the object, repeated keys become arrays and the lines
+that are not of this form are gathered in a "Text" member.*/
+static void appendJsonBody(ostringstream &ostr, const string &body) {
+	list<pair<string, list<string> > > fields;
+	string text;
+	istringstream ist(body);
+	string line;
+	while (getline(ist, line)) {
+		if (line.empty()) continue;
+		size_t pos = line.find(": ");
+		if (pos == string::npos || pos == 0) {
+			if (!text.empty()) text += "\n";
+			text += line;
+			continue;
+		}
+		string key = line.substr(0, pos);
+		list<pair<string, list<string> > >::iterator it = fields.begin();
+		while (it != fields.end() && it->first != key) ++it;
+		if (it == fields.end()) it = fields.insert(fields.end(), make_pair(key, list<string>()));
+		it->second.push_back(line.substr(pos + 2));
+	}
+	ostr << "{";
+	bool first = true;
+	for (list<pair<string, list<string> > >::const_iterator it = fields.begin(); it != fields.end(); ++it) {
+		ostr << (first ? "" : ",") << "\"" << jsonEscape(it->first) << "\":";
+		first = false;
+		if (it->second.size() == 1) {
+			ostr << "\"" << jsonEscape(it->second.front()) << "\"";
+		} else {
+			ostr << "[";
+			for (list<string>::const_iterator value = it->second.begin(); value != it->second.end(); ++value) {
+				ostr << (value == it->second.begin() ? "" : ",") << "\"" << jsonEscape(*value) << "\"";
+			}
+			ostr << "]";
+		}
+	}
+	if (!text.empty()) ostr << (first ? "" : ",") << "\"Text\":\"" << jsonEscape(text) << "\"";
+	ostr << "}";
+}
+
+static string frame(const string &payload) {
+	string buf;
+	uint32_t size = (uint32_t)payload.size();
+	buf.reserve(payload.size() + 4);
+	buf += (char)((size >> 24) & 0xff);
+	buf += (char)((size >> 16) & 0xff);
+	buf += (char)((size >> 8) & 0xff);
+	buf += (char)(size & 0xff);
+	buf += payload;
+	return buf;
+}
+
+string Response::toJson(const string &requestId) const {
+	ostringstream ostr;
+	ostr << "{\"type\":\"response\",\"status\":\"" << ((mStatus == Ok) ? "ok" : "error") << "\"";
+	if (!requestId.empty()) ostr << ",\"request-id\":\"" << jsonEscape(requestId) << "\"";
+	if (!mReason.empty()) ostr << ",\"reason\":\"" << jsonEscape(mReason) << "\"";
+	if (!mBody.empty()) {
+		ostr << ",\"body\":";
+		appendJsonBody(ostr, mBody);
+	}
+	ostr << "}";
+	return ostr.str();
+}
+
+const string &Event::toJson() const {
+	if (mJson.empty()) {
+		ostringstream ostr;
+		ostr << "{\"type\":\"event\",\"event\":\"" << jsonEscape(mEventType) << "\"";
+		if (!mBody.empty()) {
+			ostr << ",\"body\":";
+			appendJsonBody(ostr, mBody);
+		}
+		ostr << "}";
+		mJson = frame(ostr.str());
+	}
+	return mJson;
+}
+
+DaemonClient::DaemonClient(ortp_pipe_t fd, size_t maxEvents, Protocol protocol) :
+		mFd(fd), mMaxEvents(maxEvents), mDroppedEvents(0), mClosed(false), mProtocol(protocol), mAllEvents(true) {
+}
+
+void DaemonClient::subscribe(const string &eventType) {
+	if (eventType == "all") {
+		mAllEvents = true;
+		mSubscriptions.clear();
+		return;
+	}
+	mAllEvents = false;
+	mSubscriptions.insert(eventType);
+}
+
+void DaemonClient::unsubscribe(const string &eventType) {
+	if (eventType == "all") {
+		mAllEvents = false;
+		mSubscriptions.clear();
+		return;
+	}
+	mSubscriptions.erase(eventType);
+}
+
+bool DaemonClient::isSubscribed(const string &eventType) const {
+	return mAllEvents || mSubscriptions.find(eventType) != mSubscriptions.end();
+}
+
+void DaemonClient::pushEvent(const Event &ev) {
+	if (mOutput.size() > sMaxClientEventOutputSize) {
+		mDroppedEvents++;
+		return;
+	}
+	if (mDroppedEvents != 0) {
+		/*Lets the client know that it missed some events because it did not read fast enough.*/
+		ostringstream ostr;
+		ostr << "{\"type\":\"event\",\"event\":\"events-dropped\",\"body\":{\"Count\":\"" << mDroppedEvents << "\"}}";
+		mOutput += frame(ostr.str());
+		mDroppedEvents = 0;
+	}
+	mOutput += ev.toJson();
+}
+
+void DaemonClient::queueEvent(const shared_ptr<Event> &ev) {
+	if (mMaxEvents > 0 && mEvents.size() >= mMaxEvents) {
+		mEvents.pop_front();
+		mDroppedEvents++;
+	}
+	mEvents.push_back(ev);
+}
+
+shared_ptr<Event> DaemonClient::popEvent() {
+	shared_ptr<Event> ev;
+	if (!mEvents.empty()) {
+		ev = mEvents.front();
+		mEvents.pop_front();
+	}
+	return ev;
+}
+
+unsigned int DaemonClient::takeDroppedEvents() {
+	unsigned int dropped = mDroppedEvents;
+	mDroppedEvents = 0;
+	return dropped;
+}
+
+void DaemonClient::takeEventsFrom(DaemonClient *other) {
+	shared_ptr<Event> ev;
+	while ((ev = other->popEvent()) != NULL) {
+		queueEvent(ev);
+	}
+	mDroppedEvents += other->takeDroppedEvents();
+}
+
+void DaemonClient::feed(const char *data, size_t size) {
+	mInput.append(data, size);
+}
+
+bool DaemonClient::nextCommand(string &command) {
+	if (mProtocol == Json) {
+		if (mInput.size() < 4) return false;
+		const unsigned char *header = (const unsigned char *)mInput.data();
+		size_t size = ((size_t)header[0] << 24) | ((size_t)header[1] << 16) | ((size_t)header[2] << 8) | (size_t)header[3];
+		if (size > sMaxFrameSize) {
+			ms_error("Client sent a %u bytes frame, dropping it", (unsigned int)size);
+			mClosed = true;
+			mInput.clear();
+			return false;
+		}
+		if (mInput.size() < size + 4) return false;
+		command = mInput.substr(4, size);
+		mInput.erase(0, size + 4);
+		return true;
+	}
+	size_t pos;
+	while ((pos = mInput.find('\n')) != string::npos) {
+		size_t end = pos;
+		if (end > 0 && mInput[end - 1] == '\r') end--;
+		command = mInput.substr(0, end);
+		mInput.erase(0, pos + 1);
+		if (!command.empty()) return true;
+	}
+	return false;
+}
+
+bool DaemonClient::takePendingInput(string &command) {
+	if (mInput.empty() || mProtocol != Text) return false;
+	command.swap(mInput);
+	mInput.clear();
+	return true;
+}
+
+void DaemonClient::write(const string &buf) {
+	if (mOutput.size() + buf.size() > sMaxClientOutputSize) {
+		ms_error("Client does not read its responses, dropping it");
+		mClosed = true;
+		return;
+	}
+	mOutput += buf;
+}
+
+bool DaemonClient::flush() {
+	while (!mOutput.empty()) {
+#ifdef _WIN32
+		int ret = ortp_pipe_write(mFd, (uint8_t *)mOutput.data(), (int)mOutput.size());
+		if (ret == -1) {
+			ms_error("Fail to write to pipe: %s", strerror(errno));
+			return false;
+		}
+#else
+		ssize_t ret = send((int)mFd, mOutput.data(), mOutput.size(), DAEMON_SEND_FLAGS);
+		if (ret == -1) {
+			if (errno == EINTR) continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK) return true; /*will be resumed when the socket is writable again*/
+			ms_error("Fail to write to pipe: %s", strerror(errno));
+			return false;
+		}
+#endif
+		mOutput.erase(0, (size_t)ret);
+	}
+	return true;
+}
+
 DaemonCommandExample::DaemonCommandExample(const string& command, const string& output)
 	: mCommand(command), mOutput(output) {}
 
@@ -300,11 +558,15 @@ bool DaemonCommand::matches(const string& name) const {
 	return mName.compare(name) == 0;
 }
 
-Daemon::Daemon(const char *config_path, const char *factory_config_path, const char *log_file, const char *pipe_name, bool display_video, bool capture_video) :
-		mLSD(0), mLogFile(NULL), mAutoVideo(0), mCallIds(0), mProxyIds(0), mAudioStreamIds(0) {
+Daemon::Daemon(const char *config_path, const char *factory_config_path, const char *log_file, const char *pipe_name, bool display_video, bool capture_video, int max_clients, int event_queue_size, bool json) :
+		mLSD(0), mConsole((ortp_pipe_t)-1, (size_t)event_queue_size), mCurrentClient(NULL), mMaxClients((size_t)max_clients),
+		mEventQueueSize((size_t)event_queue_size), mDefaultProtocol(json ? DaemonClient::Json : DaemonClient::Text), mLogFile(NULL), mAutoVideo(0) {
 	ms_mutex_init(&mMutex, NULL);
 	mServerFd = (ortp_pipe_t)-1;
-	mChildFd = (ortp_pipe_t)-1;
+#ifndef _WIN32
+	mPollFd = -1;
+	mWakeFds[0] = mWakeFds[1] = -1;
+#endif
 	if (pipe_name == NULL) {
 #ifdef HAVE_READLINE
 		const char *homedir = getenv("HOME");
@@ -318,7 +580,30 @@ Daemon::Daemon(const char *config_path, const char *factory_config_path, const c
 	} else {
 		mServerFd = ortp_server_pipe_create(pipe_name);
 #ifndef _WIN32
-		listen(mServerFd, 2);
+		listen(mServerFd, (int)mMaxClients);
+		/*The wake pipe interrupts the wait for client activity when the daemon quits.*/
+		if (pipe(mWakeFds) == 0) {
+			fcntl(mWakeFds[0], F_SETFL, fcntl(mWakeFds[0], F_GETFL) | O_NONBLOCK);
+			fcntl(mWakeFds[1], F_SETFL, fcntl(mWakeFds[1], F_GETFL) | O_NONBLOCK);
+		} else {
+			mWakeFds[0] = mWakeFds[1] = -1;
+		}
+#ifdef __linux__
+		mPollFd = epoll_create1(EPOLL_CLOEXEC);
+		if (mPollFd == -1) {
+			ms_fatal("Cannot create epoll instance: %s", strerror(errno));
+		} else {
+			struct epoll_event ev;
+			memset(&ev, 0, sizeof(ev));
+			ev.events = EPOLLIN;
+			ev.data.fd = (int)mServerFd;
+			epoll_ctl(mPollFd, EPOLL_CTL_ADD, (int)mServerFd, &ev);
+			if (mWakeFds[0] != -1) {
+				ev.data.fd = mWakeFds[0];
+				epoll_ctl(mPollFd, EPOLL_CTL_ADD, mWakeFds[0], &ev);
+			}
+		}
+#endif
 		fprintf(stdout, "Server unix socket created, name=%s fd=%i\n", pipe_name, (int)mServerFd);
 #else
 		fprintf(stdout, "Named pipe  created, name=%s fd=%p\n", pipe_name, mServerFd);
@@ -338,6 +623,7 @@ Daemon::Daemon(const char *config_path, const char *factory_config_path, const c
 	vtable.call_stats_updated = callStatsUpdated;
 	vtable.dtmf_received = dtmfReceived;
 	vtable.message_received = messageReceived;
+	vtable.registration_state_changed = registrationStateChanged;
 	mLc = linphone_core_new(&vtable, config_path, factory_config_path, this);
 	linphone_core_set_user_data(mLc, this);
 	linphone_core_enable_video_capture(mLc,capture_video);
@@ -355,6 +641,11 @@ const list<DaemonCommand*> &Daemon::getCommandList() const {
 	return mCommands;
 }
 
+DaemonCommand *Daemon::findCommand(const string &name) const {
+	unordered_map<string, DaemonCommand*>::const_iterator it = mCommandsByName.find(name);
+	return it != mCommandsByName.end() ? it->second : NULL;
+}
+
 LinphoneCore *Daemon::getCore() {
 	return mLc;
 }
@@ -363,44 +654,41 @@ LinphoneSoundDaemon *Daemon::getLSD() {
 	return mLSD;
 }
 
+/*Calls leave the table when they are released, see callStateChanged().*/
 int Daemon::updateCallId(LinphoneCall *call) {
-	int val = VOIDPTR_TO_INT(linphone_call_get_user_data(call));
-	if (val == 0) {
-		linphone_call_set_user_data(call, INT_TO_VOIDPTR(++mCallIds));
-		return mCallIds;
-	}
-	return val;
+	return mCalls.add(call);
 }
 
 LinphoneCall *Daemon::findCall(int id) {
-	const bctbx_list_t *elem = linphone_core_get_calls(mLc);
-	for (; elem != NULL; elem = elem->next) {
-		LinphoneCall *call = (LinphoneCall *) elem->data;
-		if (VOIDPTR_TO_INT(linphone_call_get_user_data(call)) == id)
-			return call;
-	}
-	return NULL;
+	return mCalls.get(id);
 }
 
+/*The table holds a reference on the proxy configs so that an id never points to a freed one.*/
 int Daemon::updateProxyId(LinphoneProxyConfig *cfg) {
-	int val = VOIDPTR_TO_INT(linphone_proxy_config_get_user_data(cfg));
-	if (val == 0) {
-		linphone_proxy_config_set_user_data(cfg, INT_TO_VOIDPTR(++mProxyIds));
-		return mProxyIds;
+	int id = mProxies.find(cfg);
+	if (id == 0) {
+		id = mProxies.add(cfg);
+		if (id != 0) linphone_proxy_config_ref(cfg);
 	}
-	return val;
+	return id;
 }
 
 LinphoneProxyConfig *Daemon::findProxy(int id) {
-	const bctbx_list_t *elem = linphone_core_get_proxy_config_list(mLc);
-	for (; elem != NULL; elem = elem->next) {
-		LinphoneProxyConfig *proxy = (LinphoneProxyConfig *) elem->data;
-		if (VOIDPTR_TO_INT(linphone_proxy_config_get_user_data(proxy)) == id)
-			return proxy;
-	}
-	return NULL;
+	return mProxies.get(id);
 }
 
+void Daemon::removeProxy(LinphoneProxyConfig *cfg) {
+	if (mProxies.remove(cfg) != 0) linphone_proxy_config_unref(cfg);
+}
+
+/*Proxy configs removed by the daemon leave the table here, the ones removed by the core itself when their registration
+state changes, see registrationStateChanged().*/
+void Daemon::deleteProxy(LinphoneProxyConfig *cfg) {
+	linphone_core_remove_proxy_config(mLc, cfg);
+	removeProxy(cfg);
+}
+
+/*There is no callback telling when an auth info is added or removed, so these ids remain positions in the core list.*/
 LinphoneAuthInfo *Daemon::findAuthInfo(int id)  {
 	const bctbx_list_t *elem = linphone_core_get_auth_info_list(mLc);
 	if (elem == NULL || id < 1 || (unsigned int)id > bctbx_list_size(elem)) {
@@ -414,35 +702,34 @@ LinphoneAuthInfo *Daemon::findAuthInfo(int id)  {
 }
 
 int Daemon::updateAudioStreamId(AudioStream *audio_stream) {
-	for (map<int, AudioStreamAndOther*>::iterator it = mAudioStreams.begin(); it != mAudioStreams.end(); ++it) {
-		if (it->second->stream == audio_stream)
-			return it->first;
-	}
+	unordered_map<AudioStream*, int>::iterator it = mAudioStreamIds.find(audio_stream);
+	if (it != mAudioStreamIds.end())
+		return it->second;
 
-	++mAudioStreamIds;
-	mAudioStreams.insert(make_pair(mAudioStreamIds, new AudioStreamAndOther(audio_stream)));
-	return mAudioStreamIds;
+	AudioStreamAndOther *streamAndOther = new AudioStreamAndOther(audio_stream);
+	int id = mAudioStreams.add(streamAndOther);
+	if (id == 0) {
+		delete streamAndOther;
+		return 0;
+	}
+	mAudioStreamIds[audio_stream] = id;
+	return id;
 }
 
 AudioStreamAndOther *Daemon::findAudioStreamAndOther(int id) {
-	map<int, AudioStreamAndOther*>::iterator it = mAudioStreams.find(id);
-	if (it != mAudioStreams.end())
-		return it->second;
-	return NULL;
+	return mAudioStreams.get(id);
 }
 
 AudioStream *Daemon::findAudioStream(int id) {
-	map<int, AudioStreamAndOther*>::iterator it = mAudioStreams.find(id);
-	if (it != mAudioStreams.end())
-		return it->second->stream;
-	return NULL;
+	AudioStreamAndOther *streamAndOther = mAudioStreams.get(id);
+	return streamAndOther ? streamAndOther->stream : NULL;
 }
 
 void Daemon::removeAudioStream(int id) {
-	map<int, AudioStreamAndOther*>::iterator it = mAudioStreams.find(id);
-	if (it != mAudioStreams.end()) {
-		mAudioStreams.erase(it);
-		delete(it->second);
+	AudioStreamAndOther *streamAndOther = mAudioStreams.remove(id);
+	if (streamAndOther) {
+		mAudioStreamIds.erase(streamAndOther->stream);
+		delete streamAndOther;
 	}
 }
 
@@ -490,6 +777,7 @@ void Daemon::initCommands() {
 	mCommands.push_back(new AdaptiveBufferCompensationCommand());
 	mCommands.push_back(new JitterBufferCommand());
 	mCommands.push_back(new JitterBufferResetCommand());
+	mCommands.push_back(new MetricsCommand());
 	mCommands.push_back(new VersionCommand());
 	mCommands.push_back(new QuitCommand());
 	mCommands.push_back(new HelpCommand());
@@ -502,10 +790,17 @@ void Daemon::initCommands() {
 	mCommands.push_back(new IncallPlayerPauseCommand());
 	mCommands.push_back(new IncallPlayerResumeCommand());
 	mCommands.push_back(new MessageCommand());
+	mCommands.push_back(new ProtocolCommand());
+	mCommands.push_back(new EventSubscribeCommand());
+	mCommands.push_back(new EventUnsubscribeCommand());
 	mCommands.sort(compareCommands);
+	for (list<DaemonCommand*>::iterator it = mCommands.begin(); it != mCommands.end(); ++it) {
+		mCommandsByName[(*it)->getName()] = *it;
+	}
 }
 
 void Daemon::uninitCommands() {
+	mCommandsByName.clear();
 	while (!mCommands.empty()) {
 		delete mCommands.front();
 		mCommands.pop_front();
@@ -515,17 +810,18 @@ void Daemon::uninitCommands() {
 bool Daemon::pullEvent() {
 	bool status = false;
 	ostringstream ostr;
-	size_t size = mEventQueue.size();
+	DaemonClient *client = mCurrentClient ? mCurrentClient : &mConsole;
+	size_t size = client->getEventCount();
+	unsigned int dropped = client->takeDroppedEvents();
 	
 	if (size != 0) size--;
 	
 	ostr << "Size: " << size << "\n"; //size is the number items remaining in the queue after popping the event.
+	if (dropped != 0) ostr << "Dropped: " << dropped << "\n"; //events lost because the queue of this client was full.
 	
-	if (!mEventQueue.empty()) {
-		Event *e = mEventQueue.front();
-		mEventQueue.pop();
+	shared_ptr<Event> e = client->popEvent();
+	if (e) {
 		ostr << e->toBuf() << "\n";
-		delete e;
 		status = true;
 	}
 	
@@ -534,32 +830,34 @@ bool Daemon::pullEvent() {
 }
 
 void Daemon::callStateChanged(LinphoneCall *call, LinphoneCallState state, const char *msg) {
-	queueEvent(new CallEvent(this, call, state));
+	if (isEventWanted("call-state-changed")) queueEvent(new CallEvent(this, call, state));
 	
 	if (state == LinphoneCallIncomingReceived && mAutoAnswer){
 		linphone_call_accept(call);
 	}
+	/*The event above has already reported the id for the last time.*/
+	if (state == LinphoneCallReleased) mCalls.remove(call);
 }
 
 void Daemon::messageReceived(LinphoneChatRoom *cr, LinphoneChatMessage *msg){
-	queueEvent(new IncomingMessageEvent(msg));
+	if (isEventWanted("message-received")) queueEvent(new IncomingMessageEvent(msg));
 }
 
 void Daemon::callStatsUpdated(LinphoneCall *call, const LinphoneCallStats *stats) {
 	if (mUseStatsEvents) {
 		/* don't queue periodical updates (3 per seconds for just bandwidth updates) */
-		if (!(_linphone_call_stats_get_updated(stats) & LINPHONE_CALL_STATS_PERIODICAL_UPDATE)){
+		if (!(_linphone_call_stats_get_updated(stats) & LINPHONE_CALL_STATS_PERIODICAL_UPDATE) && isEventWanted("call-stats")){
 			queueEvent(new CallStatsEvent(this, call, stats));
 		}
 	}
 }
 
 void Daemon::callPlayingComplete(int id) {
-	queueEvent(new CallPlayingStatsEvent(this, id));
+	if (isEventWanted("call-playing-complete")) queueEvent(new CallPlayingStatsEvent(this, id));
 }
 
 void Daemon::dtmfReceived(LinphoneCall *call, int dtmf) {
-	queueEvent(new DtmfEvent(this, call, dtmf));
+	if (isEventWanted("receiving-tone")) queueEvent(new DtmfEvent(this, call, dtmf));
 }
 
 void Daemon::callStateChanged(LinphoneCore *lc, LinphoneCall *call, LinphoneCallState state, const char *msg) {
@@ -580,15 +878,26 @@ void Daemon::messageReceived(LinphoneCore *lc, LinphoneChatRoom *cr, LinphoneCha
 	app->messageReceived(cr, msg);
 }
 
+void Daemon::registrationStateChanged(LinphoneCore *lc, LinphoneProxyConfig *cfg, LinphoneRegistrationState state, const char *msg) {
+	Daemon *app = (Daemon*) linphone_core_get_user_data(lc);
+	/*A proxy config removed from the core is unregistered, or set back to None. The table is still empty while the core
+	is being created.*/
+	if (state != LinphoneRegistrationCleared && state != LinphoneRegistrationNone) return;
+	if (app->mProxies.find(cfg) == 0) return;
+	if (bctbx_list_find(linphone_core_get_proxy_config_list(lc), cfg) == NULL) app->removeProxy(cfg);
+}
+
 void Daemon::iterateStreamStats() {
-	for (map<int, AudioStreamAndOther*>::iterator it = mAudioStreams.begin(); it != mAudioStreams.end(); ++it) {
+	const list<int> ids = mAudioStreams.getIds();
+	for (list<int>::const_iterator it = ids.begin(); it != ids.end(); ++it) {
+		AudioStreamAndOther *streamAndOther = mAudioStreams.get(*it);
 		OrtpEvent *ev;
-		while (it->second->queue && (NULL != (ev=ortp_ev_queue_get(it->second->queue)))){
+		while (streamAndOther->queue && (NULL != (ev=ortp_ev_queue_get(streamAndOther->queue)))){
 			OrtpEventType evt=ortp_event_get_type(ev);
 			if (evt == ORTP_EVENT_RTCP_PACKET_RECEIVED || evt == ORTP_EVENT_RTCP_PACKET_EMITTED) {
-				linphone_call_stats_fill(it->second->stats, &it->second->stream->ms, ev);
-				if (mUseStatsEvents) mEventQueue.push(new AudioStreamStatsEvent(this,
-					it->second->stream, it->second->stats));
+				linphone_call_stats_fill(streamAndOther->stats, &streamAndOther->stream->ms, ev);
+				if (mUseStatsEvents && isEventWanted("audio-stream-stats")) queueEvent(new AudioStreamStatsEvent(this,
+					streamAndOther->stream, streamAndOther->stats));
 			}
 			ortp_event_destroy(ev);
 		}
@@ -598,121 +907,295 @@ void Daemon::iterateStreamStats() {
 void Daemon::iterate() {
 	linphone_core_iterate(mLc);
 	iterateStreamStats();
-	if (mChildFd == (ortp_pipe_t)-1) {
-		if (!mEventQueue.empty()) {
-			Event *r = mEventQueue.front();
-			mEventQueue.pop();
+	if (mServerFd == (ortp_pipe_t)-1) {
+		shared_ptr<Event> r;
+		bool printed = false;
+		while ((r = mConsole.popEvent()) != NULL) {
 			fprintf(stdout, "\n%s\n", r->toBuf().c_str());
-			fflush(stdout);
-			delete r;
+			printed = true;
 		}
+		if (printed) fflush(stdout);
 	}
 }
 
-void Daemon::execCommand(const string &command) {
+/*Must be called with mMutex held.*/
+void Daemon::execCommand(DaemonClient *client, const string &command) {
 	istringstream ist(command);
 	string name;
+	string requestId;
 	ist >> name;
+	if (name.size() > 1 && name[0] == '@') {
+		/*"@<id> <command>" tags the response with the id, so that pipelined commands can be matched with their responses.*/
+		requestId = name.substr(1);
+		name.clear();
+		ist >> name;
+	}
+	if (name.empty()) return;
 	stringbuf argsbuf;
 	ist.get(argsbuf);
 	string args = argsbuf.str();
 	if (!args.empty() && (args[0] == ' ')) args.erase(0, 1);
-	list<DaemonCommand*>::iterator it = find_if(mCommands.begin(), mCommands.end(), bind2nd(mem_fun(&DaemonCommand::matches), name));
-	if (it != mCommands.end()) {
-		ms_mutex_lock(&mMutex);
-		(*it)->exec(this, args);
-		ms_mutex_unlock(&mMutex);
+	mCurrentClient = client;
+	client->setRequestId(requestId);
+	DaemonCommand *cmd = findCommand(name);
+	if (cmd) {
+		cmd->exec(this, args);
 	} else {
 		sendResponse(Response("Unknown command."));
 	}
+	client->setRequestId("");
+	mCurrentClient = NULL;
+}
+
+/*Runs every command received at once before writing the responses, in the order they were received. In text mode, input
+left without a terminating new line once the read drained everything the client sent is run as a command too, as
+clients have always been allowed to send a single command without a new line.*/
+void Daemon::execCommands(DaemonClient *client, bool inputDrained) {
+	string command;
+	while (!client->isClosed() && client->nextCommand(command)) {
+		execCommand(client, command);
+	}
+	if (inputDrained && !client->isClosed() && client->takePendingInput(command)) execCommand(client, command);
+	if (!client->isClosed() && !client->flush()) client->close();
 }
 
 void Daemon::sendResponse(const Response &resp) {
+	DaemonClient *client = getCurrentClient();
+	if (client->getProtocol() == DaemonClient::Json) {
+		client->write(frame(resp.toJson(client->getRequestId())));
+		return;
+	}
 	string buf = resp.toBuf();
-	if (mChildFd != (ortp_pipe_t)-1) {
-		if (ortp_pipe_write(mChildFd, (uint8_t *)buf.c_str(), (int)buf.size()) == -1) {
-			ms_error("Fail to write to pipe: %s", strerror(errno));
-		}
-	} else {
+	if (!client->getRequestId().empty()) buf = "Request-Id: " + client->getRequestId() + "\n" + buf;
+	if (client == &mConsole) {
 		cout << buf << flush;
+	} else {
+		client->write(buf);
 	}
 }
 
+bool Daemon::isEventWanted(const string &eventType) const {
+	if (mClients.empty()) return true;
+	for (map<ortp_pipe_t, DaemonClient*>::const_iterator it = mClients.begin(); it != mClients.end(); ++it) {
+		if (it->second->isSubscribed(eventType)) return true;
+	}
+	return false;
+}
+
 void Daemon::queueEvent(Event *ev){
-	mEventQueue.push(ev);
+	shared_ptr<Event> event(ev);
+	if (mClients.empty()) {
+		/*Kept for the next client to connect, or printed on the console.*/
+		mConsole.queueEvent(event);
+		return;
+	}
+	for (map<ortp_pipe_t, DaemonClient*>::iterator it = mClients.begin(); it != mClients.end(); ++it) {
+		DaemonClient *client = it->second;
+		if (!client->isSubscribed(event->getType())) continue;
+		if (client->getProtocol() == DaemonClient::Json) {
+			client->pushEvent(*event);
+#ifndef _WIN32
+			if (!client->flush()) {
+				client->close();
+				wake();
+			} else if (client->hasPendingOutput()) {
+				watchClient(client, false);
+				wake();
+			}
+#else
+			if (!client->flush()) client->close();
+#endif
+		} else {
+			client->queueEvent(event);
+		}
+	}
 }
 
-string Daemon::readPipe() {
-	char buffer[32768];
-	memset(buffer, '\0', sizeof(buffer));
 #ifdef _WIN32
-	if (mChildFd == (ortp_pipe_t)-1) {
-		mChildFd = ortp_server_pipe_accept_client(mServerFd);
+void Daemon::serveClients() {
+	char buffer[32768];
+	DaemonClient *client = mClients.empty() ? NULL : mClients.begin()->second;
+	/*Named pipes serve a single client at a time.*/
+	if (client == NULL) {
+		ortp_pipe_t fd = ortp_server_pipe_accept_client(mServerFd);
+		if (fd == (ortp_pipe_t)-1) return;
 		ms_message("Client accepted");
+		client = new DaemonClient(fd, mEventQueueSize, mDefaultProtocol);
+		ms_mutex_lock(&mMutex);
+		client->takeEventsFrom(&mConsole);
+		mClients[fd] = client;
+		ms_mutex_unlock(&mMutex);
 	}
-	if (mChildFd != (ortp_pipe_t)-1) {
-		int ret = ortp_pipe_read(mChildFd, (uint8_t *)buffer, sizeof(buffer));
-		if (ret == -1) {
+	int ret = ortp_pipe_read(client->getFd(), (uint8_t *)buffer, sizeof(buffer));
+	ms_mutex_lock(&mMutex);
+	if (ret > 0) {
+		client->feed(buffer, (size_t)ret);
+		execCommands(client, true);
+	} else {
+		if (ret == -1) ms_error("Fail to read from pipe: %s", strerror(errno));
+		else {
+			ms_message("Client disconnected");
+			execCommands(client, true);
+		}
+		client->close();
+	}
+	if (client->isClosed()) {
+		ortp_server_pipe_close_client(client->getFd());
+		mClients.clear();
+		delete client;
+	}
+	ms_mutex_unlock(&mMutex);
+}
+#else
+void Daemon::watchClient(DaemonClient *client, bool add) {
+#ifdef __linux__
+	struct epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN | (client->hasPendingOutput() ? EPOLLOUT : 0);
+	ev.data.fd = (int)client->getFd();
+	if (epoll_ctl(mPollFd, add ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, (int)client->getFd(), &ev) == -1) {
+		ms_error("Cannot watch client %i: %s", (int)client->getFd(), strerror(errno));
+	}
+#endif
+}
+
+void Daemon::acceptClient() {
+	struct sockaddr_storage addr;
+	socklen_t addrlen = sizeof(addr);
+	int childfd = accept(mServerFd, (struct sockaddr*) &addr, &addrlen);
+	if (childfd == -1) return;
+	if (mClients.size() >= mMaxClients) {
+		ms_error("Cannot accept more than %i clients at the same time", (int)mMaxClients);
+		close(childfd);
+		return;
+	}
+	fcntl(childfd, F_SETFL, fcntl(childfd, F_GETFL) | O_NONBLOCK);
+	DaemonClient *client = new DaemonClient((ortp_pipe_t)childfd, mEventQueueSize, mDefaultProtocol);
+	if (mClients.empty()) client->takeEventsFrom(&mConsole);
+	mClients[(ortp_pipe_t)childfd] = client;
+	watchClient(client, true);
+	ms_message("Client %i accepted", childfd);
+}
+
+void Daemon::readClient(DaemonClient *client) {
+	char buffer[32768];
+	bool received = false;
+	bool inputClosed = false;
+	while (true) {
+		ssize_t ret = recv((int)client->getFd(), buffer, sizeof(buffer), 0);
+		if (ret > 0) {
+			client->feed(buffer, (size_t)ret);
+			received = true;
+			continue;
+		}
+		if (ret == 0) {
+			ms_message("Client %i disconnected", (int)client->getFd());
+			inputClosed = true;
+		} else if (errno == EINTR) {
+			continue;
+		} else if (errno != EAGAIN && errno != EWOULDBLOCK) {
 			ms_error("Fail to read from pipe: %s", strerror(errno));
-			mChildFd = (ortp_pipe_t)-1;
+			client->close();
+		}
+		break;
+	}
+	/*The socket is drained here, nothing more is buffered for this client.*/
+	if (received || inputClosed) execCommands(client, true);
+	/*The responses to the last commands of a client that shut down its sending side were flushed as far as possible.*/
+	if (inputClosed) client->close();
+	if (!client->isClosed() && client->hasPendingOutput()) watchClient(client, false);
+}
+
+void Daemon::wake() {
+	if (mWakeFds[1] != -1) {
+		char c = 0;
+		if (write(mWakeFds[1], &c, 1) == -1) {
+			/*the pipe is full, the loop is already going to wake up*/
+		}
+	}
+}
+
+void Daemon::closeClients(bool all) {
+	map<ortp_pipe_t, DaemonClient*>::iterator it = mClients.begin();
+	while (it != mClients.end()) {
+		DaemonClient *client = it->second;
+		if (all || client->isClosed()) {
+			ortp_server_pipe_close_client(client->getFd());
+			delete client;
+			mClients.erase(it++);
 		} else {
-			if (ret == 0) {
-				ms_message("Client disconnected");
-				mChildFd = (ortp_pipe_t)-1;
-				return "";
-			}
-			buffer[ret] = '\0';
-			return buffer;
+			++it;
 		}
 	}
-#else
-	struct pollfd pfd[2];
-	int nfds = 1;
-	memset(&pfd[0], 0, sizeof(pfd));
-	if (mServerFd != (ortp_pipe_t)-1) {
-		pfd[0].events = POLLIN;
-		pfd[0].fd = mServerFd;
-	}
-	if (mChildFd != (ortp_pipe_t)-1) {
-		pfd[1].events = POLLIN;
-		pfd[1].fd = mChildFd;
-		nfds++;
-	}
-	int err = poll(pfd, (nfds_t)nfds, 50);
-	if (err > 0) {
-		if (mServerFd != (ortp_pipe_t)-1 && (pfd[0].revents & POLLIN)) {
-			struct sockaddr_storage addr;
-			socklen_t addrlen = sizeof(addr);
-			int childfd = accept(mServerFd, (struct sockaddr*) &addr, &addrlen);
-			if (childfd != -1) {
-				if (mChildFd != (ortp_pipe_t)-1) {
-					ms_error("Cannot accept two client at the same time");
-					close(childfd);
-				} else {
-					mChildFd = (ortp_pipe_t)childfd;
-					return "";
-				}
-			}
+}
+
+void Daemon::serveClients() {
+	vector<ortp_pipe_t> readable;
+	vector<ortp_pipe_t> writable;
+	bool acceptable = false;
+	int nevents;
+#ifdef __linux__
+	struct epoll_event events[64];
+	nevents = epoll_wait(mPollFd, events, 64, -1);
+	for (int i = 0; i < nevents; ++i) {
+		int fd = events[i].data.fd;
+		if (fd == (int)mServerFd) acceptable = true;
+		else if (fd != mWakeFds[0]) {
+			if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) readable.push_back((ortp_pipe_t)fd);
+			if (events[i].events & EPOLLOUT) writable.push_back((ortp_pipe_t)fd);
 		}
-		if (mChildFd != (ortp_pipe_t)-1 && (pfd[1].revents & POLLIN)) {
-			int ret;
-			if ((ret = ortp_pipe_read(mChildFd, (uint8_t *)buffer, sizeof(buffer))) == -1) {
-				ms_error("Fail to read from pipe: %s", strerror(errno));
-			} else {
-				if (ret == 0) {
-					ms_message("Client disconnected");
-					ortp_server_pipe_close_client(mChildFd);
-					mChildFd = (ortp_pipe_t)-1;
-					return "";
-				}
-				buffer[ret] = '\0';
-				return buffer;
-			}
+	}
+#else
+	vector<struct pollfd> pfds;
+	struct pollfd pfd;
+	memset(&pfd, 0, sizeof(pfd));
+	pfd.fd = mServerFd;
+	pfd.events = POLLIN;
+	pfds.push_back(pfd);
+	if (mWakeFds[0] != -1) {
+		pfd.fd = mWakeFds[0];
+		pfds.push_back(pfd);
+	}
+	ms_mutex_lock(&mMutex);
+	for (map<ortp_pipe_t, DaemonClient*>::iterator it = mClients.begin(); it != mClients.end(); ++it) {
+		pfd.fd = (int)it->first;
+		pfd.events = POLLIN | (it->second->hasPendingOutput() ? POLLOUT : 0);
+		pfds.push_back(pfd);
+	}
+	ms_mutex_unlock(&mMutex);
+	nevents = poll(&pfds[0], (nfds_t)pfds.size(), -1);
+	for (size_t i = 0; nevents > 0 && i < pfds.size(); ++i) {
+		if (pfds[i].fd == (int)mServerFd) {
+			if (pfds[i].revents & POLLIN) acceptable = true;
+		} else if (pfds[i].fd != mWakeFds[0]) {
+			if (pfds[i].revents & (POLLIN | POLLHUP | POLLERR)) readable.push_back((ortp_pipe_t)pfds[i].fd);
+			if (pfds[i].revents & POLLOUT) writable.push_back((ortp_pipe_t)pfds[i].fd);
 		}
 	}
 #endif
-	return "";
+	if (nevents <= 0) return;
+	if (mWakeFds[0] != -1) {
+		char drain[64];
+		while (read(mWakeFds[0], drain, sizeof(drain)) > 0) {}
+	}
+
+	ms_mutex_lock(&mMutex);
+	if (acceptable) acceptClient();
+	for (vector<ortp_pipe_t>::iterator it = writable.begin(); it != writable.end(); ++it) {
+		map<ortp_pipe_t, DaemonClient*>::iterator client = mClients.find(*it);
+		if (client == mClients.end() || client->second->isClosed()) continue;
+		if (!client->second->flush()) client->second->close();
+		else if (!client->second->hasPendingOutput()) watchClient(client->second, false);
+	}
+	for (vector<ortp_pipe_t>::iterator it = readable.begin(); it != readable.end(); ++it) {
+		map<ortp_pipe_t, DaemonClient*>::iterator client = mClients.find(*it);
+		if (client == mClients.end() || client->second->isClosed()) continue;
+		readClient(client->second);
+	}
+	closeClients(false);
+	ms_mutex_unlock(&mMutex);
 }
+#endif
 
 void Daemon::dumpCommandsHelp() {
 	int cols = 80;
@@ -805,6 +1288,9 @@ static void printHelp() {
 		"\t--dump-commands-help       Dump the help of every available commands." << endl <<
 		"\t--dump-commands-html-help  Dump the help of every available commands." << endl <<
 		"\t--pipe <pipename>          Create an unix server socket in /tmp to receive commands from." << endl <<
+		"\t--max-clients <count>      Maximum number of clients connected to the pipe at the same time (default: 16)." << endl <<
+		"\t--event-queue-size <count> Maximum number of events queued for each client, older ones are dropped (default: 1000)." << endl <<
+		"\t--json                     Use the framed JSON protocol for the clients of the pipe (see the protocol command)." << endl <<
 		"\t--log <path>               Supply a file where the log will be saved." << endl <<
 		"\t--factory-config <path>    Supply a readonly linphonerc style config file to start with." << endl <<
 		"\t--config <path>            Supply a linphonerc style config file to start with." << endl <<
@@ -854,12 +1340,12 @@ int Daemon::run() {
 #ifdef HAVE_READLINE
 				add_history(line.c_str());
 #endif
+				ms_mutex_lock(&mMutex);
+				execCommand(&mConsole, line);
+				ms_mutex_unlock(&mMutex);
 			}
 		} else {
-			line = readPipe();
-		}
-		if (!line.empty()) {
-			execCommand(line);
+			serveClients();
 		}
 		if (eof && mRunning) {
 			mRunning = false; // ctrl+d
@@ -877,6 +1363,9 @@ void Daemon::stopThread() {
 
 void Daemon::quit() {
 	mRunning = false;
+#ifndef _WIN32
+	wake();
+#endif
 }
 
 void Daemon::enableStatsEvents(bool enabled){
@@ -899,15 +1388,33 @@ void Daemon::enableLSD(bool enabled) {
 Daemon::~Daemon() {
 	uninitCommands();
 
-	for (map<int, AudioStreamAndOther *>::iterator it = mAudioStreams.begin(); it != mAudioStreams.end(); ++it) {
-		audio_stream_stop(it->second->stream);
+	const list<int> audioStreamIds = mAudioStreams.getIds();
+	for (list<int>::const_iterator it = audioStreamIds.begin(); it != audioStreamIds.end(); ++it) {
+		AudioStreamAndOther *streamAndOther = mAudioStreams.remove(*it);
+		AudioStream *stream = streamAndOther->stream;
+		delete streamAndOther;
+		audio_stream_stop(stream);
+	}
+	mAudioStreamIds.clear();
+	const list<int> proxyIds = mProxies.getIds();
+	for (list<int>::const_iterator it = proxyIds.begin(); it != proxyIds.end(); ++it) {
+		linphone_proxy_config_unref(mProxies.remove(*it));
 	}
 
 	enableLSD(false);
 	linphone_core_unref(mLc);
-	if (mChildFd != (ortp_pipe_t)-1) {
-		ortp_server_pipe_close_client(mChildFd);
+#ifdef _WIN32
+	for (map<ortp_pipe_t, DaemonClient*>::iterator it = mClients.begin(); it != mClients.end(); ++it) {
+		ortp_server_pipe_close_client(it->first);
+		delete it->second;
 	}
+	mClients.clear();
+#else
+	closeClients(true);
+	if (mPollFd != -1) close(mPollFd);
+	if (mWakeFds[0] != -1) close(mWakeFds[0]);
+	if (mWakeFds[1] != -1) close(mWakeFds[1]);
+#endif
 	if (mServerFd != (ortp_pipe_t)-1) {
 		ortp_server_pipe_close(mServerFd);
 	}
@@ -943,6 +1450,9 @@ int main(int argc, char *argv[]) {
 	bool stats_enabled = true;
 	bool lsd_enabled = false;
 	bool auto_answer = false;
+	int max_clients = 16;
+	int event_queue_size = 1000;
+	bool json = false;
 	int i;
 
 	for (i = 1; i < argc; ++i) {
@@ -995,12 +1505,26 @@ int main(int argc, char *argv[]) {
 			lsd_enabled = true;
 		}else if (strcmp(argv[i], "--auto-answer") == 0) {
 			auto_answer = true;
+		} else if (strcmp(argv[i], "--max-clients") == 0) {
+			if (i + 1 >= argc) {
+				fprintf(stderr, "no count specify after --max-clients\n");
+				return -1;
+			}
+			max_clients = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--event-queue-size") == 0) {
+			if (i + 1 >= argc) {
+				fprintf(stderr, "no count specify after --event-queue-size\n");
+				return -1;
+			}
+			event_queue_size = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--json") == 0) {
+			json = true;
 		}
 		else{
 			fprintf(stderr, "Unrecognized option : %s", argv[i]);
 		}
 	}
-	Daemon app(config_path, factory_config_path, log_file, pipe_name, display_video, capture_video);
+	Daemon app(config_path, factory_config_path, log_file, pipe_name, display_video, capture_video, max_clients, event_queue_size, json);
 	
 	the_app = &app;
 	signal(SIGINT, sighandler);
@@ -28,9 +28,13 @@ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
 
 #include <string>
 #include <list>
-#include <queue>
+#include <deque>
 #include <map>
+#include <memory>
+#include <set>
+#include <unordered_map>
 #include <sstream>
+#include <vector>
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -77,6 +81,9 @@ public:
 	virtual void exec(Daemon *app, const std::string& args)=0;
 	bool matches(const std::string& name) const;
 	const std::string getHelp() const;
+	const std::string &getName() const {
+		return mName;
+	}
 	const std::string &getProto() const {
 		return mProto;
 	}
@@ -139,6 +146,7 @@ public:
 		}
 		return buf.str();
 	}
+	std::string toJson(const std::string &requestId) const;
 private:
 	Status mStatus;
 	std::string mReason;
@@ -155,6 +163,9 @@ public:
 	void setBody(const std::string &body){
 		mBody = body;
 	}
+	const std::string &getType()const{
+		return mEventType;
+	}
 	virtual ~Event(){
 	}
 	virtual std::string toBuf() const {
@@ -166,9 +177,84 @@ public:
 		}
 		return buf.str();
 	}
+	/*Serialized once, then shared by all the clients using the framed protocol.*/
+	const std::string &toJson() const;
 protected:
 	const std::string mEventType;
 	std::string mBody;
+private:
+	mutable std::string mJson;
+};
+
+/*A client connected to the daemon's socket. Each client has its own bounded event queue, so that a client that does not
+pop its events only loses its own oldest events, and its own output buffer, so that a client that does not read its
+responses cannot block the others.*/
+class DaemonClient {
+public:
+	/*Text is the historical "Status: ..." protocol. Json frames every message with its length as a 32 bits big endian
+	integer: requests are command lines, responses and events are JSON objects, and events are pushed as they happen
+	instead of being popped.*/
+	enum Protocol {
+		Text, Json
+	};
+	DaemonClient(ortp_pipe_t fd, size_t maxEvents, Protocol protocol = Text);
+	ortp_pipe_t getFd() const {
+		return mFd;
+	}
+	void queueEvent(const std::shared_ptr<Event> &ev);
+	std::shared_ptr<Event> popEvent();
+	size_t getEventCount() const {
+		return mEvents.size();
+	}
+	unsigned int takeDroppedEvents();
+	void takeEventsFrom(DaemonClient *other);
+	void feed(const char *data, size_t size);
+	/*Extracts the next complete command, according to the protocol in use when it is called.*/
+	bool nextCommand(std::string &command);
+	/*Takes the data received without a trailing new line, it is only complete once the client stopped sending.*/
+	bool takePendingInput(std::string &command);
+	void write(const std::string &buf);
+	/*Pushes an event to a client using the framed protocol, it is dropped if the client does not keep up.*/
+	void pushEvent(const Event &ev);
+	Protocol getProtocol() const {
+		return mProtocol;
+	}
+	void setProtocol(Protocol protocol) {
+		mProtocol = protocol;
+	}
+	/*A client receives every event until it subscribes to some of them.*/
+	void subscribe(const std::string &eventType);
+	void unsubscribe(const std::string &eventType);
+	bool isSubscribed(const std::string &eventType) const;
+	/*Writes as much pending output as the socket accepts, returns false if the client must be dropped.*/
+	bool flush();
+	bool hasPendingOutput() const {
+		return !mOutput.empty();
+	}
+	const std::string &getRequestId() const {
+		return mRequestId;
+	}
+	void setRequestId(const std::string &requestId) {
+		mRequestId = requestId;
+	}
+	bool isClosed() const {
+		return mClosed;
+	}
+	void close() {
+		mClosed = true;
+	}
+private:
+	ortp_pipe_t mFd;
+	std::string mInput;
+	std::string mOutput;
+	std::deque<std::shared_ptr<Event> > mEvents;
+	size_t mMaxEvents;
+	unsigned int mDroppedEvents;
+	std::string mRequestId;
+	bool mClosed;
+	Protocol mProtocol;
+	bool mAllEvents;
+	std::set<std::string> mSubscriptions;
 };
 
 class CallEvent : public Event {
@@ -236,19 +322,105 @@ struct AudioStreamAndOther {
 	}
 };
 
+/*Maps the ids given to the clients to the objects of the core. An id is made of the index of a slot and of the generation of
+this slot, so that lookups are O(1) and an id never designates another object once its own object has been removed, even
+though the slot gets reused. The first objects of each slot get the ids 1, 2, 3... as they used to.*/
+template <typename T>
+class HandleTable {
+public:
+	/*Returns the id of the object, giving it one if it has none yet.*/
+	int add(T *object) {
+		int id = find(object);
+		if (id != 0) return id;
+		size_t index;
+		if (!mFreeSlots.empty()) {
+			index = mFreeSlots.back();
+			mFreeSlots.pop_back();
+		} else {
+			if (mSlots.size() >= IndexMask) return 0;
+			index = mSlots.size();
+			mSlots.push_back(Slot());
+		}
+		mSlots[index].object = object;
+		id = (int)((mSlots[index].generation << IndexBits) | (unsigned int)(index + 1));
+		mIds[object] = id;
+		return id;
+	}
+	/*Returns 0 if the object has no id.*/
+	int find(T *object) const {
+		typename std::unordered_map<T *, int>::const_iterator it = mIds.find(object);
+		return it != mIds.end() ? it->second : 0;
+	}
+	T *get(int id) const {
+		if (id <= 0) return NULL;
+		size_t index = (size_t)(((unsigned int)id & IndexMask) - 1);
+		if (index >= mSlots.size()) return NULL;
+		const Slot &slot = mSlots[index];
+		if (slot.object == NULL || slot.generation != ((unsigned int)id >> IndexBits)) return NULL;
+		return slot.object;
+	}
+	/*Returns the object that had this id, if any.*/
+	T *remove(int id) {
+		T *object = get(id);
+		if (object == NULL) return NULL;
+		Slot &slot = mSlots[(size_t)(((unsigned int)id & IndexMask) - 1)];
+		slot.object = NULL;
+		slot.generation = (slot.generation + 1) & GenerationMask;
+		mFreeSlots.push_back((size_t)(((unsigned int)id & IndexMask) - 1));
+		mIds.erase(object);
+		return object;
+	}
+	int remove(T *object) {
+		int id = find(object);
+		if (id != 0) remove(id);
+		return id;
+	}
+	/*Ids of all the objects in the table, in slot order.*/
+	std::list<int> getIds() const {
+		std::list<int> ids;
+		for (size_t index = 0; index < mSlots.size(); ++index) {
+			if (mSlots[index].object != NULL)
+				ids.push_back((int)((mSlots[index].generation << IndexBits) | (unsigned int)(index + 1)));
+		}
+		return ids;
+	}
+	size_t size() const {
+		return mIds.size();
+	}
+private:
+	static const unsigned int IndexBits = 16;
+	static const unsigned int IndexMask = (1u << IndexBits) - 1;
+	/*Keeps the ids positive.*/
+	static const unsigned int GenerationMask = (1u << (31 - IndexBits)) - 1;
+	struct Slot {
+		Slot() : object(NULL), generation(0) {}
+		T *object;
+		unsigned int generation;
+	};
+	std::vector<Slot> mSlots;
+	std::vector<size_t> mFreeSlots;
+	std::unordered_map<T *, int> mIds;
+};
+
 class Daemon {
 	friend class DaemonCommand;
 public:
 	typedef Response::Status Status;
-	Daemon(const char *config_path, const char *factory_config_path, const char *log_file, const char *pipe_name, bool display_video, bool capture_video);
+	Daemon(const char *config_path, const char *factory_config_path, const char *log_file, const char *pipe_name, bool display_video, bool capture_video, int max_clients = 16, int event_queue_size = 1000, bool json = false);
 	~Daemon();
 	int run();
 	void quit();
 	void sendResponse(const Response &resp);
 	void queueEvent(Event *resp);
+	/*Tells whether anybody would receive an event of this type, so that it is not even built otherwise.*/
+	bool isEventWanted(const std::string &eventType) const;
+	DaemonClient *getCurrentClient() {
+		return mCurrentClient ? mCurrentClient : &mConsole;
+	}
 	LinphoneCore *getCore();
 	LinphoneSoundDaemon *getLSD();
 	const std::list<DaemonCommand*> &getCommandList() const;
+	DaemonCommand *findCommand(const std::string &name) const;
 	LinphoneCall *findCall(int id);
 	LinphoneProxyConfig *findProxy(int id);
 	LinphoneAuthInfo *findAuthInfo(int id);
@@ -258,7 +430,9 @@ public:
 	bool pullEvent();
 	int updateCallId(LinphoneCall *call);
 	int updateProxyId(LinphoneProxyConfig *proxy);
-	inline int maxProxyId() { return mProxyIds; }
+	void removeProxy(LinphoneProxyConfig *proxy);
+	void deleteProxy(LinphoneProxyConfig *proxy);
+	std::list<int> getProxyIds() const { return mProxies.getIds(); }
 	inline int maxAuthInfoId()  { return (int)bctbx_list_size(linphone_core_get_auth_info_list(mLc)); }
 	int updateAudioStreamId(AudioStream *audio_stream);
 	void dumpCommandsHelp();
@@ -276,14 +450,23 @@ private:
 	static void callStatsUpdated(LinphoneCore *lc, LinphoneCall *call, const LinphoneCallStats *stats);
 	static void dtmfReceived(LinphoneCore *lc, LinphoneCall *call, int dtmf);
 	static void messageReceived(LinphoneCore *lc, LinphoneChatRoom *cr, LinphoneChatMessage *msg);
+	static void registrationStateChanged(LinphoneCore *lc, LinphoneProxyConfig *cfg, LinphoneRegistrationState state, const char *msg);
 	void callStateChanged(LinphoneCall *call, LinphoneCallState state, const char *msg);
 	void callStatsUpdated(LinphoneCall *call, const LinphoneCallStats *stats);
 	void dtmfReceived(LinphoneCall *call, int dtmf);
 	void messageReceived(LinphoneChatRoom *cr, LinphoneChatMessage *msg);
 	
-	void execCommand(const std::string &command);
+	void execCommand(DaemonClient *client, const std::string &command);
+	void execCommands(DaemonClient *client, bool inputDrained);
 	std::string readLine(const std::string&, bool*);
-	std::string readPipe();
+	void serveClients();
+#ifndef _WIN32
+	void acceptClient();
+	void readClient(DaemonClient *client);
+	void watchClient(DaemonClient *client, bool add);
+	void closeClients(bool all);
+	void wake();
+#endif
 	void iterate();
 	void iterateStreamStats();
 	void startThread();
@@ -293,21 +476,31 @@ private:
 	LinphoneCore *mLc;
 	LinphoneSoundDaemon *mLSD;
 	std::list<DaemonCommand*> mCommands;
-	std::queue<Event*> mEventQueue;
+	std::unordered_map<std::string, DaemonCommand*> mCommandsByName;
+	/*Console client when commands are read from stdin, and holder of the events raised while no client is connected otherwise.*/
+	DaemonClient mConsole;
+	std::map<ortp_pipe_t, DaemonClient*> mClients;
+	DaemonClient *mCurrentClient;
+	size_t mMaxClients;
+	size_t mEventQueueSize;
+	DaemonClient::Protocol mDefaultProtocol;
 	ortp_pipe_t mServerFd;
-	ortp_pipe_t mChildFd;
+#ifndef _WIN32
+	int mPollFd;
+	int mWakeFds[2];
+#endif
 	std::string mHistfile;
 	bool mRunning;
 	bool mUseStatsEvents;
 	bool mAutoAnswer;
 	FILE *mLogFile;
 	bool mAutoVideo;
-	int mCallIds;
-	int mProxyIds;
-	int mAudioStreamIds;
+	HandleTable<LinphoneCall> mCalls;
+	HandleTable<LinphoneProxyConfig> mProxies;
+	HandleTable<AudioStreamAndOther> mAudioStreams;
+	std::unordered_map<AudioStream*, int> mAudioStreamIds;
 	ms_thread_t mThread;
 	ms_mutex_t mMutex;
-	std::map<int, AudioStreamAndOther*> mAudioStreams;
 };
 
 #endif //DAEMON_H_
@@ -44,6 +44,38 @@
 #define LINPHONE_CALL_STATS_SENT_RTCP_UPDATE (1 << 1) /**< sent_rtcp field of LinphoneCallStats object has been updated */
 #define LINPHONE_CALL_STATS_PERIODICAL_UPDATE (1 << 2) /**< Every seconds LinphoneCallStats object has been updated */
 
+#define LINPHONE_CALL_STATS_SNAPSHOT_CALL_ID_SIZE 64
+
+/**
+ * Copy of the main statistics of a media stream, published by the core each time the stats of the stream are updated.
+ * Unlike #LinphoneCallStats it is a plain structure that monitoring threads can read without going through the core,
+ * see linphone_call_get_stats_snapshot() and linphone_core_get_call_stats_snapshots().
+ * @donotwrap
+ */
+typedef struct _LinphoneCallStatsSnapshot {
+	char call_id[LINPHONE_CALL_STATS_SNAPSHOT_CALL_ID_SIZE]; /**< Call-ID of the call the stream belongs to, truncated if longer */
+	LinphoneStreamType type; /**< Type of the stream */
+	unsigned int update_count; /**< Number of times the stats of the stream have been published */
+	uint64_t update_time; /**< Time of the last publication, in milliseconds */
+	float download_bandwidth; /**< Download bandwidth in kbit/s, including IP/UDP/RTP headers */
+	float upload_bandwidth; /**< Upload bandwidth in kbit/s, including IP/UDP/RTP headers */
+	float rtcp_download_bandwidth; /**< RTCP download bandwidth in kbit/s */
+	float rtcp_upload_bandwidth; /**< RTCP upload bandwidth in kbit/s */
+	float estimated_download_bandwidth; /**< Estimated download bandwidth in kbit/s */
+	float round_trip_delay; /**< Round trip delay in s, -1 if unknown */
+	float sender_loss_rate; /**< Loss rate reported by the remote end in its last RTCP report, in percent */
+	float receiver_loss_rate; /**< Loss rate of our last RTCP report, in percent */
+	float local_loss_rate; /**< Percentage of packets lost over the last second */
+	float local_late_rate; /**< Percentage of packets received too late over the last second */
+	float sender_interarrival_jitter; /**< Interarrival jitter reported by the remote end, in ms */
+	float receiver_interarrival_jitter; /**< Interarrival jitter of our last RTCP report, in ms */
+	float jitter_buffer_size_ms; /**< Size of the jitter buffer in ms */
+	uint64_t packet_sent; /**< Number of RTP packets sent */
+	uint64_t packet_recv; /**< Number of RTP packets received */
+	int64_t cum_packet_loss; /**< Cumulative number of RTP packets lost */
+	LinphoneIceState ice_state; /**< State of ICE processing */
+} LinphoneCallStatsSnapshot;
+
 /**
  * Increment refcount.
  * @param[in] stats #LinphoneCallStats object
@@ -22,6 +22,7 @@
 
 #include <ortp/rtpsession.h>
 
+#include "linphone/api/c-call-stats.h"
 #include "linphone/api/c-types.h"
 
 // =============================================================================
@@ -777,6 +778,18 @@ LINPHONE_PUBLIC LinphoneStatus linphone_call_send_info_message(LinphoneCall *cal
 **/
 LINPHONE_PUBLIC LinphoneCallStats *linphone_call_get_stats(LinphoneCall *call, LinphoneStreamType type);
 
+/**
+ * Copy the last published statistics of a stream of the call.
+ * Unlike linphone_call_get_stats(), it does not use the core and may be called from any thread, as long as the
+ * application holds a reference on the call.
+ * @param call the call
+ * @param type the stream type
+ * @param snapshot the structure to fill
+ * @return TRUE if the stream has published statistics, FALSE otherwise
+ * @donotwrap
+**/
+LINPHONE_PUBLIC bool_t linphone_call_get_stats_snapshot(const LinphoneCall *call, LinphoneStreamType type, LinphoneCallStatsSnapshot *snapshot);
+
 LINPHONE_PUBLIC LinphoneCallStats *linphone_call_get_audio_stats(LinphoneCall *call);
 
 LINPHONE_PUBLIC LinphoneCallStats *linphone_call_get_video_stats(LinphoneCall *call);
@@ -43,6 +43,13 @@ extern "C" {
 **/
 LINPHONE_PUBLIC const char * linphone_call_log_get_call_id(const LinphoneCallLog *cl);
 
+/**
+ * Get the identifier of the call log in the call history database.
+ * @param[in] cl #LinphoneCallLog object
+ * @return The storage identifier, or 0 if the call log is not stored in a database.
+**/
+LINPHONE_PUBLIC unsigned int linphone_call_log_get_storage_id(const LinphoneCallLog *cl);
+
 /**
  * Get the direction of the call.
  * @param[in] cl #LinphoneCallLog object
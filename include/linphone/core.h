@@ -155,6 +155,40 @@ LINPHONE_PUBLIC int linphone_core_get_unread_chat_message_count_from_local (
  */
 LINPHONE_PUBLIC int linphone_core_get_unread_chat_message_count_from_active_locals (const LinphoneCore *lc);
 
+/**
+ * Enable or disable the collection of metrics (counters, gauges and latency histograms) on the hot paths of the library:
+ * message database transactions, SIP requests and responses, chat messages, contact searches, presence notifications
+ * and core iterations.
+ * Metrics are shared by all the cores of the process. When disabled, collecting them costs a single test of a flag.
+ * The setting is saved in the [misc] metrics_enabled entry and restored when the core starts.
+ * @param[in] lc #LinphoneCore object
+ * @param[in] enable TRUE to collect the metrics, FALSE otherwise
+ */
+LINPHONE_PUBLIC void linphone_core_enable_metrics (LinphoneCore *lc, bool_t enable);
+
+/**
+ * Tells whether the metrics are being collected.
+ * @param[in] lc #LinphoneCore object
+ * @return TRUE if the metrics are collected, FALSE otherwise
+ */
+LINPHONE_PUBLIC bool_t linphone_core_metrics_enabled (const LinphoneCore *lc);
+
+/**
+ * Get a textual report of the metrics collected so far, one line per metric:
+ * "counter <name> <value>", "gauge <name> <value>" or
+ * "histogram <name> count=<n> sum_us=<n> min_us=<n> max_us=<n> p50_us=<n> p90_us=<n> p99_us=<n>".
+ * Percentiles are the upper bounds of power of two buckets.
+ * @param[in] lc #LinphoneCore object
+ * @return The report, to be freed with ms_free()
+ */
+LINPHONE_PUBLIC char *linphone_core_get_metrics_report (const LinphoneCore *lc);
+
+/**
+ * Set the counters and histograms of the metrics back to zero, gauges keep their value.
+ * @param[in] lc #LinphoneCore object
+ */
+LINPHONE_PUBLIC void linphone_core_reset_metrics (LinphoneCore *lc);
+
 /**
  * @}
  */
@@ -3413,6 +3447,25 @@ LINPHONE_PUBLIC bctbx_list_t *linphone_core_get_call_history_2(
 	const LinphoneAddress *local_addr
 );
 
+/**
+ * Get a page of the call logs (past calls), most recent first.
+ * Unlike linphone_core_get_call_logs, which only keeps the most recent calls in memory, this allows to browse the whole history.
+ * It is your responsibility to unref the logs and free this list once you are done using it.
+ * @param[in] lc #LinphoneCore object.
+ * @param[in] peer_addr Only return the calls with this remote #LinphoneAddress, or NULL for all of them.
+ * @param[in] local_addr Only return the calls with this local #LinphoneAddress, or NULL for all of them.
+ * @param[in] before_id Only return the calls older than the one with this storage id (see linphone_call_log_get_storage_id), or 0 to start from the most recent one.
+ * @param[in] limit The maximum number of call logs to return, or a negative value for no limit.
+ * @return \bctbx_list{LinphoneCallLog} \onTheFlyList
+**/
+LINPHONE_PUBLIC bctbx_list_t *linphone_core_get_call_history_page(
+	LinphoneCore *lc,
+	const LinphoneAddress *peer_addr,
+	const LinphoneAddress *local_addr,
+	unsigned int before_id,
+	int limit
+);
+
 /**
  * Get the latest outgoing call log.
  * @param[in] lc #LinphoneCore object
@@ -4355,6 +4408,19 @@ LINPHONE_PUBLIC int linphone_core_get_calls_nb(const LinphoneCore *lc);
 **/
 LINPHONE_PUBLIC const bctbx_list_t *linphone_core_get_calls(LinphoneCore *lc);
 
+/**
+ * Copy the last published statistics of all the media streams of the running calls, for dashboards.
+ * It does not use the core and may be called from any thread while the core is started.
+ * The number of streams that can be exported is set by the [misc] call_stats_snapshot_capacity setting.
+ * @param[in] lc The #LinphoneCore object
+ * @param[out] snapshots Array to fill
+ * @param[in] max_count Number of elements of the array
+ * @return The number of snapshots copied
+ * @ingroup call_control
+ * @donotwrap
+**/
+LINPHONE_PUBLIC int linphone_core_get_call_stats_snapshots(const LinphoneCore *lc, LinphoneCallStatsSnapshot *snapshots, int max_count);
+
 LINPHONE_PUBLIC LinphoneGlobalState linphone_core_get_global_state(const LinphoneCore *lc);
 
 /**
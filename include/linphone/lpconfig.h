@@ -202,6 +202,32 @@ LINPHONE_PUBLIC void linphone_config_set_float(LinphoneConfig *lpconfig,const ch
 **/
 LINPHONE_PUBLIC LinphoneStatus linphone_config_sync(LinphoneConfig *lpconfig);
 
+/**
+ * Enables or disables write-behind persistence.
+ * When enabled, linphone_config_sync() only takes a snapshot of the configuration and returns; the file is written
+ * by a background thread and replaced atomically. Successive syncs not yet written are coalesced into one write.
+ * Disabling it writes what is still pending before returning.
+ * Has no effect on configurations without a file or read-only ones.
+**/
+LINPHONE_PUBLIC void linphone_config_enable_write_behind(LinphoneConfig *lpconfig, bool_t enable);
+
+/**
+ * Returns whether write-behind persistence is enabled.
+**/
+LINPHONE_PUBLIC bool_t linphone_config_write_behind_enabled(const LinphoneConfig *lpconfig);
+
+/**
+ * Blocks until all the snapshots handed over to the background writer are on disk.
+ * Does nothing if write-behind is not enabled.
+**/
+LINPHONE_PUBLIC void linphone_config_wait_for_pending_writes(LinphoneConfig *lpconfig);
+
+/**
+ * Syncs uncommitted modifications, if any, and waits until they are on disk.
+ * @return 0 if successful, -1 if the file could not be written.
+**/
+LINPHONE_PUBLIC LinphoneStatus linphone_config_flush(LinphoneConfig *lpconfig);
+
 /**
  * Returns 1 if a given section is present in the configuration.
 **/
@@ -414,6 +440,10 @@ LINPHONE_PUBLIC void lp_config_load_dict_to_section( LpConfig* lpconfig, const c
 #define lp_config_set_int64 linphone_config_set_int64
 #define lp_config_set_float linphone_config_set_float
 #define lp_config_sync linphone_config_sync
+#define lp_config_enable_write_behind linphone_config_enable_write_behind
+#define lp_config_write_behind_enabled linphone_config_write_behind_enabled
+#define lp_config_wait_for_pending_writes linphone_config_wait_for_pending_writes
+#define lp_config_flush linphone_config_flush
 #define lp_config_has_section linphone_config_has_section
 #define lp_config_clean_section linphone_config_clean_section
 #define lp_config_has_entry linphone_config_has_entry
@@ -595,6 +595,10 @@ LinphoneCallStats *linphone_call_get_stats (LinphoneCall *call, LinphoneStreamTy
 	return L_GET_CPP_PTR_FROM_C_OBJECT(call)->getStats(type);
 }
 
+bool_t linphone_call_get_stats_snapshot (const LinphoneCall *call, LinphoneStreamType type, LinphoneCallStatsSnapshot *snapshot) {
+	return L_GET_CPP_PTR_FROM_C_OBJECT(call)->getStatsSnapshot(type, *snapshot);
+}
+
 LinphoneCallStats *linphone_call_get_audio_stats (LinphoneCall *call) {
 	return L_GET_CPP_PTR_FROM_C_OBJECT(call)->getAudioStats();
 }
@@ -17,6 +17,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
+#include <cstring>
+
 #include "linphone/api/c-content.h"
 #include "linphone/wrapper_utils.h"
 
@@ -351,16 +353,21 @@ SalBodyHandler *sal_body_handler_from_content (const LinphoneContent *content, b
 
 	SalBodyHandler *bodyHandler;
 	LinphonePrivate::ContentType contentType = L_GET_CPP_PTR_FROM_C_OBJECT(content)->getContentType();
+	const LinphonePrivate::SharedBuffer &body = L_GET_CPP_PTR_FROM_C_OBJECT(content)->getBodyBuffer();
 	if (contentType.isMultipart() && parseMultipart) {
-		size_t size = linphone_content_get_size(content);
-		char *buffer = bctbx_strdup(L_GET_CPP_PTR_FROM_C_OBJECT(content)->getBodyAsUtf8String().c_str());
+		// The parser needs a null-terminated buffer.
+		const string buffer = body.asString();
 		const char *boundary = L_STRING_TO_C(contentType.getParameter("boundary").getValue());
-		belle_sip_multipart_body_handler_t *bh = belle_sip_multipart_body_handler_new_from_buffer(buffer, size, boundary);
+		belle_sip_multipart_body_handler_t *bh = belle_sip_multipart_body_handler_new_from_buffer(buffer.c_str(), buffer.size(), boundary);
 		bodyHandler = reinterpret_cast<SalBodyHandler *>(BELLE_SIP_BODY_HANDLER(bh));
-		bctbx_free(buffer);
 	} else {
+		// Copied once from the shared body, the string buffer cache of the content is left untouched.
+		char *data = static_cast<char *>(belle_sip_malloc(body.size() + 1));
+		if (!body.empty())
+			memcpy(data, body.data(), body.size());
+		data[body.size()] = '\0';
 		bodyHandler = sal_body_handler_new();
-		sal_body_handler_set_data(bodyHandler, belle_sip_strdup(linphone_content_get_string_buffer(content)));
+		sal_body_handler_set_data(bodyHandler, data);
 	}
 
 	for (const auto &header : L_GET_CPP_PTR_FROM_C_OBJECT(content)->getHeaders()) {
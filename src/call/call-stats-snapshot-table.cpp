@@ -0,0 +1,129 @@
+/*
+ * call-stats-snapshot-table.cpp
+ * Copyright (C) 2010-2018 Belledonne Communications SARL
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <cstring>
+
+#include "call-stats-snapshot-table.h"
+
+// =============================================================================
+
+using namespace std;
+
+LINPHONE_BEGIN_NAMESPACE
+
+CallStatsSnapshotTable::CallStatsSnapshotTable (size_t capacity) : capacity(capacity), slots(new Slot[capacity]) {
+	for (size_t i = capacity; i > 0; i--) {
+		Slot &slot = slots[i - 1];
+		slot.sequence.store(0, memory_order_relaxed);
+		for (size_t j = 0; j < WordCount; j++)
+			slot.words[j].store(0, memory_order_relaxed);
+		// Keep the first slots on top so that they are used first.
+		freeSlots.push_back(static_cast<int>(i - 1));
+	}
+}
+
+// -----------------------------------------------------------------------------
+
+int CallStatsSnapshotTable::acquire (uint64_t &generation) {
+	if (freeSlots.empty())
+		return -1;
+	int slot = freeSlots.back();
+	freeSlots.pop_back();
+	generation = ++lastGeneration;
+	return slot;
+}
+
+void CallStatsSnapshotTable::release (int slot) {
+	if ((slot < 0) || (static_cast<size_t>(slot) >= capacity))
+		return;
+	Entry entry;
+	memset(&entry, 0, sizeof(entry));
+	write(slots[static_cast<size_t>(slot)], entry);
+	freeSlots.push_back(slot);
+}
+
+void CallStatsSnapshotTable::publish (int slot, uint64_t generation, const LinphoneCallStatsSnapshot &snapshot) {
+	if ((slot < 0) || (static_cast<size_t>(slot) >= capacity))
+		return;
+	Entry entry;
+	// Clear the padding too, so that it does not leak stack contents to the readers.
+	memset(&entry, 0, sizeof(entry));
+	entry.snapshot = snapshot;
+	entry.generation = generation;
+	entry.inUse = true;
+	write(slots[static_cast<size_t>(slot)], entry);
+}
+
+// -----------------------------------------------------------------------------
+
+bool CallStatsSnapshotTable::read (int slot, uint64_t generation, LinphoneCallStatsSnapshot &snapshot) const {
+	if ((slot < 0) || (static_cast<size_t>(slot) >= capacity))
+		return false;
+	Entry entry;
+	readEntry(static_cast<size_t>(slot), entry);
+	if (!entry.inUse || (entry.generation != generation))
+		return false;
+	snapshot = entry.snapshot;
+	return true;
+}
+
+size_t CallStatsSnapshotTable::readAll (LinphoneCallStatsSnapshot *snapshots, size_t maxCount) const {
+	size_t count = 0;
+	for (size_t i = 0; (i < capacity) && (count < maxCount); i++) {
+		Entry entry;
+		readEntry(i, entry);
+		if (entry.inUse)
+			snapshots[count++] = entry.snapshot;
+	}
+	return count;
+}
+
+// -----------------------------------------------------------------------------
+
+void CallStatsSnapshotTable::write (Slot &slot, const Entry &entry) {
+	uint64_t words[WordCount] = { 0 };
+	memcpy(words, &entry, sizeof(entry));
+	uint32_t sequence = slot.sequence.load(memory_order_relaxed);
+	// An odd sequence tells the readers that the slot is being written.
+	slot.sequence.store(sequence + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	for (size_t i = 0; i < WordCount; i++)
+		slot.words[i].store(words[i], memory_order_relaxed);
+	slot.sequence.store(sequence + 2, memory_order_release);
+}
+
+bool CallStatsSnapshotTable::tryRead (const Slot &slot, Entry &entry) {
+	uint64_t words[WordCount];
+	uint32_t sequence = slot.sequence.load(memory_order_acquire);
+	if (sequence & 1)
+		return false;
+	for (size_t i = 0; i < WordCount; i++)
+		words[i] = slot.words[i].load(memory_order_relaxed);
+	atomic_thread_fence(memory_order_acquire);
+	if (slot.sequence.load(memory_order_relaxed) != sequence)
+		return false;
+	memcpy(&entry, words, sizeof(entry));
+	return true;
+}
+
+void CallStatsSnapshotTable::readEntry (size_t slot, Entry &entry) const {
+	while (!tryRead(slots[slot], entry)) {}
+}
+
+LINPHONE_END_NAMESPACE
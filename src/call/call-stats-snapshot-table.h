@@ -0,0 +1,85 @@
+/*
+ * call-stats-snapshot-table.h
+ * Copyright (C) 2010-2018 Belledonne Communications SARL
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _L_CALL_STATS_SNAPSHOT_TABLE_H_
+#define _L_CALL_STATS_SNAPSHOT_TABLE_H_
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "linphone/api/c-call-stats.h"
+#include "linphone/utils/general.h"
+
+// =============================================================================
+
+LINPHONE_BEGIN_NAMESPACE
+
+/*
+ * Fixed set of slots holding the last published stats of the media streams of the calls of a core.
+ * Slots are acquired, published and released from the core thread only. They can be read from any thread without
+ * locking: each slot is a sequence lock, a reader copies the slot again if the writer touched it meanwhile.
+ * Every acquisition gets a new generation, stored in the slot, so that a reader holding the index of a slot that has
+ * been released and reused meanwhile does not read the stats of another call.
+ */
+class CallStatsSnapshotTable {
+public:
+	explicit CallStatsSnapshotTable (size_t capacity);
+
+	// Returns -1 if all the slots are in use, otherwise generation is set to the one to publish and read with.
+	int acquire (uint64_t &generation);
+	void release (int slot);
+	void publish (int slot, uint64_t generation, const LinphoneCallStatsSnapshot &snapshot);
+
+	// Returns false if the slot is not in use or belongs to another generation.
+	bool read (int slot, uint64_t generation, LinphoneCallStatsSnapshot &snapshot) const;
+	// Copies the snapshots of all the slots in use, returns how many were copied.
+	size_t readAll (LinphoneCallStatsSnapshot *snapshots, size_t maxCount) const;
+
+	size_t getCapacity () const {
+		return capacity;
+	}
+
+private:
+	struct Entry {
+		LinphoneCallStatsSnapshot snapshot;
+		uint64_t generation;
+		bool inUse;
+	};
+
+	static constexpr size_t WordCount = (sizeof(Entry) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+	struct Slot {
+		std::atomic<uint32_t> sequence;
+		std::atomic<uint64_t> words[WordCount];
+	};
+
+	static void write (Slot &slot, const Entry &entry);
+	static bool tryRead (const Slot &slot, Entry &entry);
+	void readEntry (size_t slot, Entry &entry) const;
+
+	size_t capacity;
+	std::unique_ptr<Slot[]> slots;
+	std::vector<int> freeSlots;
+	uint64_t lastGeneration = 0;
+};
+
+LINPHONE_END_NAMESPACE
+
+#endif // ifndef _L_CALL_STATS_SNAPSHOT_TABLE_H_
@@ -857,6 +857,11 @@ LinphoneCallStats *Call::getStats (LinphoneStreamType type) const {
 	return static_pointer_cast<const MediaSession>(d->getActiveSession())->getStats(type);
 }
 
+bool Call::getStatsSnapshot (LinphoneStreamType type, LinphoneCallStatsSnapshot &snapshot) const {
+	L_D();
+	return static_pointer_cast<const MediaSession>(d->getActiveSession())->getStatsSnapshot(type, snapshot);
+}
+
 int Call::getStreamCount () const {
 	L_D();
 	return static_pointer_cast<MediaSession>(d->getActiveSession())->getStreamCount();
@@ -108,6 +108,7 @@ public:
 	float getSpeakerVolumeGain () const;
 	CallSession::State getState () const;
 	LinphoneCallStats *getStats (LinphoneStreamType type) const;
+	bool getStatsSnapshot (LinphoneStreamType type, LinphoneCallStatsSnapshot &snapshot) const;
 	int getStreamCount () const;
 	MSFormatType getStreamType (int streamIndex) const;
 	LinphoneCallStats *getTextStats () const;
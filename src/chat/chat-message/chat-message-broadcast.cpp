@@ -0,0 +1,198 @@
+/*
+ * chat-message-broadcast.cpp
+ * Copyright (C) 2010-2018 Belledonne Communications SARL
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include <algorithm>
+
+#include "private.h"
+
+#include "chat/chat-message/chat-message-p.h"
+#include "chat/chat-room/abstract-chat-room-p.h"
+#include "core/core-p.h"
+#include "event-log/conference/conference-chat-message-event.h"
+#include "logger/logger.h"
+#include "logger/metrics.h"
+
+#include "chat-message-broadcast.h"
+
+// =============================================================================
+
+using namespace std;
+
+LINPHONE_BEGIN_NAMESPACE
+
+namespace {
+	constexpr int DefaultRate = 50;
+	constexpr int DefaultDbBatchSize = 500;
+	constexpr unsigned int PacingPeriodMs = 20;
+
+	size_t &getStatusCounter (ChatMessageBroadcast::Status &status, ChatMessage::State state) {
+		switch (state) {
+			case ChatMessage::State::Idle:
+				return status.queued;
+			case ChatMessage::State::Delivered:
+			case ChatMessage::State::DeliveredToUser:
+			case ChatMessage::State::Displayed:
+				return status.delivered;
+			case ChatMessage::State::NotDelivered:
+			case ChatMessage::State::FileTransferError:
+				return status.notDelivered;
+			default:
+				return status.inProgress;
+		}
+	}
+}
+
+ChatMessageBroadcast::ChatMessageBroadcast (const shared_ptr<Core> &core, vector<shared_ptr<ChatMessage>> messages) :
+	CoreAccessor(core), messages(move(messages)) {
+	status.total = status.queued = this->messages.size();
+}
+
+ChatMessageBroadcast::~ChatMessageBroadcast () {
+	stopPacing();
+}
+
+// -----------------------------------------------------------------------------
+
+void ChatMessageBroadcast::setStatusChangedCallback (StatusChangedCallback callback) {
+	statusChangedCallback = move(callback);
+}
+
+void ChatMessageBroadcast::cancel () {
+	shared_ptr<ChatMessageBroadcast> ref = shared_from_this();
+
+	stopPacing();
+	size_t first = nextMessage;
+	nextMessage = messages.size();
+	if (first < messages.size())
+		lInfo() << "Chat message broadcast " << this << " canceled, " << messages.size() - first << " message(s) not sent";
+	for (size_t i = first; i < messages.size(); i++)
+		messages[i]->getPrivate()->setState(ChatMessage::State::NotDelivered);
+}
+
+// -----------------------------------------------------------------------------
+
+void ChatMessageBroadcast::start () {
+	LinphoneCore *lc = getCore()->getCCore();
+	lInfo() << "Chat message broadcast " << this << " started to " << messages.size() << " peer(s)";
+	L_METRIC_COUNTER_ADD("chat.broadcast.messages", messages.size());
+
+	shared_ptr<ChatMessageBroadcast> broadcast = shared_from_this();
+	for (const auto &message : messages)
+		message->getPrivate()->broadcast = broadcast;
+	storeChatMessages();
+
+	rate = max(lp_config_get_int(lc->config, "misc", "chat_broadcast_rate", DefaultRate), 0);
+	maxCredit = max(1.0, rate * PacingPeriodMs / 1000.0);
+	credit = 1;
+	lastRefillTime = chrono::steady_clock::now();
+	sendPendingChatMessages();
+	if (nextMessage < messages.size())
+		pacingTimer = lc->sal->createTimer(onPacingTimer, this, PacingPeriodMs, "chat message broadcast");
+}
+
+void ChatMessageBroadcast::storeChatMessages () {
+	shared_ptr<Core> core = getCore();
+	LinphoneCore *lc = core->getCCore();
+	// Same as ChatMessagePrivate::storeInDb(), the server does not store its messages.
+	if (linphone_core_conference_server_enabled(lc) || !core->getPrivate()->mainDb->isInitialized())
+		return;
+
+	size_t batchSize = size_t(max(lp_config_get_int(lc->config, "misc", "chat_broadcast_db_batch_size", DefaultDbBatchSize), 1));
+	time_t creationTime = ms_time(nullptr);
+	auto it = messages.cbegin();
+	while (it != messages.cend()) {
+		list<shared_ptr<EventLog>> eventLogs;
+		for (; it != messages.cend() && eventLogs.size() < batchSize; ++it) {
+			ChatMessagePrivate *dChatMessage = (*it)->getPrivate();
+			if (!dChatMessage->toBeStored)
+				continue;
+			dChatMessage->setTime(creationTime);
+			eventLogs.push_back(make_shared<ConferenceChatMessageEvent>(creationTime, *it));
+		}
+
+		// The messages of a failed batch have no storage yet, they are stored one by one when sent.
+		if (eventLogs.empty() || !core->getPrivate()->mainDb->addEvents(eventLogs))
+			continue;
+
+		for (const auto &eventLog : eventLogs) {
+			shared_ptr<AbstractChatRoom> chatRoom = static_pointer_cast<ConferenceChatMessageEvent>(eventLog)->getChatMessage()->getChatRoom();
+			AbstractChatRoomPrivate *dChatRoom = chatRoom->getPrivate();
+			dChatRoom->setLastUpdateTime(creationTime);
+			// Keep event in transient to be able to store in database state changes.
+			dChatRoom->addTransientEvent(eventLog);
+		}
+	}
+}
+
+void ChatMessageBroadcast::sendPendingChatMessages () {
+	if (rate > 0) {
+		chrono::steady_clock::time_point now = chrono::steady_clock::now();
+		credit = min(credit + chrono::duration<double>(now - lastRefillTime).count() * rate, maxCredit);
+		lastRefillTime = now;
+	}
+
+	while (nextMessage < messages.size() && (rate <= 0 || credit >= 1)) {
+		credit -= 1;
+		messages[nextMessage++]->send();
+	}
+
+	if (nextMessage == messages.size())
+		stopPacing();
+}
+
+void ChatMessageBroadcast::stopPacing () {
+	if (!pacingTimer)
+		return;
+	LinphoneCore *lc = getCore()->getCCore();
+	if (lc->sal)
+		lc->sal->cancelTimer(pacingTimer);
+	belle_sip_object_unref(pacingTimer);
+	pacingTimer = nullptr;
+}
+
+// -----------------------------------------------------------------------------
+
+void ChatMessageBroadcast::onChatMessageStateChanged (ChatMessage::State oldState, ChatMessage::State newState) {
+	size_t &oldCounter = getStatusCounter(status, oldState);
+	size_t &newCounter = getStatusCounter(status, newState);
+	if (&oldCounter == &newCounter)
+		return;
+	oldCounter--;
+	newCounter++;
+
+	if (statusChangedCallback)
+		statusChangedCallback(status);
+
+	if (isDone()) {
+		lInfo() << "Chat message broadcast " << this << " done, " << status.delivered << " message(s) delivered and " <<
+			status.notDelivered << " not delivered";
+		L_METRIC_COUNTER_ADD("chat.broadcast.not_delivered", status.notDelivered);
+		getCore()->getPrivate()->chatMessageBroadcasts.remove(shared_from_this());
+	}
+}
+
+int ChatMessageBroadcast::onPacingTimer (void *data, unsigned int revents) {
+	// Sending a message may change the status and release the broadcast.
+	shared_ptr<ChatMessageBroadcast> broadcast = static_cast<ChatMessageBroadcast *>(data)->shared_from_this();
+	broadcast->sendPendingChatMessages();
+	return broadcast->pacingTimer ? BELLE_SIP_CONTINUE : BELLE_SIP_STOP;
+}
+
+LINPHONE_END_NAMESPACE
@@ -0,0 +1,110 @@
+/*
+ * chat-message-broadcast.h
+ * Copyright (C) 2010-2018 Belledonne Communications SARL
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef _L_CHAT_MESSAGE_BROADCAST_H_
+#define _L_CHAT_MESSAGE_BROADCAST_H_
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <belle-sip/mainloop.h>
+
+#include "chat/chat-message/chat-message.h"
+#include "core/core-accessor.h"
+
+// =============================================================================
+
+LINPHONE_BEGIN_NAMESPACE
+
+/*
+ * Same content sent to many peers, one chat message in the basic chat room of each of them, see
+ * Core::broadcastChatMessage(). The messages are stored in a few large transactions, then sent at the rate set by
+ * [misc] chat_broadcast_rate (messages per second, 0 to send them all at once). The status gathers the states of
+ * all the messages.
+ */
+class LINPHONE_PUBLIC ChatMessageBroadcast :
+	public std::enable_shared_from_this<ChatMessageBroadcast>,
+	public CoreAccessor {
+	friend class ChatMessagePrivate;
+	friend class Core;
+
+public:
+	struct Status {
+		size_t total = 0;
+		// Not sent yet.
+		size_t queued = 0;
+		size_t inProgress = 0;
+		size_t delivered = 0;
+		size_t notDelivered = 0;
+	};
+
+	typedef std::function<void (const Status &)> StatusChangedCallback;
+
+	ChatMessageBroadcast (const std::shared_ptr<Core> &core, std::vector<std::shared_ptr<ChatMessage>> messages);
+	~ChatMessageBroadcast ();
+
+	const std::vector<std::shared_ptr<ChatMessage>> &getChatMessages () const {
+		return messages;
+	}
+
+	const Status &getStatus () const {
+		return status;
+	}
+
+	// True once each message is delivered or not delivered.
+	bool isDone () const {
+		return status.delivered + status.notDelivered == status.total;
+	}
+
+	void setStatusChangedCallback (StatusChangedCallback callback);
+
+	// The messages not sent yet are set as not delivered, they can be resent one by one.
+	void cancel ();
+
+private:
+	void start ();
+	void storeChatMessages ();
+	void sendPendingChatMessages ();
+	void stopPacing ();
+
+	void onChatMessageStateChanged (ChatMessage::State oldState, ChatMessage::State newState);
+
+	static int onPacingTimer (void *data, unsigned int revents);
+
+	std::vector<std::shared_ptr<ChatMessage>> messages;
+	size_t nextMessage = 0;
+	Status status;
+	StatusChangedCallback statusChangedCallback;
+
+	// Token bucket: each message sent takes one credit, credits are refilled at the rate and up to maxCredit.
+	double rate = 0;
+	double credit = 1;
+	double maxCredit = 1;
+	std::chrono::steady_clock::time_point lastRefillTime;
+	belle_sip_source_t *pacingTimer = nullptr;
+
+	L_DISABLE_COPY(ChatMessageBroadcast);
+};
+
+LINPHONE_END_NAMESPACE
+
+#endif // ifndef _L_CHAT_MESSAGE_BROADCAST_H_
@@ -41,7 +41,11 @@
 
 LINPHONE_BEGIN_NAMESPACE
 
+class ChatMessageBroadcast;
+class ChatMessageSendPipeline;
+
 class ChatMessagePrivate : public ObjectPrivate {
+	friend class ChatMessageBroadcast;
 	friend class CpimChatMessageModifier;
 	friend class EncryptionChatMessageModifier;
 	friend class MultipartChatMessageModifier;
@@ -190,6 +194,12 @@ public:
 	LinphoneReason receive ();
 	void send ();
 
+	// Used by the send pipeline: prepareSend() does what send() does first, as soon as the message is queued.
+	// encodeInPipeline() starts the CPIM encoding with its serialization on the pipeline workers, encoded is called
+	// once it is done. Returns false if the message must be encoded by send() itself.
+	void prepareSend ();
+	bool encodeInPipeline (ChatMessageSendPipeline &pipeline, const std::function<void ()> &encoded);
+
 	void storeInDb ();
 	void updateInDb ();
 
@@ -255,6 +265,8 @@ private:
 	std::list<Content *> contents;
 
 	bool encryptionPrevented = false;
+	// Set if the message is part of a broadcast, told of each state change.
+	std::weak_ptr<ChatMessageBroadcast> broadcast;
 	mutable bool contentsNotLoadedFromDatabase = false;
 	L_DECLARE_PUBLIC(ChatMessage);
 };
@@ -0,0 +1,213 @@
+/*
+ * chat-message-send-pipeline.cpp
+ * Copyright (C) 2010-2018 Belledonne Communications SARL
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <algorithm>
+
+#include "chat/chat-message/chat-message-p.h"
+#include "chat/chat-room/abstract-chat-room.h"
+#include "logger/logger.h"
+#include "logger/metrics.h"
+#include "utils/worker-pool.h"
+
+#include "chat-message-send-pipeline.h"
+
+// =============================================================================
+
+using namespace std;
+
+LINPHONE_BEGIN_NAMESPACE
+
+ChatMessageSendPipeline::ChatMessageSendPipeline (size_t threadCount, size_t maxInFlight) :
+	workers(new WorkerPool(threadCount)), maxInFlight(max(maxInFlight, size_t(1))) {
+	lInfo() << "Chat message send pipeline started with " << workers->getThreadCount() << " worker(s) and at most "
+		<< this->maxInFlight << " message(s) in flight";
+}
+
+ChatMessageSendPipeline::~ChatMessageSendPipeline () {
+	cancel();
+}
+
+// -----------------------------------------------------------------------------
+
+void ChatMessageSendPipeline::enqueue (const shared_ptr<ChatMessage> &message) {
+	shared_ptr<AbstractChatRoom> chatRoom = message->getChatRoom();
+	if (!chatRoom)
+		return;
+
+	message->getPrivate()->prepareSend();
+
+	shared_ptr<Entry> entry = make_shared<Entry>();
+	entry->message = message;
+	entry->conferenceId = chatRoom->getConferenceId();
+	entry->queueTime = chrono::steady_clock::now();
+	waitingEntries.push_back(entry);
+	L_METRIC_COUNTER_INCREMENT("chat.send_pipeline.queued");
+
+	startEntries();
+}
+
+void ChatMessageSendPipeline::runInBackground (
+	function<void ()> job,
+	function<void ()> completion,
+	const shared_ptr<ChatMessage> &inFlightMessage
+) {
+	uint64_t jobId = ++lastJobId;
+	Completion &pending = completions[jobId];
+	pending.function = move(completion);
+	pending.inFlightMessage = inFlightMessage;
+	if (inFlightMessage) {
+		inFlight++;
+		updateGauges();
+	}
+	L_METRIC_COUNTER_INCREMENT("chat.send_pipeline.jobs");
+
+	// The workers are stopped before the pipeline is destroyed, see the destructor.
+	workers->post([this, job, jobId] {
+		{
+			L_METRIC_TIME_SCOPE("chat.send_pipeline.job");
+			job();
+		}
+		lock_guard<mutex> lock(doneJobsMutex);
+		doneJobIds.push_back(jobId);
+	});
+}
+
+void ChatMessageSendPipeline::processDoneJobs () {
+	vector<uint64_t> jobIds;
+	{
+		lock_guard<mutex> lock(doneJobsMutex);
+		if (doneJobIds.empty())
+			return;
+		jobIds.swap(doneJobIds);
+	}
+
+	// A completion may destroy the pipeline along with its core, keep it until the end.
+	shared_ptr<ChatMessageSendPipeline> pipeline = shared_from_this();
+	for (uint64_t jobId : jobIds)
+		onJobDone(jobId);
+}
+
+void ChatMessageSendPipeline::cancel () {
+	// No job can hand over its result once the workers are stopped.
+	workers = nullptr;
+
+	vector<shared_ptr<ChatMessage>> messages;
+	for (const auto &entry : waitingEntries)
+		messages.push_back(entry->message);
+	for (const auto &chatRoomEntries : startedEntries) {
+		for (const auto &entry : chatRoomEntries.second)
+			messages.push_back(entry->message);
+	}
+	for (const auto &completion : completions) {
+		if (completion.second.inFlightMessage)
+			messages.push_back(completion.second.inFlightMessage);
+	}
+	waitingEntries.clear();
+	startedEntries.clear();
+	completions.clear();
+	inFlight = 0;
+	{
+		lock_guard<mutex> lock(doneJobsMutex);
+		doneJobIds.clear();
+	}
+	updateGauges();
+
+	if (messages.empty())
+		return;
+	lInfo() << "Chat message send pipeline canceled, " << messages.size() << " message(s) not sent";
+	for (const auto &message : messages)
+		message->getPrivate()->setState(ChatMessage::State::NotDelivered);
+}
+
+// -----------------------------------------------------------------------------
+
+void ChatMessageSendPipeline::startEntries () {
+	while (inFlight < maxInFlight && !waitingEntries.empty()) {
+		shared_ptr<Entry> entry = waitingEntries.front();
+		waitingEntries.pop_front();
+		inFlight++;
+		startedEntries[entry->conferenceId].push_back(entry);
+
+		bool inBackground = entry->message->getPrivate()->encodeInPipeline(*this, [this, entry] {
+			entry->encoded = true;
+			sendEncodedEntries(entry->conferenceId);
+			startEntries();
+		});
+		if (!inBackground) {
+			entry->encoded = true;
+			sendEncodedEntries(entry->conferenceId);
+		}
+	}
+	updateGauges();
+}
+
+void ChatMessageSendPipeline::sendEncodedEntries (const ConferenceId &conferenceId) {
+	// Sending may queue other messages, the entries are looked up again after each one.
+	for (;;) {
+		auto it = startedEntries.find(conferenceId);
+		if (it == startedEntries.end())
+			return;
+		if (it->second.empty() || !it->second.front()->encoded) {
+			if (it->second.empty())
+				startedEntries.erase(it);
+			return;
+		}
+
+		shared_ptr<Entry> entry = it->second.front();
+		it->second.pop_front();
+		if (it->second.empty())
+			startedEntries.erase(it);
+		inFlight--;
+
+		L_METRIC_HISTOGRAM_RECORD("chat.send_pipeline.queue_time", static_cast<uint64_t>(
+			chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - entry->queueTime).count()
+		));
+		entry->message->getPrivate()->send();
+		L_METRIC_COUNTER_INCREMENT("chat.send_pipeline.sent");
+	}
+}
+
+void ChatMessageSendPipeline::onJobDone (uint64_t jobId) {
+	auto it = completions.find(jobId);
+	if (it == completions.end())
+		return;
+	it->second.jobDone = true;
+
+	// A completion may post other jobs, the map is looked up again after each one.
+	for (;;) {
+		it = completions.begin();
+		if (it == completions.end() || !it->second.jobDone)
+			return;
+		function<void ()> completion = move(it->second.function);
+		bool countInFlight = !!it->second.inFlightMessage;
+		completions.erase(it);
+		completion();
+		if (countInFlight) {
+			inFlight--;
+			startEntries();
+		}
+	}
+}
+
+void ChatMessageSendPipeline::updateGauges () const {
+	L_METRIC_GAUGE_SET("chat.send_pipeline.in_flight", static_cast<int64_t>(inFlight));
+	L_METRIC_GAUGE_SET("chat.send_pipeline.waiting", static_cast<int64_t>(waitingEntries.size()));
+}
+
+LINPHONE_END_NAMESPACE
@@ -0,0 +1,112 @@
+/*
+ * chat-message-send-pipeline.h
+ * Copyright (C) 2010-2018 Belledonne Communications SARL
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _L_CHAT_MESSAGE_SEND_PIPELINE_H_
+#define _L_CHAT_MESSAGE_SEND_PIPELINE_H_
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "conference/conference-id.h"
+
+// =============================================================================
+
+LINPHONE_BEGIN_NAMESPACE
+
+class ChatMessage;
+class WorkerPool;
+
+/*
+ * Sends the chat messages in stages: the CPU heavy parts of their encoding (CPIM serialization, LIME envelope)
+ * run on worker threads while the modifiers, the database and the SIP requests stay on the core thread.
+ * Messages of a chat room leave in the order they were queued, and at most maxInFlight messages are being
+ * encoded or waiting for their turn at a time, the others wait in the queue.
+ * The workers hand their finished jobs over through a queue drained by the core thread when it iterates.
+ */
+class ChatMessageSendPipeline : public std::enable_shared_from_this<ChatMessageSendPipeline> {
+public:
+	ChatMessageSendPipeline (size_t threadCount, size_t maxInFlight);
+	~ChatMessageSendPipeline ();
+
+	void enqueue (const std::shared_ptr<ChatMessage> &message);
+
+	// Runs the job on a worker thread, then the completion on the core thread. Completions run in the order the
+	// jobs were posted. The job must not touch objects owned by the core thread.
+	// A job posted once its message left the queue, like the LIME envelope, passes that message to take a
+	// place among the messages in flight until its completion has run.
+	void runInBackground (
+		std::function<void ()> job,
+		std::function<void ()> completion,
+		const std::shared_ptr<ChatMessage> &inFlightMessage = nullptr
+	);
+
+	// Runs the completions of the jobs done by the workers, called from the core thread.
+	void processDoneJobs ();
+
+	// Stops the workers and sets every message not sent yet NotDelivered, they were already stored when queued.
+	// Called from the core thread before the pipeline is released.
+	void cancel ();
+
+private:
+	struct Entry {
+		std::shared_ptr<ChatMessage> message;
+		ConferenceId conferenceId;
+		std::chrono::steady_clock::time_point queueTime;
+		bool encoded = false;
+	};
+
+	struct Completion {
+		std::function<void ()> function;
+		std::shared_ptr<ChatMessage> inFlightMessage;
+		bool jobDone = false;
+	};
+
+	void startEntries ();
+	void sendEncodedEntries (const ConferenceId &conferenceId);
+	void onJobDone (uint64_t jobId);
+	void updateGauges () const;
+
+	// Filled by the workers.
+	std::mutex doneJobsMutex;
+	std::vector<uint64_t> doneJobIds;
+
+	std::unique_ptr<WorkerPool> workers;
+	size_t maxInFlight;
+	size_t inFlight = 0;
+
+	// Messages not started yet, in the order they were queued.
+	std::deque<std::shared_ptr<Entry>> waitingEntries;
+	// Messages being encoded or waiting for the previous ones of their chat room to be sent.
+	std::unordered_map<ConferenceId, std::deque<std::shared_ptr<Entry>>> startedEntries;
+
+	uint64_t lastJobId = 0;
+	std::map<uint64_t, Completion> completions;
+
+	L_DISABLE_COPY(ChatMessageSendPipeline);
+};
+
+LINPHONE_END_NAMESPACE
+
+#endif // ifndef _L_CHAT_MESSAGE_SEND_PIPELINE_H_
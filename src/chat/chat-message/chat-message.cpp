@@ -27,10 +27,13 @@
 #include "address/address.h"
 #include "c-wrapper/c-wrapper.h"
 #include "call/call-p.h"
+#include "chat/chat-message/chat-message-broadcast.h"
 #include "chat/chat-message/chat-message-p.h"
+#include "chat/chat-message/chat-message-send-pipeline.h"
 #include "chat/chat-room/chat-room-p.h"
 #include "chat/chat-room/client-group-to-basic-chat-room.h"
 #include "chat/chat-room/real-time-text-chat-room.h"
+#include "chat/cpim/cpim.h"
 #include "chat/modifier/cpim-chat-message-modifier.h"
 #include "chat/modifier/encryption-chat-message-modifier.h"
 #include "chat/modifier/multipart-chat-message-modifier.h"
@@ -42,6 +45,7 @@
 #include "core/core.h"
 #include "core/core-p.h"
 #include "logger/logger.h"
+#include "logger/metrics.h"
 #include "sip-tools/sip-headers.h"
 
 #include "ortp/b64.h"
@@ -182,6 +186,10 @@ void ChatMessagePrivate::setState (ChatMessage::State newState) {
 		linphone_chat_message_cbs_get_msg_state_changed(cbs)(msg, (LinphoneChatMessageState)state);
 	_linphone_chat_message_notify_msg_state_changed(msg, (LinphoneChatMessageState)state);
 
+	shared_ptr<ChatMessageBroadcast> chatMessageBroadcast = broadcast.lock();
+	if (chatMessageBroadcast)
+		chatMessageBroadcast->onChatMessageStateChanged(oldState, state);
+
 	// 3. Specific case, change to displayed once all file transfers haven been downloaded.
 	if (state == ChatMessage::State::FileTransferDone && direction == ChatMessage::Direction::Incoming) {
 		if (!hasFileTransferContent()) {
@@ -378,7 +386,7 @@ const ContentType &ChatMessagePrivate::getContentType () const {
 void ChatMessagePrivate::setContentType (const ContentType &contentType) {
 	loadContentsFromDatabase();
 	if (contents.size() > 0 && internalContent.getContentType().isEmpty() && internalContent.isEmpty()) {
-		internalContent.setBody(contents.front()->getBody());
+		internalContent.setBody(contents.front()->getBodyBuffer());
 	}
 	internalContent.setContentType(contentType);
 
@@ -542,6 +550,7 @@ void ChatMessagePrivate::notifyReceiving () {
 
 LinphoneReason ChatMessagePrivate::receive () {
 	L_Q();
+	L_METRIC_TIME_SCOPE("chat.message.receive");
 	int errorCode = 0;
 	LinphoneReason reason = LinphoneReasonNone;
 
@@ -714,6 +723,7 @@ LinphoneReason ChatMessagePrivate::receive () {
 		toBeStored = false;
 
 	chatRoom->getPrivate()->onChatMessageReceived(q->getSharedFromThis());
+	L_METRIC_COUNTER_INCREMENT("chat.messages.received");
 
 	return reason;
 }
@@ -734,8 +744,54 @@ void ChatMessagePrivate::restoreFileTransferContentAsFileContent() {
 	}
 }
 
+void ChatMessagePrivate::prepareSend () {
+	L_Q();
+
+	shared_ptr<AbstractChatRoom> chatRoom(q->getChatRoom());
+	if (!chatRoom) return;
+
+	markAsRead();
+	chatRoom->getPrivate()->addTransientChatMessage(q->getSharedFromThis());
+	if (toBeStored && currentSendStep == ChatMessagePrivate::Step::None && !(dbKey.isValid() && state == ChatMessage::State::Idle))
+		storeInDb();
+}
+
+bool ChatMessagePrivate::encodeInPipeline (ChatMessageSendPipeline &pipeline, const function<void ()> &encoded) {
+	L_Q();
+
+	// Only single part messages without file to upload, the other modifiers have to run before CPIM.
+	shared_ptr<AbstractChatRoom> chatRoom(q->getChatRoom());
+	if (
+		!chatRoom ||
+		!applyModifiers ||
+		!chatRoom->canHandleCpim() ||
+		!externalBodyUrl.empty() ||
+		!internalContent.isEmpty() ||
+		(currentSendStep & ChatMessagePrivate::Step::Cpim) == ChatMessagePrivate::Step::Cpim ||
+		contents.size() != 1 ||
+		contents.front()->isFile() ||
+		contents.front()->isFileTransfer()
+	)
+		return false;
+
+	CpimChatMessageModifier ccmm;
+	shared_ptr<Cpim::Message> cpimMessage = ccmm.createMessage(q->getSharedFromThis());
+	shared_ptr<string> serialized = make_shared<string>();
+	shared_ptr<ChatMessage> message = q->getSharedFromThis();
+	pipeline.runInBackground([cpimMessage, serialized] {
+		*serialized = cpimMessage->asString();
+	}, [message, serialized, encoded] {
+		CpimChatMessageModifier ccmm;
+		ccmm.setSerializedMessage(message, *serialized);
+		message->getPrivate()->currentSendStep |= ChatMessagePrivate::Step::Cpim;
+		encoded();
+	});
+	return true;
+}
+
 void ChatMessagePrivate::send () {
 	L_Q();
+	L_METRIC_TIME_SCOPE("chat.message.send");
 
 	shared_ptr<AbstractChatRoom> chatRoom(q->getChatRoom());
 	if (!chatRoom) return;
@@ -751,7 +807,12 @@ void ChatMessagePrivate::send () {
 	q->getChatRoom()->getPrivate()->addTransientChatMessage(q->getSharedFromThis());
 	//imdnId.clear(); //moved into  ChatRoomPrivate::sendChatMessage
 
-	if (toBeStored && currentSendStep == (ChatMessagePrivate::Step::Started | ChatMessagePrivate::Step::None))
+	// A message stored but never sent yet (broadcast, send pipeline) has nothing to update.
+	if (
+		toBeStored &&
+		currentSendStep == (ChatMessagePrivate::Step::Started | ChatMessagePrivate::Step::None) &&
+		!(dbKey.isValid() && state == ChatMessage::State::Idle)
+	)
 		storeInDb();
 
 	if ((currentSendStep & ChatMessagePrivate::Step::FileUpload) == ChatMessagePrivate::Step::FileUpload) {
@@ -900,6 +961,7 @@ void ChatMessagePrivate::send () {
 		currentSendStep |= ChatMessagePrivate::Step::Sent;
 		msgOp->sendMessage(internalContent);
 	}
+	L_METRIC_COUNTER_INCREMENT("chat.messages.sent");
 
 	restoreFileTransferContentAsFileContent();
 	q->getChatRoom()->getPrivate()->removeTransientChatMessage(q->getSharedFromThis());
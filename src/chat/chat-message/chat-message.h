@@ -46,6 +46,8 @@ class ParticipantImdnState;
 class LINPHONE_PUBLIC ChatMessage : public Object, public CoreAccessor {
 	friend class BasicToClientGroupChatRoom;
 	friend class BasicToClientGroupChatRoomPrivate;
+	friend class ChatMessageBroadcast;
+	friend class ChatMessageSendPipeline;
 	friend class ChatRoom;
 	friend class ChatRoomPrivate;
 	friend class CpimChatMessageModifier;
@@ -37,6 +37,7 @@ class ChatRoomParams;
 
 class LINPHONE_PUBLIC AbstractChatRoom : public Object, public CoreAccessor, public ConferenceInterface {
 	friend class ChatMessage;
+	friend class ChatMessageBroadcast;
 	friend class ChatMessagePrivate;
 	friend class ClientGroupToBasicChatRoomPrivate;
 	friend class Core;
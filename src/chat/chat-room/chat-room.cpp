@@ -24,6 +24,7 @@
 
 #include "c-wrapper/c-wrapper.h"
 #include "chat/chat-message/chat-message-p.h"
+#include "chat/chat-message/chat-message-send-pipeline.h"
 #include "chat/chat-message/imdn-message.h"
 #include "chat/chat-message/is-composing-message.h"
 #include "chat/chat-message/notification-message-p.h"
@@ -53,7 +54,11 @@ void ChatRoomPrivate::sendChatMessage (const shared_ptr<ChatMessage> &chatMessag
 
 	ChatMessagePrivate *dChatMessage = chatMessage->getPrivate();
 	dChatMessage->setTime(ms_time(0));
-	dChatMessage->send();
+	const shared_ptr<ChatMessageSendPipeline> &sendPipeline = q->getCore()->getPrivate()->chatMessageSendPipeline;
+	if (sendPipeline)
+		sendPipeline->enqueue(chatMessage);
+	else
+		dChatMessage->send();
 
 	LinphoneChatRoom *cr = getCChatRoom();
 	// TODO: server currently don't stock message, remove condition in the future.
@@ -21,7 +21,7 @@
 #define _L_SERVER_GROUP_CHAT_ROOM_P_H_
 
 #include <chrono>
-#include <queue>
+#include <deque>
 #include <unordered_map>
 #include <map>
 
@@ -29,6 +29,7 @@
 #include "server-group-chat-room.h"
 
 #include "conference/participant-device.h"
+#include "db/main-db.h"
 #include "object/clonable-object.h"
 #include "object/clonable-object-p.h"
 
@@ -117,18 +118,46 @@ private:
 			if (salCustomHeaders)
 				customHeaders = sal_custom_header_clone(salCustomHeaders);
 		}
+		Message (const MainDb::ServerQueuedMessage &queuedMessage);
 
 		~Message () {
 			if (customHeaders)
 				sal_custom_header_free(customHeaders);
 		}
 
+		MainDb::ServerQueuedMessage toServerQueuedMessage () const;
+
+		// 0 if the message is only kept in memory.
+		long long storageId = 0;
 		IdentityAddress fromAddr;
 		Content content;
 		std::chrono::system_clock::time_point timestamp = std::chrono::system_clock::now();
 		SalCustomHeader *customHeaders = nullptr;
 	};
 
+	/*
+	 * Messages queued for a device, oldest first. When the queue is persistent, only its head is kept in memory,
+	 * the following messages stay in the database and are read back in batches as the head is dispatched.
+	 */
+	struct DeviceQueue {
+		std::deque<std::shared_ptr<Message>> messages;
+		// Messages in memory and in the database only.
+		size_t size = 0;
+		// Stored messages after this one are in the database only.
+		long long lastReadStorageId = 0;
+		// Stored messages removed from the queue whose rows are not deleted yet, see flushDeviceQueues().
+		long long lastRemovedStorageId = 0;
+		size_t removedCount = 0;
+	};
+
+	struct QueueSettings {
+		// Per device, 0 for no limit.
+		size_t maxMessages = 0;
+		std::chrono::seconds maxAge{0};
+		size_t memoryMessages = 0;
+		bool persistent = false;
+	};
+
 	static void copyMessageHeaders (const std::shared_ptr<Message> &fromMessage, const std::shared_ptr<ChatMessage> &toMessage);
 	static bool allDevicesLeft(const std::shared_ptr<Participant> &participant);
 	void addParticipantDevice (const std::shared_ptr<Participant> &participant, const ParticipantDeviceIdentity &deviceInfo);
@@ -141,6 +170,14 @@ private:
 	bool isAdminLeft () const;
 	void queueMessage (const std::shared_ptr<Message> &message);
 	void queueMessage (const std::shared_ptr<Message> &msg, const IdentityAddress &deviceAddress);
+	void loadQueueSettings ();
+	DeviceQueue &getDeviceQueue (const IdentityAddress &deviceAddress);
+	void refillDeviceQueue (const IdentityAddress &deviceAddress, DeviceQueue &deviceQueue);
+	std::shared_ptr<Message> popQueuedMessage (const IdentityAddress &deviceAddress, DeviceQueue &deviceQueue);
+	void flushDeviceQueues (const std::list<IdentityAddress> &deviceAddresses);
+	void clearDeviceQueue (const IdentityAddress &deviceAddress);
+	bool isQueuedMessageExpired (const std::shared_ptr<Message> &message) const;
+	void updateQueuedMessageCount (int64_t delta);
 	void removeParticipantDevice (const std::shared_ptr<Participant> &participant, const IdentityAddress &deviceAddress);
 
 	void onParticipantDeviceLeft (const std::shared_ptr<ParticipantDevice> &device);
@@ -171,9 +208,16 @@ private:
 	int unnotifiedRegistrationSubscriptions = 0; /*count of not-yet notified registration subscriptions*/
 	std::shared_ptr<ParticipantDevice> mInitiatorDevice; /*pointer to the ParticipantDevice that is creating the chat room*/
 	bool joiningPendingAfterCreation = false;
-	std::unordered_map<std::string, std::queue<std::shared_ptr<Message>>> queuedMessages;
+	std::unordered_map<IdentityAddress, DeviceQueue> queuedMessages;
+	QueueSettings queueSettings;
+	bool expiredQueuedMessagesDeleted = false;
 
 	L_DECLARE_PUBLIC(ServerGroupChatRoom);
+
+#ifdef LINPHONE_TESTER
+	// Drives the message queue of a chat room in the MainDb tests.
+	friend class ServerChatRoomProvider;
+#endif
 };
 
 LINPHONE_END_NAMESPACE
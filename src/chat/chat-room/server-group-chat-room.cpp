@@ -36,6 +36,7 @@
 #include "core/core-p.h"
 #include "event-log/events.h"
 #include "logger/logger.h"
+#include "logger/metrics.h"
 #include "sal/refer-op.h"
 #include "server-group-chat-room-p.h"
 
@@ -84,6 +85,19 @@ const string &ParticipantDeviceIdentity::getName () const {
 	linphone_chat_room_set_current_callbacks(cr, nullptr); \
 	bctbx_list_free(callbacksCopy);
 
+namespace {
+	// Headers of the received message that are copied to the messages sent to the devices.
+	const char *const HeadersToCopy[] = {
+		"Content-Encoding",
+		"Expires",
+		"Priority"
+	};
+
+	constexpr int DefaultQueueMaxMessages = 1000;
+	constexpr int DefaultQueueMaxAge = 7 * 24 * 3600; // One week.
+	constexpr int DefaultQueueMemoryMessages = 50;
+}
+
 void ServerGroupChatRoomPrivate::setState (ChatRoom::State state) {
 	L_Q_T(LocalConference, qConference);
 	ChatRoomPrivate::setState(state);
@@ -172,10 +186,10 @@ void ServerGroupChatRoomPrivate::setParticipantDeviceState (const shared_ptr<Par
 	switch (state){
 		case ParticipantDevice::State::ScheduledForLeaving:
 		case ParticipantDevice::State::Leaving:
-			queuedMessages.erase(address);
+			clearDeviceQueue(device->getAddress());
 		break;
 		case ParticipantDevice::State::Left:
-			queuedMessages.erase(address);
+			clearDeviceQueue(device->getAddress());
 			onParticipantDeviceLeft(device);
 		break;
 		default:
@@ -334,6 +348,7 @@ void ServerGroupChatRoomPrivate::declineSession (const shared_ptr<CallSession> &
 
 void ServerGroupChatRoomPrivate::dispatchQueuedMessages () {
 	L_Q();
+	list<IdentityAddress> dispatchedDeviceAddresses;
 	for (const auto &participant : q->getParticipants()) {
 		/*
 		 * Dispatch messages for each device in Present state. In a one to one chatroom, if a device
@@ -342,10 +357,10 @@ void ServerGroupChatRoomPrivate::dispatchQueuedMessages () {
 		
 		for (const auto &device : participant->getPrivate()->getDevices()) {
 			
-			string uri(device->getAddress().asString());
-			auto & msgQueue = queuedMessages[uri];
+			const IdentityAddress &deviceAddress = device->getAddress();
+			DeviceQueue &deviceQueue = getDeviceQueue(deviceAddress);
 			
-			if (!msgQueue.empty()){
+			if (deviceQueue.size > 0){
 				if ( (capabilities & ServerGroupChatRoom::Capabilities::OneToOne) && device->getState() == ParticipantDevice::State::Left){
 					lInfo() << "There is a message to transmit to a participant in left state in a one to one chatroom, so inviting first.";
 					inviteDevice(device);
@@ -353,16 +368,21 @@ void ServerGroupChatRoomPrivate::dispatchQueuedMessages () {
 				}
 				if (device->getState() != ParticipantDevice::State::Present)
 					continue;
-				size_t nbMessages = msgQueue.size();
-				lInfo() << q << ": Dispatching " << nbMessages << " queued message(s) for '" << uri << "'";
-				while (!msgQueue.empty()) {
-					shared_ptr<Message> msg = msgQueue.front();
-					sendMessage(msg, device->getAddress());
-					msgQueue.pop();
+				size_t nbMessages = deviceQueue.size;
+				lInfo() << q << ": Dispatching " << nbMessages << " queued message(s) for '" << deviceAddress << "'";
+				while (shared_ptr<Message> msg = popQueuedMessage(deviceAddress, deviceQueue)) {
+					if (isQueuedMessageExpired(msg)) {
+						L_METRIC_COUNTER_INCREMENT("chat.server_queue.expired");
+						continue;
+					}
+					sendMessage(msg, deviceAddress);
+					L_METRIC_COUNTER_INCREMENT("chat.server_queue.dispatched");
 				}
+				dispatchedDeviceAddresses.push_back(deviceAddress);
 			}
 		}
 	}
+	flushDeviceQueues(dispatchedDeviceAddresses);
 }
 
 void ServerGroupChatRoomPrivate::removeParticipant (const shared_ptr<const Participant> &participant) {
@@ -385,7 +405,8 @@ void ServerGroupChatRoomPrivate::removeParticipant (const shared_ptr<const Parti
 		}
 	}
 
-	queuedMessages.erase(participant->getAddress().asString());
+	for (const auto &device : participant->getPrivate()->getDevices())
+		clearDeviceQueue(device->getAddress());
 
 	shared_ptr<ConferenceParticipantEvent> event = qConference->getPrivate()->eventHandler->notifyParticipantRemoved(participant->getAddress());
 	q->getCore()->getPrivate()->mainDb->addEvent(event);
@@ -657,14 +678,45 @@ void ServerGroupChatRoomPrivate::setParticipantDevices(const IdentityAddress &pa
 
 // -----------------------------------------------------------------------------
 
+ServerGroupChatRoomPrivate::Message::Message (const MainDb::ServerQueuedMessage &queuedMessage)
+	: Message(queuedMessage.fromAddress.asString(), ContentType(queuedMessage.contentType), queuedMessage.body, nullptr)
+{
+	storageId = queuedMessage.storageId;
+	timestamp = chrono::system_clock::from_time_t(queuedMessage.creationTime);
+
+	const string &headers = queuedMessage.headers;
+	size_t begin = 0;
+	while (begin < headers.size()) {
+		size_t end = headers.find("\r\n", begin);
+		if (end == string::npos)
+			end = headers.size();
+		size_t separator = headers.find(": ", begin);
+		if (separator != string::npos && separator < end) {
+			const string name = headers.substr(begin, separator - begin);
+			const string value = headers.substr(separator + 2, end - separator - 2);
+			customHeaders = sal_custom_header_append(customHeaders, name.c_str(), value.c_str());
+		}
+		begin = end + 2;
+	}
+}
+
+MainDb::ServerQueuedMessage ServerGroupChatRoomPrivate::Message::toServerQueuedMessage () const {
+	MainDb::ServerQueuedMessage queuedMessage;
+	queuedMessage.fromAddress = fromAddr;
+	queuedMessage.contentType = content.getContentType().asString();
+	queuedMessage.body = content.getBodyAsUtf8String();
+	for (const char *headerName : HeadersToCopy) {
+		const char *headerValue = sal_custom_header_find(customHeaders, headerName);
+		if (headerValue)
+			queuedMessage.headers += string(headerName) + ": " + headerValue + "\r\n";
+	}
+	queuedMessage.creationTime = chrono::system_clock::to_time_t(timestamp);
+	return queuedMessage;
+}
+
 void ServerGroupChatRoomPrivate::copyMessageHeaders (const shared_ptr<Message> &fromMessage, const shared_ptr<ChatMessage> &toMessage) {
-	string headersToCopy[] = {
-		"Content-Encoding",
-		"Expires",
-		"Priority"
-	};
-	for (const auto &headerName : headersToCopy) {
-		const char *headerValue = sal_custom_header_find(fromMessage->customHeaders, headerName.c_str());
+	for (const char *headerName : HeadersToCopy) {
+		const char *headerValue = sal_custom_header_find(fromMessage->customHeaders, headerName);
 		if (headerValue)
 			toMessage->getPrivate()->addSalCustomHeader(headerName, headerValue);
 	}
@@ -901,29 +953,192 @@ bool ServerGroupChatRoomPrivate::isAdminLeft () const {
 
 void ServerGroupChatRoomPrivate::queueMessage (const shared_ptr<Message> &msg) {
 	L_Q();
+	list<IdentityAddress> deviceAddresses;
 	for (const auto &participant : q->getParticipants()) {
 		for (const auto &device : participant->getPrivate()->getDevices()) {
 			// Queue the message for all devices except the one that sent it
-			if (msg->fromAddr != device->getAddress()){
-				queueMessage(msg, device->getAddress());
-			}
+			if (msg->fromAddr == device->getAddress())
+				continue;
+
+			const IdentityAddress &deviceAddress = device->getAddress();
+			// Read the queue back before storing the message, it would be counted twice otherwise.
+			const DeviceQueue &deviceQueue = getDeviceQueue(deviceAddress);
+			// A present device gets the message right away, unless older messages are still waiting for it.
+			if (device->getState() == ParticipantDevice::State::Present && deviceQueue.size == 0)
+				sendMessage(msg, deviceAddress);
+			else
+				deviceAddresses.push_back(deviceAddress);
 		}
 	}
+	if (deviceAddresses.empty())
+		return;
+
+	// The message is stored once for all the devices.
+	if (queueSettings.persistent) {
+		msg->storageId = q->getCore()->getPrivate()->mainDb->addServerQueuedMessage(
+			q->getConferenceId(), msg->toServerQueuedMessage(), deviceAddresses
+		);
+		if (msg->storageId == 0)
+			lWarning() << q << ": Unable to store queued message, it is only kept in memory";
+	}
+
+	// Rows of the removed messages are deleted by batches, a few of them may come back after a restart.
+	list<IdentityAddress> flushedDeviceAddresses;
+	for (const auto &deviceAddress : deviceAddresses) {
+		queueMessage(msg, deviceAddress);
+		if (queuedMessages[deviceAddress].removedCount >= queueSettings.memoryMessages)
+			flushedDeviceAddresses.push_back(deviceAddress);
+	}
+	flushDeviceQueues(flushedDeviceAddresses);
 }
 
 void ServerGroupChatRoomPrivate::queueMessage (const shared_ptr<Message> &msg, const IdentityAddress &deviceAddress) {
-	chrono::system_clock::time_point timestamp = chrono::system_clock::now();
-	string uri(deviceAddress.asString());
-	// Remove queued messages older than one week
-	while (!queuedMessages[uri].empty()) {
-		shared_ptr<Message> m = queuedMessages[uri].front();
-		chrono::hours age = chrono::duration_cast<chrono::hours>(timestamp - m->timestamp);
-		chrono::hours oneWeek(168);
-		if (age < oneWeek)
-			break;
-		queuedMessages[uri].pop();
+	DeviceQueue &deviceQueue = getDeviceQueue(deviceAddress);
+
+	// Remove the expired messages, then the oldest ones while the queue is full.
+	while (!deviceQueue.messages.empty() && isQueuedMessageExpired(deviceQueue.messages.front())) {
+		popQueuedMessage(deviceAddress, deviceQueue);
+		L_METRIC_COUNTER_INCREMENT("chat.server_queue.expired");
+	}
+	if (queueSettings.maxMessages > 0) {
+		while (deviceQueue.size >= queueSettings.maxMessages && popQueuedMessage(deviceAddress, deviceQueue))
+			L_METRIC_COUNTER_INCREMENT("chat.server_queue.evicted");
 	}
-	queuedMessages[uri].push(msg);
+	// Once the head in memory is full, the stored messages stay in the database only. A message that could not be
+	// stored is kept in memory, even if it is then dispatched before the stored ones.
+	bool hasSpilledMessages = deviceQueue.size > deviceQueue.messages.size();
+	if (msg->storageId > 0 && (hasSpilledMessages || deviceQueue.messages.size() >= queueSettings.memoryMessages)) {
+		L_METRIC_COUNTER_INCREMENT("chat.server_queue.spilled");
+	} else {
+		deviceQueue.messages.push_back(msg);
+		if (msg->storageId > 0)
+			deviceQueue.lastReadStorageId = msg->storageId;
+	}
+	deviceQueue.size++;
+	updateQueuedMessageCount(1);
+	L_METRIC_COUNTER_INCREMENT("chat.server_queue.queued");
+}
+
+void ServerGroupChatRoomPrivate::loadQueueSettings () {
+	L_Q();
+	LinphoneConfig *config = linphone_core_get_config(q->getCore()->getCCore());
+	queueSettings.maxMessages = size_t(max(0, lp_config_get_int(config, "misc", "server_queue_max_messages", DefaultQueueMaxMessages)));
+	queueSettings.maxAge = chrono::seconds(max(0, lp_config_get_int(config, "misc", "server_queue_max_age", DefaultQueueMaxAge)));
+	queueSettings.memoryMessages = size_t(max(1, lp_config_get_int(config, "misc", "server_queue_memory_messages", DefaultQueueMemoryMessages)));
+
+	const unique_ptr<MainDb> &mainDb = q->getCore()->getPrivate()->mainDb;
+	queueSettings.persistent = !!lp_config_get_int(config, "misc", "server_queue_persistent", 1) && mainDb && mainDb->isInitialized();
+}
+
+ServerGroupChatRoomPrivate::DeviceQueue &ServerGroupChatRoomPrivate::getDeviceQueue (const IdentityAddress &deviceAddress) {
+	L_Q();
+	auto it = queuedMessages.find(deviceAddress);
+	if (it != queuedMessages.end())
+		return it->second;
+
+	DeviceQueue &deviceQueue = queuedMessages[deviceAddress];
+	if (!queueSettings.persistent)
+		return deviceQueue;
+
+	// First use of the queue since the chat room was created or loaded, read back what is left in the database.
+	const unique_ptr<MainDb> &mainDb = q->getCore()->getPrivate()->mainDb;
+	if (!expiredQueuedMessagesDeleted) {
+		expiredQueuedMessagesDeleted = true;
+		if (queueSettings.maxAge.count() > 0)
+			mainDb->deleteExpiredServerQueuedMessages(
+				q->getConferenceId(),
+				chrono::system_clock::to_time_t(chrono::system_clock::now() - queueSettings.maxAge)
+			);
+	}
+	deviceQueue.size = size_t(mainDb->getServerQueuedMessageCount(q->getConferenceId(), deviceAddress));
+	if (deviceQueue.size > 0) {
+		lInfo() << q << ": " << deviceQueue.size << " queued message(s) read back for '" << deviceAddress << "'";
+		updateQueuedMessageCount(int64_t(deviceQueue.size));
+		refillDeviceQueue(deviceAddress, deviceQueue);
+	}
+	return deviceQueue;
+}
+
+void ServerGroupChatRoomPrivate::refillDeviceQueue (const IdentityAddress &deviceAddress, DeviceQueue &deviceQueue) {
+	L_Q();
+	if (!queueSettings.persistent)
+		return;
+
+	list<MainDb::ServerQueuedMessage> storedMessages = q->getCore()->getPrivate()->mainDb->getServerQueuedMessages(
+		q->getConferenceId(), deviceAddress, deviceQueue.lastReadStorageId, int(queueSettings.memoryMessages)
+	);
+	for (const auto &storedMessage : storedMessages) {
+		deviceQueue.messages.push_back(make_shared<Message>(storedMessage));
+		deviceQueue.lastReadStorageId = storedMessage.storageId;
+	}
+}
+
+shared_ptr<ServerGroupChatRoomPrivate::Message> ServerGroupChatRoomPrivate::popQueuedMessage (
+	const IdentityAddress &deviceAddress,
+	DeviceQueue &deviceQueue
+) {
+	if (deviceQueue.size == 0)
+		return nullptr;
+
+	if (deviceQueue.messages.empty())
+		refillDeviceQueue(deviceAddress, deviceQueue);
+	if (deviceQueue.messages.empty()) {
+		lWarning() << "Queued messages of '" << deviceAddress << "' are missing from the database";
+		updateQueuedMessageCount(-int64_t(deviceQueue.size));
+		deviceQueue.size = 0;
+		return nullptr;
+	}
+
+	shared_ptr<Message> message = deviceQueue.messages.front();
+	deviceQueue.messages.pop_front();
+	deviceQueue.size--;
+	updateQueuedMessageCount(-1);
+	if (message->storageId > 0) {
+		deviceQueue.lastRemovedStorageId = message->storageId;
+		deviceQueue.removedCount++;
+	}
+	return message;
+}
+
+void ServerGroupChatRoomPrivate::flushDeviceQueues (const list<IdentityAddress> &deviceAddresses) {
+	L_Q();
+	list<pair<IdentityAddress, long long>> upToStorageIds;
+	for (const auto &deviceAddress : deviceAddresses) {
+		auto it = queuedMessages.find(deviceAddress);
+		if (it == queuedMessages.end() || it->second.lastRemovedStorageId == 0)
+			continue;
+
+		upToStorageIds.emplace_back(deviceAddress, it->second.lastRemovedStorageId);
+		it->second.lastRemovedStorageId = 0;
+		it->second.removedCount = 0;
+	}
+
+	// The rows of all the devices are deleted at once.
+	if (!upToStorageIds.empty())
+		q->getCore()->getPrivate()->mainDb->deleteServerQueuedMessages(q->getConferenceId(), upToStorageIds);
+}
+
+void ServerGroupChatRoomPrivate::clearDeviceQueue (const IdentityAddress &deviceAddress) {
+	L_Q();
+	auto it = queuedMessages.find(deviceAddress);
+	if (it != queuedMessages.end() && it->second.size == 0 && it->second.lastRemovedStorageId == 0)
+		return;
+
+	// Nothing of this device is kept once cleared, even what was not read back yet.
+	DeviceQueue &deviceQueue = queuedMessages[deviceAddress];
+	updateQueuedMessageCount(-int64_t(deviceQueue.size));
+	deviceQueue = DeviceQueue();
+	if (queueSettings.persistent)
+		q->getCore()->getPrivate()->mainDb->deleteServerQueuedMessages(q->getConferenceId(), deviceAddress);
+}
+
+bool ServerGroupChatRoomPrivate::isQueuedMessageExpired (const shared_ptr<Message> &message) const {
+	return queueSettings.maxAge.count() > 0 && chrono::system_clock::now() - message->timestamp >= queueSettings.maxAge;
+}
+
+void ServerGroupChatRoomPrivate::updateQueuedMessageCount (int64_t delta) {
+	L_Q();
+	q->getCore()->getPrivate()->updateServerQueuedMessageCount(delta);
 }
 
 /* The removal of participant device is done only when such device disapears from registration database, ie when a device unregisters explicitely
@@ -1110,6 +1325,7 @@ LocalConference(getCore(), IdentityAddress(linphone_proxy_config_get_conference_
 		d->capabilities |= ServerGroupChatRoom::Capabilities::Encrypted;
 
 	d->params = ChatRoomParams::fromCapabilities(d->capabilities);
+	d->loadQueueSettings();
 
 	shared_ptr<CallSession> session = getMe()->getPrivate()->createSession(*this, nullptr, false, d);
 	session->configure(LinphoneCallIncoming, nullptr, op, Address(op->getFrom()), Address(op->getTo()));
@@ -1134,15 +1350,24 @@ LocalConference(getCore(), peerAddress, nullptr) {
 	dConference->conferenceAddress = peerAddress;
 	dConference->eventHandler->setLastNotify(lastNotifyId);
 	dConference->eventHandler->setConferenceId(d->conferenceId);
+	d->loadQueueSettings();
 	getCore()->getPrivate()->localListEventHandler->addHandler(dConference->eventHandler.get());
 }
 
 ServerGroupChatRoom::~ServerGroupChatRoom () {
+	L_D();
 	L_D_T(LocalConference, dConference);
 
 	try {
 		if (getCore()->getPrivate()->localListEventHandler)
 			getCore()->getPrivate()->localListEventHandler->removeHandler(dConference->eventHandler.get());
+
+		// The queued messages stay in the database, they are counted again when the chat room is loaded.
+		int64_t queuedMessageCount = 0;
+		for (const auto &entry : d->queuedMessages)
+			queuedMessageCount += int64_t(entry.second.size);
+		if (queuedMessageCount > 0)
+			d->updateQueuedMessageCount(-queuedMessageCount);
 	} catch (const bad_weak_ptr &) {
 		// Unable to unregister listener here. Core is destroyed and the listener doesn't exist.
 	}
@@ -137,7 +137,7 @@ shared_ptr<const Cpim::Header> Cpim::Message::getContentHeader(const string &nam
 
 // -----------------------------------------------------------------------------
 
-string Cpim::Message::getContent () const {
+const string &Cpim::Message::getContent () const {
 	L_D();
 	return d->content;
 }
@@ -148,6 +148,12 @@ bool Cpim::Message::setContent (const string &content) {
 	return true;
 }
 
+bool Cpim::Message::setContent (string &&content) {
+	L_D();
+	d->content = move(content);
+	return true;
+}
+
 // -----------------------------------------------------------------------------
 
 string Cpim::Message::asString () const {
@@ -183,4 +189,8 @@ shared_ptr<const Cpim::Message> Cpim::Message::createFromString (const string &s
 	return Parser::getInstance()->parseMessage(str);
 }
 
+shared_ptr<const Cpim::Message> Cpim::Message::createFromString (const char *str, size_t size) {
+	return Parser::getInstance()->parseMessage(str, size);
+}
+
 LINPHONE_END_NAMESPACE
@@ -46,12 +46,14 @@ namespace Cpim {
 		void removeContentHeader (const Header &contentHeader);
 		std::shared_ptr<const Cpim::Header> getContentHeader (const std::string &name) const;
 
-		std::string getContent () const;
+		const std::string &getContent () const;
 		bool setContent (const std::string &content);
+		bool setContent (std::string &&content);
 
 		std::string asString () const;
 
 		static std::shared_ptr<const Message> createFromString (const std::string &str);
+		static std::shared_ptr<const Message> createFromString (const char *str, size_t size);
 
 	private:
 		L_DECLARE_PRIVATE(Message);
@@ -17,6 +17,9 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
+#include <cctype>
+#include <cstring>
+#include <mutex>
 #include <set>
 
 #include <belr/abnf.h>
@@ -26,6 +29,7 @@
 
 #include "content/content-type.h"
 #include "logger/logger.h"
+#include "logger/metrics.h"
 #include "object/object-p.h"
 
 #include "cpim-parser.h"
@@ -570,13 +574,431 @@ namespace Cpim {
 		list<shared_ptr<HeaderNode>> mContentHeaders;
 		list<shared_ptr<HeaderNode>> mMessageHeaders;
 	};
+
+	// -------------------------------------------------------------------------
+
+	// Hand-written parser for the usual shape of RFC 3862 messages. It fills the same nodes as the grammar handlers so
+	// that the validation of the headers is shared, and it gives up on anything less usual (crappy header, header
+	// parameters, hierarchical URIs...) for which the grammar is used instead.
+	class FastMessageParser {
+	public:
+		FastMessageParser (const char *input, size_t size) : mBegin(input), mCur(input), mEnd(input + size) {}
+
+		// Returns nullptr if the message must be parsed with the grammar.
+		shared_ptr<MessageNode> parse (size_t &parsedSize);
+
+	private:
+		bool parseHeaders (ListHeaderNode &headers, bool messageHeaders);
+		shared_ptr<HeaderNode> parseHeader (const char *begin, const char *end, bool messageHeader) const;
+
+		template<typename T>
+		static shared_ptr<HeaderNode> parseContactHeader (const char *p, const char *end);
+		static shared_ptr<HeaderNode> parseDateTimeHeader (const char *p, const char *end);
+		static shared_ptr<HeaderNode> parseSubjectHeader (const char *p, const char *end);
+		static shared_ptr<HeaderNode> parseNsHeader (const char *p, const char *end);
+		static shared_ptr<HeaderNode> parseRequireHeader (const char *p, const char *end);
+
+		static bool parseFormalName (const char *&p, const char *end, string &formalName);
+		static bool parseUri (const char *&p, const char *end, string &uri);
+		static bool parseDigits (const char *&p, const char *end, size_t count, string &digits);
+		static bool parseChar (const char *&p, const char *end, char c);
+
+		static bool isHeaderName (const char *begin, const char *end);
+		static bool isHeaderText (const char *begin, const char *end);
+		static size_t getUtf8MultiLength (const char *p, const char *end);
+
+		static bool isAlpha (unsigned char c) {
+			return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+		}
+
+		static bool isDigit (unsigned char c) {
+			return c >= '0' && c <= '9';
+		}
+
+		static bool isHexDigit (unsigned char c) {
+			return isDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+		}
+
+		static bool isNameChar (unsigned char c) {
+			return isAlpha(c) || isDigit(c) || c == 0x21 || (c >= 0x23 && c <= 0x27) || c == 0x2a || c == 0x2b
+				|| c == 0x2d || (c >= 0x5e && c <= 0x60) || c == 0x7c || c == 0x7e;
+		}
+
+		static bool isUnreserved (unsigned char c) {
+			return isAlpha(c) || isDigit(c) || strchr("-_.!~*'()", c);
+		}
+
+		const char *mBegin;
+		const char *mCur;
+		const char *mEnd;
+	};
+
+	shared_ptr<MessageNode> FastMessageParser::parse (size_t &parsedSize) {
+		static const char crappyHeader[] = "content-type:";
+		const size_t crappyHeaderSize = sizeof(crappyHeader) - 1;
+		if (size_t(mEnd - mBegin) >= crappyHeaderSize) {
+			size_t i = 0;
+			while ((i < crappyHeaderSize) && (tolower(static_cast<unsigned char>(mBegin[i])) == crappyHeader[i]))
+				i++;
+			if (i == crappyHeaderSize)
+				return nullptr;
+		}
+
+		shared_ptr<ListHeaderNode> messageHeaders = make_shared<ListHeaderNode>();
+		shared_ptr<ListHeaderNode> contentHeaders = make_shared<ListHeaderNode>();
+		if (!parseHeaders(*messageHeaders, true) || !parseHeaders(*contentHeaders, false))
+			return nullptr;
+
+		shared_ptr<MessageNode> messageNode = make_shared<MessageNode>();
+		messageNode->addMessageHeaders(messageHeaders);
+		messageNode->addContentHeaders(contentHeaders);
+		parsedSize = size_t(mCur - mBegin);
+		return messageNode;
+	}
+
+	bool FastMessageParser::parseHeaders (ListHeaderNode &headers, bool messageHeaders) {
+		for (;;) {
+			const char *lineEnd = mCur;
+			while ((lineEnd + 1 < mEnd) && !(lineEnd[0] == '\r' && lineEnd[1] == '\n'))
+				lineEnd++;
+			if (lineEnd + 1 >= mEnd)
+				return false;
+
+			const char *lineBegin = mCur;
+			mCur = lineEnd + 2;
+			if (lineBegin == lineEnd)
+				return !headers.empty();
+
+			shared_ptr<HeaderNode> header = parseHeader(lineBegin, lineEnd, messageHeaders);
+			if (!header)
+				return false;
+			headers.push_back(header);
+		}
+	}
+
+	shared_ptr<HeaderNode> FastMessageParser::parseHeader (const char *begin, const char *end, bool messageHeader) const {
+		if (!isHeaderText(begin, end))
+			return nullptr;
+
+		const char *colon = static_cast<const char *>(memchr(begin, ':', size_t(end - begin)));
+		if (!colon || !isHeaderName(begin, colon))
+			return nullptr;
+
+		const string name(begin, colon);
+		const char *p = colon + 1;
+		if (messageHeader) {
+			if (name == "From")
+				return parseContactHeader<FromHeaderNode>(p, end);
+			if (name == "To")
+				return parseContactHeader<ToHeaderNode>(p, end);
+			if (name == "DateTime")
+				return parseDateTimeHeader(p, end);
+			if (name == "cc")
+				return parseContactHeader<CcHeaderNode>(p, end);
+			if (name == "Subject")
+				return parseSubjectHeader(p, end);
+			if (name == "NS")
+				return parseNsHeader(p, end);
+			if (name == "Require")
+				return parseRequireHeader(p, end);
+		}
+
+		// Header parameters are left to the grammar.
+		if (!parseChar(p, end, ' '))
+			return nullptr;
+
+		shared_ptr<HeaderNode> header = make_shared<HeaderNode>();
+		header->setName(name);
+		header->setValue(string(p, end));
+		return header;
+	}
+
+	template<typename T>
+	shared_ptr<HeaderNode> FastMessageParser::parseContactHeader (const char *p, const char *end) {
+		string formalName;
+		string uri;
+		if (!parseChar(p, end, ' ') || !parseFormalName(p, end, formalName) || !parseUri(p, end, uri) || p != end)
+			return nullptr;
+
+		shared_ptr<T> header = make_shared<T>();
+		if (!formalName.empty())
+			header->setFormalName(formalName);
+		header->setUri(uri);
+		return header;
+	}
+
+	shared_ptr<HeaderNode> FastMessageParser::parseDateTimeHeader (const char *p, const char *end) {
+		string year, month, monthDay, hour, minute, second;
+		if (
+			!parseChar(p, end, ' ') ||
+			!parseDigits(p, end, 4, year) || !parseChar(p, end, '-') ||
+			!parseDigits(p, end, 2, month) || !parseChar(p, end, '-') ||
+			!parseDigits(p, end, 2, monthDay) || !parseChar(p, end, 'T') ||
+			!parseDigits(p, end, 2, hour) || !parseChar(p, end, ':') ||
+			!parseDigits(p, end, 2, minute) || !parseChar(p, end, ':') ||
+			!parseDigits(p, end, 2, second)
+		)
+			return nullptr;
+
+		if (parseChar(p, end, '.')) {
+			if (p == end || !isDigit(static_cast<unsigned char>(*p)))
+				return nullptr;
+			while (p != end && isDigit(static_cast<unsigned char>(*p)))
+				p++;
+		}
+
+		shared_ptr<DateTimeOffsetNode> offset = make_shared<DateTimeOffsetNode>();
+		if (!parseChar(p, end, 'Z')) {
+			string sign(p, p == end ? p : p + 1);
+			string offsetHour, offsetMinute;
+			if (
+				(!parseChar(p, end, '+') && !parseChar(p, end, '-')) ||
+				!parseDigits(p, end, 2, offsetHour) || !parseChar(p, end, ':') ||
+				!parseDigits(p, end, 2, offsetMinute)
+			)
+				return nullptr;
+			offset->setSign(sign);
+			offset->setHour(offsetHour);
+			offset->setMinute(offsetMinute);
+		}
+		if (p != end)
+			return nullptr;
+
+		shared_ptr<DateTimeHeaderNode> header = make_shared<DateTimeHeaderNode>();
+		header->setYear(year);
+		header->setMonth(month);
+		header->setMonthDay(monthDay);
+		header->setHour(hour);
+		header->setMinute(minute);
+		header->setSecond(second);
+		header->setOffset(offset);
+		return header;
+	}
+
+	shared_ptr<HeaderNode> FastMessageParser::parseSubjectHeader (const char *p, const char *end) {
+		// The language parameter is left to the grammar.
+		if (!parseChar(p, end, ' '))
+			return nullptr;
+
+		shared_ptr<SubjectHeaderNode> header = make_shared<SubjectHeaderNode>();
+		header->setSubject(string(p, end));
+		return header;
+	}
+
+	shared_ptr<HeaderNode> FastMessageParser::parseNsHeader (const char *p, const char *end) {
+		if (!parseChar(p, end, ' '))
+			return nullptr;
+
+		const char *prefixBegin = p;
+		while (p != end && isNameChar(static_cast<unsigned char>(*p)))
+			p++;
+		string prefixName(prefixBegin, p);
+		if (!prefixName.empty() && !parseChar(p, end, ' '))
+			return nullptr;
+
+		string uri;
+		if (!parseUri(p, end, uri) || p != end)
+			return nullptr;
+
+		shared_ptr<NsHeaderNode> header = make_shared<NsHeaderNode>();
+		if (!prefixName.empty())
+			header->setPrefixName(prefixName);
+		header->setUri(uri);
+		return header;
+	}
+
+	shared_ptr<HeaderNode> FastMessageParser::parseRequireHeader (const char *p, const char *end) {
+		if (!parseChar(p, end, ' '))
+			return nullptr;
+
+		const char *headerNames = p;
+		for (;;) {
+			const char *comma = static_cast<const char *>(memchr(p, ',', size_t(end - p)));
+			const char *nameEnd = comma ? comma : end;
+			if (!isHeaderName(p, nameEnd))
+				return nullptr;
+			if (!comma)
+				break;
+			p = comma + 1;
+		}
+
+		shared_ptr<RequireHeaderNode> header = make_shared<RequireHeaderNode>();
+		header->setHeaderNames(string(headerNames, end));
+		return header;
+	}
+
+	// Formal-name = 1*( Token SP ) / String, it is optional before the URI.
+	bool FastMessageParser::parseFormalName (const char *&p, const char *end, string &formalName) {
+		const char *begin = p;
+		if (p == end)
+			return false;
+
+		if (*p == '"') {
+			for (p++; p != end && *p != '"';) {
+				const unsigned char c = static_cast<unsigned char>(*p);
+				if (c == '\\') {
+					if (++p == end)
+						return false;
+					const char escaped = static_cast<char>(tolower(static_cast<unsigned char>(*p++)));
+					if (escaped == 'u') {
+						for (int i = 0; i < 4; i++, p++) {
+							if (p == end || !isHexDigit(static_cast<unsigned char>(*p)))
+								return false;
+						}
+					} else if (!strchr("btnr\"'\\", escaped))
+						return false;
+				} else if (c >= 0x80) {
+					size_t length = getUtf8MultiLength(p, end);
+					if (length == 0)
+						return false;
+					p += length;
+				} else if (c >= 0x20 && c <= 0x7e)
+					p++;
+				else
+					return false;
+			}
+			if (!parseChar(p, end, '"'))
+				return false;
+		} else {
+			while (p != end && *p != '<') {
+				const char *tokenBegin = p;
+				while (p != end) {
+					const unsigned char c = static_cast<unsigned char>(*p);
+					if (isNameChar(c) || c == '.')
+						p++;
+					else if (c >= 0x80) {
+						size_t length = getUtf8MultiLength(p, end);
+						if (length == 0)
+							return false;
+						p += length;
+					} else
+						break;
+				}
+				if (p == tokenBegin || !parseChar(p, end, ' '))
+					return false;
+			}
+		}
+
+		formalName.assign(begin, p);
+		return true;
+	}
+
+	// Only the opaque URIs (sip:, tel:, urn:...) are handled here.
+	bool FastMessageParser::parseUri (const char *&p, const char *end, string &uri) {
+		if (!parseChar(p, end, '<') || p == end || !isAlpha(static_cast<unsigned char>(*p)))
+			return false;
+
+		const char *begin = p;
+		for (p++; p != end; p++) {
+			const unsigned char c = static_cast<unsigned char>(*p);
+			if (!isAlpha(c) && !isDigit(c) && c != '+' && c != '-' && c != '.')
+				break;
+		}
+		if (!parseChar(p, end, ':') || p == end || *p == '/')
+			return false;
+
+		for (const char *opaqueBegin = p; p != end && *p != '>'; p++) {
+			const unsigned char c = static_cast<unsigned char>(*p);
+			if (c == '%') {
+				if ((end - p < 3) || !isHexDigit(static_cast<unsigned char>(p[1])) || !isHexDigit(static_cast<unsigned char>(p[2])))
+					return false;
+				p += 2;
+			} else if (!isUnreserved(c) && !strchr(";?:@&=+$,", c) && (p == opaqueBegin || !strchr("/[]", c)))
+				return false;
+		}
+
+		uri.assign(begin, p);
+		return parseChar(p, end, '>');
+	}
+
+	bool FastMessageParser::parseDigits (const char *&p, const char *end, size_t count, string &digits) {
+		if (size_t(end - p) < count)
+			return false;
+		for (size_t i = 0; i < count; i++) {
+			if (!isDigit(static_cast<unsigned char>(p[i])))
+				return false;
+		}
+		digits.assign(p, count);
+		p += count;
+		return true;
+	}
+
+	bool FastMessageParser::parseChar (const char *&p, const char *end, char c) {
+		if (p == end || *p != c)
+			return false;
+		p++;
+		return true;
+	}
+
+	// Header-name = [ Name-prefix "." ] Name
+	bool FastMessageParser::isHeaderName (const char *begin, const char *end) {
+		const char *dot = static_cast<const char *>(memchr(begin, '.', size_t(end - begin)));
+		if (dot && (dot == begin || dot + 1 == end))
+			return false;
+		for (const char *p = begin; p != end; p++) {
+			if (p != dot && !isNameChar(static_cast<unsigned char>(*p)))
+				return false;
+		}
+		return begin != end;
+	}
+
+	// *HEADERCHAR
+	bool FastMessageParser::isHeaderText (const char *begin, const char *end) {
+		for (const char *p = begin; p != end;) {
+			const unsigned char c = static_cast<unsigned char>(*p);
+			if (c >= 0x20 && c <= 0x7e)
+				p++;
+			else {
+				size_t length = getUtf8MultiLength(p, end);
+				if (length == 0)
+					return false;
+				p += length;
+			}
+		}
+		return true;
+	}
+
+	size_t FastMessageParser::getUtf8MultiLength (const char *p, const char *end) {
+		const unsigned char c = static_cast<unsigned char>(*p);
+		size_t length;
+		if (c >= 0xc0 && c <= 0xdf)
+			length = 2;
+		else if (c >= 0xe0 && c <= 0xef)
+			length = 3;
+		else if (c >= 0xf0 && c <= 0xf7)
+			length = 4;
+		else if (c >= 0xf8 && c <= 0xfb)
+			length = 5;
+		else if (c >= 0xfc && c <= 0xfd)
+			length = 6;
+		else
+			return 0;
+
+		if (size_t(end - p) < length)
+			return 0;
+		for (size_t i = 1; i < length; i++) {
+			const unsigned char continuation = static_cast<unsigned char>(p[i]);
+			if (continuation < 0x80 || continuation > 0xbf)
+				return 0;
+		}
+		return length;
+	}
 }
 
 // -----------------------------------------------------------------------------
 
 class Cpim::ParserPrivate : public ObjectPrivate {
 public:
+	void buildMessageParser ();
+	shared_ptr<Message> parseMessageWithGrammar (const string &input);
+
+	static shared_ptr<Message> createMessage (const MessageNode &messageNode, const char *content, size_t contentSize);
+
 	shared_ptr<belr::Grammar> grammar;
+
+	// The handlers are set once, the same parser is then used for all the messages.
+	unique_ptr<belr::Parser<shared_ptr<Node>>> messageParser;
+	mutex messageParserMutex;
 };
 
 Cpim::Parser::Parser () : Singleton(*new ParserPrivate) {
@@ -584,16 +1006,16 @@ Cpim::Parser::Parser () : Singleton(*new ParserPrivate) {
 	d->grammar = belr::GrammarLoader::get().load(CpimGrammar);
 	if (!d->grammar)
 		lFatal() << "Unable to load CPIM grammar.";
+	d->buildMessageParser();
 }
 
 // -----------------------------------------------------------------------------
 
-shared_ptr<Cpim::Message> Cpim::Parser::parseMessage (const string &input) {
-	L_D();
-
+void Cpim::ParserPrivate::buildMessageParser () {
 	typedef void (list<shared_ptr<HeaderNode> >::*pushPtr)(const shared_ptr<HeaderNode> &value);
 
-	belr::Parser<shared_ptr<Node> > parser(d->grammar);
+	messageParser.reset(new belr::Parser<shared_ptr<Node>>(grammar));
+	belr::Parser<shared_ptr<Node>> &parser = *messageParser;
 	parser.setHandler("Message", belr::make_fn(make_shared<MessageNode>))
 		->setCollector("Message-headers", belr::make_sfn(&MessageNode::addMessageHeaders))
 		->setCollector("Content-headers", belr::make_sfn(&MessageNode::addContentHeaders));
@@ -652,9 +1074,15 @@ shared_ptr<Cpim::Message> Cpim::Parser::parseMessage (const string &input) {
 
 	parser.setHandler("Require-header", belr::make_fn(make_shared<RequireHeaderNode>))
 		->setCollector("Require-header-value", belr::make_sfn(&RequireHeaderNode::setHeaderNames));
+}
 
+shared_ptr<Cpim::Message> Cpim::ParserPrivate::parseMessageWithGrammar (const string &input) {
 	size_t parsedSize;
-	shared_ptr<Node> node = parser.parseInput("Message", input, &parsedSize);
+	shared_ptr<Node> node;
+	{
+		lock_guard<mutex> lock(messageParserMutex);
+		node = messageParser->parseInput("Message", input, &parsedSize);
+	}
 	if (!node) {
 		lWarning() << "Unable to parse message.";
 		return nullptr;
@@ -666,15 +1094,47 @@ shared_ptr<Cpim::Message> Cpim::Parser::parseMessage (const string &input) {
 		return nullptr;
 	}
 
-	shared_ptr<Message> message = messageNode->createMessage();
-	if (message) {
-		message->setContent(input.substr(parsedSize));
-	}
+	return createMessage(*messageNode, input.c_str() + parsedSize, input.size() - parsedSize);
+}
+
+shared_ptr<Cpim::Message> Cpim::ParserPrivate::createMessage (const MessageNode &messageNode, const char *content, size_t contentSize) {
+	shared_ptr<Message> message = messageNode.createMessage();
+	if (message)
+		message->setContent(string(content, contentSize));
 	return message;
 }
 
 // -----------------------------------------------------------------------------
 
+shared_ptr<Cpim::Message> Cpim::Parser::parseMessage (const string &input) {
+	L_D();
+	size_t parsedSize;
+	shared_ptr<MessageNode> messageNode = FastMessageParser(input.c_str(), input.size()).parse(parsedSize);
+	if (!messageNode) {
+		L_METRIC_COUNTER_INCREMENT("cpim.parser.fallbacks");
+		return d->parseMessageWithGrammar(input);
+	}
+	return d->createMessage(*messageNode, input.c_str() + parsedSize, input.size() - parsedSize);
+}
+
+shared_ptr<Cpim::Message> Cpim::Parser::parseMessage (const char *input, size_t size) {
+	L_D();
+	size_t parsedSize;
+	shared_ptr<MessageNode> messageNode = FastMessageParser(input, size).parse(parsedSize);
+	if (!messageNode) {
+		L_METRIC_COUNTER_INCREMENT("cpim.parser.fallbacks");
+		return d->parseMessageWithGrammar(string(input, size));
+	}
+	return d->createMessage(*messageNode, input + parsedSize, size - parsedSize);
+}
+
+shared_ptr<Cpim::Message> Cpim::Parser::parseMessageWithGrammar (const string &input) {
+	L_D();
+	return d->parseMessageWithGrammar(input);
+}
+
+// -----------------------------------------------------------------------------
+
 shared_ptr<Cpim::Header> Cpim::Parser::cloneHeader (const Header &header) {
 	if (header.getName() == "From")
 		return FromHeaderNode(header).createHeader();
@@ -30,11 +30,15 @@ LINPHONE_BEGIN_NAMESPACE
 namespace Cpim {
 	class ParserPrivate;
 
-	class Parser : public Singleton<Parser> {
+	class LINPHONE_PUBLIC Parser : public Singleton<Parser> {
 		friend class Singleton<Parser>;
 
 	public:
 		std::shared_ptr<Message> parseMessage (const std::string &input);
+		std::shared_ptr<Message> parseMessage (const char *input, size_t size);
+
+		// Parses with the CPIM grammar only, without the fast path used for the common messages.
+		std::shared_ptr<Message> parseMessageWithGrammar (const std::string &input);
 
 		std::shared_ptr<Header> cloneHeader (const Header &header);
 
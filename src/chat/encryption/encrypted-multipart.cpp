@@ -0,0 +1,80 @@
+/*
+ * encrypted-multipart.cpp
+ * Copyright (C) 2010-2018 Belledonne Communications SARL
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "content/content-type.h"
+#include "content/multipart-writer.h"
+#include "utils/base64.h"
+
+#include "encrypted-multipart.h"
+
+// =============================================================================
+
+using namespace std;
+
+LINPHONE_BEGIN_NAMESPACE
+
+vector<char> buildEncryptedMultipart (
+	const string &localDeviceId,
+	const vector<EncryptedMultipartKey> &keys,
+	const vector<uint8_t> &cipherMessage
+) {
+	const string sipfragType = ContentType::SipFrag.asString();
+	const string limeKeyType = ContentType::LimeKey.asString();
+	const string octetStreamType = ContentType::OctetStream.asString();
+	const string sipfrag = "From: <" + localDeviceId + ">";
+	const string cipherKeyDescription = "Cipher key";
+	const string encryptedMessageDescription = "Encrypted message";
+
+	MultipartWriter writer;
+	size_t size = writer.getPartOverhead(sipfragType, sipfrag.size()) + sipfrag.size();
+	for (const EncryptedMultipartKey &key : keys) {
+		size_t encodedSize = Base64::getEncodedSize(key.cipherHeader.size());
+		size += writer.getPartOverhead(limeKeyType, encodedSize) + encodedSize +
+			sizeof("Content-Id: \r\n") + key.deviceId.size() +
+			sizeof("Content-Description: \r\n") + cipherKeyDescription.size();
+	}
+	size_t encodedMessageSize = Base64::getEncodedSize(cipherMessage.size());
+	size += writer.getPartOverhead(octetStreamType, encodedMessageSize) + encodedMessageSize +
+		sizeof("Content-Description: \r\n") + encryptedMessageDescription.size();
+	writer.reserve(size);
+
+	// ---------------------------------------------- SIPFRAG
+
+	writer.beginPart();
+	writer.writeBody(sipfragType, sipfrag.c_str(), sipfrag.size());
+
+	// ---------------------------------------------- HEADERS
+
+	for (const EncryptedMultipartKey &key : keys) {
+		writer.beginPart();
+		writer.addHeader("Content-Id", key.deviceId);
+		writer.addHeader("Content-Description", cipherKeyDescription);
+		writer.writeBase64Body(limeKeyType, key.cipherHeader.data(), key.cipherHeader.size());
+	}
+
+	// ---------------------------------------------- MESSAGE
+
+	writer.beginPart();
+	writer.addHeader("Content-Description", encryptedMessageDescription);
+	writer.writeBase64Body(octetStreamType, cipherMessage.data(), cipherMessage.size());
+
+	return writer.finish();
+}
+
+LINPHONE_END_NAMESPACE
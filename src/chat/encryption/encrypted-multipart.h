@@ -0,0 +1,49 @@
+/*
+ * encrypted-multipart.h
+ * Copyright (C) 2010-2018 Belledonne Communications SARL
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _L_ENCRYPTED_MULTIPART_H_
+#define _L_ENCRYPTED_MULTIPART_H_
+
+#include <string>
+#include <vector>
+
+#include "linphone/utils/general.h"
+
+// =============================================================================
+
+LINPHONE_BEGIN_NAMESPACE
+
+// Cipher header of a recipient device, only referenced while the multipart is built.
+struct EncryptedMultipartKey {
+	const std::string &deviceId;
+	const std::vector<uint8_t> &cipherHeader;
+};
+
+// Multipart sent to the recipients: the sipfrag of the sender, the cipher header of each recipient then the
+// cipher message. All the parts are written in a single buffer sized beforehand, the cipher headers and the
+// cipher message are base64 encoded directly into it. Only reads its arguments, can run on any thread.
+LINPHONE_PUBLIC std::vector<char> buildEncryptedMultipart (
+	const std::string &localDeviceId,
+	const std::vector<EncryptedMultipartKey> &keys,
+	const std::vector<uint8_t> &cipherMessage
+);
+
+LINPHONE_END_NAMESPACE
+
+#endif // ifndef _L_ENCRYPTED_MULTIPART_H_
@@ -81,6 +81,10 @@ public:
 		uint8_t *encryptedBuffer
 	) { return 0; }
 
+	// If true, downloadingFile and uploadingFile may be given the same buffer as input and output, so the
+	// file transfer chunks are processed in place.
+	virtual bool isFileTransferProcessedInPlace () const { return false; }
+
 	virtual void mutualAuthentication (
 		MSZrtpContext *zrtpContext,
 		SalMediaDescription *localMediaDescription,
@@ -19,23 +19,46 @@
 
 #include "bctoolbox/crypto.h"
 #include "chat/chat-message/chat-message-p.h"
+#include "chat/chat-message/chat-message-send-pipeline.h"
 #include "chat/chat-room/chat-room-p.h"
 #include "chat/chat-room/client-group-chat-room.h"
 #include "content/content-manager.h"
+#include "content/multipart-reader.h"
 #include "content/header/header-param.h"
 #include "conference/participant-p.h"
 #include "conference/participant-device.h"
 #include "core/core.h"
+#include "core/core-p.h"
 #include "c-wrapper/c-wrapper.h"
+#include "encrypted-multipart.h"
 #include "event-log/conference/conference-security-event.h"
 #include "lime-x3dh-encryption-engine.h"
 #include "private.h"
+#include "utils/base64.h"
 #include "bctoolbox/exception.hh"
 
 using namespace std;
 
 LINPHONE_BEGIN_NAMESPACE
 
+namespace {
+	vector<char> buildRecipientsMultipart (
+		const string &localDeviceId,
+		const vector<lime::RecipientData> &recipients,
+		const vector<uint8_t> &cipherMessage
+	) {
+		vector<EncryptedMultipartKey> keys;
+		keys.reserve(recipients.size());
+		for (const lime::RecipientData &recipient : recipients) {
+			// Ignore devices which do not have keys on the X3DH server
+			// The message will still be sent to them but they will not be able to decrypt it
+			if (recipient.peerStatus != lime::PeerDeviceStatus::fail)
+				keys.push_back({ recipient.deviceId, recipient.DRmessage });
+		}
+		return buildEncryptedMultipart(localDeviceId, keys, cipherMessage);
+	}
+}
+
 struct X3dhServerPostContext {
 	const lime::limeX3DHServerResponseProcess responseProcess;
 	const string username;
@@ -244,67 +267,37 @@ ChatMessageModifier::Result LimeX3dhEncryptionEngine::processOutgoingMessage (
 		limeManager->encrypt(localDeviceId, recipientUserId, recipients, plainMessage, cipherMessage, [localDeviceId, recipients, cipherMessage, message, result] (lime::CallbackReturn returnCode, string errorMessage) {
 			if (returnCode == lime::CallbackReturn::success) {
 
-				// Ignore devices which do not have keys on the X3DH server
-				// The message will still be sent to them but they will not be able to decrypt it
-				vector<lime::RecipientData> filteredRecipients;
-				filteredRecipients.reserve(recipients->size());
-				for (const lime::RecipientData &recipient : *recipients) {
-					if (recipient.peerStatus != lime::PeerDeviceStatus::fail) {
-						filteredRecipients.push_back(recipient);
-					}
-				}
-
-				list<Content *> contents;
-
-				// ---------------------------------------------- SIPFRAG
-
-				Content *sipfrag = new Content();
-				sipfrag->setBody("From: <" + localDeviceId + ">");
-				sipfrag->setContentType(ContentType::SipFrag);
-				contents.push_back(move(sipfrag));
-
-				// ---------------------------------------------- HEADERS
-
-				for (const lime::RecipientData &recipient : filteredRecipients) {
-					string cipherHeaderB64 = encodeBase64(recipient.DRmessage);
-					Content *cipherHeader = new Content();
-					cipherHeader->setBody(cipherHeaderB64);
-					cipherHeader->setContentType(ContentType::LimeKey);
-					cipherHeader->addHeader("Content-Id", recipient.deviceId);
-					Header contentDescription("Content-Description", "Cipher key");
-					cipherHeader->addHeader(contentDescription);
-					contents.push_back(move(cipherHeader));
-				}
-
-				// ---------------------------------------------- MESSAGE
-
-				const vector<uint8_t> *binaryCipherMessage = cipherMessage.get();
-				string cipherMessageB64 = encodeBase64(*binaryCipherMessage);
-				Content *cipherMessage = new Content();
-				cipherMessage->setBody(cipherMessageB64);
-				cipherMessage->setContentType(ContentType::OctetStream);
-				cipherMessage->addHeader("Content-Description", "Encrypted message");
-				contents.push_back(move(cipherMessage));
-
-				Content finalContent = ContentManager::contentListToMultipart(contents, MultipartBoundary, true);
-
 				// Insert protocol param before boundary for flexisip
-				ContentType contentType(finalContent.getContentType());
-				contentType.removeParameter("boundary");
+				ContentType contentType(ContentType::Encrypted);
 				if (!linphone_config_get_bool(linphone_core_get_config(message->getCore()->getCCore()), "lime", "preserve_backward_compatibility",FALSE)) {
 					contentType.addParameter("protocol", "\"application/lime\"");
 				}
 				contentType.addParameter("boundary", MultipartBoundary);
+
+				// With a send pipeline the multipart is built by its workers, the message is sent once it is done.
+				// The message has already left the queue of the pipeline, the job takes a place in flight instead.
+				const shared_ptr<ChatMessageSendPipeline> &sendPipeline = message->getCore()->getPrivate()->chatMessageSendPipeline;
+				if (sendPipeline) {
+					shared_ptr<vector<char>> body = make_shared<vector<char>>();
+					sendPipeline->runInBackground([localDeviceId, recipients, cipherMessage, body] {
+						*body = buildRecipientsMultipart(localDeviceId, *recipients, *cipherMessage);
+					}, [message, contentType, body] {
+						Content finalContent;
+						finalContent.setContentType(contentType);
+						finalContent.setBody(move(*body));
+						message->setInternalContent(finalContent);
+						message->getPrivate()->send();
+					}, message);
+					return;
+				}
+
+				Content finalContent;
 				finalContent.setContentType(contentType);
+				finalContent.setBody(buildRecipientsMultipart(localDeviceId, *recipients, *cipherMessage));
 
 				message->setInternalContent(finalContent);
 				message->getPrivate()->send(); // seems to leak when called for the second time
 				*result = ChatMessageModifier::Result::Done;
-
-				// TODO can be improved
-				for (const auto &content : contents) {
-					delete content;
-				}
 			} else {
 				lError() << "[LIME] operation failed: " << errorMessage;
 				*result = ChatMessageModifier::Result::Error;
@@ -355,23 +348,38 @@ ChatMessageModifier::Result LimeX3dhEncryptionEngine::processIncomingMessage (
 		message->getPrivate()->enableSenderAuthentication(false);
 		return ChatMessageModifier::Result::Skipped;
 	}
-	list<Content> contentList = ContentManager::multipartToContentList(*internalContent);
-
-	// ---------------------------------------------- SIPFRAG
 
+	// Only the sipfrag, the key of this device and the message are looked at, the other keys are skipped in place.
+	const vector<char> &multipart = internalContent->getBody();
+	// The boundary is chosen by the sender, it is not necessarily the one used by this version.
+	MultipartReader reader(multipart.data(), multipart.size(), ContentManager::getMultipartBoundary(incomingContentType));
+	MultipartReader::Part part;
 	string senderDeviceId;
-	for (const auto &content : contentList) {
-		if (content.getContentType() != ContentType::SipFrag)
-			continue;
-
-		// Extract Contact header from sipfrag content
-		senderDeviceId = content.getBodyAsUtf8String();
-		string toErase = "From: ";
-		size_t contactPosition = senderDeviceId.find(toErase);
-		if (contactPosition != string::npos) senderDeviceId.erase(contactPosition, toErase.length());
-		IdentityAddress tmpIdentityAddress(senderDeviceId);
-		senderDeviceId = tmpIdentityAddress.asString();
+	const char *cipherHeader = nullptr;
+	size_t cipherHeaderSize = 0;
+	const char *cipherMessage = nullptr;
+	size_t cipherMessageSize = 0;
+	while (reader.next(part)) {
+		if (part.hasContentType(ContentType::SipFrag)) {
+			// Extract Contact header from sipfrag content
+			senderDeviceId = part.getBodyAsString();
+			string toErase = "From: ";
+			size_t contactPosition = senderDeviceId.find(toErase);
+			if (contactPosition != string::npos) senderDeviceId.erase(contactPosition, toErase.length());
+			IdentityAddress tmpIdentityAddress(senderDeviceId);
+			senderDeviceId = tmpIdentityAddress.asString();
+		} else if (part.hasContentType(ContentType::LimeKey)) {
+			if (part.hasHeaderValue("Content-Id", localDeviceId)) {
+				cipherHeader = part.getBody();
+				cipherHeaderSize = part.getBodySize();
+			}
+		} else if (part.hasContentType(ContentType::OctetStream)) {
+			cipherMessage = part.getBody();
+			cipherMessageSize = part.getBodySize();
+		}
 	}
+	if (reader.isMalformed())
+		lWarning() << "[LIME] malformed multipart in message [" << message << "]";
 
 	// Discard incoming messages from unsafe peer devices
 	lime::PeerDeviceStatus peerDeviceStatus = limeManager->get_peerDeviceStatus(senderDeviceId);
@@ -383,36 +391,17 @@ ChatMessageModifier::Result LimeX3dhEncryptionEngine::processIncomingMessage (
 		}
 	}
 
-	// ---------------------------------------------- HEADERS
-
-	string cipherHeader;
-	for (const auto &content : contentList) {
-		if (content.getContentType() != ContentType::LimeKey)
-			continue;
-
-		Header headerDeviceId = content.getHeader("Content-Id");
-		if (headerDeviceId.getValueWithParams() == localDeviceId) {
-			cipherHeader = content.getBodyAsUtf8String();
-		}
-	}
-
-	// ---------------------------------------------- MESSAGE
-
-	string cipherMessage;
-	for (const auto &content : contentList) {
-		if (content.getContentType() == ContentType::OctetStream) {
-			cipherMessage = content.getBodyAsUtf8String();
-		}
-	}
-	
-	if (cipherHeader.empty()) {
+	if (!cipherHeader || cipherHeaderSize == 0) {
 		lError() << "No key found for [" << localDeviceId << "] for message [" << message <<"]";
 		errorCode = 488; // Not Acceptable
 		return ChatMessageModifier::Result::Done;
 	}
-	
-	vector<uint8_t> decodedCipherHeader = decodeBase64(cipherHeader);
-	vector<uint8_t> decodedCipherMessage = decodeBase64(cipherMessage);
+
+	vector<uint8_t> decodedCipherHeader;
+	Base64::decode(cipherHeader, cipherHeaderSize, decodedCipherHeader);
+	vector<uint8_t> decodedCipherMessage;
+	if (cipherMessage)
+		Base64::decode(cipherMessage, cipherMessageSize, decodedCipherMessage);
 	vector<uint8_t> plainMessage{};
 
 	try {
@@ -541,6 +530,11 @@ int LimeX3dhEncryptionEngine::uploadingFile (
 	return 0;
 }
 
+// AES-GCM is a stream mode, each chunk can be encrypted or decrypted over itself.
+bool LimeX3dhEncryptionEngine::isFileTransferProcessedInPlace () const {
+	return true;
+}
+
 EncryptionEngine::EngineType LimeX3dhEncryptionEngine::getEngineType () {
 	return engineType;
 }
@@ -592,7 +586,7 @@ list<EncryptionParameter> LimeX3dhEncryptionEngine::getEncryptionParameters () {
 
 	// Encode to base64 and append to the parameter list
 	list<pair<string,string>> paramList;
-	string IkB64 = encodeBase64(Ik);
+	string IkB64 = Base64::encode(Ik);
 	paramList.push_back(make_pair("Ik", IkB64));
 	return paramList;
 }
@@ -617,8 +611,8 @@ void LimeX3dhEncryptionEngine::mutualAuthentication (
 	const string RemoteIkB64(charRemoteIk);
 
 	// Convert to vectors and decode base64
-	vector<uint8_t> localIk = decodeBase64(LocalIkB64);
-	vector<uint8_t> remoteIk = decodeBase64(RemoteIkB64);
+	vector<uint8_t> localIk = Base64::decode(LocalIkB64);
+	vector<uint8_t> remoteIk = Base64::decode(RemoteIkB64);
 
 	// Concatenate identity keys in the right order
 	vector<uint8_t> vectorAuxSharedSecret;
@@ -658,7 +652,7 @@ void LimeX3dhEncryptionEngine::authenticationVerified (
 	if (sdpRemoteIk)
 		remoteIkB64 = sdpRemoteIk;
 
-	vector<uint8_t> remoteIk = decodeBase64(remoteIkB64);
+	vector<uint8_t> remoteIk = Base64::decode(remoteIkB64);
 	const IdentityAddress peerDeviceAddr = IdentityAddress(peerDeviceId);
 
 	if (ms_zrtp_getAuxiliarySharedSecretMismatch(zrtpContext) == 2 /*BZRTP_AUXSECRET_UNSET*/) {
@@ -36,7 +36,14 @@ using namespace std;
 LINPHONE_BEGIN_NAMESPACE
 
 ChatMessageModifier::Result CpimChatMessageModifier::encode (const shared_ptr<ChatMessage> &message, int &errorCode) {
-	Cpim::Message cpimMessage;
+	shared_ptr<Cpim::Message> cpimMessage = createMessage(message);
+	setSerializedMessage(message, cpimMessage->asString());
+	return ChatMessageModifier::Result::Done;
+}
+
+shared_ptr<Cpim::Message> CpimChatMessageModifier::createMessage (const shared_ptr<ChatMessage> &message) const {
+	shared_ptr<Cpim::Message> cpimMessagePtr = make_shared<Cpim::Message>();
+	Cpim::Message &cpimMessage = *cpimMessagePtr;
 
 	cpimMessage.addMessageHeader(
 		Cpim::FromHeader(cpimAddressUri(message->getFromAddress()), cpimAddressDisplayName(message->getFromAddress()))
@@ -95,7 +102,7 @@ ChatMessageModifier::Result CpimChatMessageModifier::encode (const shared_ptr<Ch
 		content = message->getContents().front();
 	}
 
-	const string contentBody = content->getBodyAsString();
+	string contentBody = content->getBodyAsUtf8String();
 	if (content->getContentDisposition().isValid()) {
 		cpimMessage.addContentHeader(
 			Cpim::GenericHeader("Content-Disposition", content->getContentDisposition().asString())
@@ -107,14 +114,16 @@ ChatMessageModifier::Result CpimChatMessageModifier::encode (const shared_ptr<Ch
 	cpimMessage.addContentHeader(
 		Cpim::GenericHeader("Content-Length", Utils::toString(contentBody.size()))
 	);
-	cpimMessage.setContent(contentBody);
+	cpimMessage.setContent(move(contentBody));
 
+	return cpimMessagePtr;
+}
+
+void CpimChatMessageModifier::setSerializedMessage (const shared_ptr<ChatMessage> &message, const string &serialized) const {
 	Content newContent;
 	newContent.setContentType(ContentType::Cpim);
-	newContent.setBody(cpimMessage.asString());
+	newContent.setBodyFromUtf8(serialized);
 	message->setInternalContent(newContent);
-
-	return ChatMessageModifier::Result::Done;
 }
 
 ChatMessageModifier::Result CpimChatMessageModifier::decode (const shared_ptr<ChatMessage> &message, int &errorCode) {
@@ -129,10 +138,11 @@ ChatMessageModifier::Result CpimChatMessageModifier::decode (const shared_ptr<Ch
 		return ChatMessageModifier::Result::Skipped;
 	}
 
-	const string contentBody = content->getBodyAsString();
-	const shared_ptr<const Cpim::Message> cpimMessage = Cpim::Message::createFromString(contentBody);
+	// Parsed in place, the body is only copied to the payload of the CPIM message.
+	const SharedBuffer &contentBody = content->getBodyBuffer();
+	const shared_ptr<const Cpim::Message> cpimMessage = Cpim::Message::createFromString(contentBody.data(), contentBody.size());
 	if (!cpimMessage || !cpimMessage->getMessageHeader("From") || !cpimMessage->getMessageHeader("To")) {
-		lError() << "[CPIM] Message is invalid: " << contentBody;
+		lError() << "[CPIM] Message is invalid: " << content->getBodyAsString();
 		errorCode = 488; // Not Acceptable
 		return ChatMessageModifier::Result::Error;
 	}
@@ -148,7 +158,8 @@ ChatMessageModifier::Result CpimChatMessageModifier::decode (const shared_ptr<Ch
 	auto contentDispositionHeader = cpimMessage->getContentHeader("Content-Disposition");
 	if (contentDispositionHeader)
 		newContent.setContentDisposition(ContentDisposition(contentDispositionHeader->getValue()));
-	newContent.setBody(cpimMessage->getContent());
+	// The payload ends the CPIM body, the new content refers to it instead of copying it.
+	newContent.setBody(contentBody.slice(contentBody.size() - cpimMessage->getContent().size()));
 
 	message->getPrivate()->setPositiveDeliveryNotificationRequired(false);
 	message->getPrivate()->setNegativeDeliveryNotificationRequired(false);
@@ -26,6 +26,10 @@
 
 LINPHONE_BEGIN_NAMESPACE
 
+namespace Cpim {
+	class Message;
+}
+
 class CpimChatMessageModifier : public ChatMessageModifier {
 public:
 	CpimChatMessageModifier () = default;
@@ -33,6 +37,10 @@ public:
 	Result encode (const std::shared_ptr<ChatMessage> &message, int &errorCode) override;
 	Result decode (const std::shared_ptr<ChatMessage> &message, int &errorCode) override;
 
+	// encode() in two steps, the serialization of the CPIM message can be done on another thread.
+	std::shared_ptr<Cpim::Message> createMessage (const std::shared_ptr<ChatMessage> &message) const;
+	void setSerializedMessage (const std::shared_ptr<ChatMessage> &message, const std::string &serialized) const;
+
 private:
 	std::string cpimAddressDisplayName (const Address &addr) const;
 	std::string cpimAddressUri (const Address &addr) const;
@@ -17,7 +17,15 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
+#include <algorithm>
+
+#include <fcntl.h>
+
+// TODO: Remove me later.
+#include "private.h"
+
 #include "linphone/api/c-content.h"
+#include "linphone/utils/utils.h"
 
 #include "address/address.h"
 #include "bctoolbox/crypto.h"
@@ -27,7 +35,8 @@
 #include "chat/chat-room/chat-room-p.h"
 #include "content/content-type.h"
 #include "content/content.h"
-#include "core/core.h"
+#include "core/core-p.h"
+#include "db/main-db.h"
 #include "logger/logger.h"
 
 #include "file-transfer-chat-message-modifier.h"
@@ -38,6 +47,28 @@ using namespace std;
 
 LINPHONE_BEGIN_NAMESPACE
 
+using DownloadRequestContext = FileTransferChatMessageModifier::DownloadRequestContext;
+
+namespace {
+	constexpr int DefaultDownloadMaxRetries = 3;
+	constexpr int DefaultDownloadSegmentMinSize = 4 * 1024 * 1024;
+	// Doubled after each failed attempt of the same segment.
+	constexpr unsigned int DownloadRetryDelay = 500;
+	// The progress of a resumable download is stored each time this amount of data has been received.
+	constexpr size_t DownloadStateSaveInterval = 1024 * 1024;
+	constexpr int DefaultUploadMaxRetries = 3;
+	// Doubled after each failed attempt of the same chunk.
+	constexpr unsigned int UploadRetryDelay = 500;
+	constexpr unsigned int UploadChunkPollDelay = 10;
+}
+
+static MainDb *getFileTransferStateDb (const shared_ptr<ChatMessage> &message) {
+	if (!message->getPrivate()->dbKey.isValid())
+		return nullptr;
+	const unique_ptr<MainDb> &mainDb = message->getCore()->getPrivate()->mainDb;
+	return mainDb && mainDb->isInitialized() ? mainDb.get() : nullptr;
+}
+
 FileTransferChatMessageModifier::FileTransferChatMessageModifier (belle_http_provider_t *prov) : provider(prov) {
 	bgTask.setName("File transfer upload");
 }
@@ -53,8 +84,11 @@ void FileTransferChatMessageModifier::setHttpRequest (belle_http_request_t *requ
 FileTransferChatMessageModifier::~FileTransferChatMessageModifier () {
 	if (isFileTransferInProgressAndValid())
 		cancelFileTransfer(); //to avoid body handler to still refference zombie FileTransferChatMessageModifier
-	else
+	else {
 		releaseHttpRequest();
+		releaseChunkedUpload();
+		releaseDownload();
+	}
 }
 
 ChatMessageModifier::Result FileTransferChatMessageModifier::encode (const shared_ptr<ChatMessage> &message, int &errorCode) {
@@ -182,16 +216,16 @@ int FileTransferChatMessageModifier::onSendBody (
 	EncryptionEngine *imee = message->getCore()->getEncryptionEngine();
 	if (imee) {
 		size_t max_size = *size;
-		uint8_t *encrypted_buffer = (uint8_t *)ms_malloc0(max_size);
+		uint8_t *encrypted_buffer = imee->isFileTransferProcessedInPlace() ? buffer : getCryptoBuffer(max_size);
 		retval = imee->uploadingFile(L_GET_CPP_PTR_FROM_C_OBJECT(msg), offset, buffer, size, encrypted_buffer);
 		if (retval == 0) {
 			if (*size > max_size) {
 				lError() << "IM encryption engine process upload file callback returned a size bigger than the size of the buffer, so it will be truncated !";
 				*size = max_size;
 			}
-			memcpy(buffer, encrypted_buffer, *size);
+			if (encrypted_buffer != buffer)
+				memcpy(buffer, encrypted_buffer, *size);
 		}
-		ms_free(encrypted_buffer);
 	}
 
 	return retval <= 0 ? BELLE_SIP_CONTINUE : BELLE_SIP_STOP;
@@ -231,6 +265,14 @@ void FileTransferChatMessageModifier::processResponseFromPostFile (const belle_h
 	// check the answer code
 	if (event->response) {
 		int code = belle_http_response_get_status_code(event->response);
+		if (uploadReader) {
+			if (code == 201) { // the server opened an upload session, the file is sent in chunks
+				startChunkedUpload(message, event);
+				return;
+			}
+			// The server does not know upload sessions, the file is sent in a single request.
+			releaseChunkedUpload();
+		}
 		if (code == 204) { // this is the reply to the first post to the server - an empty msg
 			// start uploading the file
 			belle_sip_multipart_body_handler_t *bh;
@@ -427,6 +469,7 @@ static void _chat_message_process_io_error_upload (void *data, const belle_sip_i
 
 void FileTransferChatMessageModifier::processIoErrorUpload (const belle_sip_io_error_event_t *event) {
 	lError() << "I/O Error during file upload of msg [" << this << "]";
+	releaseChunkedUpload();
 	shared_ptr<ChatMessage> message = chatMessage.lock();
 	if (!message)
 		return;
@@ -441,6 +484,10 @@ static void _chat_message_process_auth_requested_upload (void *data, belle_sip_a
 
 void FileTransferChatMessageModifier::processAuthRequestedUpload (const belle_sip_auth_event *event) {
 	lError() << "Error during file upload: auth requested for msg [" << this << "]";
+	if (uploadReader) {
+		onChunkedUploadFailed();
+		return;
+	}
 	shared_ptr<ChatMessage> message = chatMessage.lock();
 	if (!message)
 		return;
@@ -466,60 +513,72 @@ int FileTransferChatMessageModifier::uploadFile (belle_sip_body_handler_t *bh) {
 		currentFileContentToTransfer->setFilePath(message->getPrivate()->getFileTransferFilepath());
 	}
 
+	list<pair<string, string>> headers;
+	if (!bh)
+		prepareChunkedUpload(message, headers);
+
 	belle_http_request_listener_callbacks_t cbs = { 0 };
 	cbs.process_response = _chat_message_process_response_from_post_file;
 	cbs.process_io_error = _chat_message_process_io_error_upload;
 	cbs.process_auth_requested = _chat_message_process_auth_requested_upload;
 
 	const char *url = linphone_core_get_file_transfer_server(message->getCore()->getCCore());
-	return startHttpTransfer(url ? url : "", "POST", bh, &cbs);
+	return startHttpTransfer(url ? url : "", "POST", bh, &cbs, headers);
 }
 
-int FileTransferChatMessageModifier::startHttpTransfer (const string &url, const string &action, belle_sip_body_handler_t *bh, belle_http_request_listener_callbacks_t *cbs) {
-	belle_generic_uri_t *uri = nullptr;
+int FileTransferChatMessageModifier::startHttpTransfer (
+	const string &url,
+	const string &action,
+	belle_sip_body_handler_t *bh,
+	belle_http_request_listener_callbacks_t *cbs,
+	const list<pair<string, string>> &headers
+) {
+	httpRequest = createHttpRequest(url, action);
+	if (!httpRequest) {
+		if (bh) belle_sip_object_unref(bh);
+		return -1;
+	}
+
+	for (const auto &header : headers)
+		belle_sip_message_add_header(BELLE_SIP_MESSAGE(httpRequest), belle_sip_header_create(header.first.c_str(), header.second.c_str()));
+	if (bh) belle_sip_message_set_body_handler(BELLE_SIP_MESSAGE(httpRequest), BELLE_SIP_BODY_HANDLER(bh));
+	// keep a reference to the http request to be able to cancel it during upload
+	belle_sip_object_ref(httpRequest);
+
+	// give msg to listener to be able to start the actual file upload when server answer a 204 No content
+	httpListener = belle_http_request_listener_create_from_callbacks(cbs, this);
+	belle_http_provider_send_request(provider, httpRequest, httpListener);
+	return 0;
+}
 
+belle_http_request_t *FileTransferChatMessageModifier::createHttpRequest (const string &url, const string &action) {
 	shared_ptr<ChatMessage> message = chatMessage.lock();
-	if (!message){
-		goto error;
-	}
+	if (!message)
+		return nullptr;
 
 	if (url.empty()) {
 		lWarning() << "Cannot process file transfer msg [" << this << "]: no file remote URI configured.";
-		goto error;
+		return nullptr;
 	}
-	uri = belle_generic_uri_parse(url.c_str());
+	belle_generic_uri_t *uri = belle_generic_uri_parse(url.c_str());
 	if (!uri || !belle_generic_uri_get_host(uri)) {
 		lWarning() << "Cannot process file transfer msg [" << this << "]: incorrect file remote URI configured '" <<
 			url << "'.";
-		goto error;
+		if (uri) belle_sip_object_unref(uri);
+		return nullptr;
 	}
 
-	httpRequest = belle_http_request_create(
+	belle_http_request_t *request = belle_http_request_create(
 		action.c_str(),
 		uri,
 		belle_sip_header_create("User-Agent", linphone_core_get_user_agent(message->getCore()->getCCore())),
 		nullptr
 	);
-
-	if (!httpRequest) {
+	if (!request) {
 		lWarning() << "Could not create http request for uri " << url;
-		goto error;
-	}
-	if (bh) belle_sip_message_set_body_handler(BELLE_SIP_MESSAGE(httpRequest), BELLE_SIP_BODY_HANDLER(bh));
-	// keep a reference to the http request to be able to cancel it during upload
-	belle_sip_object_ref(httpRequest);
-
-	// give msg to listener to be able to start the actual file upload when server answer a 204 No content
-	httpListener = belle_http_request_listener_create_from_callbacks(cbs, this);
-	belle_http_provider_send_request(provider, httpRequest, httpListener);
-	return 0;
-
-error:
-	if (uri) {
 		belle_sip_object_unref(uri);
 	}
-	if (bh) belle_sip_object_unref(bh);
-	return -1;
+	return request;
 }
 
 void FileTransferChatMessageModifier::fileUploadBeginBackgroundTask () {
@@ -533,6 +592,315 @@ void FileTransferChatMessageModifier::fileUploadEndBackgroundTask () {
 	bgTask.stop();
 }
 
+// -----------------------------------------------------------------------------
+
+static bool getUploadOffset (const belle_http_response_t *response, size_t &offset) {
+	belle_sip_header_t *header = belle_sip_message_get_header(BELLE_SIP_MESSAGE(response), "Upload-Offset");
+	const char *value = header ? belle_sip_header_get_unparsed_value(header) : nullptr;
+	unsigned long long parsedOffset;
+	if (!value || sscanf(value, "%llu", &parsedOffset) != 1)
+		return false;
+	offset = static_cast<size_t>(parsedOffset);
+	return true;
+}
+
+void FileTransferChatMessageModifier::prepareChunkedUpload (
+	const shared_ptr<ChatMessage> &message,
+	list<pair<string, string>> &headers
+) {
+	releaseChunkedUpload();
+
+	const string &filePath = currentFileContentToTransfer->getFilePath();
+	LinphoneCore *lc = message->getCore()->getCCore();
+	int chunkSize = lp_config_get_int(lc->config, "misc", "file_transfer_upload_chunk_size", 0);
+	if (chunkSize <= 0 || filePath.empty())
+		return;
+
+	// Encrypted files are processed as a stream, they are sent in a single request.
+	EncryptionEngine *imee = message->getCore()->getEncryptionEngine();
+	if (imee && imee->isEncryptionEnabledForFileTransfer(message->getChatRoom()))
+		return;
+
+	uploadReader.reset(new FileChunkReader(filePath, static_cast<size_t>(chunkSize)));
+	if (!uploadReader->isOpen()) {
+		lWarning() << "Unable to open file [" << filePath << "] to upload it in chunks, msg [" << this << "]";
+		uploadReader.reset();
+		return;
+	}
+
+	// Offer an upload session to the server, it answers with a 201 if it supports them.
+	headers.emplace_back("Upload-Length", Utils::toString(static_cast<unsigned long long>(uploadReader->getFileSize())));
+	MainDb *mainDb = getFileTransferStateDb(message);
+	if (mainDb) {
+		string sessionId = mainDb->getChatMessageFileTransferUploadSession(message, filePath);
+		if (!sessionId.empty())
+			headers.emplace_back("Upload-Session", sessionId);
+	}
+}
+
+void FileTransferChatMessageModifier::startChunkedUpload (
+	const shared_ptr<ChatMessage> &message,
+	const belle_http_response_event_t *event
+) {
+	belle_sip_header_t *sessionHeader = belle_sip_message_get_header(BELLE_SIP_MESSAGE(event->response), "Upload-Session");
+	const char *sessionId = sessionHeader ? belle_sip_header_get_unparsed_value(sessionHeader) : nullptr;
+	size_t offset;
+	if (!sessionId || !sessionId[0] || !getUploadOffset(event->response, offset) || offset > uploadReader->getFileSize()) {
+		lWarning() << "Invalid upload session opened by the server for msg [" << this << "]";
+		onChunkedUploadFailed();
+		return;
+	}
+
+	uploadSessionId = sessionId;
+	if (offset > 0)
+		lInfo() << "Resuming file upload of msg [" << this << "] at " << offset;
+
+	FileTransferContent *fileTransferContent = new FileTransferContent();
+	fileTransferContent->setContentType(ContentType::FileTransfer);
+	fileTransferContent->setFileSize(uploadReader->getFileSize());
+	fileTransferContent->setFilePath(currentFileContentToTransfer->getFilePath());
+	message->getPrivate()->addContent(fileTransferContent);
+
+	// The upload can be resumed by another instance of the core.
+	MainDb *mainDb = getFileTransferStateDb(message);
+	if (mainDb)
+		mainDb->updateChatMessageFileTransferUploadSession(message, currentFileContentToTransfer->getFilePath(), uploadSessionId);
+
+	releaseHttpRequest();
+	fileUploadBeginBackgroundTask();
+	uploadReader->start(offset);
+	sendNextUploadChunk();
+}
+
+static int _chat_message_poll_upload_chunk (void *data, unsigned int revents) {
+	FileTransferChatMessageModifier *d = (FileTransferChatMessageModifier *)data;
+	d->pollUploadChunk();
+	return BELLE_SIP_STOP;
+}
+
+void FileTransferChatMessageModifier::pollUploadChunk () {
+	belle_sip_object_unref(uploadPollTimer);
+	uploadPollTimer = nullptr;
+	sendNextUploadChunk();
+}
+
+void FileTransferChatMessageModifier::sendNextUploadChunk () {
+	// Usually already read by the background thread, the main loop is never blocked waiting for the disk.
+	switch (uploadReader->tryTakeChunk(uploadChunk)) {
+		case FileChunkReader::TakeResult::Taken:
+			sendUploadChunk();
+			return;
+		case FileChunkReader::TakeResult::NotReady: {
+			shared_ptr<ChatMessage> message = chatMessage.lock();
+			if (!message)
+				return;
+			LinphoneCore *lc = message->getCore()->getCCore();
+			uploadPollTimer = lc->sal->createTimer(_chat_message_poll_upload_chunk, this, UploadChunkPollDelay, "file transfer upload chunk");
+			return;
+		}
+		case FileChunkReader::TakeResult::Failed:
+			break;
+	}
+	lError() << "Unable to read file [" << currentFileContentToTransfer->getFilePath() << "] to upload it, msg [" << this << "]";
+	onChunkedUploadFailed();
+}
+
+static void _chat_message_upload_chunk_on_progress (
+	belle_sip_body_handler_t *bh,
+	belle_sip_message_t *m,
+	void *data,
+	size_t offset,
+	size_t total
+) {
+	FileTransferChatMessageModifier *d = (FileTransferChatMessageModifier *)data;
+	d->uploadChunkOnProgress(bh, m, offset);
+}
+
+void FileTransferChatMessageModifier::uploadChunkOnProgress (belle_sip_body_handler_t *bh, belle_sip_message_t *m, size_t offset) {
+	fileTransferOnProgress(bh, m, uploadChunk.offset + offset, uploadReader ? uploadReader->getFileSize() : 0);
+}
+
+static void _chat_message_process_response_from_upload_chunk (void *data, const belle_http_response_event_t *event) {
+	FileTransferChatMessageModifier *d = (FileTransferChatMessageModifier *)data;
+	d->processResponseFromUploadChunk(event);
+}
+
+static void _chat_message_process_io_error_upload_chunk (void *data, const belle_sip_io_error_event_t *event) {
+	FileTransferChatMessageModifier *d = (FileTransferChatMessageModifier *)data;
+	d->processIoErrorUploadChunk(event);
+}
+
+void FileTransferChatMessageModifier::sendUploadChunk () {
+	shared_ptr<ChatMessage> message = chatMessage.lock();
+	if (!message)
+		return;
+
+	// An empty chunk at the end of the file asks the server to complete the upload.
+	belle_sip_body_handler_t *bh = nullptr;
+	if (!uploadChunk.data.empty())
+		bh = BELLE_SIP_BODY_HANDLER(belle_sip_memory_body_handler_new_copy_from_buffer(
+			uploadChunk.data.data(), uploadChunk.data.size(), _chat_message_upload_chunk_on_progress, this
+		));
+
+	list<pair<string, string>> headers;
+	headers.emplace_back("Upload-Session", uploadSessionId);
+	headers.emplace_back("Upload-Offset", Utils::toString(static_cast<unsigned long long>(uploadChunk.offset)));
+	headers.emplace_back("Content-Type", "application/offset+octet-stream");
+
+	belle_http_request_listener_callbacks_t cbs = { 0 };
+	cbs.process_response = _chat_message_process_response_from_upload_chunk;
+	cbs.process_io_error = _chat_message_process_io_error_upload_chunk;
+	cbs.process_auth_requested = _chat_message_process_auth_requested_upload;
+
+	releaseHttpRequest();
+	const char *url = linphone_core_get_file_transfer_server(message->getCore()->getCCore());
+	if (startHttpTransfer(url ? url : "", "PATCH", bh, &cbs, headers) == -1)
+		onChunkedUploadFailed();
+}
+
+void FileTransferChatMessageModifier::processResponseFromUploadChunk (const belle_http_response_event_t *event) {
+	if (httpRequest && !isFileTransferInProgressAndValid()) {
+		releaseHttpRequest();
+		return;
+	}
+
+	shared_ptr<ChatMessage> message = chatMessage.lock();
+	if (!message || !event->response || !uploadReader)
+		return;
+
+	int code = belle_http_response_get_status_code(event->response);
+	if (code == 200) { // the whole file has been received, the answer is the same as the one of a single upload
+		clearUploadState();
+		releaseChunkedUpload();
+		processResponseFromPostFile(event);
+	} else if (code == 204 || code == 409) { // 409: the server expected another offset
+		size_t offset;
+		if (!getUploadOffset(event->response, offset) || offset > uploadReader->getFileSize()) {
+			lWarning() << "Invalid upload offset received for msg [" << this << "]";
+			onChunkedUploadFailed();
+			return;
+		}
+
+		if (code == 409) {
+			LinphoneCore *lc = message->getCore()->getCCore();
+			if (uploadRetries++ >= lp_config_get_int(lc->config, "misc", "file_transfer_upload_max_retries", DefaultUploadMaxRetries)) {
+				lError() << "Giving up file upload of msg [" << this << "], the server keeps rejecting offset " << uploadChunk.offset;
+				onChunkedUploadFailed();
+				return;
+			}
+		} else
+			uploadRetries = 0;
+
+		if (offset != uploadChunk.offset + uploadChunk.data.size()) {
+			lInfo() << "Continuing file upload of msg [" << this << "] at " << offset << " requested by the server";
+			uploadReader->start(offset);
+		}
+		sendNextUploadChunk();
+	} else if (code == 404 || code == 410) {
+		lWarning() << "Upload session of msg [" << this << "] is no longer known by the server";
+		clearUploadState();
+		onChunkedUploadFailed();
+	} else if (code >= 500) {
+		lWarning() << "Received HTTP code response " << code << " for a chunk of file upload of msg [" << this << "]";
+		scheduleUploadChunkRetry();
+	} else {
+		lWarning() << "Unhandled HTTP code response " << code << " for a chunk of file upload of msg [" << this << "]";
+		onChunkedUploadFailed();
+	}
+}
+
+void FileTransferChatMessageModifier::processIoErrorUploadChunk (const belle_sip_io_error_event_t *event) {
+	lWarning() << "I/O Error during file upload of msg [" << this << "] at " << uploadChunk.offset;
+	if (uploadReader)
+		scheduleUploadChunkRetry();
+}
+
+static int _chat_message_retry_upload_chunk (void *data, unsigned int revents) {
+	FileTransferChatMessageModifier *d = (FileTransferChatMessageModifier *)data;
+	d->retryUploadChunk();
+	return BELLE_SIP_STOP;
+}
+
+void FileTransferChatMessageModifier::retryUploadChunk () {
+	belle_sip_object_unref(uploadRetryTimer);
+	uploadRetryTimer = nullptr;
+	sendUploadChunk();
+}
+
+void FileTransferChatMessageModifier::scheduleUploadChunkRetry () {
+	releaseHttpRequest();
+
+	shared_ptr<ChatMessage> message = chatMessage.lock();
+	if (!message)
+		return;
+
+	LinphoneCore *lc = message->getCore()->getCCore();
+	int maxRetries = lp_config_get_int(lc->config, "misc", "file_transfer_upload_max_retries", DefaultUploadMaxRetries);
+	if (uploadRetries >= maxRetries) {
+		lError() << "Giving up file upload of msg [" << this << "] after " << uploadRetries << " retries";
+		onChunkedUploadFailed();
+		return;
+	}
+
+	unsigned int delay = UploadRetryDelay << min(uploadRetries, 6);
+	uploadRetries++;
+	lInfo() << "Resuming file upload of msg [" << this << "] at " << uploadChunk.offset << " in " << delay << "ms";
+	uploadRetryTimer = lc->sal->createTimer(_chat_message_retry_upload_chunk, this, delay, "file transfer upload retry");
+}
+
+void FileTransferChatMessageModifier::onChunkedUploadFailed () {
+	// The session is kept in the database, the upload is resumed if the message is sent again.
+	releaseChunkedUpload();
+	releaseHttpRequest();
+	fileUploadEndBackgroundTask();
+
+	shared_ptr<ChatMessage> message = chatMessage.lock();
+	if (!message)
+		return;
+	removeFileTransferContentToUpload(message);
+	message->getPrivate()->setState(ChatMessage::State::NotDelivered);
+}
+
+void FileTransferChatMessageModifier::removeFileTransferContentToUpload (const shared_ptr<ChatMessage> &message) {
+	for (Content *c : message->getPrivate()->getContents()) {
+		if (c->isFileTransfer()) {
+			FileTransferContent *fileTransferContent = static_cast<FileTransferContent *>(c);
+			if (!fileTransferContent->getFileContent() && fileTransferContent->getSize() == 0) {
+				message->getPrivate()->removeContent(fileTransferContent);
+				delete fileTransferContent;
+				return;
+			}
+		}
+	}
+}
+
+void FileTransferChatMessageModifier::clearUploadState () {
+	shared_ptr<ChatMessage> message = chatMessage.lock();
+	if (!message)
+		return;
+
+	MainDb *mainDb = getFileTransferStateDb(message);
+	if (mainDb)
+		mainDb->deleteChatMessageFileTransferUploadSession(message);
+}
+
+void FileTransferChatMessageModifier::releaseChunkedUpload () {
+	if (uploadRetryTimer) {
+		belle_sip_source_cancel(uploadRetryTimer);
+		belle_sip_object_unref(uploadRetryTimer);
+		uploadRetryTimer = nullptr;
+	}
+	if (uploadPollTimer) {
+		belle_sip_source_cancel(uploadPollTimer);
+		belle_sip_object_unref(uploadPollTimer);
+		uploadPollTimer = nullptr;
+	}
+	uploadReader.reset();
+	uploadChunk = FileChunkReader::Chunk();
+	uploadSessionId.clear();
+	uploadRetries = 0;
+}
+
 // ----------------------------------------------------------
 
 static void fillFileTransferContentInformationsFromVndGsmaRcsFtHttpXml (FileTransferContent *fileTransferContent) {
@@ -609,7 +977,7 @@ ChatMessageModifier::Result FileTransferChatMessageModifier::decode (const share
 	if (internalContent.getContentType() == ContentType::FileTransfer) {
 		FileTransferContent *fileTransferContent = new FileTransferContent();
 		fileTransferContent->setContentType(internalContent.getContentType());
-		fileTransferContent->setBody(internalContent.getBody());
+		fileTransferContent->setBody(internalContent.getBodyBuffer());
 		fillFileTransferContentInformationsFromVndGsmaRcsFtHttpXml(fileTransferContent);
 		message->addContent(fileTransferContent);
 		return ChatMessageModifier::Result::Done;
@@ -712,12 +1080,13 @@ static void createFileTransferInformationsFromVndGsmaRcsFtHttpXml (FileTransferC
 }
 
 static void _chat_message_on_recv_body (belle_sip_user_body_handler_t *bh, belle_sip_message_t *m, void *data, size_t offset, uint8_t *buffer, size_t size) {
-	FileTransferChatMessageModifier *d = (FileTransferChatMessageModifier *)data;
-	d->onRecvBody(bh, m, offset, buffer, size);
+	const DownloadRequestContext *context = static_cast<const DownloadRequestContext *>(data);
+	context->modifier->onRecvBody(context, buffer, size);
 }
 
-void FileTransferChatMessageModifier::onRecvBody (belle_sip_user_body_handler_t *bh, belle_sip_message_t *m, size_t offset, uint8_t *buffer, size_t size) {
-	if (!httpRequest || belle_http_request_is_cancelled(httpRequest)) {
+void FileTransferChatMessageModifier::onRecvBody (const DownloadRequestContext *context, uint8_t *buffer, size_t size) {
+	DownloadSegment *segment = getDownloadSegment(context);
+	if (!segment || belle_http_request_is_cancelled(segment->request)) {
 		lWarning() << "Cancelled request for msg [" << this << "], ignoring " << __FUNCTION__;
 		return;
 	}
@@ -731,53 +1100,106 @@ void FileTransferChatMessageModifier::onRecvBody (belle_sip_user_body_handler_t
 	if (!message)
 		return;
 
+	size_t offset = segment->start + segment->received;
+	if (segment->end && offset + size > segment->end) {
+		lWarning() << "Received more than the requested range for msg [" << this << "], ignoring the extra bytes";
+		size = segment->end - offset;
+		if (size == 0)
+			return;
+	}
+
 	int retval = -1;
 	EncryptionEngine *imee = message->getCore()->getEncryptionEngine();
 	if (imee) {
-		uint8_t *decrypted_buffer = (uint8_t *)ms_malloc0(size);
+		uint8_t *decrypted_buffer = imee->isFileTransferProcessedInPlace() ? buffer : getCryptoBuffer(size);
 		retval = imee->downloadingFile(message, offset, buffer, size, decrypted_buffer);
-		if (retval == 0) {
+		if (retval == 0 && decrypted_buffer != buffer)
 			memcpy(buffer, decrypted_buffer, size);
-		}
-		ms_free(decrypted_buffer);
 	}
 
-	if (retval <= 0) {
-		if (currentFileContentToTransfer->getFilePath().empty()) {
-			LinphoneChatMessage *msg = L_GET_C_BACK_PTR(message);
-			LinphoneChatMessageCbs *cbs = linphone_chat_message_get_callbacks(msg);
-			LinphoneContent *content = L_GET_C_BACK_PTR((Content *)currentFileContentToTransfer);
-			LinphoneBuffer *lb = linphone_buffer_new_from_data(buffer, size);
-			// Deprecated: use list of callbacks now
-			if (linphone_chat_message_cbs_get_file_transfer_recv(cbs)) {
-				linphone_chat_message_cbs_get_file_transfer_recv(cbs)(msg, content, lb);
-			} else {
-				// Legacy: call back given by application level
-				linphone_core_notify_file_transfer_recv(message->getCore()->getCCore(), msg, content, (const char *)buffer, size);
-			}
-			_linphone_chat_message_notify_file_transfer_recv(msg, content, lb);
-			linphone_buffer_unref(lb);
-		}
-	} else {
+	if (retval > 0) {
 		lWarning() << "File transfer decrypt failed with code " << (int)retval;
 		message->getPrivate()->setState(ChatMessage::State::FileTransferError);
+		return;
+	}
+
+	if (downloadedFile) {
+		if (bctbx_file_write(downloadedFile, buffer, size, (off_t)offset) != (ssize_t)size) {
+			lError() << "Cannot write downloaded file [" << currentFileContentToTransfer->getFilePath() << "]";
+			message->getPrivate()->setState(ChatMessage::State::FileTransferError);
+			return;
+		}
+	} else {
+		LinphoneChatMessage *msg = L_GET_C_BACK_PTR(message);
+		LinphoneChatMessageCbs *cbs = linphone_chat_message_get_callbacks(msg);
+		LinphoneContent *content = L_GET_C_BACK_PTR((Content *)currentFileContentToTransfer);
+		LinphoneBuffer *lb = getRecvBuffer(buffer, size);
+		// Deprecated: use list of callbacks now
+		if (linphone_chat_message_cbs_get_file_transfer_recv(cbs)) {
+			linphone_chat_message_cbs_get_file_transfer_recv(cbs)(msg, content, lb);
+		} else {
+			// Legacy: call back given by application level
+			linphone_core_notify_file_transfer_recv(message->getCore()->getCCore(), msg, content, (const char *)buffer, size);
+		}
+		_linphone_chat_message_notify_file_transfer_recv(msg, content, lb);
+		// The application may have cancelled the transfer.
+		segment = getDownloadSegment(context);
+		if (!segment)
+			return;
 	}
+
+	segment->received += size;
+	segment->retries = 0;
+	downloadedSize += size;
+	fileTransferOnProgress(nullptr, nullptr, downloadedSize, downloadFileSize);
+
+	if (downloadedSize - downloadSavedSize >= DownloadStateSaveInterval)
+		saveDownloadState();
 }
 
 static void _chat_message_on_recv_end (belle_sip_user_body_handler_t *bh, void *data) {
-	FileTransferChatMessageModifier *d = (FileTransferChatMessageModifier *)data;
-	d->onRecvEnd(bh);
+	const DownloadRequestContext *context = static_cast<const DownloadRequestContext *>(data);
+	context->modifier->onRecvEnd(context);
 }
 
-void FileTransferChatMessageModifier::onRecvEnd (belle_sip_user_body_handler_t *bh) {
+void FileTransferChatMessageModifier::onRecvEnd (const DownloadRequestContext *context) {
+	DownloadSegment *segment = getDownloadSegment(context);
+	if (!segment)
+		return;
+
 	shared_ptr<ChatMessage> message = chatMessage.lock();
 	if (!message)
 		return;
 
+	releaseDownloadSegment(segment, false);
+	if (message->getState() == ChatMessage::State::FileTransferError) {
+		// The data could not be decrypted or written.
+		releaseDownload();
+		return;
+	}
+
+	if (segment->end == 0) {
+		// The size of the file was not known, the whole body has been received.
+		segment->end = segment->start + segment->received;
+		downloadFileSize = segment->end;
+	}
+	if (segment->start + segment->received < segment->end) {
+		lWarning() << "Download of msg [" << this << "] interrupted at " << segment->start + segment->received <<
+			" of range [" << segment->start << ", " << segment->end << ")";
+		scheduleDownloadSegmentRetry(segment);
+		return;
+	}
+
+	segment->complete = true;
+	if (isDownloadComplete())
+		finishDownload(message);
+}
+
+void FileTransferChatMessageModifier::finishDownload (const shared_ptr<ChatMessage> &message) {
 	shared_ptr<Core> core = message->getCore();
 
 	int retval = -1;
-	EncryptionEngine *imee = message->getCore()->getEncryptionEngine();
+	EncryptionEngine *imee = core->getEncryptionEngine();
 	if (imee) {
 		retval = imee->downloadingFile(message, 0, nullptr, 0, nullptr);
 	}
@@ -787,7 +1209,7 @@ void FileTransferChatMessageModifier::onRecvEnd (belle_sip_user_body_handler_t *
 			LinphoneChatMessage *msg = L_GET_C_BACK_PTR(message);
 			LinphoneChatMessageCbs *cbs = linphone_chat_message_get_callbacks(msg);
 			LinphoneContent *content = L_GET_C_BACK_PTR((Content *)currentFileContentToTransfer);
-				LinphoneBuffer *lb = linphone_buffer_new();
+			LinphoneBuffer *lb = linphone_buffer_new();
 			// Deprecated: use list of callbacks now
 			if (linphone_chat_message_cbs_get_file_transfer_recv(cbs)) {
 				linphone_chat_message_cbs_get_file_transfer_recv(cbs)(msg, content, lb);
@@ -800,7 +1222,17 @@ void FileTransferChatMessageModifier::onRecvEnd (belle_sip_user_body_handler_t *
 		}
 	}
 
-	if (retval <= 0 && message->getState() != ChatMessage::State::FileTransferError) {
+	clearDownloadState();
+	// Closes the file before the application is told it is there.
+	releaseDownload();
+
+	if (retval > 0) {
+		lWarning() << "File transfer decrypt failed with code " << (int)retval;
+		message->getPrivate()->setState(ChatMessage::State::FileTransferError);
+		return;
+	}
+
+	if (message->getState() != ChatMessage::State::FileTransferError) {
 		// Remove the FileTransferContent from the message and store the FileContent
 		FileContent *fileContent = currentFileContentToTransfer;
 		message->getPrivate()->addContent(fileContent);
@@ -815,7 +1247,6 @@ void FileTransferChatMessageModifier::onRecvEnd (belle_sip_user_body_handler_t *
 			}
 		}
 		if (message->getPrivate()->isAutoFileTransferDownloadHappened()) {
-			releaseHttpRequest();
 			message->getPrivate()->receive();
 		} else {
 			message->getPrivate()->setState(ChatMessage::State::FileTransferDone);
@@ -824,81 +1255,92 @@ void FileTransferChatMessageModifier::onRecvEnd (belle_sip_user_body_handler_t *
 }
 
 static void _chat_process_response_headers_from_get_file (void *data, const belle_http_response_event_t *event) {
-	FileTransferChatMessageModifier *d = (FileTransferChatMessageModifier *)data;
-	d->processResponseHeadersFromGetFile(event);
+	const DownloadRequestContext *context = static_cast<const DownloadRequestContext *>(data);
+	context->modifier->processResponseHeadersFromGetFile(context, event);
 }
 
-static FileContent* createFileTransferInformationFromHeaders (const belle_sip_message_t *m) {
-	FileContent *fileContent = new FileContent();
+void FileTransferChatMessageModifier::processResponseHeadersFromGetFile (const DownloadRequestContext *context, const belle_http_response_event_t *event) {
+	DownloadSegment *segment = getDownloadSegment(context);
+	if (!segment || !event->response)
+		return;
 
-	belle_sip_header_content_length_t *content_length_hdr = BELLE_SIP_HEADER_CONTENT_LENGTH(belle_sip_message_get_header(m, "Content-Length"));
-	belle_sip_header_content_type_t *content_type_hdr = BELLE_SIP_HEADER_CONTENT_TYPE(belle_sip_message_get_header(m, "Content-Type"));
+	shared_ptr<ChatMessage> message = chatMessage.lock();
+	if (!message)
+		return;
 
-	if (content_type_hdr) {
-		const char *type = belle_sip_header_content_type_get_type(content_type_hdr);
-		const char *subtype = belle_sip_header_content_type_get_subtype(content_type_hdr);
-		lInfo() << "Extracted content type " << type << " / " << subtype << " from header";
-		ContentType contentType(type, subtype);
-		fileContent->setContentType(contentType);
+	int code = belle_http_response_get_status_code(event->response);
+	if (code >= 400 && code < 500) {
+		lWarning() << "File transfer failed with code " << code;
+		message->getPrivate()->setState(ChatMessage::State::FileTransferError);
+		clearDownloadState();
+		releaseDownload();
+		return;
 	}
-	if (content_length_hdr) {
-		fileContent->setFileSize(belle_sip_header_content_length_get_content_length(content_length_hdr));
-		lInfo() << "Extracted content length " << fileContent->getFileSize() << " from header";
+	if (code != 200 && code != 206) {
+		lWarning() << "Unhandled HTTP code response " << code << " for file transfer";
+		releaseDownloadSegment(segment, false);
+		scheduleDownloadSegmentRetry(segment);
+		return;
 	}
 
-	return fileContent;
-}
-
-void FileTransferChatMessageModifier::processResponseHeadersFromGetFile (const belle_http_response_event_t *event) {
-	if (event->response) {
-		int code = belle_http_response_get_status_code(event->response);
-		shared_ptr<ChatMessage> message = chatMessage.lock();
-
-		if (!message)
-			return;
-
-		if (code >= 400 && code < 500) {
-			lWarning() << "File transfer failed with code " << code;
-			message->getPrivate()->setState(ChatMessage::State::FileTransferError);
-			releaseHttpRequest();
+	belle_sip_message_t *response = BELLE_SIP_MESSAGE(event->response);
+	belle_sip_header_content_length_t *contentLengthHeader = BELLE_SIP_HEADER_CONTENT_LENGTH(belle_sip_message_get_header(response, "Content-Length"));
+	size_t offset = segment->start + segment->received;
+
+	if (code == 206) {
+		belle_sip_header_t *contentRangeHeader = belle_sip_message_get_header(response, "Content-Range");
+		const char *contentRange = contentRangeHeader ? belle_sip_header_get_unparsed_value(contentRangeHeader) : nullptr;
+		unsigned long long rangeStart = 0;
+		unsigned long long fileSize = 0;
+		if (!contentRange || sscanf(contentRange, "bytes %llu-%*u/%llu", &rangeStart, &fileSize) < 1 || rangeStart != offset) {
+			lWarning() << "Unexpected range [" << L_C_TO_STRING(contentRange) << "] for file transfer of msg [" << this << "]";
+			onDownloadFailed();
 			return;
 		}
-
-		// we are receiving a response, set a specific body handler to acquire the response.
-		// if not done, belle-sip will create a memory body handler, the default
-		belle_sip_message_t *response = BELLE_SIP_MESSAGE(event->response);
-
-		if (currentFileContentToTransfer) {
-			belle_sip_header_content_length_t *content_length_hdr = BELLE_SIP_HEADER_CONTENT_LENGTH(belle_sip_message_get_header(response, "Content-Length"));
-			currentFileContentToTransfer->setFileSize(belle_sip_header_content_length_get_content_length(content_length_hdr));
-			lInfo() << "Extracted content length " << currentFileContentToTransfer->getFileSize() << " from header";
-		} else {
-			lWarning() << "No file transfer information for msg [" << this << "]: creating...";
-			FileContent *content = createFileTransferInformationFromHeaders(response);
-			message->addContent(content);
+		if (downloadFileSize == 0 && fileSize > 0) {
+			downloadFileSize = static_cast<size_t>(fileSize);
+			segment->end = downloadFileSize;
+			currentFileContentToTransfer->setFileSize(downloadFileSize);
 		}
-
-		size_t body_size = 0;
-		if (currentFileContentToTransfer)
-			body_size = currentFileContentToTransfer->getFileSize();
-
-		belle_sip_body_handler_t *body_handler = (belle_sip_body_handler_t *)belle_sip_user_body_handler_new(
-			body_size, _chat_message_file_transfer_on_progress,
-			nullptr, _chat_message_on_recv_body,
-			nullptr, _chat_message_on_recv_end, this
-		);
-		if (!currentFileContentToTransfer->getFilePath().empty()) {
-			belle_sip_user_body_handler_t *bh = (belle_sip_user_body_handler_t *)body_handler;
-			body_handler = (belle_sip_body_handler_t *)belle_sip_file_body_handler_new(currentFileContentToTransfer->getFilePath().c_str(), _chat_message_file_transfer_on_progress, this);
-			if (belle_sip_body_handler_get_size((belle_sip_body_handler_t *)body_handler) == 0) {
-				// If the size of the body has not been initialized from the file stat, use the one from the
-				// file_transfer_information.
-				belle_sip_body_handler_set_size((belle_sip_body_handler_t *)body_handler, body_size);
+		// The server supports ranges, the other segments can be fetched now.
+		startPendingDownloadSegments();
+	} else {
+		if (offset > 0 || downloadSegments.size() > 1) {
+			// The server ignored the range and sends the whole file.
+			if (!downloadResumable) {
+				lWarning() << "Cannot resume download of msg [" << this << "], the server does not support ranges";
+				onDownloadFailed();
+				return;
+			}
+			lInfo() << "The server does not support ranges, downloading the whole file of msg [" << this << "]";
+			for (const auto &other : downloadSegments) {
+				if (other.get() == segment)
+					continue;
+				releaseDownloadSegment(other.get(), true);
+				other->start = other->end = other->received = 0;
+				other->started = other->complete = true;
 			}
-			belle_sip_file_body_handler_set_user_body_handler((belle_sip_file_body_handler_t *)body_handler, bh);
+			segment->start = segment->received = 0;
+			downloadedSize = 0;
+			if (downloadedFile)
+				bctbx_file_truncate(downloadedFile, 0);
 		}
-		belle_sip_message_set_body_handler((belle_sip_message_t *)event->response, body_handler);
+		if (contentLengthHeader) {
+			downloadFileSize = belle_sip_header_content_length_get_content_length(contentLengthHeader);
+			currentFileContentToTransfer->setFileSize(downloadFileSize);
+			lInfo() << "Extracted content length " << downloadFileSize << " from header";
+		}
+		segment->end = downloadFileSize;
 	}
+
+	// we are receiving a response, set a specific body handler to acquire the response.
+	// if not done, belle-sip will create a memory body handler, the default
+	belle_sip_body_handler_t *bodyHandler = (belle_sip_body_handler_t *)belle_sip_user_body_handler_new(
+		contentLengthHeader ? belle_sip_header_content_length_get_content_length(contentLengthHeader) : 0,
+		nullptr, nullptr, _chat_message_on_recv_body, nullptr, _chat_message_on_recv_end,
+		const_cast<DownloadRequestContext *>(context)
+	);
+	belle_sip_message_set_body_handler(response, bodyHandler);
 }
 
 void FileTransferChatMessageModifier::onDownloadFailed() {
@@ -907,63 +1349,113 @@ void FileTransferChatMessageModifier::onDownloadFailed() {
 		return;
 	if (message->getPrivate()->isAutoFileTransferDownloadHappened()) {
 		message->getPrivate()->doNotRetryAutoDownload();
-		releaseHttpRequest();
+		releaseDownload();
 		message->getPrivate()->receive();
 	} else {
 		message->getPrivate()->setState(ChatMessage::State::FileTransferError);
-		releaseHttpRequest();
+		releaseDownload();
 	}
 }
 
 static void _chat_message_process_auth_requested_download (void *data, belle_sip_auth_event *event) {
-	FileTransferChatMessageModifier *d = (FileTransferChatMessageModifier *)data;
-	d->processAuthRequestedDownload(event);
+	const DownloadRequestContext *context = static_cast<const DownloadRequestContext *>(data);
+	context->modifier->processAuthRequestedDownload(context, event);
 }
 
-void FileTransferChatMessageModifier::processAuthRequestedDownload (const belle_sip_auth_event *event) {
+void FileTransferChatMessageModifier::processAuthRequestedDownload (const DownloadRequestContext *context, const belle_sip_auth_event *event) {
+	if (!getDownloadSegment(context))
+		return;
 	lError() << "Error during file download : auth requested for msg [" << this << "]";
 	onDownloadFailed();
 }
 
 static void _chat_message_process_io_error_download (void *data, const belle_sip_io_error_event_t *event) {
-	FileTransferChatMessageModifier *d = (FileTransferChatMessageModifier *)data;
-	d->processIoErrorDownload(event);
+	const DownloadRequestContext *context = static_cast<const DownloadRequestContext *>(data);
+	context->modifier->processIoErrorDownload(context, event);
 }
 
-void FileTransferChatMessageModifier::processIoErrorDownload (const belle_sip_io_error_event_t *event) {
-	lError() << "I/O Error during file download msg [" << this << "]";
-	onDownloadFailed();
+void FileTransferChatMessageModifier::processIoErrorDownload (const DownloadRequestContext *context, const belle_sip_io_error_event_t *event) {
+	// The message owns the modifier, keep it until the context is removed.
+	shared_ptr<ChatMessage> message = chatMessage.lock();
+	DownloadSegment *segment = getDownloadSegment(context);
+	if (segment) {
+		lError() << "I/O Error during file download msg [" << this << "]";
+		releaseDownloadSegment(segment, false);
+		scheduleDownloadSegmentRetry(segment);
+	}
+	removeDownloadRequestContext(context);
 }
 
 static void _chat_message_process_response_from_get_file (void *data, const belle_http_response_event_t *event) {
-	FileTransferChatMessageModifier *d = (FileTransferChatMessageModifier *)data;
-	d->processResponseFromGetFile(event);
+	const DownloadRequestContext *context = static_cast<const DownloadRequestContext *>(data);
+	context->modifier->processResponseFromGetFile(context, event);
 }
 
-void FileTransferChatMessageModifier::processResponseFromGetFile (const belle_http_response_event_t *event) {
-	// check the answer code
-	if (event->response) {
-		shared_ptr<ChatMessage> message = chatMessage.lock();
-		if (!message)
-			return;
-
+void FileTransferChatMessageModifier::processResponseFromGetFile (const DownloadRequestContext *context, const belle_http_response_event_t *event) {
+	// The message owns the modifier, keep it until the context is removed.
+	shared_ptr<ChatMessage> message = chatMessage.lock();
+	// The segment is released when its body ends, only responses that did not go through the body handler remain.
+	if (getDownloadSegment(context) && event->response) {
 		int code = belle_http_response_get_status_code(event->response);
-		if (code >= 400 && code < 500) {
-			lWarning() << "File transfer failed with code " << code;
-			onDownloadFailed();
-		} else if (code != 200) {
+		if (code == 200 || code == 206) {
+			// The body handler is not told about the end of an empty body.
+			onRecvEnd(context);
+		} else {
 			lWarning() << "Unhandled HTTP code response " << code << " for file transfer";
 		}
 	}
+	removeDownloadRequestContext(context);
 }
 
+static int _chat_message_retry_download_segment (void *data, unsigned int revents) {
+	FileTransferChatMessageModifier::DownloadSegment *segment = static_cast<FileTransferChatMessageModifier::DownloadSegment *>(data);
+	segment->modifier->retryDownloadSegment(segment);
+	return BELLE_SIP_STOP;
+}
+
+void FileTransferChatMessageModifier::retryDownloadSegment (DownloadSegment *segment) {
+	belle_sip_object_unref(segment->retryTimer);
+	segment->retryTimer = nullptr;
+
+	for (size_t i = 0; i < downloadSegments.size(); i++) {
+		if (downloadSegments[i].get() == segment) {
+			if (startDownloadSegment(i) == -1)
+				onDownloadFailed();
+			return;
+		}
+	}
+}
+
+void FileTransferChatMessageModifier::scheduleDownloadSegmentRetry (DownloadSegment *segment) {
+	shared_ptr<ChatMessage> message = chatMessage.lock();
+	if (!message)
+		return;
+
+	LinphoneCore *lc = message->getCore()->getCCore();
+	int maxRetries = lp_config_get_int(lc->config, "misc", "file_transfer_download_max_retries", DefaultDownloadMaxRetries);
+	if (segment->retries >= maxRetries) {
+		lError() << "Giving up file download of msg [" << this << "] after " << segment->retries << " retries";
+		saveDownloadState();
+		onDownloadFailed();
+		return;
+	}
+
+	unsigned int delay = DownloadRetryDelay << min(segment->retries, 6);
+	segment->retries++;
+	lInfo() << "Resuming file download of msg [" << this << "] at " << segment->start + segment->received <<
+		" in " << delay << "ms";
+	segment->retryTimer = lc->sal->createTimer(_chat_message_retry_download_segment, segment, delay, "file transfer download retry");
+}
+
+// -----------------------------------------------------------------------------
+
 bool FileTransferChatMessageModifier::downloadFile (
 	const shared_ptr<ChatMessage> &message,
 	FileTransferContent *fileTransferContent
 ) {
 	chatMessage = message;
 
-	if (httpRequest) {
+	if (httpRequest || isDownloadInProgress()) {
 		lError() << "There is already a download in progress.";
 		return false;
 	}
@@ -984,22 +1476,241 @@ bool FileTransferChatMessageModifier::downloadFile (
 		currentFileContentToTransfer->setFilePath(message->getPrivate()->getFileTransferFilepath());
 	}
 
+	const string &filePath = currentFileContentToTransfer->getFilePath();
+	if (!filePath.empty()) {
+		downloadedFile = bctbx_file_open2(bctbx_vfs_get_default(), filePath.c_str(), O_WRONLY | O_CREAT);
+		if (!downloadedFile) {
+			lError() << "Cannot open file [" << filePath << "] to download msg [" << this << "]";
+			return false;
+		}
+	}
+
+	downloadUrl = fileTransferContent->getFileUrl(); // File URL has been set by createFileTransferInformationsFromVndGsmaRcsFtHttpXml
+	downloadFileSize = currentFileContentToTransfer->getFileSize();
+	downloadResumable = downloadedFile && fileTransferContent->getFileKeySize() == 0;
+	planDownloadSegments(message);
+	if (downloadedFile && downloadedSize == 0)
+		bctbx_file_truncate(downloadedFile, 0);
+
+	auto segment = find_if(downloadSegments.cbegin(), downloadSegments.cend(), [](const unique_ptr<DownloadSegment> &pending) {
+		return !pending->complete;
+	});
+	// The other segments are started once the server is known to support ranges.
+	if (segment != downloadSegments.cend() && startDownloadSegment(size_t(segment - downloadSegments.cbegin())) == -1) {
+		releaseDownload();
+		return false;
+	}
+
+	// start the download, status is In Progress
+	message->getPrivate()->setState(ChatMessage::State::FileTransferInProgress);
+	if (segment == downloadSegments.cend())
+		finishDownload(message);
+	return true;
+}
+
+void FileTransferChatMessageModifier::planDownloadSegments (const shared_ptr<ChatMessage> &message) {
+	downloadSegments.clear();
+	downloadedSize = 0;
+
+	auto addSegment = [this](size_t start, size_t end, size_t received) {
+		unique_ptr<DownloadSegment> segment(new DownloadSegment);
+		segment->modifier = this;
+		segment->start = start;
+		segment->end = end;
+		segment->received = received;
+		segment->complete = end > 0 && start + received >= end;
+		downloadedSize += received;
+		downloadSegments.push_back(move(segment));
+	};
+
+	MainDb *mainDb = downloadResumable ? getFileTransferStateDb(message) : nullptr;
+	if (mainDb) {
+		list<MainDb::FileTransferSegment> savedSegments = mainDb->getChatMessageFileTransferSegments(
+			message, downloadUrl, currentFileContentToTransfer->getFilePath()
+		);
+		// The received bytes must still be in the file.
+		int64_t fileSize = bctbx_file_size(downloadedFile);
+		bool valid = !savedSegments.empty() && fileSize >= 0;
+		for (const auto &saved : savedSegments)
+			valid = valid && saved.end > 0 && saved.start + saved.received <= min(saved.end, static_cast<size_t>(fileSize));
+
+		if (valid) {
+			for (const auto &saved : savedSegments)
+				addSegment(saved.start, saved.end, saved.received);
+			downloadFileSize = downloadSegments.back()->end;
+			downloadSavedSize = downloadedSize;
+			lInfo() << "Resuming file download of msg [" << this << "] at " << downloadedSize << "/" << downloadFileSize;
+			return;
+		}
+	}
+
+	size_t count = 1;
+	if (downloadResumable && downloadFileSize > 0) {
+		LpConfig *config = message->getCore()->getCCore()->config;
+		int maxCount = lp_config_get_int(config, "misc", "file_transfer_download_segments", 1);
+		int minSize = lp_config_get_int(config, "misc", "file_transfer_download_segment_min_size", DefaultDownloadSegmentMinSize);
+		if (maxCount > 1 && minSize > 0)
+			count = max(size_t(1), min(size_t(maxCount), downloadFileSize / size_t(minSize)));
+	}
+
+	size_t segmentSize = downloadFileSize / count;
+	for (size_t i = 0; i < count; i++)
+		addSegment(i * segmentSize, (i == count - 1) ? downloadFileSize : (i + 1) * segmentSize, 0);
+	downloadSavedSize = 0;
+}
+
+int FileTransferChatMessageModifier::startDownloadSegment (size_t index) {
+	DownloadSegment *segment = downloadSegments[index].get();
+	belle_http_request_t *request = createHttpRequest(downloadUrl, "GET");
+	if (!request)
+		return -1;
+
+	size_t offset = segment->start + segment->received;
+	if (offset > 0 || (segment->end > 0 && segment->end < downloadFileSize)) {
+		string range = "bytes=" + Utils::toString(static_cast<unsigned long long>(offset)) + "-";
+		if (segment->end > 0)
+			range += Utils::toString(static_cast<unsigned long long>(segment->end - 1));
+		belle_sip_message_add_header(BELLE_SIP_MESSAGE(request), belle_sip_header_create("Range", range.c_str()));
+	}
+
+	segment->generation = ++lastDownloadRequestGeneration;
+	downloadRequestContexts.push_back(DownloadRequestContext{ this, index, segment->generation });
+
 	belle_http_request_listener_callbacks_t cbs = { 0 };
 	cbs.process_response_headers = _chat_process_response_headers_from_get_file;
 	cbs.process_response = _chat_message_process_response_from_get_file;
 	cbs.process_io_error = _chat_message_process_io_error_download;
 	cbs.process_auth_requested = _chat_message_process_auth_requested_download;
-	int err = startHttpTransfer(fileTransferContent->getFileUrl(), "GET", nullptr, &cbs); // File URL has been set by createFileTransferInformationsFromVndGsmaRcsFtHttpXml
-	if (err == -1)
-		return false;
-	// start the download, status is In Progress
-	message->getPrivate()->setState(ChatMessage::State::FileTransferInProgress);
-	return true;
+
+	// keep a reference to the http request to be able to cancel it during download
+	belle_sip_object_ref(request);
+	segment->request = request;
+	segment->listener = belle_http_request_listener_create_from_callbacks(&cbs, &downloadRequestContexts.back());
+	segment->started = true;
+	belle_http_provider_send_request(provider, request, segment->listener);
+	return 0;
+}
+
+void FileTransferChatMessageModifier::startPendingDownloadSegments () {
+	for (size_t i = 0; i < downloadSegments.size(); i++) {
+		if (!downloadSegments[i]->started && !downloadSegments[i]->complete)
+			startDownloadSegment(i);
+	}
+}
+
+FileTransferChatMessageModifier::DownloadSegment *FileTransferChatMessageModifier::getDownloadSegment (
+	const DownloadRequestContext *context
+) const {
+	if (context->segmentIndex >= downloadSegments.size())
+		return nullptr;
+	DownloadSegment *segment = downloadSegments[context->segmentIndex].get();
+	return segment->request && segment->generation == context->generation ? segment : nullptr;
+}
+
+void FileTransferChatMessageModifier::removeDownloadRequestContext (const DownloadRequestContext *context) {
+	downloadRequestContexts.remove_if([context](const DownloadRequestContext &other) {
+		return &other == context;
+	});
+}
+
+bool FileTransferChatMessageModifier::isDownloadInProgress () const {
+	return !downloadSegments.empty();
+}
+
+bool FileTransferChatMessageModifier::isDownloadComplete () const {
+	return all_of(downloadSegments.cbegin(), downloadSegments.cend(), [](const unique_ptr<DownloadSegment> &segment) {
+		return segment->complete;
+	});
+}
+
+void FileTransferChatMessageModifier::saveDownloadState () {
+	shared_ptr<ChatMessage> message = chatMessage.lock();
+	if (!downloadResumable || downloadSegments.empty() || !message)
+		return;
+
+	MainDb *mainDb = getFileTransferStateDb(message);
+	if (!mainDb)
+		return;
+
+	list<MainDb::FileTransferSegment> segments;
+	for (const auto &segment : downloadSegments) {
+		if (segment->end == 0) {
+			if (segment->start == 0 && segment->complete)
+				continue; // Dropped when the server sent the whole file.
+			return; // Nothing can be resumed while the size of the file is unknown.
+		}
+		segments.push_back(MainDb::FileTransferSegment{ segment->start, segment->end, segment->received });
+	}
+	mainDb->updateChatMessageFileTransferSegments(message, downloadUrl, currentFileContentToTransfer->getFilePath(), segments);
+	downloadSavedSize = downloadedSize;
+}
+
+void FileTransferChatMessageModifier::clearDownloadState () {
+	shared_ptr<ChatMessage> message = chatMessage.lock();
+	if (!downloadResumable || !message)
+		return;
+
+	MainDb *mainDb = getFileTransferStateDb(message);
+	if (mainDb)
+		mainDb->deleteChatMessageFileTransferSegments(message);
+}
+
+void FileTransferChatMessageModifier::releaseDownloadSegment (DownloadSegment *segment, bool cancel) {
+	if (segment->retryTimer) {
+		belle_sip_source_cancel(segment->retryTimer);
+		belle_sip_object_unref(segment->retryTimer);
+		segment->retryTimer = nullptr;
+	}
+	if (segment->request) {
+		if (cancel && !belle_http_request_is_cancelled(segment->request))
+			belle_http_provider_cancel_request(provider, segment->request);
+		belle_sip_object_unref(segment->request);
+		segment->request = nullptr;
+	}
+	if (segment->listener) {
+		belle_sip_object_unref(segment->listener);
+		segment->listener = nullptr;
+	}
+}
+
+void FileTransferChatMessageModifier::releaseDownload () {
+	for (const auto &segment : downloadSegments)
+		releaseDownloadSegment(segment.get(), true);
+	downloadSegments.clear();
+	if (downloadedFile) {
+		bctbx_file_close(downloadedFile);
+		downloadedFile = nullptr;
+	}
+	downloadFileSize = downloadedSize = downloadSavedSize = 0;
+	downloadResumable = false;
+	releaseTransferBuffers();
 }
 
 // ----------------------------------------------------------
 
 void FileTransferChatMessageModifier::cancelFileTransfer () {
+	if (isDownloadInProgress()) {
+		lInfo() << "Canceling file download of msg [" << this << "]";
+		// It can be resumed by downloading the file again.
+		saveDownloadState();
+		releaseDownload();
+		return;
+	}
+
+	if (uploadReader) {
+		lInfo() << "Canceling chunked file upload of msg [" << this << "]";
+		// It is resumed if the message is sent again.
+		if (httpRequest && !belle_http_request_is_cancelled(httpRequest))
+			belle_http_provider_cancel_request(provider, httpRequest);
+		releaseHttpRequest();
+		releaseChunkedUpload();
+		fileUploadEndBackgroundTask();
+		shared_ptr<ChatMessage> message = chatMessage.lock();
+		if (message)
+			removeFileTransferContentToUpload(message);
+		return;
+	}
+
 	if (!httpRequest) {
 		lInfo() << "No existing file transfer - nothing to cancel";
 		return;
@@ -1023,7 +1734,7 @@ void FileTransferChatMessageModifier::cancelFileTransfer () {
 }
 
 bool FileTransferChatMessageModifier::isFileTransferInProgressAndValid () const {
-	return httpRequest && !belle_http_request_is_cancelled(httpRequest);
+	return (httpRequest && !belle_http_request_is_cancelled(httpRequest)) || uploadRetryTimer || isDownloadInProgress();
 }
 
 void FileTransferChatMessageModifier::releaseHttpRequest () {
@@ -1035,6 +1746,37 @@ void FileTransferChatMessageModifier::releaseHttpRequest () {
 			httpListener = nullptr;
 		}
 	}
+	releaseTransferBuffers();
+}
+
+// -----------------------------------------------------------------------------
+
+uint8_t *FileTransferChatMessageModifier::getCryptoBuffer (size_t size) {
+	if (cryptoBuffer.size() < size)
+		cryptoBuffer.resize(size);
+	return cryptoBuffer.data();
+}
+
+LinphoneBuffer *FileTransferChatMessageModifier::getRecvBuffer (const uint8_t *data, size_t size) {
+	if (recvBuffer && BELLE_SIP_OBJECT(recvBuffer)->ref > 1) {
+		// The application kept the previous chunk, leave it to it.
+		linphone_buffer_unref(recvBuffer);
+		recvBuffer = nullptr;
+	}
+	if (!recvBuffer)
+		recvBuffer = linphone_buffer_new();
+	linphone_buffer_set_content(recvBuffer, data, size);
+	return recvBuffer;
+}
+
+void FileTransferChatMessageModifier::releaseTransferBuffers () {
+	// The scratch buffer held clear data of the file.
+	fill(cryptoBuffer.begin(), cryptoBuffer.end(), 0);
+	vector<uint8_t>().swap(cryptoBuffer);
+	if (recvBuffer) {
+		linphone_buffer_unref(recvBuffer);
+		recvBuffer = nullptr;
+	}
 }
 
 string FileTransferChatMessageModifier::createFakeFileTransferFromUrl (const string &url) {
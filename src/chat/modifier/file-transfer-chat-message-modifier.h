@@ -20,13 +20,21 @@
 #ifndef _L_FILE_TRANSFER_CHAT_MESSAGE_MODIFIER_H_
 #define _L_FILE_TRANSFER_CHAT_MESSAGE_MODIFIER_H_
 
+#include <list>
+#include <memory>
+#include <vector>
+
+#include <bctoolbox/vfs.h>
 #include <belle-sip/belle-sip.h>
 
 #include "chat-message-modifier.h"
 #include "utils/background-task.h"
+#include "utils/file-chunk-reader.h"
 
 // =============================================================================
 
+L_DECL_C_STRUCT(LinphoneBuffer);
+
 LINPHONE_BEGIN_NAMESPACE
 
 class ChatRoom;
@@ -36,6 +44,31 @@ class FileTransferContent;
 
 class FileTransferChatMessageModifier : public ChatMessageModifier {
 public:
+	// A byte range of a downloaded file, or the whole file if the server does not support ranges.
+	struct DownloadSegment {
+		FileTransferChatMessageModifier *modifier = nullptr;
+		size_t start = 0;
+		// Exclusive, 0 while the size of the file is unknown.
+		size_t end = 0;
+		size_t received = 0;
+		int retries = 0;
+		// Identifies the request in flight, so that the callbacks of an older request are ignored.
+		uint64_t generation = 0;
+		bool started = false;
+		bool complete = false;
+		belle_http_request_t *request = nullptr;
+		belle_http_request_listener_t *listener = nullptr;
+		belle_sip_source_t *retryTimer = nullptr;
+	};
+
+	// Given to the callbacks of each download request. Removed after the last callback of the request (its response
+	// or an I/O error). The contexts of cancelled requests are kept as long as the modifier and their callbacks ignored.
+	struct DownloadRequestContext {
+		FileTransferChatMessageModifier *modifier;
+		size_t segmentIndex;
+		uint64_t generation;
+	};
+
 	FileTransferChatMessageModifier (belle_http_provider_t *prov);
 	~FileTransferChatMessageModifier ();
 
@@ -52,13 +85,19 @@ public:
 	void processResponseFromPostFile (const belle_http_response_event_t *event);
 	void processIoErrorUpload (const belle_sip_io_error_event_t *event);
 	void processAuthRequestedUpload (const belle_sip_auth_event *event);
-
-	void onRecvBody (belle_sip_user_body_handler_t *bh, belle_sip_message_t *m, size_t offset, uint8_t *buffer, size_t size);
-	void onRecvEnd (belle_sip_user_body_handler_t *bh);
-	void processResponseHeadersFromGetFile (const belle_http_response_event_t *event);
-	void processAuthRequestedDownload (const belle_sip_auth_event *event);
-	void processIoErrorDownload (const belle_sip_io_error_event_t *event);
-	void processResponseFromGetFile (const belle_http_response_event_t *event);
+	void uploadChunkOnProgress (belle_sip_body_handler_t *bh, belle_sip_message_t *m, size_t offset);
+	void processResponseFromUploadChunk (const belle_http_response_event_t *event);
+	void processIoErrorUploadChunk (const belle_sip_io_error_event_t *event);
+	void retryUploadChunk ();
+	void pollUploadChunk ();
+
+	void onRecvBody (const DownloadRequestContext *context, uint8_t *buffer, size_t size);
+	void onRecvEnd (const DownloadRequestContext *context);
+	void processResponseHeadersFromGetFile (const DownloadRequestContext *context, const belle_http_response_event_t *event);
+	void processAuthRequestedDownload (const DownloadRequestContext *context, const belle_sip_auth_event *event);
+	void processIoErrorDownload (const DownloadRequestContext *context, const belle_sip_io_error_event_t *event);
+	void processResponseFromGetFile (const DownloadRequestContext *context, const belle_http_response_event_t *event);
+	void retryDownloadSegment (DownloadSegment *segment);
 
 	bool downloadFile (const std::shared_ptr<ChatMessage> &message, FileTransferContent *fileTransferContent);
 	void cancelFileTransfer ();
@@ -69,13 +108,48 @@ private:
 	// Body handler is optional, but if set this method takes owneship of it, even in error cases.
 	int uploadFile (belle_sip_body_handler_t *bh);
 	// Body handler is optional, but if set this method takes owneship of it, even in error cases.
-	int startHttpTransfer (const std::string &url, const std::string &action, belle_sip_body_handler_t *bh, belle_http_request_listener_callbacks_t *cbs);
+	int startHttpTransfer (
+		const std::string &url,
+		const std::string &action,
+		belle_sip_body_handler_t *bh,
+		belle_http_request_listener_callbacks_t *cbs,
+		const std::list<std::pair<std::string, std::string>> &headers = {}
+	);
+	belle_http_request_t *createHttpRequest (const std::string &url, const std::string &action);
 	void fileUploadBeginBackgroundTask ();
 	void fileUploadEndBackgroundTask ();
 
+	void prepareChunkedUpload (const std::shared_ptr<ChatMessage> &message, std::list<std::pair<std::string, std::string>> &headers);
+	void startChunkedUpload (const std::shared_ptr<ChatMessage> &message, const belle_http_response_event_t *event);
+	void sendNextUploadChunk ();
+	void sendUploadChunk ();
+	void scheduleUploadChunkRetry ();
+	void onChunkedUploadFailed ();
+	void removeFileTransferContentToUpload (const std::shared_ptr<ChatMessage> &message);
+	void clearUploadState ();
+	void releaseChunkedUpload ();
+
 	void onDownloadFailed ();
 	void releaseHttpRequest ();
 
+	DownloadSegment *getDownloadSegment (const DownloadRequestContext *context) const;
+	void removeDownloadRequestContext (const DownloadRequestContext *context);
+	void planDownloadSegments (const std::shared_ptr<ChatMessage> &message);
+	int startDownloadSegment (size_t index);
+	void startPendingDownloadSegments ();
+	void scheduleDownloadSegmentRetry (DownloadSegment *segment);
+	void releaseDownloadSegment (DownloadSegment *segment, bool cancel);
+	void releaseDownload ();
+	bool isDownloadInProgress () const;
+	bool isDownloadComplete () const;
+	void finishDownload (const std::shared_ptr<ChatMessage> &message);
+	void saveDownloadState ();
+	void clearDownloadState ();
+
+	uint8_t *getCryptoBuffer (size_t size);
+	LinphoneBuffer *getRecvBuffer (const uint8_t *data, size_t size);
+	void releaseTransferBuffers ();
+
 	std::weak_ptr<ChatMessage> chatMessage;
 	FileContent* currentFileContentToTransfer = nullptr;
 
@@ -84,6 +158,35 @@ private:
 	belle_http_provider_t *provider  = nullptr;
 
 	BackgroundTask bgTask;
+
+	// Scratch buffer of the encryption engine, kept for the whole transfer.
+	std::vector<uint8_t> cryptoBuffer;
+	// Given to the receive callbacks, it is reused until the application keeps a reference to it.
+	LinphoneBuffer *recvBuffer = nullptr;
+
+	// Set while a file is uploaded in chunks, each one in its own request, within a session opened by the server.
+	std::unique_ptr<FileChunkReader> uploadReader;
+	// Kept until the server acknowledges it.
+	FileChunkReader::Chunk uploadChunk;
+	std::string uploadSessionId;
+	int uploadRetries = 0;
+	belle_sip_source_t *uploadRetryTimer = nullptr;
+	// Set while the next chunk is not read from the disk yet.
+	belle_sip_source_t *uploadPollTimer = nullptr;
+
+	std::vector<std::unique_ptr<DownloadSegment>> downloadSegments;
+	std::list<DownloadRequestContext> downloadRequestContexts;
+	uint64_t lastDownloadRequestGeneration = 0;
+	std::string downloadUrl;
+	// Written directly at the offset of each segment, nullptr when the file is given to the application callbacks.
+	bctbx_vfs_file_t *downloadedFile = nullptr;
+	// 0 while unknown.
+	size_t downloadFileSize = 0;
+	size_t downloadedSize = 0;
+	size_t downloadSavedSize = 0;
+	// The segments can be fetched in any order and resumed by another instance of the core. Not the case of
+	// encrypted files, they are decrypted as a stream, nor of the files given to the application callbacks.
+	bool downloadResumable = false;
 };
 
 LINPHONE_END_NAMESPACE
@@ -20,6 +20,8 @@
 #ifndef _L_MEDIA_SESSION_P_H_
 #define _L_MEDIA_SESSION_P_H_
 
+#include <atomic>
+
 #include "call-session-p.h"
 
 #include "media-session.h"
@@ -33,6 +35,8 @@
 
 LINPHONE_BEGIN_NAMESPACE
 
+class CallStatsSnapshotTable;
+
 class MediaSessionPrivate : public CallSessionPrivate {
 public:
 	static int resumeAfterFailedTransfer (void *userData, unsigned int);
@@ -139,6 +143,8 @@ private:
 
 	void initStats (LinphoneCallStats *stats, LinphoneStreamType type);
 	void notifyStatsUpdated (int streamIndex);
+	void publishStatsSnapshot (LinphoneCallStats *stats);
+	void releaseStatsSnapshots ();
 
 	OrtpEvQueue *getEventQueue (int streamIndex) const;
 	MediaStream *getMediaStream (int streamIndex) const;
@@ -155,6 +161,8 @@ private:
 	void getLocalIp (const Address &remoteAddr);
 	std::string getPublicIpForStream (int streamIndex);
 	void runStunTestsIfNeeded ();
+	bool isStunDiscoveryPending () const;
+	void stunDiscoveryFinished (int ret);
 	void selectIncomingIpVersion ();
 	void selectOutgoingIpVersion ();
 
@@ -295,6 +303,13 @@ private:
 	RtpProfile *textProfile = nullptr;
 	int mainTextStreamIndex = LINPHONE_CALL_STATS_TEXT;
 
+	// Slots of the core table where the stats of the audio, video and text streams are published, -1 if none, and the
+	// generations they were acquired with. Both are read by the monitoring threads, see MediaSession::getStatsSnapshot().
+	std::shared_ptr<CallStatsSnapshotTable> statsSnapshotTable;
+	std::atomic<int> statsSnapshotSlots[3];
+	std::atomic<uint64_t> statsSnapshotGenerations[3];
+	unsigned int statsSnapshotUpdates[3] = { 0, 0, 0 };
+
 	LinphoneNatPolicy *natPolicy = nullptr;
 	std::unique_ptr<StunClient> stunClient;
 	std::unique_ptr<IceAgent> iceAgent;
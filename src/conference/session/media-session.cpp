@@ -22,6 +22,7 @@
 
 #include "address/address-p.h"
 #include "call/call-p.h"
+#include "call/call-stats-snapshot-table.h"
 #include "chat/chat-room/client-group-chat-room.h"
 #include "conference/params/media-session-params-p.h"
 #include "conference/participant-p.h"
@@ -661,6 +662,7 @@ void MediaSessionPrivate::stopStreams () {
 		if (q->getCore()->getCCore()->msevq)
 			ms_event_queue_skip(q->getCore()->getCCore()->msevq);
 	}
+	releaseStatsSnapshots();
 
 	if (audioProfile) {
 		rtp_profile_destroy(audioProfile);
@@ -1047,10 +1049,75 @@ void MediaSessionPrivate::notifyStatsUpdated (int streamIndex) {
 		}
 		if (listener)
 			listener->onStatsUpdated(q->getSharedFromThis(), stats);
+		publishStatsSnapshot(stats);
 		_linphone_call_stats_set_updated(stats, 0);
 	}
 }
 
+void MediaSessionPrivate::publishStatsSnapshot (LinphoneCallStats *stats) {
+	L_Q();
+	int type = static_cast<int>(linphone_call_stats_get_type(stats));
+	if ((type < LinphoneStreamTypeAudio) || (type > LinphoneStreamTypeText))
+		return;
+	if (!statsSnapshotTable) {
+		statsSnapshotTable = q->getCore()->getPrivate()->callStatsSnapshots;
+		if (!statsSnapshotTable)
+			return;
+	}
+	int slot = statsSnapshotSlots[type].load(memory_order_relaxed);
+	if (slot < 0) {
+		uint64_t generation;
+		slot = statsSnapshotTable->acquire(generation);
+		if (slot < 0) {
+			if (statsSnapshotUpdates[type]++ == 0)
+				lWarning() << "No room left to publish the stats of the " << linphone_stream_type_to_string(static_cast<LinphoneStreamType>(type))
+					<< " stream of MediaSession [" << q << "], increase [misc] call_stats_snapshot_capacity";
+			return;
+		}
+		// The generation is stored first, a reader that sees the new slot sees its generation too.
+		statsSnapshotGenerations[type].store(generation, memory_order_relaxed);
+		statsSnapshotSlots[type].store(slot, memory_order_release);
+	}
+
+	LinphoneCallStatsSnapshot snapshot;
+	memset(&snapshot, 0, sizeof(snapshot));
+	if (op)
+		strncpy(snapshot.call_id, op->getCallId().c_str(), sizeof(snapshot.call_id) - 1);
+	snapshot.type = static_cast<LinphoneStreamType>(type);
+	snapshot.update_count = ++statsSnapshotUpdates[type];
+	snapshot.update_time = ms_get_cur_time_ms();
+	snapshot.download_bandwidth = linphone_call_stats_get_download_bandwidth(stats);
+	snapshot.upload_bandwidth = linphone_call_stats_get_upload_bandwidth(stats);
+	snapshot.rtcp_download_bandwidth = linphone_call_stats_get_rtcp_download_bandwidth(stats);
+	snapshot.rtcp_upload_bandwidth = linphone_call_stats_get_rtcp_upload_bandwidth(stats);
+	snapshot.estimated_download_bandwidth = linphone_call_stats_get_estimated_download_bandwidth(stats);
+	snapshot.round_trip_delay = linphone_call_stats_get_round_trip_delay(stats);
+	snapshot.sender_loss_rate = linphone_call_stats_get_sender_loss_rate(stats);
+	snapshot.receiver_loss_rate = linphone_call_stats_get_receiver_loss_rate(stats);
+	snapshot.local_loss_rate = linphone_call_stats_get_local_loss_rate(stats);
+	snapshot.local_late_rate = linphone_call_stats_get_local_late_rate(stats);
+	snapshot.sender_interarrival_jitter = linphone_call_stats_get_sender_interarrival_jitter(stats);
+	snapshot.receiver_interarrival_jitter = linphone_call_stats_get_receiver_interarrival_jitter(stats);
+	snapshot.jitter_buffer_size_ms = linphone_call_stats_get_jitter_buffer_size_ms(stats);
+	const rtp_stats_t *rtpStats = linphone_call_stats_get_rtp_stats(stats);
+	if (rtpStats) {
+		snapshot.packet_sent = rtpStats->packet_sent;
+		snapshot.packet_recv = rtpStats->packet_recv;
+		snapshot.cum_packet_loss = rtpStats->cum_packet_loss;
+	}
+	snapshot.ice_state = linphone_call_stats_get_ice_state(stats);
+	statsSnapshotTable->publish(slot, statsSnapshotGenerations[type].load(memory_order_relaxed), snapshot);
+}
+
+void MediaSessionPrivate::releaseStatsSnapshots () {
+	for (int type = LinphoneStreamTypeAudio; type <= LinphoneStreamTypeText; type++) {
+		int slot = statsSnapshotSlots[type].exchange(-1);
+		if ((slot >= 0) && statsSnapshotTable)
+			statsSnapshotTable->release(slot);
+		statsSnapshotUpdates[type] = 0;
+	}
+}
+
 // -----------------------------------------------------------------------------
 
 OrtpEvQueue * MediaSessionPrivate::getEventQueue (int streamIndex) const {
@@ -1278,9 +1345,41 @@ void MediaSessionPrivate::runStunTestsIfNeeded () {
 	L_Q();
 	if (linphone_nat_policy_stun_enabled(natPolicy) && !(linphone_nat_policy_ice_enabled(natPolicy) || linphone_nat_policy_turn_enabled(natPolicy))) {
 		stunClient = makeUnique<StunClient>(q->getCore());
-		int ret = stunClient->run(mediaPorts[mainAudioStreamIndex].rtpPort, mediaPorts[mainVideoStreamIndex].rtpPort, mediaPorts[mainTextStreamIndex].rtpPort);
-		if (ret >= 0)
-			pingTime = ret;
+		/* The discovery runs from the core main loop, the INVITE or the incoming call notification is deferred until it completes */
+		stunClient->runAsync(
+			mediaPorts[mainAudioStreamIndex].rtpPort,
+			mediaPorts[mainVideoStreamIndex].rtpPort,
+			mediaPorts[mainTextStreamIndex].rtpPort,
+			[this](int ret) { stunDiscoveryFinished(ret); }
+		);
+	}
+}
+
+bool MediaSessionPrivate::isStunDiscoveryPending () const {
+	return stunClient && stunClient->isRunning();
+}
+
+void MediaSessionPrivate::stunDiscoveryFinished (int ret) {
+	L_Q();
+	if (ret >= 0)
+		pingTime = ret;
+	/* The local description was built before the discovery completed, refresh it with the discovered addresses */
+	if (localDesc)
+		stunClient->updateMediaDescription(localDesc);
+	switch (state) {
+		case CallSession::State::OutgoingInit:
+			if (isReadyForInvite())
+				q->startInvite(nullptr, "");
+			break;
+		case CallSession::State::Idle:
+			if (deferIncomingNotification) {
+				op->setLocalMediaDescription(localDesc);
+				deferIncomingNotification = false;
+				startIncomingNotification();
+			}
+			break;
+		default:
+			break;
 	}
 }
 
@@ -3661,6 +3760,8 @@ void MediaSessionPrivate::reportBandwidthForStream (MediaStream *ms, LinphoneStr
 	_linphone_call_stats_set_rtcp_upload_bandwidth(stats, active ? (float)(media_stream_get_rtcp_up_bw(ms) * 1e-3) : 0.f);
 	_linphone_call_stats_set_ip_family_of_remote(stats,
 		active ? (ortp_stream_is_ipv6(&ms->sessions.rtp_session->rtp.gs) ? LinphoneAddressFamilyInet6 : LinphoneAddressFamilyInet) : LinphoneAddressFamilyUnspec);
+	if (active)
+		publishStatsSnapshot(stats);
 
 	if (q->getCore()->getCCore()->send_call_stats_periodical_updates) {
 		if (active)
@@ -3704,7 +3805,7 @@ bool MediaSessionPrivate::isReadyForInvite () const {
 			iceReady = true;
 	} else
 		iceReady = true;
-	return callSessionReady && iceReady;
+	return callSessionReady && iceReady && !isStunDiscoveryPending();
 }
 
 LinphoneStatus MediaSessionPrivate::pause () {
@@ -4126,6 +4227,10 @@ MediaSession::MediaSession (const shared_ptr<Core> &core, shared_ptr<Participant
 	d->initStats(d->videoStats, LinphoneStreamTypeVideo);
 	d->textStats = _linphone_call_stats_new();
 	d->initStats(d->textStats, LinphoneStreamTypeText);
+	for (auto &slot : d->statsSnapshotSlots)
+		slot.store(-1);
+	for (auto &generation : d->statsSnapshotGenerations)
+		generation.store(0);
 
 	int minPort, maxPort;
 	linphone_core_get_audio_port_range(getCore()->getCCore(), &minPort, &maxPort);
@@ -4152,6 +4257,7 @@ MediaSession::~MediaSession () {
 		linphone_call_stats_unref(d->videoStats);
 	if (d->textStats)
 		linphone_call_stats_unref(d->textStats);
+	d->releaseStatsSnapshots();
 	if (d->natPolicy)
 		linphone_nat_policy_unref(d->natPolicy);
 	if (d->localDesc)
@@ -4294,6 +4400,8 @@ void MediaSession::initiateIncoming () {
 	if (d->natPolicy) {
 		if (linphone_nat_policy_ice_enabled(d->natPolicy))
 			d->deferIncomingNotification = d->iceAgent->prepare(d->localDesc, true);
+		else if (d->isStunDiscoveryPending())
+			d->deferIncomingNotification = true;
 	}
 }
 
@@ -4309,6 +4417,8 @@ bool MediaSession::initiateOutgoing () {
 			defer |= d->iceAgent->prepare(d->localDesc, false);
 		}
 	}
+	/* Defer the start of the call after the STUN discovery */
+	defer |= d->isStunDiscoveryPending();
 	return defer;
 }
 
@@ -4863,6 +4973,17 @@ float MediaSession::getSpeakerVolumeGain () const {
 	}
 }
 
+bool MediaSession::getStatsSnapshot (LinphoneStreamType type, LinphoneCallStatsSnapshot &snapshot) const {
+	L_D();
+	if ((type < LinphoneStreamTypeAudio) || (type > LinphoneStreamTypeText))
+		return false;
+	int slot = d->statsSnapshotSlots[type].load(memory_order_acquire);
+	uint64_t generation = d->statsSnapshotGenerations[type].load(memory_order_relaxed);
+	// The table is set before the first slot is acquired and never changes afterwards. If the slot has been released
+	// meanwhile, possibly to be reused by another call, its generation no longer matches.
+	return (slot >= 0) && d->statsSnapshotTable->read(slot, generation, snapshot);
+}
+
 LinphoneCallStats * MediaSession::getStats (LinphoneStreamType type) const {
 	L_D();
 	if (type == LinphoneStreamTypeUnknown)
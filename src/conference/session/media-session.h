@@ -23,6 +23,8 @@
 #include "call-session.h"
 #include "conference/params/media-session-params.h"
 
+#include "linphone/api/c-call-stats.h"
+
 // =============================================================================
 
 LINPHONE_BEGIN_NAMESPACE
@@ -94,6 +96,7 @@ public:
 	const MediaSessionParams *getRemoteParams ();
 	float getSpeakerVolumeGain () const;
 	LinphoneCallStats * getStats (LinphoneStreamType type) const;
+	bool getStatsSnapshot (LinphoneStreamType type, LinphoneCallStatsSnapshot &snapshot) const;
 	int getStreamCount () const;
 	MSFormatType getStreamType (int streamIndex) const;
 	LinphoneCallStats * getTextStats () const;
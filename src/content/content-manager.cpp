@@ -88,4 +88,11 @@ Content ContentManager::contentListToMultipart (const list<Content *> &contents,
 	return content;
 }
 
+string ContentManager::getMultipartBoundary (const ContentType &contentType) {
+	string boundary = contentType.getParameter("boundary").getValue();
+	if (boundary.size() >= 2 && boundary.front() == '"' && boundary.back() == '"')
+		boundary = boundary.substr(1, boundary.size() - 2);
+	return boundary.empty() ? string(MultipartBoundary) : boundary;
+}
+
 LINPHONE_END_NAMESPACE
@@ -21,6 +21,7 @@
 #define _L_CONTENT_MANAGER_H_
 
 #include <list>
+#include <string>
 
 #include "linphone/utils/general.h"
 
@@ -29,6 +30,7 @@
 LINPHONE_BEGIN_NAMESPACE
 
 class Content;
+class ContentType;
 
 namespace {
 	constexpr const char MultipartBoundary[] = "---------------------------14737809831466499882746641449";
@@ -37,6 +39,8 @@ namespace {
 namespace ContentManager {
 	LINPHONE_PUBLIC std::list<Content> multipartToContentList (const Content &content);
 	LINPHONE_PUBLIC Content contentListToMultipart (const std::list<Content *> &contents, const std::string &boundary = MultipartBoundary, bool encrypted = false);
+	// The boundary parameter of a multipart content type, unquoted, or the default one if there is none.
+	LINPHONE_PUBLIC std::string getMultipartBoundary (const ContentType &contentType);
 }
 
 LINPHONE_END_NAMESPACE
@@ -33,7 +33,7 @@ class Header;
 
 class ContentPrivate : public ClonableObjectPrivate {
 private:
-	std::vector<char> body;
+	SharedBuffer body;
 	ContentType contentType;
 	ContentDisposition contentDisposition;
 	std::string contentEncoding;
@@ -53,14 +53,8 @@ Content::Content (Content &&other) : ClonableObject(*new ContentPrivate), AppDat
 
 Content::Content (ContentPrivate &p) : ClonableObject(p) {}
 
-Content::~Content () {
-	L_D();
-	/*
-	 * Fills the body with zeros before releasing since it may contain
-	 * private data like cipher keys or decoded messages.
-	 */
-	d->body.assign(d->body.size(), 0);
-}
+// The body is zeroed by its buffer when the last content sharing it is released.
+Content::~Content () {}
 
 Content &Content::operator= (const Content &other) {
 	if (this != &other) {
@@ -85,7 +79,7 @@ Content &Content::operator= (Content &&other) {
 bool Content::operator== (const Content &other) const {
 	L_D();
 	return d->contentType == other.getContentType() &&
-		d->body == other.getBody() &&
+		d->body == other.getBodyBuffer() &&
 		d->contentDisposition == other.getContentDisposition() &&
 		d->contentEncoding == other.getContentEncoding() &&
 		d->headers == other.getHeaders();
@@ -93,7 +87,7 @@ bool Content::operator== (const Content &other) const {
 
 void Content::copy(const Content &other) {
 	L_D();
-	d->body = other.getBody();
+	d->body = other.getBodyBuffer();
 	d->contentType = other.getContentType();
 	d->contentDisposition = other.getContentDisposition();
 	d->contentEncoding = other.getContentEncoding();
@@ -132,44 +126,53 @@ void Content::setContentEncoding (const string &contentEncoding) {
 
 const vector<char> &Content::getBody () const {
 	L_D();
-	return d->body;
+	return d->body.asVector();
 }
 
 string Content::getBodyAsString () const {
 	L_D();
-	return Utils::utf8ToLocale(string(d->body.begin(), d->body.end()));
+	return Utils::utf8ToLocale(d->body.asString());
 }
 
 string Content::getBodyAsUtf8String () const {
 	L_D();
-	return string(d->body.begin(), d->body.end());
+	return d->body.asString();
 }
 
-void Content::setBody (const vector<char> &body) {
+const SharedBuffer &Content::getBodyBuffer () const {
+	L_D();
+	return d->body;
+}
+
+void Content::setBody (const SharedBuffer &body) {
 	L_D();
 	d->body = body;
 }
 
+void Content::setBody (const vector<char> &body) {
+	L_D();
+	d->body = SharedBuffer(body.data(), body.size());
+}
+
 void Content::setBody (vector<char> &&body) {
 	L_D();
-	d->body = move(body);
+	d->body = SharedBuffer(move(body));
 }
 
 void Content::setBody (const string &body) {
 	L_D();
 	string toUtf8 = Utils::localeToUtf8(body);
-	d->body = vector<char>(toUtf8.cbegin(), toUtf8.cend());
+	d->body = SharedBuffer(toUtf8.data(), toUtf8.size());
 }
 
 void Content::setBody (const void *buffer, size_t size) {
 	L_D();
-	const char *start = static_cast<const char *>(buffer);
-	d->body = vector<char>(start, start + size);
+	d->body = SharedBuffer(buffer, size);
 }
 
 void Content::setBodyFromUtf8 (const string &body) {
 	L_D();
-	d->body = vector<char>(body.cbegin(), body.cend());
+	d->body = SharedBuffer(body.data(), body.size());
 }
 
 size_t Content::getSize () const {
@@ -25,6 +25,7 @@
 
 #include "object/app-data-container.h"
 #include "object/clonable-object.h"
+#include "shared-buffer.h"
 
 // =============================================================================
 
@@ -68,6 +69,10 @@ public:
 	std::string getBodyAsString () const;
 	std::string getBodyAsUtf8String () const;
 
+	// The body is shared with the copies of this content, the setters replace it without touching the copies.
+	const SharedBuffer &getBodyBuffer () const;
+	void setBody (const SharedBuffer &body);
+
 	void setBody (const std::vector<char> &body);
 	void setBody (std::vector<char> &&body);
 	void setBody (const std::string &body);
@@ -0,0 +1,207 @@
+/*
+ * multipart-reader.cpp
+ * Copyright (C) 2010-2018 Belledonne Communications SARL
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <cstring>
+
+#include "content-type.h"
+
+#include "multipart-reader.h"
+
+// =============================================================================
+
+using namespace std;
+
+LINPHONE_BEGIN_NAMESPACE
+
+namespace {
+	inline char toLowerAscii (char c) {
+		return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c;
+	}
+
+	bool equalsIgnoreCase (const char *a, const char *b, size_t size) {
+		for (size_t i = 0; i < size; i++) {
+			if (toLowerAscii(a[i]) != toLowerAscii(b[i]))
+				return false;
+		}
+		return true;
+	}
+
+	inline bool isBlank (char c) {
+		return c == ' ' || c == '\t';
+	}
+
+	void trim (const char *&value, size_t &size) {
+		while (size > 0 && isBlank(*value)) {
+			value++;
+			size--;
+		}
+		while (size > 0 && isBlank(value[size - 1]))
+			size--;
+	}
+
+	// End of the line starting at from, before its CRLF or LF.
+	const char *findLineEnd (const char *from, const char *end, const char *&next) {
+		const char *lf = static_cast<const char *>(memchr(from, '\n', size_t(end - from)));
+		if (!lf) {
+			next = end;
+			return end;
+		}
+		next = lf + 1;
+		return (lf > from && lf[-1] == '\r') ? lf - 1 : lf;
+	}
+}
+
+// -----------------------------------------------------------------------------
+
+bool MultipartReader::Part::getHeaderValue (const string &name, const char *&value, size_t &size) const {
+	const char *headersEnd = headers + headersSize;
+	const char *next;
+	for (const char *line = headers; line < headersEnd; line = next) {
+		const char *lineEnd = findLineEnd(line, headersEnd, next);
+		size_t lineSize = size_t(lineEnd - line);
+		if (
+			lineSize > name.size() &&
+			line[name.size()] == ':' &&
+			equalsIgnoreCase(line, name.c_str(), name.size())
+		) {
+			value = line + name.size() + 1;
+			size = lineSize - name.size() - 1;
+			trim(value, size);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool MultipartReader::Part::hasHeaderValue (const string &name, const string &value) const {
+	const char *headerValue;
+	size_t size;
+	return getHeaderValue(name, headerValue, size) &&
+		size == value.size() &&
+		memcmp(headerValue, value.c_str(), size) == 0;
+}
+
+bool MultipartReader::Part::hasContentType (const ContentType &contentType) const {
+	const char *value;
+	size_t size;
+	if (!getHeaderValue("Content-Type", value, size))
+		return false;
+
+	const char *parameters = static_cast<const char *>(memchr(value, ';', size));
+	if (parameters) {
+		size = size_t(parameters - value);
+		trim(value, size);
+	}
+
+	const string &type = contentType.getType();
+	const string &subType = contentType.getSubType();
+	return size == type.size() + 1 + subType.size() &&
+		value[type.size()] == '/' &&
+		equalsIgnoreCase(value, type.c_str(), type.size()) &&
+		equalsIgnoreCase(value + type.size() + 1, subType.c_str(), subType.size());
+}
+
+// -----------------------------------------------------------------------------
+
+MultipartReader::MultipartReader (const char *data, size_t size, const string &boundary) :
+	position(data), end(data + size), dashBoundary("--" + boundary) {
+	// Anything before the first delimiter is a preamble to ignore.
+	position = findDelimiter(data);
+	if (!position) {
+		ended = true;
+		malformed = true;
+	}
+}
+
+bool MultipartReader::next (Part &part) {
+	if (ended)
+		return false;
+
+	const char *cursor = position + dashBoundary.size();
+	if (size_t(end - cursor) >= 2 && cursor[0] == '-' && cursor[1] == '-') {
+		ended = true;
+		return false;
+	}
+
+	// Skip the transport padding and the end of the delimiter line.
+	const char *next;
+	const char *lineEnd = findLineEnd(cursor, end, next);
+	for (; cursor < lineEnd && isBlank(*cursor); cursor++);
+	if (cursor != lineEnd || next == end) {
+		ended = true;
+		malformed = true;
+		return false;
+	}
+
+	// Headers go up to the first empty line.
+	const char *headers = next;
+	const char *headersEnd = nullptr;
+	for (const char *line = headers; line < end; line = next) {
+		lineEnd = findLineEnd(line, end, next);
+		if (lineEnd == line) {
+			headersEnd = line;
+			break;
+		}
+	}
+	if (!headersEnd) {
+		ended = true;
+		malformed = true;
+		return false;
+	}
+
+	const char *body = next;
+	const char *delimiter = findDelimiter(body);
+	if (!delimiter) {
+		ended = true;
+		malformed = true;
+		return false;
+	}
+
+	// The line break before the delimiter belongs to it.
+	const char *bodyEnd = delimiter;
+	if (bodyEnd > body && bodyEnd[-1] == '\n')
+		bodyEnd--;
+	if (bodyEnd > body && bodyEnd[-1] == '\r')
+		bodyEnd--;
+
+	part.headers = headers;
+	part.headersSize = size_t(headersEnd - headers);
+	part.body = body;
+	part.bodySize = size_t(bodyEnd - body);
+	position = delimiter;
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+
+const char *MultipartReader::findDelimiter (const char *from) const {
+	// Every line is looked at from its start, from being the start of one.
+	for (const char *cursor = from; size_t(end - cursor) >= dashBoundary.size();) {
+		if (memcmp(cursor, dashBoundary.c_str(), dashBoundary.size()) == 0)
+			return cursor;
+
+		const char *lf = static_cast<const char *>(memchr(cursor, '\n', size_t(end - cursor)));
+		if (!lf)
+			return nullptr;
+		cursor = lf + 1;
+	}
+	return nullptr;
+}
+
+LINPHONE_END_NAMESPACE
@@ -0,0 +1,92 @@
+/*
+ * multipart-reader.h
+ * Copyright (C) 2010-2018 Belledonne Communications SARL
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _L_MULTIPART_READER_H_
+#define _L_MULTIPART_READER_H_
+
+#include <string>
+
+#include "content-manager.h"
+
+// =============================================================================
+
+LINPHONE_BEGIN_NAMESPACE
+
+class ContentType;
+
+/*
+ * Walks the parts of a multipart body in place, without copying them. Only the headers of a part that are asked
+ * for are looked at. The multipart buffer must outlive the reader and its parts.
+ */
+class LINPHONE_PUBLIC MultipartReader {
+public:
+	class Part {
+	public:
+		const char *getBody () const {
+			return body;
+		}
+
+		size_t getBodySize () const {
+			return bodySize;
+		}
+
+		std::string getBodyAsString () const {
+			return std::string(body, bodySize);
+		}
+
+		// Value of the header without surrounding whitespace, false if the part does not have it.
+		bool getHeaderValue (const std::string &name, const char *&value, size_t &size) const;
+		bool hasHeaderValue (const std::string &name, const std::string &value) const;
+		// Only the type and subtype are compared, the parameters are ignored.
+		bool hasContentType (const ContentType &contentType) const;
+
+	private:
+		const char *headers = nullptr;
+		size_t headersSize = 0;
+		const char *body = nullptr;
+		size_t bodySize = 0;
+
+		friend class MultipartReader;
+	};
+
+	MultipartReader (const char *data, size_t size, const std::string &boundary = MultipartBoundary);
+
+	// Moves to the next part, false once the closing delimiter is reached or if the multipart is malformed.
+	bool next (Part &part);
+
+	bool isMalformed () const {
+		return malformed;
+	}
+
+private:
+	// Position of the next "--boundary" starting a line, or nullptr.
+	const char *findDelimiter (const char *from) const;
+
+	const char *position;
+	const char *end;
+	std::string dashBoundary;
+	bool ended = false;
+	bool malformed = false;
+
+	L_DISABLE_COPY(MultipartReader);
+};
+
+LINPHONE_END_NAMESPACE
+
+#endif // ifndef _L_MULTIPART_READER_H_
@@ -0,0 +1,118 @@
+/*
+ * multipart-writer.cpp
+ * Copyright (C) 2010-2018 Belledonne Communications SARL
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "linphone/utils/utils.h"
+
+#include "utils/base64.h"
+
+#include "multipart-writer.h"
+
+// =============================================================================
+
+using namespace std;
+
+LINPHONE_BEGIN_NAMESPACE
+
+namespace {
+	constexpr const char ContentTypeHeader[] = "Content-Type: ";
+	constexpr const char ContentLengthHeader[] = "Content-Length: ";
+	constexpr const char Crlf[] = "\r\n";
+
+	// Number of digits of the body size.
+	size_t getSizeLength (size_t size) {
+		size_t digits = 1;
+		for (; size >= 10; size /= 10)
+			digits++;
+		return digits;
+	}
+}
+
+MultipartWriter::MultipartWriter (const string &boundary) : boundary(boundary) {}
+
+size_t MultipartWriter::getPartOverhead (const string &contentType, size_t bodySize) const {
+	// Delimiter, then the headers written with the body and the empty line.
+	return 2 + boundary.size() + 2 + 2 +
+		sizeof(ContentTypeHeader) - 1 + contentType.size() + 2 +
+		sizeof(ContentLengthHeader) - 1 + getSizeLength(bodySize) + 2 +
+		2;
+}
+
+void MultipartWriter::reserve (size_t size) {
+	// The closing delimiter is added to the room asked for the parts.
+	buffer.reserve(buffer.size() + size + 2 + 2 + boundary.size() + 2 + 2);
+}
+
+void MultipartWriter::beginPart () {
+	append(partStarted ? "\r\n--" : "--", partStarted ? 4 : 2);
+	append(boundary);
+	append(Crlf, 2);
+	partStarted = true;
+}
+
+void MultipartWriter::addHeader (const string &name, const string &value) {
+	append(name);
+	append(": ", 2);
+	append(value);
+	append(Crlf, 2);
+}
+
+void MultipartWriter::writeBody (const string &contentType, const char *body, size_t size) {
+	writeBodyHeaders(contentType, size);
+	append(body, size);
+}
+
+void MultipartWriter::writeBase64Body (const string &contentType, const uint8_t *data, size_t size) {
+	size_t encodedSize = Base64::getEncodedSize(size);
+	writeBodyHeaders(contentType, encodedSize);
+	size_t offset = buffer.size();
+	buffer.resize(offset + encodedSize);
+	Base64::encode(data, size, buffer.data() + offset);
+}
+
+vector<char> MultipartWriter::finish () {
+	append("\r\n--", 4);
+	append(boundary);
+	append("--\r\n", 4);
+	partStarted = false;
+
+	vector<char> result;
+	result.swap(buffer);
+	return result;
+}
+
+// -----------------------------------------------------------------------------
+
+void MultipartWriter::append (const char *data, size_t size) {
+	buffer.insert(buffer.end(), data, data + size);
+}
+
+void MultipartWriter::append (const string &data) {
+	append(data.data(), data.size());
+}
+
+void MultipartWriter::writeBodyHeaders (const string &contentType, size_t size) {
+	append(ContentTypeHeader, sizeof(ContentTypeHeader) - 1);
+	append(contentType);
+	append(Crlf, 2);
+	append(ContentLengthHeader, sizeof(ContentLengthHeader) - 1);
+	append(Utils::toString(static_cast<unsigned long long>(size)));
+	append("\r\n\r\n", 4);
+}
+
+LINPHONE_END_NAMESPACE
@@ -0,0 +1,68 @@
+/*
+ * multipart-writer.h
+ * Copyright (C) 2010-2018 Belledonne Communications SARL
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _L_MULTIPART_WRITER_H_
+#define _L_MULTIPART_WRITER_H_
+
+#include <string>
+#include <vector>
+
+#include "content-manager.h"
+
+// =============================================================================
+
+LINPHONE_BEGIN_NAMESPACE
+
+/*
+ * Writes a multipart body part after part into a single buffer, in the same layout as
+ * ContentManager::contentListToMultipart. Each part is made of:
+ *   beginPart(), addHeader() for each additional header, then writeBody() or writeBase64Body().
+ * The Content-Type and Content-Length headers are written with the body.
+ */
+class LINPHONE_PUBLIC MultipartWriter {
+public:
+	explicit MultipartWriter (const std::string &boundary = MultipartBoundary);
+
+	// Room taken by a part besides its additional headers and its body, for the content type and body size given.
+	size_t getPartOverhead (const std::string &contentType, size_t bodySize) const;
+	void reserve (size_t size);
+
+	void beginPart ();
+	void addHeader (const std::string &name, const std::string &value);
+	void writeBody (const std::string &contentType, const char *body, size_t size);
+	void writeBase64Body (const std::string &contentType, const uint8_t *data, size_t size);
+
+	// Closes the multipart and gives its bytes away, the writer can then be reused.
+	std::vector<char> finish ();
+
+private:
+	void append (const char *data, size_t size);
+	void append (const std::string &data);
+	void writeBodyHeaders (const std::string &contentType, size_t size);
+
+	std::string boundary;
+	std::vector<char> buffer;
+	bool partStarted = false;
+
+	L_DISABLE_COPY(MultipartWriter);
+};
+
+LINPHONE_END_NAMESPACE
+
+#endif // ifndef _L_MULTIPART_WRITER_H_
@@ -0,0 +1,146 @@
+/*
+ * shared-buffer.cpp
+ * Copyright (C) 2010-2018 Belledonne Communications SARL
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <cstring>
+
+#include "linphone/utils/utils.h"
+
+#include "shared-buffer.h"
+
+// =============================================================================
+
+using namespace std;
+
+LINPHONE_BEGIN_NAMESPACE
+
+struct SharedBuffer::Storage {
+	explicit Storage (vector<char> &&bytes) : bytes(move(bytes)) {}
+
+	~Storage () {
+		bytes.assign(bytes.size(), 0);
+	}
+
+	vector<char> bytes;
+};
+
+// -----------------------------------------------------------------------------
+
+SharedBuffer::SharedBuffer (vector<char> &&bytes) : mSize(bytes.size()) {
+	if (mSize > 0)
+		mStorage = make_shared<const Storage>(move(bytes));
+}
+
+SharedBuffer::SharedBuffer (const void *bytes, size_t size) : mSize(size) {
+	if (mSize > 0) {
+		const char *start = static_cast<const char *>(bytes);
+		mStorage = make_shared<const Storage>(vector<char>(start, start + size));
+	}
+}
+
+SharedBuffer::SharedBuffer (const SharedBuffer &other) :
+	mStorage(other.mStorage), mOffset(other.mOffset), mSize(other.mSize), mVectorStorage(atomic_load(&other.mVectorStorage)) {}
+
+SharedBuffer::SharedBuffer (SharedBuffer &&other) :
+	mStorage(move(other.mStorage)), mOffset(other.mOffset), mSize(other.mSize), mVectorStorage(move(other.mVectorStorage)) {
+	other.mOffset = 0;
+	other.mSize = 0;
+}
+
+SharedBuffer &SharedBuffer::operator= (const SharedBuffer &other) {
+	if (this != &other) {
+		mStorage = other.mStorage;
+		mOffset = other.mOffset;
+		mSize = other.mSize;
+		mVectorStorage = atomic_load(&other.mVectorStorage);
+	}
+	return *this;
+}
+
+SharedBuffer &SharedBuffer::operator= (SharedBuffer &&other) {
+	if (this != &other) {
+		mStorage = move(other.mStorage);
+		mOffset = other.mOffset;
+		mSize = other.mSize;
+		mVectorStorage = move(other.mVectorStorage);
+		other.mOffset = 0;
+		other.mSize = 0;
+	}
+	return *this;
+}
+
+// -----------------------------------------------------------------------------
+
+const char *SharedBuffer::data () const {
+	return mStorage ? mStorage->bytes.data() + mOffset : nullptr;
+}
+
+SharedBuffer SharedBuffer::slice (size_t offset, size_t size) const {
+	SharedBuffer buffer;
+	if (offset >= mSize)
+		return buffer;
+
+	buffer.mSize = min(size, mSize - offset);
+	if (buffer.mSize > 0) {
+		buffer.mStorage = mStorage;
+		buffer.mOffset = mOffset + offset;
+	}
+	return buffer;
+}
+
+const vector<char> &SharedBuffer::asVector () const {
+	if (!mStorage)
+		return Utils::getEmptyConstRefObject<vector<char>>();
+
+	if (mOffset == 0 && mSize == mStorage->bytes.size())
+		return mStorage->bytes;
+
+	// Concurrent callers may both copy the slice, only the first copy is kept.
+	shared_ptr<const Storage> storage = atomic_load(&mVectorStorage);
+	if (!storage) {
+		const char *start = data();
+		shared_ptr<const Storage> copy = make_shared<const Storage>(vector<char>(start, start + mSize));
+		if (atomic_compare_exchange_strong(&mVectorStorage, &storage, copy))
+			storage = copy;
+	}
+	return storage->bytes;
+}
+
+string SharedBuffer::asString () const {
+	return mStorage ? string(data(), mSize) : string();
+}
+
+bool SharedBuffer::isSharedWith (const SharedBuffer &other) const {
+	return mStorage && mStorage == other.mStorage;
+}
+
+// -----------------------------------------------------------------------------
+
+bool SharedBuffer::operator== (const SharedBuffer &other) const {
+	if (mSize != other.mSize)
+		return false;
+	if (mSize == 0 || (mStorage == other.mStorage && mOffset == other.mOffset))
+		return true;
+	return memcmp(data(), other.data(), mSize) == 0;
+}
+
+bool SharedBuffer::operator!= (const SharedBuffer &other) const {
+	return !(*this == other);
+}
+
+LINPHONE_END_NAMESPACE
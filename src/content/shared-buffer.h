@@ -0,0 +1,84 @@
+/*
+ * shared-buffer.h
+ * Copyright (C) 2010-2018 Belledonne Communications SARL
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _L_SHARED_BUFFER_H_
+#define _L_SHARED_BUFFER_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "linphone/utils/general.h"
+
+// =============================================================================
+
+LINPHONE_BEGIN_NAMESPACE
+
+/*
+ * Immutable byte buffer shared by all its copies. A slice refers to a range of the same bytes, so neither copying
+ * nor slicing duplicates the data. The bytes are zeroed when the last reference goes away since they may contain
+ * private data like cipher keys or decoded messages.
+ */
+class LINPHONE_PUBLIC SharedBuffer {
+public:
+	SharedBuffer () = default;
+	explicit SharedBuffer (std::vector<char> &&bytes);
+	SharedBuffer (const void *bytes, size_t size);
+	SharedBuffer (const SharedBuffer &other);
+	SharedBuffer (SharedBuffer &&other);
+
+	SharedBuffer &operator= (const SharedBuffer &other);
+	SharedBuffer &operator= (SharedBuffer &&other);
+
+	const char *data () const;
+
+	size_t size () const {
+		return mSize;
+	}
+
+	bool empty () const {
+		return mSize == 0;
+	}
+
+	// The range is clamped to the bytes of this buffer.
+	SharedBuffer slice (size_t offset, size_t size = std::string::npos) const;
+
+	// All the bytes of the buffer. A slice is copied to a storage of its own the first time it is called, the slice itself
+	// is left untouched so that it can be called concurrently.
+	const std::vector<char> &asVector () const;
+	std::string asString () const;
+
+	bool isSharedWith (const SharedBuffer &other) const;
+
+	bool operator== (const SharedBuffer &other) const;
+	bool operator!= (const SharedBuffer &other) const;
+
+private:
+	struct Storage;
+
+	std::shared_ptr<const Storage> mStorage;
+	size_t mOffset = 0;
+	size_t mSize = 0;
+	// Only accessed with the atomic shared_ptr functions, see asVector().
+	mutable std::shared_ptr<const Storage> mVectorStorage;
+};
+
+LINPHONE_END_NAMESPACE
+
+#endif // ifndef _L_SHARED_BUFFER_H_
@@ -22,6 +22,7 @@
 #include "linphone/utils/algorithm.h"
 
 #include "address/identity-address.h"
+#include "chat/chat-message/chat-message-broadcast.h"
 #include "chat/chat-room/abstract-chat-room.h"
 #include "chat/chat-room/basic-chat-room.h"
 #include "chat/chat-room/basic-to-client-group-chat-room.h"
@@ -31,6 +32,7 @@
 #include "chat/chat-room/real-time-text-chat-room.h"
 #include "conference/handlers/remote-conference-list-event-handler.h"
 #include "conference/participant.h"
+#include "content/content.h"
 #include "core-p.h"
 #include "logger/logger.h"
 
@@ -489,4 +491,32 @@ void Core::deleteChatRoom (const shared_ptr<const AbstractChatRoom> &chatRoom) {
 		L_ASSERT(find(d->chatRooms, chatRoom) == d->chatRooms.end());
 }
 
+// -----------------------------------------------------------------------------
+
+shared_ptr<ChatMessageBroadcast> Core::broadcastChatMessage (const Content &content, const list<IdentityAddress> &peers) {
+	L_D();
+
+	vector<shared_ptr<ChatMessage>> messages;
+	messages.reserve(peers.size());
+	for (const auto &peer : peers) {
+		shared_ptr<AbstractChatRoom> chatRoom = getOrCreateBasicChatRoom(peer);
+		if (!chatRoom) {
+			lError() << "Unable to broadcast chat message to " << peer;
+			continue;
+		}
+		shared_ptr<ChatMessage> message = chatRoom->createChatMessage();
+		// Copying the content does not copy its body.
+		message->addContent(new Content(content));
+		messages.push_back(message);
+	}
+
+	shared_ptr<ChatMessageBroadcast> broadcast = make_shared<ChatMessageBroadcast>(getSharedFromThis(), move(messages));
+	d->chatMessageBroadcasts.push_back(broadcast);
+	broadcast->start();
+	// Nothing to wait for, without peers.
+	if (broadcast->isDone())
+		d->chatMessageBroadcasts.remove(broadcast);
+	return broadcast;
+}
+
 LINPHONE_END_NAMESPACE
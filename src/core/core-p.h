@@ -30,10 +30,15 @@
 
 LINPHONE_BEGIN_NAMESPACE
 
+class CallStatsSnapshotTable;
+class ChatMessageBroadcast;
+class ChatMessageSendPipeline;
 class CoreListener;
 class EncryptionEngine;
 class LocalConferenceListEventHandler;
+class NetworkTopologyCache;
 class RemoteConferenceListEventHandler;
+class StunClient;
 
 class CorePrivate : public ObjectPrivate {
 public:
@@ -49,6 +54,8 @@ public:
 	void notifyEnteringForeground ();
 
 	void enableFriendListsSubscription (bool enable);
+	void iterateChatMessageSendPipeline () const;
+	void updateServerQueuedMessageCount (int64_t delta);
 
 	int addCall (const std::shared_ptr<Call> &call);
 	bool canWeAddCall () const;
@@ -111,12 +118,29 @@ public:
 	std::unique_ptr<MainDb> mainDb;
 	std::unique_ptr<RemoteConferenceListEventHandler> remoteListEventHandler;
 	std::unique_ptr<LocalConferenceListEventHandler> localListEventHandler;
+	std::unique_ptr<NetworkTopologyCache> networkTopologyCache;
+	// Shared with the media sessions, that may outlive the core.
+	std::shared_ptr<CallStatsSnapshotTable> callStatsSnapshots;
+	// Only created if [misc] chat_send_worker_threads is set, otherwise chat messages are sent synchronously.
+	std::shared_ptr<ChatMessageSendPipeline> chatMessageSendPipeline;
+	// Kept until each of their messages is delivered or not.
+	std::list<std::shared_ptr<ChatMessageBroadcast>> chatMessageBroadcasts;
+	// Started by linphone_run_stun_tests(), kept until their discovery is done.
+	std::list<std::shared_ptr<StunClient>> stunClients;
+	// Messages queued by the server group chat rooms of this core for their devices.
+	int64_t serverQueuedMessageCount = 0;
 
 private:
 	bool isInBackground = false;
 	bool isFriendListSubscriptionEnabled = false;
 
-	std::list<CoreListener *> listeners;
+	template<typename... Params, typename... Args>
+	void notifyListeners (void (CoreListener::*method)(Params...), Args &&...args);
+
+	// Unregistered listeners are set to null while a notification is running, and erased once it is done.
+	std::vector<CoreListener *> listeners;
+	int listenersNotifyDepth = 0;
+	bool hasUnregisteredListeners = false;
 
 	std::list<std::shared_ptr<Call>> calls;
 	std::shared_ptr<Call> currentCall;
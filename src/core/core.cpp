@@ -25,6 +25,9 @@
 
 #include "address/address-p.h"
 #include "call/call.h"
+#include "call/call-stats-snapshot-table.h"
+#include "chat/chat-message/chat-message-broadcast.h"
+#include "chat/chat-message/chat-message-send-pipeline.h"
 #include "chat/encryption/encryption-engine.h"
 #ifdef HAVE_LIME_X3DH
 #include "chat/encryption/lime-x3dh-encryption-engine.h"
@@ -34,6 +37,9 @@
 #include "core/core-listener.h"
 #include "core/core-p.h"
 #include "logger/logger.h"
+#include "logger/metrics.h"
+#include "nat/network-topology-cache.h"
+#include "nat/stun-client.h"
 #include "paths/paths.h"
 #include "linphone/utils/utils.h"
 #include "linphone/utils/algorithm.h"
@@ -56,6 +62,24 @@ void CorePrivate::init () {
 	mainDb.reset(new MainDb(q->getSharedFromThis()));
 	remoteListEventHandler = makeUnique<RemoteConferenceListEventHandler>(q->getSharedFromThis());
 	localListEventHandler = makeUnique<LocalConferenceListEventHandler>(q->getSharedFromThis());
+	networkTopologyCache = makeUnique<NetworkTopologyCache>(q->getSharedFromThis());
+	networkTopologyCache->start();
+
+	// Room for the audio, video and text streams of as many calls as the core accepts.
+	LinphoneCore *lc = L_GET_C_BACK_PTR(q);
+	int snapshotCapacity = lp_config_get_int(linphone_core_get_config(lc), "misc", "call_stats_snapshot_capacity", 3 * linphone_core_get_max_calls(lc));
+	callStatsSnapshots = make_shared<CallStatsSnapshotTable>(static_cast<size_t>(max(snapshotCapacity, 0)));
+
+	if (lp_config_get_int(linphone_core_get_config(lc), "misc", "metrics_enabled", 0))
+		Metrics::setEnabled(true);
+
+	int sendWorkerThreads = lp_config_get_int(linphone_core_get_config(lc), "misc", "chat_send_worker_threads", 0);
+	if (sendWorkerThreads > 0) {
+		int maxInFlight = lp_config_get_int(linphone_core_get_config(lc), "misc", "chat_send_max_in_flight", 64);
+		chatMessageSendPipeline = make_shared<ChatMessageSendPipeline>(
+			static_cast<size_t>(sendWorkerThreads), static_cast<size_t>(max(maxInFlight, 1))
+		);
+	}
 
 	AbstractDb::Backend backend;
 	string uri = L_C_TO_STRING(lp_config_get_string(linphone_core_get_config(L_GET_C_BACK_PTR(q)), "storage", "uri", nullptr));
@@ -84,7 +108,29 @@ void CorePrivate::registerListener (CoreListener *listener) {
 }
 
 void CorePrivate::unregisterListener (CoreListener *listener) {
-	listeners.remove(listener);
+	auto it = find(listeners.begin(), listeners.end(), listener);
+	if (it == listeners.end())
+		return;
+	if (listenersNotifyDepth > 0) {
+		*it = nullptr;
+		hasUnregisteredListeners = true;
+	} else
+		listeners.erase(it);
+}
+
+template<typename... Params, typename... Args>
+void CorePrivate::notifyListeners (void (CoreListener::*method)(Params...), Args &&...args) {
+	listenersNotifyDepth++;
+	// Listeners registered by a listener are only notified of the next events.
+	for (size_t i = 0, size = listeners.size(); i < size; i++) {
+		CoreListener *listener = listeners[i];
+		if (listener)
+			(listener->*method)(args...);
+	}
+	if ((--listenersNotifyDepth == 0) && hasUnregisteredListeners) {
+		listeners.erase(remove(listeners.begin(), listeners.end(), nullptr), listeners.end());
+		hasUnregisteredListeners = false;
+	}
 }
 
 void CorePrivate::uninit () {
@@ -95,6 +141,20 @@ void CorePrivate::uninit () {
 		ms_usleep(10000);
 	}
 
+	// The messages it did not send are notified, released first so that none of them is queued again.
+	shared_ptr<ChatMessageSendPipeline> sendPipeline;
+	sendPipeline.swap(chatMessageSendPipeline);
+	if (sendPipeline)
+		sendPipeline->cancel();
+	sendPipeline = nullptr;
+	list<shared_ptr<ChatMessageBroadcast>> broadcasts;
+	broadcasts.swap(chatMessageBroadcasts);
+	for (const auto &broadcast : broadcasts)
+		broadcast->cancel();
+	// Their sockets and timers belong to the main loop of the core, their callbacks are not called.
+	for (const auto &stunClient : stunClients)
+		stunClient->cancel();
+	stunClients.clear();
 	chatRooms.clear();
 	chatRoomsById.clear();
 	noCreatedClientGroupChatRooms.clear();
@@ -105,6 +165,8 @@ void CorePrivate::uninit () {
 
 	remoteListEventHandler = nullptr;
 	localListEventHandler = nullptr;
+	networkTopologyCache = nullptr;
+	callStatsSnapshots = nullptr;
 
 	AddressPrivate::clearSipAddressesCache();
 	if (mainDb != nullptr) {
@@ -115,21 +177,21 @@ void CorePrivate::uninit () {
 // -----------------------------------------------------------------------------
 
 void CorePrivate::notifyGlobalStateChanged (LinphoneGlobalState state) {
-	auto listenersCopy = listeners; // Allow removable of a listener in its own call
-	for (const auto &listener : listenersCopy)
-		listener->onGlobalStateChanged(state);
+	notifyListeners(&CoreListener::onGlobalStateChanged, state);
 }
 
 void CorePrivate::notifyNetworkReachable (bool sipNetworkReachable, bool mediaNetworkReachable) {
-	auto listenersCopy = listeners; // Allow removable of a listener in its own call
-	for (const auto &listener : listenersCopy)
-		listener->onNetworkReachable(sipNetworkReachable, mediaNetworkReachable);
+	// Whatever was learnt about the previous network is meaningless now, warm the cache up again for the next call.
+	if (networkTopologyCache) {
+		networkTopologyCache->invalidate();
+		if (mediaNetworkReachable)
+			networkTopologyCache->refresh();
+	}
+	notifyListeners(&CoreListener::onNetworkReachable, sipNetworkReachable, mediaNetworkReachable);
 }
 
 void CorePrivate::notifyRegistrationStateChanged (LinphoneProxyConfig *cfg, LinphoneRegistrationState state, const string &message) {
-	auto listenersCopy = listeners; // Allow removable of a listener in its own call
-	for (const auto &listener : listenersCopy)
-		listener->onRegistrationStateChanged(cfg, state, message);
+	notifyListeners(&CoreListener::onRegistrationStateChanged, cfg, state, message);
 }
 
 void CorePrivate::notifyEnteringBackground () {
@@ -137,9 +199,7 @@ void CorePrivate::notifyEnteringBackground () {
 		return;
 
 	isInBackground = true;
-	auto listenersCopy = listeners; // Allow removable of a listener in its own call
-	for (const auto &listener : listenersCopy)
-		listener->onEnteringBackground();
+	notifyListeners(&CoreListener::onEnteringBackground);
 
 	if (isFriendListSubscriptionEnabled)
 		enableFriendListsSubscription(false);
@@ -159,9 +219,7 @@ void CorePrivate::notifyEnteringForeground () {
 		linphone_core_refresh_registers(lc);
 	}
 
-	auto listenersCopy = listeners; // Allow removable of a listener in its own call
-	for (const auto &listener : listenersCopy)
-		listener->onEnteringForeground();
+	notifyListeners(&CoreListener::onEnteringForeground);
 
 	if (isFriendListSubscriptionEnabled)
 		enableFriendListsSubscription(true);	
@@ -187,6 +245,16 @@ void CorePrivate::enableFriendListsSubscription(bool enable) {
 	}
 }
 
+void CorePrivate::iterateChatMessageSendPipeline () const {
+	if (chatMessageSendPipeline)
+		chatMessageSendPipeline->processDoneJobs();
+}
+
+void CorePrivate::updateServerQueuedMessageCount (int64_t delta) {
+	serverQueuedMessageCount += delta;
+	L_METRIC_GAUGE_SET("chat.server_queue.depth", serverQueuedMessageCount);
+}
+
 bool CorePrivate::basicToFlexisipChatroomMigrationEnabled()const{
 	L_Q();
 	return linphone_config_get_bool(linphone_core_get_config(q->getCCore()), "misc", "enable_basic_to_client_group_chat_room_migration", FALSE);
@@ -36,7 +36,9 @@ LINPHONE_BEGIN_NAMESPACE
 class AbstractChatRoom;
 class Address;
 class Call;
+class ChatMessageBroadcast;
 class ConferenceId;
+class Content;
 class CorePrivate;
 class IdentityAddress;
 class EncryptionEngine;
@@ -47,13 +49,18 @@ class LINPHONE_PUBLIC Core : public Object {
 	friend class CallPrivate;
 	friend class CallSession;
 	friend class ChatMessage;
+	friend class ChatMessageBroadcast;
+	friend class ChatMessageSendPipeline;
 	friend class ChatMessagePrivate;
 	friend class ChatRoom;
 	friend class ChatRoomPrivate;
 	friend class ClientGroupChatRoom;
 	friend class ClientGroupChatRoomPrivate;
 	friend class ClientGroupToBasicChatRoomPrivate;
+	friend class FileTransferChatMessageModifier;
+	friend class IceAgent;
 	friend class Imdn;
+	friend class LimeX3dhEncryptionEngine;
 	friend class LocalConferenceEventHandlerPrivate;
 	friend class MainDb;
 	friend class MainDbChatMessageKey;
@@ -135,6 +142,9 @@ public:
 
 	static void deleteChatRoom (const std::shared_ptr<const AbstractChatRoom> &chatRoom);
 
+	// Sends the content to each peer in its basic chat room. The body is shared by all the messages.
+	std::shared_ptr<ChatMessageBroadcast> broadcastChatMessage (const Content &content, const std::list<IdentityAddress> &peers);
+
 	// ---------------------------------------------------------------------------
 	// Paths.
 	// ---------------------------------------------------------------------------
@@ -22,6 +22,7 @@
 
 #include "db/main-db-p.h"
 #include "logger/logger.h"
+#include "logger/metrics.h"
 
 // =============================================================================
 
@@ -95,11 +96,13 @@ public:
 		const char *name = info.name;
 		soci::session *session = mainDb->getPrivate()->dbSession.getBackendSession();
 
+		L_METRIC_TIME_SCOPE("maindb.transaction");
 		try {
 			SmartTransaction tr(session, name);
 			mResult = exec<InternalReturnType>(tr);
 		} catch (const soci::soci_error &e) {
 			lWarning() << "Catched exception in MainDb::" << name << "(" << e.what() << ").";
+			L_METRIC_COUNTER_INCREMENT("maindb.transaction.errors");
 			soci::soci_error::error_category category = e.get_error_category();
 			if (
 				(category == soci::soci_error::connection_error || category == soci::soci_error::unknown) &&
@@ -116,6 +119,7 @@ public:
 			lError() << "Unhandled [" << getErrorCategoryAsString(category) << "] exception in MainDb::" <<
 				name << ": `" << e.what() << "`.";
 		} catch (const std::exception &e) {
+			L_METRIC_COUNTER_INCREMENT("maindb.transaction.errors");
 			lError() << "Unhandled generic exception in MainDb::" << name << ": `" << e.what() << "`.";
 		}
 	}
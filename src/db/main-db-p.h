@@ -145,6 +145,8 @@ private:
 		const soci::row &row
 	) const;
 
+	// Dispatches on the event type, returns -1 if the event cannot be inserted.
+	long long insertEventLog (const std::shared_ptr<EventLog> &eventLog);
 	long long insertEvent (const std::shared_ptr<EventLog> &eventLog);
 	long long insertConferenceEvent (const std::shared_ptr<EventLog> &eventLog, long long *chatRoomId = nullptr);
 	long long insertConferenceCallEvent (const std::shared_ptr<EventLog> &eventLog);
@@ -18,6 +18,7 @@
  */
 
 #include <ctime>
+#include <limits>
 
 #include "linphone/utils/algorithm.h"
 #include "linphone/utils/static-string.h"
@@ -720,6 +721,44 @@ shared_ptr<EventLog> MainDbPrivate::selectConferenceSubjectEvent (
 
 // -----------------------------------------------------------------------------
 
+long long MainDbPrivate::insertEventLog (const shared_ptr<EventLog> &eventLog) {
+	EventLog::Type type = eventLog->getType();
+	lInfo() << "MainDb::addEvent() of type " << static_cast<int>(type);
+	switch (type) {
+		case EventLog::Type::None:
+			return -1;
+
+		case EventLog::Type::ConferenceCreated:
+		case EventLog::Type::ConferenceTerminated:
+			return insertConferenceEvent(eventLog);
+
+		case EventLog::Type::ConferenceCallStart:
+		case EventLog::Type::ConferenceCallEnd:
+			return insertConferenceCallEvent(eventLog);
+
+		case EventLog::Type::ConferenceChatMessage:
+			return insertConferenceChatMessageEvent(eventLog);
+
+		case EventLog::Type::ConferenceParticipantAdded:
+		case EventLog::Type::ConferenceParticipantRemoved:
+		case EventLog::Type::ConferenceParticipantSetAdmin:
+		case EventLog::Type::ConferenceParticipantUnsetAdmin:
+			return insertConferenceParticipantEvent(eventLog);
+
+		case EventLog::Type::ConferenceParticipantDeviceAdded:
+		case EventLog::Type::ConferenceParticipantDeviceRemoved:
+			return insertConferenceParticipantDeviceEvent(eventLog);
+
+		case EventLog::Type::ConferenceSecurityEvent:
+			return insertConferenceSecurityEvent(eventLog);
+
+		case EventLog::Type::ConferenceSubjectChanged:
+			return insertConferenceSubjectEvent(eventLog);
+	}
+
+	return -1;
+}
+
 long long MainDbPrivate::insertEvent (const shared_ptr<EventLog> &eventLog) {
 	const int &type = int(eventLog->getType());
 	const tm &creationTime = Utils::getTimeTAsTm(eventLog->getCreationTime());
@@ -1735,6 +1774,72 @@ void MainDb::init () {
 		"    ON DELETE CASCADE"
 		") " + charset;
 
+	*session <<
+		"CREATE TABLE IF NOT EXISTS chat_message_file_transfer_segment ("
+		"  event_id" + primaryKeyRefStr("BIGINT UNSIGNED") + ","
+		"  range_start BIGINT UNSIGNED NOT NULL,"
+		"  range_end BIGINT UNSIGNED NOT NULL,"
+		"  received BIGINT UNSIGNED NOT NULL,"
+		"  url VARCHAR(2047) NOT NULL,"
+		"  path VARCHAR(512) NOT NULL,"
+
+		"  PRIMARY KEY (event_id, range_start),"
+		"  FOREIGN KEY (event_id)"
+		"    REFERENCES conference_chat_message_event(event_id)"
+		"    ON DELETE CASCADE"
+		") " + charset;
+
+	*session <<
+		"CREATE TABLE IF NOT EXISTS chat_message_file_transfer_upload ("
+		"  event_id" + primaryKeyStr("BIGINT UNSIGNED") + ","
+		"  session VARCHAR(255) NOT NULL,"
+		"  path VARCHAR(512) NOT NULL,"
+
+		"  FOREIGN KEY (event_id)"
+		"    REFERENCES conference_chat_message_event(event_id)"
+		"    ON DELETE CASCADE"
+		") " + charset;
+
+	*session <<
+		"CREATE TABLE IF NOT EXISTS server_queued_message ("
+		"  id" + primaryKeyStr("BIGINT UNSIGNED") + ","
+
+		"  chat_room_id" + primaryKeyRefStr("BIGINT UNSIGNED") + " NOT NULL,"
+		"  from_sip_address_id" + primaryKeyRefStr("BIGINT UNSIGNED") + " NOT NULL,"
+		"  content_type_id" + primaryKeyRefStr("SMALLINT UNSIGNED") + " NOT NULL,"
+		"  body TEXT NOT NULL,"
+		"  headers TEXT NOT NULL,"
+		"  creation_time" + timestampType() + " NOT NULL,"
+
+		// Number of devices the message is still queued for.
+		"  device_count INT UNSIGNED NOT NULL,"
+
+		"  FOREIGN KEY (chat_room_id)"
+		"    REFERENCES chat_room(id)"
+		"    ON DELETE CASCADE,"
+		"  FOREIGN KEY (from_sip_address_id)"
+		"    REFERENCES sip_address(id)"
+		"    ON DELETE CASCADE,"
+		"  FOREIGN KEY (content_type_id)"
+		"    REFERENCES content_type(id)"
+		"    ON DELETE CASCADE"
+		") " + charset;
+
+	*session <<
+		"CREATE TABLE IF NOT EXISTS server_queued_message_device ("
+		"  device_sip_address_id" + primaryKeyRefStr("BIGINT UNSIGNED") + ","
+		"  server_queued_message_id" + primaryKeyRefStr("BIGINT UNSIGNED") + ","
+
+		// Device first, the messages of a device are read in order.
+		"  PRIMARY KEY (device_sip_address_id, server_queued_message_id),"
+		"  FOREIGN KEY (device_sip_address_id)"
+		"    REFERENCES sip_address(id)"
+		"    ON DELETE CASCADE,"
+		"  FOREIGN KEY (server_queued_message_id)"
+		"    REFERENCES server_queued_message(id)"
+		"    ON DELETE CASCADE"
+		") " + charset;
+
 	*session <<
 		"CREATE TABLE IF NOT EXISTS chat_message_content_app_data ("
 		"  chat_message_content_id" + primaryKeyRefStr("BIGINT UNSIGNED") + ","
@@ -1828,54 +1933,12 @@ bool MainDb::addEvent (const shared_ptr<EventLog> &eventLog) {
 	return L_DB_TRANSACTION {
 		L_D();
 
-		long long eventId = -1;
-
-		EventLog::Type type = eventLog->getType();
-		lInfo() << "MainDb::addEvent() of type " << static_cast<int>(type);
-		switch (type) {
-			case EventLog::Type::None:
-				return false;
-
-			case EventLog::Type::ConferenceCreated:
-			case EventLog::Type::ConferenceTerminated:
-				eventId = d->insertConferenceEvent(eventLog);
-				break;
-
-			case EventLog::Type::ConferenceCallStart:
-			case EventLog::Type::ConferenceCallEnd:
-				eventId = d->insertConferenceCallEvent(eventLog);
-				break;
-
-			case EventLog::Type::ConferenceChatMessage:
-				eventId = d->insertConferenceChatMessageEvent(eventLog);
-				break;
-
-			case EventLog::Type::ConferenceParticipantAdded:
-			case EventLog::Type::ConferenceParticipantRemoved:
-			case EventLog::Type::ConferenceParticipantSetAdmin:
-			case EventLog::Type::ConferenceParticipantUnsetAdmin:
-				eventId = d->insertConferenceParticipantEvent(eventLog);
-				break;
-
-			case EventLog::Type::ConferenceParticipantDeviceAdded:
-			case EventLog::Type::ConferenceParticipantDeviceRemoved:
-				eventId = d->insertConferenceParticipantDeviceEvent(eventLog);
-				break;
-
-			case EventLog::Type::ConferenceSecurityEvent:
-				eventId = d->insertConferenceSecurityEvent(eventLog);
-				break;
-
-			case EventLog::Type::ConferenceSubjectChanged:
-				eventId = d->insertConferenceSubjectEvent(eventLog);
-				break;
-		}
-
+		long long eventId = d->insertEventLog(eventLog);
 		if (eventId >= 0) {
 			tr.commit();
 			d->cache(eventLog, eventId);
 
-			if (type == EventLog::Type::ConferenceChatMessage)
+			if (eventLog->getType() == EventLog::Type::ConferenceChatMessage)
 				d->cache(static_pointer_cast<ConferenceChatMessageEvent>(eventLog)->getChatMessage(), eventId);
 
 			return true;
@@ -1885,6 +1948,43 @@ bool MainDb::addEvent (const shared_ptr<EventLog> &eventLog) {
 	};
 }
 
+bool MainDb::addEvents (const list<shared_ptr<EventLog>> &eventLogs) {
+	for (const auto &eventLog : eventLogs) {
+		if (eventLog->getPrivate()->dbKey.isValid()) {
+			lWarning() << "Unable to add an event twice!!!";
+			return false;
+		}
+	}
+
+	return L_DB_TRANSACTION {
+		L_D();
+
+		// Nothing is cached before the commit, the transaction may be run again after a reconnection.
+		vector<long long> eventIds;
+		eventIds.reserve(eventLogs.size());
+		for (const auto &eventLog : eventLogs) {
+			long long eventId = d->insertEventLog(eventLog);
+			if (eventId < 0) {
+				lError() << "MainDb::addEvents() failed.";
+				return false;
+			}
+			eventIds.push_back(eventId);
+		}
+
+		tr.commit();
+		L_METRIC_COUNTER_ADD("maindb.batched_events", eventIds.size());
+
+		auto eventId = eventIds.cbegin();
+		for (const auto &eventLog : eventLogs) {
+			d->cache(eventLog, *eventId);
+			if (eventLog->getType() == EventLog::Type::ConferenceChatMessage)
+				d->cache(static_pointer_cast<ConferenceChatMessageEvent>(eventLog)->getChatMessage(), *eventId);
+			++eventId;
+		}
+		return true;
+	};
+}
+
 bool MainDb::updateEvent (const shared_ptr<EventLog> &eventLog) {
 	if (!eventLog->getPrivate()->dbKey.isValid()) {
 		lWarning() << "Unable to update an event that wasn't inserted yet!!!";
@@ -2527,6 +2627,127 @@ void MainDb::loadChatMessageContents (const shared_ptr<ChatMessage> &chatMessage
 	};
 }
 
+list<MainDb::FileTransferSegment> MainDb::getChatMessageFileTransferSegments (
+	const shared_ptr<ChatMessage> &chatMessage,
+	const string &url,
+	const string &path
+) const {
+	return L_DB_TRANSACTION {
+		L_D();
+
+		MainDbKeyPrivate *dEventKey = static_cast<MainDbKey &>(chatMessage->getPrivate()->dbKey).getPrivate();
+		const long long &eventId = dEventKey->storageId;
+
+		long long start, end, received;
+		soci::statement statement = (
+			d->dbSession.getBackendSession()->prepare << "SELECT range_start, range_end, received"
+				" FROM chat_message_file_transfer_segment"
+				" WHERE event_id = :eventId AND url = :url AND path = :path"
+				" ORDER BY range_start",
+				soci::into(start), soci::into(end), soci::into(received), soci::use(eventId), soci::use(url), soci::use(path)
+		);
+		statement.execute();
+
+		list<FileTransferSegment> segments;
+		while (statement.fetch())
+			segments.push_back(FileTransferSegment{ size_t(start), size_t(end), size_t(received) });
+
+		return segments;
+	};
+}
+
+void MainDb::updateChatMessageFileTransferSegments (
+	const shared_ptr<ChatMessage> &chatMessage,
+	const string &url,
+	const string &path,
+	const list<FileTransferSegment> &segments
+) {
+	L_DB_TRANSACTION {
+		L_D();
+
+		soci::session *session = d->dbSession.getBackendSession();
+		MainDbKeyPrivate *dEventKey = static_cast<MainDbKey &>(chatMessage->getPrivate()->dbKey).getPrivate();
+		const long long &eventId = dEventKey->storageId;
+
+		*session << "DELETE FROM chat_message_file_transfer_segment WHERE event_id = :eventId", soci::use(eventId);
+
+		long long start, end, received;
+		soci::statement statement = (
+			session->prepare << "INSERT INTO chat_message_file_transfer_segment"
+				" (event_id, range_start, range_end, received, url, path) VALUES"
+				" (:eventId, :start, :end, :received, :url, :path)",
+				soci::use(eventId), soci::use(start), soci::use(end), soci::use(received), soci::use(url), soci::use(path)
+		);
+		for (const auto &segment : segments) {
+			start = static_cast<long long>(segment.start);
+			end = static_cast<long long>(segment.end);
+			received = static_cast<long long>(segment.received);
+			statement.execute(true);
+		}
+
+		tr.commit();
+	};
+}
+
+void MainDb::deleteChatMessageFileTransferSegments (const shared_ptr<ChatMessage> &chatMessage) {
+	MainDbKeyPrivate *dEventKey = static_cast<MainDbKey &>(chatMessage->getPrivate()->dbKey).getPrivate();
+	const long long &eventId = dEventKey->storageId;
+
+	L_DB_TRANSACTION {
+		L_D();
+		*d->dbSession.getBackendSession() << "DELETE FROM chat_message_file_transfer_segment WHERE event_id = :eventId",
+			soci::use(eventId);
+		tr.commit();
+	};
+}
+
+string MainDb::getChatMessageFileTransferUploadSession (
+	const shared_ptr<ChatMessage> &chatMessage,
+	const string &path
+) const {
+	return L_DB_TRANSACTION {
+		L_D();
+
+		soci::session *session = d->dbSession.getBackendSession();
+		MainDbKeyPrivate *dEventKey = static_cast<MainDbKey &>(chatMessage->getPrivate()->dbKey).getPrivate();
+		const long long &eventId = dEventKey->storageId;
+
+		string sessionId;
+		*session << "SELECT session FROM chat_message_file_transfer_upload WHERE event_id = :eventId AND path = :path",
+			soci::into(sessionId), soci::use(eventId), soci::use(path);
+		return session->got_data() ? sessionId : string();
+	};
+}
+
+void MainDb::updateChatMessageFileTransferUploadSession (
+	const shared_ptr<ChatMessage> &chatMessage,
+	const string &path,
+	const string &sessionId
+) {
+	MainDbKeyPrivate *dEventKey = static_cast<MainDbKey &>(chatMessage->getPrivate()->dbKey).getPrivate();
+	const long long &eventId = dEventKey->storageId;
+
+	L_DB_TRANSACTION {
+		L_D();
+		*d->dbSession.getBackendSession() << "REPLACE INTO chat_message_file_transfer_upload (event_id, session, path)"
+			" VALUES (:eventId, :sessionId, :path)",
+			soci::use(eventId), soci::use(sessionId), soci::use(path);
+		tr.commit();
+	};
+}
+
+void MainDb::deleteChatMessageFileTransferUploadSession (const shared_ptr<ChatMessage> &chatMessage) {
+	MainDbKeyPrivate *dEventKey = static_cast<MainDbKey &>(chatMessage->getPrivate()->dbKey).getPrivate();
+	const long long &eventId = dEventKey->storageId;
+
+	L_DB_TRANSACTION {
+		L_D();
+		*d->dbSession.getBackendSession() << "DELETE FROM chat_message_file_transfer_upload WHERE event_id = :eventId",
+			soci::use(eventId);
+		tr.commit();
+	};
+}
+
 // -----------------------------------------------------------------------------
 
 void MainDb::disableDeliveryNotificationRequired (const std::shared_ptr<const EventLog> &eventLog) {
@@ -2924,6 +3145,188 @@ void MainDb::deleteChatRoomParticipantDevice (
 	const long long &participantId = d->selectChatRoomParticipantId(dbChatRoomId, participantSipAddressId);
 	d->deleteChatRoomParticipantDevice(participantId, participantSipAddressId);
 }
+
+// -----------------------------------------------------------------------------
+
+long long MainDb::addServerQueuedMessage (
+	const ConferenceId &conferenceId,
+	const ServerQueuedMessage &message,
+	const list<IdentityAddress> &deviceAddresses
+) {
+	return L_DB_TRANSACTION {
+		L_D();
+
+		const long long &dbChatRoomId = d->selectChatRoomId(conferenceId);
+		if (dbChatRoomId < 0) {
+			lError() << "Unable to find chat room storage id of: " << conferenceId << ".";
+			return 0LL;
+		}
+
+		soci::session *session = d->dbSession.getBackendSession();
+		const long long &fromSipAddressId = d->insertSipAddress(message.fromAddress.asString());
+		const long long &contentTypeId = d->insertContentType(message.contentType);
+		const tm &creationTime = Utils::getTimeTAsTm(message.creationTime);
+		const int &deviceCount = int(deviceAddresses.size());
+		*session << "INSERT INTO server_queued_message"
+			" (chat_room_id, from_sip_address_id, content_type_id, body, headers, creation_time, device_count) VALUES"
+			" (:chatRoomId, :fromSipAddressId, :contentTypeId, :body, :headers, :creationTime, :deviceCount)",
+			soci::use(dbChatRoomId), soci::use(fromSipAddressId), soci::use(contentTypeId), soci::use(message.body),
+			soci::use(message.headers), soci::use(creationTime), soci::use(deviceCount);
+		const long long &storageId = d->dbSession.getLastInsertId();
+
+		long long deviceSipAddressId;
+		soci::statement statement = (
+			session->prepare << "INSERT INTO server_queued_message_device (device_sip_address_id, server_queued_message_id)"
+				" VALUES (:deviceSipAddressId, :storageId)",
+				soci::use(deviceSipAddressId), soci::use(storageId)
+		);
+		for (const auto &deviceAddress : deviceAddresses) {
+			deviceSipAddressId = d->insertSipAddress(deviceAddress.asString());
+			statement.execute(true);
+		}
+
+		tr.commit();
+		return storageId;
+	};
+}
+
+list<MainDb::ServerQueuedMessage> MainDb::getServerQueuedMessages (
+	const ConferenceId &conferenceId,
+	const IdentityAddress &deviceAddress,
+	long long afterStorageId,
+	int limit
+) const {
+	string query = "SELECT server_queued_message.id, sip_address.value, content_type.value, body, headers, creation_time"
+		" FROM server_queued_message, server_queued_message_device, sip_address, content_type"
+		" WHERE device_sip_address_id = :deviceSipAddressId"
+		"  AND server_queued_message_id = server_queued_message.id"
+		"  AND chat_room_id = :chatRoomId"
+		"  AND server_queued_message.id > :afterStorageId"
+		"  AND sip_address.id = from_sip_address_id"
+		"  AND content_type.id = content_type_id"
+		" ORDER BY server_queued_message.id"
+		" LIMIT " + Utils::toString(limit);
+
+	return L_DB_TRANSACTION {
+		L_D();
+
+		list<ServerQueuedMessage> messages;
+		const long long &dbChatRoomId = d->selectChatRoomId(conferenceId);
+		const long long &deviceSipAddressId = d->selectSipAddressId(deviceAddress.asString());
+		if (dbChatRoomId < 0 || deviceSipAddressId < 0)
+			return messages;
+
+		soci::rowset<soci::row> rows = (
+			d->dbSession.getBackendSession()->prepare << query,
+				soci::use(deviceSipAddressId), soci::use(dbChatRoomId), soci::use(afterStorageId)
+		);
+		for (const auto &row : rows) {
+			ServerQueuedMessage message;
+			message.storageId = d->dbSession.resolveId(row, 0);
+			message.fromAddress = IdentityAddress(row.get<string>(1));
+			message.contentType = row.get<string>(2);
+			message.body = row.get<string>(3);
+			message.headers = row.get<string>(4);
+			message.creationTime = d->dbSession.getTime(row, 5);
+			messages.push_back(move(message));
+		}
+
+		return messages;
+	};
+}
+
+int MainDb::getServerQueuedMessageCount (const ConferenceId &conferenceId, const IdentityAddress &deviceAddress) const {
+	return L_DB_TRANSACTION {
+		L_D();
+
+		const long long &dbChatRoomId = d->selectChatRoomId(conferenceId);
+		const long long &deviceSipAddressId = d->selectSipAddressId(deviceAddress.asString());
+		if (dbChatRoomId < 0 || deviceSipAddressId < 0)
+			return 0;
+
+		int count = 0;
+		*d->dbSession.getBackendSession() << "SELECT COUNT(*) FROM server_queued_message, server_queued_message_device"
+			" WHERE device_sip_address_id = :deviceSipAddressId"
+			"  AND server_queued_message_id = id"
+			"  AND chat_room_id = :chatRoomId",
+			soci::use(deviceSipAddressId), soci::use(dbChatRoomId), soci::into(count);
+		return count;
+	};
+}
+
+void MainDb::deleteServerQueuedMessages (
+	const ConferenceId &conferenceId,
+	const IdentityAddress &deviceAddress,
+	long long upToStorageId
+) {
+	deleteServerQueuedMessages(conferenceId, { make_pair(deviceAddress, upToStorageId) });
+}
+
+void MainDb::deleteServerQueuedMessages (
+	const ConferenceId &conferenceId,
+	const list<pair<IdentityAddress, long long>> &upToStorageIds
+) {
+	L_DB_TRANSACTION {
+		L_D();
+
+		const long long &dbChatRoomId = d->selectChatRoomId(conferenceId);
+		if (dbChatRoomId < 0)
+			return;
+
+		soci::session *session = d->dbSession.getBackendSession();
+		long long deviceSipAddressId;
+		long long upToStorageId;
+		soci::statement updateStatement = (
+			session->prepare << "UPDATE server_queued_message SET device_count = device_count - 1"
+				" WHERE chat_room_id = :chatRoomId AND id <= :upToStorageId AND id IN ("
+				"  SELECT server_queued_message_id FROM server_queued_message_device"
+				"  WHERE device_sip_address_id = :deviceSipAddressId"
+				" )",
+				soci::use(dbChatRoomId), soci::use(upToStorageId), soci::use(deviceSipAddressId)
+		);
+		soci::statement deleteStatement = (
+			session->prepare << "DELETE FROM server_queued_message_device"
+				" WHERE device_sip_address_id = :deviceSipAddressId AND server_queued_message_id IN ("
+				"  SELECT id FROM server_queued_message WHERE chat_room_id = :chatRoomId AND id <= :upToStorageId"
+				" )",
+				soci::use(deviceSipAddressId), soci::use(dbChatRoomId), soci::use(upToStorageId)
+		);
+		for (const auto &entry : upToStorageIds) {
+			deviceSipAddressId = d->selectSipAddressId(entry.first.asString());
+			if (deviceSipAddressId < 0)
+				continue;
+
+			upToStorageId = entry.second > 0 ? entry.second : numeric_limits<long long>::max();
+			updateStatement.execute(true);
+			deleteStatement.execute(true);
+		}
+		*session << "DELETE FROM server_queued_message WHERE chat_room_id = :chatRoomId AND device_count = 0",
+			soci::use(dbChatRoomId);
+
+		tr.commit();
+	};
+}
+
+void MainDb::deleteExpiredServerQueuedMessages (const ConferenceId &conferenceId, time_t before) {
+	L_DB_TRANSACTION {
+		L_D();
+
+		const long long &dbChatRoomId = d->selectChatRoomId(conferenceId);
+		if (dbChatRoomId < 0)
+			return;
+
+		soci::session *session = d->dbSession.getBackendSession();
+		const tm &beforeTime = Utils::getTimeTAsTm(before);
+		*session << "DELETE FROM server_queued_message_device WHERE server_queued_message_id IN ("
+			"  SELECT id FROM server_queued_message WHERE chat_room_id = :chatRoomId AND creation_time < :beforeTime"
+			" )",
+			soci::use(dbChatRoomId), soci::use(beforeTime);
+		*session << "DELETE FROM server_queued_message WHERE chat_room_id = :chatRoomId AND creation_time < :beforeTime",
+			soci::use(dbChatRoomId), soci::use(beforeTime);
+
+		tr.commit();
+	};
+}
 	
 // -----------------------------------------------------------------------------
 
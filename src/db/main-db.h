@@ -69,6 +69,24 @@ public:
 		time_t timestamp = 0;
 	};
 
+	// Byte range [start, end) of a file being downloaded, of which the first received bytes are already written.
+	struct FileTransferSegment {
+		size_t start;
+		size_t end;
+		size_t received;
+	};
+
+	// Message kept by a server group chat room for a device that cannot receive it yet.
+	struct ServerQueuedMessage {
+		long long storageId = 0;
+		IdentityAddress fromAddress;
+		std::string contentType;
+		std::string body;
+		// Headers copied to the messages sent to the devices, a "Name: value\r\n" line each.
+		std::string headers;
+		time_t creationTime = 0;
+	};
+
 	MainDb (const std::shared_ptr<Core> &core);
 
 	// ---------------------------------------------------------------------------
@@ -76,6 +94,8 @@ public:
 	// ---------------------------------------------------------------------------
 
 	bool addEvent (const std::shared_ptr<EventLog> &eventLog);
+	// Adds all the events in a single transaction, none of them is added if one fails.
+	bool addEvents (const std::list<std::shared_ptr<EventLog>> &eventLogs);
 	bool updateEvent (const std::shared_ptr<EventLog> &eventLog);
 	static bool deleteEvent (const std::shared_ptr<const EventLog> &eventLog);
 	int getEventCount (FilterMask mask = NoFilter) const;
@@ -156,6 +176,30 @@ public:
 
 	void loadChatMessageContents (const std::shared_ptr<ChatMessage> &chatMessage);
 
+	std::list<FileTransferSegment> getChatMessageFileTransferSegments (
+		const std::shared_ptr<ChatMessage> &chatMessage,
+		const std::string &url,
+		const std::string &path
+	) const;
+	void updateChatMessageFileTransferSegments (
+		const std::shared_ptr<ChatMessage> &chatMessage,
+		const std::string &url,
+		const std::string &path,
+		const std::list<FileTransferSegment> &segments
+	);
+	void deleteChatMessageFileTransferSegments (const std::shared_ptr<ChatMessage> &chatMessage);
+
+	std::string getChatMessageFileTransferUploadSession (
+		const std::shared_ptr<ChatMessage> &chatMessage,
+		const std::string &path
+	) const;
+	void updateChatMessageFileTransferUploadSession (
+		const std::shared_ptr<ChatMessage> &chatMessage,
+		const std::string &path,
+		const std::string &sessionId
+	);
+	void deleteChatMessageFileTransferUploadSession (const std::shared_ptr<ChatMessage> &chatMessage);
+
 	void disableDeliveryNotificationRequired (const std::shared_ptr<const EventLog> &eventLog);
 	void disableDisplayNotificationRequired (const std::shared_ptr<const EventLog> &eventLog);
 
@@ -199,6 +243,39 @@ public:
 		const std::shared_ptr<ParticipantDevice> &device
 	);
 
+	// ---------------------------------------------------------------------------
+	// Server group chat room queued messages.
+	// ---------------------------------------------------------------------------
+
+	// The message is stored once for all the devices. Returns its storage id, 0 if it could not be stored.
+	// Storage ids grow in the order the messages are queued.
+	long long addServerQueuedMessage (
+		const ConferenceId &conferenceId,
+		const ServerQueuedMessage &message,
+		const std::list<IdentityAddress> &deviceAddresses
+	);
+	// At most limit messages queued for the device after the given storage id, oldest first.
+	std::list<ServerQueuedMessage> getServerQueuedMessages (
+		const ConferenceId &conferenceId,
+		const IdentityAddress &deviceAddress,
+		long long afterStorageId,
+		int limit
+	) const;
+	int getServerQueuedMessageCount (const ConferenceId &conferenceId, const IdentityAddress &deviceAddress) const;
+	// Removes the messages queued for the device up to this storage id included, all of them if it is 0.
+	void deleteServerQueuedMessages (
+		const ConferenceId &conferenceId,
+		const IdentityAddress &deviceAddress,
+		long long upToStorageId = 0
+	);
+	// Same for several devices in a single transaction, each one up to its own storage id.
+	void deleteServerQueuedMessages (
+		const ConferenceId &conferenceId,
+		const std::list<std::pair<IdentityAddress, long long>> &upToStorageIds
+	);
+	// Removes the messages queued before this time, for all the devices.
+	void deleteExpiredServerQueuedMessages (const ConferenceId &conferenceId, time_t before);
+
 	// ---------------------------------------------------------------------------
 	// Other.
 	// ---------------------------------------------------------------------------
@@ -0,0 +1,170 @@
+/*
+ * metrics.cpp
+ * Copyright (C) 2010-2018 Belledonne Communications SARL
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+#include "logger.h"
+#include "metrics.h"
+
+// =============================================================================
+
+using namespace std;
+
+LINPHONE_BEGIN_NAMESPACE
+
+namespace {
+	struct Registry {
+		mutex accessMutex;
+		map<string, unique_ptr<MetricCounter>> counters;
+		map<string, unique_ptr<MetricGauge>> gauges;
+		map<string, unique_ptr<MetricHistogram>> histograms;
+	};
+
+	Registry &getRegistry () {
+		static Registry registry;
+		return registry;
+	}
+
+	template<typename T>
+	T &getMetric (map<string, unique_ptr<T>> &metrics, const string &name) {
+		unique_ptr<T> &metric = metrics[name];
+		if (!metric)
+			metric.reset(new T);
+		return *metric;
+	}
+}
+
+// -----------------------------------------------------------------------------
+
+MetricHistogram::MetricHistogram () {
+	reset();
+}
+
+void MetricHistogram::record (uint64_t us) {
+	int bucket = 0;
+	for (uint64_t value = us; (value > 1) && (bucket < BucketCount - 1); value >>= 1)
+		bucket++;
+	mBuckets[bucket].fetch_add(1, memory_order_relaxed);
+	mCount.fetch_add(1, memory_order_relaxed);
+	mSum.fetch_add(us, memory_order_relaxed);
+
+	uint64_t min = mMin.load(memory_order_relaxed);
+	while ((us < min) && !mMin.compare_exchange_weak(min, us, memory_order_relaxed)) {}
+	uint64_t max = mMax.load(memory_order_relaxed);
+	while ((us > max) && !mMax.compare_exchange_weak(max, us, memory_order_relaxed)) {}
+}
+
+MetricHistogram::Summary MetricHistogram::getSummary () const {
+	Summary summary;
+	summary.count = mCount.load(memory_order_relaxed);
+	summary.sum = mSum.load(memory_order_relaxed);
+	summary.min = summary.count ? mMin.load(memory_order_relaxed) : 0;
+	summary.max = mMax.load(memory_order_relaxed);
+	summary.p50 = getPercentile(summary.count, summary.max, 50);
+	summary.p90 = getPercentile(summary.count, summary.max, 90);
+	summary.p99 = getPercentile(summary.count, summary.max, 99);
+	return summary;
+}
+
+void MetricHistogram::reset () {
+	for (auto &bucket : mBuckets)
+		bucket.store(0, memory_order_relaxed);
+	mCount.store(0, memory_order_relaxed);
+	mSum.store(0, memory_order_relaxed);
+	mMin.store(numeric_limits<uint64_t>::max(), memory_order_relaxed);
+	mMax.store(0, memory_order_relaxed);
+}
+
+// Upper bound of the bucket holding the requested rank, the samples are not kept.
+uint64_t MetricHistogram::getPercentile (uint64_t count, uint64_t max, int percent) const {
+	if (count == 0)
+		return 0;
+	uint64_t rank = (count * static_cast<uint64_t>(percent) + 99) / 100;
+	uint64_t seen = 0;
+	for (int i = 0; i < BucketCount; i++) {
+		seen += mBuckets[i].load(memory_order_relaxed);
+		if (seen >= rank) {
+			uint64_t upperBound = (uint64_t(1) << (i + 1)) - 1;
+			return upperBound < max ? upperBound : max;
+		}
+	}
+	return max;
+}
+
+// -----------------------------------------------------------------------------
+
+atomic<bool> Metrics::sEnabled(false);
+
+void Metrics::setEnabled (bool enabled) {
+	if (sEnabled.exchange(enabled) != enabled)
+		lInfo() << "Metrics " << (enabled ? "enabled" : "disabled");
+}
+
+MetricCounter &Metrics::getCounter (const string &name) {
+	Registry &registry = getRegistry();
+	lock_guard<mutex> lock(registry.accessMutex);
+	return getMetric(registry.counters, name);
+}
+
+MetricGauge &Metrics::getGauge (const string &name) {
+	Registry &registry = getRegistry();
+	lock_guard<mutex> lock(registry.accessMutex);
+	return getMetric(registry.gauges, name);
+}
+
+MetricHistogram &Metrics::getHistogram (const string &name) {
+	Registry &registry = getRegistry();
+	lock_guard<mutex> lock(registry.accessMutex);
+	return getMetric(registry.histograms, name);
+}
+
+// -----------------------------------------------------------------------------
+
+string Metrics::getReport () {
+	Registry &registry = getRegistry();
+	lock_guard<mutex> lock(registry.accessMutex);
+
+	ostringstream os;
+	for (const auto &counter : registry.counters)
+		os << "counter " << counter.first << " " << counter.second->get() << "\n";
+	for (const auto &gauge : registry.gauges)
+		os << "gauge " << gauge.first << " " << gauge.second->get() << "\n";
+	for (const auto &histogram : registry.histograms) {
+		MetricHistogram::Summary summary = histogram.second->getSummary();
+		os << "histogram " << histogram.first << " count=" << summary.count << " sum_us=" << summary.sum <<
+			" min_us=" << summary.min << " max_us=" << summary.max << " p50_us=" << summary.p50 <<
+			" p90_us=" << summary.p90 << " p99_us=" << summary.p99 << "\n";
+	}
+	return os.str();
+}
+
+void Metrics::reset () {
+	Registry &registry = getRegistry();
+	lock_guard<mutex> lock(registry.accessMutex);
+	for (const auto &counter : registry.counters)
+		counter.second->reset();
+	for (const auto &histogram : registry.histograms)
+		histogram.second->reset();
+}
+
+LINPHONE_END_NAMESPACE
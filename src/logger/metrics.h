@@ -0,0 +1,185 @@
+/*
+ * metrics.h
+ * Copyright (C) 2010-2018 Belledonne Communications SARL
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _L_METRICS_H_
+#define _L_METRICS_H_
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#include "linphone/utils/general.h"
+
+// =============================================================================
+
+// Instrumentation points. When the metrics are disabled they only cost the test of a flag, the arguments are not
+// evaluated. The metric of each point is looked up once, the first time it is hit while enabled.
+#define L_METRIC_COUNTER_ADD(NAME, VALUE) \
+	do { \
+		if (L_UNLIKELY(LinphonePrivate::Metrics::isEnabled())) { \
+			static LinphonePrivate::MetricCounter &metricCounter = LinphonePrivate::Metrics::getCounter(NAME); \
+			metricCounter.add(VALUE); \
+		} \
+	} while (false)
+
+#define L_METRIC_COUNTER_INCREMENT(NAME) L_METRIC_COUNTER_ADD(NAME, 1)
+
+#define L_METRIC_GAUGE_SET(NAME, VALUE) \
+	do { \
+		if (L_UNLIKELY(LinphonePrivate::Metrics::isEnabled())) { \
+			static LinphonePrivate::MetricGauge &metricGauge = LinphonePrivate::Metrics::getGauge(NAME); \
+			metricGauge.set(VALUE); \
+		} \
+	} while (false)
+
+#define L_METRIC_HISTOGRAM_RECORD(NAME, US) \
+	do { \
+		if (L_UNLIKELY(LinphonePrivate::Metrics::isEnabled())) { \
+			static LinphonePrivate::MetricHistogram &metricHistogram = LinphonePrivate::Metrics::getHistogram(NAME); \
+			metricHistogram.record(US); \
+		} \
+	} while (false)
+
+// Records the time spent until the end of the enclosing scope.
+#define L_METRIC_TIME_SCOPE(NAME) \
+	LinphonePrivate::MetricTimer L_METRIC_CONCAT(metricTimer, __LINE__)( \
+		L_UNLIKELY(LinphonePrivate::Metrics::isEnabled()) \
+			? []() -> LinphonePrivate::MetricHistogram * { \
+				static LinphonePrivate::MetricHistogram &metricHistogram = LinphonePrivate::Metrics::getHistogram(NAME); \
+				return &metricHistogram; \
+			}() \
+			: nullptr \
+	)
+
+#define L_METRIC_CONCAT_IMPL(A, B) A ## B
+#define L_METRIC_CONCAT(A, B) L_METRIC_CONCAT_IMPL(A, B)
+
+LINPHONE_BEGIN_NAMESPACE
+
+class MetricCounter {
+public:
+	void add (int64_t value) {
+		mValue.fetch_add(value, std::memory_order_relaxed);
+	}
+
+	int64_t get () const {
+		return mValue.load(std::memory_order_relaxed);
+	}
+
+	void reset () {
+		mValue.store(0, std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<int64_t> mValue{0};
+};
+
+class MetricGauge {
+public:
+	void set (int64_t value) {
+		mValue.store(value, std::memory_order_relaxed);
+	}
+
+	int64_t get () const {
+		return mValue.load(std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<int64_t> mValue{0};
+};
+
+// Latency histogram in microseconds, bucket i counts the samples in [2^i, 2^(i+1)).
+class MetricHistogram {
+public:
+	struct Summary {
+		uint64_t count;
+		uint64_t sum;
+		uint64_t min;
+		uint64_t max;
+		uint64_t p50;
+		uint64_t p90;
+		uint64_t p99;
+	};
+
+	MetricHistogram ();
+
+	void record (uint64_t us);
+	Summary getSummary () const;
+	void reset ();
+
+private:
+	static constexpr int BucketCount = 40;
+
+	uint64_t getPercentile (uint64_t count, uint64_t max, int percent) const;
+
+	std::atomic<uint64_t> mBuckets[BucketCount];
+	std::atomic<uint64_t> mCount;
+	std::atomic<uint64_t> mSum;
+	std::atomic<uint64_t> mMin;
+	std::atomic<uint64_t> mMax;
+};
+
+class MetricTimer {
+public:
+	explicit MetricTimer (MetricHistogram *histogram) : mHistogram(histogram) {
+		if (mHistogram)
+			mStart = std::chrono::steady_clock::now();
+	}
+
+	~MetricTimer () {
+		if (mHistogram)
+			mHistogram->record(static_cast<uint64_t>(
+				std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - mStart).count()
+			));
+	}
+
+private:
+	MetricHistogram *mHistogram;
+	std::chrono::steady_clock::time_point mStart;
+
+	L_DISABLE_COPY(MetricTimer);
+};
+
+// Process-wide registry of the metrics. Metrics are never removed once created so references to them stay valid.
+class Metrics {
+public:
+	static bool isEnabled () {
+		return sEnabled.load(std::memory_order_relaxed);
+	}
+
+	static void setEnabled (bool enabled);
+
+	static MetricCounter &getCounter (const std::string &name);
+	static MetricGauge &getGauge (const std::string &name);
+	static MetricHistogram &getHistogram (const std::string &name);
+
+	// One line per metric, sorted by name: "<type> <name> <values>".
+	static std::string getReport ();
+	// Counters and histograms go back to zero, gauges keep their current value.
+	static void reset ();
+
+private:
+	static std::atomic<bool> sEnabled;
+
+	L_DISABLE_COPY(Metrics);
+};
+
+LINPHONE_END_NAMESPACE
+
+#endif // ifndef _L_METRICS_H_
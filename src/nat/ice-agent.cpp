@@ -22,10 +22,11 @@
 #include "private.h"
 
 #include "conference/session/media-session-p.h"
-#include "core/core.h"
+#include "core/core-p.h"
 #include "logger/logger.h"
 
 #include "ice-agent.h"
+#include "network-topology-cache.h"
 
 // =============================================================================
 
@@ -95,6 +96,13 @@ void IceAgent::gatheringFinished () {
 	if (pingTime >= 0) {
 		mediaSession.getPrivate()->setPingTime(pingTime);
 	}
+
+	LinphoneNatPolicy *natPolicy = mediaSession.getPrivate()->getNatPolicy();
+	if (natPolicy && linphone_nat_policy_stun_server_activated(natPolicy)) {
+		recordReflexiveAddresses(natPolicy, ice_session_check_list(iceSession, mediaSession.getPrivate()->getStreamIndex(LinphoneStreamTypeAudio)));
+		recordReflexiveAddresses(natPolicy, ice_session_check_list(iceSession, mediaSession.getPrivate()->getStreamIndex(LinphoneStreamTypeVideo)));
+		recordReflexiveAddresses(natPolicy, ice_session_check_list(iceSession, mediaSession.getPrivate()->getStreamIndex(LinphoneStreamTypeText)));
+	}
 }
 
 int IceAgent::getNbLosingPairs () const {
@@ -451,6 +459,43 @@ void IceAgent::addLocalIceCandidates (int family, const char *addr, IceCheckList
 	}
 }
 
+// The server-reflexive mappings seen by the last calls are offered right away, the STUN answers then only confirm them
+// or add the new mapping. The cache is dropped on network changes so a stale mapping only costs a failed check pair.
+void IceAgent::addCachedReflexiveCandidates (LinphoneNatPolicy *natPolicy, IceCheckList *cl) {
+	if (!cl || (ice_check_list_state(cl) == ICL_Completed) || ice_check_list_candidates_gathered(cl))
+		return;
+	NetworkTopologyCache *topology = mediaSession.getCore()->getPrivate()->networkTopologyCache.get();
+	list<IceCandidate *> hostCandidates;
+	for (const bctbx_list_t *it = cl->local_candidates; it; it = bctbx_list_next(it)) {
+		IceCandidate *candidate = reinterpret_cast<IceCandidate *>(bctbx_list_get_data(it));
+		if (candidate->type == ICT_HostCandidate)
+			hostCandidates.push_back(candidate);
+	}
+	for (IceCandidate *hostCandidate : hostCandidates) {
+		string reflexiveAddress;
+		int reflexivePort;
+		if (!topology->getReflexiveAddress(natPolicy, hostCandidate->taddr.ip, hostCandidate->taddr.port, reflexiveAddress, reflexivePort))
+			continue;
+		ice_add_local_candidate(
+			cl, "srflx", hostCandidate->taddr.family, reflexiveAddress.c_str(), reflexivePort, hostCandidate->componentID, hostCandidate
+		);
+	}
+}
+
+void IceAgent::recordReflexiveAddresses (LinphoneNatPolicy *natPolicy, IceCheckList *cl) {
+	if (!cl)
+		return;
+	NetworkTopologyCache *topology = mediaSession.getCore()->getPrivate()->networkTopologyCache.get();
+	for (const bctbx_list_t *it = cl->local_candidates; it; it = bctbx_list_next(it)) {
+		const IceCandidate *candidate = reinterpret_cast<const IceCandidate *>(bctbx_list_get_data(it));
+		if ((candidate->type != ICT_ServerReflexiveCandidate) || !candidate->base)
+			continue;
+		topology->setReflexiveAddress(
+			natPolicy, candidate->base->taddr.ip, candidate->base->taddr.port, candidate->taddr.ip, candidate->taddr.port
+		);
+	}
+}
+
 bool IceAgent::checkForIceRestartAndSetRemoteCredentials (const SalMediaDescription *md, bool isOffer) {
 	bool iceRestarted = false;
 	string addr = md->addr;
@@ -591,13 +636,15 @@ int IceAgent::gatherIceCandidates () {
 	if (!audioCl && !videoCl && !textCl)
 		return -1;
 
-	const struct addrinfo *ai = nullptr;
+	// Local addresses and the STUN server address come from the core cache, warmed up before the call.
+	NetworkTopologyCache *topology = mediaSession.getCore()->getPrivate()->networkTopologyCache.get();
+	struct sockaddr_storage stunAddr;
+	socklen_t stunAddrLen = 0;
+	bool stunAddrFound = false;
 	LinphoneNatPolicy *natPolicy = mediaSession.getPrivate()->getNatPolicy();
 	if (natPolicy && linphone_nat_policy_stun_server_activated(natPolicy)) {
-		ai = linphone_nat_policy_get_stun_server_addrinfo(natPolicy);
-		if (ai)
-			ai = getIcePreferredStunServerAddrinfo(ai);
-		else
+		stunAddrFound = topology->getStunServerAddress(natPolicy, stunAddr, stunAddrLen);
+		if (!stunAddrFound)
 			lWarning() << "Failed to resolve STUN server for ICE gathering, continuing without STUN";
 	} else
 		lWarning() << "ICE is used without STUN server";
@@ -606,27 +653,32 @@ int IceAgent::gatherIceCandidates () {
 	ice_session_enable_short_turn_refresh(iceSession, core->short_turn_refresh);
 
 	// Gather local host candidates.
-	char localAddr[64];
+	string localAddr;
 	if (mediaSession.getPrivate()->getAf() == AF_INET6) {
-		if (linphone_core_get_local_ip_for(AF_INET6, nullptr, localAddr) < 0) {
+		if (!topology->getLocalAddress(AF_INET6, localAddr)) {
 			lError() << "Fail to get local IPv6";
 		} else
-			addLocalIceCandidates(AF_INET6, localAddr, audioCl, videoCl, textCl);
+			addLocalIceCandidates(AF_INET6, localAddr.c_str(), audioCl, videoCl, textCl);
 	}
-	if (linphone_core_get_local_ip_for(AF_INET, nullptr, localAddr) < 0) {
+	if (!topology->getLocalAddress(AF_INET, localAddr)) {
 		if (mediaSession.getPrivate()->getAf() != AF_INET6) {
 			lError() << "Fail to get local IPv4";
 			return -1;
 		}
 	} else
-		addLocalIceCandidates(AF_INET, localAddr, audioCl, videoCl, textCl);
-	if (ai && natPolicy && linphone_nat_policy_stun_server_activated(natPolicy)) {
+		addLocalIceCandidates(AF_INET, localAddr.c_str(), audioCl, videoCl, textCl);
+	if (stunAddrFound && natPolicy && linphone_nat_policy_stun_server_activated(natPolicy)) {
 		string server = linphone_nat_policy_get_stun_server(natPolicy);
 		lInfo() << "ICE: gathering candidates from [" << server << "] using " << (linphone_nat_policy_turn_enabled(natPolicy) ? "TURN" : "STUN");
+		if (!core->forced_ice_relay) {
+			addCachedReflexiveCandidates(natPolicy, audioCl);
+			addCachedReflexiveCandidates(natPolicy, videoCl);
+			addCachedReflexiveCandidates(natPolicy, textCl);
+		}
 		// Gather local srflx candidates.
 		ice_session_enable_turn(iceSession, linphone_nat_policy_turn_enabled(natPolicy));
 		ice_session_set_stun_auth_requested_cb(iceSession, MediaSessionPrivate::stunAuthRequestedCb, mediaSession.getPrivate());
-		return ice_session_gather_candidates(iceSession, ai->ai_addr, (socklen_t)ai->ai_addrlen) ? 1 : 0;
+		return ice_session_gather_candidates(iceSession, (struct sockaddr *)&stunAddr, stunAddrLen) ? 1 : 0;
 	} else {
 		lInfo() << "ICE: bypass candidates gathering";
 		ice_session_compute_candidates_foundations(iceSession);
@@ -654,50 +706,6 @@ void IceAgent::getIceDefaultAddrAndPort (
 	if ((*addr)[0] == '\0') *addr = md->addr;
 }
 
-/**
- * Choose the preferred IP address to use to contact the STUN server from the list of IP addresses
- * the DNS resolution returned. If a NAT64 address is present, use it, otherwise if an IPv4 address
- * is present, use it, otherwise use an IPv6 address if it is present.
- */
-const struct addrinfo *IceAgent::getIcePreferredStunServerAddrinfo (const struct addrinfo *ai) {
-	// Search for NAT64 addrinfo.
-	const struct addrinfo *it = ai;
-	while (it) {
-		if (it->ai_family == AF_INET6) {
-			struct sockaddr_storage ss;
-			socklen_t sslen = sizeof(ss);
-			memset(&ss, 0, sizeof(ss));
-			bctbx_sockaddr_remove_nat64_mapping(it->ai_addr, (struct sockaddr *)&ss, &sslen);
-			if (ss.ss_family == AF_INET) break;
-		}
-		it = it->ai_next;
-	}
-	const struct addrinfo *preferredAi = it;
-	if (!preferredAi) {
-		// Search for IPv4 addrinfo.
-		it = ai;
-		while (it) {
-			if (it->ai_family == AF_INET)
-				break;
-			if ((it->ai_family == AF_INET6) && (it->ai_flags & AI_V4MAPPED))
-				break;
-			it = it->ai_next;
-		}
-		preferredAi = it;
-	}
-	if (!preferredAi) {
-		// Search for IPv6 addrinfo.
-		it = ai;
-		while (it) {
-			if (it->ai_family == AF_INET6)
-				break;
-			it = it->ai_next;
-		}
-		preferredAi = it;
-	}
-	return preferredAi;
-}
-
 bool IceAgent::iceParamsFoundInRemoteMediaDescription (const SalMediaDescription *md) {
 	if ((md->ice_pwd[0] != '\0') && (md->ice_ufrag[0] != '\0'))
 		return true;
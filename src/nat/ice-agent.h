@@ -31,6 +31,7 @@ L_DECL_C_STRUCT_PREFIX_LESS(SalMediaDescription);
 L_DECL_C_STRUCT_PREFIX_LESS(SalStreamDescription);
 L_DECL_C_STRUCT(LinphoneCallStats);
 L_DECL_C_STRUCT(LinphoneCore);
+L_DECL_C_STRUCT(LinphoneNatPolicy);
 L_DECL_C_STRUCT(MediaStream);
 
 class MediaSession;
@@ -74,13 +75,14 @@ public:
 
 private:
 	void addLocalIceCandidates (int family, const char *addr, IceCheckList *audioCl, IceCheckList *videoCl, IceCheckList *textCl);
+	void addCachedReflexiveCandidates (LinphoneNatPolicy *natPolicy, IceCheckList *cl);
 	bool checkForIceRestartAndSetRemoteCredentials (const SalMediaDescription *md, bool isOffer);
 	void clearUnusedIceCandidates (const SalMediaDescription *localDesc, const SalMediaDescription *remoteDesc);
 	void createIceCheckListsAndParseIceAttributes (const SalMediaDescription *md, bool iceRestarted);
 	int gatherIceCandidates ();
 	void getIceDefaultAddrAndPort (uint16_t componentID, const SalMediaDescription *md, const SalStreamDescription *stream, const char **addr, int *port);
-	const struct addrinfo *getIcePreferredStunServerAddrinfo (const struct addrinfo *ai);
 	bool iceParamsFoundInRemoteMediaDescription (const SalMediaDescription *md);
+	void recordReflexiveAddresses (LinphoneNatPolicy *natPolicy, IceCheckList *cl);
 	void updateIceStateInCallStatsForStream (LinphoneCallStats *stats, IceCheckList *cl);
 
 private:
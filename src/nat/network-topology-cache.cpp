@@ -0,0 +1,234 @@
+/*
+ * network-topology-cache.cpp
+ * Copyright (C) 2010-2018 Belledonne Communications SARL
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "private.h"
+
+#include "logger/logger.h"
+#include "nat/stun-client.h"
+
+#include "network-topology-cache.h"
+
+// =============================================================================
+
+using namespace std;
+
+LINPHONE_BEGIN_NAMESPACE
+
+namespace {
+	constexpr int DefaultRefreshPeriod = 60;
+}
+
+NetworkTopologyCache::NetworkTopologyCache (const shared_ptr<Core> &core) : CoreAccessor(core) {}
+
+NetworkTopologyCache::~NetworkTopologyCache () {
+	stop();
+}
+
+// -----------------------------------------------------------------------------
+
+void NetworkTopologyCache::start () {
+	LinphoneCore *lc = getCore()->getCCore();
+	int period = lp_config_get_int(lc->config, "net", "network_topology_refresh_period", DefaultRefreshPeriod);
+	if ((period > 0) && !refreshTimer)
+		refreshTimer = lc->sal->createTimer(onRefreshTimer, this, static_cast<unsigned int>(period) * 1000, "network topology refresh");
+	// Warm the cache up right now so that the first call does not pay for it.
+	refresh();
+}
+
+void NetworkTopologyCache::stop () {
+	if (!refreshTimer)
+		return;
+	LinphoneCore *lc = getCore()->getCCore();
+	if (lc->sal)
+		lc->sal->cancelTimer(refreshTimer);
+	belle_sip_object_unref(refreshTimer);
+	refreshTimer = nullptr;
+}
+
+// -----------------------------------------------------------------------------
+
+void NetworkTopologyCache::invalidate () {
+	lInfo() << "Network topology cache invalidated";
+	localIpv4.valid = false;
+	localIpv6.valid = false;
+	stunServers.clear();
+	reflexiveAddresses.clear();
+	StunClient::clearNetworkCache();
+}
+
+void NetworkTopologyCache::refresh () {
+	LinphoneCore *lc = getCore()->getCCore();
+	if (!linphone_core_is_network_reachable(lc))
+		return;
+	refreshLocalAddress(AF_INET);
+	if (linphone_core_ipv6_enabled(lc))
+		refreshLocalAddress(AF_INET6);
+	// The resolution is asynchronous, the nat policies keep the results.
+	linphone_core_resolve_stun_server(lc);
+}
+
+// -----------------------------------------------------------------------------
+
+bool NetworkTopologyCache::getLocalAddress (int family, string &address) {
+	LocalAddress &entry = getLocalAddressEntry(family);
+	if (!entry.valid)
+		refreshLocalAddress(family);
+	if (entry.available)
+		address = entry.address;
+	return entry.available;
+}
+
+bool NetworkTopologyCache::isLocalAddressCached (int family) const {
+	return family == AF_INET6 ? localIpv6.valid : localIpv4.valid;
+}
+
+void NetworkTopologyCache::refreshLocalAddress (int family) {
+	LocalAddress &entry = getLocalAddressEntry(family);
+	char address[LINPHONE_IPADDR_SIZE] = { 0 };
+	entry.available = (linphone_core_get_local_ip_for(family, nullptr, address) == 0);
+	entry.address = address;
+	entry.valid = true;
+}
+
+// -----------------------------------------------------------------------------
+
+bool NetworkTopologyCache::getStunServerAddress (LinphoneNatPolicy *policy, struct sockaddr_storage &address, socklen_t &addressLen) {
+	string key = getStunServerKey(policy);
+	const struct addrinfo *ai = nullptr;
+	if (policy->resolver_results)
+		ai = belle_sip_resolver_results_get_addrinfos(policy->resolver_results);
+	else {
+		auto it = stunServers.find(key);
+		if (it != stunServers.end()) {
+			// Use the last known address while a fresh resolution is running in the background.
+			linphone_nat_policy_resolve_stun_server(policy);
+			memcpy(&address, &it->second.address, sizeof(address));
+			addressLen = it->second.addressLen;
+			return true;
+		}
+		ai = linphone_nat_policy_get_stun_server_addrinfo(policy);
+	}
+	if (ai)
+		ai = getPreferredStunServerAddrinfo(ai);
+	if (!ai)
+		return false;
+
+	ServerAddress &entry = stunServers[key];
+	memset(&entry.address, 0, sizeof(entry.address));
+	memcpy(&entry.address, ai->ai_addr, static_cast<size_t>(ai->ai_addrlen));
+	entry.addressLen = static_cast<socklen_t>(ai->ai_addrlen);
+	memcpy(&address, &entry.address, sizeof(address));
+	addressLen = entry.addressLen;
+	return true;
+}
+
+bool NetworkTopologyCache::isStunServerAddressCached (LinphoneNatPolicy *policy) const {
+	return stunServers.find(getStunServerKey(policy)) != stunServers.end();
+}
+
+string NetworkTopologyCache::getStunServerKey (LinphoneNatPolicy *policy) {
+	return string(linphone_nat_policy_turn_enabled(policy) ? "turn|" : "stun|")
+		+ L_C_TO_STRING(linphone_nat_policy_get_stun_server(policy));
+}
+
+/**
+ * Choose the preferred IP address to use to contact the STUN server from the list of IP addresses
+ * the DNS resolution returned. If a NAT64 address is present, use it, otherwise if an IPv4 address
+ * is present, use it, otherwise use an IPv6 address if it is present.
+ */
+const struct addrinfo *NetworkTopologyCache::getPreferredStunServerAddrinfo (const struct addrinfo *ai) {
+	// Search for NAT64 addrinfo.
+	const struct addrinfo *it = ai;
+	while (it) {
+		if (it->ai_family == AF_INET6) {
+			struct sockaddr_storage ss;
+			socklen_t sslen = sizeof(ss);
+			memset(&ss, 0, sizeof(ss));
+			bctbx_sockaddr_remove_nat64_mapping(it->ai_addr, (struct sockaddr *)&ss, &sslen);
+			if (ss.ss_family == AF_INET) break;
+		}
+		it = it->ai_next;
+	}
+	const struct addrinfo *preferredAi = it;
+	if (!preferredAi) {
+		// Search for IPv4 addrinfo.
+		it = ai;
+		while (it) {
+			if (it->ai_family == AF_INET)
+				break;
+			if ((it->ai_family == AF_INET6) && (it->ai_flags & AI_V4MAPPED))
+				break;
+			it = it->ai_next;
+		}
+		preferredAi = it;
+	}
+	if (!preferredAi) {
+		// Search for IPv6 addrinfo.
+		it = ai;
+		while (it) {
+			if (it->ai_family == AF_INET6)
+				break;
+			it = it->ai_next;
+		}
+		preferredAi = it;
+	}
+	return preferredAi;
+}
+
+// -----------------------------------------------------------------------------
+
+void NetworkTopologyCache::setReflexiveAddress (
+	LinphoneNatPolicy *policy,
+	const string &localAddress,
+	int localPort,
+	const string &reflexiveAddress,
+	int reflexivePort
+) {
+	ReflexiveAddress &entry = reflexiveAddresses[getReflexiveAddressKey(policy, localAddress, localPort)];
+	entry.address = reflexiveAddress;
+	entry.port = reflexivePort;
+}
+
+bool NetworkTopologyCache::getReflexiveAddress (
+	LinphoneNatPolicy *policy,
+	const string &localAddress,
+	int localPort,
+	string &reflexiveAddress,
+	int &reflexivePort
+) const {
+	auto it = reflexiveAddresses.find(getReflexiveAddressKey(policy, localAddress, localPort));
+	if (it == reflexiveAddresses.end())
+		return false;
+	reflexiveAddress = it->second.address;
+	reflexivePort = it->second.port;
+	return true;
+}
+
+string NetworkTopologyCache::getReflexiveAddressKey (LinphoneNatPolicy *policy, const string &localAddress, int localPort) {
+	return getStunServerKey(policy) + "|" + localAddress + "|" + Utils::toString(localPort);
+}
+
+// -----------------------------------------------------------------------------
+
+int NetworkTopologyCache::onRefreshTimer (void *data, unsigned int revents) {
+	static_cast<NetworkTopologyCache *>(data)->refresh();
+	return BELLE_SIP_CONTINUE;
+}
+
+LINPHONE_END_NAMESPACE
@@ -0,0 +1,121 @@
+/*
+ * network-topology-cache.h
+ * Copyright (C) 2010-2018 Belledonne Communications SARL
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _L_NETWORK_TOPOLOGY_CACHE_H_
+#define _L_NETWORK_TOPOLOGY_CACHE_H_
+
+#include <string>
+#include <unordered_map>
+
+#include <belle-sip/mainloop.h>
+#include <ortp/port.h>
+
+#include "core/core-accessor.h"
+
+#include "linphone/utils/general.h"
+
+// =============================================================================
+
+L_DECL_C_STRUCT(LinphoneNatPolicy);
+
+LINPHONE_BEGIN_NAMESPACE
+
+/*
+ * Keeps what the core knows about the network it is attached to: the local interface addresses, the preferred
+ * address of each STUN/TURN server and the last server-reflexive mapping seen through them for each local transport
+ * address.
+ * It is invalidated on network reachability changes and refreshed periodically from the core main loop so that
+ * ICE gathering for a new call does not have to discover all of it again.
+ */
+class NetworkTopologyCache : public CoreAccessor {
+public:
+	NetworkTopologyCache (const std::shared_ptr<Core> &core);
+	~NetworkTopologyCache ();
+
+	void start ();
+	void stop ();
+
+	void invalidate ();
+	void refresh ();
+
+	// Returns false if the host has no usable address for this family.
+	bool getLocalAddress (int family, std::string &address);
+	// Fills the preferred address to contact the STUN/TURN server of the policy, returns false if it is not known yet.
+	bool getStunServerAddress (LinphoneNatPolicy *policy, struct sockaddr_storage &address, socklen_t &addressLen);
+
+	void setReflexiveAddress (
+		LinphoneNatPolicy *policy,
+		const std::string &localAddress,
+		int localPort,
+		const std::string &reflexiveAddress,
+		int reflexivePort
+	);
+	// Returns false if no mapping was seen for this local transport address since the last invalidation.
+	bool getReflexiveAddress (
+		LinphoneNatPolicy *policy,
+		const std::string &localAddress,
+		int localPort,
+		std::string &reflexiveAddress,
+		int &reflexivePort
+	) const;
+
+	bool isLocalAddressCached (int family) const;
+	bool isStunServerAddressCached (LinphoneNatPolicy *policy) const;
+	size_t getReflexiveAddressCount () const {
+		return reflexiveAddresses.size();
+	}
+
+	static const struct addrinfo *getPreferredStunServerAddrinfo (const struct addrinfo *ai);
+
+private:
+	struct LocalAddress {
+		std::string address;
+		bool available = false;
+		bool valid = false;
+	};
+
+	struct ServerAddress {
+		struct sockaddr_storage address;
+		socklen_t addressLen = 0;
+	};
+
+	struct ReflexiveAddress {
+		std::string address;
+		int port = 0;
+	};
+
+	LocalAddress &getLocalAddressEntry (int family) {
+		return family == AF_INET6 ? localIpv6 : localIpv4;
+	}
+
+	void refreshLocalAddress (int family);
+	static std::string getStunServerKey (LinphoneNatPolicy *policy);
+	static std::string getReflexiveAddressKey (LinphoneNatPolicy *policy, const std::string &localAddress, int localPort);
+	static int onRefreshTimer (void *data, unsigned int revents);
+
+	LocalAddress localIpv4;
+	LocalAddress localIpv6;
+	std::unordered_map<std::string, ServerAddress> stunServers;
+	std::unordered_map<std::string, ReflexiveAddress> reflexiveAddresses;
+	belle_sip_source_t *refreshTimer = nullptr;
+};
+
+LINPHONE_END_NAMESPACE
+
+#endif // ifndef _L_NETWORK_TOPOLOGY_CACHE_H_
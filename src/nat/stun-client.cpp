@@ -17,6 +17,9 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
+#include <mutex>
+#include <unordered_map>
+
 #include "private.h"
 
 #include "logger/logger.h"
@@ -29,119 +32,262 @@ using namespace std;
 
 LINPHONE_BEGIN_NAMESPACE
 
-int StunClient::run (int audioPort, int videoPort, int textPort) {
+namespace {
+	// What was learnt about a network, identified by the STUN server and the local address used to reach it.
+	struct NetworkInfo {
+		StunClient::NatType natType;
+		int rtt;
+	};
+
+	mutex networkCacheMutex;
+	unordered_map<string, NetworkInfo> networkCache;
+
+	// RFC 5389 section 7.2.1 default values.
+	constexpr unsigned int DefaultRto = 500;
+	constexpr int DefaultMaxTransmissions = 7;
+	constexpr unsigned int LastTransmissionTimeoutFactor = 16;
+	constexpr unsigned int MinRto = 100;
+
+	bool transactionIdEqual (const UInt96 &a, const UInt96 &b) {
+		return memcmp(a.octet, b.octet, sizeof(a.octet)) == 0;
+	}
+
+	UInt96 generateTransactionId (int id) {
+		MSStunMessage *req = ms_stun_binding_request_create();
+		UInt96 trId = ms_stun_message_get_tr_id(req);
+		trId.octet[0] = static_cast<unsigned char>(id);
+		ms_free(req);
+		return trId;
+	}
+}
+
+StunClient::~StunClient () {
+	cancel();
+}
+
+int StunClient::runAsync (int audioPort, int videoPort, int textPort, const DiscoveryCallback &callback) {
+	LinphoneCore *lc = getCore()->getCCore();
+	cancel();
 	stunDiscoveryDone = false;
-	if (linphone_core_ipv6_enabled(getCore()->getCCore())) {
+	if (linphone_core_ipv6_enabled(lc)) {
 		lWarning() << "STUN support is not implemented for ipv6";
 		return -1;
 	}
-	if (!linphone_core_get_stun_server(getCore()->getCCore()))
+	if (!linphone_core_get_stun_server(lc))
 		return -1;
-	const struct addrinfo *ai = linphone_core_get_stun_server_addrinfo(getCore()->getCCore());
+	const struct addrinfo *ai = linphone_core_get_stun_server_addrinfo(lc);
 	if (!ai) {
 		lError() << "Could not obtain STUN server addrinfo";
 		return -1;
 	}
+	memcpy(&serverAddr, ai->ai_addr, (size_t)ai->ai_addrlen);
+	serverAddrLen = (socklen_t)ai->ai_addrlen;
 
-	/* Create the RTP sockets and send STUN messages to the STUN server */
-	ortp_socket_t sockAudio = createStunSocket(audioPort);
-	if (sockAudio == -1)
+	/* Create the RTP sockets that will send STUN messages to the STUN server */
+	nbTransactions = 0;
+	if (!startTransaction(transactions[nbTransactions++], "audio", audioCandidate, audioPort, 1)) {
+		stopTransactions();
 		return -1;
-	ortp_socket_t sockVideo = -1;
-	if (linphone_core_video_enabled(getCore()->getCCore())) {
-		sockVideo = createStunSocket(videoPort);
-		if (sockVideo == -1)
-			return -1;
 	}
-	ortp_socket_t sockText = -1;
-	if (linphone_core_realtime_text_enabled(getCore()->getCCore())) {
-		sockText = createStunSocket(textPort);
-		if (sockText == -1)
-			return -1;
+	if (linphone_core_video_enabled(lc) && !startTransaction(transactions[nbTransactions++], "video", videoCandidate, videoPort, 2)) {
+		stopTransactions();
+		return -1;
+	}
+	if (linphone_core_realtime_text_enabled(lc) && !startTransaction(transactions[nbTransactions++], "text", textCandidate, textPort, 3)) {
+		stopTransactions();
+		return -1;
 	}
 
-	int ret = 0;
-	int loops = 0;
-	bool gotAudio = false;
-	bool gotVideo = false;
-	bool gotText = false;
-	bool coneAudio = false;
-	bool coneVideo = false;
-	bool coneText = false;
-	double elapsed;
-	struct timeval init;
-	ortp_gettimeofday(&init, nullptr);
-
-	do {
-		int id;
-		if ((loops % 20) == 0) {
-			lInfo() << "Sending STUN requests...";
-			sendStunRequest(sockAudio, ai->ai_addr, (socklen_t)ai->ai_addrlen, 11, true);
-			sendStunRequest(sockAudio, ai->ai_addr, (socklen_t)ai->ai_addrlen, 1, false);
-			if (sockVideo != -1) {
-				sendStunRequest(sockVideo, ai->ai_addr, (socklen_t)ai->ai_addrlen, 22, true);
-				sendStunRequest(sockVideo, ai->ai_addr, (socklen_t)ai->ai_addrlen, 2, false);
-			}
-			if (sockText != -1) {
-				sendStunRequest(sockText, ai->ai_addr, (socklen_t)ai->ai_addrlen, 33, true);
-				sendStunRequest(sockText, ai->ai_addr, (socklen_t)ai->ai_addrlen, 3, false);
-			}
+	/* What is known about the current network tells whether the NAT type must be probed and how fast to retransmit */
+	char localIp[LINPHONE_IPADDR_SIZE] = { 0 };
+	linphone_core_get_local_ip(lc, AF_INET, nullptr, localIp);
+	networkKey = string(linphone_core_get_stun_server(lc)) + "|" + localIp;
+	rto = static_cast<unsigned int>(lp_config_get_int(lc->config, "net", "stun_rto", DefaultRto));
+	probeNatType = true;
+	natType = NatType::Unknown;
+	{
+		lock_guard<mutex> lock(networkCacheMutex);
+		auto it = networkCache.find(networkKey);
+		if (it != networkCache.end()) {
+			natType = it->second.natType;
+			probeNatType = (natType == NatType::Unknown);
+			if (it->second.rtt >= 0)
+				rto = max(MinRto, min(rto, static_cast<unsigned int>(2 * it->second.rtt)));
 		}
-		ms_usleep(10000);
+	}
+	maxTransmissions = lp_config_get_int(lc->config, "net", "stun_max_transmissions", DefaultMaxTransmissions);
+	timeout = lp_config_get_int(lc->config, "net", "stun_discovery_timeout", 2000);
+	initialRto = rto;
+	firstResponseRtt = -1;
+	nbTransmissions = 0;
 
-		if (recvStunResponse(sockAudio, audioCandidate, id) > 0) {
-			lInfo() << "STUN test result: local audio port maps to " << audioCandidate.address << ":" << audioCandidate.port;
-			if (id == 11) coneAudio = true;
-			gotAudio = true;
-		}
-		if (recvStunResponse(sockVideo, videoCandidate, id) > 0) {
-			lInfo() << "STUN test result: local video port maps to " << videoCandidate.address << ":" << videoCandidate.port;
-			if (id == 22) coneVideo = true;
-			gotVideo = true;
+	discoveryCallback = callback;
+	running = true;
+	startTime = bctbx_get_cur_time_ms();
+	lInfo() << "Sending STUN requests...";
+	sendRequests();
+	timer = lc->sal->createTimer(onTimeout, this, 0, "STUN discovery");
+	scheduleNextTimeout();
+	return 0;
+}
+
+void StunClient::cancel () {
+	if (!running)
+		return;
+	stopTransactions();
+	running = false;
+	discoveryCallback = nullptr;
+}
+
+bool StunClient::startTransaction (Transaction &transaction, const char *streamName, Candidate &candidate, int localPort, int id) {
+	transaction = Transaction();
+	transaction.sock = createStunSocket(localPort);
+	if (transaction.sock == -1)
+		return false;
+	transaction.client = this;
+	transaction.streamName = streamName;
+	transaction.candidate = &candidate;
+	/* Retransmissions reuse the transaction ids, the first octet tells which request a response belongs to */
+	transaction.trId = generateTransactionId(id);
+	transaction.changeAddrTrId = generateTransactionId(id * 11);
+	transaction.watcher = getCore()->getCCore()->sal->createSocketWatcher(onSocketReadable, &transaction, transaction.sock, "STUN discovery socket");
+	return true;
+}
+
+void StunClient::stopTransactions () {
+	Sal *sal = getCore()->getCCore()->sal;
+	if (timer) {
+		sal->cancelTimer(timer);
+		belle_sip_object_unref(timer);
+		timer = nullptr;
+	}
+	for (int i = 0; i < nbTransactions; i++) {
+		Transaction &transaction = transactions[i];
+		if (transaction.watcher) {
+			sal->cancelTimer(transaction.watcher);
+			belle_sip_object_unref(transaction.watcher);
+			transaction.watcher = nullptr;
 		}
-		if (recvStunResponse(sockText, textCandidate, id) > 0) {
-			lInfo() << "STUN test result: local text port maps to " << textCandidate.address << ":" << textCandidate.port;
-			if (id == 33) coneText = true;
-			gotText = true;
+		if (transaction.sock != -1) {
+			close_socket(transaction.sock);
+			transaction.sock = -1;
 		}
-		struct timeval cur;
-		ortp_gettimeofday(&cur, nullptr);
-		elapsed = static_cast<double>(cur.tv_sec - init.tv_sec) * 1000 + static_cast<double>(cur.tv_usec - init.tv_usec) / 1000;
-		if (elapsed > 2000.) {
-			lInfo() << "STUN responses timeout, going ahead";
-			ret = -1;
-			break;
+	}
+	nbTransactions = 0;
+}
+
+void StunClient::sendRequests () {
+	const struct sockaddr *server = reinterpret_cast<const struct sockaddr *>(&serverAddr);
+	for (int i = 0; i < nbTransactions; i++) {
+		Transaction &transaction = transactions[i];
+		if (transaction.gotResponse)
+			continue;
+		if (probeNatType)
+			sendStunRequest(transaction.sock, server, serverAddrLen, transaction.changeAddrTrId, true);
+		sendStunRequest(transaction.sock, server, serverAddrLen, transaction.trId, false);
+	}
+	nbTransmissions++;
+}
+
+/*
+ * Retransmissions follow RFC 5389: the interval starts at RTO and doubles after each transmission, and after the last
+ * one a response is waited for 16 * RTO. This is bounded by the overall discovery timeout so that a call never waits
+ * more than that before going ahead.
+ */
+void StunClient::scheduleNextTimeout () {
+	uint64_t now = bctbx_get_cur_time_ms();
+	uint64_t deadline = startTime + static_cast<uint64_t>(timeout);
+	uint64_t next;
+	if (nbTransmissions < maxTransmissions) {
+		next = now + rto;
+		rto *= 2;
+	} else
+		next = now + static_cast<uint64_t>(LastTransmissionTimeoutFactor * initialRto);
+	nextTransmissionTime = next;
+	if (next > deadline)
+		next = deadline;
+	belle_sip_source_set_timeout(timer, static_cast<unsigned int>(next > now ? next - now : 0));
+}
+
+int StunClient::onTimeout (void *userData, unsigned int events) {
+	StunClient *client = static_cast<StunClient *>(userData);
+	uint64_t now = bctbx_get_cur_time_ms();
+	if ((now >= client->startTime + static_cast<uint64_t>(client->timeout)) || (now >= client->nextTransmissionTime && client->nbTransmissions >= client->maxTransmissions)) {
+		lInfo() << "STUN responses timeout, going ahead";
+		client->finish(-1);
+		return BELLE_SIP_STOP;
+	}
+	if (now >= client->nextTransmissionTime) {
+		lInfo() << "Retransmitting STUN requests...";
+		client->sendRequests();
+	}
+	client->scheduleNextTimeout();
+	return BELLE_SIP_CONTINUE;
+}
+
+int StunClient::onSocketReadable (void *userData, unsigned int events) {
+	Transaction *transaction = static_cast<Transaction *>(userData);
+	StunClient *client = transaction->client;
+	client->processResponses(*transaction);
+	return client->running ? BELLE_SIP_CONTINUE : BELLE_SIP_STOP;
+}
+
+void StunClient::processResponses (Transaction &transaction) {
+	UInt96 trId;
+	while (running && (recvStunResponse(transaction.sock, *transaction.candidate, trId) > 0)) {
+		bool isChangeAddrResponse = transactionIdEqual(trId, transaction.changeAddrTrId);
+		if (!isChangeAddrResponse && !transactionIdEqual(trId, transaction.trId))
+			continue; /* Not for us, or a late response to a previous discovery */
+		if (!transaction.gotResponse) {
+			lInfo() << "STUN test result: local " << transaction.streamName << " port maps to "
+				<< transaction.candidate->address << ":" << transaction.candidate->port;
+			if ((firstResponseRtt < 0) && (nbTransmissions == 1))
+				firstResponseRtt = static_cast<int>(bctbx_get_cur_time_ms() - startTime);
 		}
-		loops++;
-	} while (!(gotAudio && (gotVideo || sockVideo == -1) && (gotText || sockText == -1)));
-
-	if (ret == 0)
-		ret = (int)elapsed;
-
-	if (!gotAudio)
-		lError() << "No STUN server response for audio port";
-	else if (!coneAudio)
-		lInfo() << "NAT is symmetric for audio port";
-
-	if (sockVideo != -1) {
-		if (!gotVideo)
-			lError() << "No STUN server response for video port";
-		else if (!coneVideo)
-			lInfo() << "NAT is symmetric for video port";
+		transaction.gotResponse = true;
+		if (isChangeAddrResponse)
+			transaction.cone = true;
+	}
+
+	for (int i = 0; i < nbTransactions; i++) {
+		if (!transactions[i].gotResponse)
+			return;
+	}
+	if (running)
+		finish(static_cast<int>(bctbx_get_cur_time_ms() - startTime));
+}
+
+void StunClient::finish (int result) {
+	for (int i = 0; i < nbTransactions; i++) {
+		const Transaction &transaction = transactions[i];
+		if (!transaction.gotResponse)
+			lError() << "No STUN server response for " << transaction.streamName << " port";
+		else if (probeNatType && !transaction.cone)
+			lInfo() << "NAT is symmetric for " << transaction.streamName << " port";
 	}
 
-	if (sockText != -1) {
-		if (!gotText)
-			lError() << "No STUN server response for text port";
-		else if (!coneText)
-			lInfo() << "NAT is symmetric for text port";
+	/* The NAT type is the one seen on the audio port */
+	if (nbTransactions > 0 && transactions[0].gotResponse) {
+		if (probeNatType)
+			natType = transactions[0].cone ? NatType::Cone : NatType::Symmetric;
+		lock_guard<mutex> lock(networkCacheMutex);
+		NetworkInfo &info = networkCache[networkKey];
+		info.natType = natType;
+		info.rtt = firstResponseRtt;
 	}
 
-	close_socket(sockAudio);
-	if (sockVideo != -1) close_socket(sockVideo);
-	if (sockText != -1) close_socket(sockText);
+	stopTransactions();
+	running = false;
 	stunDiscoveryDone = true;
-	return ret;
+	DiscoveryCallback callback = discoveryCallback;
+	discoveryCallback = nullptr;
+	if (callback)
+		callback(result);
+}
+
+void StunClient::clearNetworkCache () {
+	lock_guard<mutex> lock(networkCacheMutex);
+	networkCache.clear();
 }
 
 void StunClient::updateMediaDescription (SalMediaDescription *md) const {
@@ -200,7 +346,7 @@ ortp_socket_t StunClient::createStunSocket (int localPort) {
 	return sock;
 }
 
-int StunClient::recvStunResponse (ortp_socket_t sock, Candidate &candidate, int &id) {
+int StunClient::recvStunResponse (ortp_socket_t sock, Candidate &candidate, UInt96 &trId) {
 	char buf[MS_STUN_MAX_MESSAGE_SIZE];
 	int len = MS_STUN_MAX_MESSAGE_SIZE;
 
@@ -209,8 +355,7 @@ int StunClient::recvStunResponse (ortp_socket_t sock, Candidate &candidate, int
 		struct in_addr ia;
 		MSStunMessage *resp = ms_stun_message_create_from_buffer_parsing((uint8_t *)buf, (ssize_t)len);
 		if (resp) {
-			UInt96 trId = ms_stun_message_get_tr_id(resp);
-			id = trId.octet[0];
+			trId = ms_stun_message_get_tr_id(resp);
 			const MSStunAddress *stunAddr = ms_stun_message_get_xor_mapped_address(resp);
 			if (stunAddr) {
 				candidate.port = stunAddr->ip.v4.port;
@@ -225,7 +370,9 @@ int StunClient::recvStunResponse (ortp_socket_t sock, Candidate &candidate, int
 			}
 			if (len > 0)
 				candidate.address = inet_ntoa(ia);
-		}
+			ms_stun_message_destroy(resp);
+		} else
+			len = -1;
 	}
 	return len;
 }
@@ -234,12 +381,10 @@ int StunClient::sendStunRequest (
 	ortp_socket_t sock,
 	const struct sockaddr *server,
 	socklen_t addrlen,
-	int id,
+	const UInt96 &trId,
 	bool changeAddr
 ) {
 	MSStunMessage *req = ms_stun_binding_request_create();
-	UInt96 trId = ms_stun_message_get_tr_id(req);
-	trId.octet[0] = static_cast<unsigned char>(id);
 	ms_stun_message_set_tr_id(req, trId);
 	ms_stun_message_enable_change_ip(req, changeAddr);
 	ms_stun_message_enable_change_port(req, changeAddr);
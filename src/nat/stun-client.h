@@ -20,8 +20,11 @@
 #ifndef _L_STUN_CLIENT_H_
 #define _L_STUN_CLIENT_H_
 
+#include <functional>
 #include <string>
 
+#include <belle-sip/mainloop.h>
+#include <mediastreamer2/stun.h>
 #include <ortp/port.h>
 
 #include "core/core.h"
@@ -42,11 +45,31 @@ class StunClient : public CoreAccessor {
 	};
 
 public:
+	enum class NatType {
+		Unknown,
+		Cone,
+		Symmetric
+	};
+
+	// Called with the time it took to get all the responses in milliseconds, or -1 if the discovery failed.
+	using DiscoveryCallback = std::function<void (int pingTime)>;
+
 	StunClient (const std::shared_ptr<Core> &core) : CoreAccessor(core) {}
+	~StunClient ();
 
-	int run (int audioPort, int videoPort, int textPort);
+	// Returns 0 if the discovery has been started, the callback is then called from the core main loop.
+	int runAsync (int audioPort, int videoPort, int textPort, const DiscoveryCallback &callback);
+	void cancel ();
 	void updateMediaDescription (SalMediaDescription *md) const;
 
+	bool isRunning () const {
+		return running;
+	}
+
+	NatType getNatType () const {
+		return natType;
+	}
+
 	const Candidate &getAudioCandidate () const {
 		return audioCandidate;
 	}
@@ -60,14 +83,58 @@ public:
 	}
 
 	ortp_socket_t createStunSocket (int localPort);
-	int recvStunResponse (ortp_socket_t sock, Candidate &candidate, int &id);
-	int sendStunRequest (ortp_socket_t sock, const struct sockaddr *server, socklen_t addrlen, int id, bool changeAddr);
+	int recvStunResponse (ortp_socket_t sock, Candidate &candidate, UInt96 &trId);
+	int sendStunRequest (ortp_socket_t sock, const struct sockaddr *server, socklen_t addrlen, const UInt96 &trId, bool changeAddr);
+
+	// Forgets the NAT types and round trip times learnt on the previously used networks.
+	static void clearNetworkCache ();
 
 private:
+	struct Transaction {
+		StunClient *client = nullptr;
+		const char *streamName = nullptr;
+		Candidate *candidate = nullptr;
+		ortp_socket_t sock = -1;
+		belle_sip_source_t *watcher = nullptr;
+		UInt96 trId;
+		UInt96 changeAddrTrId;
+		bool gotResponse = false;
+		bool cone = false;
+	};
+
+	bool startTransaction (Transaction &transaction, const char *streamName, Candidate &candidate, int localPort, int id);
+	void sendRequests ();
+	void processResponses (Transaction &transaction);
+	void scheduleNextTimeout ();
+	void finish (int result);
+	void stopTransactions ();
+
+	static int onSocketReadable (void *userData, unsigned int events);
+	static int onTimeout (void *userData, unsigned int events);
+
 	Candidate audioCandidate;
 	Candidate videoCandidate;
 	Candidate textCandidate;
 	bool stunDiscoveryDone = false;
+
+	Transaction transactions[3];
+	int nbTransactions = 0;
+	struct sockaddr_storage serverAddr;
+	socklen_t serverAddrLen = 0;
+	belle_sip_source_t *timer = nullptr;
+	DiscoveryCallback discoveryCallback;
+	std::string networkKey;
+	uint64_t startTime = 0;
+	uint64_t nextTransmissionTime = 0;
+	unsigned int rto = 0;
+	unsigned int initialRto = 0;
+	int nbTransmissions = 0;
+	int maxTransmissions = 0;
+	int timeout = 0;
+	int firstResponseRtt = -1;
+	bool probeNatType = true;
+	bool running = false;
+	NatType natType = NatType::Unknown;
 };
 
 LINPHONE_END_NAMESPACE
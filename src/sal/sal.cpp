@@ -30,6 +30,7 @@
 #include "private.h"
 
 #include "c-wrapper/internal/c-tools.h"
+#include "logger/metrics.h"
 
 using namespace std;
 
@@ -58,6 +59,8 @@ void Sal::processIoErrorCb (void *userCtx, const belle_sip_io_error_event_t *eve
 }
 
 void Sal::processRequestEventCb (void *userCtx, const belle_sip_request_event_t *event) {
+	L_METRIC_TIME_SCOPE("sal.request");
+	L_METRIC_COUNTER_INCREMENT("sal.requests.received");
 	auto sal = static_cast<Sal *>(userCtx);
 	SalOp *op = nullptr;
 	belle_sip_header_t *evh = nullptr;
@@ -250,6 +253,8 @@ void Sal::processRequestEventCb (void *userCtx, const belle_sip_request_event_t
 }
 
 void Sal::processResponseEventCb (void *userCtx, const belle_sip_response_event_t *event) {
+	L_METRIC_TIME_SCOPE("sal.response");
+	L_METRIC_COUNTER_INCREMENT("sal.responses.received");
 	auto response = belle_sip_response_event_get_response(event);
 	int responseCode = belle_sip_response_get_status_code(response);
 
@@ -796,6 +801,14 @@ belle_sip_source_t *Sal::createTimer (belle_sip_source_func_t func, void *data,
 	return belle_sip_main_loop_create_timeout(ml, func, data, timeoutValueMs, L_STRING_TO_C(timerName));
 }
 
+belle_sip_source_t *Sal::createSocketWatcher (belle_sip_source_func_t func, void *data, belle_sip_socket_t fd, const string &name) {
+	belle_sip_main_loop_t *ml = belle_sip_stack_get_main_loop(mStack);
+	belle_sip_source_t *source = belle_sip_socket_source_new(func, data, fd, BELLE_SIP_EVENT_READ, (unsigned int)-1);
+	belle_sip_object_set_name(BELLE_SIP_OBJECT(source), L_STRING_TO_C(name));
+	belle_sip_main_loop_add_source(ml, source);
+	return source;
+}
+
 void Sal::cancelTimer(belle_sip_source_t *timer) {
 	belle_sip_main_loop_t *ml = belle_sip_stack_get_main_loop(mStack);
 	belle_sip_main_loop_remove_source(ml, timer);
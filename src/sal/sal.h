@@ -248,6 +248,8 @@ public:
 	// ---------------------------------------------------------------------------
 	belle_sip_source_t *createTimer (belle_sip_source_func_t func, void *data, unsigned int timeoutValueMs, const std::string &timerName);
 	void cancelTimer (belle_sip_source_t *timer);
+	// Calls func whenever fd becomes readable, cancel it with cancelTimer().
+	belle_sip_source_t *createSocketWatcher (belle_sip_source_func_t func, void *data, belle_sip_socket_t fd, const std::string &name);
 
 	//utils
 	static int findCryptoIndexFromTag (const SalSrtpCryptoAlgo crypto[], unsigned char tag);
@@ -27,6 +27,7 @@
 #include "linphone/core.h"
 #include "linphone/types.h"
 #include "logger/logger.h"
+#include "logger/metrics.h"
 #include "private.h"
 
 using namespace std;
@@ -130,6 +131,7 @@ static string getDisplayNameFromSearchResult (const SearchResult &sr) {
 }
 
 list<SearchResult> MagicSearch::getContactListFromFilter (const string &filter, const string &withDomain) const {
+	L_METRIC_TIME_SCOPE("magic_search.query");
 	list<SearchResult> *resultList;
 	list<SearchResult> returnList;
 	LinphoneProxyConfig *proxy = nullptr;
@@ -0,0 +1,226 @@
+/*
+ * base64.cpp
+ * Copyright (C) 2010-2018 Belledonne Communications SARL
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#define L_BASE64_SSSE3
+	#include <tmmintrin.h>
+#endif
+
+#include "base64.h"
+
+// =============================================================================
+
+using namespace std;
+
+LINPHONE_BEGIN_NAMESPACE
+
+namespace {
+	const char EncodeTable[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+	constexpr int8_t InvalidChar = -1;
+	constexpr int8_t WhitespaceChar = -2;
+	constexpr int8_t PaddingChar = -3;
+
+	struct DecodeTable {
+		int8_t values[256];
+
+		DecodeTable () {
+			for (int8_t &value : values)
+				value = InvalidChar;
+			for (int8_t i = 0; i < 64; i++)
+				values[static_cast<uint8_t>(EncodeTable[i])] = i;
+			values[static_cast<uint8_t>(' ')] = values[static_cast<uint8_t>('\t')] = WhitespaceChar;
+			values[static_cast<uint8_t>('\r')] = values[static_cast<uint8_t>('\n')] = WhitespaceChar;
+			values[static_cast<uint8_t>('=')] = PaddingChar;
+		}
+	};
+
+	const DecodeTable decodeTable;
+
+	void encodeScalar (const uint8_t *data, size_t size, char *output) {
+		size_t i = 0;
+		for (; i + 3 <= size; i += 3) {
+			uint32_t value = (uint32_t(data[i]) << 16) | (uint32_t(data[i + 1]) << 8) | data[i + 2];
+			*output++ = EncodeTable[(value >> 18) & 0x3f];
+			*output++ = EncodeTable[(value >> 12) & 0x3f];
+			*output++ = EncodeTable[(value >> 6) & 0x3f];
+			*output++ = EncodeTable[value & 0x3f];
+		}
+		if (i < size) {
+			uint32_t value = uint32_t(data[i]) << 16;
+			if (i + 1 < size)
+				value |= uint32_t(data[i + 1]) << 8;
+			*output++ = EncodeTable[(value >> 18) & 0x3f];
+			*output++ = EncodeTable[(value >> 12) & 0x3f];
+			*output++ = (i + 1 < size) ? EncodeTable[(value >> 6) & 0x3f] : '=';
+			*output++ = '=';
+		}
+	}
+
+	// Appends to the output from offset outputSize, which is resized to the decoded data.
+	bool decodeScalar (const char *input, size_t size, vector<uint8_t> &output, size_t outputSize) {
+		uint32_t accumulator = 0;
+		int bits = 0;
+		size_t count = 0;
+		bool padding = false;
+		for (size_t i = 0; i < size; i++) {
+			int8_t value = decodeTable.values[static_cast<uint8_t>(input[i])];
+			if (value == WhitespaceChar)
+				continue;
+			if (value == PaddingChar) {
+				padding = true;
+				continue;
+			}
+			if (value == InvalidChar || padding)
+				return false;
+
+			accumulator = (accumulator << 6) | uint32_t(value);
+			bits += 6;
+			count++;
+			if (bits >= 8) {
+				bits -= 8;
+				output[outputSize++] = static_cast<uint8_t>(accumulator >> bits);
+			}
+		}
+		if (count % 4 == 1)
+			return false;
+		output.resize(outputSize);
+		return true;
+	}
+
+#ifdef L_BASE64_SSSE3
+	bool hasSsse3 () {
+		static const bool supported = __builtin_cpu_supports("ssse3");
+		return supported;
+	}
+
+	// Encodes the first 12 bytes of the block into 16 characters.
+	__attribute__((target("ssse3"))) __m128i encodeBlockSsse3 (__m128i block) {
+		// Spread each 3 bytes in 4 lanes of 6 bits.
+		__m128i in = _mm_shuffle_epi8(block, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+		__m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+		__m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+		__m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+		__m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+		__m128i indices = _mm_or_si128(t1, t3);
+
+		// Offset of each range of the alphabet: A-Z, a-z, 0-9, + and /.
+		__m128i ranges = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+		__m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+		ranges = _mm_or_si128(ranges, _mm_and_si128(upper, _mm_set1_epi8(13)));
+		const __m128i offsets = _mm_setr_epi8(
+			'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+			'0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0
+		);
+		return _mm_add_epi8(_mm_shuffle_epi8(offsets, ranges), indices);
+	}
+
+	__attribute__((target("ssse3"))) size_t encodeSsse3 (const uint8_t *data, size_t size, char *output) {
+		size_t i = 0;
+		// 16 bytes are loaded for 12 used.
+		for (; size - i >= 16; i += 12, output += 16) {
+			__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(output), encodeBlockSsse3(block));
+		}
+		return i;
+	}
+
+	// Decodes 16 characters into the first 12 bytes of the output, returns false if one of them is not in the
+	// alphabet, padding and whitespace included.
+	__attribute__((target("ssse3"))) bool decodeBlockSsse3 (const char *input, uint8_t *output) {
+		__m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input));
+		__m128i higherNibbles = _mm_and_si128(_mm_srli_epi32(in, 4), _mm_set1_epi8(0x0f));
+		__m128i lowerNibbles = _mm_and_si128(in, _mm_set1_epi8(0x0f));
+
+		const __m128i lowerNibbleMasks = _mm_setr_epi8(
+			0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a
+		);
+		const __m128i higherNibbleMasks = _mm_setr_epi8(
+			0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10
+		);
+		__m128i invalid = _mm_and_si128(
+			_mm_shuffle_epi8(lowerNibbleMasks, lowerNibbles),
+			_mm_shuffle_epi8(higherNibbleMasks, higherNibbles)
+		);
+		if (_mm_movemask_epi8(_mm_cmpgt_epi8(invalid, _mm_setzero_si128())) != 0)
+			return false;
+
+		// Character to value, '/' shares its higher nibble with '+' but not its offset.
+		const __m128i offsets = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+		__m128i isSlash = _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+		__m128i values = _mm_add_epi8(in, _mm_shuffle_epi8(offsets, _mm_add_epi8(isSlash, higherNibbles)));
+
+		// Pack each 4 values of 6 bits in 3 bytes.
+		__m128i merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+		merged = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+		merged = _mm_shuffle_epi8(merged, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(output), merged);
+		return true;
+	}
+#endif
+}
+
+// -----------------------------------------------------------------------------
+
+void Base64::encode (const uint8_t *data, size_t size, char *output) {
+	size_t i = 0;
+#ifdef L_BASE64_SSSE3
+	if (hasSsse3())
+		i = encodeSsse3(data, size, output);
+#endif
+	encodeScalar(data + i, size - i, output + i / 3 * 4);
+}
+
+string Base64::encode (const vector<uint8_t> &data) {
+	string output(getEncodedSize(data.size()), '\0');
+	if (!data.empty())
+		encode(data.data(), data.size(), &output[0]);
+	return output;
+}
+
+bool Base64::decode (const char *input, size_t size, vector<uint8_t> &output) {
+	// Upper bound, adjusted once decoded.
+	output.resize(size / 4 * 3 + 3);
+
+	size_t i = 0;
+	size_t outputSize = 0;
+#ifdef L_BASE64_SSSE3
+	// The last characters may be padding, they are left to the scalar decoder. Each block writes 16 bytes for
+	// 12 decoded, there is enough room as long as 8 characters remain after it.
+	if (hasSsse3()) {
+		for (; size - i >= 24; i += 16, outputSize += 12) {
+			if (!decodeBlockSsse3(input + i, output.data() + outputSize))
+				break; // Whitespace or invalid character, handled by the scalar decoder.
+		}
+	}
+#endif
+	if (!decodeScalar(input + i, size - i, output, outputSize)) {
+		output.clear();
+		return false;
+	}
+	return true;
+}
+
+vector<uint8_t> Base64::decode (const string &input) {
+	vector<uint8_t> output;
+	decode(input.data(), input.size(), output);
+	return output;
+}
+
+LINPHONE_END_NAMESPACE
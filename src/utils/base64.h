@@ -0,0 +1,50 @@
+/*
+ * base64.h
+ * Copyright (C) 2010-2018 Belledonne Communications SARL
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _L_BASE64_H_
+#define _L_BASE64_H_
+
+#include <string>
+#include <vector>
+
+#include "linphone/utils/general.h"
+
+// =============================================================================
+
+LINPHONE_BEGIN_NAMESPACE
+
+// Standard base64 alphabet with padding. Blocks of 12 bytes are processed with SSSE3 when the CPU supports it.
+namespace Base64 {
+	inline size_t getEncodedSize (size_t size) {
+		return (size + 2) / 3 * 4;
+	}
+
+	// Writes exactly getEncodedSize(size) characters, without null terminator.
+	LINPHONE_PUBLIC void encode (const uint8_t *data, size_t size, char *output);
+	LINPHONE_PUBLIC std::string encode (const std::vector<uint8_t> &data);
+
+	// Whitespace is skipped, the padding is optional. Returns false on any other invalid character.
+	LINPHONE_PUBLIC bool decode (const char *input, size_t size, std::vector<uint8_t> &output);
+	// Empty if the input is invalid.
+	LINPHONE_PUBLIC std::vector<uint8_t> decode (const std::string &input);
+}
+
+LINPHONE_END_NAMESPACE
+
+#endif // ifndef _L_BASE64_H_
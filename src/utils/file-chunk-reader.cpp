@@ -0,0 +1,121 @@
+/*
+ * file-chunk-reader.cpp
+ * Copyright (C) 2010-2018 Belledonne Communications SARL
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <algorithm>
+
+#include "logger/logger.h"
+
+#include "file-chunk-reader.h"
+
+// =============================================================================
+
+using namespace std;
+
+LINPHONE_BEGIN_NAMESPACE
+
+FileChunkReader::FileChunkReader (const string &path, size_t chunkSize, size_t readAhead) :
+	chunkSize(chunkSize), readAhead(max(readAhead, size_t(1))) {
+	file = bctbx_file_open(bctbx_vfs_get_default(), path.c_str(), "r");
+	if (!file) {
+		lError() << "Cannot open file [" << path << "] for reading";
+		return;
+	}
+	int64_t size = bctbx_file_size(file);
+	if (size < 0) {
+		lError() << "Cannot get the size of file [" << path << "]";
+		bctbx_file_close(file);
+		file = nullptr;
+		return;
+	}
+	fileSize = static_cast<size_t>(size);
+}
+
+FileChunkReader::~FileChunkReader () {
+	stop();
+	if (file)
+		bctbx_file_close(file);
+}
+
+// -----------------------------------------------------------------------------
+
+void FileChunkReader::start (size_t offset) {
+	stop();
+
+	chunks.clear();
+	ended = false;
+	failed = !file;
+	if (failed)
+		return;
+	running = true;
+	thread = std::thread(&FileChunkReader::run, this, offset);
+}
+
+void FileChunkReader::stop () {
+	{
+		lock_guard<mutex> lock(accessMutex);
+		running = false;
+	}
+	chunksChanged.notify_all();
+	if (thread.joinable())
+		thread.join();
+}
+
+FileChunkReader::TakeResult FileChunkReader::tryTakeChunk (Chunk &chunk) {
+	lock_guard<mutex> lock(accessMutex);
+	if (chunks.empty())
+		return (failed || ended || !running) ? TakeResult::Failed : TakeResult::NotReady;
+	chunk = move(chunks.front());
+	chunks.pop_front();
+	chunksChanged.notify_all();
+	return TakeResult::Taken;
+}
+
+// -----------------------------------------------------------------------------
+
+void FileChunkReader::run (size_t offset) {
+	for (;;) {
+		Chunk chunk;
+		chunk.offset = offset;
+		size_t size = offset < fileSize ? min(chunkSize, fileSize - offset) : 0;
+		chunk.data.resize(size);
+		ssize_t read = size > 0 ? bctbx_file_read(file, chunk.data.data(), size, (off_t)offset) : 0;
+
+		unique_lock<mutex> lock(accessMutex);
+		if (!running)
+			return;
+		if (read < 0 || static_cast<size_t>(read) != size) {
+			lError() << "Cannot read " << size << " bytes at offset " << offset << " of file";
+			failed = true;
+			chunksChanged.notify_all();
+			return;
+		}
+		chunks.push_back(move(chunk));
+		chunksChanged.notify_all();
+		if (size == 0) {
+			ended = true;
+			return;
+		}
+		offset += size;
+		chunksChanged.wait(lock, [this] { return !running || chunks.size() < readAhead; });
+		if (!running)
+			return;
+	}
+}
+
+LINPHONE_END_NAMESPACE
@@ -0,0 +1,94 @@
+/*
+ * file-chunk-reader.h
+ * Copyright (C) 2010-2018 Belledonne Communications SARL
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _L_FILE_CHUNK_READER_H_
+#define _L_FILE_CHUNK_READER_H_
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <bctoolbox/vfs.h>
+
+#include "linphone/utils/general.h"
+
+// =============================================================================
+
+LINPHONE_BEGIN_NAMESPACE
+
+/*
+ * Reads a file in chunks of a fixed size on a background thread, a few chunks ahead of the consumer so that it
+ * rarely has to wait for the disk. The consumer never blocks, it polls again when the next chunk is not read yet.
+ */
+class FileChunkReader {
+public:
+	enum class TakeResult {
+		Taken,
+		NotReady,
+		Failed
+	};
+
+	struct Chunk {
+		size_t offset = 0;
+		// Empty at the end of the file.
+		std::vector<uint8_t> data;
+	};
+
+	FileChunkReader (const std::string &path, size_t chunkSize, size_t readAhead = 4);
+	~FileChunkReader ();
+
+	bool isOpen () const {
+		return file != nullptr;
+	}
+
+	size_t getFileSize () const {
+		return fileSize;
+	}
+
+	// (Re)starts reading at this offset, the chunks read ahead so far are dropped.
+	void start (size_t offset);
+	// Takes the next chunk if the background thread has already read it.
+	TakeResult tryTakeChunk (Chunk &chunk);
+
+private:
+	void stop ();
+	void run (size_t offset);
+
+	bctbx_vfs_file_t *file = nullptr;
+	size_t fileSize = 0;
+	size_t chunkSize;
+	size_t readAhead;
+
+	std::thread thread;
+	std::mutex accessMutex;
+	std::condition_variable chunksChanged;
+	std::deque<Chunk> chunks;
+	bool running = false;
+	bool failed = false;
+	bool ended = false;
+
+	L_DISABLE_COPY(FileChunkReader);
+};
+
+LINPHONE_END_NAMESPACE
+
+#endif // ifndef _L_FILE_CHUNK_READER_H_
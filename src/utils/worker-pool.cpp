@@ -0,0 +1,73 @@
+/*
+ * worker-pool.cpp
+ * Copyright (C) 2010-2018 Belledonne Communications SARL
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <algorithm>
+
+#include "worker-pool.h"
+
+// =============================================================================
+
+using namespace std;
+
+LINPHONE_BEGIN_NAMESPACE
+
+WorkerPool::WorkerPool (size_t threadCount) {
+	threadCount = max(threadCount, size_t(1));
+	threads.reserve(threadCount);
+	for (size_t i = 0; i < threadCount; i++)
+		threads.emplace_back(&WorkerPool::run, this);
+}
+
+WorkerPool::~WorkerPool () {
+	{
+		lock_guard<mutex> lock(accessMutex);
+		running = false;
+		jobs.clear();
+	}
+	jobsChanged.notify_all();
+	for (thread &worker : threads)
+		worker.join();
+}
+
+void WorkerPool::post (function<void ()> job) {
+	{
+		lock_guard<mutex> lock(accessMutex);
+		jobs.push_back(move(job));
+	}
+	jobsChanged.notify_one();
+}
+
+// -----------------------------------------------------------------------------
+
+void WorkerPool::run () {
+	for (;;) {
+		function<void ()> job;
+		{
+			unique_lock<mutex> lock(accessMutex);
+			jobsChanged.wait(lock, [this] { return !running || !jobs.empty(); });
+			if (!running)
+				return;
+			job = move(jobs.front());
+			jobs.pop_front();
+		}
+		job();
+	}
+}
+
+LINPHONE_END_NAMESPACE
@@ -0,0 +1,65 @@
+/*
+ * worker-pool.h
+ * Copyright (C) 2010-2018 Belledonne Communications SARL
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _L_WORKER_POOL_H_
+#define _L_WORKER_POOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "linphone/utils/general.h"
+
+// =============================================================================
+
+LINPHONE_BEGIN_NAMESPACE
+
+/*
+ * Fixed set of threads running jobs in the order they are posted. Jobs must not touch objects owned by the core
+ * thread, their results are handed back to it by the caller. Jobs still pending are dropped on destruction.
+ */
+class WorkerPool {
+public:
+	explicit WorkerPool (size_t threadCount);
+	~WorkerPool ();
+
+	size_t getThreadCount () const {
+		return threads.size();
+	}
+
+	void post (std::function<void ()> job);
+
+private:
+	void run ();
+
+	std::vector<std::thread> threads;
+	std::mutex accessMutex;
+	std::condition_variable jobsChanged;
+	std::deque<std::function<void ()>> jobs;
+	bool running = true;
+
+	L_DISABLE_COPY(WorkerPool);
+};
+
+LINPHONE_END_NAMESPACE
+
+#endif // ifndef _L_WORKER_POOL_H_
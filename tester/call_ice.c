@@ -388,6 +388,44 @@ end:
 	linphone_core_manager_destroy(pauline);
 }
 
+static void call_with_ice_reuses_network_topology(void){
+	LinphoneCoreManager* marie = linphone_core_manager_new("marie_rc");
+	LinphoneCoreManager* pauline = linphone_core_manager_new(transport_supported(LinphoneTransportTls) ? "pauline_rc" : "pauline_tcp_rc");
+	LinphoneNatPolicy *pol = linphone_core_get_nat_policy(pauline->lc);
+	int reflexive_count;
+
+	/*the local addresses are looked up when the core starts, not by the first call*/
+	BC_ASSERT_TRUE(_linphone_core_network_topology_has_local_address(pauline->lc, AF_INET));
+	linphone_core_manager_wait_for_stun_resolution(pauline);
+
+	_call_with_ice_base(pauline, marie, TRUE, TRUE, FALSE, FALSE);
+	BC_ASSERT_TRUE(_linphone_core_network_topology_has_local_address(pauline->lc, AF_INET));
+	BC_ASSERT_TRUE(_linphone_core_network_topology_has_stun_server_address(pauline->lc, pol));
+	reflexive_count = _linphone_core_network_topology_get_reflexive_address_count(pauline->lc);
+	BC_ASSERT_GREATER(reflexive_count, 0, int, "%i");
+
+	/*the second call from the same ports finds the same addresses and mappings*/
+	_call_with_ice_base(pauline, marie, TRUE, TRUE, FALSE, FALSE);
+	BC_ASSERT_TRUE(_linphone_core_network_topology_has_local_address(pauline->lc, AF_INET));
+	BC_ASSERT_TRUE(_linphone_core_network_topology_has_stun_server_address(pauline->lc, pol));
+	BC_ASSERT_EQUAL(_linphone_core_network_topology_get_reflexive_address_count(pauline->lc), reflexive_count, int, "%i");
+
+	/*nothing learnt about the previous network is kept*/
+	linphone_core_set_network_reachable(pauline->lc, FALSE);
+	BC_ASSERT_FALSE(_linphone_core_network_topology_has_local_address(pauline->lc, AF_INET));
+	BC_ASSERT_FALSE(_linphone_core_network_topology_has_stun_server_address(pauline->lc, pol));
+	BC_ASSERT_EQUAL(_linphone_core_network_topology_get_reflexive_address_count(pauline->lc), 0, int, "%i");
+
+	/*the local addresses are looked up again as soon as the network is back*/
+	linphone_core_set_network_reachable(pauline->lc, TRUE);
+	BC_ASSERT_TRUE(wait_for(pauline->lc, marie->lc, &pauline->stat.number_of_LinphoneRegistrationOk, 2));
+	BC_ASSERT_TRUE(_linphone_core_network_topology_has_local_address(pauline->lc, AF_INET));
+	BC_ASSERT_EQUAL(_linphone_core_network_topology_get_reflexive_address_count(pauline->lc), 0, int, "%i");
+
+	linphone_core_manager_destroy(marie);
+	linphone_core_manager_destroy(pauline);
+}
+
 static void call_with_early_media_ice_and_no_sdp_in_200(void){
 	early_media_without_sdp_in_200_base(FALSE, TRUE);
 }
@@ -420,6 +458,7 @@ static test_t call_with_ice_tests[] = {
 	TEST_ONE_TAG("Call with ICE without stun server", call_with_ice_without_stun, "ICE"),
 	TEST_ONE_TAG("Call with ICE without stun server one side", call_with_ice_without_stun2, "ICE"),
 	TEST_ONE_TAG("Call with ICE and stun server not responding", call_with_ice_stun_not_responding, "ICE"),
+	TEST_ONE_TAG("Call with ICE reuses network topology", call_with_ice_reuses_network_topology, "ICE"),
 };
 
 test_suite_t call_with_ice_test_suite = {"Call with ICE", NULL, NULL, liblinphone_tester_before_each, liblinphone_tester_after_each,
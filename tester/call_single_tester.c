@@ -296,6 +296,35 @@ end:
 	linphone_core_manager_destroy(marie);
 }
 
+static void call_stats_snapshots(void) {
+	LinphoneCoreManager* marie = linphone_core_manager_new("marie_rc");
+	LinphoneCoreManager* pauline = linphone_core_manager_new(transport_supported(LinphoneTransportTls) ? "pauline_rc" : "pauline_tcp_rc");
+	LinphoneCallStatsSnapshot snapshots[4];
+	LinphoneCallStatsSnapshot snapshot;
+	LinphoneCall *call_marie;
+
+	if (!BC_ASSERT_TRUE(call(marie,pauline))) goto end;
+
+	liblinphone_tester_check_rtcp(marie,pauline);
+
+	call_marie = linphone_core_get_current_call(marie->lc);
+	if (BC_ASSERT_TRUE(linphone_call_get_stats_snapshot(call_marie, LinphoneStreamTypeAudio, &snapshot))) {
+		BC_ASSERT_STRING_EQUAL(snapshot.call_id, linphone_call_log_get_call_id(linphone_call_get_call_log(call_marie)));
+		BC_ASSERT_EQUAL(snapshot.type, LinphoneStreamTypeAudio, int, "%d");
+		BC_ASSERT_GREATER(snapshot.update_count, 1, unsigned int, "%u");
+		BC_ASSERT_GREATER((unsigned long long)snapshot.packet_recv, 0, unsigned long long, "%llu");
+	}
+	BC_ASSERT_FALSE(linphone_call_get_stats_snapshot(call_marie, LinphoneStreamTypeVideo, &snapshot));
+	BC_ASSERT_EQUAL(linphone_core_get_call_stats_snapshots(marie->lc, snapshots, 4), 1, int, "%d");
+
+	end_call(marie, pauline);
+	/*the slots are given back when the streams are stopped*/
+	BC_ASSERT_EQUAL(linphone_core_get_call_stats_snapshots(marie->lc, snapshots, 4), 0, int, "%d");
+end:
+	linphone_core_manager_destroy(pauline);
+	linphone_core_manager_destroy(marie);
+}
+
 static void call_with_timed_out_bye(void) {
 	LinphoneCoreManager* marie;
 	LinphoneCoreManager* pauline;
@@ -4555,6 +4584,79 @@ static void call_logs_sqlite_storage(void) {
 	ms_free(logs_db);
 }
 
+static void call_logs_sqlite_storage_paging(void) {
+	LinphoneCoreManager* marie = linphone_core_manager_new("marie_rc");
+	char *logs_db = bc_tester_file("call_logs_paging.db");
+	const LinphoneAddress *identity = linphone_proxy_config_get_identity_address(linphone_core_get_default_proxy_config(marie->lc));
+	LinphoneAddress *bob = linphone_address_new("sip:bob@sip.example.org");
+	LinphoneAddress *alice = linphone_address_new("sip:alice@sip.example.org");
+	LinphoneAddress *bob_with_params = linphone_address_new("\"Bob\" <sip:bob@sip.example.org:5060;transport=tcp>");
+	bctbx_list_t *logs;
+	bctbx_list_t *it;
+	unsigned int before_id = 0;
+	unsigned int previous_id = 0;
+	int nb_logs = 150;
+	int total = 0;
+	int i;
+
+	unlink(logs_db);
+	linphone_core_set_call_logs_database_path(marie->lc, logs_db);
+	BC_ASSERT_EQUAL(linphone_core_get_call_history_size(marie->lc), 0, int, "%d");
+
+	for (i = 0; i < nb_logs; i++) {
+		LinphoneAddress *from = linphone_address_clone(identity);
+		LinphoneAddress *to = linphone_address_clone(i % 2 ? bob : alice);
+		LinphoneCallLog *log = linphone_core_create_call_log(marie->lc, from, to, LinphoneCallOutgoing, 10, time(NULL), time(NULL), LinphoneCallSuccess, FALSE, 4.f);
+		linphone_call_log_unref(log);
+		linphone_address_unref(from);
+		linphone_address_unref(to);
+	}
+	BC_ASSERT_EQUAL(linphone_core_get_call_history_size(marie->lc), nb_logs, int, "%d");
+	/* Only the most recent calls are kept in memory. */
+	BC_ASSERT_EQUAL((int)bctbx_list_size(linphone_core_get_call_logs(marie->lc)), 100, int, "%d");
+
+	do {
+		logs = linphone_core_get_call_history_page(marie->lc, NULL, NULL, before_id, 40);
+		BC_ASSERT_LOWER((int)bctbx_list_size(logs), 40, int, "%d");
+		for (it = logs; it != NULL; it = bctbx_list_next(it)) {
+			unsigned int id = linphone_call_log_get_storage_id((LinphoneCallLog *)bctbx_list_get_data(it));
+			if (previous_id != 0) BC_ASSERT_LOWER(id, previous_id - 1, unsigned int, "%u");
+			previous_id = before_id = id;
+			total++;
+		}
+		if (!logs) break;
+		bctbx_list_free_with_data(logs, (void (*)(void*))linphone_call_log_unref);
+	} while (total < 2 * nb_logs);
+	BC_ASSERT_EQUAL(total, nb_logs, int, "%d");
+
+	logs = linphone_core_get_call_history_page(marie->lc, bob, NULL, 0, -1);
+	BC_ASSERT_EQUAL((int)bctbx_list_size(logs), nb_logs / 2, int, "%d");
+	bctbx_list_free_with_data(logs, (void (*)(void*))linphone_call_log_unref);
+
+	logs = linphone_core_get_call_history_page(marie->lc, alice, identity, 0, 10);
+	BC_ASSERT_EQUAL((int)bctbx_list_size(logs), 10, int, "%d");
+	bctbx_list_free_with_data(logs, (void (*)(void*))linphone_call_log_unref);
+
+	/* Display name, port and uri parameters do not matter. */
+	logs = linphone_core_get_call_history_for_address(marie->lc, bob_with_params);
+	BC_ASSERT_EQUAL((int)bctbx_list_size(logs), nb_logs / 2, int, "%d");
+	bctbx_list_free_with_data(logs, (void (*)(void*))linphone_call_log_unref);
+
+	logs = linphone_core_get_call_history_2(marie->lc, bob_with_params, identity);
+	BC_ASSERT_EQUAL((int)bctbx_list_size(logs), nb_logs / 2, int, "%d");
+	bctbx_list_free_with_data(logs, (void (*)(void*))linphone_call_log_unref);
+
+	logs = linphone_core_get_call_history_2(marie->lc, identity, bob);
+	BC_ASSERT_PTR_NULL(logs);
+
+	linphone_address_unref(bob);
+	linphone_address_unref(alice);
+	linphone_address_unref(bob_with_params);
+	linphone_core_manager_destroy(marie);
+	unlink(logs_db);
+	ms_free(logs_db);
+}
+
 static void call_with_http_proxy(void) {
 	LinphoneCoreManager* marie = linphone_core_manager_create("marie_rc");
 	LinphoneCoreManager* pauline = linphone_core_manager_create("pauline_rc");
@@ -4901,6 +5003,7 @@ test_t call_tests[] = {
 	TEST_NO_TAG("Simple call with UDP", simple_call_with_udp),
 	TEST_ONE_TAG("Call terminated automatically by linphone_core_destroy", automatic_call_termination, "LeaksMemory"),
 	TEST_NO_TAG("Call with http proxy", call_with_http_proxy),
+	TEST_NO_TAG("Call stats snapshots", call_stats_snapshots),
 	TEST_NO_TAG("Call with timed-out bye", call_with_timed_out_bye),
 	TEST_NO_TAG("Direct call over IPv6", direct_call_over_ipv6),
 	TEST_NO_TAG("Call IPv6 to IPv4 without relay", v6_to_v4_call_without_relay),
@@ -4971,6 +5074,7 @@ test_t call_tests[] = {
 	TEST_NO_TAG("Call log working if no db set", call_logs_if_no_db_set),
 	TEST_NO_TAG("Call log storage migration from rc to db", call_logs_migrate),
 	TEST_NO_TAG("Call log storage in sqlite database", call_logs_sqlite_storage),
+	TEST_NO_TAG("Call log storage paging in sqlite database", call_logs_sqlite_storage_paging),
 	TEST_NO_TAG("Call with custom RTP Modifier", call_with_custom_rtp_modifier),
 	TEST_NO_TAG("Call paused resumed with custom RTP Modifier", call_paused_resumed_with_custom_rtp_modifier),
 	TEST_NO_TAG("Call record with custom RTP Modifier", call_record_with_custom_rtp_modifier),
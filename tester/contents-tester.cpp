@@ -17,11 +17,14 @@
  */
 #include <algorithm>
 #include <string>
+#include <thread>
 
 #include "content/content-manager.h"
 #include "content/content-type.h"
 #include "content/content.h"
 #include "content/header/header-param.h"
+#include "content/multipart-reader.h"
+#include "encrypted-envelope.h"
 #include "liblinphone_tester.h"
 #include "tester_utils.h"
 #include "logger/logger.h"
@@ -549,11 +552,193 @@ static void content_header_parsing(void) {
 	BC_ASSERT_TRUE(header.getValueWithParams() == value);
 }
 
+static void content_body_sharing(void) {
+	Content content;
+	content.setBodyFromUtf8("Hello shared world");
+
+	Content copy(content);
+	BC_ASSERT_TRUE(copy.getBodyBuffer().isSharedWith(content.getBodyBuffer()));
+	BC_ASSERT_TRUE(copy == content);
+
+	// Setting the body of a copy leaves the other contents alone.
+	copy.setBodyFromUtf8("Goodbye");
+	BC_ASSERT_FALSE(copy.getBodyBuffer().isSharedWith(content.getBodyBuffer()));
+	BC_ASSERT_STRING_EQUAL(content.getBodyAsUtf8String().c_str(), "Hello shared world");
+	BC_ASSERT_STRING_EQUAL(copy.getBodyAsUtf8String().c_str(), "Goodbye");
+
+	Content slice;
+	slice.setBody(content.getBodyBuffer().slice(6, 6));
+	BC_ASSERT_TRUE(slice.getBodyBuffer().isSharedWith(content.getBodyBuffer()));
+	BC_ASSERT_EQUAL(slice.getSize(), 6, int, "%d");
+	BC_ASSERT_STRING_EQUAL(slice.getBodyAsUtf8String().c_str(), "shared");
+	BC_ASSERT_EQUAL(slice.getBody().size(), 6, int, "%d");
+	// Getting the body of a slice as a vector copies it aside, the slice keeps sharing the bytes.
+	BC_ASSERT_TRUE(slice.getBodyBuffer().isSharedWith(content.getBodyBuffer()));
+	BC_ASSERT_TRUE(content.getBodyBuffer().slice(100).empty());
+
+	Content moved(move(content));
+	BC_ASSERT_TRUE(content.isEmpty());
+	BC_ASSERT_STRING_EQUAL(moved.getBodyAsUtf8String().c_str(), "Hello shared world");
+}
+
+static void content_body_concurrent_reads(void) {
+	Content content;
+	content.setBodyFromUtf8("Hello shared world");
+	Content slice;
+	slice.setBody(content.getBodyBuffer().slice(6, 6));
+	const Content &constSlice = slice;
+
+	const vector<char> expected = { 's', 'h', 'a', 'r', 'e', 'd' };
+	vector<thread> readers;
+	vector<int> results(8, 0);
+	for (size_t i = 0; i < results.size(); i++) {
+		readers.emplace_back([&constSlice, &expected, &results, i] {
+			results[i] = (constSlice.getBody() == expected) ? 1 : 0;
+		});
+	}
+	for (thread &reader : readers)
+		reader.join();
+	for (int result : results)
+		BC_ASSERT_EQUAL(result, 1, int, "%d");
+	BC_ASSERT_TRUE(&constSlice.getBody() == &constSlice.getBody());
+}
+
+namespace {
+	string removeWhitespace (string str) {
+		str.erase(remove_if(str.begin(), str.end(), [](char c) {
+			return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+		}), str.end());
+		return str;
+	}
+}
+
+static void multipart_writer(void) {
+	vector<EnvelopeRecipient> recipients = createEnvelopeRecipients(5);
+	vector<uint8_t> cipherMessage(recipients[0].cipherHeader.begin(), recipients[0].cipherHeader.end());
+
+	vector<char> written = buildEncryptedEnvelope(recipients, cipherMessage);
+	Content expected = buildEnvelopeFromContents(recipients, cipherMessage);
+	// Byte for byte what the content per part implementation sends.
+	BC_ASSERT_TRUE(written == expected.getBody());
+
+	Content multipart;
+	multipart.setContentType(ContentType("multipart/encrypted;boundary=" + string(MultipartBoundary)));
+	multipart.setBody(move(written));
+	list<Content> contents = ContentManager::multipartToContentList(multipart);
+	if (!BC_ASSERT_EQUAL(contents.size(), recipients.size() + 2, int, "%d"))
+		return;
+
+	BC_ASSERT_TRUE(contents.front().getContentType() == ContentType::SipFrag);
+	BC_ASSERT_STRING_EQUAL(contents.front().getBodyAsString().c_str(), "From: <sip:sender@sip.example.org>");
+	contents.pop_front();
+	for (const auto &recipient : recipients) {
+		const Content &content = contents.front();
+		BC_ASSERT_TRUE(content.getContentType() == ContentType::LimeKey);
+		BC_ASSERT_STRING_EQUAL(content.getHeader("Content-Id").getValueWithParams().c_str(), recipient.deviceId.c_str());
+		BC_ASSERT_STRING_EQUAL(content.getBodyAsString().c_str(), encodeWithBctoolbox(recipient.cipherHeader).c_str());
+		contents.pop_front();
+	}
+	BC_ASSERT_STRING_EQUAL(contents.front().getHeader("Content-Description").getValue().c_str(), "Encrypted message");
+	BC_ASSERT_STRING_EQUAL(contents.front().getBodyAsString().c_str(), encodeWithBctoolbox(cipherMessage).c_str());
+}
+
+static void multipart_reader(void) {
+	Content multipartContent;
+	multipartContent.setBody(source_multipart);
+	multipartContent.setContentType(ContentType("multipart", "related"));
+	list<Content> contents = ContentManager::multipartToContentList(multipartContent);
+
+	const vector<char> &body = multipartContent.getBody();
+	MultipartReader reader(body.data(), body.size());
+	MultipartReader::Part part;
+	const char *contentIds[] = { contentid1, contentid2, contentid3, "toto;param1=value1;param2;param3=value3" };
+	size_t index = 0;
+	for (const Content &content : contents) {
+		if (!BC_ASSERT_TRUE(reader.next(part)))
+			return;
+		BC_ASSERT_TRUE(removeWhitespace(part.getBodyAsString()) == removeWhitespace(content.getBodyAsUtf8String()));
+		BC_ASSERT_TRUE(part.hasContentType(content.getContentType()));
+		BC_ASSERT_TRUE(part.hasHeaderValue("content-id", contentIds[index++]));
+	}
+	BC_ASSERT_FALSE(reader.next(part));
+	BC_ASSERT_FALSE(reader.isMalformed());
+
+	// Only the key of one recipient is looked for, as on reception of an encrypted message.
+	vector<EnvelopeRecipient> recipients = createEnvelopeRecipients(200);
+	vector<uint8_t> cipherMessage(recipients[0].cipherHeader.begin(), recipients[0].cipherHeader.end());
+	vector<char> envelope = buildEncryptedEnvelope(recipients, cipherMessage);
+	MultipartReader envelopeReader(envelope.data(), envelope.size());
+	string cipherHeader;
+	string encodedMessage;
+	while (envelopeReader.next(part)) {
+		if (part.hasContentType(ContentType::LimeKey) && part.hasHeaderValue("Content-Id", recipients[123].deviceId))
+			cipherHeader = part.getBodyAsString();
+		else if (part.hasContentType(ContentType::OctetStream))
+			encodedMessage = part.getBodyAsString();
+	}
+	BC_ASSERT_FALSE(envelopeReader.isMalformed());
+	BC_ASSERT_STRING_EQUAL(cipherHeader.c_str(), encodeWithBctoolbox(recipients[123].cipherHeader).c_str());
+	BC_ASSERT_STRING_EQUAL(encodedMessage.c_str(), encodeWithBctoolbox(cipherMessage).c_str());
+
+	// A truncated multipart stops at the last complete part.
+	MultipartReader truncatedReader(envelope.data(), envelope.size() / 2);
+	int count = 0;
+	while (truncatedReader.next(part))
+		count++;
+	BC_ASSERT_TRUE(truncatedReader.isMalformed());
+	BC_ASSERT_LOWER(count, 200, int, "%d");
+}
+
+// Encrypted messages are read with the boundary given by their content type, as the LIME engine does.
+static void multipart_reader_with_other_boundary(void) {
+	const string boundary = "uuid:2a9461cb-9014-4022-a21d-875074da7010";
+	vector<EnvelopeRecipient> recipients = createEnvelopeRecipients(3);
+	vector<uint8_t> cipherMessage(recipients[0].cipherHeader.begin(), recipients[0].cipherHeader.end());
+	// The envelope of the LIME engine, its default boundary replaced by another one.
+	vector<char> defaultEnvelope = buildEncryptedEnvelope(recipients, cipherMessage);
+	string envelopeString(defaultEnvelope.begin(), defaultEnvelope.end());
+	const string defaultBoundary = MultipartBoundary;
+	for (size_t pos = envelopeString.find(defaultBoundary); pos != string::npos; pos = envelopeString.find(defaultBoundary, pos + boundary.size()))
+		envelopeString.replace(pos, defaultBoundary.size(), boundary);
+	vector<char> envelope(envelopeString.begin(), envelopeString.end());
+
+	BC_ASSERT_STRING_EQUAL(ContentManager::getMultipartBoundary(ContentType::Encrypted).c_str(), MultipartBoundary);
+	ContentType contentType("multipart/encrypted;protocol=\"application/lime\";boundary=\"" + boundary + "\"");
+	BC_ASSERT_STRING_EQUAL(ContentManager::getMultipartBoundary(contentType).c_str(), boundary.c_str());
+
+	MultipartReader reader(envelope.data(), envelope.size(), ContentManager::getMultipartBoundary(contentType));
+	MultipartReader::Part part;
+	string cipherHeader;
+	string encodedMessage;
+	int count = 0;
+	while (reader.next(part)) {
+		count++;
+		if (part.hasContentType(ContentType::LimeKey) && part.hasHeaderValue("Content-Id", recipients[1].deviceId))
+			cipherHeader = part.getBodyAsString();
+		else if (part.hasContentType(ContentType::OctetStream))
+			encodedMessage = part.getBodyAsString();
+	}
+	BC_ASSERT_FALSE(reader.isMalformed());
+	BC_ASSERT_EQUAL(count, 5, int, "%d");
+	BC_ASSERT_STRING_EQUAL(cipherHeader.c_str(), encodeWithBctoolbox(recipients[1].cipherHeader).c_str());
+	BC_ASSERT_STRING_EQUAL(encodedMessage.c_str(), encodeWithBctoolbox(cipherMessage).c_str());
+
+	// Nothing is found with the default boundary.
+	MultipartReader defaultReader(envelope.data(), envelope.size());
+	BC_ASSERT_FALSE(defaultReader.next(part));
+	BC_ASSERT_TRUE(defaultReader.isMalformed());
+}
+
 test_t contents_tests[] = {
 	TEST_NO_TAG("Multipart to list", multipart_to_list),
 	TEST_NO_TAG("List to multipart", list_to_multipart),
 	TEST_NO_TAG("Content type parsing", content_type_parsing),
-	TEST_NO_TAG("Content header parsing", content_header_parsing)
+	TEST_NO_TAG("Content header parsing", content_header_parsing),
+	TEST_NO_TAG("Content body sharing", content_body_sharing),
+	TEST_NO_TAG("Content body concurrent reads", content_body_concurrent_reads),
+	TEST_NO_TAG("Multipart writer", multipart_writer),
+	TEST_NO_TAG("Multipart reader", multipart_reader),
+	TEST_NO_TAG("Multipart reader with another boundary", multipart_reader_with_other_boundary)
 };
 
 test_suite_t contents_test_suite = {
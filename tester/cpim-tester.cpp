@@ -20,6 +20,7 @@
 #include "chat/chat-message/chat-message.h"
 #include "chat/chat-room/basic-chat-room.h"
 #include "chat/cpim/cpim.h"
+#include "chat/cpim/parser/cpim-parser.h"
 #include "content/content-type.h"
 #include "content/content.h"
 #include "core/core.h"
@@ -150,6 +151,115 @@ static void parse_message_with_generic_header_parameters () {
 	BC_ASSERT_STRING_EQUAL(content.c_str(), body.c_str());
 }
 
+namespace {
+	const string ParitySeeds[] = {
+		"From: \"Alice\"<sip:alice@sip.example.org>\r\n"
+			"To: \"Bob\"<sip:bob@sip.example.org>\r\n"
+			"DateTime: 2018-05-17T13:40:00Z\r\n"
+			"NS: imdn <urn:ietf:params:imdn>\r\n"
+			"imdn.Message-ID: 0GHXUnxPbBHcfXyUx3\r\n"
+			"imdn.Disposition-Notification: positive-delivery, display\r\n"
+			"\r\n"
+			"Content-Type: text/plain\r\n"
+			"Content-Length: 12\r\n"
+			"\r\n"
+			"Hello world!",
+		"From: <sip:alice@sip.example.org;gr=urn:uuid:0001>\r\n"
+			"To: <sip:chatroom-x@conf.example.org>\r\n"
+			"cc: Charlie Brown <tel:+33123456789>\r\n"
+			"DateTime: 2000-12-13T13:40:00.125-08:00\r\n"
+			"Subject: \xc3\xa9t\xc3\xa9\r\n"
+			"Require: MyFeatures.VitalMessageOption,Other\r\n"
+			"\r\n"
+			"Content-Type: application/vnd.gsma.rcs-ft-http+xml\r\n"
+			"Content-Disposition: attachment\r\n"
+			"\r\n"
+			"<file/>",
+		"From: \"Esc\\\"aped \\u00e9\"<im:piglet@100akerwood.com>\r\n"
+			"Test:;aaa=bbb;yes=no CheckMe\r\n"
+			"\r\n"
+			"Content-Type: text/xml; charset=utf-8\r\n"
+			"\r\n",
+		"Content-Type: Message/CPIM\r\n"
+			"\r\n"
+			"From: <sip:a@b.c>\r\n"
+			"\r\n"
+			"Content-Type: text/plain\r\n"
+			"\r\n"
+			"body"
+	};
+
+	// Characters that matter to the CPIM grammar, used to mutate the seeds.
+	const char ParityMutations[] = " \t:;.,<>\"\\/@%+-=ZzTt09aA\r\n\x7f\x80\xc3\xa9";
+
+	bool parseResultsMatch (const string &input) {
+		shared_ptr<Cpim::Message> fast = Cpim::Parser::getInstance()->parseMessage(input);
+		shared_ptr<Cpim::Message> grammar = Cpim::Parser::getInstance()->parseMessageWithGrammar(input);
+		if (!fast || !grammar)
+			return !fast && !grammar;
+		return fast->asString() == grammar->asString();
+	}
+}
+
+static void parse_fast_path_parity () {
+	uint32_t seed = 0x43504d31;
+	auto next = [&seed]() {
+		seed = seed * 1103515245 + 12345;
+		return (seed >> 16) & 0x7fff;
+	};
+
+	int mismatches = 0;
+	for (const auto &seedMessage : ParitySeeds) {
+		BC_ASSERT_TRUE(parseResultsMatch(seedMessage));
+		for (int i = 0; i < 300; i++) {
+			string input = seedMessage;
+			for (int mutations = 1 + int(next() % 3); mutations > 0 && !input.empty(); mutations--) {
+				size_t position = next() % input.size();
+				char c = ParityMutations[next() % (sizeof(ParityMutations) - 1)];
+				switch (next() % 4) {
+					case 0:
+						input[position] = c;
+						break;
+					case 1:
+						input.insert(position, 1, c);
+						break;
+					case 2:
+						input.erase(position, 1);
+						break;
+					default:
+						input.resize(position);
+						break;
+				}
+			}
+			if (!parseResultsMatch(input)) {
+				if (mismatches++ == 0)
+					ms_error("CPIM fast path and grammar disagree on: %s", input.c_str());
+			}
+		}
+	}
+	BC_ASSERT_EQUAL(mismatches, 0, int, "%d");
+}
+
+static void parse_throughput () {
+	const string &str = ParitySeeds[0];
+	const int iterations = 2000;
+
+	uint64_t start = bctbx_get_cur_time_ms();
+	for (int i = 0; i < iterations; i++)
+		BC_ASSERT_PTR_NOT_NULL(Cpim::Parser::getInstance()->parseMessage(str));
+	uint64_t fastElapsed = bctbx_get_cur_time_ms() - start;
+
+	start = bctbx_get_cur_time_ms();
+	for (int i = 0; i < iterations; i++)
+		BC_ASSERT_PTR_NOT_NULL(Cpim::Parser::getInstance()->parseMessageWithGrammar(str));
+	uint64_t grammarElapsed = bctbx_get_cur_time_ms() - start;
+
+	ms_message(
+		"Parsed %d CPIM messages in %llu ms, %llu ms with the grammar only",
+		iterations, (unsigned long long)fastElapsed, (unsigned long long)grammarElapsed
+	);
+}
+
 static void build_message () {
 
 	Cpim::Message message;
@@ -307,15 +417,94 @@ static void cpim_chat_message_modifier_with_multipart_body () {
 	cpim_chat_message_modifier_base(TRUE);
 }
 
+static void cpim_chat_messages_sent_through_send_pipeline () {
+	LinphoneCoreManager* marie = linphone_core_manager_create("marie_rc");
+	LinphoneCoreManager* pauline = linphone_core_manager_new( "pauline_tcp_rc");
+	const int messageCount = 10;
+
+	// Fewer messages in flight than sent so that some of them wait in the queue.
+	lp_config_set_int(linphone_core_get_config(marie->lc), "misc", "chat_send_worker_threads", 2);
+	lp_config_set_int(linphone_core_get_config(marie->lc), "misc", "chat_send_max_in_flight", 3);
+	linphone_core_manager_start(marie, TRUE);
+
+	char *paulineUri = linphone_address_as_string_uri_only(pauline->identity);
+	IdentityAddress paulineAddress(paulineUri);
+	bctbx_free(paulineUri);
+
+	shared_ptr<AbstractChatRoom> marieRoom = marie->lc->cppPtr->getOrCreateBasicChatRoom(paulineAddress);
+	marieRoom->allowCpim(true);
+	for (int i = 0; i < messageCount; i++)
+		marieRoom->createChatMessage("Message " + to_string(i))->send();
+
+	BC_ASSERT_TRUE(wait_for_until(pauline->lc, marie->lc, &pauline->stat.number_of_LinphoneMessageReceived, messageCount, 10000));
+
+	// Messages of a chat room are received in the order they were sent.
+	LinphoneChatRoom *paulineRoom = linphone_core_get_chat_room(pauline->lc, marie->identity);
+	if (BC_ASSERT_PTR_NOT_NULL(paulineRoom)) {
+		bctbx_list_t *history = linphone_chat_room_get_history(paulineRoom, 0);
+		BC_ASSERT_EQUAL((int)bctbx_list_size(history), messageCount, int, "%d");
+		int i = 0;
+		for (bctbx_list_t *it = history; it; it = bctbx_list_next(it), i++) {
+			LinphoneChatMessage *message = (LinphoneChatMessage *)bctbx_list_get_data(it);
+			BC_ASSERT_STRING_EQUAL(linphone_chat_message_get_text(message), ("Message " + to_string(i)).c_str());
+			BC_ASSERT_STRING_EQUAL(linphone_chat_message_get_content_type(message), ContentType::PlainText.asString().c_str());
+		}
+		bctbx_list_free_with_data(history, (bctbx_list_free_func)linphone_chat_message_unref);
+	}
+
+	marieRoom.reset();
+
+	linphone_core_manager_destroy(marie);
+	linphone_core_manager_destroy(pauline);
+}
+
+static void cpim_chat_messages_not_delivered_when_send_pipeline_stops () {
+	LinphoneCoreManager* marie = linphone_core_manager_create("marie_rc");
+	LinphoneCoreManager* pauline = linphone_core_manager_new( "pauline_tcp_rc");
+	const int messageCount = 5;
+
+	lp_config_set_int(linphone_core_get_config(marie->lc), "misc", "chat_send_worker_threads", 1);
+	lp_config_set_int(linphone_core_get_config(marie->lc), "misc", "chat_send_max_in_flight", 1);
+	linphone_core_manager_start(marie, TRUE);
+
+	char *paulineUri = linphone_address_as_string_uri_only(pauline->identity);
+	IdentityAddress paulineAddress(paulineUri);
+	bctbx_free(paulineUri);
+
+	// The core does not iterate before it stops, none of the messages leaves the pipeline.
+	shared_ptr<AbstractChatRoom> marieRoom = marie->lc->cppPtr->getOrCreateBasicChatRoom(paulineAddress);
+	marieRoom->allowCpim(true);
+	list<shared_ptr<ChatMessage>> messages;
+	for (int i = 0; i < messageCount; i++) {
+		shared_ptr<ChatMessage> message = marieRoom->createChatMessage("Message " + to_string(i));
+		message->send();
+		messages.push_back(message);
+	}
+	marieRoom.reset();
+
+	linphone_core_manager_stop(marie);
+	for (const auto &message : messages)
+		BC_ASSERT_EQUAL((int)message->getState(), (int)ChatMessage::State::NotDelivered, int, "%d");
+	messages.clear();
+
+	linphone_core_manager_uninit(marie);
+	ms_free(marie);
+	linphone_core_manager_destroy(pauline);
+}
+
 test_t cpim_tests[] = {
 	TEST_NO_TAG("Parse minimal CPIM message", parse_minimal_message),
 	TEST_NO_TAG("Set generic header name", set_generic_header_name),
 	TEST_NO_TAG("Check core header names", check_core_header_names),
 	TEST_NO_TAG("Parse RFC example", parse_rfc_example),
 	TEST_NO_TAG("Parse Message with generic header parameters", parse_message_with_generic_header_parameters),
+	TEST_NO_TAG("Parse fast path parity", parse_fast_path_parity),
+	TEST_ONE_TAG("Parse throughput", parse_throughput, "Benchmark"),
 	TEST_NO_TAG("Build Message", build_message),
 	TEST_NO_TAG("CPIM chat message modifier", cpim_chat_message_modifier),
-	TEST_NO_TAG("CPIM chat message modifier with multipart body", cpim_chat_message_modifier_with_multipart_body)
+	TEST_NO_TAG("CPIM chat message modifier with multipart body", cpim_chat_message_modifier_with_multipart_body),
+	TEST_NO_TAG("CPIM chat messages sent through the send pipeline", cpim_chat_messages_sent_through_send_pipeline),
+	TEST_NO_TAG("CPIM chat messages not delivered when the send pipeline stops", cpim_chat_messages_not_delivered_when_send_pipeline_stops)
 };
 
 static int suite_begin(void) {
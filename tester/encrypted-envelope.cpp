@@ -0,0 +1,116 @@
+/*
+ * encrypted-envelope.cpp
+ * Copyright (C) 2010-2018 Belledonne Communications SARL
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <list>
+
+#include <bctoolbox/crypto.h>
+#include <bctoolbox/port.h>
+
+#include "chat/encryption/encrypted-multipart.h"
+#include "content/content-manager.h"
+#include "content/content-type.h"
+#include "liblinphone_tester.h"
+
+#include "encrypted-envelope.h"
+
+// =============================================================================
+
+using namespace LinphonePrivate;
+using namespace std;
+
+vector<EnvelopeRecipient> createEnvelopeRecipients (int count) {
+	vector<EnvelopeRecipient> recipients(static_cast<size_t>(count));
+	uint32_t seed = 0x4c494d45;
+	for (int i = 0; i < count; i++) {
+		recipients[size_t(i)].deviceId = "sip:user" + to_string(i) + "@sip.example.org;gr=urn:uuid:6cfdef8a-ae0b-4072-97bc-c0399ab9071b";
+		recipients[size_t(i)].cipherHeader.resize(83 + size_t(i % 7));
+		for (uint8_t &byte : recipients[size_t(i)].cipherHeader) {
+			seed = seed * 1103515245 + 12345;
+			byte = uint8_t(seed >> 16);
+		}
+	}
+	return recipients;
+}
+
+string encodeWithBctoolbox (const vector<uint8_t> &data) {
+	size_t size = 0;
+	bctbx_base64_encode(nullptr, &size, data.data(), data.size());
+	string encoded(size, '\0');
+	bctbx_base64_encode(reinterpret_cast<unsigned char *>(&encoded[0]), &size, data.data(), data.size());
+	encoded.resize(size);
+	return encoded;
+}
+
+Content buildEnvelopeFromContents (const vector<EnvelopeRecipient> &recipients, const vector<uint8_t> &cipherMessage) {
+	list<Content *> contents;
+	Content *sipfrag = new Content();
+	sipfrag->setBody("From: <sip:sender@sip.example.org>");
+	sipfrag->setContentType(ContentType::SipFrag);
+	contents.push_back(sipfrag);
+	for (const auto &recipient : recipients) {
+		Content *cipherHeader = new Content();
+		cipherHeader->setBody(encodeWithBctoolbox(recipient.cipherHeader));
+		cipherHeader->setContentType(ContentType::LimeKey);
+		cipherHeader->addHeader("Content-Id", recipient.deviceId);
+		cipherHeader->addHeader("Content-Description", "Cipher key");
+		contents.push_back(cipherHeader);
+	}
+	Content *message = new Content();
+	message->setBody(encodeWithBctoolbox(cipherMessage));
+	message->setContentType(ContentType::OctetStream);
+	message->addHeader("Content-Description", "Encrypted message");
+	contents.push_back(message);
+
+	Content multipart = ContentManager::contentListToMultipart(contents, MultipartBoundary, true);
+	for (Content *content : contents)
+		delete content;
+	return multipart;
+}
+
+vector<char> buildEncryptedEnvelope (const vector<EnvelopeRecipient> &recipients, const vector<uint8_t> &cipherMessage) {
+	vector<EncryptedMultipartKey> keys;
+	keys.reserve(recipients.size());
+	for (const auto &recipient : recipients)
+		keys.push_back({ recipient.deviceId, recipient.cipherHeader });
+	return buildEncryptedMultipart("sip:sender@sip.example.org", keys, cipherMessage);
+}
+
+void encrypted_envelope_build_run (
+	int nb_recipients,
+	int iterations,
+	uint64_t *writer_elapsed_ms,
+	uint64_t *contents_elapsed_ms
+) {
+	vector<uint8_t> cipherMessage(1024, 0x5a);
+	vector<EnvelopeRecipient> recipients = createEnvelopeRecipients(nb_recipients);
+
+	uint64_t start = bctbx_get_cur_time_ms();
+	size_t contentsSize = 0;
+	for (int i = 0; i < iterations; i++)
+		contentsSize += buildEnvelopeFromContents(recipients, cipherMessage).getSize();
+	*contents_elapsed_ms = bctbx_get_cur_time_ms() - start;
+
+	start = bctbx_get_cur_time_ms();
+	size_t writerSize = 0;
+	for (int i = 0; i < iterations; i++)
+		writerSize += buildEncryptedEnvelope(recipients, cipherMessage).size();
+	*writer_elapsed_ms = bctbx_get_cur_time_ms() - start;
+
+	BC_ASSERT_EQUAL(writerSize, contentsSize, size_t, "%zu");
+}
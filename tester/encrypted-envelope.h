@@ -0,0 +1,73 @@
+/*
+ * encrypted-envelope.h
+ * Copyright (C) 2010-2018 Belledonne Communications SARL
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _L_ENCRYPTED_ENVELOPE_H_
+#define _L_ENCRYPTED_ENVELOPE_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+
+#include <string>
+#include <vector>
+
+#include "content/content.h"
+
+// =============================================================================
+
+// Envelopes of encrypted messages, as sent to several recipient devices, shared by the tests and the benchmarks.
+
+struct EnvelopeRecipient {
+	std::string deviceId;
+	std::vector<uint8_t> cipherHeader;
+};
+
+// Always the same recipients for a given count.
+std::vector<EnvelopeRecipient> createEnvelopeRecipients (int count);
+
+std::string encodeWithBctoolbox (const std::vector<uint8_t> &data);
+
+// Envelope built the way it used to be, a content per part.
+LinphonePrivate::Content buildEnvelopeFromContents (
+	const std::vector<EnvelopeRecipient> &recipients,
+	const std::vector<uint8_t> &cipherMessage
+);
+
+// Envelope built by the LIME engine, from sip:sender@sip.example.org.
+std::vector<char> buildEncryptedEnvelope (
+	const std::vector<EnvelopeRecipient> &recipients,
+	const std::vector<uint8_t> &cipherMessage
+);
+
+extern "C" {
+#endif
+
+/* Builds iterations envelopes for nb_recipients recipients both ways, gives the time spent by each one. */
+void encrypted_envelope_build_run (
+	int nb_recipients,
+	int iterations,
+	uint64_t *writer_elapsed_ms,
+	uint64_t *contents_elapsed_ms
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ifndef _L_ENCRYPTED_ENVELOPE_H_
@@ -2047,6 +2047,75 @@ end:
 	linphone_core_manager_destroy(laure);
 }
 
+/* Same as the CPIM messages of the send pipeline, but the LIME envelopes are built by its workers too. */
+static void group_chat_lime_x3dh_messages_sent_through_send_pipeline (void) {
+	LinphoneCoreManager *marie = linphone_core_manager_create("marie_lime_x3dh_rc");
+	LinphoneCoreManager *pauline = linphone_core_manager_create("pauline_lime_x3dh_rc");
+	LinphoneCoreManager *laure = linphone_core_manager_create("laure_lime_x3dh_rc");
+	bctbx_list_t *coresManagerList = NULL;
+	bctbx_list_t *participantsAddresses = NULL;
+	const int messageCount = 6;
+	int dummy = 0;
+	int i;
+	coresManagerList = bctbx_list_append(coresManagerList, marie);
+	coresManagerList = bctbx_list_append(coresManagerList, pauline);
+	coresManagerList = bctbx_list_append(coresManagerList, laure);
+
+	// Fewer messages in flight than sent so that some of them wait in the queue.
+	lp_config_set_int(linphone_core_get_config(marie->lc), "misc", "chat_send_worker_threads", 2);
+	lp_config_set_int(linphone_core_get_config(marie->lc), "misc", "chat_send_max_in_flight", 2);
+
+	bctbx_list_t *coresList = init_core_for_conference(coresManagerList);
+	start_core_for_conference(coresManagerList);
+	participantsAddresses = bctbx_list_append(participantsAddresses, linphone_address_new(linphone_core_get_identity(pauline->lc)));
+	participantsAddresses = bctbx_list_append(participantsAddresses, linphone_address_new(linphone_core_get_identity(laure->lc)));
+	stats initialMarieStats = marie->stat;
+	stats initialPaulineStats = pauline->stat;
+	stats initialLaureStats = laure->stat;
+
+	// Wait for lime users to be created on X3DH server
+	wait_for_list(coresList, &dummy, 1, x3dhServerDelay);
+	BC_ASSERT_TRUE(linphone_core_lime_x3dh_enabled(marie->lc));
+
+	// Marie creates a new group chat room
+	const char *initialSubject = "Friends";
+	LinphoneChatRoom *marieCr = create_chat_room_client_side(coresList, marie, &initialMarieStats, participantsAddresses, initialSubject, TRUE);
+	const LinphoneAddress *confAddr = linphone_chat_room_get_conference_address(marieCr);
+	LinphoneChatRoom *paulineCr = check_creation_chat_room_client_side(coresList, pauline, &initialPaulineStats, confAddr, initialSubject, 2, 0);
+	LinphoneChatRoom *laureCr = check_creation_chat_room_client_side(coresList, laure, &initialLaureStats, confAddr, initialSubject, 2, 0);
+	if (!BC_ASSERT_PTR_NOT_NULL(paulineCr) || !BC_ASSERT_PTR_NOT_NULL(laureCr))
+		goto end;
+
+	for (i = 0; i < messageCount; i++) {
+		char *text = bctbx_strdup_printf("Message %d", i);
+		_send_message(marieCr, text);
+		bctbx_free(text);
+	}
+	BC_ASSERT_TRUE(wait_for_list(coresList, &pauline->stat.number_of_LinphoneMessageReceived, initialPaulineStats.number_of_LinphoneMessageReceived + messageCount, 20000));
+	BC_ASSERT_TRUE(wait_for_list(coresList, &laure->stat.number_of_LinphoneMessageReceived, initialLaureStats.number_of_LinphoneMessageReceived + messageCount, 20000));
+
+	// Messages of a chat room are decrypted in the order they were sent.
+	bctbx_list_t *history = linphone_chat_room_get_history(paulineCr, messageCount);
+	BC_ASSERT_EQUAL((int)bctbx_list_size(history), messageCount, int, "%d");
+	i = 0;
+	for (bctbx_list_t *it = history; it; it = bctbx_list_next(it), i++) {
+		char *text = bctbx_strdup_printf("Message %d", i);
+		BC_ASSERT_STRING_EQUAL(linphone_chat_message_get_text((LinphoneChatMessage *)bctbx_list_get_data(it)), text);
+		bctbx_free(text);
+	}
+	bctbx_list_free_with_data(history, (bctbx_list_free_func)linphone_chat_message_unref);
+
+end:
+	linphone_core_manager_delete_chat_room(marie, marieCr, coresList);
+	if (paulineCr) linphone_core_manager_delete_chat_room(pauline, paulineCr, coresList);
+
+	bctbx_list_free(coresList);
+	bctbx_list_free(coresManagerList);
+	linphone_core_manager_destroy(marie);
+	linphone_core_manager_destroy(pauline);
+	linphone_core_manager_destroy(laure);
+}
+
 static void group_chat_lime_x3dh_send_encrypted_message_to_disabled_lime_x3dh (void) {
 	LinphoneCoreManager *marie = linphone_core_manager_create("marie_lime_x3dh_rc");
 	LinphoneCoreManager *pauline = linphone_core_manager_create("pauline_lime_x3dh_rc");
@@ -2705,6 +2774,7 @@ test_t secure_group_chat_tests[] = {
 	TEST_TWO_TAGS("LIME X3DH chatroom security alert", group_chat_lime_x3dh_chatroom_security_alert, "LimeX3DH", "LeaksMemory"),
 	TEST_TWO_TAGS("LIME X3DH call security alert", group_chat_lime_x3dh_call_security_alert, "LimeX3DH", "LeaksMemory"),
 	TEST_TWO_TAGS("LIME X3DH multiple successive messages", group_chat_lime_x3dh_send_multiple_successive_encrypted_messages, "LimeX3DH", "LeaksMemory"),
+	TEST_TWO_TAGS("LIME X3DH messages sent through the send pipeline", group_chat_lime_x3dh_messages_sent_through_send_pipeline, "LimeX3DH", "LeaksMemory"),
 	TEST_TWO_TAGS("LIME X3DH encrypted message to disabled LIME X3DH", group_chat_lime_x3dh_send_encrypted_message_to_disabled_lime_x3dh, "LimeX3DH", "LeaksMemory"),
 	TEST_TWO_TAGS("LIME X3DH plain message to enabled LIME X3DH", group_chat_lime_x3dh_send_plain_message_to_enabled_lime_x3dh, "LimeX3DH", "LeaksMemory"),
 	TEST_TWO_TAGS("LIME X3DH message to multidevice participants", group_chat_lime_x3dh_send_encrypted_message_to_multidevice_participants, "LimeX3DH", "LeaksMemory"),
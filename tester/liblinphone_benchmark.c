@@ -0,0 +1,919 @@
+/*
+ liblinphone_benchmark - performance benchmarks of liblinphone hot paths
+ Copyright (C) 2018  Belledonne Communications SARL
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * All the cores of the benchmarks run in this process and talk to each other directly over TCP on the loopback
+ * interface, no SIP server is needed. Each result is printed as one JSON object per line:
+ * {"benchmark":"<name>","metric":"<name>","value":<number>,"unit":"<unit>"}
+ */
+
+#include "linphone/core.h"
+#include "encrypted-envelope.h"
+#include "liblinphone_tester.h"
+#include "tester_utils.h"
+#include "ortp/port.h"
+
+static FILE *log_file = NULL;
+static FILE *results_file = NULL;
+
+static int nb_calls = 20;
+static int nb_messages = 200;
+static int nb_fanout_receivers = 4;
+static int nb_fanout_messages = 50;
+static int nb_notifies = 100;
+static int nb_contacts = 100000;
+static int nb_history_messages = 1000;
+static int history_page_size = 50;
+static int nb_dispatches = 100000;
+static int file_transfer_size = 16 * 1024 * 1024;
+static int nb_envelope_builds = 50;
+static int nb_config_lookups = 100000;
+
+static void log_handler(int lev, const char *fmt, va_list args) {
+#ifdef _WIN32
+	vfprintf(lev == ORTP_ERROR ? stderr : stdout, fmt, args);
+	fprintf(lev == ORTP_ERROR ? stderr : stdout, "\n");
+#else
+	va_list cap;
+	va_copy(cap,args);
+	/* Otherwise, we must use stdio to avoid log formatting (for autocompletion etc.) */
+	vfprintf(lev == ORTP_ERROR ? stderr : stdout, fmt, cap);
+	fprintf(lev == ORTP_ERROR ? stderr : stdout, "\n");
+	va_end(cap);
+#endif
+	bctbx_logv(BCTBX_LOG_DOMAIN, lev, fmt, args);
+}
+
+int liblinphone_benchmark_set_log_file(const char *filename) {
+	if (log_file) {
+		fclose(log_file);
+	}
+	log_file = fopen(filename, "w");
+	if (!log_file) {
+		ms_error("Cannot open file [%s] for writing logs because [%s]", filename, strerror(errno));
+		return -1;
+	}
+	ms_message("Redirecting traces to file [%s]", filename);
+	linphone_core_set_log_file(log_file);
+	return 0;
+}
+
+static int silent_arg_func(const char *arg) {
+	linphone_core_set_log_level(ORTP_FATAL);
+	return 0;
+}
+
+static int verbose_arg_func(const char *arg) {
+	linphone_core_set_log_level(ORTP_MESSAGE);
+	return 0;
+}
+
+static int logfile_arg_func(const char *arg) {
+	if (liblinphone_benchmark_set_log_file(arg) < 0) return -2;
+	return 0;
+}
+
+/****************************** Helpers ******************************/
+
+static void report_result(const char *benchmark, const char *metric, double value, const char *unit) {
+	FILE *output = results_file ? results_file : stdout;
+	fprintf(output, "{\"benchmark\":\"%s\",\"metric\":\"%s\",\"value\":%.3f,\"unit\":\"%s\"}\n", benchmark, metric, value, unit);
+	fflush(output);
+}
+
+static double per_second(int count, uint64_t elapsed_ms) {
+	return elapsed_ms ? (count * 1000.0) / (double)elapsed_ms : 0;
+}
+
+/* Same as wait_for_list() but polling every millisecond, so that the measures are not rounded to the polling period. */
+static bool_t benchmark_wait_for(bctbx_list_t *lcs, int *counter, int value, int timeout_ms) {
+	uint64_t start = ms_get_cur_time_ms();
+	bctbx_list_t *it;
+	while (*counter < value && (ms_get_cur_time_ms() - start) < (uint64_t)timeout_ms) {
+		for (it = lcs; it != NULL; it = it->next)
+			linphone_core_iterate((LinphoneCore *)it->data);
+		ms_usleep(1000);
+	}
+	return *counter >= value;
+}
+
+static void configure_loopback_transports(LinphoneCoreManager *mgr) {
+	LinphoneTransports *transports = linphone_factory_create_transports(linphone_factory_get());
+	linphone_transports_set_udp_port(transports, 0);
+	linphone_transports_set_tcp_port(transports, LC_SIP_TRANSPORT_RANDOM);
+	linphone_transports_set_tls_port(transports, 0);
+	linphone_transports_set_dtls_port(transports, 0);
+	linphone_core_set_transports(mgr->lc, transports);
+	linphone_transports_unref(transports);
+}
+
+/* A core without any proxy, listening on a random TCP port and identified as sip:<username>@127.0.0.1. */
+static LinphoneCoreManager *create_loopback_core(const char *username) {
+	LinphoneCoreManager *mgr = linphone_core_manager_create("empty_rc");
+	char *contact = bctbx_strdup_printf("sip:%s@127.0.0.1", username);
+	linphone_core_set_primary_contact(mgr->lc, contact);
+	bctbx_free(contact);
+	configure_loopback_transports(mgr);
+	linphone_core_manager_start(mgr, FALSE);
+	return mgr;
+}
+
+/* The URI to reach the core directly, to be freed with bctbx_free(). */
+static char *get_loopback_uri(LinphoneCoreManager *mgr) {
+	LinphoneAddress *addr = linphone_core_get_primary_contact_parsed(mgr->lc);
+	LinphoneTransports *transports = linphone_core_get_transports_used(mgr->lc);
+	char *uri;
+	linphone_address_set_port(addr, linphone_transports_get_tcp_port(transports));
+	linphone_address_set_transport(addr, LinphoneTransportTcp);
+	uri = linphone_address_as_string(addr);
+	linphone_transports_unref(transports);
+	linphone_address_unref(addr);
+	return uri;
+}
+
+/* Sends count messages without waiting in between, returns the time until all of them are received. */
+static uint64_t send_messages(LinphoneCoreManager *sender, LinphoneCoreManager *receiver, int count) {
+	bctbx_list_t *lcs = bctbx_list_append(bctbx_list_append(NULL, sender->lc), receiver->lc);
+	char *receiver_uri = get_loopback_uri(receiver);
+	LinphoneChatRoom *room = linphone_core_get_chat_room_from_uri(sender->lc, receiver_uri);
+	int initial_received = receiver->stat.number_of_LinphoneMessageReceived;
+	uint64_t start = ms_get_cur_time_ms();
+	uint64_t elapsed;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		char *text = bctbx_strdup_printf("Benchmark message %d", i);
+		LinphoneChatMessage *msg = linphone_chat_room_create_message(room, text);
+		linphone_chat_message_send(msg);
+		linphone_chat_message_unref(msg);
+		bctbx_free(text);
+	}
+	BC_ASSERT_TRUE(benchmark_wait_for(lcs, &receiver->stat.number_of_LinphoneMessageReceived, initial_received + count, count * 200 + 10000));
+	elapsed = ms_get_cur_time_ms() - start;
+
+	bctbx_free(receiver_uri);
+	bctbx_list_free(lcs);
+	return elapsed;
+}
+
+/****************************** Benchmarks ******************************/
+
+static void call_setup_benchmark(void) {
+	LinphoneCoreManager *caller = create_loopback_core("caller");
+	LinphoneCoreManager *callee = create_loopback_core("callee");
+	bctbx_list_t *lcs = bctbx_list_append(bctbx_list_append(NULL, caller->lc), callee->lc);
+	char *callee_uri = get_loopback_uri(callee);
+	uint64_t setup_time = 0;
+	uint64_t start = ms_get_cur_time_ms();
+	int completed = 0;
+	int i;
+
+	for (i = 0; i < nb_calls; i++) {
+		uint64_t call_start = ms_get_cur_time_ms();
+		LinphoneCall *call = linphone_core_invite(caller->lc, callee_uri);
+		if (!BC_ASSERT_PTR_NOT_NULL(call)) break;
+		if (!BC_ASSERT_TRUE(benchmark_wait_for(lcs, &callee->stat.number_of_LinphoneCallIncomingReceived, i + 1, 10000))) break;
+		linphone_call_accept(linphone_core_get_current_call(callee->lc));
+		if (!BC_ASSERT_TRUE(benchmark_wait_for(lcs, &caller->stat.number_of_LinphoneCallStreamsRunning, i + 1, 10000))) break;
+		setup_time += ms_get_cur_time_ms() - call_start;
+		linphone_core_terminate_all_calls(caller->lc);
+		if (!BC_ASSERT_TRUE(benchmark_wait_for(lcs, &caller->stat.number_of_LinphoneCallReleased, i + 1, 10000))) break;
+		if (!BC_ASSERT_TRUE(benchmark_wait_for(lcs, &callee->stat.number_of_LinphoneCallReleased, i + 1, 10000))) break;
+		completed++;
+	}
+
+	if (completed > 0) {
+		report_result("call_setup", "calls_per_second", per_second(completed, ms_get_cur_time_ms() - start), "1/s");
+		report_result("call_setup", "setup_latency_avg", (double)setup_time / completed, "ms");
+	}
+
+	bctbx_free(callee_uri);
+	bctbx_list_free(lcs);
+	linphone_core_manager_destroy(caller);
+	linphone_core_manager_destroy(callee);
+}
+
+static void message_throughput_benchmark(void) {
+	LinphoneCoreManager *sender = create_loopback_core("sender");
+	LinphoneCoreManager *receiver = create_loopback_core("receiver");
+	uint64_t elapsed = send_messages(sender, receiver, nb_messages);
+
+	/* Both ends persist the messages in their database. */
+	report_result("message", "messages_per_second", per_second(nb_messages, elapsed), "1/s");
+	report_result("message", "message_latency_avg", (double)elapsed / nb_messages, "ms");
+
+	linphone_core_manager_destroy(sender);
+	linphone_core_manager_destroy(receiver);
+}
+
+/*
+ * Group chat rooms need a conference focus, so the fan-out is measured with one basic chat room per receiver:
+ * it exercises the same send, store and receive paths for every participant.
+ */
+static void message_fanout_benchmark(void) {
+	LinphoneCoreManager *sender = create_loopback_core("fanout_sender");
+	LinphoneCoreManager **receivers = ms_new0(LinphoneCoreManager *, nb_fanout_receivers);
+	LinphoneChatRoom **rooms = ms_new0(LinphoneChatRoom *, nb_fanout_receivers);
+	bctbx_list_t *lcs = bctbx_list_append(NULL, sender->lc);
+	uint64_t latency = 0;
+	uint64_t max_latency = 0;
+	uint64_t start;
+	int received = 0;
+	int i, j;
+
+	for (i = 0; i < nb_fanout_receivers; i++) {
+		char *username = bctbx_strdup_printf("fanout_receiver_%d", i);
+		char *uri;
+		receivers[i] = create_loopback_core(username);
+		lcs = bctbx_list_append(lcs, receivers[i]->lc);
+		uri = get_loopback_uri(receivers[i]);
+		rooms[i] = linphone_core_get_chat_room_from_uri(sender->lc, uri);
+		bctbx_free(uri);
+		bctbx_free(username);
+	}
+
+	start = ms_get_cur_time_ms();
+	for (j = 0; j < nb_fanout_messages; j++) {
+		uint64_t message_start = ms_get_cur_time_ms();
+		uint64_t message_latency;
+		for (i = 0; i < nb_fanout_receivers; i++) {
+			LinphoneChatMessage *msg = linphone_chat_room_create_message(rooms[i], "Fan-out benchmark message");
+			linphone_chat_message_send(msg);
+			linphone_chat_message_unref(msg);
+		}
+		for (i = 0; i < nb_fanout_receivers; i++) {
+			if (!BC_ASSERT_TRUE(benchmark_wait_for(lcs, &receivers[i]->stat.number_of_LinphoneMessageReceived, j + 1, 10000)))
+				goto end;
+		}
+		message_latency = ms_get_cur_time_ms() - message_start;
+		latency += message_latency;
+		if (message_latency > max_latency) max_latency = message_latency;
+		received++;
+	}
+
+end:
+	if (received > 0) {
+		report_result("fanout", "fanout_latency_avg", (double)latency / received, "ms");
+		report_result("fanout", "fanout_latency_max", (double)max_latency, "ms");
+		report_result("fanout", "deliveries_per_second", per_second(received * nb_fanout_receivers, ms_get_cur_time_ms() - start), "1/s");
+	}
+
+	bctbx_list_free(lcs);
+	ms_free(rooms);
+	linphone_core_manager_destroy(sender);
+	for (i = 0; i < nb_fanout_receivers; i++)
+		linphone_core_manager_destroy(receivers[i]);
+	ms_free(receivers);
+}
+
+static void presence_notify_benchmark(void) {
+	LinphoneCoreManager *publisher = create_loopback_core("publisher");
+	LinphoneCoreManager *subscriber = create_loopback_core("subscriber");
+	bctbx_list_t *lcs = bctbx_list_append(bctbx_list_append(NULL, publisher->lc), subscriber->lc);
+	char *publisher_uri = get_loopback_uri(publisher);
+	LinphoneFriend *subscriber_friend = linphone_core_create_friend_with_address(publisher->lc, "sip:subscriber@127.0.0.1");
+	LinphoneFriend *publisher_friend = linphone_core_create_friend_with_address(subscriber->lc, publisher_uri);
+	uint64_t start;
+	int initial_notifies;
+	int received = 0;
+	int i;
+
+	linphone_friend_set_inc_subscribe_policy(subscriber_friend, LinphoneSPAccept);
+	linphone_core_add_friend(publisher->lc, subscriber_friend);
+	linphone_friend_enable_subscribes(publisher_friend, TRUE);
+	linphone_core_add_friend(subscriber->lc, publisher_friend);
+	/* Wait for the initial NOTIFY of the subscription. */
+	BC_ASSERT_TRUE(benchmark_wait_for(lcs, &subscriber->stat.number_of_NotifyPresenceReceived, 1, 10000));
+
+	initial_notifies = subscriber->stat.number_of_NotifyPresenceReceived;
+	start = ms_get_cur_time_ms();
+	for (i = 0; i < nb_notifies; i++) {
+		LinphonePresenceModel *model = linphone_presence_model_new_with_activity(
+			(i % 2) ? LinphonePresenceActivityOnThePhone : LinphonePresenceActivityAway, NULL
+		);
+		linphone_core_set_presence_model(publisher->lc, model);
+		linphone_presence_model_unref(model);
+		if (!BC_ASSERT_TRUE(benchmark_wait_for(lcs, &subscriber->stat.number_of_NotifyPresenceReceived, initial_notifies + i + 1, 10000)))
+			break;
+		received++;
+	}
+	if (received > 0) {
+		uint64_t elapsed = ms_get_cur_time_ms() - start;
+		report_result("presence", "notifies_per_second", per_second(received, elapsed), "1/s");
+		report_result("presence", "notify_latency_avg", (double)elapsed / received, "ms");
+	}
+
+	linphone_friend_unref(subscriber_friend);
+	linphone_friend_unref(publisher_friend);
+	bctbx_free(publisher_uri);
+	bctbx_list_free(lcs);
+	linphone_core_manager_destroy(publisher);
+	linphone_core_manager_destroy(subscriber);
+}
+
+/* Ingestion of the full-state then partial-state NOTIFY of an RLS for a list of friends. */
+static void presence_list_notify_benchmark(void) {
+	static const int resource_counts[] = { 1000, 10000 };
+	size_t i;
+	int j;
+
+	for (i = 0; i < sizeof(resource_counts) / sizeof(resource_counts[0]); i++) {
+		int nb_resources = resource_counts[i];
+		LinphoneCoreManager *mgr = create_loopback_core("presence_list");
+		LinphoneFriendList *list = linphone_core_create_friend_list(mgr->lc);
+		LinphoneContent *full_state_body = liblinphone_tester_create_rlmi_notify_body(mgr->lc, nb_resources, 0, TRUE);
+		LinphoneContent *partial_state_body = liblinphone_tester_create_rlmi_notify_body(mgr->lc, nb_resources / 10, 1, FALSE);
+		uint64_t start;
+		char *metric;
+
+		for (j = 0; j < nb_resources; j++) {
+			char *uri = bctbx_strdup_printf("sip:user%d@sip.example.org", j);
+			LinphoneFriend *lf = linphone_core_create_friend_with_address(mgr->lc, uri);
+			linphone_friend_enable_subscribes(lf, FALSE);
+			linphone_friend_list_add_local_friend(list, lf);
+			linphone_friend_unref(lf);
+			bctbx_free(uri);
+		}
+
+		start = ms_get_cur_time_ms();
+		linphone_friend_list_notify_presence_received(list, NULL, full_state_body);
+		metric = bctbx_strdup_printf("full_state_time[%d resources]", nb_resources);
+		report_result("presence_list", metric, (double)(ms_get_cur_time_ms() - start), "ms");
+		bctbx_free(metric);
+		BC_ASSERT_EQUAL(linphone_friend_list_get_expected_notification_version(list), 1, int, "%d");
+
+		start = ms_get_cur_time_ms();
+		linphone_friend_list_notify_presence_received(list, NULL, partial_state_body);
+		metric = bctbx_strdup_printf("partial_state_time[%d resources]", nb_resources / 10);
+		report_result("presence_list", metric, (double)(ms_get_cur_time_ms() - start), "ms");
+		bctbx_free(metric);
+		BC_ASSERT_EQUAL(linphone_friend_list_get_expected_notification_version(list), 2, int, "%d");
+
+		linphone_content_unref(full_state_body);
+		linphone_content_unref(partial_state_body);
+		linphone_friend_list_unref(list);
+		linphone_core_manager_destroy(mgr);
+	}
+}
+
+static void magic_search_benchmark(void) {
+	static const char *filters[] = { "", "contact", "contact1", "99", "nomatch" };
+	LinphoneCoreManager *mgr = create_loopback_core("searcher");
+	LinphoneFriendList *list = linphone_core_get_default_friend_list(mgr->lc);
+	LinphoneMagicSearch *magic_search;
+	uint64_t start;
+	size_t i;
+	int j;
+
+	linphone_friend_list_enable_subscriptions(list, FALSE);
+	start = ms_get_cur_time_ms();
+	for (j = 0; j < nb_contacts; j++) {
+		char *name = bctbx_strdup_printf("Contact %d", j);
+		char *uri = bctbx_strdup_printf("sip:contact%d@example.org", j);
+		LinphoneFriend *lf = linphone_core_create_friend_with_address(mgr->lc, uri);
+		linphone_friend_set_name(lf, name);
+		linphone_friend_list_add_local_friend(list, lf);
+		linphone_friend_unref(lf);
+		bctbx_free(uri);
+		bctbx_free(name);
+	}
+	report_result("magic_search", "contacts_load_time", (double)(ms_get_cur_time_ms() - start), "ms");
+
+	magic_search = linphone_core_create_magic_search(mgr->lc);
+	for (i = 0; i < sizeof(filters) / sizeof(filters[0]); i++) {
+		char *metric = bctbx_strdup_printf("query_latency[%s]", filters[i]);
+		bctbx_list_t *results;
+		linphone_magic_search_reset_search_cache(magic_search);
+		start = ms_get_cur_time_ms();
+		results = linphone_magic_search_get_contact_list_from_filter(magic_search, filters[i], "");
+		report_result("magic_search", metric, (double)(ms_get_cur_time_ms() - start), "ms");
+		bctbx_list_free_with_data(results, (bctbx_list_free_func)linphone_search_result_unref);
+		bctbx_free(metric);
+	}
+	linphone_magic_search_unref(magic_search);
+
+	linphone_core_manager_destroy(mgr);
+}
+
+static void history_paging_benchmark(void) {
+	LinphoneCoreManager *sender = create_loopback_core("history_sender");
+	LinphoneCoreManager *receiver = create_loopback_core("history_receiver");
+	LinphoneAddress *sender_addr = linphone_core_get_primary_contact_parsed(sender->lc);
+	LinphoneChatRoom *room;
+	uint64_t start;
+	uint64_t page_time = 0;
+	int pages = 0;
+	int i;
+
+	send_messages(sender, receiver, nb_history_messages);
+	room = linphone_core_find_chat_room(receiver->lc, sender_addr, NULL);
+	if (!BC_ASSERT_PTR_NOT_NULL(room)) goto end;
+
+	start = ms_get_cur_time_ms();
+	BC_ASSERT_EQUAL(linphone_chat_room_get_history_size(room), nb_history_messages, int, "%d");
+	report_result("history", "history_size_time", (double)(ms_get_cur_time_ms() - start), "ms");
+
+	for (i = 0; i < nb_history_messages; i += history_page_size) {
+		bctbx_list_t *page;
+		start = ms_get_cur_time_ms();
+		page = linphone_chat_room_get_history_range(room, i, i + history_page_size - 1);
+		page_time += ms_get_cur_time_ms() - start;
+		BC_ASSERT_PTR_NOT_NULL(page);
+		bctbx_list_free_with_data(page, (bctbx_list_free_func)linphone_chat_message_unref);
+		pages++;
+	}
+	if (pages > 0)
+		report_result("history", "page_latency_avg", (double)page_time / pages, "ms");
+
+end:
+	linphone_address_unref(sender_addr);
+	linphone_core_manager_destroy(sender);
+	linphone_core_manager_destroy(receiver);
+}
+
+static void startup_benchmark(void) {
+	LinphoneCoreManager *sender = create_loopback_core("startup_sender");
+	LinphoneCoreManager *receiver = create_loopback_core("startup_receiver");
+	uint64_t start;
+
+	send_messages(sender, receiver, nb_history_messages);
+	linphone_core_manager_stop(receiver);
+
+	/* Start again on the database filled above. */
+	start = ms_get_cur_time_ms();
+	linphone_core_manager_reinit(receiver);
+	configure_loopback_transports(receiver);
+	linphone_core_manager_start(receiver, FALSE);
+	report_result("startup", "startup_time", (double)(ms_get_cur_time_ms() - start), "ms");
+
+	start = ms_get_cur_time_ms();
+	BC_ASSERT_PTR_NOT_NULL(linphone_core_get_chat_rooms(receiver->lc));
+	report_result("startup", "chat_rooms_load_time", (double)(ms_get_cur_time_ms() - start), "ms");
+
+	linphone_core_manager_destroy(sender);
+	linphone_core_manager_destroy(receiver);
+}
+
+static void dispatch_call_stats_updated(LinphoneCore *lc, LinphoneCall *call, const LinphoneCallStats *stats) {
+	int *count = (int *)linphone_core_cbs_get_user_data(linphone_core_get_current_callbacks(lc));
+	(*count)++;
+}
+
+static void dispatch_call_state_changed(LinphoneCore *lc, LinphoneCall *call, LinphoneCallState state, const char *message) {
+}
+
+/* Cost of notifying an event having a single subscriber among listener_count registered callbacks. */
+static void core_callbacks_dispatch_benchmark(void) {
+	static const int listener_counts[] = { 1, 10, 100, 1000 };
+	size_t i;
+	int j;
+
+	for (i = 0; i < sizeof(listener_counts) / sizeof(listener_counts[0]); i++) {
+		LinphoneCore *lc = linphone_factory_create_core_3(linphone_factory_get(), NULL, liblinphone_tester_get_empty_rc(), system_context);
+		LinphoneCoreCbs *subscriber = linphone_factory_create_core_cbs(linphone_factory_get());
+		bctbx_list_t *listeners = NULL;
+		char *metric;
+		uint64_t start;
+		int count = 0;
+
+		for (j = 1; j < listener_counts[i]; j++) {
+			LinphoneCoreCbs *cbs = linphone_factory_create_core_cbs(linphone_factory_get());
+			linphone_core_cbs_set_call_state_changed(cbs, dispatch_call_state_changed);
+			linphone_core_add_callbacks(lc, cbs);
+			listeners = bctbx_list_append(listeners, cbs);
+		}
+		linphone_core_cbs_set_call_stats_updated(subscriber, dispatch_call_stats_updated);
+		linphone_core_cbs_set_user_data(subscriber, &count);
+		linphone_core_add_callbacks(lc, subscriber);
+
+		start = ms_get_cur_time_ms();
+		for (j = 0; j < nb_dispatches; j++)
+			_linphone_core_notify_call_stats_updated(lc, NULL, NULL);
+		metric = bctbx_strdup_printf("notify_cost[%d listeners]", listener_counts[i]);
+		report_result("callbacks", metric, (double)(ms_get_cur_time_ms() - start) * 1000000.0 / nb_dispatches, "ns");
+		bctbx_free(metric);
+		BC_ASSERT_EQUAL(count, nb_dispatches, int, "%d");
+
+		linphone_core_remove_callbacks(lc, subscriber);
+		linphone_core_cbs_unref(subscriber);
+		bctbx_list_free_with_data(listeners, (bctbx_list_free_func)linphone_core_cbs_unref);
+		linphone_core_unref(lc);
+	}
+}
+
+/* XOR "cipher" of the file transfer chunks through the C encryption engine callbacks, cheap enough to measure the
+ * cost of the chunk processing itself. */
+static int xor_process_file(const uint8_t *buffer, size_t size, uint8_t *processed_buffer) {
+	size_t i;
+	if (!buffer || size == 0) return 0;
+	for (i = 0; i < size; i++)
+		processed_buffer[i] = buffer[i] ^ 0x5a;
+	return 0;
+}
+
+static bool_t xor_is_encryption_enabled_for_file_transfer(LinphoneImEncryptionEngine *engine, LinphoneChatRoom *room) {
+	return TRUE;
+}
+
+static int xor_downloading_file(LinphoneImEncryptionEngine *engine, LinphoneChatMessage *msg, size_t offset, const uint8_t *buffer, size_t size, uint8_t *decrypted_buffer) {
+	return xor_process_file(buffer, size, decrypted_buffer);
+}
+
+static int xor_uploading_file(LinphoneImEncryptionEngine *engine, LinphoneChatMessage *msg, size_t offset, const uint8_t *buffer, size_t *size, uint8_t *encrypted_buffer) {
+	return xor_process_file(buffer, *size, encrypted_buffer);
+}
+
+static void enable_xor_file_encryption(LinphoneCoreManager *mgr) {
+	LinphoneImEncryptionEngine *imee = linphone_im_encryption_engine_new();
+	LinphoneImEncryptionEngineCbs *cbs = linphone_im_encryption_engine_get_callbacks(imee);
+	linphone_im_encryption_engine_cbs_set_is_encryption_enabled_for_file_transfer(cbs, xor_is_encryption_enabled_for_file_transfer);
+	linphone_im_encryption_engine_cbs_set_process_downloading_file(cbs, xor_downloading_file);
+	linphone_im_encryption_engine_cbs_set_process_uploading_file(cbs, xor_uploading_file);
+	linphone_core_set_im_encryption_engine(mgr->lc, imee);
+	linphone_im_encryption_engine_unref(imee);
+	_linphone_core_use_legacy_encryption_engine(mgr->lc);
+}
+
+static void file_transfer_received(LinphoneChatMessage *msg, const LinphoneContent *content, const LinphoneBuffer *buffer) {
+	size_t *received = (size_t *)linphone_chat_message_get_user_data(msg);
+	*received += linphone_buffer_get_size(buffer);
+}
+
+static double megabytes_per_second(size_t size, uint64_t elapsed_ms) {
+	return elapsed_ms ? ((double)size / (1024.0 * 1024.0)) * 1000.0 / (double)elapsed_ms : 0;
+}
+
+static void run_file_transfer_benchmark(bool_t encrypted) {
+	const char *mode = encrypted ? "encrypted" : "plain";
+	FileServerStub *server = file_server_stub_start();
+	LinphoneCoreManager *sender = create_loopback_core("ft_sender");
+	LinphoneCoreManager *receiver = create_loopback_core("ft_receiver");
+	bctbx_list_t *lcs = bctbx_list_append(bctbx_list_append(NULL, sender->lc), receiver->lc);
+	char *receiver_uri = get_loopback_uri(receiver);
+	char *send_filepath = bc_tester_file("ft_benchmark.bin");
+	char *server_url;
+	char *metric;
+	LinphoneChatRoom *room;
+	LinphoneContent *content;
+	LinphoneChatMessage *msg;
+	LinphoneChatMessage *recv_msg;
+	FILE *file;
+	char chunk[4096];
+	size_t written = 0;
+	size_t received = 0;
+	uint64_t start;
+
+	if (!BC_ASSERT_PTR_NOT_NULL(server)) goto end;
+	for (file = fopen(send_filepath, "wb"); file && written < (size_t)file_transfer_size; written += sizeof(chunk)) {
+		size_t i;
+		for (i = 0; i < sizeof(chunk); i++) chunk[i] = (char)('a' + (written + i) % 26);
+		fwrite(chunk, 1, MIN(sizeof(chunk), (size_t)file_transfer_size - written), file);
+	}
+	if (!BC_ASSERT_PTR_NOT_NULL(file)) goto end;
+	fclose(file);
+
+	if (encrypted) {
+		enable_xor_file_encryption(sender);
+		enable_xor_file_encryption(receiver);
+	}
+	server_url = bctbx_strdup_printf("http://127.0.0.1:%d/upload", file_server_stub_get_port(server));
+	linphone_core_set_file_transfer_server(sender->lc, server_url);
+	bctbx_free(server_url);
+
+	room = linphone_core_get_chat_room_from_uri(sender->lc, receiver_uri);
+	content = linphone_core_create_content(sender->lc);
+	linphone_content_set_type(content, "application");
+	linphone_content_set_subtype(content, "octet-stream");
+	linphone_content_set_name(content, "ft_benchmark.bin");
+	linphone_content_set_file_path(content, send_filepath);
+	msg = linphone_chat_room_create_file_transfer_message(room, content);
+	linphone_chat_message_cbs_set_msg_state_changed(linphone_chat_message_get_callbacks(msg), liblinphone_tester_chat_message_msg_state_changed);
+	linphone_content_unref(content);
+
+	start = ms_get_cur_time_ms();
+	linphone_chat_message_send(msg);
+	if (BC_ASSERT_TRUE(benchmark_wait_for(lcs, &sender->stat.number_of_LinphoneMessageFileTransferDone, 1, 60000))) {
+		metric = bctbx_strdup_printf("upload_throughput[%s]", mode);
+		report_result("file_transfer", metric, megabytes_per_second((size_t)file_transfer_size, ms_get_cur_time_ms() - start), "MB/s");
+		bctbx_free(metric);
+	}
+	linphone_chat_message_unref(msg);
+
+	if (BC_ASSERT_TRUE(benchmark_wait_for(lcs, &receiver->stat.number_of_LinphoneMessageReceivedWithFile, 1, 10000))
+		&& BC_ASSERT_PTR_NOT_NULL(receiver->stat.last_received_chat_message)) {
+		LinphoneChatMessageCbs *cbs;
+		recv_msg = receiver->stat.last_received_chat_message;
+		cbs = linphone_chat_message_get_callbacks(recv_msg);
+		linphone_chat_message_cbs_set_msg_state_changed(cbs, liblinphone_tester_chat_message_msg_state_changed);
+		linphone_chat_message_cbs_set_file_transfer_recv(cbs, file_transfer_received);
+		linphone_chat_message_set_user_data(recv_msg, &received);
+
+		start = ms_get_cur_time_ms();
+		linphone_chat_message_download_file(recv_msg);
+		if (BC_ASSERT_TRUE(benchmark_wait_for(lcs, &receiver->stat.number_of_LinphoneMessageFileTransferDone, 1, 60000))) {
+			metric = bctbx_strdup_printf("download_throughput[%s]", mode);
+			report_result("file_transfer", metric, megabytes_per_second((size_t)file_transfer_size, ms_get_cur_time_ms() - start), "MB/s");
+			bctbx_free(metric);
+		}
+		BC_ASSERT_EQUAL((int)received, file_transfer_size, int, "%d");
+		linphone_chat_message_set_user_data(recv_msg, NULL);
+	}
+
+end:
+	remove(send_filepath);
+	bctbx_free(send_filepath);
+	bctbx_free(receiver_uri);
+	bctbx_list_free(lcs);
+	linphone_core_manager_destroy(sender);
+	linphone_core_manager_destroy(receiver);
+	if (server) file_server_stub_stop(server);
+}
+
+/* Throughput of the file transfers through a local HTTP server, with and without the chunks going through an
+ * encryption engine. */
+static void file_transfer_benchmark(void) {
+	run_file_transfer_benchmark(FALSE);
+	run_file_transfer_benchmark(TRUE);
+}
+
+/* Envelope of an encrypted message written at once, compared to a content per part. */
+static void encrypted_envelope_build_benchmark(void) {
+	static const int recipient_counts[] = { 1, 10, 50, 200 };
+	size_t i;
+
+	for (i = 0; i < sizeof(recipient_counts) / sizeof(recipient_counts[0]); i++) {
+		uint64_t writer_elapsed;
+		uint64_t contents_elapsed;
+		char *metric;
+
+		encrypted_envelope_build_run(recipient_counts[i], nb_envelope_builds, &writer_elapsed, &contents_elapsed);
+		metric = bctbx_strdup_printf("build_time_avg[%d recipients]", recipient_counts[i]);
+		report_result("envelope", metric, (double)writer_elapsed / nb_envelope_builds, "ms");
+		bctbx_free(metric);
+		metric = bctbx_strdup_printf("build_time_avg_per_part[%d recipients]", recipient_counts[i]);
+		report_result("envelope", metric, (double)contents_elapsed / nb_envelope_builds, "ms");
+		bctbx_free(metric);
+	}
+}
+
+static int config_lookup_run(LpConfig *conf, int nb_sections, int nb_keys, int nb_lookups) {
+	char section[32];
+	char key[32];
+	int i;
+	int found = 0;
+	for (i = 0; i < nb_lookups; i++) {
+		int value = ((i * 7) % nb_sections) * nb_keys + i % nb_keys;
+		snprintf(section, sizeof(section), "proxy_%i", (i * 7) % nb_sections);
+		snprintf(key, sizeof(key), "key_%i", i % nb_keys);
+		if (lp_config_get_int(conf, section, key, -1) == value) found++;
+		lp_config_set_int(conf, section, key, value);
+	}
+	return found;
+}
+
+typedef struct _LinearLookupItem {
+	char key[32];
+	char value[16];
+} LinearLookupItem;
+
+typedef struct _LinearLookupSection {
+	char name[32];
+	bctbx_list_t *items;
+} LinearLookupSection;
+
+/* The lookup LpConfig did before its sections and items were indexed: a walk of the ordered lists. */
+static LinearLookupItem *linear_lookup_find_item(bctbx_list_t *sections, const char *section, const char *key) {
+	bctbx_list_t *elem;
+	bctbx_list_t *it;
+	for (elem = sections; elem != NULL; elem = bctbx_list_next(elem)) {
+		LinearLookupSection *sec = (LinearLookupSection *)elem->data;
+		if (strcmp(sec->name, section) != 0) continue;
+		for (it = sec->items; it != NULL; it = bctbx_list_next(it)) {
+			LinearLookupItem *item = (LinearLookupItem *)it->data;
+			if (strcmp(item->key, key) == 0) return item;
+		}
+		return NULL;
+	}
+	return NULL;
+}
+
+static void linear_lookup_free_section(LinearLookupSection *sec) {
+	bctbx_list_free_with_data(sec->items, ms_free);
+	ms_free(sec);
+}
+
+/* Same get/set sequence as config_lookup_run() through the linear lookup. */
+static int linear_lookup_run(bctbx_list_t *sections, int nb_sections, int nb_keys, int nb_lookups) {
+	char section[32];
+	char key[32];
+	LinearLookupItem *item;
+	int i;
+	int found = 0;
+	for (i = 0; i < nb_lookups; i++) {
+		int value = ((i * 7) % nb_sections) * nb_keys + i % nb_keys;
+		snprintf(section, sizeof(section), "proxy_%i", (i * 7) % nb_sections);
+		snprintf(key, sizeof(key), "key_%i", i % nb_keys);
+		item = linear_lookup_find_item(sections, section, key);
+		if (item && atoi(item->value) == value) found++;
+		item = linear_lookup_find_item(sections, section, key);
+		if (item) snprintf(item->value, sizeof(item->value), "%i", value);
+	}
+	return found;
+}
+
+/* Indexed get/set on a large provisioned-like configuration, compared to the linear lookups used before the index. */
+static void config_lookup_benchmark(void) {
+	const int nb_sections = 500;
+	const int nb_keys = 20;
+	LpConfig *conf = lp_config_new_from_buffer("");
+	bctbx_list_t *linear_sections = NULL;
+	uint64_t start;
+	char section[32];
+	char key[32];
+	int i, j;
+
+	for (i = 0; i < nb_sections; i++) {
+		LinearLookupSection *sec = ms_new0(LinearLookupSection, 1);
+		snprintf(section, sizeof(section), "proxy_%i", i);
+		snprintf(sec->name, sizeof(sec->name), "%s", section);
+		for (j = 0; j < nb_keys; j++) {
+			LinearLookupItem *item = ms_new0(LinearLookupItem, 1);
+			snprintf(key, sizeof(key), "key_%i", j);
+			lp_config_set_int(conf, section, key, i * nb_keys + j);
+			snprintf(item->key, sizeof(item->key), "%s", key);
+			snprintf(item->value, sizeof(item->value), "%i", i * nb_keys + j);
+			sec->items = bctbx_list_append(sec->items, item);
+		}
+		linear_sections = bctbx_list_append(linear_sections, sec);
+	}
+
+	start = ms_get_cur_time_ms();
+	BC_ASSERT_EQUAL(config_lookup_run(conf, nb_sections, nb_keys, nb_config_lookups), nb_config_lookups, int, "%d");
+	report_result("config", "get_set_time[indexed]", (double)(ms_get_cur_time_ms() - start), "ms");
+
+	start = ms_get_cur_time_ms();
+	BC_ASSERT_EQUAL(linear_lookup_run(linear_sections, nb_sections, nb_keys, nb_config_lookups), nb_config_lookups, int, "%d");
+	report_result("config", "get_set_time[linear]", (double)(ms_get_cur_time_ms() - start), "ms");
+
+	bctbx_list_free_with_data(linear_sections, (bctbx_list_free_func)linear_lookup_free_section);
+	lp_config_destroy(conf);
+}
+
+static test_t benchmark_tests[] = {
+	TEST_NO_TAG("Call setup", call_setup_benchmark),
+	TEST_NO_TAG("Message throughput", message_throughput_benchmark),
+	TEST_NO_TAG("Message fan-out", message_fanout_benchmark),
+	TEST_NO_TAG("Presence NOTIFY", presence_notify_benchmark),
+	TEST_NO_TAG("Presence list NOTIFY", presence_list_notify_benchmark),
+	TEST_NO_TAG("MagicSearch", magic_search_benchmark),
+	TEST_NO_TAG("History paging", history_paging_benchmark),
+	TEST_NO_TAG("Startup with large database", startup_benchmark),
+	TEST_NO_TAG("Core callbacks dispatch", core_callbacks_dispatch_benchmark),
+	TEST_NO_TAG("File transfer", file_transfer_benchmark),
+	TEST_NO_TAG("Encrypted envelope build", encrypted_envelope_build_benchmark),
+	TEST_NO_TAG("Config lookup", config_lookup_benchmark)
+};
+
+static test_suite_t benchmark_test_suite = {
+	"Benchmark", NULL, NULL, liblinphone_tester_before_each, liblinphone_tester_after_each,
+	sizeof(benchmark_tests) / sizeof(benchmark_tests[0]), benchmark_tests
+};
+
+void liblinphone_benchmark_init(void(*ftester_printf)(int level, const char *fmt, va_list args)) {
+	bctbx_init_logger(FALSE);
+	if (ftester_printf == NULL) ftester_printf = log_handler;
+	bc_tester_set_silent_func(silent_arg_func);
+	bc_tester_set_verbose_func(verbose_arg_func);
+	bc_tester_set_logfile_func(logfile_arg_func);
+	bc_tester_init(ftester_printf, ORTP_MESSAGE, ORTP_ERROR, "rcfiles");
+}
+
+void liblinphone_benchmark_uninit(void) {
+	if (results_file) {
+		fclose(results_file);
+		results_file = NULL;
+	}
+	bc_tester_uninit();
+	bctbx_uninit_logger();
+}
+
+#if !TARGET_OS_IPHONE && !(defined(LINPHONE_WINDOWS_PHONE) || defined(LINPHONE_WINDOWS_UNIVERSAL))
+
+static const char* liblinphone_benchmark_helper =
+	"\t\t\t--results <file> (Write the results to this file instead of the standard output)\n"
+	"\t\t\t--calls <nb_calls> (Number of calls to set up)\n"
+	"\t\t\t--messages <nb_messages> (Number of messages to send for the throughput)\n"
+	"\t\t\t--fanout-receivers <nb_receivers> (Number of receivers of each fan-out message)\n"
+	"\t\t\t--fanout-messages <nb_messages> (Number of fan-out messages)\n"
+	"\t\t\t--notifies <nb_notifies> (Number of presence changes to notify)\n"
+	"\t\t\t--contacts <nb_contacts> (Number of contacts to search in)\n"
+	"\t\t\t--history-messages <nb_messages> (Number of messages in the history to page through and to start with)\n"
+	"\t\t\t--history-page-size <nb_messages> (Number of messages of each history page)\n"
+	"\t\t\t--dispatches <nb_dispatches> (Number of core callbacks notifications to dispatch)\n"
+	"\t\t\t--file-transfer-size <size> (Size in bytes of the file to upload and download)\n"
+	"\t\t\t--envelope-builds <nb_builds> (Number of encrypted message envelopes to build for each recipient count)\n"
+	"\t\t\t--config-lookups <nb_lookups> (Number of configuration values to get and set)\n"
+	"\t\t\t--dns-hosts </etc/hosts -like file to used to override DNS names (default: tester_hosts)>\n"
+	"\t\t\t--disable-leak-detector\n"
+	"\t\t\t--no-ipv6 (turn off IPv6 in LinphoneCore)\n"
+	;
+
+int main (int argc, char *argv[])
+{
+	int i;
+	int ret;
+
+	liblinphone_benchmark_init(NULL);
+	linphone_core_set_log_level(ORTP_ERROR);
+	bc_tester_add_suite(&benchmark_test_suite);
+
+	for(i = 1; i < argc; ++i) {
+		if (strcmp(argv[i],"--results")==0){
+			CHECK_ARG("--results", ++i, argc);
+			results_file = fopen(argv[i], "w");
+			if (!results_file) {
+				ms_error("Cannot open file [%s] for writing results because [%s]", argv[i], strerror(errno));
+				return -1;
+			}
+		} else if (strcmp(argv[i],"--calls")==0){
+			CHECK_ARG("--calls", ++i, argc);
+			nb_calls=atoi(argv[i]);
+		} else if (strcmp(argv[i],"--messages")==0){
+			CHECK_ARG("--messages", ++i, argc);
+			nb_messages=atoi(argv[i]);
+		} else if (strcmp(argv[i],"--fanout-receivers")==0){
+			CHECK_ARG("--fanout-receivers", ++i, argc);
+			nb_fanout_receivers=atoi(argv[i]);
+		} else if (strcmp(argv[i],"--fanout-messages")==0){
+			CHECK_ARG("--fanout-messages", ++i, argc);
+			nb_fanout_messages=atoi(argv[i]);
+		} else if (strcmp(argv[i],"--notifies")==0){
+			CHECK_ARG("--notifies", ++i, argc);
+			nb_notifies=atoi(argv[i]);
+		} else if (strcmp(argv[i],"--contacts")==0){
+			CHECK_ARG("--contacts", ++i, argc);
+			nb_contacts=atoi(argv[i]);
+		} else if (strcmp(argv[i],"--history-messages")==0){
+			CHECK_ARG("--history-messages", ++i, argc);
+			nb_history_messages=atoi(argv[i]);
+		} else if (strcmp(argv[i],"--history-page-size")==0){
+			CHECK_ARG("--history-page-size", ++i, argc);
+			history_page_size=atoi(argv[i]);
+		} else if (strcmp(argv[i],"--dispatches")==0){
+			CHECK_ARG("--dispatches", ++i, argc);
+			nb_dispatches=atoi(argv[i]);
+		} else if (strcmp(argv[i],"--file-transfer-size")==0){
+			CHECK_ARG("--file-transfer-size", ++i, argc);
+			file_transfer_size=atoi(argv[i]);
+		} else if (strcmp(argv[i],"--envelope-builds")==0){
+			CHECK_ARG("--envelope-builds", ++i, argc);
+			nb_envelope_builds=atoi(argv[i]);
+		} else if (strcmp(argv[i],"--config-lookups")==0){
+			CHECK_ARG("--config-lookups", ++i, argc);
+			nb_config_lookups=atoi(argv[i]);
+		} else if (strcmp(argv[i],"--dns-hosts")==0){
+			CHECK_ARG("--dns-hosts", ++i, argc);
+			userhostsfile=argv[i];
+		} else if (strcmp(argv[i],"--disable-leak-detector")==0){
+			liblinphone_tester_disable_leak_detector(TRUE);
+		} else if (strcmp(argv[i],"--no-ipv6")==0){
+			liblinphonetester_ipv6 = FALSE;
+		} else {
+			int bret = bc_tester_parse_args(argc, argv, i);
+			if (bret>0) {
+				i += bret - 1;
+				continue;
+			} else if (bret<0) {
+				bc_tester_helper(argv[0], liblinphone_benchmark_helper);
+			}
+			return bret;
+		}
+	}
+
+	if (nb_calls < 1 || nb_messages < 1 || nb_fanout_receivers < 1 || nb_fanout_messages < 1 || nb_notifies < 1
+		|| nb_contacts < 0 || nb_history_messages < 1 || history_page_size < 1 || nb_dispatches < 1
+		|| file_transfer_size < 1 || nb_envelope_builds < 1 || nb_config_lookups < 1) {
+		bctbx_error("The benchmark sizes must be positive!");
+		return -1;
+	}
+	ret = bc_tester_start(argv[0]);
+	liblinphone_benchmark_uninit();
+	return ret;
+}
+
+#endif
@@ -365,6 +365,7 @@ void linphone_core_manager_reinit(LinphoneCoreManager *mgr);
 void linphone_core_manager_restart(LinphoneCoreManager *mgr, bool_t check_for_proxies);
 void linphone_core_manager_uninit(LinphoneCoreManager *mgr);
 void linphone_core_manager_wait_for_stun_resolution(LinphoneCoreManager *mgr);
+bool_t wait_for_stun_resolution(LinphoneCoreManager *m);
 void linphone_core_manager_destroy(LinphoneCoreManager* mgr);
 void linphone_core_manager_delete_chat_room (LinphoneCoreManager *mgr, LinphoneChatRoom *cr, bctbx_list_t *coresList);
 bctbx_list_t * init_core_for_conference(bctbx_list_t *coreManagerList);
@@ -502,6 +503,25 @@ const char *liblinphone_tester_get_empty_rc(void);
     
 int liblinphone_tester_copy_file(const char *from, const char *to);
 char * generate_random_e164_phone_from_dial_plan(const LinphoneDialPlan *dialPlan);
+
+/* Local HTTP file sharing server, to be set as file transfer server of the cores. */
+typedef struct _FileServerStub FileServerStub;
+FileServerStub *file_server_stub_start(void);
+void file_server_stub_stop(FileServerStub *stub);
+int file_server_stub_get_port(const FileServerStub *stub);
+/* Closes the connection of the next download once this amount of the file has been sent. */
+void file_server_stub_drop_next_download(FileServerStub *stub, size_t after);
+/* Number of downloads that asked for a range of the file. */
+int file_server_stub_get_range_requests(const FileServerStub *stub);
+/* Closes the connection of the next chunk of an upload session once half of it has been received. */
+void file_server_stub_drop_next_upload_chunk(FileServerStub *stub);
+/* Number of chunks received in upload sessions, including the rejected ones. */
+int file_server_stub_get_upload_chunk_requests(const FileServerStub *stub);
+/* Number of upload sessions resumed by a client. */
+int file_server_stub_get_resumed_upload_sessions(const FileServerStub *stub);
+
+/* Builds an RLS NOTIFY multipart/related body with one active PIDF part for each of sip:user<i>@sip.example.org. */
+LinphoneContent *liblinphone_tester_create_rlmi_notify_body(LinphoneCore *lc, int nb_resources, int version, bool_t full_state);
 	
 #ifdef __cplusplus
 };
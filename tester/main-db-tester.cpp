@@ -17,6 +17,8 @@
  */
 
 #include "address/address.h"
+#include "chat/chat-room/server-group-chat-room-p.h"
+#include "conference/participant-p.h"
 #include "core/core-p.h"
 #include "db/main-db.h"
 #include "event-log/events.h"
@@ -52,7 +54,7 @@ public:
 		linphone_core_manager_destroy(mCoreManager);
 	}
 
-	const MainDb &getMainDb () {
+	MainDb &getMainDb () {
 		return *L_GET_PRIVATE(mCoreManager->lc->cppPtr)->mainDb;
 	}
 
@@ -62,6 +64,159 @@ private:
 
 // -----------------------------------------------------------------------------
 
+LINPHONE_BEGIN_NAMESPACE
+
+// Friend of ServerGroupChatRoomPrivate, the tests only see the queue through it.
+class ServerChatRoomProvider {
+public:
+	ServerChatRoomProvider (int maxMessages, int memoryMessages) : mMaxMessages(maxMessages), mMemoryMessages(memoryMessages) {
+		mCoreManager = linphone_core_manager_create("marie_rc");
+		start();
+
+		mChatRoom = make_shared<ServerGroupChatRoom>(
+			getCore(),
+			mConferenceAddress,
+			ChatRoom::CapabilitiesMask(ChatRoom::Capabilities::Conference),
+			ChatRoomParams::getDefaults(getCore()),
+			"Queued messages",
+			list<shared_ptr<Participant>>(),
+			0
+		);
+		L_GET_PRIVATE(getCore())->insertChatRoom(mChatRoom);
+		getMainDb().insertChatRoom(mChatRoom);
+	}
+
+	~ServerChatRoomProvider () {
+		mChatRoom = nullptr;
+		linphone_core_manager_destroy(mCoreManager);
+	}
+
+	// The chat room is loaded back from the database, with its participants and their devices.
+	void restart () {
+		mChatRoom = nullptr;
+		linphone_core_manager_reinit(mCoreManager);
+		start();
+		mChatRoom = static_pointer_cast<ServerGroupChatRoom>(getCore()->findChatRoom(getConferenceId()));
+		BC_ASSERT_PTR_NOT_NULL(mChatRoom.get());
+	}
+
+	IdentityAddress addDevice (const string &participantAddress, const string &deviceAddress, ParticipantDevice::State state) {
+		ServerGroupChatRoomPrivate *d = getPrivate();
+		shared_ptr<Participant> participant = d->addParticipant(IdentityAddress(participantAddress));
+		d->addParticipantDevice(participant, ParticipantDeviceIdentity(Address(deviceAddress), ""));
+		d->setParticipantDeviceState(findDevice(participantAddress, deviceAddress), state);
+		return IdentityAddress(deviceAddress);
+	}
+
+	shared_ptr<ParticipantDevice> findDevice (const string &participantAddress, const string &deviceAddress) const {
+		shared_ptr<Participant> participant = mChatRoom->findParticipant(IdentityAddress(participantAddress));
+		return participant ? L_GET_PRIVATE(participant)->findDevice(IdentityAddress(deviceAddress)) : nullptr;
+	}
+
+	void setDeviceState (const shared_ptr<ParticipantDevice> &device, ParticipantDevice::State state) {
+		getPrivate()->setParticipantDeviceState(device, state);
+	}
+
+	// Returns the storage id of the queued message.
+	long long queueMessage (const string &text) {
+		shared_ptr<ServerGroupChatRoomPrivate::Message> message = make_shared<ServerGroupChatRoomPrivate::Message>(
+			"sip:laure@sip.example.org", ContentType::PlainText, text, nullptr
+		);
+		getPrivate()->queueMessage(message);
+		return message->storageId;
+	}
+
+	bool popQueuedMessage (const IdentityAddress &deviceAddress, string *text = nullptr) {
+		ServerGroupChatRoomPrivate *d = getPrivate();
+		shared_ptr<ServerGroupChatRoomPrivate::Message> message = d->popQueuedMessage(deviceAddress, d->getDeviceQueue(deviceAddress));
+		if (!message)
+			return false;
+		if (text)
+			*text = message->content.getBodyAsUtf8String();
+		return true;
+	}
+
+	bool getQueueHead (const IdentityAddress &deviceAddress, long long &storageId, string &text) {
+		const ServerGroupChatRoomPrivate::DeviceQueue &deviceQueue = getPrivate()->getDeviceQueue(deviceAddress);
+		if (deviceQueue.messages.empty())
+			return false;
+		storageId = deviceQueue.messages.front()->storageId;
+		text = deviceQueue.messages.front()->content.getBodyAsUtf8String();
+		return true;
+	}
+
+	void flushDeviceQueue (const IdentityAddress &deviceAddress) {
+		getPrivate()->flushDeviceQueues({ deviceAddress });
+	}
+
+	void dispatchQueuedMessages () {
+		getPrivate()->dispatchQueuedMessages();
+	}
+
+	int getQueueSize (const IdentityAddress &deviceAddress) {
+		return int(getPrivate()->getDeviceQueue(deviceAddress).size);
+	}
+
+	int getQueueSizeInMemory (const IdentityAddress &deviceAddress) {
+		return int(getPrivate()->getDeviceQueue(deviceAddress).messages.size());
+	}
+
+	long long getLastReadStorageId (const IdentityAddress &deviceAddress) {
+		return getPrivate()->getDeviceQueue(deviceAddress).lastReadStorageId;
+	}
+
+	long long getLastRemovedStorageId (const IdentityAddress &deviceAddress) {
+		return getPrivate()->getDeviceQueue(deviceAddress).lastRemovedStorageId;
+	}
+
+	int getRemovedCount (const IdentityAddress &deviceAddress) {
+		return int(getPrivate()->getDeviceQueue(deviceAddress).removedCount);
+	}
+
+	shared_ptr<Core> getCore () const {
+		return mCoreManager->lc->cppPtr;
+	}
+
+	MainDb &getMainDb () const {
+		return *L_GET_PRIVATE(getCore())->mainDb;
+	}
+
+	ConferenceId getConferenceId () const {
+		return ConferenceId(mConferenceAddress, mConferenceAddress);
+	}
+
+	int getQueuedMessageCount () const {
+		return int(L_GET_PRIVATE(getCore())->serverQueuedMessageCount);
+	}
+
+private:
+	void start () {
+		LinphoneConfig *config = linphone_core_get_config(mCoreManager->lc);
+		linphone_core_enable_conference_server(mCoreManager->lc, TRUE);
+		linphone_config_set_int(config, "misc", "server_queue_max_messages", mMaxMessages);
+		linphone_config_set_int(config, "misc", "server_queue_memory_messages", mMemoryMessages);
+		linphone_core_manager_start(mCoreManager, false);
+	}
+
+	ServerGroupChatRoomPrivate *getPrivate () const {
+		return L_GET_PRIVATE(mChatRoom);
+	}
+
+	LinphoneCoreManager *mCoreManager;
+	const IdentityAddress mConferenceAddress = IdentityAddress("sip:queued-messages@sip.example.org");
+	shared_ptr<ServerGroupChatRoom> mChatRoom;
+	int mMaxMessages;
+	int mMemoryMessages;
+};
+
+LINPHONE_END_NAMESPACE
+
+static const char *paulineAddress = "sip:pauline@sip.example.org";
+static const char *paulinePhoneAddress = "sip:pauline@sip.example.org;gr=urn:uuid:5a4e2a3e-4c2b-4f7e-9d8b-0e2c4f6a1b01";
+static const char *paulineTabletAddress = "sip:pauline@sip.example.org;gr=urn:uuid:5a4e2a3e-4c2b-4f7e-9d8b-0e2c4f6a1b02";
+
+// -----------------------------------------------------------------------------
+
 static void get_events_count () {
 	MainDbProvider provider;
 	const MainDb &mainDb = provider.getMainDb();
@@ -185,12 +340,179 @@ static void get_conference_notified_events () {
 	}
 }
 
+static void server_queued_messages () {
+	MainDbProvider provider;
+	MainDb &mainDb = provider.getMainDb();
+	ConferenceId conferenceId(IdentityAddress("sip:test-3@sip.linphone.org"), IdentityAddress("sip:test-1@sip.linphone.org"));
+	IdentityAddress firstDevice("sip:device-1@sip.linphone.org");
+	IdentityAddress secondDevice("sip:device-2@sip.linphone.org");
+
+	time_t now = time(nullptr);
+	MainDb::ServerQueuedMessage message;
+	message.fromAddress = IdentityAddress("sip:test-3@sip.linphone.org");
+	message.contentType = "text/plain";
+	message.headers = "Priority: urgent\r\n";
+	message.creationTime = now;
+
+	message.body = "First";
+	long long firstId = mainDb.addServerQueuedMessage(conferenceId, message, { firstDevice, secondDevice });
+	message.body = "Second";
+	long long secondId = mainDb.addServerQueuedMessage(conferenceId, message, { firstDevice });
+	message.body = "Old";
+	message.creationTime = now - 3600;
+	long long oldId = mainDb.addServerQueuedMessage(conferenceId, message, { secondDevice });
+	BC_ASSERT_TRUE(firstId > 0 && firstId < secondId && secondId < oldId);
+
+	BC_ASSERT_EQUAL(mainDb.getServerQueuedMessageCount(conferenceId, firstDevice), 2, int, "%d");
+	BC_ASSERT_EQUAL(mainDb.getServerQueuedMessageCount(conferenceId, secondDevice), 2, int, "%d");
+
+	// Read back in batches.
+	list<MainDb::ServerQueuedMessage> messages = mainDb.getServerQueuedMessages(conferenceId, firstDevice, 0, 1);
+	if (BC_ASSERT_EQUAL((int)messages.size(), 1, int, "%d")) {
+		const MainDb::ServerQueuedMessage &first = messages.front();
+		BC_ASSERT_TRUE(first.storageId == firstId);
+		BC_ASSERT_TRUE(first.fromAddress == message.fromAddress);
+		BC_ASSERT_STRING_EQUAL(first.contentType.c_str(), "text/plain");
+		BC_ASSERT_STRING_EQUAL(first.body.c_str(), "First");
+		BC_ASSERT_STRING_EQUAL(first.headers.c_str(), "Priority: urgent\r\n");
+		BC_ASSERT_TRUE(first.creationTime == now);
+	}
+	messages = mainDb.getServerQueuedMessages(conferenceId, firstDevice, firstId, 10);
+	if (BC_ASSERT_EQUAL((int)messages.size(), 1, int, "%d"))
+		BC_ASSERT_STRING_EQUAL(messages.front().body.c_str(), "Second");
+
+	// Dispatched to the first device, the first message is still queued for the second one.
+	mainDb.deleteServerQueuedMessages(conferenceId, firstDevice, firstId);
+	BC_ASSERT_EQUAL(mainDb.getServerQueuedMessageCount(conferenceId, firstDevice), 1, int, "%d");
+	BC_ASSERT_EQUAL(mainDb.getServerQueuedMessageCount(conferenceId, secondDevice), 2, int, "%d");
+
+	mainDb.deleteExpiredServerQueuedMessages(conferenceId, now - 60);
+	messages = mainDb.getServerQueuedMessages(conferenceId, secondDevice, 0, 10);
+	if (BC_ASSERT_EQUAL((int)messages.size(), 1, int, "%d"))
+		BC_ASSERT_STRING_EQUAL(messages.front().body.c_str(), "First");
+
+	mainDb.deleteServerQueuedMessages(conferenceId, firstDevice);
+	mainDb.deleteServerQueuedMessages(conferenceId, secondDevice);
+	BC_ASSERT_EQUAL(mainDb.getServerQueuedMessageCount(conferenceId, firstDevice), 0, int, "%d");
+	BC_ASSERT_EQUAL(mainDb.getServerQueuedMessageCount(conferenceId, secondDevice), 0, int, "%d");
+}
+
+static void server_chat_room_queued_messages () {
+	ServerChatRoomProvider provider(0, 2);
+	MainDb &mainDb = provider.getMainDb();
+	IdentityAddress phone = provider.addDevice(paulineAddress, paulinePhoneAddress, ParticipantDevice::State::Joining);
+	IdentityAddress tablet = provider.addDevice(paulineAddress, paulineTabletAddress, ParticipantDevice::State::Present);
+
+	vector<long long> storageIds;
+	for (int i = 0; i < 5; i++)
+		storageIds.push_back(provider.queueMessage(Utils::toString(i)));
+
+	// Sent right away to the present device, nothing is stored for it.
+	BC_ASSERT_EQUAL(provider.getQueueSize(tablet), 0, int, "%d");
+	BC_ASSERT_EQUAL(mainDb.getServerQueuedMessageCount(provider.getConferenceId(), tablet), 0, int, "%d");
+
+	// Only the head of the queue is kept in memory, the following messages are spilled to the database.
+	BC_ASSERT_EQUAL(provider.getQueueSize(phone), 5, int, "%d");
+	BC_ASSERT_EQUAL(provider.getQueueSizeInMemory(phone), 2, int, "%d");
+	BC_ASSERT_TRUE(provider.getLastReadStorageId(phone) == storageIds[1]);
+	BC_ASSERT_EQUAL(mainDb.getServerQueuedMessageCount(provider.getConferenceId(), phone), 5, int, "%d");
+	BC_ASSERT_EQUAL(provider.getQueuedMessageCount(), 5, int, "%d");
+
+	// The spilled messages are read back in order as the head is popped.
+	for (int i = 0; i < 5; i++) {
+		string text;
+		if (BC_ASSERT_TRUE(provider.popQueuedMessage(phone, &text)))
+			BC_ASSERT_STRING_EQUAL(text.c_str(), Utils::toString(i).c_str());
+	}
+	BC_ASSERT_FALSE(provider.popQueuedMessage(phone));
+	BC_ASSERT_TRUE(provider.getLastRemovedStorageId(phone) == storageIds[4]);
+	BC_ASSERT_EQUAL(provider.getRemovedCount(phone), 5, int, "%d");
+	BC_ASSERT_EQUAL(provider.getQueuedMessageCount(), 0, int, "%d");
+
+	// The rows of the popped messages are deleted once flushed.
+	BC_ASSERT_EQUAL(mainDb.getServerQueuedMessageCount(provider.getConferenceId(), phone), 5, int, "%d");
+	provider.flushDeviceQueue(phone);
+	BC_ASSERT_EQUAL(mainDb.getServerQueuedMessageCount(provider.getConferenceId(), phone), 0, int, "%d");
+	BC_ASSERT_TRUE(provider.getLastRemovedStorageId(phone) == 0);
+	BC_ASSERT_EQUAL(provider.getRemovedCount(phone), 0, int, "%d");
+}
+
+static void server_chat_room_queued_messages_eviction () {
+	ServerChatRoomProvider provider(3, 2);
+	MainDb &mainDb = provider.getMainDb();
+	IdentityAddress phone = provider.addDevice(paulineAddress, paulinePhoneAddress, ParticipantDevice::State::Joining);
+
+	for (int i = 0; i < 5; i++)
+		provider.queueMessage(Utils::toString(i));
+
+	// The two oldest messages are dropped, and their rows deleted as a batch once as many as the head were removed.
+	BC_ASSERT_EQUAL(provider.getQueueSize(phone), 3, int, "%d");
+	BC_ASSERT_EQUAL(provider.getQueueSizeInMemory(phone), 0, int, "%d");
+	BC_ASSERT_TRUE(provider.getLastRemovedStorageId(phone) == 0);
+	BC_ASSERT_EQUAL(mainDb.getServerQueuedMessageCount(provider.getConferenceId(), phone), 3, int, "%d");
+	BC_ASSERT_EQUAL(provider.getQueuedMessageCount(), 3, int, "%d");
+
+	for (int i = 2; i < 5; i++) {
+		string text;
+		if (BC_ASSERT_TRUE(provider.popQueuedMessage(phone, &text)))
+			BC_ASSERT_STRING_EQUAL(text.c_str(), Utils::toString(i).c_str());
+	}
+	BC_ASSERT_EQUAL(provider.getQueueSize(phone), 0, int, "%d");
+}
+
+static void server_chat_room_queued_messages_after_restart () {
+	ServerChatRoomProvider provider(0, 2);
+	IdentityAddress phone = provider.addDevice(paulineAddress, paulinePhoneAddress, ParticipantDevice::State::Joining);
+
+	vector<long long> storageIds;
+	for (int i = 0; i < 4; i++)
+		storageIds.push_back(provider.queueMessage(Utils::toString(i)));
+
+	// The first message is deleted, the second one is popped but its row is not deleted yet.
+	provider.popQueuedMessage(phone);
+	provider.flushDeviceQueue(phone);
+	provider.popQueuedMessage(phone);
+	BC_ASSERT_TRUE(provider.getLastRemovedStorageId(phone) == storageIds[1]);
+	BC_ASSERT_EQUAL(provider.getQueuedMessageCount(), 2, int, "%d");
+
+	provider.restart();
+	MainDb &mainDb = provider.getMainDb();
+	shared_ptr<ParticipantDevice> device = provider.findDevice(paulineAddress, paulinePhoneAddress);
+	if (!BC_ASSERT_PTR_NOT_NULL(device.get()))
+		return;
+	BC_ASSERT_TRUE(device->getState() == ParticipantDevice::State::Joining);
+
+	// The second message comes back with the ones that were not popped, the head is read back from the database.
+	BC_ASSERT_EQUAL(provider.getQueueSize(phone), 3, int, "%d");
+	BC_ASSERT_EQUAL(provider.getQueueSizeInMemory(phone), 2, int, "%d");
+	BC_ASSERT_TRUE(provider.getLastReadStorageId(phone) == storageIds[2]);
+	BC_ASSERT_TRUE(provider.getLastRemovedStorageId(phone) == 0);
+	BC_ASSERT_EQUAL(provider.getQueuedMessageCount(), 3, int, "%d");
+	long long headStorageId = 0;
+	string headText;
+	if (BC_ASSERT_TRUE(provider.getQueueHead(phone, headStorageId, headText))) {
+		BC_ASSERT_TRUE(headStorageId == storageIds[1]);
+		BC_ASSERT_STRING_EQUAL(headText.c_str(), "1");
+	}
+
+	// Once the device is present, everything is dispatched and the rows are deleted.
+	provider.setDeviceState(device, ParticipantDevice::State::Present);
+	provider.dispatchQueuedMessages();
+	BC_ASSERT_EQUAL(provider.getQueueSize(phone), 0, int, "%d");
+	BC_ASSERT_EQUAL(mainDb.getServerQueuedMessageCount(provider.getConferenceId(), phone), 0, int, "%d");
+	BC_ASSERT_EQUAL(provider.getQueuedMessageCount(), 0, int, "%d");
+}
+
 test_t main_db_tests[] = {
 	TEST_NO_TAG("Get events count", get_events_count),
 	TEST_NO_TAG("Get messages count", get_messages_count),
 	TEST_NO_TAG("Get unread messages count", get_unread_messages_count),
 	TEST_NO_TAG("Get history", get_history),
-	TEST_NO_TAG("Get conference events", get_conference_notified_events)
+	TEST_NO_TAG("Get conference events", get_conference_notified_events),
+	TEST_NO_TAG("Server queued messages", server_queued_messages),
+	TEST_NO_TAG("Server chat room queued messages", server_chat_room_queued_messages),
+	TEST_NO_TAG("Server chat room queued messages eviction", server_chat_room_queued_messages_eviction),
+	TEST_NO_TAG("Server chat room queued messages after restart", server_chat_room_queued_messages_after_restart)
 };
 
 test_suite_t main_db_test_suite = {
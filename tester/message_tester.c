@@ -172,6 +172,97 @@ static void text_message_with_utf8(void) {
 	linphone_core_manager_destroy(pauline);
 }
 
+static void text_message_with_metrics(void) {
+	LinphoneCoreManager* marie = linphone_core_manager_new("marie_rc");
+	LinphoneCoreManager* pauline = linphone_core_manager_new( "pauline_tcp_rc");
+	char *report;
+
+	linphone_core_enable_metrics(pauline->lc, TRUE);
+	BC_ASSERT_TRUE(linphone_core_metrics_enabled(marie->lc));
+	linphone_core_reset_metrics(pauline->lc);
+
+	text_message_base(marie, pauline);
+
+	report = linphone_core_get_metrics_report(pauline->lc);
+	/*both cores of the process count in the same metrics*/
+	BC_ASSERT_PTR_NOT_NULL(strstr(report, "counter chat.messages.sent "));
+	BC_ASSERT_PTR_NULL(strstr(report, "counter chat.messages.sent 0\n"));
+	BC_ASSERT_PTR_NOT_NULL(strstr(report, "counter chat.messages.received "));
+	BC_ASSERT_PTR_NULL(strstr(report, "counter chat.messages.received 0\n"));
+	BC_ASSERT_PTR_NOT_NULL(strstr(report, "histogram core.iterate count="));
+	BC_ASSERT_PTR_NOT_NULL(strstr(report, "histogram sal.request count="));
+	ms_free(report);
+
+	linphone_core_reset_metrics(pauline->lc);
+	report = linphone_core_get_metrics_report(pauline->lc);
+	BC_ASSERT_PTR_NOT_NULL(strstr(report, "counter chat.messages.sent 0\n"));
+	ms_free(report);
+
+	linphone_core_enable_metrics(pauline->lc, FALSE);
+	BC_ASSERT_FALSE(linphone_core_metrics_enabled(pauline->lc));
+
+	linphone_core_manager_destroy(marie);
+	linphone_core_manager_destroy(pauline);
+}
+
+static void broadcast_chat_message(void) {
+	LinphoneCoreManager *marie = linphone_core_manager_create("marie_rc");
+	LinphoneCoreManager *pauline = linphone_core_manager_new("pauline_tcp_rc");
+	LinphoneChatMessageBroadcast *broadcast;
+	LinphoneChatMessageBroadcastStatus *status;
+	LinphoneChatRoom *pauline_room;
+	bctbx_list_t *peers = NULL;
+	bctbx_list_t *messages;
+	bctbx_list_t *it;
+
+	/* Smaller batches than peers, and a rate low enough for the messages to be paced. */
+	lp_config_set_int(linphone_core_get_config(marie->lc), "misc", "chat_broadcast_db_batch_size", 2);
+	lp_config_set_int(linphone_core_get_config(marie->lc), "misc", "chat_broadcast_rate", 5);
+	linphone_core_manager_start(marie, TRUE);
+
+	peers = bctbx_list_append(peers, linphone_address_clone(pauline->identity));
+	/* Not registered, these messages fail. */
+	peers = bctbx_list_append(peers, linphone_address_new("sip:broadcast-1@sip.example.org"));
+	peers = bctbx_list_append(peers, linphone_address_new("sip:broadcast-2@sip.example.org"));
+
+	broadcast = _linphone_core_broadcast_text_message(marie->lc, "Broadcast", peers);
+	bctbx_list_free_with_data(peers, (bctbx_list_free_func)linphone_address_unref);
+	status = _linphone_chat_message_broadcast_get_status(broadcast);
+
+	messages = _linphone_chat_message_broadcast_get_chat_messages(broadcast);
+	if (BC_ASSERT_EQUAL((int)bctbx_list_size(messages), 3, int, "%d")) {
+		/* All the messages are stored before the first one is sent. */
+		for (it = messages; it; it = bctbx_list_next(it)) {
+			LinphoneChatRoom *room = linphone_chat_message_get_chat_room((LinphoneChatMessage *)bctbx_list_get_data(it));
+			BC_ASSERT_EQUAL(linphone_chat_room_get_history_size(room), 1, int, "%d");
+		}
+		BC_ASSERT_GREATER(status->queued, 0, int, "%d");
+	}
+	bctbx_list_free(messages);
+
+	BC_ASSERT_TRUE(wait_for_until(pauline->lc, marie->lc, &pauline->stat.number_of_LinphoneMessageReceived, 1, 10000));
+	BC_ASSERT_TRUE(wait_for_until(pauline->lc, marie->lc, &status->done, 1, 10000));
+
+	BC_ASSERT_EQUAL(status->total, 3, int, "%d");
+	BC_ASSERT_EQUAL(status->queued, 0, int, "%d");
+	BC_ASSERT_EQUAL(status->in_progress, 0, int, "%d");
+	BC_ASSERT_EQUAL(status->delivered, 1, int, "%d");
+	BC_ASSERT_EQUAL(status->not_delivered, 2, int, "%d");
+
+	pauline_room = linphone_core_get_chat_room(pauline->lc, marie->identity);
+	if (BC_ASSERT_PTR_NOT_NULL(pauline_room)) {
+		bctbx_list_t *history = linphone_chat_room_get_history(pauline_room, 0);
+		if (BC_ASSERT_EQUAL((int)bctbx_list_size(history), 1, int, "%d"))
+			BC_ASSERT_STRING_EQUAL(linphone_chat_message_get_text((LinphoneChatMessage *)bctbx_list_get_data(history)), "Broadcast");
+		bctbx_list_free_with_data(history, (bctbx_list_free_func)linphone_chat_message_unref);
+	}
+
+	_linphone_chat_message_broadcast_free(broadcast);
+
+	linphone_core_manager_destroy(marie);
+	linphone_core_manager_destroy(pauline);
+}
+
 static void text_message_within_call_dialog(void) {
 	LinphoneCoreManager* marie = linphone_core_manager_new("marie_rc");
 	LinphoneCoreManager* pauline = linphone_core_manager_new( "pauline_tcp_rc");
@@ -541,6 +632,172 @@ static void transfer_message_upload_cancelled(void) {
 	}
 }
 
+/* Downloads through a local file server that supports ranges. Either the first download is cut and retried from where it
+ * stopped, or it fails and the message is downloaded again by a restarted core which resumes from the state stored in
+ * the database, or the file is fetched as several ranges at once. */
+static void transfer_message_download_resumed_base(bool_t after_failure, int segments) {
+	char *send_filepath = bc_tester_res("sounds/sintel_trailer_opus_h264.mkv");
+	char *receive_filepath = bc_tester_file("receive_file.dump");
+	FileServerStub *server = file_server_stub_start();
+	LinphoneCoreManager *marie;
+	LinphoneCoreManager *pauline;
+	LinphoneChatRoom *chat_room;
+	LinphoneChatMessage *msg;
+	char *server_url;
+
+	if (!BC_ASSERT_PTR_NOT_NULL(server)) goto end;
+	marie = linphone_core_manager_new("marie_rc");
+	pauline = linphone_core_manager_new("pauline_tcp_rc");
+
+	/* Remove any previously downloaded file */
+	remove(receive_filepath);
+
+	server_url = bctbx_strdup_printf("http://127.0.0.1:%d/upload", file_server_stub_get_port(server));
+	linphone_core_set_file_transfer_server(pauline->lc, server_url);
+	bctbx_free(server_url);
+	if (segments > 1) {
+		lp_config_set_int(linphone_core_get_config(marie->lc), "misc", "file_transfer_download_segments", segments);
+		lp_config_set_int(linphone_core_get_config(marie->lc), "misc", "file_transfer_download_segment_min_size", 128 * 1024);
+	} else {
+		if (after_failure)
+			lp_config_set_int(linphone_core_get_config(marie->lc), "misc", "file_transfer_download_max_retries", 0);
+		file_server_stub_drop_next_download(server, 300000);
+	}
+
+	chat_room = linphone_core_get_chat_room(pauline->lc, marie->identity);
+	msg = create_file_transfer_message_from_sintel_trailer(chat_room);
+	linphone_chat_message_send(msg);
+
+	BC_ASSERT_TRUE(wait_for_until(pauline->lc, marie->lc, &marie->stat.number_of_LinphoneMessageReceivedWithFile, 1, 60000));
+	if (marie->stat.last_received_chat_message) {
+		LinphoneChatMessage *recv_msg = marie->stat.last_received_chat_message;
+		LinphoneChatMessageCbs *cbs = linphone_chat_message_get_callbacks(recv_msg);
+		linphone_chat_message_cbs_set_msg_state_changed(cbs, liblinphone_tester_chat_message_msg_state_changed);
+		linphone_chat_message_cbs_set_file_transfer_progress_indication(cbs, file_transfer_progress_indication);
+		linphone_chat_message_set_file_transfer_filepath(recv_msg, receive_filepath);
+		linphone_chat_message_download_file(recv_msg);
+
+		if (after_failure) {
+			LinphoneChatRoom *marie_cr;
+			bctbx_list_t *history;
+
+			BC_ASSERT_TRUE(wait_for_until(pauline->lc, marie->lc, &marie->stat.number_of_LinphoneMessageNotDelivered, 1, 10000));
+			BC_ASSERT_EQUAL(file_server_stub_get_range_requests(server), 0, int, "%d");
+
+			/* Restart the core so that the download can only resume from what was stored in the database. */
+			linphone_core_manager_restart(marie, TRUE);
+			marie_cr = linphone_core_get_chat_room(marie->lc, pauline->identity);
+			history = linphone_chat_room_get_history(marie_cr, 1);
+			if (BC_ASSERT_PTR_NOT_NULL(history)) {
+				recv_msg = (LinphoneChatMessage *)history->data;
+				cbs = linphone_chat_message_get_callbacks(recv_msg);
+				linphone_chat_message_cbs_set_msg_state_changed(cbs, liblinphone_tester_chat_message_msg_state_changed);
+				linphone_chat_message_cbs_set_file_transfer_progress_indication(cbs, file_transfer_progress_indication);
+				linphone_chat_message_set_file_transfer_filepath(recv_msg, receive_filepath);
+				linphone_chat_message_download_file(recv_msg);
+				bctbx_list_free_with_data(history, (bctbx_list_free_func)linphone_chat_message_unref);
+			}
+		}
+
+		if (BC_ASSERT_TRUE(wait_for_until(pauline->lc, marie->lc, &marie->stat.number_of_LinphoneMessageFileTransferDone, 1, 55000)))
+			compare_files(send_filepath, receive_filepath);
+		/* Each segment is a range, otherwise only the download that resumed the file asks for one. */
+		BC_ASSERT_EQUAL(file_server_stub_get_range_requests(server), segments > 1 ? segments : 1, int, "%d");
+		/* The counters of a restarted core start again from zero. */
+		BC_ASSERT_EQUAL(marie->stat.number_of_LinphoneMessageNotDelivered, 0, int, "%d");
+	}
+
+	linphone_chat_message_unref(msg);
+	linphone_core_manager_destroy(marie);
+	linphone_core_manager_destroy(pauline);
+
+end:
+	remove(receive_filepath);
+	bc_free(send_filepath);
+	bc_free(receive_filepath);
+	if (server) file_server_stub_stop(server);
+}
+
+static void transfer_message_download_resumed_after_io_error(void) {
+	transfer_message_download_resumed_base(FALSE, 1);
+}
+
+static void transfer_message_download_resumed_after_failure(void) {
+	transfer_message_download_resumed_base(TRUE, 1);
+}
+
+static void transfer_message_download_in_parallel_segments(void) {
+	transfer_message_download_resumed_base(FALSE, 4);
+}
+
+static void transfer_message_upload_in_chunks_base(bool_t after_failure) {
+	char *send_filepath = bc_tester_res("sounds/sintel_trailer_opus_h264.mkv");
+	char *receive_filepath = bc_tester_file("receive_file.dump");
+	FileServerStub *server = file_server_stub_start();
+	LinphoneCoreManager *marie;
+	LinphoneCoreManager *pauline;
+	LinphoneChatRoom *chat_room;
+	LinphoneChatMessage *msg;
+	char *server_url;
+
+	if (!BC_ASSERT_PTR_NOT_NULL(server)) goto end;
+	marie = linphone_core_manager_new("marie_rc");
+	pauline = linphone_core_manager_new("pauline_tcp_rc");
+
+	/* Remove any previously downloaded file */
+	remove(receive_filepath);
+
+	server_url = bctbx_strdup_printf("http://127.0.0.1:%d/upload", file_server_stub_get_port(server));
+	linphone_core_set_file_transfer_server(pauline->lc, server_url);
+	bctbx_free(server_url);
+	lp_config_set_int(linphone_core_get_config(pauline->lc), "misc", "file_transfer_upload_chunk_size", 128 * 1024);
+	if (after_failure)
+		lp_config_set_int(linphone_core_get_config(pauline->lc), "misc", "file_transfer_upload_max_retries", 0);
+	file_server_stub_drop_next_upload_chunk(server);
+
+	chat_room = linphone_core_get_chat_room(pauline->lc, marie->identity);
+	msg = create_file_transfer_message_from_sintel_trailer(chat_room);
+	linphone_chat_message_send(msg);
+
+	if (after_failure) {
+		BC_ASSERT_TRUE(wait_for_until(pauline->lc, marie->lc, &pauline->stat.number_of_LinphoneMessageNotDelivered, 1, 10000));
+		/* The upload session is kept, sending the message again resumes it. */
+		linphone_chat_message_send(msg);
+	}
+
+	BC_ASSERT_TRUE(wait_for_until(pauline->lc, marie->lc, &marie->stat.number_of_LinphoneMessageReceivedWithFile, 1, 60000));
+	BC_ASSERT_EQUAL(file_server_stub_get_resumed_upload_sessions(server), after_failure ? 1 : 0, int, "%d");
+	BC_ASSERT_GREATER(file_server_stub_get_upload_chunk_requests(server), 2, int, "%d");
+	if (marie->stat.last_received_chat_message) {
+		LinphoneChatMessage *recv_msg = marie->stat.last_received_chat_message;
+		LinphoneChatMessageCbs *cbs = linphone_chat_message_get_callbacks(recv_msg);
+		linphone_chat_message_cbs_set_msg_state_changed(cbs, liblinphone_tester_chat_message_msg_state_changed);
+		linphone_chat_message_set_file_transfer_filepath(recv_msg, receive_filepath);
+		linphone_chat_message_download_file(recv_msg);
+
+		if (BC_ASSERT_TRUE(wait_for_until(pauline->lc, marie->lc, &marie->stat.number_of_LinphoneMessageFileTransferDone, 1, 55000)))
+			compare_files(send_filepath, receive_filepath);
+	}
+
+	linphone_chat_message_unref(msg);
+	linphone_core_manager_destroy(marie);
+	linphone_core_manager_destroy(pauline);
+
+end:
+	remove(receive_filepath);
+	bc_free(send_filepath);
+	bc_free(receive_filepath);
+	if (server) file_server_stub_stop(server);
+}
+
+static void transfer_message_upload_in_chunks_resumed_after_io_error(void) {
+	transfer_message_upload_in_chunks_base(FALSE);
+}
+
+static void transfer_message_upload_in_chunks_resumed_after_failure(void) {
+	transfer_message_upload_in_chunks_base(TRUE);
+}
+
 static void transfer_message_download_cancelled(void) {
 	LinphoneChatRoom* chat_room;
 	LinphoneChatMessage* msg;
@@ -2381,6 +2638,8 @@ static void migration_from_messages_db (void) {
 test_t message_tests[] = {
 	TEST_NO_TAG("Text message", text_message),
 	TEST_NO_TAG("Text message UTF8", text_message_with_utf8),
+	TEST_NO_TAG("Text message with metrics", text_message_with_metrics),
+	TEST_NO_TAG("Broadcast chat message", broadcast_chat_message),
 	TEST_NO_TAG("Text message with credentials from auth callback", text_message_with_credential_from_auth_callback),
 	TEST_NO_TAG("Text message with privacy", text_message_with_privacy),
 	TEST_NO_TAG("Text message compatibility mode", text_message_compatibility_mode),
@@ -2398,6 +2657,11 @@ test_t message_tests[] = {
 	TEST_NO_TAG("Transfer message with upload io error", transfer_message_with_upload_io_error),
 	TEST_NO_TAG("Transfer message with download io error", transfer_message_with_download_io_error),
 	TEST_NO_TAG("Transfer message upload cancelled", transfer_message_upload_cancelled),
+	TEST_NO_TAG("Transfer message download resumed after io error", transfer_message_download_resumed_after_io_error),
+	TEST_NO_TAG("Transfer message download resumed after failure", transfer_message_download_resumed_after_failure),
+	TEST_NO_TAG("Transfer message download in parallel segments", transfer_message_download_in_parallel_segments),
+	TEST_NO_TAG("Transfer message upload in chunks resumed after io error", transfer_message_upload_in_chunks_resumed_after_io_error),
+	TEST_NO_TAG("Transfer message upload in chunks resumed after failure", transfer_message_upload_in_chunks_resumed_after_failure),
 	TEST_NO_TAG("Transfer message download cancelled", transfer_message_download_cancelled),
 	TEST_NO_TAG("Transfer 2 messages simultaneously", file_transfer_2_messages_simultaneously),
 	TEST_NO_TAG("Transfer using external body URL", file_transfer_using_external_body_url),
@@ -408,6 +408,87 @@ static void simple_subscribe_with_friend_from_rc(void) {
 	linphone_core_manager_destroy(pauline);
 }
 
+static void presence_model_lookup_for_uri_or_tel(void) {
+	LinphoneCoreManager *marie = linphone_core_manager_new("marie_rc");
+	LinphoneFriend *lf = linphone_core_create_friend_with_address(marie->lc, "sip:pauline@sip.example.org");
+	LinphonePresenceModel *online = linphone_presence_model_new_with_activity(LinphonePresenceActivityOnline, NULL);
+	LinphonePresenceModel *away = linphone_presence_model_new_with_activity(LinphonePresenceActivityAway, NULL);
+
+	BC_ASSERT_PTR_NULL(linphone_friend_get_presence_model_for_uri_or_tel(lf, "sip:pauline@sip.example.org"));
+	linphone_friend_set_presence_model_for_uri_or_tel(lf, "sip:pauline@sip.example.org", online);
+	BC_ASSERT_PTR_EQUAL(linphone_friend_get_presence_model_for_uri_or_tel(lf, "sip:pauline@sip.example.org"), online);
+	/* Another spelling of the same address must resolve to the same model */
+	BC_ASSERT_PTR_EQUAL(linphone_friend_get_presence_model_for_uri_or_tel(lf, "\"Pauline\" <sip:pauline@sip.example.org;transport=tcp>"), online);
+	BC_ASSERT_PTR_NULL(linphone_friend_get_presence_model_for_uri_or_tel(lf, "sip:marie@sip.example.org"));
+
+	/* Updating through another spelling must replace the existing model, not add a new one */
+	linphone_friend_set_presence_model_for_uri_or_tel(lf, "sip:pauline@sip.example.org;transport=tls", away);
+	BC_ASSERT_PTR_EQUAL(linphone_friend_get_presence_model_for_uri_or_tel(lf, "sip:pauline@sip.example.org"), away);
+	BC_ASSERT_PTR_EQUAL(linphone_friend_get_presence_model_for_uri_or_tel(lf, "sip:pauline@sip.example.org;transport=tls"), away);
+
+	linphone_presence_model_unref(online);
+	linphone_presence_model_unref(away);
+	linphone_friend_unref(lf);
+	linphone_core_manager_destroy(marie);
+}
+
+/* Full-state then partial-state NOTIFY of an RLS for a list of friends. */
+static void presence_list_notify(void) {
+	const int nb_resources = 100;
+	LinphoneCoreManager *marie = linphone_core_manager_new("marie_rc");
+	LinphoneFriendList *list = linphone_core_create_friend_list(marie->lc);
+	LinphoneContent *full_state_body = liblinphone_tester_create_rlmi_notify_body(marie->lc, nb_resources, 0, TRUE);
+	LinphoneContent *partial_state_body = liblinphone_tester_create_rlmi_notify_body(marie->lc, nb_resources / 10, 1, FALSE);
+	LinphoneFriend *lf;
+	int i;
+
+	for (i = 0; i < nb_resources; i++) {
+		char *uri = ms_strdup_printf("sip:user%d@sip.example.org", i);
+		lf = linphone_core_create_friend_with_address(marie->lc, uri);
+		linphone_friend_enable_subscribes(lf, FALSE);
+		linphone_friend_list_add_local_friend(list, lf);
+		linphone_friend_unref(lf);
+		ms_free(uri);
+	}
+
+	linphone_friend_list_notify_presence_received(list, NULL, full_state_body);
+	BC_ASSERT_EQUAL(linphone_friend_list_get_expected_notification_version(list), 1, int, "%d");
+	linphone_friend_list_notify_presence_received(list, NULL, partial_state_body);
+	BC_ASSERT_EQUAL(linphone_friend_list_get_expected_notification_version(list), 2, int, "%d");
+
+	lf = linphone_friend_list_find_friend_by_uri(list, "sip:user1@sip.example.org");
+	if (BC_ASSERT_PTR_NOT_NULL(lf)) {
+		BC_ASSERT_TRUE(linphone_friend_is_presence_received(lf));
+		BC_ASSERT_STRING_EQUAL(linphone_friend_get_name(lf), "User 1");
+		BC_ASSERT_EQUAL(linphone_friend_get_consolidated_presence(lf), LinphoneConsolidatedPresenceBusy, int, "%d");
+	}
+	lf = linphone_friend_list_find_friend_by_uri(list, "sip:user0@sip.example.org");
+	if (BC_ASSERT_PTR_NOT_NULL(lf)) {
+		BC_ASSERT_EQUAL(linphone_friend_get_consolidated_presence(lf), LinphoneConsolidatedPresenceBusy, int, "%d");
+	}
+
+	linphone_content_unref(full_state_body);
+	linphone_content_unref(partial_state_body);
+	linphone_friend_list_unref(list);
+	linphone_core_manager_destroy(marie);
+}
+
+static void presence_model_lookup_for_uri_or_tel_before_core(void) {
+	LinphoneCoreManager *marie = linphone_core_manager_new("marie_rc");
+	/* Not associated to any core yet, the normalized key cannot be computed */
+	LinphoneFriend *lf = linphone_friend_new_with_address("sip:pauline@sip.example.org");
+	LinphonePresenceModel *online = linphone_presence_model_new_with_activity(LinphonePresenceActivityOnline, NULL);
+
+	linphone_friend_set_presence_model_for_uri_or_tel(lf, "sip:pauline@sip.example.org", online);
+	linphone_friend_list_add_friend(linphone_core_get_default_friend_list(marie->lc), lf);
+	BC_ASSERT_PTR_EQUAL(linphone_friend_get_presence_model_for_uri_or_tel(lf, "sip:pauline@sip.example.org"), online);
+	BC_ASSERT_PTR_EQUAL(linphone_friend_get_presence_model_for_uri_or_tel(lf, "\"Pauline\" <sip:pauline@sip.example.org;transport=tcp>"), online);
+
+	linphone_presence_model_unref(online);
+	linphone_friend_unref(lf);
+	linphone_core_manager_destroy(marie);
+}
+
 test_t presence_tests[] = {
 	TEST_ONE_TAG("Simple Subscribe", simple_subscribe,"presence"),
 	TEST_ONE_TAG("Simple Subscribe with early NOTIFY", simple_subscribe_with_early_notify,"presence"),
@@ -418,6 +499,9 @@ test_t presence_tests[] = {
 	TEST_ONE_TAG("App managed presence failure", subscribe_failure_handle_by_app,"presence"),
 	TEST_NO_TAG("Presence SUBSCRIBE forked", subscribe_presence_forked),
 	TEST_NO_TAG("Presence SUBSCRIBE expired", subscribe_presence_expired),
+	TEST_ONE_TAG("Presence model lookup for uri or tel", presence_model_lookup_for_uri_or_tel, "presence"),
+	TEST_ONE_TAG("Presence model lookup for uri or tel before core", presence_model_lookup_for_uri_or_tel_before_core, "presence"),
+	TEST_ONE_TAG("Presence list NOTIFY", presence_list_notify, "presence"),
 };
 
 test_suite_t presence_test_suite = {"Presence", NULL, NULL, liblinphone_tester_before_each, liblinphone_tester_after_each,
@@ -20,6 +20,7 @@
 #include "liblinphone_tester.h"
 #include "tester_utils.h"
 #include "quality_reporting.h"
+#include "ortp/port.h"
 
 /* Avoid crash if x is NULL on libc versions <4.5.26 */
 #define __strstr(x, y) ((x==NULL)?NULL:strstr(x,y))
@@ -384,6 +385,183 @@ static void quality_reporting_sent_using_custom_route(void) {
 	linphone_core_manager_destroy(pauline);
 }
 
+/* Minimal SIP over TCP collector: answers 200 OK to every request and counts the reports it receives */
+typedef struct _CollectorStub {
+	ortp_socket_t sock;
+	int port;
+	volatile bool_t running;
+	int nb_publish;
+	int nb_reports;
+	int nb_batched_publish;
+	ms_thread_t thread;
+} CollectorStub;
+
+static bool_t collector_stub_header_is(const char *line, const char *name, const char *compact_name) {
+	return strncasecmp(line, name, strlen(name)) == 0 || strncasecmp(line, compact_name, strlen(compact_name)) == 0;
+}
+
+static int collector_stub_count(const char *str, const char *pattern) {
+	int count = 0;
+	while ((str = strstr(str, pattern)) != NULL) {
+		count++;
+		str += strlen(pattern);
+	}
+	return count;
+}
+
+/* Returns the size of the message handled, 0 if it is not complete yet */
+static size_t collector_stub_handle_message(CollectorStub *stub, ortp_socket_t client, char *msg) {
+	char *headers_end = strstr(msg, "\r\n\r\n");
+	char *line;
+	char *next;
+	size_t content_length = 0;
+	size_t msg_size;
+	char response[4096];
+	size_t response_size = 0;
+
+	if (!headers_end) return 0;
+	for (line = strstr(msg, "\r\n") + 2; line < headers_end; line = strstr(line, "\r\n") + 2) {
+		if (collector_stub_header_is(line, "Content-Length:", "l:"))
+			content_length = (size_t)atoi(strchr(line, ':') + 1);
+	}
+	msg_size = (size_t)(headers_end - msg) + 4 + content_length;
+	if (strlen(msg) < msg_size) return 0;
+	if (strncmp(msg, "SIP/2.0", 7) == 0) return msg_size;
+
+	if (strncmp(msg, "PUBLISH ", 8) == 0) {
+		char saved = msg[msg_size];
+		int nb_reports;
+		msg[msg_size] = '\0';
+		nb_reports = collector_stub_count(headers_end, "CallID: ");
+		msg[msg_size] = saved;
+		stub->nb_reports += nb_reports;
+		if (nb_reports > 1) stub->nb_batched_publish++;
+		stub->nb_publish++;
+	}
+
+	response_size += (size_t)snprintf(response, sizeof(response), "SIP/2.0 200 OK\r\n");
+	for (line = strstr(msg, "\r\n") + 2; line < headers_end; line = next + 2) {
+		next = strstr(line, "\r\n");
+		if (collector_stub_header_is(line, "Via:", "v:") || collector_stub_header_is(line, "From:", "f:")
+			|| collector_stub_header_is(line, "Call-ID:", "i:") || collector_stub_header_is(line, "CSeq:", "CSeq:")) {
+			response_size += (size_t)snprintf(response + response_size, sizeof(response) - response_size, "%.*s\r\n", (int)(next - line), line);
+		} else if (collector_stub_header_is(line, "To:", "t:")) {
+			response_size += (size_t)snprintf(response + response_size, sizeof(response) - response_size, "%.*s;tag=collector-stub\r\n", (int)(next - line), line);
+		}
+	}
+	response_size += (size_t)snprintf(response + response_size, sizeof(response) - response_size,
+		"SIP-ETag: collector-stub\r\nExpires: 60\r\nContent-Length: 0\r\n\r\n");
+	send(client, response, (int)response_size, 0);
+	return msg_size;
+}
+
+static void *collector_stub_run(void *data) {
+	CollectorStub *stub = (CollectorStub *)data;
+	ortp_socket_t client = (ortp_socket_t)-1;
+	char buf[65536];
+	size_t buf_size = 0;
+
+	while (stub->running) {
+		fd_set fds;
+		struct timeval tv = { 0, 20000 };
+		ortp_socket_t maxfd = stub->sock;
+
+		FD_ZERO(&fds);
+		FD_SET(stub->sock, &fds);
+		if (client != (ortp_socket_t)-1) {
+			FD_SET(client, &fds);
+			if (client > maxfd) maxfd = client;
+		}
+		if (select((int)maxfd + 1, &fds, NULL, NULL, &tv) <= 0) continue;
+		if (FD_ISSET(stub->sock, &fds)) {
+			/* belle-sip reuses its connection, a new one replaces the previous */
+			if (client != (ortp_socket_t)-1) close_socket(client);
+			client = accept(stub->sock, NULL, NULL);
+			buf_size = 0;
+		} else if (client != (ortp_socket_t)-1 && FD_ISSET(client, &fds)) {
+			size_t handled;
+			int len = (int)recv(client, buf + buf_size, (int)(sizeof(buf) - buf_size - 1), 0);
+			if (len <= 0) {
+				close_socket(client);
+				client = (ortp_socket_t)-1;
+				continue;
+			}
+			buf_size += (size_t)len;
+			buf[buf_size] = '\0';
+			while ((handled = collector_stub_handle_message(stub, client, buf)) > 0) {
+				memmove(buf, buf + handled, buf_size - handled + 1);
+				buf_size -= handled;
+			}
+		}
+	}
+	if (client != (ortp_socket_t)-1) close_socket(client);
+	return NULL;
+}
+
+static CollectorStub *collector_stub_start(void) {
+	CollectorStub *stub = ms_new0(CollectorStub, 1);
+	struct sockaddr_in addr;
+	socklen_t addrlen = sizeof(addr);
+
+	stub->sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = 0;
+	if (stub->sock == (ortp_socket_t)-1
+		|| bind(stub->sock, (struct sockaddr *)&addr, sizeof(addr)) != 0
+		|| listen(stub->sock, 4) != 0
+		|| getsockname(stub->sock, (struct sockaddr *)&addr, &addrlen) != 0) {
+		ms_error("Cannot start collector stub");
+		if (stub->sock != (ortp_socket_t)-1) close_socket(stub->sock);
+		ms_free(stub);
+		return NULL;
+	}
+	stub->port = ntohs(addr.sin_port);
+	stub->running = TRUE;
+	ms_thread_create(&stub->thread, NULL, collector_stub_run, stub);
+	return stub;
+}
+
+static void collector_stub_stop(CollectorStub *stub) {
+	stub->running = FALSE;
+	ms_thread_join(stub->thread, NULL);
+	close_socket(stub->sock);
+	ms_free(stub);
+}
+
+static void quality_reporting_interval_reports_batched (void) {
+	LinphoneCoreManager *marie = linphone_core_manager_new("marie_rc_rtcp_xr");
+	LinphoneCoreManager *pauline = linphone_core_manager_new("pauline_rc_rtcp_xr");
+	CollectorStub *stub = collector_stub_start();
+	LinphoneCall *call_marie = NULL;
+	char collector_uri[64];
+
+	if (!BC_ASSERT_PTR_NOT_NULL(stub)) goto end;
+	snprintf(collector_uri, sizeof(collector_uri), "sip:collector@127.0.0.1:%i;transport=tcp", stub->port);
+	/* Interval reports are only published two by two, the delay being too long to ever expire */
+	linphone_config_set_int(linphone_core_get_config(marie->lc), "misc", "quality_reporting_batch_delay", 600000);
+	linphone_config_set_int(linphone_core_get_config(marie->lc), "misc", "quality_reporting_batch_max_reports", 2);
+
+	if (create_call_for_quality_reporting_tests(marie, pauline, &call_marie, NULL, NULL, NULL)) {
+		linphone_reporting_set_on_report_send(call_marie, on_report_send_mandatory);
+		linphone_proxy_config_set_quality_reporting_collector(linphone_call_get_dest_proxy(call_marie), collector_uri);
+		linphone_proxy_config_set_quality_reporting_interval(linphone_call_get_dest_proxy(call_marie), 1);
+
+		BC_ASSERT_TRUE(wait_for_until(marie->lc, pauline->lc, &stub->nb_batched_publish, 1, 60000));
+		BC_ASSERT_TRUE(wait_for_until(marie->lc, pauline->lc, &marie->stat.number_of_LinphonePublishOk, 1, 10000));
+		BC_ASSERT_GREATER(stub->nb_reports, 1, int, "%d");
+		end_call(marie, pauline);
+		/* The session report is not batched */
+		BC_ASSERT_TRUE(wait_for_until(marie->lc, pauline->lc, &marie->stat.number_of_LinphonePublishOk, 2, 10000));
+	}
+	collector_stub_stop(stub);
+
+end:
+	linphone_core_manager_destroy(marie);
+	linphone_core_manager_destroy(pauline);
+}
+
 #ifdef VIDEO_ENABLED
 static void quality_reporting_interval_report_video_and_rtt (void) {
 	LinphoneCoreManager *marie = linphone_core_manager_new("marie_rc_rtcp_xr");
@@ -496,6 +674,7 @@ test_t quality_reporting_tests[] = {
 	TEST_NO_TAG("Call term session report invalid if missing mandatory fields", quality_reporting_invalid_report),
 	TEST_NO_TAG("Call term session report sent if call ended normally", quality_reporting_at_call_termination),
 	TEST_NO_TAG("Interval report if interval is configured", quality_reporting_interval_report),
+	TEST_NO_TAG("Interval reports batched to the collector", quality_reporting_interval_reports_batched),
 	#ifdef VIDEO_ENABLED
 		TEST_NO_TAG("Interval report if interval is configured with video and realtime text", quality_reporting_interval_report_video_and_rtt),
 		TEST_NO_TAG("Session report sent if video stopped during call", quality_reporting_session_report_if_video_stopped),
@@ -135,6 +135,58 @@ static void core_init_stop_start_test(void) {
 	}
 }
 
+static void core_callbacks_call_stats_updated(LinphoneCore *lc, LinphoneCall *call, const LinphoneCallStats *stats) {
+	int *count = (int *)linphone_core_cbs_get_user_data(linphone_core_get_current_callbacks(lc));
+	(*count)++;
+}
+
+static void core_callbacks_call_stats_updated_once(LinphoneCore *lc, LinphoneCall *call, const LinphoneCallStats *stats) {
+	core_callbacks_call_stats_updated(lc, call, stats);
+	linphone_core_remove_callbacks(lc, linphone_core_get_current_callbacks(lc));
+}
+
+static void core_callbacks_dispatch_test(void) {
+	LinphoneCore *lc = linphone_factory_create_core_3(linphone_factory_get(), NULL, liblinphone_tester_get_empty_rc(), system_context);
+	LinphoneCoreCbs *registered_cbs = linphone_factory_create_core_cbs(linphone_factory_get());
+	LinphoneCoreCbs *set_later_cbs = linphone_factory_create_core_cbs(linphone_factory_get());
+	LinphoneCoreCbs *once_cbs = linphone_factory_create_core_cbs(linphone_factory_get());
+	int registered_count = 0;
+	int set_later_count = 0;
+	int once_count = 0;
+
+	linphone_core_cbs_set_call_stats_updated(registered_cbs, core_callbacks_call_stats_updated);
+	linphone_core_cbs_set_user_data(registered_cbs, &registered_count);
+	linphone_core_add_callbacks(lc, registered_cbs);
+	linphone_core_cbs_set_user_data(set_later_cbs, &set_later_count);
+	linphone_core_add_callbacks(lc, set_later_cbs);
+	linphone_core_cbs_set_call_stats_updated(once_cbs, core_callbacks_call_stats_updated_once);
+	linphone_core_cbs_set_user_data(once_cbs, &once_count);
+	linphone_core_add_callbacks(lc, once_cbs);
+
+	_linphone_core_notify_call_stats_updated(lc, NULL, NULL);
+	BC_ASSERT_EQUAL(registered_count, 1, int, "%d");
+	BC_ASSERT_EQUAL(set_later_count, 0, int, "%d");
+	BC_ASSERT_EQUAL(once_count, 1, int, "%d");
+
+	/* A callback set after the registration must be notified as well. */
+	linphone_core_cbs_set_call_stats_updated(set_later_cbs, core_callbacks_call_stats_updated);
+	_linphone_core_notify_call_stats_updated(lc, NULL, NULL);
+	BC_ASSERT_EQUAL(registered_count, 2, int, "%d");
+	BC_ASSERT_EQUAL(set_later_count, 1, int, "%d");
+	BC_ASSERT_EQUAL(once_count, 1, int, "%d");
+
+	linphone_core_remove_callbacks(lc, registered_cbs);
+	_linphone_core_notify_call_stats_updated(lc, NULL, NULL);
+	BC_ASSERT_EQUAL(registered_count, 2, int, "%d");
+	BC_ASSERT_EQUAL(set_later_count, 2, int, "%d");
+
+	linphone_core_remove_callbacks(lc, set_later_cbs);
+	linphone_core_cbs_unref(registered_cbs);
+	linphone_core_cbs_unref(set_later_cbs);
+	linphone_core_cbs_unref(once_cbs);
+	linphone_core_unref(lc);
+}
+
 static void linphone_address_test(void) {
 	LinphoneAddress *address;
 
@@ -278,6 +330,80 @@ static void linphone_lpconfig_from_file_zerolen_value(void){
 	lp_config_destroy(conf);
 }
 
+/* Removal must keep the index of the sections and items consistent with the ordered lists used for writing. */
+static void linphone_lpconfig_indexed_lookup(void) {
+	LpConfig *conf = lp_config_new_from_buffer("");
+	char section[32];
+	char key[32];
+	int i, j;
+
+	for (i = 0; i < 5; i++) {
+		snprintf(section, sizeof(section), "proxy_%i", i);
+		for (j = 0; j < 10; j++) {
+			snprintf(key, sizeof(key), "key_%i", j);
+			lp_config_set_int(conf, section, key, i * 10 + j);
+		}
+	}
+	BC_ASSERT_EQUAL(lp_config_get_int(conf, "proxy_4", "key_9", -1), 49, int, "%d");
+
+	lp_config_set_string(conf, "proxy_3", "key_4", NULL);
+	BC_ASSERT_EQUAL(lp_config_get_int(conf, "proxy_3", "key_4", -1), -1, int, "%d");
+	lp_config_clean_section(conf, "proxy_3");
+	BC_ASSERT_FALSE(lp_config_has_section(conf, "proxy_3"));
+	BC_ASSERT_EQUAL(lp_config_get_int(conf, "proxy_3", "key_5", -1), -1, int, "%d");
+	lp_config_set_int(conf, "proxy_3", "key_5", 42);
+	BC_ASSERT_EQUAL(lp_config_get_int(conf, "proxy_3", "key_5", -1), 42, int, "%d");
+
+	lp_config_destroy(conf);
+}
+
+static void linphone_lpconfig_write_behind(void) {
+	char *rc_path = bc_tester_file("lpconfig_write_behind_rc");
+	LpConfig *conf;
+	int i;
+
+	unlink(rc_path);
+	conf = lp_config_new(rc_path);
+	if (!BC_ASSERT_PTR_NOT_NULL(conf)) goto end;
+	lp_config_enable_write_behind(conf, TRUE);
+	BC_ASSERT_TRUE(lp_config_write_behind_enabled(conf));
+
+	/* Many syncs in a row are coalesced by the background writer, only the last state matters. */
+	lp_config_set_string(conf, "unchanged", "key", "value");
+	for (i = 0; i < 200; i++) {
+		lp_config_set_int(conf, "counter", "value", i);
+		BC_ASSERT_EQUAL(lp_config_sync(conf), 0, int, "%d");
+		BC_ASSERT_FALSE(lp_config_needs_commit(conf));
+	}
+	lp_config_set_string(conf, "counter", "last", "yes");
+	BC_ASSERT_TRUE(lp_config_needs_commit(conf));
+	BC_ASSERT_EQUAL(lp_config_flush(conf), 0, int, "%d");
+	BC_ASSERT_FALSE(lp_config_needs_commit(conf));
+	lp_config_destroy(conf);
+
+	conf = lp_config_new(rc_path);
+	if (!BC_ASSERT_PTR_NOT_NULL(conf)) goto end;
+	BC_ASSERT_EQUAL(lp_config_get_int(conf, "counter", "value", -1), 199, int, "%d");
+	BC_ASSERT_STRING_EQUAL(lp_config_get_string(conf, "counter", "last", NULL), "yes");
+	BC_ASSERT_STRING_EQUAL(lp_config_get_string(conf, "unchanged", "key", NULL), "value");
+
+	/* Destroying the config must write what is still pending. */
+	lp_config_enable_write_behind(conf, TRUE);
+	lp_config_set_string(conf, "unchanged", "key", "changed");
+	lp_config_sync(conf);
+	lp_config_destroy(conf);
+
+	conf = lp_config_new(rc_path);
+	if (!BC_ASSERT_PTR_NOT_NULL(conf)) goto end;
+	BC_ASSERT_STRING_EQUAL(lp_config_get_string(conf, "unchanged", "key", NULL), "changed");
+	BC_ASSERT_EQUAL(lp_config_get_int(conf, "counter", "value", -1), 199, int, "%d");
+	lp_config_destroy(conf);
+
+end:
+	unlink(rc_path);
+	bc_free(rc_path);
+}
+
 static void linphone_lpconfig_from_xml_zerolen_value(void){
 	const char* zero_xml_file = "remote_zero_length_params_rc";
 	char* xml_path = ms_strdup_printf("%s/rcfiles/%s", bc_tester_get_resource_dir_prefix(), zero_xml_file);
@@ -1563,12 +1689,15 @@ test_t setup_tests[] = {
 	TEST_NO_TAG("Linphone core init/uninit", core_init_test),
 	TEST_NO_TAG("Linphone core init/stop/uninit", core_init_stop_test),
 	TEST_NO_TAG("Linphone core init/stop/start/uninit", core_init_stop_start_test),
+	TEST_NO_TAG("Linphone core callbacks dispatch", core_callbacks_dispatch_test),
 	TEST_NO_TAG("Linphone random transport port",core_sip_transport_test),
 	TEST_NO_TAG("Linphone interpret url", linphone_interpret_url_test),
 	TEST_NO_TAG("LPConfig from buffer", linphone_lpconfig_from_buffer),
 	TEST_NO_TAG("LPConfig zero_len value from buffer", linphone_lpconfig_from_buffer_zerolen_value),
 	TEST_NO_TAG("LPConfig zero_len value from file", linphone_lpconfig_from_file_zerolen_value),
 	TEST_NO_TAG("LPConfig zero_len value from XML", linphone_lpconfig_from_xml_zerolen_value),
+	TEST_NO_TAG("LPConfig indexed lookup", linphone_lpconfig_indexed_lookup),
+	TEST_NO_TAG("LPConfig write-behind sync", linphone_lpconfig_write_behind),
 	TEST_NO_TAG("Chat room", chat_room_test),
 	TEST_NO_TAG("Devices reload", devices_reload_test),
 	TEST_NO_TAG("Codec usability", codec_usability_test),
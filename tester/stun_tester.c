@@ -26,6 +26,40 @@
 static const char *stun_address = "stun.linphone.org";
 
 
+typedef struct _StunTestsResult {
+	int done;
+	int ping_time;
+	char audio_addr[LINPHONE_IPADDR_SIZE];
+	int audio_port;
+	char video_addr[LINPHONE_IPADDR_SIZE];
+	int video_port;
+	char text_addr[LINPHONE_IPADDR_SIZE];
+	int text_port;
+} StunTestsResult;
+
+static void stun_tests_done(LinphoneCore *lc, int ping_time, const char *audio_addr, int audio_port,
+	const char *video_addr, int video_port, const char *text_addr, int text_port, void *user_data) {
+	StunTestsResult *result = (StunTestsResult *)user_data;
+	result->ping_time = ping_time;
+	strncpy(result->audio_addr, audio_addr, sizeof(result->audio_addr) - 1);
+	result->audio_port = audio_port;
+	strncpy(result->video_addr, video_addr, sizeof(result->video_addr) - 1);
+	result->video_port = video_port;
+	strncpy(result->text_addr, text_addr, sizeof(result->text_addr) - 1);
+	result->text_port = text_port;
+	result->done++;
+}
+
+/* The discovery runs from the core main loop, the tester iterates it until the result comes */
+static int run_stun_tests(LinphoneCore *lc, int audio_port, int video_port, int text_port, StunTestsResult *result) {
+	memset(result, 0, sizeof(*result));
+	result->ping_time = -1;
+	if (linphone_run_stun_tests(lc, audio_port, video_port, text_port, stun_tests_done, result) < 0)
+		return -1;
+	BC_ASSERT_TRUE(wait_for_until(lc, NULL, &result->done, 1, 5000));
+	return result->ping_time;
+}
+
 static size_t test_stun_encode(char **buffer)
 {
 	MSStunMessage *req = ms_stun_binding_request_create();
@@ -49,12 +83,7 @@ static void linphone_stun_test_grab_ip(void) {
 	LinphoneCoreManager* lc_stun = linphone_core_manager_new2("stun_rc", FALSE);
 	int ping_time;
 	int tmp = 0;
-	char audio_addr[LINPHONE_IPADDR_SIZE] = { 0 };
-	char video_addr[LINPHONE_IPADDR_SIZE] = { 0 };
-	char text_addr[LINPHONE_IPADDR_SIZE] = { 0 };
-	int audio_port = 0;
-	int video_port = 0;
-	int text_port = 0;
+	StunTestsResult result;
 
 	/* This test verifies the very basic STUN support of liblinphone, which is deprecated.
 	 * It works only in IPv4 mode and there is no plan to make it work over ipv6. */
@@ -66,30 +95,297 @@ static void linphone_stun_test_grab_ip(void) {
 	BC_ASSERT_STRING_EQUAL(stun_address, linphone_core_get_stun_server(lc_stun->lc));
 	wait_for(lc_stun->lc, lc_stun->lc, &tmp, 1);
 
-	ping_time = linphone_run_stun_tests(lc_stun->lc, 7078, 9078, 11078, audio_addr, &audio_port, video_addr, &video_port, text_addr, &text_port);
+	ping_time = run_stun_tests(lc_stun->lc, 7078, 9078, 11078, &result);
 	BC_ASSERT(ping_time != -1);
 
 	ms_message("Round trip to STUN: %d ms", ping_time);
 
-	BC_ASSERT(audio_addr[0] != '\0');
-	BC_ASSERT(audio_port != 0);
+	BC_ASSERT(result.audio_addr[0] != '\0');
+	BC_ASSERT(result.audio_port != 0);
 #ifdef VIDEO_ENABLED
-	BC_ASSERT(video_addr[0] != '\0');
-	BC_ASSERT(video_port != 0);
+	BC_ASSERT(result.video_addr[0] != '\0');
+	BC_ASSERT(result.video_port != 0);
 #endif
-	BC_ASSERT(text_addr[0] != '\0');
-	BC_ASSERT(text_port != 0);
+	BC_ASSERT(result.text_addr[0] != '\0');
+	BC_ASSERT(result.text_port != 0);
 
-	ms_message("STUN test result: local audio port maps to %s:%i", audio_addr, audio_port);
+	ms_message("STUN test result: local audio port maps to %s:%i", result.audio_addr, result.audio_port);
 #ifdef VIDEO_ENABLED
-	ms_message("STUN test result: local video port maps to %s:%i", video_addr, video_port);
+	ms_message("STUN test result: local video port maps to %s:%i", result.video_addr, result.video_port);
 #endif
-	ms_message("STUN test result: local text port maps to %s:%i", text_addr, text_port);
+	ms_message("STUN test result: local text port maps to %s:%i", result.text_addr, result.text_port);
 
 end:
 	linphone_core_manager_destroy(lc_stun);
 }
 
+typedef struct _LocalStunServer {
+	ortp_socket_t sock;
+	int port;
+	bool_t drop_first_transmission;
+	bool_t silent;
+	ms_thread_t thread;
+	/* What follows is shared with the server thread */
+	ms_mutex_t lock;
+	bool_t running;
+	int nb_requests;
+	int nb_dropped;
+	UInt96 seen[32];
+	int nb_seen;
+} LocalStunServer;
+
+static bool_t local_stun_server_is_running(LocalStunServer *server) {
+	bool_t running;
+	ms_mutex_lock(&server->lock);
+	running = server->running;
+	ms_mutex_unlock(&server->lock);
+	return running;
+}
+
+static int local_stun_server_get_nb_requests(LocalStunServer *server) {
+	int nb_requests;
+	ms_mutex_lock(&server->lock);
+	nb_requests = server->nb_requests;
+	ms_mutex_unlock(&server->lock);
+	return nb_requests;
+}
+
+static int local_stun_server_get_nb_dropped(LocalStunServer *server) {
+	int nb_dropped;
+	ms_mutex_lock(&server->lock);
+	nb_dropped = server->nb_dropped;
+	ms_mutex_unlock(&server->lock);
+	return nb_dropped;
+}
+
+static bool_t local_stun_server_first_seen(LocalStunServer *server, const UInt96 *tr_id) {
+	int i;
+	for (i = 0; i < server->nb_seen; i++) {
+		if (memcmp(&server->seen[i], tr_id, sizeof(UInt96)) == 0) return FALSE;
+	}
+	if (server->nb_seen < (int)(sizeof(server->seen) / sizeof(server->seen[0])))
+		server->seen[server->nb_seen++] = *tr_id;
+	return TRUE;
+}
+
+static void *local_stun_server_run(void *data) {
+	LocalStunServer *server = (LocalStunServer *)data;
+	char buf[MS_STUN_MAX_MESSAGE_SIZE];
+	while (local_stun_server_is_running(server)) {
+		struct sockaddr_in from;
+		socklen_t fromlen = sizeof(from);
+		fd_set fds;
+		struct timeval tv = { 0, 20000 };
+		ssize_t len;
+		MSStunMessage *req;
+
+		FD_ZERO(&fds);
+		FD_SET(server->sock, &fds);
+		if (select((int)server->sock + 1, &fds, NULL, NULL, &tv) <= 0) continue;
+		len = recvfrom(server->sock, buf, sizeof(buf), 0, (struct sockaddr *)&from, &fromlen);
+		if (len <= 0) continue;
+		req = ms_stun_message_create_from_buffer_parsing((uint8_t *)buf, len);
+		if (!req) continue;
+		ms_mutex_lock(&server->lock);
+		server->nb_requests++;
+		ms_mutex_unlock(&server->lock);
+		if (!server->silent) {
+			UInt96 tr_id = ms_stun_message_get_tr_id(req);
+			bool_t dropped = FALSE;
+			if (server->drop_first_transmission) {
+				ms_mutex_lock(&server->lock);
+				if (local_stun_server_first_seen(server, &tr_id)) {
+					server->nb_dropped++;
+					dropped = TRUE;
+				}
+				ms_mutex_unlock(&server->lock);
+			}
+			if (!dropped) {
+				MSStunMessage *resp = ms_stun_binding_success_response_create();
+				MSStunAddress mapped;
+				char *out = NULL;
+				size_t outlen;
+				memset(&mapped, 0, sizeof(mapped));
+				mapped.family = MS_STUN_ADDR_FAMILY_IPV4;
+				mapped.ip.v4.addr = ntohl(from.sin_addr.s_addr);
+				mapped.ip.v4.port = ntohs(from.sin_port);
+				ms_stun_message_set_tr_id(resp, tr_id);
+				ms_stun_message_set_xor_mapped_address(resp, mapped);
+				outlen = ms_stun_message_encode(resp, &out);
+				if (outlen > 0) bctbx_sendto(server->sock, out, outlen, 0, (struct sockaddr *)&from, fromlen);
+				if (out) ms_free(out);
+				ms_stun_message_destroy(resp);
+			}
+		}
+		ms_stun_message_destroy(req);
+	}
+	return NULL;
+}
+
+static LocalStunServer *local_stun_server_start(bool_t drop_first_transmission, bool_t silent) {
+	LocalStunServer *server = ms_new0(LocalStunServer, 1);
+	struct sockaddr_in addr;
+	socklen_t addrlen = sizeof(addr);
+
+	server->sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = 0;
+	if (server->sock == (ortp_socket_t)-1
+		|| bind(server->sock, (struct sockaddr *)&addr, sizeof(addr)) != 0
+		|| getsockname(server->sock, (struct sockaddr *)&addr, &addrlen) != 0) {
+		ms_error("Cannot start local STUN server");
+		if (server->sock != (ortp_socket_t)-1) close_socket(server->sock);
+		ms_free(server);
+		return NULL;
+	}
+	server->port = ntohs(addr.sin_port);
+	server->drop_first_transmission = drop_first_transmission;
+	server->silent = silent;
+	server->running = TRUE;
+	ms_mutex_init(&server->lock, NULL);
+	ms_thread_create(&server->thread, NULL, local_stun_server_run, server);
+	return server;
+}
+
+static void local_stun_server_stop(LocalStunServer *server) {
+	ms_mutex_lock(&server->lock);
+	server->running = FALSE;
+	ms_mutex_unlock(&server->lock);
+	ms_thread_join(server->thread, NULL);
+	ms_mutex_destroy(&server->lock);
+	close_socket(server->sock);
+	ms_free(server);
+}
+
+static int run_stun_tests_against_local_server(LinphoneCoreManager *mgr, LocalStunServer *server, uint64_t *elapsed) {
+	char server_addr[64];
+	StunTestsResult result;
+	uint64_t start;
+	int ping_time;
+
+	linphone_core_enable_ipv6(mgr->lc, FALSE);
+	snprintf(server_addr, sizeof(server_addr), "127.0.0.1:%i", server->port);
+	linphone_core_set_stun_server(mgr->lc, server_addr);
+	linphone_config_set_int(linphone_core_get_config(mgr->lc), "net", "stun_rto", 100);
+	linphone_config_set_int(linphone_core_get_config(mgr->lc), "net", "stun_discovery_timeout", 1000);
+
+	start = ms_get_cur_time_ms();
+	ping_time = run_stun_tests(mgr->lc, 17078, 19078, 21078, &result);
+	*elapsed = ms_get_cur_time_ms() - start;
+	if (ping_time >= 0) {
+		BC_ASSERT_STRING_EQUAL(result.audio_addr, "127.0.0.1");
+		BC_ASSERT_EQUAL(result.audio_port, 17078, int, "%i");
+	}
+	return ping_time;
+}
+
+static void linphone_stun_test_retransmission(void) {
+	LinphoneCoreManager *mgr = linphone_core_manager_new2("empty_rc", FALSE);
+	LocalStunServer *server = local_stun_server_start(TRUE, FALSE);
+	uint64_t elapsed = 0;
+
+	if (!BC_ASSERT_PTR_NOT_NULL(server)) goto end;
+	/* Every first transmission is lost, the discovery only succeeds thanks to retransmissions */
+	BC_ASSERT_NOT_EQUAL(run_stun_tests_against_local_server(mgr, server, &elapsed), -1, int, "%i");
+	BC_ASSERT_GREATER(local_stun_server_get_nb_dropped(server), 1, int, "%i");
+	BC_ASSERT_GREATER(local_stun_server_get_nb_requests(server), local_stun_server_get_nb_dropped(server), int, "%i");
+	BC_ASSERT_LOWER((int)elapsed, 1000, int, "%i");
+	local_stun_server_stop(server);
+
+end:
+	linphone_core_manager_destroy(mgr);
+}
+
+static void linphone_stun_test_timeout(void) {
+	LinphoneCoreManager *mgr = linphone_core_manager_new2("empty_rc", FALSE);
+	LocalStunServer *server = local_stun_server_start(FALSE, TRUE);
+	uint64_t elapsed = 0;
+
+	if (!BC_ASSERT_PTR_NOT_NULL(server)) goto end;
+	/* An unresponsive server makes the discovery give up at the configured timeout instead of blocking */
+	BC_ASSERT_EQUAL(run_stun_tests_against_local_server(mgr, server, &elapsed), -1, int, "%i");
+	BC_ASSERT_GREATER(local_stun_server_get_nb_requests(server), 1, int, "%i");
+	BC_ASSERT_LOWER((int)elapsed, 1500, int, "%i");
+	local_stun_server_stop(server);
+
+end:
+	linphone_core_manager_destroy(mgr);
+}
+
+static void linphone_stun_test_stopped_with_core(void) {
+	LinphoneCoreManager *mgr = linphone_core_manager_new2("empty_rc", FALSE);
+	LocalStunServer *server = local_stun_server_start(FALSE, TRUE);
+	StunTestsResult result;
+	char server_addr[64];
+	int i;
+
+	if (!BC_ASSERT_PTR_NOT_NULL(server)) goto end;
+	linphone_core_enable_ipv6(mgr->lc, FALSE);
+	snprintf(server_addr, sizeof(server_addr), "127.0.0.1:%i", server->port);
+	linphone_core_set_stun_server(mgr->lc, server_addr);
+	memset(&result, 0, sizeof(result));
+	if (!BC_ASSERT_EQUAL(linphone_run_stun_tests(mgr->lc, 17078, 19078, 21078, stun_tests_done, &result), 0, int, "%i"))
+		goto stop_server;
+	for (i = 0; (i < 100) && (local_stun_server_get_nb_requests(server) == 0); i++)
+		ms_usleep(10000);
+	BC_ASSERT_GREATER(local_stun_server_get_nb_requests(server), 0, int, "%i");
+
+	/* The server never answers: the discovery is cancelled when the core stops, its callback is not called */
+	linphone_core_manager_destroy(mgr);
+	mgr = NULL;
+	BC_ASSERT_EQUAL(result.done, 0, int, "%i");
+
+stop_server:
+	local_stun_server_stop(server);
+end:
+	if (mgr) linphone_core_manager_destroy(mgr);
+}
+
+static void call_deferred_until_stun_discovery(void) {
+	LinphoneCoreManager *marie = linphone_core_manager_new("marie_rc");
+	LinphoneCoreManager *pauline = linphone_core_manager_new(transport_supported(LinphoneTransportTls) ? "pauline_rc" : "pauline_tcp_rc");
+	LocalStunServer *server = local_stun_server_start(TRUE, FALSE);
+	LinphoneNatPolicy *nat_policy;
+	LinphoneCall *marie_call;
+	char server_addr[64];
+
+	if (!BC_ASSERT_PTR_NOT_NULL(server)) goto end;
+	linphone_core_enable_ipv6(marie->lc, FALSE);
+	snprintf(server_addr, sizeof(server_addr), "127.0.0.1:%i", server->port);
+	nat_policy = linphone_core_create_nat_policy(marie->lc);
+	linphone_nat_policy_enable_stun(nat_policy, TRUE);
+	linphone_nat_policy_set_stun_server(nat_policy, server_addr);
+	linphone_core_set_nat_policy(marie->lc, nat_policy);
+	linphone_nat_policy_unref(nat_policy);
+	linphone_config_set_int(linphone_core_get_config(marie->lc), "net", "stun_rto", 100);
+	BC_ASSERT_TRUE(wait_for_stun_resolution(marie));
+
+	/* The first transmissions are lost, the INVITE must wait for the retransmissions to be answered */
+	marie_call = linphone_core_invite_address(marie->lc, pauline->identity);
+	if (!BC_ASSERT_PTR_NOT_NULL(marie_call)) goto stop_server;
+	BC_ASSERT_EQUAL(linphone_call_get_state(marie_call), LinphoneCallOutgoingInit, int, "%i");
+	BC_ASSERT_EQUAL(marie->stat.number_of_LinphoneCallOutgoingProgress, 0, int, "%i");
+
+	BC_ASSERT_TRUE(wait_for(marie->lc, pauline->lc, &pauline->stat.number_of_LinphoneCallIncomingReceived, 1));
+	BC_ASSERT_GREATER(local_stun_server_get_nb_dropped(server), 0, int, "%i");
+	BC_ASSERT_GREATER(local_stun_server_get_nb_requests(server), local_stun_server_get_nb_dropped(server), int, "%i");
+	/* The offer carries the address mapped by the STUN server */
+	BC_ASSERT_STRING_EQUAL(_linphone_call_get_local_desc(marie_call)->streams[0].rtp_addr, "127.0.0.1");
+
+	linphone_call_accept(linphone_core_get_current_call(pauline->lc));
+	BC_ASSERT_TRUE(wait_for(marie->lc, pauline->lc, &marie->stat.number_of_LinphoneCallStreamsRunning, 1));
+	BC_ASSERT_TRUE(wait_for(marie->lc, pauline->lc, &pauline->stat.number_of_LinphoneCallStreamsRunning, 1));
+	end_call(marie, pauline);
+
+stop_server:
+	local_stun_server_stop(server);
+end:
+	linphone_core_manager_destroy(pauline);
+	linphone_core_manager_destroy(marie);
+}
+
 static void configure_nat_policy(LinphoneCore *lc, bool_t turn_enabled) {
 	const char *username = "liblinphone-tester";
 	const char *password = "retset-enohpnilbil";
@@ -242,6 +538,10 @@ static void relayed_ice_turn_to_ice_stun_call(void) {
 test_t stun_tests[] = {
 	TEST_ONE_TAG("Basic Stun test (Ping/public IP)", linphone_stun_test_grab_ip, "STUN"),
 	TEST_ONE_TAG("STUN encode", linphone_stun_test_encode, "STUN"),
+	TEST_ONE_TAG("STUN retransmission", linphone_stun_test_retransmission, "STUN"),
+	TEST_ONE_TAG("STUN discovery timeout", linphone_stun_test_timeout, "STUN"),
+	TEST_ONE_TAG("STUN discovery stopped with the core", linphone_stun_test_stopped_with_core, "STUN"),
+	TEST_ONE_TAG("Call deferred until STUN discovery", call_deferred_until_stun_discovery, "STUN"),
 	TEST_TWO_TAGS("Basic ICE+TURN call", basic_ice_turn_call, "ICE", "TURN"),
 	TEST_TWO_TAGS("Basic IPv6 ICE+TURN call", basic_ipv6_ice_turn_call, "ICE", "TURN"),
 #ifdef VIDEO_ENABLED
@@ -24,6 +24,7 @@
 #include "liblinphone_tester.h"
 #include <bctoolbox/tester.h>
 #include "tester_utils.h"
+#include "ortp/port.h"
 
 #define SKIP_PULSEAUDIO 1
 
@@ -1985,4 +1986,414 @@ int liblinphone_tester_copy_file(const char *from, const char *to)
     return 0;
 }
 
+/* Minimal HTTP file sharing server: an empty POST is answered 204, a multipart POST stores its file part and a GET
+ * returns the last file stored, or the requested range of it. An empty POST announcing an Upload-Length opens an
+ * upload session instead, the file is then sent in chunks with PATCH requests. It runs on its own thread so that it
+ * does not compete with the cores main loop. */
+typedef struct _FileServerClient {
+	ortp_socket_t sock;
+	char *buf;
+	size_t size;
+	size_t capacity;
+} FileServerClient;
+
+#define FILE_SERVER_MAX_CLIENTS 8
+
+struct _FileServerStub {
+	ortp_socket_t sock;
+	int port;
+	volatile bool_t running;
+	FileServerClient clients[FILE_SERVER_MAX_CLIENTS];
+	char *file;
+	size_t file_size;
+	volatile bool_t drop_next_download;
+	volatile size_t drop_after;
+	volatile int range_requests;
+	char upload_session[32];
+	size_t upload_offset;
+	int upload_session_count;
+	volatile bool_t drop_next_upload_chunk;
+	volatile int upload_chunk_requests;
+	volatile int resumed_upload_sessions;
+	ms_thread_t thread;
+};
+
+static const char *file_server_find(const char *data, size_t size, const char *pattern) {
+	size_t len = strlen(pattern);
+	size_t i;
+	for (i = 0; i + len <= size; i++) {
+		if (memcmp(data + i, pattern, len) == 0) return data + i;
+	}
+	return NULL;
+}
+
+static const char *file_server_rfind(const char *data, size_t size, const char *pattern) {
+	size_t len = strlen(pattern);
+	size_t i;
+	if (size < len) return NULL;
+	for (i = size - len + 1; i > 0; i--) {
+		if (memcmp(data + i - 1, pattern, len) == 0) return data + i - 1;
+	}
+	return NULL;
+}
+
+static void file_server_send(ortp_socket_t sock, const char *data, size_t size) {
+	while (size > 0) {
+		int len = (int)send(sock, data, (int)size, 0);
+		if (len <= 0) return;
+		data += len;
+		size -= (size_t)len;
+	}
+}
+
+static void file_server_close_client(FileServerClient *client) {
+	close_socket(client->sock);
+	client->sock = (ortp_socket_t)-1;
+	client->size = 0;
+}
+
+/* Decodes a complete chunked body in place, returns its encoded size or 0 if it is not complete yet. */
+static size_t file_server_dechunk(char *body, size_t available, size_t *decoded_size) {
+	size_t pos = 0;
+	size_t decoded = 0;
+	for (;;) {
+		const char *line_end = file_server_find(body + pos, available - pos, "\r\n");
+		size_t chunk_size;
+		if (!line_end) return 0;
+		chunk_size = (size_t)strtoul(body + pos, NULL, 16);
+		pos = (size_t)(line_end - body) + 2;
+		if (available - pos < chunk_size + 2) return 0;
+		memmove(body + decoded, body + pos, chunk_size);
+		decoded += chunk_size;
+		pos += chunk_size + 2;
+		if (chunk_size == 0) break;
+	}
+	*decoded_size = decoded;
+	return pos;
+}
+
+static void file_server_send_file_info(FileServerStub *stub, FileServerClient *client) {
+	char xml[1024];
+	char response[2048];
+	snprintf(xml, sizeof(xml),
+		"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\r\n"
+		"<file xmlns=\"urn:gsma:params:xml:ns:rcs:rcs:fthttp\">\r\n"
+		"<file-info type=\"file\">\r\n"
+		"<file-size>%lu</file-size>\r\n"
+		"<file-name>file_server_stub.bin</file-name>\r\n"
+		"<content-type>application/octet-stream</content-type>\r\n"
+		"<data url=\"http://127.0.0.1:%d/download\" until=\"2100-01-01T00:00:00Z\"/>\r\n"
+		"</file-info>\r\n"
+		"</file>",
+		(unsigned long)stub->file_size, stub->port);
+	snprintf(response, sizeof(response), "HTTP/1.1 200 OK\r\nContent-Type: application/vnd.gsma.rcs-ft-http+xml\r\nContent-Length: %lu\r\n\r\n%s",
+		(unsigned long)strlen(xml), xml);
+	file_server_send(client->sock, response, strlen(response));
+}
+
+static void file_server_send_upload_offset(FileServerStub *stub, FileServerClient *client, int code, const char *reason) {
+	char response[256];
+	snprintf(response, sizeof(response), "HTTP/1.1 %d %s\r\nUpload-Session: %s\r\nUpload-Offset: %lu\r\nContent-Length: 0\r\n\r\n",
+		code, reason, stub->upload_session, (unsigned long)stub->upload_offset);
+	file_server_send(client->sock, response, strlen(response));
+}
+
+/* Returns the size of the request handled, 0 if it is not complete yet or if the connection has been closed */
+static size_t file_server_handle_request(FileServerStub *stub, FileServerClient *client) {
+	const char *headers_end = file_server_find(client->buf, client->size, "\r\n\r\n");
+	const char *line;
+	char *body;
+	size_t content_length = 0;
+	size_t request_size;
+	bool_t chunked = FALSE;
+	const char *range = NULL;
+	const char *upload_length = NULL;
+	const char *upload_session = NULL;
+	const char *upload_offset = NULL;
+	char response[2048];
+
+	if (!headers_end) return 0;
+	for (line = strstr(client->buf, "\r\n") + 2; line < headers_end; line = strstr(line, "\r\n") + 2) {
+		if (strncasecmp(line, "Content-Length:", 15) == 0)
+			content_length = (size_t)atoi(line + 15);
+		else if (strncasecmp(line, "Transfer-Encoding:", 18) == 0)
+			chunked = strncasecmp(line + 18 + strspn(line + 18, " "), "chunked", 7) == 0;
+		else if (strncasecmp(line, "Range:", 6) == 0)
+			range = line + 6 + strspn(line + 6, " ");
+		else if (strncasecmp(line, "Upload-Length:", 14) == 0)
+			upload_length = line + 14 + strspn(line + 14, " ");
+		else if (strncasecmp(line, "Upload-Session:", 15) == 0)
+			upload_session = line + 15 + strspn(line + 15, " ");
+		else if (strncasecmp(line, "Upload-Offset:", 14) == 0)
+			upload_offset = line + 14 + strspn(line + 14, " ");
+	}
+	body = client->buf + (headers_end - client->buf) + 4;
+	request_size = (size_t)(body - client->buf);
+	if (chunked) {
+		size_t encoded_size = file_server_dechunk(body, client->size - request_size, &content_length);
+		if (encoded_size == 0) return 0;
+		request_size += encoded_size;
+	} else {
+		if (client->size - request_size < content_length) return 0;
+		request_size += content_length;
+	}
+
+	if (strncmp(client->buf, "GET ", 4) == 0) {
+		size_t start = 0;
+		size_t end = stub->file_size;
+		size_t size;
+		if (range) {
+			unsigned long range_start = 0;
+			unsigned long range_end = 0;
+			int count = sscanf(range, "bytes=%lu-%lu", &range_start, &range_end);
+			start = MIN((size_t)range_start, stub->file_size);
+			if (count == 2) end = MIN((size_t)range_end + 1, stub->file_size);
+			if (end < start) end = start;
+			stub->range_requests++;
+			snprintf(response, sizeof(response),
+				"HTTP/1.1 206 Partial Content\r\nContent-Type: application/octet-stream\r\nContent-Range: bytes %lu-%lu/%lu\r\nContent-Length: %lu\r\n\r\n",
+				(unsigned long)start, (unsigned long)(end - 1), (unsigned long)stub->file_size, (unsigned long)(end - start));
+		} else {
+			snprintf(response, sizeof(response),
+				"HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\nAccept-Ranges: bytes\r\nContent-Length: %lu\r\n\r\n",
+				(unsigned long)stub->file_size);
+		}
+		size = end - start;
+		if (stub->drop_next_download) {
+			stub->drop_next_download = FALSE;
+			size = MIN(size, stub->drop_after);
+		}
+		file_server_send(client->sock, response, strlen(response));
+		file_server_send(client->sock, stub->file + start, size);
+		if (size < end - start) {
+			file_server_close_client(client);
+			return 0;
+		}
+	} else if (strncmp(client->buf, "PATCH ", 6) == 0) {
+		size_t offset = upload_offset ? (size_t)strtoul(upload_offset, NULL, 10) : 0;
+		size_t size;
+		stub->upload_chunk_requests++;
+		if (!upload_session || stub->upload_session[0] == '\0'
+			|| strncmp(upload_session, stub->upload_session, strlen(stub->upload_session)) != 0) {
+			snprintf(response, sizeof(response), "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+			file_server_send(client->sock, response, strlen(response));
+			return request_size;
+		}
+		if (offset != stub->upload_offset) {
+			file_server_send_upload_offset(stub, client, 409, "Conflict");
+			return request_size;
+		}
+		size = MIN(content_length, stub->file_size - stub->upload_offset);
+		if (stub->drop_next_upload_chunk) {
+			/* Only a part of the chunk is received before the connection is lost */
+			stub->drop_next_upload_chunk = FALSE;
+			size /= 2;
+			memcpy(stub->file + stub->upload_offset, body, size);
+			stub->upload_offset += size;
+			file_server_close_client(client);
+			return 0;
+		}
+		memcpy(stub->file + stub->upload_offset, body, size);
+		stub->upload_offset += size;
+		if (stub->upload_offset == stub->file_size) file_server_send_file_info(stub, client);
+		else file_server_send_upload_offset(stub, client, 204, "No Content");
+	} else if (content_length == 0 && upload_length) {
+		size_t length = (size_t)strtoul(upload_length, NULL, 10);
+		if (upload_session && stub->upload_session[0] != '\0' && length == stub->file_size
+			&& strncmp(upload_session, stub->upload_session, strlen(stub->upload_session)) == 0) {
+			stub->resumed_upload_sessions++;
+		} else {
+			snprintf(stub->upload_session, sizeof(stub->upload_session), "session-%d", ++stub->upload_session_count);
+			ms_free(stub->file);
+			stub->file_size = length;
+			stub->file = ms_malloc(length > 0 ? length : 1);
+			stub->upload_offset = 0;
+		}
+		file_server_send_upload_offset(stub, client, 201, "Created");
+	} else if (content_length == 0) {
+		snprintf(response, sizeof(response), "HTTP/1.1 204 No Content\r\nContent-Length: 0\r\n\r\n");
+		file_server_send(client->sock, response, strlen(response));
+	} else {
+		/* The single part starts after its headers and ends before the closing boundary */
+		const char *part = file_server_find(body, content_length, "\r\n\r\n");
+		const char *part_end = file_server_rfind(body, content_length, "\r\n--");
+		if (part && part_end && part_end > part) {
+			part += 4;
+			ms_free(stub->file);
+			stub->file_size = (size_t)(part_end - part);
+			stub->file = ms_malloc(stub->file_size);
+			memcpy(stub->file, part, stub->file_size);
+		}
+		stub->upload_session[0] = '\0';
+		file_server_send_file_info(stub, client);
+	}
+	return request_size;
+}
+
+static void *file_server_run(void *data) {
+	FileServerStub *stub = (FileServerStub *)data;
+	int i;
+
+	while (stub->running) {
+		fd_set fds;
+		struct timeval tv = { 0, 20000 };
+		ortp_socket_t maxfd = stub->sock;
+
+		FD_ZERO(&fds);
+		FD_SET(stub->sock, &fds);
+		for (i = 0; i < FILE_SERVER_MAX_CLIENTS; i++) {
+			if (stub->clients[i].sock == (ortp_socket_t)-1) continue;
+			FD_SET(stub->clients[i].sock, &fds);
+			if (stub->clients[i].sock > maxfd) maxfd = stub->clients[i].sock;
+		}
+		if (select((int)maxfd + 1, &fds, NULL, NULL, &tv) <= 0) continue;
+		if (FD_ISSET(stub->sock, &fds)) {
+			ortp_socket_t sock = accept(stub->sock, NULL, NULL);
+			for (i = 0; i < FILE_SERVER_MAX_CLIENTS && stub->clients[i].sock != (ortp_socket_t)-1; i++);
+			if (i < FILE_SERVER_MAX_CLIENTS) stub->clients[i].sock = sock;
+			else close_socket(sock);
+		}
+		for (i = 0; i < FILE_SERVER_MAX_CLIENTS; i++) {
+			FileServerClient *client = &stub->clients[i];
+			size_t handled;
+			int len;
+			if (client->sock == (ortp_socket_t)-1 || !FD_ISSET(client->sock, &fds)) continue;
+			if (client->capacity - client->size < 65536) {
+				client->capacity = client->capacity * 2 + 65536;
+				client->buf = ms_realloc(client->buf, client->capacity + 1);
+			}
+			len = (int)recv(client->sock, client->buf + client->size, (int)(client->capacity - client->size), 0);
+			if (len <= 0) {
+				file_server_close_client(client);
+				continue;
+			}
+			client->size += (size_t)len;
+			client->buf[client->size] = '\0';
+			while ((handled = file_server_handle_request(stub, client)) > 0) {
+				memmove(client->buf, client->buf + handled, client->size - handled + 1);
+				client->size -= handled;
+			}
+		}
+	}
+	for (i = 0; i < FILE_SERVER_MAX_CLIENTS; i++) {
+		if (stub->clients[i].sock != (ortp_socket_t)-1) close_socket(stub->clients[i].sock);
+		ms_free(stub->clients[i].buf);
+	}
+	return NULL;
+}
+
+FileServerStub *file_server_stub_start(void) {
+	FileServerStub *stub = ms_new0(FileServerStub, 1);
+	struct sockaddr_in addr;
+	socklen_t addrlen = sizeof(addr);
+	int i;
+
+	for (i = 0; i < FILE_SERVER_MAX_CLIENTS; i++)
+		stub->clients[i].sock = (ortp_socket_t)-1;
+	stub->sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = 0;
+	if (stub->sock == (ortp_socket_t)-1
+		|| bind(stub->sock, (struct sockaddr *)&addr, sizeof(addr)) != 0
+		|| listen(stub->sock, FILE_SERVER_MAX_CLIENTS) != 0
+		|| getsockname(stub->sock, (struct sockaddr *)&addr, &addrlen) != 0) {
+		ms_error("Cannot start file server stub");
+		if (stub->sock != (ortp_socket_t)-1) close_socket(stub->sock);
+		ms_free(stub);
+		return NULL;
+	}
+	stub->port = ntohs(addr.sin_port);
+	stub->running = TRUE;
+	ms_thread_create(&stub->thread, NULL, file_server_run, stub);
+	return stub;
+}
+
+void file_server_stub_stop(FileServerStub *stub) {
+	stub->running = FALSE;
+	ms_thread_join(stub->thread, NULL);
+	close_socket(stub->sock);
+	ms_free(stub->file);
+	ms_free(stub);
+}
+
+int file_server_stub_get_port(const FileServerStub *stub) {
+	return stub->port;
+}
+
+void file_server_stub_drop_next_download(FileServerStub *stub, size_t after) {
+	stub->drop_after = after;
+	stub->drop_next_download = TRUE;
+}
+
+int file_server_stub_get_range_requests(const FileServerStub *stub) {
+	return stub->range_requests;
+}
+
+void file_server_stub_drop_next_upload_chunk(FileServerStub *stub) {
+	stub->drop_next_upload_chunk = TRUE;
+}
 
+int file_server_stub_get_upload_chunk_requests(const FileServerStub *stub) {
+	return stub->upload_chunk_requests;
+}
+
+int file_server_stub_get_resumed_upload_sessions(const FileServerStub *stub) {
+	return stub->resumed_upload_sessions;
+}
+
+#define RLMI_NOTIFY_BOUNDARY "rlmi-notify-boundary"
+
+static size_t append_to_body(char *body, size_t size, size_t offset, const char *fmt, ...) {
+	va_list args;
+	int written;
+	va_start(args, fmt);
+	written = vsnprintf(body + offset, size - offset, fmt, args);
+	va_end(args);
+	BC_ASSERT_TRUE((written > 0) && ((size_t)written < size - offset));
+	return offset + (size_t)written;
+}
+
+LinphoneContent *liblinphone_tester_create_rlmi_notify_body(LinphoneCore *lc, int nb_resources, int version, bool_t full_state) {
+	LinphoneContent *content = linphone_core_create_content(lc);
+	size_t size = (size_t)nb_resources * 1024 + 1024;
+	char *body = ms_malloc(size);
+	size_t offset = 0;
+	int i;
+
+	offset = append_to_body(body, size, offset,
+		"--" RLMI_NOTIFY_BOUNDARY "\r\n"
+		"Content-Type: application/rlmi+xml;charset=\"UTF-8\"\r\n\r\n"
+		"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\r\n"
+		"<list xmlns=\"urn:ietf:params:xml:ns:rlmi\" uri=\"sip:rls@sip.example.org\" version=\"%d\" fullState=\"%s\">\r\n",
+		version, full_state ? "true" : "false");
+	for (i = 0; i < nb_resources; i++) {
+		offset = append_to_body(body, size, offset,
+			"<resource uri=\"sip:user%d@sip.example.org\"><name>User %d</name>"
+			"<instance id=\"i%d\" state=\"active\" cid=\"cid%d@sip.example.org\"/></resource>\r\n", i, i, i, i);
+	}
+	offset = append_to_body(body, size, offset, "</list>\r\n");
+	for (i = 0; i < nb_resources; i++) {
+		offset = append_to_body(body, size, offset,
+			"--" RLMI_NOTIFY_BOUNDARY "\r\n"
+			"Content-Transfer-Encoding: binary\r\n"
+			"Content-Id: cid%d@sip.example.org\r\n"
+			"Content-Type: application/pidf+xml;charset=\"UTF-8\"\r\n\r\n"
+			"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\r\n"
+			"<presence xmlns=\"urn:ietf:params:xml:ns:pidf\" xmlns:dm=\"urn:ietf:params:xml:ns:pidf:data-model\" "
+			"xmlns:rpid=\"urn:ietf:params:xml:ns:pidf:rpid\" entity=\"sip:user%d@sip.example.org\">"
+			"<tuple id=\"t%d\"><status><basic>open</basic></status><contact>sip:user%d@sip.example.org</contact>"
+			"<timestamp>2018-05-04T10:00:00Z</timestamp></tuple>"
+			"<dm:person id=\"p%d\"><rpid:activities><rpid:%s/></rpid:activities><dm:note>note %d</dm:note></dm:person>"
+			"</presence>\r\n", i, i, i, i, i, (i % 2) ? "away" : "on-the-phone", i);
+	}
+	offset = append_to_body(body, size, offset, "--" RLMI_NOTIFY_BOUNDARY "--\r\n");
+
+	linphone_content_set_type(content, "multipart");
+	linphone_content_set_subtype(content, "related");
+	linphone_content_add_content_type_parameter(content, "boundary", RLMI_NOTIFY_BOUNDARY);
+	linphone_content_set_string_buffer(content, body);
+	ms_free(body);
+	return content;
+}
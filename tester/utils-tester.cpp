@@ -16,8 +16,12 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <bctoolbox/crypto.h>
+
 #include "linphone/utils/utils.h"
 
+#include "utils/base64.h"
+
 #include "liblinphone_tester.h"
 #include "tester_utils.h"
 
@@ -71,9 +75,51 @@ static void trim () {
 	BC_ASSERT_STRING_EQUAL(result.c_str(), "hello world!");
 }
 
+static void base64 () {
+	const char *vectors[][2] = {
+		{ "", "" }, { "f", "Zg==" }, { "fo", "Zm8=" }, { "foo", "Zm9v" },
+		{ "foob", "Zm9vYg==" }, { "fooba", "Zm9vYmE=" }, { "foobar", "Zm9vYmFy" }
+	};
+	for (const auto &testVector : vectors) {
+		vector<uint8_t> data(testVector[0], testVector[0] + strlen(testVector[0]));
+		BC_ASSERT_STRING_EQUAL(Base64::encode(data).c_str(), testVector[1]);
+		BC_ASSERT_TRUE(Base64::decode(testVector[1]) == data);
+	}
+
+	// Sizes around the blocks of the vectorized code, checked against bctoolbox.
+	uint32_t seed = 0x42363421;
+	for (size_t size = 0; size < 200; size++) {
+		vector<uint8_t> data(size);
+		for (uint8_t &byte : data) {
+			seed = seed * 1103515245 + 12345;
+			byte = uint8_t(seed >> 16);
+		}
+		string encoded = Base64::encode(data);
+		size_t expectedSize = 0;
+		bctbx_base64_encode(nullptr, &expectedSize, data.data(), data.size());
+		string expected(expectedSize, '\0');
+		bctbx_base64_encode(reinterpret_cast<unsigned char *>(&expected[0]), &expectedSize, data.data(), data.size());
+		expected.resize(expectedSize);
+		BC_ASSERT_STRING_EQUAL(encoded.c_str(), expected.c_str());
+		BC_ASSERT_TRUE(Base64::decode(encoded) == data);
+
+		if (encoded.size() > 4) {
+			string wrapped = encoded;
+			wrapped.insert(encoded.size() / 2, "\r\n");
+			BC_ASSERT_TRUE(Base64::decode(wrapped) == data);
+
+			string invalid = encoded;
+			invalid[encoded.size() / 3] = '*';
+			vector<uint8_t> output;
+			BC_ASSERT_FALSE(Base64::decode(invalid.data(), invalid.size(), output));
+		}
+	}
+}
+
 test_t utils_tests[] = {
 	TEST_NO_TAG("split", split),
-	TEST_NO_TAG("trim", trim)
+	TEST_NO_TAG("trim", trim),
+	TEST_NO_TAG("base64", base64)
 };
 
 test_suite_t utils_test_suite = {